@@ -38,7 +38,7 @@ void Core2ForAWS_Init(void) {
         .sclk_io_num = 18,
         .quadwp_io_num = -1,
         .quadhd_io_num = -1,
-        .max_transfer_sz = 320 * 32 * 3,
+        .max_transfer_sz = DISP_SPI_MAX_TRANSFER_SZ,
     };
     spi_bus_initialize(SPI_HOST_USE, &bus_cfg, SPI_DMA_CHAN);
 #endif
@@ -266,14 +266,25 @@ void Core2ForAWS_Sk6812_Clear(void) {
 
 #define DISPLAY_BRIGHTNESS_MIN_VOLT 2200
 #define DISPLAY_BRIGHTNESS_MAX_VOLT 3300
-#define LV_TICK_PERIOD_MS 1
+/* Longest sleep of guiTask with no LVGL task due, in case something is
+ * changed without invalidating the screen (e.g. a new lv_task) */
+#define GUI_IDLE_MAX_SLEEP_MS 1000
 
 SemaphoreHandle_t xGuiSemaphore;
 
+static TaskHandle_t gui_task_handle;
+static volatile uint32_t gui_wakeups = 0;
+static int64_t gui_stats_time = 0;
+static uint32_t gui_stats_wakeups = 0;
+static uint32_t gui_stats_frames = 0;
+static uint32_t gui_stats_latency_us = 0;
+
 static void guiTask(void *pvParameter);
-static void lv_tick_task(void *arg);
+static void gui_wake(void);
 
 #if CONFIG_SOFTWARE_FT6336U_SUPPORT
+static lv_indev_t *touch_indev;
+static touch_ring_reader_t touch_reader;
 static bool ft6336u_read(lv_indev_drv_t * drv, lv_indev_data_t * data);
 #endif
 
@@ -295,7 +306,11 @@ void Core2ForAWS_Display_Init(void) {
 
     uint32_t size_in_px = DISP_BUF_SIZE;
     lv_color_t *buf1 = heap_caps_malloc(DISP_BUF_SIZE * sizeof(lv_color_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT); //Assuming max size of lv_color_t = 16bit, DISP_BUF_SIZE calculated from max horizontal display size 480
+#if CONFIG_LV_DISP_BUF_MODE_FULL_FRAME
+    lv_color_t *buf2 = NULL; // A single framebuffer: every area is rendered and sent in one part
+#else
     lv_color_t *buf2 = heap_caps_malloc(DISP_BUF_SIZE * sizeof(lv_color_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT); //Assuming max size of lv_color_t = 16bit, DISP_BUF_SIZE calculated from max horizontal display size 480
+#endif
     
     /* Initialize the working buffer depending on the selected display */
     lv_disp_buf_init(&disp_buf, buf1, buf2, size_in_px);
@@ -305,7 +320,8 @@ void Core2ForAWS_Display_Init(void) {
     disp_drv.flush_cb = disp_driver_flush;
 
     disp_drv.buffer = &disp_buf;
-    lv_disp_drv_register(&disp_drv);
+    lv_disp_t *disp = lv_disp_drv_register(&disp_drv);
+    disp_driver_attach(disp, gui_wake);
 
     /* Register an input device when enabled on the menuconfig */
 #if CONFIG_SOFTWARE_FT6336U_SUPPORT
@@ -313,21 +329,38 @@ void Core2ForAWS_Display_Init(void) {
     lv_indev_drv_init(&indev_drv);
     indev_drv.read_cb = ft6336u_read;
     indev_drv.type = LV_INDEV_TYPE_POINTER;
-    lv_indev_drv_register(&indev_drv);
+    FT6336U_ReaderInit(&touch_reader);
+    touch_indev = lv_indev_drv_register(&indev_drv);
 #endif
 
-    /* Create and start a periodic timer interrupt to call lv_tick_inc */
-    const esp_timer_create_args_t periodic_timer_args = {
-        .callback = &lv_tick_task,
-        .name = "periodic_gui"
-    };
-    esp_timer_handle_t periodic_timer;
-    ESP_ERROR_CHECK(esp_timer_create(&periodic_timer_args, &periodic_timer));
-    ESP_ERROR_CHECK(esp_timer_start_periodic(periodic_timer, LV_TICK_PERIOD_MS * 1000));
-
     xSemaphoreGive(xGuiSemaphore);
 
-    xTaskCreatePinnedToCore(guiTask, "gui", 4096*2, NULL, 2, NULL, 1);
+    xTaskCreatePinnedToCore(guiTask, "gui", 4096*2, NULL, 2, &gui_task_handle, 1);
+
+#if CONFIG_SOFTWARE_FT6336U_SUPPORT
+    /* Wake guiTask on touch instead of polling the panel */
+    FT6336U_SetEventTask(gui_task_handle);
+#endif
+}
+
+void Core2ForAWS_Display_GetStats(Core2ForAWS_Display_Stats_t *stats) {
+    disp_flush_stats_t flush;
+    disp_driver_get_flush_stats(&flush);
+
+    int64_t now = esp_timer_get_time();
+    int64_t elapsed_us = now - gui_stats_time;
+    uint32_t wakeups = gui_wakeups - gui_stats_wakeups;
+    uint32_t frames = flush.frames - gui_stats_frames;
+
+    stats->wakeups_per_sec = elapsed_us > 0 ? (uint32_t)(wakeups * 1000000LL / elapsed_us) : 0;
+    stats->frames = frames;
+    stats->latency_avg_us = frames ? (flush.latency_us - gui_stats_latency_us) / frames : 0;
+    stats->latency_max_us = flush.latency_max_us;
+
+    gui_stats_time = now;
+    gui_stats_wakeups = gui_wakeups;
+    gui_stats_frames = flush.frames;
+    gui_stats_latency_us = flush.latency_us;
 }
 
 void Core2ForAWS_Display_SetBrightness(uint8_t brightness) {
@@ -345,42 +378,81 @@ void Core2ForAWS_LED_Enable(uint8_t enable) {
 
 #if CONFIG_SOFTWARE_FT6336U_SUPPORT
 static bool ft6336u_read(lv_indev_drv_t * drv, lv_indev_data_t * data) {
-    bool valid = true;
-    uint16_t x = 0;
-    uint16_t y = 0;
-    FT6336U_GetTouch(&x, &y, &valid);
-    data->point.x = x;
-    data->point.y = y;
-    data->state = valid == false ? LV_INDEV_STATE_REL : LV_INDEV_STATE_PR;
+    static lv_point_t last_point;
+    static lv_indev_state_t last_state = LV_INDEV_STATE_REL;
+    touch_sample_t sample;
+
+    /* Replay every sample in order so a tap shorter than the LVGL read
+     * period still produces a press and a release */
+    if (FT6336U_ReadSample(&touch_reader, &sample)) {
+        if (sample.points) {
+            last_point.x = sample.x;
+            last_point.y = sample.y;
+            last_state = LV_INDEV_STATE_PR;
+        } else {
+            last_state = LV_INDEV_STATE_REL;
+        }
+    }
+    data->point = last_point;
+    data->state = last_state;
+
+    /* Ask LVGL to call again while samples are buffered */
+    if (FT6336U_SamplesPending(&touch_reader)) {
+        return true;
+    }
+
+    /* Nothing to poll until the panel reports a touch, guiTask resumes
+     * the read task when it's woken up */
+    if (data->state == LV_INDEV_STATE_REL) {
+        lv_task_set_prio(drv->read_task, LV_TASK_PRIO_OFF);
+    }
     return false;
 }
 #endif
 
-static void lv_tick_task(void *arg) {
-    (void) arg;
-    lv_tick_inc(LV_TICK_PERIOD_MS);
+/* Called by the display driver on invalidation and by the touch panel on
+ * new samples */
+static void gui_wake(void) {
+    if (gui_task_handle) {
+        xTaskNotifyGive(gui_task_handle);
+    }
 }
 
 /**
- * @brief The FreeRTOS task that periodically calls lv_task_handler
+ * @brief The FreeRTOS task that calls lv_task_handler when there is work
  * 
- * A FreeRTOS task function that calls [lv_task_handler](https://docs.lvgl.io/7.11/porting/task-handler.html)
- * after a tick (depends on task prioritization), which executes 
- * LVGL tasks to then pass to the display controller. Learn more 
- * about LVGL Tasks[https://docs.lvgl.io/7.11/overview/task.html].
+ * A FreeRTOS task function that calls [lv_task_handler](https://docs.lvgl.io/7.11/porting/task-handler.html),
+ * which executes LVGL tasks to then pass to the display controller.
+ * Learn more about LVGL Tasks[https://docs.lvgl.io/7.11/overview/task.html].
+ * Between calls the task sleeps until the next LVGL task is due, the screen
+ * is invalidated or the touch panel reports a touch.
  */
 static void guiTask(void *pvParameter) {
     
     (void) pvParameter;
 
+    uint32_t time_till_next = 0;
 
     while (1) {
-        /* Delay 1 tick (assumes FreeRTOS tick is 10ms */
-        vTaskDelay(pdMS_TO_TICKS(10));
+        /* Sleep at least 1 tick (assumes FreeRTOS tick is 10ms) */
+        TickType_t wait = pdMS_TO_TICKS(time_till_next < GUI_IDLE_MAX_SLEEP_MS ? time_till_next : GUI_IDLE_MAX_SLEEP_MS);
+        if (wait == 0) {
+            wait = 1;
+        }
+
+        ulTaskNotifyTake(pdTRUE, wait);
+        gui_wakeups++;
 
         /* Try to take the semaphore, call lvgl related function on success */
         if (pdTRUE == xSemaphoreTake(xGuiSemaphore, portMAX_DELAY)) {
-            lv_task_handler();
+#if CONFIG_SOFTWARE_FT6336U_SUPPORT
+            /* The wakeup may come from the touch panel, read it at least once */
+            if (touch_indev) {
+                lv_task_set_prio(touch_indev->driver.read_task, LV_TASK_PRIO_HIGH);
+                lv_task_ready(touch_indev->driver.read_task);
+            }
+#endif
+            time_till_next = lv_task_handler();
             xSemaphoreGive(xGuiSemaphore);
        }
     }
@@ -5,6 +5,11 @@
 
 #pragma once
 
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "touch_ring.h"
+
 /**
  * @brief Initializes the FT6336U over I2C.
  * 
@@ -21,11 +26,89 @@
  * FT6336U_INTR_PIN). If multiple press events are stashed by the hardware, the
  * FreeRTOS task keeps retrieving them one by one at an interval of 20 ticks.
  * Once all the events are retrieved, the task suspends itself.
+ *
+ * Every read is pushed as a timestamped sample into a lock-free ring, so
+ * readers never block the task or each other, and a tap that is pressed
+ * and released between two reads of a consumer is not lost.
  */
 /* @[declare_ft6336_init] */
 void FT6336U_Init();
 /* @[declare_ft6336_init] */
 
+/**
+ * @brief Sets a task to notify whenever a new touch sample is read.
+ *
+ * The task is woken with xTaskNotifyGive() each time the `FT6336Task`
+ * reads the panel, so it can wait with ulTaskNotifyTake() instead of
+ * polling the touch state.
+ *
+ * @note The Core2ForAWS_Display_Init() sets this to the `gui` task.
+ *
+ * @param[in] task The task to notify, or NULL to stop notifying.
+ */
+/* @[declare_ft6336_seteventtask] */
+void FT6336U_SetEventTask(TaskHandle_t task);
+/* @[declare_ft6336_seteventtask] */
+
+/**
+ * @brief Starts a reader of the touch sample ring at the newest sample.
+ *
+ * Each consumer needs its own reader. Samples pushed after this call can
+ * be retrieved in order with FT6336U_ReadSample().
+ *
+ * @param[out] reader The reader to initialize.
+ */
+/* @[declare_ft6336_readerinit] */
+void FT6336U_ReaderInit(touch_ring_reader_t *reader);
+/* @[declare_ft6336_readerinit] */
+
+/**
+ * @brief Retrieves the next touch sample for a reader.
+ *
+ * Never blocks. If the reader fell more than the ring size behind, the
+ * oldest samples are skipped and counted in `reader->dropped`.
+ *
+ * **Example:**
+ *
+ * Handle every touch sample since the last call.
+ * @code{c}
+ *  static touch_ring_reader_t reader;
+ *  touch_sample_t sample;
+ *
+ *  while (FT6336U_ReadSample(&reader, &sample)) {
+ *      printf("%lld: %d points at %d,%d\n", sample.time_us, sample.points, sample.x, sample.y);
+ *  }
+ * @endcode
+ *
+ * @param[in, out] reader The reader, advanced past the returned sample.
+ * @param[out] sample The touch sample.
+ * @return true if a sample was returned, false if there are no new samples.
+ */
+/* @[declare_ft6336_readsample] */
+bool FT6336U_ReadSample(touch_ring_reader_t *reader, touch_sample_t *sample);
+/* @[declare_ft6336_readsample] */
+
+/**
+ * @brief Retrieves the number of samples not read yet by a reader.
+ *
+ * @param[in] reader The reader.
+ * @return The number of pending samples.
+ */
+/* @[declare_ft6336_samplespending] */
+uint32_t FT6336U_SamplesPending(const touch_ring_reader_t *reader);
+/* @[declare_ft6336_samplespending] */
+
+/**
+ * @brief Retrieves the most recent touch sample, including the second
+ * touch point.
+ *
+ * @param[out] sample The touch sample.
+ * @return false if the panel has not been read yet.
+ */
+/* @[declare_ft6336_getsample] */
+bool FT6336U_GetSample(touch_sample_t *sample);
+/* @[declare_ft6336_getsample] */
+
 /**
  * @brief Retrieves the most recent touch data from the FT6336U.
  * 
@@ -0,0 +1,284 @@
+#include <math.h>
+#include <string.h>
+
+#include "mic_features.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/* Samples filtered per pass. Each filter runs over a whole chunk before
+ * the next one, which keeps the inner loops short and branch-free. */
+#define MIC_FEATURES_CHUNK 64
+
+/* Torn reads mic_features_latest() retries before giving up */
+#define MIC_FEATURES_READ_RETRIES 4
+
+/* Squared full scale, 0 dBFS */
+#define FULL_SCALE_SQ (32768.0f * 32768.0f)
+
+/* A-weighting pole frequencies from IEC 61672-1, in Hz */
+#define A_WEIGHT_F1 20.598997
+#define A_WEIGHT_F2 107.65265
+#define A_WEIGHT_F3 737.86223
+#define A_WEIGHT_F4 12194.217
+
+/* Bilinear transform of (b2 s^2 + b1 s + b0) / (a2 s^2 + a1 s + a0) */
+static void biquad_from_analog(mic_biquad_t *bq, double fs,
+                               double b2, double b1, double b0,
+                               double a2, double a1, double a0) {
+    double k = 2.0 * fs;
+    double k2 = k * k;
+    double norm = a2 * k2 + a1 * k + a0;
+
+    bq->b0 = (b2 * k2 + b1 * k + b0) / norm;
+    bq->b1 = (2.0 * b0 - 2.0 * b2 * k2) / norm;
+    bq->b2 = (b2 * k2 - b1 * k + b0) / norm;
+    bq->a1 = (2.0 * a0 - 2.0 * a2 * k2) / norm;
+    bq->a2 = (a2 * k2 - a1 * k + a0) / norm;
+    bq->z1 = 0;
+    bq->z2 = 0;
+}
+
+/* Magnitude of a cascade of sections at frequency f */
+static double biquad_gain(const mic_biquad_t *bq, int count, double fs, double f) {
+    double w = 2.0 * M_PI * f / fs;
+    double gain = 1.0;
+
+    for (int i = 0; i < count; i++) {
+        /* H(e^jw) with z^-1 = cos w - j sin w */
+        double c1 = cos(w), s1 = -sin(w), c2 = cos(2 * w), s2 = -sin(2 * w);
+        double nr = bq[i].b0 + bq[i].b1 * c1 + bq[i].b2 * c2;
+        double ni = bq[i].b1 * s1 + bq[i].b2 * s2;
+        double dr = 1.0 + bq[i].a1 * c1 + bq[i].a2 * c2;
+        double di = bq[i].a1 * s1 + bq[i].a2 * s2;
+        gain *= sqrt((nr * nr + ni * ni) / (dr * dr + di * di));
+    }
+    return gain;
+}
+
+/* Analog pole pre-warped so the digital filter has it at the same frequency */
+static double prewarp(double f, double fs) {
+    return 2.0 * fs * tan(M_PI * f / fs);
+}
+
+static void a_weight_design(mic_biquad_t *bq, double fs) {
+    double w1 = prewarp(A_WEIGHT_F1, fs);
+    double w2 = prewarp(A_WEIGHT_F2, fs);
+    double w3 = prewarp(A_WEIGHT_F3, fs);
+    double w4 = prewarp(A_WEIGHT_F4 < fs * 0.45 ? A_WEIGHT_F4 : fs * 0.45, fs);
+
+    /* s^2 / (s + w1)^2, s^2 / ((s + w2)(s + w3)), 1 / (s + w4)^2 */
+    biquad_from_analog(&bq[0], fs, 1, 0, 0, 1, 2 * w1, w1 * w1);
+    biquad_from_analog(&bq[1], fs, 1, 0, 0, 1, w2 + w3, w2 * w3);
+    biquad_from_analog(&bq[2], fs, 0, 0, 1, 1, 2 * w4, w4 * w4);
+
+    /* 0 dB at 1 kHz */
+    double g = 1.0 / biquad_gain(bq, 3, fs, 1000.0);
+    bq[2].b0 *= g;
+    bq[2].b1 *= g;
+    bq[2].b2 *= g;
+}
+
+/* Band-pass with 0 dB peak gain at the geometric centre of the band */
+static void band_design(mic_biquad_t *bq, double fs, double lo, double hi) {
+    double fc = sqrt(lo * hi);
+    double q = fc / (hi - lo);
+    double w0 = 2.0 * M_PI * fc / fs;
+    double alpha = sin(w0) / (2.0 * q);
+    double a0 = 1.0 + alpha;
+
+    bq->b0 = alpha / a0;
+    bq->b1 = 0;
+    bq->b2 = -alpha / a0;
+    bq->a1 = -2.0 * cos(w0) / a0;
+    bq->a2 = (1.0 - alpha) / a0;
+    bq->z1 = 0;
+    bq->z2 = 0;
+}
+
+static void biquad_run(mic_biquad_t *bq, float *x, int n) {
+    float b0 = bq->b0, b1 = bq->b1, b2 = bq->b2, a1 = bq->a1, a2 = bq->a2;
+    float z1 = bq->z1, z2 = bq->z2;
+
+    for (int i = 0; i < n; i++) {
+        float in = x[i];
+        float out = b0 * in + z1;
+        z1 = b1 * in - a1 * out + z2;
+        z2 = b2 * in - a2 * out;
+        x[i] = out;
+    }
+    bq->z1 = z1;
+    bq->z2 = z2;
+}
+
+static float sum_sq(const float *x, int n) {
+    float sum = 0;
+    for (int i = 0; i < n; i++) {
+        sum += x[i] * x[i];
+    }
+    return sum;
+}
+
+static float level_db(float mean_sq) {
+    if (mean_sq <= 0) {
+        return MIC_FEATURES_FLOOR_DB;
+    }
+    float db = 10.0f * log10f(mean_sq / FULL_SCALE_SQ);
+    return db > MIC_FEATURES_FLOOR_DB ? db : MIC_FEATURES_FLOOR_DB;
+}
+
+static void publish(mic_features_t *ctx, const mic_features_frame_t *frame) {
+    uint32_t seq = atomic_load_explicit(&ctx->latest_seq, memory_order_relaxed);
+
+    atomic_store_explicit(&ctx->latest_seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    memcpy(&ctx->latest, frame, sizeof(*frame));
+    atomic_store_explicit(&ctx->latest_seq, seq + 2, memory_order_release);
+}
+
+/* Combine the hops of a full frame */
+static void frame_complete(mic_features_t *ctx, mic_features_frame_t *frame) {
+    const mic_features_config_t *cfg = &ctx->config;
+    uint64_t total_sq = 0;
+    float total_a = 0;
+    float total_band[MIC_FEATURES_MAX_BANDS] = {0};
+
+    memset(frame, 0, sizeof(*frame));
+    for (uint8_t h = 0; h < ctx->hop_count; h++) {
+        const mic_hop_t *hop = &ctx->hops[h];
+        total_sq += hop->sum_sq;
+        total_a += hop->sum_sq_a;
+        for (uint8_t b = 0; b < cfg->band_count; b++) {
+            total_band[b] += hop->sum_sq_band[b];
+        }
+        if (hop->peak > frame->peak) {
+            frame->peak = hop->peak;
+        }
+    }
+
+    float mean_sq = (float)total_sq / cfg->frame_len;
+    frame->seq = ++ctx->seq;
+    frame->rms = sqrtf(mean_sq / FULL_SCALE_SQ);
+    frame->dbfs = level_db(mean_sq);
+    frame->dba = level_db(total_a / cfg->frame_len);
+    for (uint8_t b = 0; b < cfg->band_count; b++) {
+        frame->band_db[b] = level_db(total_band[b] / cfg->frame_len);
+    }
+}
+
+bool mic_features_init(mic_features_t *ctx, const mic_features_config_t *config) {
+    if (ctx == NULL || config == NULL || config->sample_rate == 0 || config->hop_len == 0 ||
+        config->frame_len % config->hop_len != 0 ||
+        config->frame_len / config->hop_len > MIC_FEATURES_MAX_HOPS ||
+        config->band_count > MIC_FEATURES_MAX_BANDS) {
+        return false;
+    }
+    for (uint8_t b = 0; b < config->band_count; b++) {
+        if (config->band_edges_hz[b] == 0 || config->band_edges_hz[b] >= config->band_edges_hz[b + 1] ||
+            config->band_edges_hz[b + 1] * 2 >= config->sample_rate) {
+            return false;
+        }
+    }
+
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->config = *config;
+    ctx->hop_count = config->frame_len / config->hop_len;
+    atomic_init(&ctx->latest_seq, 0);
+
+    a_weight_design(ctx->a_weight, config->sample_rate);
+    for (uint8_t b = 0; b < config->band_count; b++) {
+        band_design(&ctx->band[b], config->sample_rate,
+                    config->band_edges_hz[b], config->band_edges_hz[b + 1]);
+    }
+    return true;
+}
+
+uint32_t mic_features_process(mic_features_t *ctx, const int16_t *pcm, size_t count, mic_features_frame_t *frame) {
+    const mic_features_config_t *cfg = &ctx->config;
+    float x[MIC_FEATURES_CHUNK];
+    float y[MIC_FEATURES_CHUNK];
+    mic_features_frame_t out;
+    uint32_t published = 0;
+
+    while (count > 0) {
+        mic_hop_t *hop = &ctx->hops[ctx->hop_index];
+        int n = cfg->hop_len - ctx->hop_fill;
+        if (n > MIC_FEATURES_CHUNK) {
+            n = MIC_FEATURES_CHUNK;
+        }
+        if ((size_t)n > count) {
+            n = count;
+        }
+
+        /* Exact integer energy and peak */
+        uint64_t sq = 0;
+        uint16_t peak = hop->peak;
+        for (int i = 0; i < n; i++) {
+            int32_t s = pcm[i];
+            uint16_t mag = s < 0 ? -s : s;
+            sq += (uint32_t)(s * s);
+            peak = mag > peak ? mag : peak;
+            x[i] = s;
+        }
+        hop->sum_sq += sq;
+        hop->peak = peak;
+
+        memcpy(y, x, n * sizeof(float));
+        for (int k = 0; k < 3; k++) {
+            biquad_run(&ctx->a_weight[k], y, n);
+        }
+        hop->sum_sq_a += sum_sq(y, n);
+
+        for (uint8_t b = 0; b < cfg->band_count; b++) {
+            memcpy(y, x, n * sizeof(float));
+            biquad_run(&ctx->band[b], y, n);
+            hop->sum_sq_band[b] += sum_sq(y, n);
+        }
+
+        pcm += n;
+        count -= n;
+        ctx->hop_fill += n;
+        if (ctx->hop_fill < cfg->hop_len) {
+            continue;
+        }
+
+        /* Hop done, publish once the frame has enough of them */
+        ctx->hop_fill = 0;
+        if (ctx->hops_filled < ctx->hop_count) {
+            ctx->hops_filled++;
+        }
+        if (ctx->hops_filled == ctx->hop_count) {
+            frame_complete(ctx, &out);
+            publish(ctx, &out);
+            published++;
+        }
+        ctx->hop_index = (ctx->hop_index + 1) % ctx->hop_count;
+        memset(&ctx->hops[ctx->hop_index], 0, sizeof(mic_hop_t));
+    }
+
+    if (frame != NULL && published) {
+        *frame = out;
+    }
+    return published;
+}
+
+bool mic_features_latest(mic_features_t *ctx, mic_features_frame_t *frame) {
+    /* Bounded: a reader that preempted the producer mid-update on the same
+     * core would otherwise spin forever, the producer never gets to finish */
+    for (int retry = 0; retry < MIC_FEATURES_READ_RETRIES; retry++) {
+        uint32_t seq = atomic_load_explicit(&ctx->latest_seq, memory_order_acquire);
+        if (seq == 0) {
+            return false;
+        }
+        if (seq & 1) {
+            continue;
+        }
+        memcpy(frame, &ctx->latest, sizeof(*frame));
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&ctx->latest_seq, memory_order_relaxed) == seq) {
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,190 @@
+/*
+ * Host-side stress test for the touch sample ring in ../ft6336u/touch_ring.c.
+ *
+ * A synthetic producer pushes samples as fast as it can, or paced like the
+ * FT6336U task, while several readers consume them concurrently. Every
+ * field of a sample is derived from its number, so a torn copy, a sample
+ * returned twice or out of order, or a gap that is not accounted for in
+ * `dropped` fails the test.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "touch_ring.h"
+
+#define READERS 4
+
+typedef struct {
+    uint32_t samples;       /* Samples to push */
+    useconds_t period_us;   /* Producer pause between samples, 0 to spin */
+    useconds_t reader_us;   /* Reader pause between batches */
+} round_t;
+
+typedef struct {
+    const round_t *round;
+    touch_ring_reader_t reader;
+    uint32_t read;
+    int latest;             /* Also hammer touch_ring_latest() */
+} reader_arg_t;
+
+static touch_ring_t ring;
+static volatile int producer_done;
+
+static void make_sample(uint32_t n, touch_sample_t *s)
+{
+    s->time_us = (int64_t)n * 20000;
+    s->points = n % 3;
+    s->x = n & 0xfff;
+    s->y = (n >> 12) & 0xfff;
+    s->x2 = ~n & 0xfff;
+    s->y2 = (~n >> 12) & 0xfff;
+}
+
+static void check_sample(const touch_sample_t *s)
+{
+    touch_sample_t want;
+    make_sample((uint32_t)(s->time_us / 20000), &want);
+    assert(s->time_us % 20000 == 0);
+    assert(s->points == want.points);
+    assert(s->x == want.x && s->y == want.y);
+    assert(s->x2 == want.x2 && s->y2 == want.y2);
+}
+
+static void *producer(void *arg)
+{
+    const round_t *round = arg;
+    touch_sample_t s;
+
+    for (uint32_t n = 0; n < round->samples; n++) {
+        make_sample(n, &s);
+        touch_ring_push(&ring, &s);
+        if (round->period_us) {
+            usleep(round->period_us);
+        }
+    }
+    producer_done = 1;
+    return NULL;
+}
+
+static void *consumer(void *arg)
+{
+    reader_arg_t *r = arg;
+    touch_sample_t s;
+    int64_t last = -1;
+
+    for (;;) {
+        int done = producer_done;
+
+        while (touch_ring_read(&ring, &r->reader, &s)) {
+            check_sample(&s);
+            assert(s.time_us / 20000 == (int64_t)r->reader.next - 1);
+            assert(s.time_us / 20000 > last);
+            last = s.time_us / 20000;
+            r->read++;
+        }
+        if (r->latest && touch_ring_latest(&ring, &s)) {
+            check_sample(&s);
+        }
+        if (done) {
+            break;
+        }
+        if (r->round->reader_us) {
+            usleep(r->round->reader_us);
+        }
+    }
+
+    assert(r->read + r->reader.dropped == r->round->samples);
+    return NULL;
+}
+
+static void run_round(const round_t *round)
+{
+    pthread_t prod, cons[READERS];
+    reader_arg_t args[READERS];
+
+    touch_ring_init(&ring);
+    producer_done = 0;
+
+    for (int i = 0; i < READERS; i++) {
+        args[i].round = round;
+        args[i].read = 0;
+        args[i].latest = i & 1;
+        touch_ring_reader_init(&ring, &args[i].reader);
+        pthread_create(&cons[i], NULL, consumer, &args[i]);
+    }
+    pthread_create(&prod, NULL, producer, (void *)round);
+
+    pthread_join(prod, NULL);
+    for (int i = 0; i < READERS; i++) {
+        pthread_join(cons[i], NULL);
+    }
+
+    printf("%8u samples, producer %4u us, readers %5u us:", round->samples,
+           (unsigned)round->period_us, (unsigned)round->reader_us);
+    for (int i = 0; i < READERS; i++) {
+        printf(" %u/%u", args[i].read, args[i].reader.dropped);
+    }
+    printf(" (read/dropped)\n");
+}
+
+static void test_sequential(void)
+{
+    touch_ring_reader_t reader;
+    touch_sample_t s;
+
+    touch_ring_init(&ring);
+    assert(!touch_ring_latest(&ring, &s));
+    touch_ring_reader_init(&ring, &reader);
+    assert(!touch_ring_read(&ring, &reader, &s));
+
+    /* Overflow by ten: the reader skips to the oldest sample still held */
+    for (uint32_t n = 0; n < TOUCH_RING_SIZE + 10; n++) {
+        make_sample(n, &s);
+        touch_ring_push(&ring, &s);
+    }
+    assert(touch_ring_pending(&ring, &reader) == TOUCH_RING_SIZE - 1);
+    assert(touch_ring_read(&ring, &reader, &s));
+    assert(s.time_us / 20000 == 11);
+    assert(reader.dropped == 11);
+
+    assert(touch_ring_latest(&ring, &s));
+    assert(s.time_us / 20000 == TOUCH_RING_SIZE + 9);
+
+    uint32_t read = 1;
+    while (touch_ring_read(&ring, &reader, &s)) {
+        check_sample(&s);
+        read++;
+    }
+    assert(read + reader.dropped == TOUCH_RING_SIZE + 10);
+    assert(touch_ring_pending(&ring, &reader) == 0);
+
+    /* Newest slot overwritten on every retry, as when the producer laps
+     * the ring under a slow reader: the reader gives up instead of
+     * spinning */
+    touch_slot_t *slot = &ring.slots[(TOUCH_RING_SIZE + 9) % TOUCH_RING_SIZE];
+    atomic_store(&slot->seq, 0);
+    assert(!touch_ring_latest(&ring, &s));
+    atomic_store(&slot->seq, TOUCH_RING_SIZE + 10);
+    assert(touch_ring_latest(&ring, &s));
+}
+
+int main(void)
+{
+    static const round_t rounds[] = {
+        { 2000000, 0, 0 },      /* Everyone spins, constant lapping */
+        { 200000, 0, 50 },      /* Slow readers */
+        { 2000, 200, 1000 },    /* Paced producer, readers keep up */
+    };
+
+    test_sequential();
+
+    for (size_t i = 0; i < sizeof(rounds) / sizeof(rounds[0]); i++) {
+        run_round(&rounds[i]);
+    }
+
+    printf("all tests passed\n");
+    return 0;
+}
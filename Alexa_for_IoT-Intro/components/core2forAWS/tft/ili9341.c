@@ -11,6 +11,7 @@
 #include "freertos/semphr.h"
 #include "ili9341.h"
 #include "disp_spi.h"
+#include "disp_area.h"
 #include "driver/gpio.h"
 #include "esp_log.h"
 #include "axp192.h"
@@ -35,14 +36,18 @@ typedef struct {
  *  STATIC PROTOTYPES
  **********************/
 static void ili9341_set_orientation(uint8_t orientation);
+static uint32_t ili9341_set_window(const lv_area_t * area);
 
 static void ili9341_send_cmd(uint8_t cmd);
 static void ili9341_send_data(void * data, uint16_t length);
-static void ili9341_send_color(void * data, uint16_t length);
+static void ili9341_send_color(void * data, uint32_t length, bool last);
 
 /**********************
  *  STATIC VARIABLES
  **********************/
+/* Address window currently latched in the controller */
+static lv_area_t window;
+static bool window_valid;
 
 /**********************
  *      MACROS
@@ -108,33 +113,15 @@ void ili9341_init(void)
 	ili9341_send_cmd(0x21);
 }
 
-void ili9341_flush(lv_disp_drv_t * drv, const lv_area_t * area, lv_color_t * color_map)
+uint32_t ili9341_flush(lv_disp_drv_t * drv, const lv_area_t * area, lv_color_t * color_map)
 {
-	uint8_t data[4];
-
-	/*Column addresses*/
-	ili9341_send_cmd(0x2A);
-	data[0] = (area->x1 >> 8) & 0xFF;
-	data[1] = area->x1 & 0xFF;
-	data[2] = (area->x2 >> 8) & 0xFF;
-	data[3] = area->x2 & 0xFF;
-	ili9341_send_data(data, 4);
-
-	/*Page addresses*/
-	ili9341_send_cmd(0x2B);
-	data[0] = (area->y1 >> 8) & 0xFF;
-	data[1] = area->y1 & 0xFF;
-	data[2] = (area->y2 >> 8) & 0xFF;
-	data[3] = area->y2 & 0xFF;
-	ili9341_send_data(data, 4);
-
-	/*Memory write*/
-	ili9341_send_cmd(0x2C);
-
+	uint32_t cmd_bytes = ili9341_set_window(area);
 
 	uint32_t size = lv_area_get_width(area) * lv_area_get_height(area);
 
-	ili9341_send_color((void*)color_map, size * 2);
+	ili9341_send_color((void*)color_map, size * 2, lv_disp_flush_is_last(drv));
+
+	return cmd_bytes;
 }
 
 void ili9341_sleep_in()
@@ -155,26 +142,62 @@ void ili9341_sleep_out()
  *   STATIC FUNCTIONS
  **********************/
 
+static uint32_t ili9341_set_window(const lv_area_t * area)
+{
+	uint8_t caset[4] = {
+		(area->x1 >> 8) & 0xFF, area->x1 & 0xFF,
+		(area->x2 >> 8) & 0xFF, area->x2 & 0xFF,
+	};
+	uint8_t raset[4] = {
+		(area->y1 >> 8) & 0xFF, area->y1 & 0xFF,
+		(area->y2 >> 8) & 0xFF, area->y2 & 0xFF,
+	};
+	const uint8_t cmd_caset = 0x2A;
+	const uint8_t cmd_raset = 0x2B;
+	const uint8_t cmd_ramwr = 0x2C;
+
+	/* RAMWR restarts at the latched column/page start, so addresses the
+	 * controller already holds (e.g. the columns of consecutive full-width
+	 * bands) do not need to be sent again. */
+	bool send_caset, send_raset;
+	uint32_t cmd_bytes = disp_area_window_cmd_bytes(window_valid ? &window : NULL, area,
+	                                                &send_caset, &send_raset);
+
+	disp_spi_segment_t chain[5];
+	size_t n = 0;
+	if (send_caset) {
+		chain[n++] = (disp_spi_segment_t){ &cmd_caset, 1, true };
+		chain[n++] = (disp_spi_segment_t){ caset, 4, false };
+	}
+	if (send_raset) {
+		chain[n++] = (disp_spi_segment_t){ &cmd_raset, 1, true };
+		chain[n++] = (disp_spi_segment_t){ raset, 4, false };
+	}
+	chain[n++] = (disp_spi_segment_t){ &cmd_ramwr, 1, true };
+	disp_spi_send_chain(chain, n);
+
+	lv_area_copy(&window, area);
+	window_valid = true;
+
+	return cmd_bytes;
+}
+
 
 static void ili9341_send_cmd(uint8_t cmd)
 {
-    disp_wait_for_pending_transactions();
-    gpio_set_level(ILI9341_DC, 0);	 /*Command mode*/
-    disp_spi_send_data(&cmd, 1);
+    /* Any other command may move the address window */
+    window_valid = false;
+    disp_spi_send_cmd(&cmd, 1);
 }
 
 static void ili9341_send_data(void * data, uint16_t length)
 {
-    disp_wait_for_pending_transactions();
-    gpio_set_level(ILI9341_DC, 1);	 /*Data mode*/
     disp_spi_send_data(data, length);
 }
 
-static void ili9341_send_color(void * data, uint16_t length)
+static void ili9341_send_color(void * data, uint32_t length, bool last)
 {
-    disp_wait_for_pending_transactions();
-    gpio_set_level(ILI9341_DC, 1);   /*Data mode*/
-    disp_spi_send_colors(data, length);
+    disp_spi_send_colors(data, length, last);
 }
 
 static void ili9341_set_orientation(uint8_t orientation)
@@ -88,6 +88,7 @@ extern SemaphoreHandle_t xGuiSemaphore;
 
 #if CONFIG_SOFTWARE_MIC_SUPPORT
 #include "microphone.h"
+#include "mic_features.h"
 #endif
 
 #if CONFIG_SOFTWARE_SPEAKER_SUPPORT
@@ -468,6 +469,41 @@ void Core2ForAWS_Display_Init(void);
 /* @[declare_core2foraws_display_setbrightness] */
 void Core2ForAWS_Display_SetBrightness(uint8_t brightness);
 /* @[declare_core2foraws_display_setbrightness] */
+
+/**
+ * @brief Scheduling counters of the `gui` task.
+ */
+/* @[declare_core2foraws_display_stats_t] */
+typedef struct {
+    uint32_t wakeups_per_sec;   /**< @brief Times per second the `gui` task woke up to run LVGL. */
+    uint32_t frames;            /**< @brief Refreshes that sent pixels to the display. */
+    uint32_t latency_avg_us;    /**< @brief Mean time from the first invalidation to the end of a refresh. */
+    uint32_t latency_max_us;    /**< @brief Worst time from the first invalidation to the end of a refresh since boot. */
+} Core2ForAWS_Display_Stats_t;
+/* @[declare_core2foraws_display_stats_t] */
+
+/**
+ * @brief Retrieves the scheduling counters of the `gui` task.
+ *
+ * The `gui` task sleeps until the next LVGL task is due, the screen is
+ * invalidated or the touch panel reports a touch. Use this to check how
+ * often it wakes up and how long a change takes to reach the display.
+ * Rates and averages cover the time since the previous call.
+ *
+ * **Example:**
+ *
+ * Print the wakeups per second and the mean frame latency.
+ * @code{c}
+ *  Core2ForAWS_Display_Stats_t stats;
+ *  Core2ForAWS_Display_GetStats(&stats);
+ *  printf("%u wakeups/s, %u us latency", stats.wakeups_per_sec, stats.latency_avg_us);
+ * @endcode
+ *
+ * @param[out] stats The counters since the previous call.
+ */
+/* @[declare_core2foraws_display_getstats] */
+void Core2ForAWS_Display_GetStats(Core2ForAWS_Display_Stats_t *stats);
+/* @[declare_core2foraws_display_getstats] */
 #endif
 
 /**
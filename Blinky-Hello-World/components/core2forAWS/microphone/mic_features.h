@@ -0,0 +1,167 @@
+/**
+ * @file mic_features.h
+ * @brief Streaming audio features for the microphone: RMS, peak, A-weighted
+ * level and band energies.
+ *
+ * Blocks of PCM samples are fed as they come from i2s_read(). The filters
+ * keep their state across blocks, so the features don't depend on how the
+ * stream is cut. A frame of features is produced every `hop_len` samples,
+ * covering the last `frame_len` samples.
+ *
+ * Frames are published to a latest-value slot that any task can read
+ * without blocking the producer.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+/**
+ * @brief Maximum number of frequency bands.
+ */
+/* @[declare_mic_features_max_bands] */
+#define MIC_FEATURES_MAX_BANDS 8
+/* @[declare_mic_features_max_bands] */
+
+/**
+ * @brief Maximum number of hops in a frame, i.e. frame_len / hop_len.
+ */
+/* @[declare_mic_features_max_hops] */
+#define MIC_FEATURES_MAX_HOPS 8
+/* @[declare_mic_features_max_hops] */
+
+/**
+ * @brief Level reported for digital silence, in dBFS.
+ */
+/* @[declare_mic_features_floor_db] */
+#define MIC_FEATURES_FLOOR_DB (-120.0f)
+/* @[declare_mic_features_floor_db] */
+
+/**
+ * @brief Configuration of the feature extractor.
+ */
+/* @[declare_mic_features_config_t] */
+typedef struct {
+    uint32_t sample_rate;       /**< @brief Sample rate in Hz. */
+    uint16_t frame_len;         /**< @brief Samples covered by a frame, a multiple of hop_len. */
+    uint16_t hop_len;           /**< @brief Samples between two frames. */
+    uint8_t band_count;         /**< @brief Number of bands, up to MIC_FEATURES_MAX_BANDS. */
+    /** @brief Band edges in Hz, band n spans edges n to n + 1. */
+    uint16_t band_edges_hz[MIC_FEATURES_MAX_BANDS + 1];
+} mic_features_config_t;
+/* @[declare_mic_features_config_t] */
+
+/**
+ * @brief Default configuration for the SPM1423 at 44.1 kHz.
+ *
+ * 1024 sample frames with 50% overlap, and four bands: low (63-250 Hz),
+ * voice (250-2000 Hz), presence (2-6 kHz) and high (6-16 kHz).
+ */
+/* @[declare_mic_features_config_default] */
+#define MIC_FEATURES_CONFIG_DEFAULT() { \
+    .sample_rate = 44100,                       \
+    .frame_len = 1024,                          \
+    .hop_len = 512,                             \
+    .band_count = 4,                            \
+    .band_edges_hz = { 63, 250, 2000, 6000, 16000 }, \
+}
+/* @[declare_mic_features_config_default] */
+
+/**
+ * @brief Features of one frame. Levels are in dBFS, where 0 dBFS is the RMS
+ * of a full scale square wave.
+ */
+/* @[declare_mic_features_frame_t] */
+typedef struct {
+    uint32_t seq;               /**< @brief Frame number, starting at 1. */
+    uint16_t peak;              /**< @brief Largest absolute sample value. */
+    float rms;                  /**< @brief RMS, 1.0 at full scale. */
+    float dbfs;                 /**< @brief RMS level. */
+    float dba;                  /**< @brief A-weighted RMS level. */
+    float band_db[MIC_FEATURES_MAX_BANDS];  /**< @brief Level of each band. */
+} mic_features_frame_t;
+/* @[declare_mic_features_frame_t] */
+
+/* Second order IIR section, transposed direct form II */
+typedef struct {
+    float b0, b1, b2, a1, a2;
+    float z1, z2;
+} mic_biquad_t;
+
+/* Sums over one hop */
+typedef struct {
+    uint64_t sum_sq;
+    float sum_sq_a;
+    float sum_sq_band[MIC_FEATURES_MAX_BANDS];
+    uint16_t peak;
+} mic_hop_t;
+
+/**
+ * @brief Feature extractor state. Treat as opaque.
+ */
+/* @[declare_mic_features_t] */
+typedef struct {
+    mic_features_config_t config;
+    mic_biquad_t a_weight[3];
+    mic_biquad_t band[MIC_FEATURES_MAX_BANDS];
+    mic_hop_t hops[MIC_FEATURES_MAX_HOPS];
+    uint8_t hop_count;          /* Hops per frame */
+    uint8_t hop_index;          /* Hop being accumulated */
+    uint8_t hops_filled;        /* Completed hops, up to hop_count */
+    uint16_t hop_fill;          /* Samples in the current hop */
+    uint32_t seq;
+
+    /* Latest frame, a seqlock: odd while being written */
+    atomic_uint_fast32_t latest_seq;
+    mic_features_frame_t latest;
+} mic_features_t;
+/* @[declare_mic_features_t] */
+
+/**
+ * @brief Initializes a feature extractor.
+ *
+ * Computes the filter coefficients for the configured sample rate.
+ *
+ * @param[out] ctx The extractor.
+ * @param[in] config The configuration, copied.
+ * @return false if the configuration is invalid.
+ */
+/* @[declare_mic_features_init] */
+bool mic_features_init(mic_features_t *ctx, const mic_features_config_t *config);
+/* @[declare_mic_features_init] */
+
+/**
+ * @brief Feeds PCM samples to the extractor.
+ *
+ * Blocks may have any length. A frame is published each time a hop is
+ * completed and the frame is full.
+ *
+ * @param[in] ctx The extractor.
+ * @param[in] pcm 16-bit mono samples.
+ * @param[in] count Number of samples.
+ * @param[out] frame If not NULL, set to the last frame published by this call.
+ * @return Number of frames published by this call.
+ */
+/* @[declare_mic_features_process] */
+uint32_t mic_features_process(mic_features_t *ctx, const int16_t *pcm, size_t count, mic_features_frame_t *frame);
+/* @[declare_mic_features_process] */
+
+/**
+ * @brief Reads the latest published frame.
+ *
+ * Safe to call from any task while another one is feeding samples. Never
+ * blocks the producer. A reader that keeps catching the producer mid-update
+ * gives up after a few retries instead of spinning, so a higher priority
+ * reader can't starve a producer it preempted.
+ *
+ * @param[in] ctx The extractor.
+ * @param[out] frame The latest frame.
+ * @return false if no frame has been published yet, or if the frame was
+ * being updated on every retry.
+ */
+/* @[declare_mic_features_latest] */
+bool mic_features_latest(mic_features_t *ctx, mic_features_frame_t *frame);
+/* @[declare_mic_features_latest] */
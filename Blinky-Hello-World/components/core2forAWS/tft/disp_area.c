@@ -0,0 +1,88 @@
+/**
+ * @file disp_area.c
+ *
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "disp_area.h"
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static uint32_t area_size(const lv_area_t * a);
+static void area_join(lv_area_t * res, const lv_area_t * a, const lv_area_t * b);
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+uint16_t disp_area_merge(lv_area_t * areas, uint8_t * joined, uint16_t count, uint32_t window_cost_px)
+{
+    uint16_t merged = 0;
+    bool changed = true;
+
+    /* A merge grows the target area, which may make it worth absorbing
+     * areas that were rejected earlier, so repeat until stable. */
+    while (changed) {
+        changed = false;
+        for (uint16_t in = 0; in < count; in++) {
+            if (joined[in]) {
+                continue;
+            }
+            for (uint16_t from = in + 1; from < count; from++) {
+                if (joined[from]) {
+                    continue;
+                }
+
+                lv_area_t u;
+                area_join(&u, &areas[in], &areas[from]);
+
+                if (area_size(&u) <= area_size(&areas[in]) + area_size(&areas[from]) + window_cost_px) {
+                    areas[in] = u;
+                    joined[from] = 1;
+                    merged++;
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    return merged;
+}
+
+uint32_t disp_area_window_cmd_bytes(const lv_area_t * prev, const lv_area_t * next,
+                                    bool * send_caset, bool * send_raset)
+{
+    bool caset = prev == NULL || prev->x1 != next->x1 || prev->x2 != next->x2;
+    bool raset = prev == NULL || prev->y1 != next->y1 || prev->y2 != next->y2;
+
+    if (send_caset) {
+        *send_caset = caset;
+    }
+    if (send_raset) {
+        *send_raset = raset;
+    }
+
+    return (caset ? DISP_AREA_ADDR_CMD_BYTES : 0) +
+           (raset ? DISP_AREA_ADDR_CMD_BYTES : 0) +
+           DISP_AREA_RAMWR_CMD_BYTES;
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+static uint32_t area_size(const lv_area_t * a)
+{
+    return (uint32_t)(a->x2 - a->x1 + 1) * (uint32_t)(a->y2 - a->y1 + 1);
+}
+
+static void area_join(lv_area_t * res, const lv_area_t * a, const lv_area_t * b)
+{
+    res->x1 = a->x1 < b->x1 ? a->x1 : b->x1;
+    res->y1 = a->y1 < b->y1 ? a->y1 : b->y1;
+    res->x2 = a->x2 > b->x2 ? a->x2 : b->x2;
+    res->y2 = a->y2 > b->y2 ? a->y2 : b->y2;
+}
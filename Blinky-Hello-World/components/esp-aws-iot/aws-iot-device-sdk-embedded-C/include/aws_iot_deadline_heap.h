@@ -0,0 +1,101 @@
+/*
+ * Copyright 2010-2015 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file aws_iot_deadline_heap.h
+ * @brief Min heap of timer deadlines
+ *
+ * Keeps the timers a task has to wake up for ordered by their deadline, so the time until the next of them is
+ * read from the top of the heap instead of looking at every timer. The MQTT client keeps its keep alive and
+ * reconnect timers in one and sleeps until the earliest of them when there is nothing to read.
+ *
+ * The heap stores the deadline of a timer when it is scheduled. A timer restarted with countdown_ms or
+ * countdown_sec has to be scheduled again to move to its new place. Timers are dropped from the heap once their
+ * deadline was reported by aws_iot_deadline_heap_next_wakeup_us.
+ */
+
+#ifndef AWS_IOT_SDK_SRC_IOT_DEADLINE_HEAP_H_
+#define AWS_IOT_SDK_SRC_IOT_DEADLINE_HEAP_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#include "aws_iot_error.h"
+#include "timer_interface.h"
+
+/** Timers a heap holds at most */
+#ifndef AWS_IOT_DEADLINE_HEAP_SIZE
+#define AWS_IOT_DEADLINE_HEAP_SIZE 4
+#endif
+
+/**
+ * @brief A scheduled timer and the deadline it had when scheduled
+ */
+typedef struct {
+	Timer *pTimer; ///< The timer
+	uint64_t deadline_us; ///< timer_deadline_us of the timer when it was scheduled
+} AWS_IoT_Deadline;
+
+/**
+ * @brief Timers ordered by deadline, initialize with aws_iot_deadline_heap_init
+ */
+typedef struct {
+	AWS_IoT_Deadline entries[AWS_IOT_DEADLINE_HEAP_SIZE]; ///< Binary min heap, the earliest deadline first
+	uint8_t count; ///< Entries in use
+} AWS_IoT_Deadline_Heap;
+
+/**
+ * @brief Empty a heap
+ *
+ * @param pHeap Heap to initialize
+ */
+void aws_iot_deadline_heap_init(AWS_IoT_Deadline_Heap *pHeap);
+
+/**
+ * @brief Add a timer at its current deadline, or move it there if it is in the heap already
+ *
+ * @param pHeap Heap to add to
+ * @param pTimer Timer started with countdown_ms or countdown_sec
+ * @return An IoT Error Type, LIMIT_EXCEEDED_ERROR if the heap is full
+ */
+IoT_Error_t aws_iot_deadline_heap_schedule(AWS_IoT_Deadline_Heap *pHeap, Timer *pTimer);
+
+/**
+ * @brief Remove a timer, nothing happens if it is not in the heap
+ *
+ * @param pHeap Heap to remove from
+ * @param pTimer Timer to remove
+ */
+void aws_iot_deadline_heap_cancel(AWS_IoT_Deadline_Heap *pHeap, Timer *pTimer);
+
+/**
+ * @brief Time until the earliest deadline
+ *
+ * Drops the timers that have expired, they are reported by a return value of 0 once.
+ *
+ * @param pHeap Heap to look at
+ * @param max_us Value returned when the earliest deadline is further away, or the heap is empty
+ * @return Microseconds until the earliest deadline, 0 if a timer expired
+ */
+uint64_t aws_iot_deadline_heap_next_wakeup_us(AWS_IoT_Deadline_Heap *pHeap, uint64_t max_us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AWS_IOT_SDK_SRC_IOT_DEADLINE_HEAP_H_ */
@@ -87,6 +87,11 @@ IoT_Error_t aws_iot_mqtt_internal_init_header(MQTTHeader *pHeader, MessageTypes
 IoT_Error_t aws_iot_mqtt_internal_serialize_ack(unsigned char *pTxBuf, size_t txBufLen,
 												MessageTypes msgType, uint8_t dup, uint16_t packetId,
 												uint32_t *pSerializedLen);
+IoT_Error_t aws_iot_mqtt_internal_serialize_publish_header(unsigned char *pTxBuf, size_t txBufLen,
+															 uint8_t dup, QoS qos, uint8_t retained,
+															 uint16_t packetId, const char *pTopicName,
+															 uint16_t topicNameLen, size_t payloadLen,
+															 uint32_t *pSerializedLen);
 IoT_Error_t aws_iot_mqtt_internal_deserialize_ack(unsigned char *, unsigned char *,
 												  uint16_t *, unsigned char *, size_t);
 
@@ -105,6 +110,8 @@ void aws_iot_mqtt_internal_write_utf8_string(unsigned char **pptr, const char *s
 
 IoT_Error_t aws_iot_mqtt_internal_flushBuffers( AWS_IoT_Client *pClient );
 IoT_Error_t aws_iot_mqtt_internal_send_packet(AWS_IoT_Client *pClient, size_t length, Timer *pTimer);
+IoT_Error_t aws_iot_mqtt_internal_send_packet_vector(AWS_IoT_Client *pClient, IoT_Iovec *pVec, size_t count,
+													 Timer *pTimer);
 IoT_Error_t aws_iot_mqtt_internal_cycle_read(AWS_IoT_Client *pClient, Timer *pTimer, uint8_t *pPacketType);
 IoT_Error_t aws_iot_mqtt_internal_wait_for_read(AWS_IoT_Client *pClient, uint8_t packetType, Timer *pTimer);
 IoT_Error_t aws_iot_mqtt_internal_serialize_zero(unsigned char *pTxBuf, size_t txBufLen,
@@ -115,6 +122,8 @@ IoT_Error_t aws_iot_mqtt_internal_deserialize_publish(uint8_t *dup, QoS *qos,
 													  unsigned char **payload, size_t *payloadLen,
 													  unsigned char *pRxBuf, size_t rxBufLen);
 
+void aws_iot_mqtt_internal_index_subscriptions(AWS_IoT_Client *pClient);
+
 IoT_Error_t aws_iot_mqtt_set_client_state(AWS_IoT_Client *pClient, ClientState expectedCurrentState,
 										  ClientState newState);
 
@@ -66,6 +66,7 @@ extern "C" {
  * - @functionname{mqtt_function_free}
  * - @functionname{mqtt_function_connect}
  * - @functionname{mqtt_function_publish}
+ * - @functionname{mqtt_function_publish_vector}
  * - @functionname{mqtt_function_subscribe}
  * - @functionname{mqtt_function_resubscribe}
  * - @functionname{mqtt_function_unsubscribe}
@@ -88,6 +89,7 @@ extern "C" {
  * @functionpage{aws_iot_mqtt_free,mqtt,free}
  * @functionpage{aws_iot_mqtt_connect,mqtt,connect}
  * @functionpage{aws_iot_mqtt_publish,mqtt,publish}
+ * @functionpage{aws_iot_mqtt_publish_vector,mqtt,publish_vector}
  * @functionpage{aws_iot_mqtt_subscribe,mqtt,subscribe}
  * @functionpage{aws_iot_mqtt_resubscribe,mqtt,resubscribe}
  * @functionpage{aws_iot_mqtt_unsubscribe,mqtt,unsubscribe}
@@ -154,6 +156,10 @@ IoT_Error_t aws_iot_mqtt_connect(AWS_IoT_Client *pClient, const IoT_Client_Conne
  * passed to the TLS layer. For a QoS 1 message, this function returns after the
  * receipt of the PUBACK for the transmitted message.
  *
+ * The packet is built in the client's TX buffer when it fits. Larger payloads
+ * are sent from the caller's buffer as with @ref mqtt_function_publish_vector,
+ * so `AWS_IOT_MQTT_TX_BUF_LEN` does not limit the payload size.
+ *
  * @param pClient MQTT client context
  * @param pTopicName Topic name to publish to
  * @param topicNameLen Length of the topic name
@@ -166,6 +172,33 @@ IoT_Error_t aws_iot_mqtt_publish(AWS_IoT_Client *pClient, const char *pTopicName
 								 IoT_Publish_Message_Params *pParams);
 /* @[declare_mqtt_publish] */
 
+/**
+ * @brief Publish an MQTT message whose payload is split over several buffers.
+ *
+ * Works like @ref mqtt_function_publish, but the payload is the concatenation
+ * of `payloadCount` buffers and is not copied into the client's TX buffer.
+ * Only the fixed header, topic and packet identifier are serialized there;
+ * payload buffers are handed to the network layer as they are. Buffers shorter
+ * than `AWS_IOT_MQTT_PUBLISH_COPY_THRESHOLD` are appended to the header instead
+ * so that small pieces do not each cost a TLS record.
+ *
+ * @param pClient MQTT client context
+ * @param pTopicName Topic name to publish to
+ * @param topicNameLen Length of the topic name
+ * @param pParams Publish message parameters, `payload` and `payloadLen` are ignored
+ * @param pPayload Payload buffers, in order
+ * @param payloadCount Number of payload buffers, at most `AWS_IOT_MQTT_PUBLISH_MAX_IOVECS`
+ *
+ * @return `IoT_Error_t`: See `aws_iot_error.h`
+ *
+ * @attention The payload buffers must stay unchanged until the function returns.
+ */
+/* @[declare_mqtt_publish_vector] */
+IoT_Error_t aws_iot_mqtt_publish_vector(AWS_IoT_Client *pClient, const char *pTopicName, uint16_t topicNameLen,
+										IoT_Publish_Message_Params *pParams, const IoT_Iovec *pPayload,
+										size_t payloadCount);
+/* @[declare_mqtt_publish_vector] */
+
 /**
  * @brief Subscribe to an MQTT topic.
  *
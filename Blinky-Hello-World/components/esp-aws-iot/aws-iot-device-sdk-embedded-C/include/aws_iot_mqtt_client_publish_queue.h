@@ -0,0 +1,151 @@
+/*
+ * Copyright 2010-2015 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file aws_iot_mqtt_client_publish_queue.h
+ * @brief Publish queue drained by a single network task
+ *
+ * With thread support every task that publishes takes the TLS write mutex and waits on the socket itself. A
+ * publish queue lets one network task own the client instead. Other tasks serialize their messages into the
+ * queue without taking any lock, and learn through a completion handler when the message was sent, or for
+ * QoS 1 acknowledged. The network task calls aws_iot_mqtt_publish_queue_run where it would call
+ * aws_iot_mqtt_yield, and is the only task that calls into the client.
+ *
+ * Every lane is a bounded ring written by any number of producers and read by the network task alone. The
+ * high priority lane is always emptied before the next normal message goes out. A full lane refuses the
+ * message with MQTT_PUBLISH_QUEUE_FULL_ERROR, so producers see back-pressure instead of blocking.
+ */
+
+#ifndef AWS_IOT_SDK_SRC_IOT_MQTT_CLIENT_PUBLISH_QUEUE_H
+#define AWS_IOT_SDK_SRC_IOT_MQTT_CLIENT_PUBLISH_QUEUE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "aws_iot_mqtt_client.h"
+
+/** Messages each lane holds, a power of two */
+#ifndef AWS_IOT_MQTT_PUBLISH_QUEUE_LENGTH
+#define AWS_IOT_MQTT_PUBLISH_QUEUE_LENGTH 8
+#endif
+
+/** Largest serialized publish packet, header and topic included, a queued message can have */
+#ifndef AWS_IOT_MQTT_PUBLISH_QUEUE_PACKET_LEN
+#define AWS_IOT_MQTT_PUBLISH_QUEUE_PACKET_LEN 256
+#endif
+
+/** Longest the network task yields before it looks at the queue again */
+#ifndef AWS_IOT_MQTT_PUBLISH_QUEUE_YIELD_MS
+#define AWS_IOT_MQTT_PUBLISH_QUEUE_YIELD_MS 10
+#endif
+
+/**
+ * @brief Lanes of a publish queue, in the order they are drained
+ */
+typedef enum {
+	PUBLISH_QUEUE_LANE_HIGH = 0,
+	PUBLISH_QUEUE_LANE_NORMAL = 1,
+	PUBLISH_QUEUE_LANE_COUNT = 2
+} IoT_Publish_Queue_Lane;
+
+/**
+ * @brief Called by the network task once a queued message was sent
+ *
+ * rc is SUCCESS when a QoS 0 message was written to the network or a QoS 1 message was acknowledged, the
+ * error of the publish otherwise.
+ */
+typedef void (*pPublishCompletionHandler)(AWS_IoT_Client *pClient, IoT_Error_t rc, void *pData);
+
+/**
+ * @brief A queued message
+ */
+typedef struct {
+	uint32_t sequence; ///< Ring position the cell is free for, that position + 1 once the message is written
+	uint32_t packetLen; ///< Bytes of the serialized packet
+	uint32_t packetIdOffset; ///< Offset of the packet id filled in when the message is sent, 0 for QoS 0
+	pPublishCompletionHandler completionHandler; ///< Called once the message was sent, can be NULL
+	void *pCompletionHandlerData; ///< Passed to completionHandler
+	unsigned char packet[AWS_IOT_MQTT_PUBLISH_QUEUE_PACKET_LEN]; ///< Serialized publish packet
+} IoT_Publish_Queue_Cell;
+
+/**
+ * @brief One priority lane of a publish queue
+ */
+typedef struct {
+	uint32_t enqueuePosition; ///< Next position a producer claims
+	uint32_t dequeuePosition; ///< Next position the network task sends, only used by it
+	IoT_Publish_Queue_Cell cells[AWS_IOT_MQTT_PUBLISH_QUEUE_LENGTH]; ///< Ring of messages
+} IoT_Publish_Queue_Ring;
+
+/**
+ * @brief Publish queue, initialize with aws_iot_mqtt_publish_queue_init
+ */
+typedef struct {
+	IoT_Publish_Queue_Ring lanes[PUBLISH_QUEUE_LANE_COUNT]; ///< Rings in the order they are drained
+	uint32_t refusedCount; ///< Messages refused because their lane was full
+} AWS_IoT_Publish_Queue;
+
+/**
+ * @brief Initialize an empty publish queue
+ *
+ * @param pQueue Queue to initialize
+ * @return An IoT Error Type, NULL_VALUE_ERROR for a NULL pointer
+ */
+IoT_Error_t aws_iot_mqtt_publish_queue_init(AWS_IoT_Publish_Queue *pQueue);
+
+/**
+ * @brief Queue a message to be published by the network task
+ *
+ * Safe to call from any number of tasks at the same time, and never blocks. The topic and payload are
+ * serialized into the queue before the call returns, so the caller can reuse them right away.
+ *
+ * @param pQueue Queue of the client
+ * @param lane Lane of the message
+ * @param pTopicName Topic Name to publish to
+ * @param topicNameLen Length of the topic name
+ * @param pParams Message, only QoS 0 and QoS 1 are supported
+ * @param completionHandler Called by the network task once the message was sent, can be NULL
+ * @param pCompletionHandlerData Passed to completionHandler
+ * @return An IoT Error Type, MQTT_PUBLISH_QUEUE_FULL_ERROR if the lane is full or MQTT_TX_BUFFER_TOO_SHORT_ERROR
+ * if the packet is longer than AWS_IOT_MQTT_PUBLISH_QUEUE_PACKET_LEN
+ */
+IoT_Error_t aws_iot_mqtt_publish_queue_add(AWS_IoT_Publish_Queue *pQueue, IoT_Publish_Queue_Lane lane,
+										   const char *pTopicName, uint16_t topicNameLen,
+										   const IoT_Publish_Message_Params *pParams,
+										   pPublishCompletionHandler completionHandler,
+										   void *pCompletionHandlerData);
+
+/**
+ * @brief Send queued messages and yield to the client
+ *
+ * Called by the network task in place of aws_iot_mqtt_yield. Queued messages are sent, high priority lane
+ * first, while the client is connected. In between the client yields for at most
+ * AWS_IOT_MQTT_PUBLISH_QUEUE_YIELD_MS at a time to handle incoming messages and the keep alive. Messages
+ * stay queued while the client reconnects.
+ *
+ * @param pClient Client the network task owns
+ * @param pQueue Queue of the client
+ * @param timeout_ms Time to spend before returning
+ * @return An IoT Error Type, the error of the yield if it failed
+ */
+IoT_Error_t aws_iot_mqtt_publish_queue_run(AWS_IoT_Client *pClient, AWS_IoT_Publish_Queue *pQueue,
+										   uint32_t timeout_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AWS_IOT_SDK_SRC_IOT_MQTT_CLIENT_PUBLISH_QUEUE_H */
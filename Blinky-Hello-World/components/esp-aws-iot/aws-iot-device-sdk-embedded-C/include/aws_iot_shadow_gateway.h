@@ -0,0 +1,243 @@
+/*
+ * Copyright 2010-2015 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#ifndef AWS_IOT_SDK_SRC_IOT_SHADOW_GATEWAY_H_
+#define AWS_IOT_SDK_SRC_IOT_SHADOW_GATEWAY_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file aws_iot_shadow_gateway.h
+ * @brief Shadows of many things over one MQTT connection
+ *
+ * The shadow client of aws_iot_shadow_interface.h keeps its state in global tables sized for the one thing the
+ * device is, and subscribes to two topics for every thing and action it waits for acks on. A gateway acts for
+ * many things, the sensors attached to it, so all of its state lives in a context object instead. Every table of
+ * the context is carved out of one arena given at init and none of them grows afterwards.
+ *
+ * The gateway subscribes to three wildcard topics however many things it handles. The thing a message is for is
+ * read from the topic and looked up by hash, an ack is found from the sequence number in its client token
+ * without a search. Both cost the same for ten things and for hundreds.
+ *
+ * All callbacks run in the task that calls aws_iot_shadow_gateway_yield. Received documents are parsed with the
+ * JSON tokens of the shadow client, so the gateway and the single thing shadow client have to be driven by the
+ * same task. A client can carry one gateway, as both would subscribe to the same topics.
+ */
+
+#include "aws_iot_shadow_interface.h"
+#include "aws_iot_config.h"
+#include "timer_interface.h"
+
+/**
+ * @brief A thing the gateway handles
+ */
+typedef struct {
+	jsonStruct_t *pDeltaFields; ///< Keys dispatched from the delta of the thing, can be NULL
+	uint32_t nameHash; ///< Hash of the Thing Name
+	uint32_t version; ///< Last shadow version received for the thing
+	uint16_t nameOffset; ///< Start of the null terminated Thing Name in the name pool
+	uint8_t nameLen; ///< Length of the Thing Name
+	uint8_t deltaFieldCount; ///< Entries in pDeltaFields
+} ShadowGatewayThing_t;
+
+/**
+ * @brief An action waiting for its ack, kept in the slot its sequence number selects
+ */
+typedef struct {
+	fpActionCallback_t callback; ///< Called with the ack
+	void *pCallbackContext; ///< Context passed to callback
+	Timer timer; ///< Counts down to the timeout of the action
+	uint32_t sequence; ///< Sequence number of the client token of the action
+	uint16_t thingIndex; ///< Thing the action was sent for
+	uint8_t action; ///< ShadowActions_t of the action
+	bool isInUse; ///< Set while the action waits for its ack
+} ShadowGatewayAck_t;
+
+/**
+ * @brief Arena bytes a gateway needs at most
+ *
+ * @param maxThings Things the gateway handles
+ * @param maxAcks Actions waiting for an ack at the same time
+ * @param rxBufferSize Largest received document plus its null terminator
+ * @param nameBytes Sum of the Thing Name lengths plus one per thing
+ */
+#define AWS_IOT_SHADOW_GATEWAY_ARENA_SIZE(maxThings, maxAcks, rxBufferSize, nameBytes) \
+	((maxThings) * sizeof(ShadowGatewayThing_t) + (maxAcks) * sizeof(ShadowGatewayAck_t) \
+	 + 4 * (maxThings) * sizeof(uint16_t) + (rxBufferSize) + (nameBytes) + 4 * sizeof(uint64_t))
+
+/**
+ * @brief Parameters of aws_iot_shadow_gateway_init
+ */
+typedef struct {
+	void *pArena; ///< Memory all tables of the gateway are carved out of
+	size_t arenaSize; ///< Size of pArena in bytes, see AWS_IOT_SHADOW_GATEWAY_ARENA_SIZE
+	uint16_t maxThings; ///< Things the gateway handles
+	uint8_t maxAcks; ///< Actions waiting for an ack at the same time
+	uint16_t rxBufferSize; ///< Largest received document plus its null terminator
+	const char *pClientTokenPrefix; ///< Client tokens are this prefix, a '-' and a sequence number, usually the client id
+	bool isDiscardOldDeltaEnabled; ///< Drop deltas with a version not above the last one seen for the thing
+} ShadowGatewayParams_t;
+
+/**
+ * @brief State of a gateway, initialize with aws_iot_shadow_gateway_init
+ */
+typedef struct {
+	AWS_IoT_Client *pClient; ///< Client the shadows are reached through
+	const char *pClientTokenPrefix; ///< Prefix of the client tokens
+	uint16_t clientTokenPrefixLen; ///< Length of pClientTokenPrefix
+	bool isDiscardOldDeltaEnabled; ///< Drop deltas with a version not above the last one seen
+	ShadowGatewayThing_t *pThings; ///< Things in the order they were added
+	uint16_t thingCount; ///< Entries of pThings in use
+	uint16_t maxThings; ///< Size of pThings
+	uint16_t *pThingBuckets; ///< Open addressing table from name hash to thing index + 1, 0 marks an empty bucket
+	uint32_t thingBucketMask; ///< Number of buckets minus one, the number is a power of two
+	ShadowGatewayAck_t *pAcks; ///< Ack slots, indexed by sequence number modulo maxAcks
+	uint8_t maxAcks; ///< Size of pAcks
+	uint8_t ackCount; ///< Slots in use
+	uint32_t nextSequence; ///< Sequence number of the next client token
+	char *pRxBuffer; ///< Received documents are copied here to be parsed
+	uint16_t rxBufferSize; ///< Size of pRxBuffer
+	char *pNames; ///< Name pool the Thing Names are copied into
+	uint16_t namesSize; ///< Size of pNames
+	uint16_t namesUsed; ///< Bytes of pNames in use
+} ShadowGateway_t;
+
+/**
+ * @brief Initialize a gateway
+ *
+ * Nothing is sent, call aws_iot_shadow_gateway_subscribe once the client is connected.
+ *
+ * @param pGateway Gateway to initialize
+ * @param pClient MQTT Client used as the protocol layer
+ * @param pParams Arena and table sizes
+ * @return An IoT Error Type, NULL_VALUE_ERROR for a NULL pointer or LIMIT_EXCEEDED_ERROR if the tables do not
+ * fit in the arena
+ */
+IoT_Error_t aws_iot_shadow_gateway_init(ShadowGateway_t *pGateway, AWS_IoT_Client *pClient,
+										const ShadowGatewayParams_t *pParams);
+
+/**
+ * @brief Subscribe to the delta and ack topics of every thing
+ *
+ * The three subscriptions use wildcards for the Thing Name and the action, the policy of the client has to
+ * allow them. They are made once, things added later are covered by them.
+ *
+ * @param pGateway Gateway of the things
+ * @return An IoT Error Type, the error of the first subscribe that failed
+ */
+IoT_Error_t aws_iot_shadow_gateway_subscribe(ShadowGateway_t *pGateway);
+
+/**
+ * @brief Add a thing to the gateway
+ *
+ * The Thing Name is copied into the arena. The delta fields are not, they have to stay valid as long as the
+ * gateway is used. Their callbacks run for the keys of a delta like those registered with
+ * aws_iot_shadow_register_delta.
+ *
+ * @param pGateway Gateway of the things
+ * @param pThingName Thing Name of the shadow
+ * @param pDeltaFields Keys dispatched from the delta of the thing, can be NULL
+ * @param deltaFieldCount Entries in pDeltaFields
+ * @param pThingIndex Set to the index later calls identify the thing by
+ * @return An IoT Error Type, LIMIT_EXCEEDED_ERROR if maxThings things were added or the names fill the arena,
+ * MAX_SIZE_ERROR if the Thing Name is too long or FAILURE if it was added already
+ */
+IoT_Error_t aws_iot_shadow_gateway_add_thing(ShadowGateway_t *pGateway, const char *pThingName,
+											 jsonStruct_t *pDeltaFields, uint8_t deltaFieldCount,
+											 uint16_t *pThingIndex);
+
+/**
+ * @brief Look up a thing by name
+ *
+ * @param pGateway Gateway of the things
+ * @param pThingName Thing Name to look for
+ * @param pThingIndex Set to the index of the thing
+ * @return An IoT Error Type, FAILURE if the gateway does not handle the thing
+ */
+IoT_Error_t aws_iot_shadow_gateway_find_thing(const ShadowGateway_t *pGateway, const char *pThingName,
+											  uint16_t *pThingIndex);
+
+/**
+ * @brief Thing Name of a thing, NULL for an unknown index
+ */
+const char *aws_iot_shadow_gateway_get_thing_name(const ShadowGateway_t *pGateway, uint16_t thingIndex);
+
+/**
+ * @brief Last shadow version received for a thing, 0 for an unknown index
+ */
+uint32_t aws_iot_shadow_gateway_get_version(const ShadowGateway_t *pGateway, uint16_t thingIndex);
+
+/**
+ * @brief Send a document to the update topic of a thing
+ *
+ * The document is a JSON object without a client token, written with aws_iot_shadow_json_writer_begin_object
+ * and closed with aws_iot_shadow_json_writer_end_object rather than finalized. When a callback is given the
+ * gateway adds its own client token in the publish, the document itself is not changed.
+ *
+ * @param pGateway Gateway of the things
+ * @param thingIndex Thing to update
+ * @param pJsonDocument Document to send
+ * @param callback Called with the ack or on timeout, can be NULL
+ * @param pContextData Context passed to callback
+ * @param timeout_seconds Time to wait for the ack
+ * @return An IoT Error Type, LIMIT_EXCEEDED_ERROR if maxAcks actions wait for an ack or the error of the publish
+ */
+IoT_Error_t aws_iot_shadow_gateway_update(ShadowGateway_t *pGateway, uint16_t thingIndex, const char *pJsonDocument,
+										  fpActionCallback_t callback, void *pContextData, uint8_t timeout_seconds);
+
+/**
+ * @brief Request the shadow document of a thing
+ *
+ * @param pGateway Gateway of the things
+ * @param thingIndex Thing to get the shadow of
+ * @param callback Called with the document or on timeout
+ * @param pContextData Context passed to callback
+ * @param timeout_seconds Time to wait for the document
+ * @return An IoT Error Type, LIMIT_EXCEEDED_ERROR if maxAcks actions wait for an ack or the error of the publish
+ */
+IoT_Error_t aws_iot_shadow_gateway_get(ShadowGateway_t *pGateway, uint16_t thingIndex, fpActionCallback_t callback,
+									   void *pContextData, uint8_t timeout_seconds);
+
+/**
+ * @brief Delete the shadow of a thing
+ *
+ * @param pGateway Gateway of the things
+ * @param thingIndex Thing to delete the shadow of
+ * @param callback Called with the ack or on timeout, can be NULL
+ * @param pContextData Context passed to callback
+ * @param timeout_seconds Time to wait for the ack
+ * @return An IoT Error Type, LIMIT_EXCEEDED_ERROR if maxAcks actions wait for an ack or the error of the publish
+ */
+IoT_Error_t aws_iot_shadow_gateway_delete(ShadowGateway_t *pGateway, uint16_t thingIndex, fpActionCallback_t callback,
+										  void *pContextData, uint8_t timeout_seconds);
+
+/**
+ * @brief Report timed out actions and yield to the client
+ *
+ * Called where aws_iot_shadow_yield would be called.
+ *
+ * @param pGateway Gateway of the things
+ * @param timeout_ms Time to yield to the client
+ * @return An IoT Error Type, the error of the yield
+ */
+IoT_Error_t aws_iot_shadow_gateway_yield(ShadowGateway_t *pGateway, uint32_t timeout_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AWS_IOT_SDK_SRC_IOT_SHADOW_GATEWAY_H_ */
@@ -26,11 +26,21 @@ extern "C" {
 #include "aws_iot_error.h"
 #include "aws_iot_shadow_json_data.h"
 
+/* Called for each key found while walking a parsed document, valueIndex identifies the key's value */
+typedef void (*jsonKeyVisitor_t)(const char *pJsonDocument, const char *pKey, uint32_t keyLen, int32_t valueIndex,
+								 void *pContext);
+
 bool isJsonValidAndParse(const char *pJsonDocument, size_t jsonSize, void *pJsonHandler, int32_t *pTokenCount);
 
 bool isJsonKeyMatchingAndUpdateValue(const char *pJsonDocument, void *pJsonHandler, int32_t tokenCount,
 									 jsonStruct_t *pDataStruct, uint32_t *pDataLength, int32_t *pDataPosition);
 
+void visitJsonStateKeys(const char *pJsonDocument, void *pJsonHandler, int32_t tokenCount,
+						jsonKeyVisitor_t visitor, void *pContext);
+
+void updateValueOfJsonToken(const char *pJsonDocument, void *pJsonHandler, int32_t valueIndex,
+							jsonStruct_t *pDataStruct, uint32_t *pDataLength, int32_t *pDataPosition);
+
 IoT_Error_t aws_iot_shadow_internal_get_request_json(char *pBuffer, size_t bufferSize);
 
 IoT_Error_t aws_iot_shadow_internal_delete_request_json(char *pBuffer, size_t bufferSize);
@@ -0,0 +1,240 @@
+/*
+ * Copyright 2010-2015 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file aws_iot_spool.h
+ * @brief Store and forward spool for telemetry recorded while offline
+ *
+ * Records are appended to a log on persistent storage while the client cannot publish, and replayed in batches
+ * once it is connected again. Every record gets a sequence number that keeps growing across reboots. A batch is
+ * published with QoS 1, and after its PUBACK a commit record with the sequence number of its last record is
+ * appended. Replay skips every record at or below the last commit, so a record is sent again only if power was
+ * lost between the PUBACK and the commit, and the receiver drops it by its sequence number.
+ *
+ * Record layout, integers little endian:
+ *
+ *     offset 0   uint8   AWS_IOT_SPOOL_RECORD_MAGIC
+ *     offset 1   uint8   type, data or commit
+ *     offset 2   uint16  payload length
+ *     offset 4   uint32  sequence number
+ *     offset 8   payload
+ *     then       uint32  CRC-32 of the type, length, sequence number and payload
+ *
+ * Opening the spool walks the log and cuts it after the last record with a valid CRC, which drops a record torn
+ * by a power loss. The log is rewritten, keeping only a commit record and the records not yet committed, once
+ * everything was replayed or the committed records take more than half of the space.
+ *
+ * Batch payload, integers little endian:
+ *
+ *     uint8   AWS_IOT_SPOOL_BATCH_VERSION
+ *     uint16  number of records
+ *     then for every record: uint32 sequence number, uint16 payload length, payload
+ */
+
+#ifndef AWS_IOT_SDK_SRC_IOT_SPOOL_H_
+#define AWS_IOT_SDK_SRC_IOT_SPOOL_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "aws_iot_mqtt_client_interface.h"
+#include "timer_interface.h"
+
+/** Longest payload of a single record */
+#ifndef AWS_IOT_SPOOL_MAX_RECORD_LEN
+#define AWS_IOT_SPOOL_MAX_RECORD_LEN 256
+#endif
+
+/** Longest path of a spool file, the temporary file used while rewriting included */
+#ifndef AWS_IOT_SPOOL_MAX_PATH_LEN
+#define AWS_IOT_SPOOL_MAX_PATH_LEN 64
+#endif
+
+#define AWS_IOT_SPOOL_RECORD_MAGIC 0xA5
+#define AWS_IOT_SPOOL_BATCH_VERSION 1
+#define AWS_IOT_SPOOL_RECORD_HEADER_LEN 8
+#define AWS_IOT_SPOOL_RECORD_OVERHEAD (AWS_IOT_SPOOL_RECORD_HEADER_LEN + 4)
+
+/**
+ * @brief Persistent storage the log is kept on
+ *
+ * Offsets count from the start of the log. A storage that cannot rewrite atomically has to make sure that after a
+ * power loss either the old or the new content is found.
+ */
+typedef struct {
+	/** Read up to len bytes at offset, pRead is set to the number read, less than len at the end of the log */
+	IoT_Error_t (*read)(void *pContext, uint32_t offset, uint8_t *pBuf, size_t len, size_t *pRead);
+	/** Append len bytes at the end of the log */
+	IoT_Error_t (*append)(void *pContext, const uint8_t *pBuf, size_t len);
+	/** Make everything appended so far survive a power loss */
+	IoT_Error_t (*sync)(void *pContext);
+	/** Replace the log with pHead followed by the srcLen bytes at srcOffset of the current log */
+	IoT_Error_t (*rewrite)(void *pContext, const uint8_t *pHead, size_t headLen, uint32_t srcOffset,
+						   uint32_t srcLen);
+	void *pContext; ///< Passed to every function
+} AWS_IoT_Spool_Storage;
+
+/**
+ * @brief Storage on a stdio file, for a card or flash file system mounted on the VFS, or a file on a host
+ */
+typedef struct {
+	FILE *pFile; ///< The log, opened for reading and appending
+	char path[AWS_IOT_SPOOL_MAX_PATH_LEN]; ///< Path of the log
+	char tmpPath[AWS_IOT_SPOOL_MAX_PATH_LEN]; ///< Path the rewritten log is built at
+} AWS_IoT_Spool_File;
+
+/**
+ * @brief Counters of a spool, read with aws_iot_spool_get_metrics
+ */
+typedef struct {
+	uint32_t appended; ///< Records appended since the spool was opened
+	uint32_t refused; ///< Records refused because the spool was full
+	uint32_t replayed; ///< Records published and committed
+	uint32_t batches; ///< Batches published and committed
+	uint32_t rateLimited; ///< Replay calls that waited for the batch interval
+	uint32_t rewrites; ///< Times the log was rewritten to drop committed records
+	uint32_t discardedBytes; ///< Bytes cut from the end of the log when it was opened
+} AWS_IoT_Spool_Metrics;
+
+/**
+ * @brief State of a spool, initialize with aws_iot_spool_init
+ */
+typedef struct {
+	AWS_IoT_Spool_Storage storage; ///< Where the log is kept
+	uint32_t maxBytes; ///< Size the log is not allowed to grow beyond
+	uint32_t size; ///< Bytes in the log
+	uint32_t nextSeq; ///< Sequence number of the next appended record
+	uint32_t committedSeq; ///< Sequence number of the last record replayed and committed, 0 for none
+	uint32_t replayOffset; ///< Offset replay continues reading at
+	uint32_t pendingCount; ///< Records not yet committed
+	uint32_t batchInterval_ms; ///< Time between two published batches
+	uint32_t syncInterval; ///< Records appended between two syncs of the storage
+	uint32_t unsyncedCount; ///< Records appended since the storage was last synced
+	Timer batchTimer; ///< Counts down the time until the next batch can be published
+	AWS_IoT_Spool_Metrics metrics; ///< Counters of the spool
+} AWS_IoT_Spool;
+
+/**
+ * @brief Open a log kept in a stdio file
+ *
+ * Finishes or drops a rewrite a power loss interrupted, and creates the file when it does not exist yet.
+ *
+ * @param pStorage Filled with the functions of the file storage
+ * @param pFile File state, has to live as long as the spool
+ * @param pPath Path of the log, the rewritten log is built at the same path with ".tmp" appended
+ * @return An IoT Error Type, SPOOL_STORAGE_ERROR if the file cannot be opened
+ */
+IoT_Error_t aws_iot_spool_file_open(AWS_IoT_Spool_Storage *pStorage, AWS_IoT_Spool_File *pFile, const char *pPath);
+
+/**
+ * @brief Close a log opened with aws_iot_spool_file_open
+ *
+ * @param pFile File state
+ * @return An IoT Error Type
+ */
+IoT_Error_t aws_iot_spool_file_close(AWS_IoT_Spool_File *pFile);
+
+/**
+ * @brief Open a spool on a storage and recover its state from the log
+ *
+ * @param pSpool Spool to initialize
+ * @param pStorage Storage of the log, copied
+ * @param maxBytes Size the log is not allowed to grow beyond
+ * @param batchInterval_ms Shortest time between two published batches
+ * @return An IoT Error Type, the error of the storage if the log cannot be read or repaired
+ */
+IoT_Error_t aws_iot_spool_init(AWS_IoT_Spool *pSpool, const AWS_IoT_Spool_Storage *pStorage, uint32_t maxBytes,
+							   uint32_t batchInterval_ms);
+
+/**
+ * @brief Append a record, and sync the storage once the sync interval of records was appended
+ *
+ * @param pSpool Spool to append to
+ * @param pPayload Payload of the record
+ * @param payloadLen Length of the payload, at most AWS_IOT_SPOOL_MAX_RECORD_LEN
+ * @param pSeq Set to the sequence number of the record, can be NULL
+ * @return An IoT Error Type, SPOOL_FULL_ERROR if the record does not fit in maxBytes
+ */
+IoT_Error_t aws_iot_spool_append(AWS_IoT_Spool *pSpool, const void *pPayload, uint16_t payloadLen,
+								 uint32_t *pSeq);
+
+/**
+ * @brief Sync the storage only every few appended records
+ *
+ * Every append is synced by default, which on a card or flash file system writes the file system metadata again
+ * for each record. With a larger interval a power loss takes at most the last interval - 1 records, which
+ * aws_iot_spool_sync saves earlier, for instance once the client is connected again.
+ *
+ * @param pSpool Spool to configure
+ * @param syncInterval Records appended between two syncs, 0 and 1 sync every record
+ * @return An IoT Error Type, NULL_VALUE_ERROR for a NULL pointer
+ */
+IoT_Error_t aws_iot_spool_set_sync_interval(AWS_IoT_Spool *pSpool, uint32_t syncInterval);
+
+/**
+ * @brief Sync the records appended since the last sync to the storage
+ *
+ * @param pSpool Spool to sync
+ * @return An IoT Error Type, SUCCESS without touching the storage when there is nothing to sync
+ */
+IoT_Error_t aws_iot_spool_sync(AWS_IoT_Spool *pSpool);
+
+/**
+ * @brief Number of records that still have to be replayed
+ *
+ * @param pSpool Spool to look at
+ * @return Records appended and not yet committed
+ */
+uint32_t aws_iot_spool_pending(const AWS_IoT_Spool *pSpool);
+
+/**
+ * @brief Publish the next batch of records if the batch interval has passed
+ *
+ * Fills pBatchBuffer with as many records as fit, publishes them as one QoS 1 message and commits them after the
+ * PUBACK. Nothing is committed when the publish fails, the same records go out with the next call. Call it from
+ * the task that yields the client, at most one batch is sent per call.
+ *
+ * @param pSpool Spool to replay
+ * @param pClient Connected MQTT client
+ * @param pTopicName Topic the batches are published to
+ * @param topicNameLen Length of the topic
+ * @param pBatchBuffer Buffer the batch is built in, the MQTT TX buffer also has to hold it with the topic
+ * @param batchBufferSize Size of pBatchBuffer in bytes
+ * @param pReplayed Set to the number of records committed by this call, can be NULL
+ * @return An IoT Error Type, SUCCESS also when there was nothing to send or the interval did not pass yet
+ */
+IoT_Error_t aws_iot_spool_replay(AWS_IoT_Spool *pSpool, AWS_IoT_Client *pClient, const char *pTopicName,
+								 uint16_t topicNameLen, uint8_t *pBatchBuffer, size_t batchBufferSize,
+								 uint32_t *pReplayed);
+
+/**
+ * @brief Copy the counters of a spool
+ *
+ * @param pSpool Spool to look at
+ * @param pMetrics Filled with the counters
+ * @return An IoT Error Type, NULL_VALUE_ERROR for a NULL pointer
+ */
+IoT_Error_t aws_iot_spool_get_metrics(const AWS_IoT_Spool *pSpool, AWS_IoT_Spool_Metrics *pMetrics);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AWS_IOT_SDK_SRC_IOT_SPOOL_H_ */
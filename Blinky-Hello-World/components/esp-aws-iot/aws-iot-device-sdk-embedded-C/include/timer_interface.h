@@ -89,6 +89,28 @@ void countdown_sec(Timer *, uint32_t);
  */
 uint32_t left_ms(Timer *);
 
+/**
+ * @brief Check the time remaining on a given timer in microseconds
+ *
+ * Same as left_ms with the resolution of the platform clock, for callers that
+ * have to wait until a deadline without rounding it down to a millisecond.
+ *
+ * @param Timer - pointer to the timer to be checked
+ * @return uint64_t - microseconds left on the countdown timer, 0 once expired
+ */
+uint64_t left_us(Timer *);
+
+/**
+ * @brief Get the time a timer expires at
+ *
+ * The deadline is counted in microseconds on a monotonic clock with an
+ * arbitrary origin, so it only compares to the deadlines of other timers.
+ *
+ * @param Timer - pointer to the timer
+ * @return uint64_t - the deadline of the timer in microseconds
+ */
+uint64_t timer_deadline_us(Timer *);
+
 /**
  * @brief Initialize a timer
  *
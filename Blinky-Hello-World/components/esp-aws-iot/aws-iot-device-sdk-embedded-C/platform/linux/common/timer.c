@@ -16,6 +16,9 @@
 /**
  * @file timer.c
  * @brief Linux implementation of the timer interface.
+ *
+ * Deadlines are kept in microseconds of CLOCK_MONOTONIC, which is not moved
+ * by changes of the wall clock.
  */
 
 #ifdef __cplusplus
@@ -27,47 +30,43 @@ extern "C" {
 #include <stdint.h>
 #include <stdbool.h>
 #include <unistd.h>
+#include <time.h>
 
 #include "timer_platform.h"
 
+static uint64_t monotonic_us(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t) now.tv_sec * 1000000 + (uint64_t) now.tv_nsec / 1000;
+}
+
 bool has_timer_expired(Timer *timer) {
-	struct timeval now, res;
-	gettimeofday(&now, NULL);
-	timersub(&timer->end_time, &now, &res);
-	return res.tv_sec < 0 || (res.tv_sec == 0 && res.tv_usec <= 0);
+	return monotonic_us() >= timer->end_us;
 }
 
 void countdown_ms(Timer *timer, uint32_t timeout) {
-	struct timeval now;
-#ifdef __cplusplus
-	struct timeval interval = {timeout / 1000, static_cast<int>((timeout % 1000) * 1000)};
-#else
-	struct timeval interval = {timeout / 1000, (int)((timeout % 1000) * 1000)};
-#endif
-	gettimeofday(&now, NULL);
-	timeradd(&now, &interval, &timer->end_time);
+	timer->end_us = monotonic_us() + (uint64_t) timeout * 1000;
+}
+
+uint64_t left_us(Timer *timer) {
+	uint64_t now = monotonic_us();
+	return (timer->end_us > now) ? timer->end_us - now : 0;
 }
 
 uint32_t left_ms(Timer *timer) {
-	struct timeval now, res;
-	uint32_t result_ms = 0;
-	gettimeofday(&now, NULL);
-	timersub(&timer->end_time, &now, &res);
-	if(res.tv_sec >= 0) {
-		result_ms = (uint32_t) (res.tv_sec * 1000 + res.tv_usec / 1000);
-	}
-	return result_ms;
+	return (uint32_t) (left_us(timer) / 1000);
+}
+
+uint64_t timer_deadline_us(Timer *timer) {
+	return timer->end_us;
 }
 
 void countdown_sec(Timer *timer, uint32_t timeout) {
-	struct timeval now;
-	struct timeval interval = {timeout, 0};
-	gettimeofday(&now, NULL);
-	timeradd(&now, &interval, &timer->end_time);
+	timer->end_us = monotonic_us() + (uint64_t) timeout * 1000000;
 }
 
 void init_timer(Timer *timer) {
-	timer->end_time = (struct timeval) {0, 0};
+	timer->end_us = 0;
 }
 
 void delay(unsigned milliseconds)
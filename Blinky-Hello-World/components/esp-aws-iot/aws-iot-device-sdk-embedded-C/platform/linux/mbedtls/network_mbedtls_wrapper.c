@@ -19,6 +19,9 @@ extern "C" {
 
 #include <stdbool.h>
 #include <string.h>
+#include <errno.h>
+#include <sys/select.h>
+#include <sys/time.h>
 #include "aws_iot_config.h"
 
 #include <timer_platform.h>
@@ -78,6 +81,14 @@ static int _iot_tls_verify_cert(void *data, mbedtls_x509_crt *crt, int depth, ui
 	return 0;
 }
 
+static uint32_t _iot_tls_elapsed_ms(const struct timeval *pStart) {
+	struct timeval now, elapsed;
+
+	gettimeofday(&now, NULL);
+	timersub(&now, pStart, &elapsed);
+	return (uint32_t) (elapsed.tv_sec * 1000 + elapsed.tv_usec / 1000);
+}
+
 void _iot_tls_set_connect_params(Network *pNetwork, char *pRootCALocation, char *pDeviceCertLocation,
 								 char *pDevicePrivateKeyLocation, char *pDestinationURL,
 								 uint16_t destinationPort, uint32_t timeout_ms, bool ServerVerificationFlag) {
@@ -99,11 +110,14 @@ IoT_Error_t iot_tls_init(Network *pNetwork, char *pRootCALocation, char *pDevice
 	pNetwork->connect = iot_tls_connect;
 	pNetwork->read = iot_tls_read;
 	pNetwork->write = iot_tls_write;
+	pNetwork->writev = iot_tls_writev;
+	pNetwork->waitForRead = iot_tls_wait_for_read;
 	pNetwork->disconnect = iot_tls_disconnect;
 	pNetwork->isConnected = iot_tls_is_connected;
 	pNetwork->destroy = iot_tls_destroy;
 
 	pNetwork->tlsDataParams.flags = 0;
+	memset(&(pNetwork->connectTiming), 0, sizeof(TLSConnectTiming));
 
 	return SUCCESS;
 }
@@ -120,6 +134,8 @@ IoT_Error_t iot_tls_connect(Network *pNetwork, TLSConnectParams *params) {
 	char portBuffer[6];
 	char vrfy_buf[512];
 	const char *alpnProtocols[] = { "x-amzn-mqtt-ca", NULL };
+	TLSConnectTiming *pTiming = NULL;
+	struct timeval start;
 
 #ifdef ENABLE_IOT_DEBUG
 	unsigned char buf[MBEDTLS_DEBUG_BUFFER_SIZE];
@@ -136,6 +152,8 @@ IoT_Error_t iot_tls_connect(Network *pNetwork, TLSConnectParams *params) {
 	}
 
 	tlsDataParams = &(pNetwork->tlsDataParams);
+	pTiming = &(pNetwork->connectTiming);
+	memset(pTiming, 0, sizeof(TLSConnectTiming));
 
 	mbedtls_net_init(&(tlsDataParams->server_fd));
 	mbedtls_ssl_init(&(tlsDataParams->ssl));
@@ -154,6 +172,7 @@ IoT_Error_t iot_tls_connect(Network *pNetwork, TLSConnectParams *params) {
 	}
 
 	IOT_DEBUG("  . Loading the CA root certificate ...");
+	gettimeofday(&start, NULL);
 	ret = mbedtls_x509_crt_parse_file(&(tlsDataParams->cacert), pNetwork->tlsConnectParams.pRootCALocation);
 	if(ret < 0) {
 		IOT_ERROR(" failed\n  !  mbedtls_x509_crt_parse returned -0x%x while parsing root cert\n\n", -ret);
@@ -175,8 +194,10 @@ IoT_Error_t iot_tls_connect(Network *pNetwork, TLSConnectParams *params) {
 		return NETWORK_PK_PRIVATE_KEY_PARSE_ERROR;
 	}
 	IOT_DEBUG(" ok\n");
+	pTiming->credentials_ms = _iot_tls_elapsed_ms(&start);
 	snprintf(portBuffer, 6, "%d", pNetwork->tlsConnectParams.DestinationPort);
 	IOT_DEBUG("  . Connecting to %s/%s...", pNetwork->tlsConnectParams.pDestinationURL, portBuffer);
+	gettimeofday(&start, NULL);
 	if((ret = mbedtls_net_connect(&(tlsDataParams->server_fd), pNetwork->tlsConnectParams.pDestinationURL,
 								  portBuffer, MBEDTLS_NET_PROTO_TCP)) != 0) {
 		IOT_ERROR(" failed\n  ! mbedtls_net_connect returned -0x%x\n\n", -ret);
@@ -190,6 +211,7 @@ IoT_Error_t iot_tls_connect(Network *pNetwork, TLSConnectParams *params) {
 				return NETWORK_ERR_NET_CONNECT_FAILED;
 		};
 	}
+	pTiming->tcp_ms = _iot_tls_elapsed_ms(&start);
 
 	ret = mbedtls_net_set_block(&(tlsDataParams->server_fd));
 	if(ret != 0) {
@@ -245,6 +267,7 @@ IoT_Error_t iot_tls_connect(Network *pNetwork, TLSConnectParams *params) {
 
 	IOT_DEBUG("\n\nSSL state connect : %d ", tlsDataParams->ssl.state);
 	IOT_DEBUG("  . Performing the SSL/TLS handshake...");
+	gettimeofday(&start, NULL);
 	while((ret = mbedtls_ssl_handshake(&(tlsDataParams->ssl))) != 0) {
 		if(ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
 			IOT_ERROR(" failed\n  ! mbedtls_ssl_handshake returned -0x%x\n", -ret);
@@ -259,6 +282,7 @@ IoT_Error_t iot_tls_connect(Network *pNetwork, TLSConnectParams *params) {
 			return SSL_CONNECTION_ERROR;
 		}
 	}
+	pTiming->handshake_ms = _iot_tls_elapsed_ms(&start);
 
 	IOT_DEBUG(" ok\n    [ Protocol is %s ]\n    [ Ciphersuite is %s ]\n", mbedtls_ssl_get_version(&(tlsDataParams->ssl)),
 		  mbedtls_ssl_get_ciphersuite(&(tlsDataParams->ssl)));
@@ -352,6 +376,24 @@ IoT_Error_t iot_tls_write(Network *pNetwork, unsigned char *pMsg, size_t len, Ti
 	return SUCCESS;
 }
 
+IoT_Error_t iot_tls_writev(Network *pNetwork, const IoT_Iovec *pVec, size_t count, Timer *timer, size_t *written_len) {
+	size_t txLen = 0U;
+	size_t vecLen;
+	size_t i;
+	IoT_Error_t rc = SUCCESS;
+
+	/* Each buffer is passed to mbedtls_ssl_write where it is, mbedTLS copies
+	 * it only once into its record while encrypting */
+	for(i = 0U; i < count && SUCCESS == rc; i++) {
+		vecLen = 0U;
+		rc = iot_tls_write(pNetwork, (unsigned char *) pVec[i].pBuffer, pVec[i].len, timer, &vecLen);
+		txLen += vecLen;
+	}
+
+	*written_len = txLen;
+	return rc;
+}
+
 IoT_Error_t iot_tls_read(Network *pNetwork, unsigned char *pMsg, size_t len, Timer *timer, size_t *read_len) {
 	mbedtls_ssl_context *pSsl = &(pNetwork->tlsDataParams.ssl);
 	size_t rxLen = 0U;
@@ -406,6 +448,33 @@ IoT_Error_t iot_tls_read(Network *pNetwork, unsigned char *pMsg, size_t len, Tim
 	return SUCCESS;
 }
 
+IoT_Error_t iot_tls_wait_for_read(Network *pNetwork, uint32_t timeout_ms) {
+	TLSDataParams *tlsDataParams = &(pNetwork->tlsDataParams);
+	fd_set readFds;
+	struct timeval timeout;
+	int ret;
+
+	/* Records mbedtls_ssl_read already decrypted are no longer visible on the socket */
+	if(mbedtls_ssl_get_bytes_avail(&(tlsDataParams->ssl)) > 0) {
+		return SUCCESS;
+	}
+
+	FD_ZERO(&readFds);
+	FD_SET(tlsDataParams->server_fd.fd, &readFds);
+	timeout.tv_sec = timeout_ms / 1000;
+	timeout.tv_usec = (timeout_ms % 1000) * 1000;
+
+	ret = select(tlsDataParams->server_fd.fd + 1, &readFds, NULL, NULL, &timeout);
+	if(ret > 0) {
+		return SUCCESS;
+	} else if(ret == 0 || errno == EINTR) {
+		return NETWORK_SSL_NOTHING_TO_READ;
+	}
+
+	IOT_ERROR("Failed\n  ! select returned %d, errno %d\n\n", ret, errno);
+	return NETWORK_SSL_READ_ERROR;
+}
+
 IoT_Error_t iot_tls_disconnect(Network *pNetwork) {
 	mbedtls_ssl_context *ssl = &(pNetwork->tlsDataParams.ssl);
 	int ret = 0;
@@ -435,6 +504,12 @@ IoT_Error_t iot_tls_destroy(Network *pNetwork) {
 	return SUCCESS;
 }
 
+IoT_Error_t iot_tls_free_cache(Network *pNetwork) {
+	/* Nothing is kept across connections, every connect parses the credentials again */
+	IOT_UNUSED(pNetwork);
+	return SUCCESS;
+}
+
 #ifdef __cplusplus
 }
 #endif
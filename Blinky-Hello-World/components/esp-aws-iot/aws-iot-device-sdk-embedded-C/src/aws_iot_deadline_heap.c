@@ -0,0 +1,166 @@
+/*
+ * Copyright 2010-2015 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file aws_iot_deadline_heap.c
+ * @brief Min heap of timer deadlines
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+#include "aws_iot_deadline_heap.h"
+
+static void _aws_iot_deadline_heap_swap(AWS_IoT_Deadline_Heap *pHeap, uint8_t a, uint8_t b) {
+	AWS_IoT_Deadline entry = pHeap->entries[a];
+	pHeap->entries[a] = pHeap->entries[b];
+	pHeap->entries[b] = entry;
+}
+
+static void _aws_iot_deadline_heap_sift_up(AWS_IoT_Deadline_Heap *pHeap, uint8_t index) {
+	uint8_t parent;
+
+	while(0 < index) {
+		parent = (uint8_t) ((index - 1) / 2);
+		if(pHeap->entries[parent].deadline_us <= pHeap->entries[index].deadline_us) {
+			break;
+		}
+		_aws_iot_deadline_heap_swap(pHeap, parent, index);
+		index = parent;
+	}
+}
+
+static void _aws_iot_deadline_heap_sift_down(AWS_IoT_Deadline_Heap *pHeap, uint8_t index) {
+	uint8_t child, smallest;
+
+	for(;;) {
+		smallest = index;
+		child = (uint8_t) (2 * index + 1);
+		if(child < pHeap->count && pHeap->entries[child].deadline_us < pHeap->entries[smallest].deadline_us) {
+			smallest = child;
+		}
+		child++;
+		if(child < pHeap->count && pHeap->entries[child].deadline_us < pHeap->entries[smallest].deadline_us) {
+			smallest = child;
+		}
+		if(smallest == index) {
+			return;
+		}
+		_aws_iot_deadline_heap_swap(pHeap, smallest, index);
+		index = smallest;
+	}
+}
+
+static void _aws_iot_deadline_heap_remove_at(AWS_IoT_Deadline_Heap *pHeap, uint8_t index) {
+	pHeap->count--;
+	if(index == pHeap->count) {
+		return;
+	}
+	pHeap->entries[index] = pHeap->entries[pHeap->count];
+	_aws_iot_deadline_heap_sift_down(pHeap, index);
+	_aws_iot_deadline_heap_sift_up(pHeap, index);
+}
+
+static int _aws_iot_deadline_heap_find(const AWS_IoT_Deadline_Heap *pHeap, const Timer *pTimer) {
+	uint8_t i;
+
+	for(i = 0; i < pHeap->count; i++) {
+		if(pHeap->entries[i].pTimer == pTimer) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+void aws_iot_deadline_heap_init(AWS_IoT_Deadline_Heap *pHeap) {
+	if(NULL != pHeap) {
+		pHeap->count = 0;
+	}
+}
+
+IoT_Error_t aws_iot_deadline_heap_schedule(AWS_IoT_Deadline_Heap *pHeap, Timer *pTimer) {
+	uint64_t deadline_us;
+	int index;
+
+	if(NULL == pHeap || NULL == pTimer) {
+		return NULL_VALUE_ERROR;
+	}
+
+	deadline_us = timer_deadline_us(pTimer);
+	index = _aws_iot_deadline_heap_find(pHeap, pTimer);
+	if(0 <= index) {
+		pHeap->entries[index].deadline_us = deadline_us;
+		_aws_iot_deadline_heap_sift_down(pHeap, (uint8_t) index);
+		_aws_iot_deadline_heap_sift_up(pHeap, (uint8_t) index);
+		return SUCCESS;
+	}
+
+	if(AWS_IOT_DEADLINE_HEAP_SIZE <= pHeap->count) {
+		return LIMIT_EXCEEDED_ERROR;
+	}
+
+	pHeap->entries[pHeap->count].pTimer = pTimer;
+	pHeap->entries[pHeap->count].deadline_us = deadline_us;
+	pHeap->count++;
+	_aws_iot_deadline_heap_sift_up(pHeap, (uint8_t) (pHeap->count - 1));
+
+	return SUCCESS;
+}
+
+void aws_iot_deadline_heap_cancel(AWS_IoT_Deadline_Heap *pHeap, Timer *pTimer) {
+	int index;
+
+	if(NULL == pHeap || NULL == pTimer) {
+		return;
+	}
+
+	index = _aws_iot_deadline_heap_find(pHeap, pTimer);
+	if(0 <= index) {
+		_aws_iot_deadline_heap_remove_at(pHeap, (uint8_t) index);
+	}
+}
+
+uint64_t aws_iot_deadline_heap_next_wakeup_us(AWS_IoT_Deadline_Heap *pHeap, uint64_t max_us) {
+	uint64_t left = 0;
+	bool isExpired = false;
+
+	if(NULL == pHeap) {
+		return max_us;
+	}
+
+	// the timers are asked rather than the stored deadlines, they have the clock
+	while(0 < pHeap->count && 0 == (left = left_us(pHeap->entries[0].pTimer))) {
+		_aws_iot_deadline_heap_remove_at(pHeap, 0);
+		isExpired = true;
+	}
+
+	if(isExpired) {
+		return 0;
+	}
+
+	if(0 == pHeap->count || max_us < left) {
+		return max_us;
+	}
+
+	return left;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -226,6 +226,13 @@ IoT_Error_t aws_iot_mqtt_free(AWS_IoT_Client *pClient)
 			(void)aws_iot_thread_mutex_destroy(&(pClient->clientData.tls_write_mutex));
 		}
 	#endif
+
+		if (rc == SUCCESS)
+		{
+			rc = iot_tls_free_cache(&(pClient->networkStack));
+		}else{
+			(void)iot_tls_free_cache(&(pClient->networkStack));
+		}
 	}
 
     FUNC_EXIT_RC(rc);
@@ -250,12 +257,14 @@ IoT_Error_t aws_iot_mqtt_init(AWS_IoT_Client *pClient, const IoT_Client_Init_Par
 		pClient->clientData.messageHandlers[i].pApplicationHandlerData = NULL;
 		pClient->clientData.messageHandlers[i].qos = QOS0;
 	}
+	aws_iot_mqtt_internal_index_subscriptions(pClient);
 
 	pClient->clientData.packetTimeoutMs = pInitParams->mqttPacketTimeout_ms;
 	pClient->clientData.commandTimeoutMs = pInitParams->mqttCommandTimeout_ms;
 	pClient->clientData.writeBufSize = AWS_IOT_MQTT_TX_BUF_LEN;
 	pClient->clientData.readBufSize = AWS_IOT_MQTT_RX_BUF_LEN;
 	pClient->clientData.counterNetworkDisconnected = 0;
+	pClient->clientData.connackLatencyMs = 0;
 	pClient->clientData.disconnectHandler = pInitParams->disconnectHandler;
 	pClient->clientData.disconnectHandlerData = pInitParams->disconnectHandlerData;
 	pClient->clientData.nextPacketId = 1;
@@ -305,6 +314,7 @@ IoT_Error_t aws_iot_mqtt_init(AWS_IoT_Client *pClient, const IoT_Client_Init_Par
 	init_timer(&(pClient->pingReqTimer));
 	init_timer(&(pClient->pingRespTimer));
 	init_timer(&(pClient->reconnectDelayTimer));
+	aws_iot_deadline_heap_init(&(pClient->deadlines));
 
 	pClient->clientStatus.clientState = CLIENT_STATE_INITIALIZED;
 
@@ -392,6 +402,17 @@ void aws_iot_mqtt_reset_network_disconnected_count(AWS_IoT_Client *pClient) {
 	pClient->clientData.counterNetworkDisconnected = 0;
 }
 
+IoT_Error_t aws_iot_mqtt_get_connect_timing(AWS_IoT_Client *pClient, IoT_Client_Connect_Timing *pTiming) {
+	if(NULL == pClient || NULL == pTiming) {
+		return NULL_VALUE_ERROR;
+	}
+
+	pTiming->network = pClient->networkStack.connectTiming;
+	pTiming->mqttConnect_ms = pClient->clientData.connackLatencyMs;
+
+	return SUCCESS;
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -42,6 +42,9 @@ extern "C" {
 
 #include "aws_iot_mqtt_client_common_internal.h"
 
+/** Greatest value of the remaining length field, MQTT v3.1.1 Specification 2.2.3 */
+#define MAX_REMAINING_LENGTH 268435455
+
 /**
  * @param stringVar pointer to the String into which the data is to be read
  * @param stringLen pointer to variable which has the length of the string
@@ -69,8 +72,8 @@ static IoT_Error_t _aws_iot_mqtt_read_string_with_len(char **stringVar, uint16_t
 }
 
 /**
-  * Serializes the supplied publish data into the supplied buffer, ready for sending
-  * @param pTxBuf the buffer into which the packet will be serialized
+  * Serializes everything of a publish packet but its payload into the supplied buffer
+  * @param pTxBuf the buffer into which the packet header will be serialized
   * @param txBufLen the length in bytes of the supplied buffer
   * @param dup uint8_t - the MQTT dup flag
   * @param qos QoS - the MQTT QoS value
@@ -78,35 +81,38 @@ static IoT_Error_t _aws_iot_mqtt_read_string_with_len(char **stringVar, uint16_t
   * @param packetId uint16_t - the MQTT packet identifier
   * @param pTopicName char * - the MQTT topic in the publish
   * @param topicNameLen uint16_t - the length of the Topic Name
-  * @param pPayload byte buffer - the MQTT publish payload
-  * @param payloadLen size_t - the length of the MQTT payload
+  * @param payloadLen size_t - the length of the MQTT payload that will follow
   * @param pSerializedLen uint32_t - pointer to the variable that stores serialized len
   *
   * @return An IoT Error Type defining successful/failed call
   */
-static IoT_Error_t _aws_iot_mqtt_internal_serialize_publish(unsigned char *pTxBuf, size_t txBufLen, uint8_t dup,
-															QoS qos, uint8_t retained, uint16_t packetId,
-															const char *pTopicName, uint16_t topicNameLen,
-															const unsigned char *pPayload, size_t payloadLen,
-															uint32_t *pSerializedLen) {
+IoT_Error_t aws_iot_mqtt_internal_serialize_publish_header(unsigned char *pTxBuf, size_t txBufLen,
+															 uint8_t dup, QoS qos, uint8_t retained,
+															 uint16_t packetId, const char *pTopicName,
+															 uint16_t topicNameLen, size_t payloadLen,
+															 uint32_t *pSerializedLen) {
 	unsigned char *ptr;
 	uint32_t rem_len;
 	IoT_Error_t rc;
 	MQTTHeader header = {0};
 
 	FUNC_ENTRY;
-	if(NULL == pTxBuf || NULL == pPayload || NULL == pSerializedLen) {
+	if(NULL == pTxBuf || NULL == pSerializedLen) {
 		FUNC_EXIT_RC(NULL_VALUE_ERROR);
 	}
 
 	ptr = pTxBuf;
 	rem_len = 0;
 
-	rem_len += (uint32_t) (topicNameLen + payloadLen + 2);
+	rem_len += (uint32_t) (topicNameLen + 2);
 	if(qos > 0) {
 		rem_len += 2; /* packetId */
 	}
-	if(aws_iot_mqtt_internal_get_final_packet_length_from_remaining_length(rem_len) > txBufLen) {
+	if(payloadLen > MAX_REMAINING_LENGTH - rem_len) {
+		FUNC_EXIT_RC(MAX_SIZE_ERROR);
+	}
+	rem_len += (uint32_t) payloadLen;
+	if(aws_iot_mqtt_internal_get_final_packet_length_from_remaining_length(rem_len) - payloadLen > txBufLen) {
 		FUNC_EXIT_RC(MQTT_TX_BUFFER_TOO_SHORT_ERROR);
 	}
 
@@ -124,9 +130,6 @@ static IoT_Error_t _aws_iot_mqtt_internal_serialize_publish(unsigned char *pTxBu
 		aws_iot_mqtt_internal_write_uint_16(&ptr, packetId);
 	}
 
-	memcpy(ptr, pPayload, payloadLen);
-	ptr += payloadLen;
-
 	*pSerializedLen = (uint32_t) (ptr - pTxBuf);
 
 	FUNC_EXIT_RC(SUCCESS);
@@ -187,16 +190,28 @@ IoT_Error_t aws_iot_mqtt_internal_serialize_ack(unsigned char *pTxBuf, size_t tx
  * This is the internal function which is called by the publish API to perform the operation.
  * Not meant to be called directly as it doesn't do validations or client state changes
  *
+ * The header goes into the TX buffer. Payload buffers shorter than copyThreshold
+ * are copied after it while there is room, the others are written to the
+ * network straight from the caller's memory.
+ *
  * @param pClient Reference to the IoT Client
  * @param pTopicName Topic Name to publish to
  * @param topicNameLen Length of the topic name
  * @param pParams Pointer to Publish Message parameters
+ * @param pPayload Payload buffers
+ * @param payloadCount Number of payload buffers, at most AWS_IOT_MQTT_PUBLISH_MAX_IOVECS
+ * @param copyThreshold Payload buffers shorter than this are copied into the TX buffer
  *
  * @return An IoT Error Type defining successful/failed publish
  */
 static IoT_Error_t _aws_iot_mqtt_internal_publish(AWS_IoT_Client *pClient, const char *pTopicName,
-												  uint16_t topicNameLen, IoT_Publish_Message_Params *pParams) {
+												  uint16_t topicNameLen, IoT_Publish_Message_Params *pParams,
+												  const IoT_Iovec *pPayload, size_t payloadCount,
+												  size_t copyThreshold) {
 	Timer timer;
+	IoT_Iovec packet[AWS_IOT_MQTT_PUBLISH_MAX_IOVECS + 1];
+	size_t packetCount, payloadLen, staged, i;
+	unsigned char *pWriteBuf = pClient->clientData.writeBuf;
 	uint32_t len = 0;
 	uint16_t packet_id;
 	unsigned char dup, type;
@@ -207,20 +222,53 @@ static IoT_Error_t _aws_iot_mqtt_internal_publish(AWS_IoT_Client *pClient, const
 	init_timer(&timer);
 	countdown_ms(&timer, pClient->clientData.commandTimeoutMs);
 
+	payloadLen = 0;
+	for(i = 0; i < payloadCount; i++) {
+		if(pPayload[i].len > MAX_REMAINING_LENGTH - payloadLen) {
+			FUNC_EXIT_RC(MAX_SIZE_ERROR);
+		}
+		payloadLen += pPayload[i].len;
+	}
+
 	if(QOS1 == pParams->qos) {
 		pParams->id = aws_iot_mqtt_get_next_packet_id(pClient);
 	}
 
-	rc = _aws_iot_mqtt_internal_serialize_publish(pClient->clientData.writeBuf, pClient->clientData.writeBufSize, 0,
-												  pParams->qos, pParams->isRetained, pParams->id, pTopicName,
-												  topicNameLen, (unsigned char *) pParams->payload,
-												  pParams->payloadLen, &len);
+	rc = aws_iot_mqtt_internal_serialize_publish_header(pWriteBuf, pClient->clientData.writeBufSize, 0,
+														pParams->qos, pParams->isRetained, pParams->id,
+														pTopicName, topicNameLen, payloadLen, &len);
 	if(SUCCESS != rc) {
 		FUNC_EXIT_RC(rc);
 	}
 
+	packet[0].pBuffer = pWriteBuf;
+	packet[0].len = len;
+	packetCount = 1;
+	staged = len;
+
+	for(i = 0; i < payloadCount; i++) {
+		if(0 == pPayload[i].len) {
+			continue;
+		}
+
+		if(pPayload[i].len < copyThreshold && pPayload[i].len <= pClient->clientData.writeBufSize - staged) {
+			/* start a new buffer if the last one is not the staged tail of the TX buffer */
+			if(packet[packetCount - 1].pBuffer + packet[packetCount - 1].len != &pWriteBuf[staged]) {
+				packet[packetCount].pBuffer = &pWriteBuf[staged];
+				packet[packetCount].len = 0;
+				packetCount++;
+			}
+			memcpy(&pWriteBuf[staged], pPayload[i].pBuffer, pPayload[i].len);
+			packet[packetCount - 1].len += pPayload[i].len;
+			staged += pPayload[i].len;
+		} else {
+			packet[packetCount] = pPayload[i];
+			packetCount++;
+		}
+	}
+
 	/* send the publish packet */
-	rc = aws_iot_mqtt_internal_send_packet(pClient, len, &timer);
+	rc = aws_iot_mqtt_internal_send_packet_vector(pClient, packet, packetCount, &timer);
 	if(SUCCESS != rc) {
 		FUNC_EXIT_RC(rc);
 	}
@@ -246,6 +294,7 @@ IoT_Error_t aws_iot_mqtt_publish(AWS_IoT_Client *pClient, const char *pTopicName
 								 IoT_Publish_Message_Params *pParams) {
 	IoT_Error_t rc, pubRc;
 	ClientState clientState;
+	IoT_Iovec payload;
 
 	FUNC_ENTRY;
 
@@ -262,12 +311,69 @@ IoT_Error_t aws_iot_mqtt_publish(AWS_IoT_Client *pClient, const char *pTopicName
 		FUNC_EXIT_RC(MQTT_CLIENT_NOT_IDLE_ERROR);
 	}
 
+	if(NULL == pParams->payload) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	rc = aws_iot_mqtt_set_client_state(pClient, clientState, CLIENT_STATE_CONNECTED_PUBLISH_IN_PROGRESS);
+	if(SUCCESS != rc) {
+		FUNC_EXIT_RC(rc);
+	}
+
+	/* Copy the payload whenever it fits so the packet goes out in one write */
+	payload.pBuffer = (const unsigned char *) pParams->payload;
+	payload.len = pParams->payloadLen;
+	pubRc = _aws_iot_mqtt_internal_publish(pClient, pTopicName, topicNameLen, pParams, &payload, 1,
+										   pClient->clientData.writeBufSize + 1);
+
+	rc = aws_iot_mqtt_set_client_state(pClient, CLIENT_STATE_CONNECTED_PUBLISH_IN_PROGRESS, clientState);
+	if(SUCCESS == pubRc && SUCCESS != rc) {
+		pubRc = rc;
+	}
+
+	FUNC_EXIT_RC(pubRc);
+}
+
+IoT_Error_t aws_iot_mqtt_publish_vector(AWS_IoT_Client *pClient, const char *pTopicName, uint16_t topicNameLen,
+										IoT_Publish_Message_Params *pParams, const IoT_Iovec *pPayload,
+										size_t payloadCount) {
+	IoT_Error_t rc, pubRc;
+	ClientState clientState;
+	size_t i;
+
+	FUNC_ENTRY;
+
+	if(NULL == pClient || NULL == pTopicName || 0 == topicNameLen || NULL == pParams
+	   || (NULL == pPayload && 0 < payloadCount)) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	for(i = 0; i < payloadCount; i++) {
+		if(NULL == pPayload[i].pBuffer && 0 < pPayload[i].len) {
+			FUNC_EXIT_RC(NULL_VALUE_ERROR);
+		}
+	}
+
+	if(AWS_IOT_MQTT_PUBLISH_MAX_IOVECS < payloadCount) {
+		FUNC_EXIT_RC(LIMIT_EXCEEDED_ERROR);
+	}
+
+	if(!aws_iot_mqtt_is_client_connected(pClient)) {
+		FUNC_EXIT_RC(NETWORK_DISCONNECTED_ERROR);
+	}
+
+	clientState = aws_iot_mqtt_get_client_state(pClient);
+	if(CLIENT_STATE_CONNECTED_IDLE != clientState && CLIENT_STATE_CONNECTED_WAIT_FOR_CB_RETURN != clientState) {
+		FUNC_EXIT_RC(MQTT_CLIENT_NOT_IDLE_ERROR);
+	}
+
 	rc = aws_iot_mqtt_set_client_state(pClient, clientState, CLIENT_STATE_CONNECTED_PUBLISH_IN_PROGRESS);
 	if(SUCCESS != rc) {
 		FUNC_EXIT_RC(rc);
 	}
 
-	pubRc = _aws_iot_mqtt_internal_publish(pClient, pTopicName, topicNameLen, pParams);
+	pubRc = _aws_iot_mqtt_internal_publish(pClient, pTopicName, topicNameLen, pParams, pPayload, payloadCount,
+										   AWS_IOT_MQTT_PUBLISH_COPY_THRESHOLD);
 
 	rc = aws_iot_mqtt_set_client_state(pClient, CLIENT_STATE_CONNECTED_PUBLISH_IN_PROGRESS, clientState);
 	if(SUCCESS == pubRc && SUCCESS != rc) {
@@ -192,6 +192,7 @@ static IoT_Error_t _aws_iot_mqtt_internal_unsubscribe(AWS_IoT_Client *pClient, c
              * with 2 callbacks. Unlikely scenario */
 		}
 	}
+	aws_iot_mqtt_internal_index_subscriptions(pClient);
 
 	FUNC_EXIT_RC(SUCCESS);
 }
@@ -0,0 +1,606 @@
+/*
+ * Copyright 2010-2015 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file aws_iot_payload.c
+ * @brief Schema driven payloads in JSON or CBOR
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <string.h>
+#include <math.h>
+
+#include "aws_iot_payload.h"
+#include "aws_iot_shadow_json.h"
+#include "aws_iot_log.h"
+
+#define CBOR_MAJOR_UINT 0
+#define CBOR_MAJOR_NEGINT 1
+#define CBOR_MAJOR_BYTES 2
+#define CBOR_MAJOR_TEXT 3
+#define CBOR_MAJOR_ARRAY 4
+#define CBOR_MAJOR_MAP 5
+#define CBOR_MAJOR_TAG 6
+#define CBOR_MAJOR_SIMPLE 7
+
+#define CBOR_FALSE 20
+#define CBOR_TRUE 21
+#define CBOR_HALF 25
+#define CBOR_SINGLE 26
+#define CBOR_DOUBLE 27
+
+#define PAYLOAD_MAX_FIELDS 32
+
+typedef struct {
+	uint8_t *pBuffer;
+	size_t bufferSize;
+	size_t offset;
+	IoT_Error_t error;
+} CborWriter_t;
+
+typedef struct {
+	const uint8_t *pPayload;
+	size_t payloadLen;
+	size_t offset;
+} CborReader_t;
+
+static bool cborSkipItem(CborReader_t *pReader, uint8_t depth);
+
+static void cborWrite(CborWriter_t *pWriter, const void *pData, size_t length) {
+	if(SUCCESS != pWriter->error) {
+		return;
+	}
+	if(length > pWriter->bufferSize - pWriter->offset) {
+		pWriter->error = SHADOW_JSON_BUFFER_TRUNCATED;
+		return;
+	}
+	memcpy(&pWriter->pBuffer[pWriter->offset], pData, length);
+	pWriter->offset += length;
+}
+
+/* Writes length bytes of value big endian after the initial byte */
+static void cborWriteHead(CborWriter_t *pWriter, uint8_t major, uint64_t value) {
+	uint8_t head[9];
+	size_t length, i;
+	uint8_t info;
+
+	if(value < 24) {
+		info = (uint8_t) value;
+		length = 0;
+	} else if(value <= UINT8_MAX) {
+		info = 24;
+		length = 1;
+	} else if(value <= UINT16_MAX) {
+		info = 25;
+		length = 2;
+	} else if(value <= UINT32_MAX) {
+		info = 26;
+		length = 4;
+	} else {
+		info = 27;
+		length = 8;
+	}
+
+	head[0] = (uint8_t) ((major << 5) | info);
+	for(i = 0; i < length; i++) {
+		head[length - i] = (uint8_t) (value >> (8 * i));
+	}
+	cborWrite(pWriter, head, length + 1);
+}
+
+static void cborWriteSigned(CborWriter_t *pWriter, int32_t value) {
+	if(0 <= value) {
+		cborWriteHead(pWriter, CBOR_MAJOR_UINT, (uint64_t) value);
+	} else {
+		cborWriteHead(pWriter, CBOR_MAJOR_NEGINT, (uint64_t) (-(int64_t) value - 1));
+	}
+}
+
+static void cborWriteFloatBits(CborWriter_t *pWriter, uint8_t info, uint64_t bits, size_t length) {
+	uint8_t head[9];
+	size_t i;
+
+	head[0] = (uint8_t) ((CBOR_MAJOR_SIMPLE << 5) | info);
+	for(i = 0; i < length; i++) {
+		head[length - i] = (uint8_t) (bits >> (8 * i));
+	}
+	cborWrite(pWriter, head, length + 1);
+}
+
+static void cborWriteValue(CborWriter_t *pWriter, const jsonStruct_t *pField) {
+	CborReader_t item;
+	uint32_t floatBits;
+	uint64_t doubleBits;
+	size_t length;
+
+	switch(pField->type) {
+		case SHADOW_JSON_INT32:
+			cborWriteSigned(pWriter, *(const int32_t *) pField->pData);
+			break;
+		case SHADOW_JSON_INT16:
+			cborWriteSigned(pWriter, *(const int16_t *) pField->pData);
+			break;
+		case SHADOW_JSON_INT8:
+			cborWriteSigned(pWriter, *(const int8_t *) pField->pData);
+			break;
+		case SHADOW_JSON_UINT32:
+			cborWriteHead(pWriter, CBOR_MAJOR_UINT, *(const uint32_t *) pField->pData);
+			break;
+		case SHADOW_JSON_UINT16:
+			cborWriteHead(pWriter, CBOR_MAJOR_UINT, *(const uint16_t *) pField->pData);
+			break;
+		case SHADOW_JSON_UINT8:
+			cborWriteHead(pWriter, CBOR_MAJOR_UINT, *(const uint8_t *) pField->pData);
+			break;
+		case SHADOW_JSON_FLOAT:
+			memcpy(&floatBits, pField->pData, sizeof(floatBits));
+			cborWriteFloatBits(pWriter, CBOR_SINGLE, floatBits, sizeof(floatBits));
+			break;
+		case SHADOW_JSON_DOUBLE:
+			memcpy(&doubleBits, pField->pData, sizeof(doubleBits));
+			cborWriteFloatBits(pWriter, CBOR_DOUBLE, doubleBits, sizeof(doubleBits));
+			break;
+		case SHADOW_JSON_BOOL:
+			cborWriteHead(pWriter, CBOR_MAJOR_SIMPLE, *(const bool *) pField->pData ? CBOR_TRUE : CBOR_FALSE);
+			break;
+		case SHADOW_JSON_STRING:
+			length = strlen((const char *) pField->pData);
+			cborWriteHead(pWriter, CBOR_MAJOR_TEXT, length);
+			cborWrite(pWriter, pField->pData, length);
+			break;
+		case SHADOW_JSON_OBJECT:
+			/* The item in pData tells its own length, pData only has to be large enough for it */
+			item.pPayload = (const uint8_t *) pField->pData;
+			item.payloadLen = pField->dataLength;
+			item.offset = 0;
+			if(!cborSkipItem(&item, AWS_IOT_PAYLOAD_CBOR_MAX_DEPTH)) {
+				pWriter->error = SHADOW_JSON_ERROR;
+				break;
+			}
+			cborWrite(pWriter, pField->pData, item.offset);
+			break;
+	}
+}
+
+/* Reads the initial byte and the argument of an item, indefinite lengths are not supported */
+static bool cborReadHead(CborReader_t *pReader, uint8_t *pMajor, uint8_t *pInfo, uint64_t *pValue) {
+	size_t length, i;
+	uint8_t initial;
+
+	if(pReader->offset >= pReader->payloadLen) {
+		return false;
+	}
+
+	initial = pReader->pPayload[pReader->offset++];
+	*pMajor = initial >> 5;
+	*pInfo = initial & 0x1F;
+
+	if(*pInfo < 24) {
+		*pValue = *pInfo;
+		return true;
+	}
+	if(*pInfo > 27) {
+		return false;
+	}
+
+	length = (size_t) 1 << (*pInfo - 24);
+	if(length > pReader->payloadLen - pReader->offset) {
+		return false;
+	}
+	*pValue = 0;
+	for(i = 0; i < length; i++) {
+		*pValue = (*pValue << 8) | pReader->pPayload[pReader->offset++];
+	}
+
+	return true;
+}
+
+static bool cborSkipItem(CborReader_t *pReader, uint8_t depth) {
+	uint64_t value, items, i;
+	uint8_t major, info;
+
+	if(0 == depth || !cborReadHead(pReader, &major, &info, &value)) {
+		return false;
+	}
+
+	switch(major) {
+		case CBOR_MAJOR_BYTES:
+		case CBOR_MAJOR_TEXT:
+			if(value > pReader->payloadLen - pReader->offset) {
+				return false;
+			}
+			pReader->offset += (size_t) value;
+			return true;
+		case CBOR_MAJOR_ARRAY:
+		case CBOR_MAJOR_MAP:
+			/* Every item takes at least one byte, which bounds the loop by the payload length */
+			items = (CBOR_MAJOR_MAP == major) ? 2 * value : value;
+			if(value > pReader->payloadLen || items > pReader->payloadLen - pReader->offset) {
+				return false;
+			}
+			for(i = 0; i < items; i++) {
+				if(!cborSkipItem(pReader, (uint8_t) (depth - 1))) {
+					return false;
+				}
+			}
+			return true;
+		case CBOR_MAJOR_TAG:
+			return cborSkipItem(pReader, (uint8_t) (depth - 1));
+		default:
+			return true;
+	}
+}
+
+static float cborHalfToFloat(uint16_t half) {
+	int exponent = (half >> 10) & 0x1F;
+	int mantissa = half & 0x3FF;
+	float value;
+
+	if(0 == exponent) {
+		value = ldexpf((float) mantissa, -24);
+	} else if(0x1F == exponent) {
+		value = (0 == mantissa) ? INFINITY : NAN;
+	} else {
+		value = ldexpf((float) (mantissa + 0x400), exponent - 25);
+	}
+
+	return (half & 0x8000) ? -value : value;
+}
+
+/* Converts a number item to double, false if the item is not a number */
+static bool cborNumberToDouble(uint8_t major, uint8_t info, uint64_t value, double *pNumber) {
+	uint32_t floatBits;
+	float singleValue;
+
+	if(CBOR_MAJOR_UINT == major) {
+		*pNumber = (double) value;
+	} else if(CBOR_MAJOR_NEGINT == major) {
+		*pNumber = -1.0 - (double) value;
+	} else if(CBOR_MAJOR_SIMPLE == major && CBOR_HALF == info) {
+		*pNumber = cborHalfToFloat((uint16_t) value);
+	} else if(CBOR_MAJOR_SIMPLE == major && CBOR_SINGLE == info) {
+		floatBits = (uint32_t) value;
+		memcpy(&singleValue, &floatBits, sizeof(singleValue));
+		*pNumber = singleValue;
+	} else if(CBOR_MAJOR_SIMPLE == major && CBOR_DOUBLE == info) {
+		memcpy(pNumber, &value, sizeof(*pNumber));
+	} else {
+		return false;
+	}
+
+	return true;
+}
+
+/* Converts an integer item to int64_t, false if the item is not an integer in range */
+static bool cborIntegerValue(uint8_t major, uint64_t value, int64_t min, int64_t max, int64_t *pInteger) {
+	if(CBOR_MAJOR_UINT == major && value <= (uint64_t) max) {
+		*pInteger = (int64_t) value;
+		return true;
+	}
+	if(CBOR_MAJOR_NEGINT == major && 0 > min && value <= (uint64_t) (-(min + 1))) {
+		*pInteger = -(int64_t) value - 1;
+		return true;
+	}
+
+	return false;
+}
+
+/* Decodes the item at the reader into the field, false only if the item is malformed. pIsUpdated tells if the
+ * item fit the field, the reader is left after the item either way */
+static bool cborReadValue(CborReader_t *pReader, jsonStruct_t *pField, bool *pIsUpdated) {
+	size_t start = pReader->offset;
+	uint64_t value;
+	int64_t integer;
+	double number;
+	uint8_t major, info;
+
+	*pIsUpdated = false;
+	if(!cborReadHead(pReader, &major, &info, &value)) {
+		return false;
+	}
+
+	switch(pField->type) {
+		case SHADOW_JSON_INT32:
+			if(pField->dataLength < sizeof(int32_t) || !cborIntegerValue(major, value, INT32_MIN, INT32_MAX, &integer)) {
+				break;
+			}
+			*(int32_t *) pField->pData = (int32_t) integer;
+			*pIsUpdated = true;
+			return true;
+		case SHADOW_JSON_INT16:
+			if(pField->dataLength < sizeof(int16_t) || !cborIntegerValue(major, value, INT16_MIN, INT16_MAX, &integer)) {
+				break;
+			}
+			*(int16_t *) pField->pData = (int16_t) integer;
+			*pIsUpdated = true;
+			return true;
+		case SHADOW_JSON_INT8:
+			if(pField->dataLength < sizeof(int8_t) || !cborIntegerValue(major, value, INT8_MIN, INT8_MAX, &integer)) {
+				break;
+			}
+			*(int8_t *) pField->pData = (int8_t) integer;
+			*pIsUpdated = true;
+			return true;
+		case SHADOW_JSON_UINT32:
+			if(pField->dataLength < sizeof(uint32_t) || !cborIntegerValue(major, value, 0, UINT32_MAX, &integer)) {
+				break;
+			}
+			*(uint32_t *) pField->pData = (uint32_t) integer;
+			*pIsUpdated = true;
+			return true;
+		case SHADOW_JSON_UINT16:
+			if(pField->dataLength < sizeof(uint16_t) || !cborIntegerValue(major, value, 0, UINT16_MAX, &integer)) {
+				break;
+			}
+			*(uint16_t *) pField->pData = (uint16_t) integer;
+			*pIsUpdated = true;
+			return true;
+		case SHADOW_JSON_UINT8:
+			if(pField->dataLength < sizeof(uint8_t) || !cborIntegerValue(major, value, 0, UINT8_MAX, &integer)) {
+				break;
+			}
+			*(uint8_t *) pField->pData = (uint8_t) integer;
+			*pIsUpdated = true;
+			return true;
+		case SHADOW_JSON_FLOAT:
+			if(pField->dataLength < sizeof(float) || !cborNumberToDouble(major, info, value, &number)) {
+				break;
+			}
+			*(float *) pField->pData = (float) number;
+			*pIsUpdated = true;
+			return true;
+		case SHADOW_JSON_DOUBLE:
+			if(pField->dataLength < sizeof(double) || !cborNumberToDouble(major, info, value, &number)) {
+				break;
+			}
+			*(double *) pField->pData = number;
+			*pIsUpdated = true;
+			return true;
+		case SHADOW_JSON_BOOL:
+			if(pField->dataLength < sizeof(bool) || CBOR_MAJOR_SIMPLE != major
+			   || (CBOR_FALSE != info && CBOR_TRUE != info)) {
+				break;
+			}
+			*(bool *) pField->pData = (CBOR_TRUE == info);
+			*pIsUpdated = true;
+			return true;
+		case SHADOW_JSON_STRING:
+			if(CBOR_MAJOR_TEXT != major || value >= pField->dataLength || value > pReader->payloadLen - pReader->offset) {
+				break;
+			}
+			memcpy(pField->pData, &pReader->pPayload[pReader->offset], (size_t) value);
+			((char *) pField->pData)[value] = '\0';
+			pReader->offset += (size_t) value;
+			*pIsUpdated = true;
+			return true;
+		case SHADOW_JSON_OBJECT:
+			pReader->offset = start;
+			if(!cborSkipItem(pReader, AWS_IOT_PAYLOAD_CBOR_MAX_DEPTH)
+			   || pReader->offset - start > pField->dataLength) {
+				break;
+			}
+			memcpy(pField->pData, &pReader->pPayload[start], pReader->offset - start);
+			*pIsUpdated = true;
+			return true;
+	}
+
+	/* The value does not fit the field, step over it */
+	pReader->offset = start;
+	return cborSkipItem(pReader, AWS_IOT_PAYLOAD_CBOR_MAX_DEPTH);
+}
+
+static IoT_Error_t cborEncode(const AWS_IoT_Payload_Schema *pSchema, uint8_t *pBuffer, size_t bufferSize,
+							  size_t *pLength) {
+	CborWriter_t writer = {pBuffer, bufferSize, 0, SUCCESS};
+	uint8_t i;
+
+	cborWriteHead(&writer, CBOR_MAJOR_MAP, pSchema->fieldCount);
+	for(i = 0; i < pSchema->fieldCount; i++) {
+		cborWriteHead(&writer, CBOR_MAJOR_UINT, i);
+		cborWriteValue(&writer, pSchema->ppFields[i]);
+	}
+
+	if(SUCCESS != writer.error) {
+		return writer.error;
+	}
+
+	*pLength = writer.offset;
+	return SUCCESS;
+}
+
+static IoT_Error_t cborDecode(const AWS_IoT_Payload_Schema *pSchema, const uint8_t *pPayload, size_t payloadLen,
+							  uint32_t *pUpdated) {
+	CborReader_t reader = {pPayload, payloadLen, 0};
+	jsonStruct_t *pField;
+	uint64_t pairs, key, i;
+	uint8_t major, info;
+	size_t keyStart, valueStart;
+	bool isUpdated;
+
+	if(!cborReadHead(&reader, &major, &info, &pairs) || CBOR_MAJOR_MAP != major) {
+		return JSON_PARSE_ERROR;
+	}
+
+	for(i = 0; i < pairs; i++) {
+		keyStart = reader.offset;
+		if(!cborReadHead(&reader, &major, &info, &key)) {
+			return JSON_PARSE_ERROR;
+		}
+
+		if(CBOR_MAJOR_UINT != major || key >= pSchema->fieldCount) {
+			reader.offset = keyStart;
+			if(!cborSkipItem(&reader, AWS_IOT_PAYLOAD_CBOR_MAX_DEPTH)
+			   || !cborSkipItem(&reader, AWS_IOT_PAYLOAD_CBOR_MAX_DEPTH)) {
+				return JSON_PARSE_ERROR;
+			}
+			continue;
+		}
+
+		pField = pSchema->ppFields[key];
+		valueStart = reader.offset;
+		if(!cborReadValue(&reader, pField, &isUpdated)) {
+			return JSON_PARSE_ERROR;
+		}
+		if(isUpdated) {
+			*pUpdated |= (uint32_t) 1 << key;
+			if(NULL != pField->cb) {
+				pField->cb((const char *) &pPayload[valueStart], (uint32_t) (reader.offset - valueStart), pField);
+			}
+		}
+	}
+
+	return SUCCESS;
+}
+
+static IoT_Error_t jsonEncode(const AWS_IoT_Payload_Schema *pSchema, uint8_t *pBuffer, size_t bufferSize,
+							  size_t *pLength) {
+	ShadowJsonWriter_t writer;
+	uint8_t i;
+
+	aws_iot_shadow_json_writer_init(&writer, (char *) pBuffer, bufferSize);
+	aws_iot_shadow_json_writer_begin_object(&writer, NULL);
+	for(i = 0; i < pSchema->fieldCount; i++) {
+		aws_iot_shadow_json_writer_add(&writer, pSchema->ppFields[i]);
+	}
+	aws_iot_shadow_json_writer_end_object(&writer);
+
+	if(SUCCESS != writer.error) {
+		return writer.error;
+	}
+
+	*pLength = writer.offset;
+	return SUCCESS;
+}
+
+static IoT_Error_t jsonDecode(const AWS_IoT_Payload_Schema *pSchema, const uint8_t *pPayload, size_t payloadLen,
+							  uint32_t *pUpdated) {
+	const char *pJson = (const char *) pPayload;
+	jsonStruct_t *pField;
+	int32_t tokenCount, dataPosition;
+	uint32_t dataLength;
+	uint8_t i;
+
+	if(!isJsonValidAndParse(pJson, payloadLen, NULL, &tokenCount)) {
+		return JSON_PARSE_ERROR;
+	}
+
+	for(i = 0; i < pSchema->fieldCount; i++) {
+		pField = pSchema->ppFields[i];
+		if(!isJsonKeyMatchingAndUpdateValue(pJson, NULL, tokenCount, pField, &dataLength, &dataPosition)) {
+			continue;
+		}
+		if(SHADOW_JSON_OBJECT == pField->type) {
+			if(dataLength >= pField->dataLength) {
+				continue;
+			}
+			memcpy(pField->pData, &pJson[dataPosition], dataLength);
+			((char *) pField->pData)[dataLength] = '\0';
+		}
+		*pUpdated |= (uint32_t) 1 << i;
+		if(NULL != pField->cb) {
+			pField->cb(&pJson[dataPosition], dataLength, pField);
+		}
+	}
+
+	return SUCCESS;
+}
+
+static bool isSchemaValid(const AWS_IoT_Payload_Schema *pSchema) {
+	uint8_t i;
+
+	if(NULL == pSchema || NULL == pSchema->ppFields || PAYLOAD_MAX_FIELDS < pSchema->fieldCount) {
+		return false;
+	}
+
+	for(i = 0; i < pSchema->fieldCount; i++) {
+		if(NULL == pSchema->ppFields[i] || NULL == pSchema->ppFields[i]->pKey
+		   || NULL == pSchema->ppFields[i]->pData) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+IoT_Error_t aws_iot_payload_encode(AWS_IoT_Payload_Format format, const AWS_IoT_Payload_Schema *pSchema,
+								   uint8_t *pBuffer, size_t bufferSize, size_t *pLength) {
+	FUNC_ENTRY;
+
+	if(NULL == pBuffer || NULL == pLength || !isSchemaValid(pSchema)) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	if(AWS_IOT_PAYLOAD_CBOR == format) {
+		FUNC_EXIT_RC(cborEncode(pSchema, pBuffer, bufferSize, pLength));
+	}
+
+	FUNC_EXIT_RC(jsonEncode(pSchema, pBuffer, bufferSize, pLength));
+}
+
+IoT_Error_t aws_iot_payload_decode(AWS_IoT_Payload_Format format, const AWS_IoT_Payload_Schema *pSchema,
+								   const uint8_t *pPayload, size_t payloadLen, uint32_t *pUpdated) {
+	uint32_t updated = 0;
+	IoT_Error_t rc;
+
+	FUNC_ENTRY;
+
+	if(NULL == pPayload || !isSchemaValid(pSchema)) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	if(AWS_IOT_PAYLOAD_CBOR == format) {
+		rc = cborDecode(pSchema, pPayload, payloadLen, &updated);
+	} else {
+		rc = jsonDecode(pSchema, pPayload, payloadLen, &updated);
+	}
+
+	if(NULL != pUpdated) {
+		*pUpdated = updated;
+	}
+
+	FUNC_EXIT_RC(rc);
+}
+
+IoT_Error_t aws_iot_payload_publish(AWS_IoT_Client *pClient, const AWS_IoT_Payload_Topic *pTopic, QoS qos,
+									uint8_t *pBuffer, size_t bufferSize) {
+	IoT_Publish_Message_Params params;
+	size_t length = 0;
+	IoT_Error_t rc;
+
+	FUNC_ENTRY;
+
+	if(NULL == pClient || NULL == pTopic || NULL == pTopic->pTopicName) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	rc = aws_iot_payload_encode(pTopic->format, pTopic->pSchema, pBuffer, bufferSize, &length);
+	if(SUCCESS != rc) {
+		FUNC_EXIT_RC(rc);
+	}
+
+	params.qos = qos;
+	params.isRetained = 0;
+	params.payload = pBuffer;
+	params.payloadLen = length;
+
+	FUNC_EXIT_RC(aws_iot_mqtt_publish(pClient, pTopic->pTopicName, pTopic->topicNameLen, &params));
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,581 @@
+/*
+ * Copyright 2010-2015 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file aws_iot_shadow_gateway.c
+ * @brief Shadows of many things over one MQTT connection
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <string.h>
+#include <stdio.h>
+
+#include "aws_iot_shadow_gateway.h"
+#include "aws_iot_log.h"
+#include "aws_iot_shadow_json.h"
+#include "aws_iot_shadow_key.h"
+
+#define SHADOW_GATEWAY_TOPIC_PREFIX "$aws/things/"
+#define SHADOW_GATEWAY_TOPIC_PREFIX_LEN (sizeof(SHADOW_GATEWAY_TOPIC_PREFIX) - 1)
+
+/* The filters are kept by the client for as long as the subscriptions exist */
+static const char shadowGatewayDeltaFilter[] = SHADOW_GATEWAY_TOPIC_PREFIX "+/shadow/update/delta";
+static const char shadowGatewayAcceptedFilter[] = SHADOW_GATEWAY_TOPIC_PREFIX "+/shadow/+/accepted";
+static const char shadowGatewayRejectedFilter[] = SHADOW_GATEWAY_TOPIC_PREFIX "+/shadow/+/rejected";
+
+/* Room for the prefix, the '-' and ten digits in the token buffer of extractClientToken */
+#define SHADOW_GATEWAY_MAX_TOKEN_PREFIX_LEN (MAX_SIZE_CLIENT_ID_WITH_SEQUENCE - 12)
+
+/* Takes size bytes, aligned for any member of the tables, from the front of the arena */
+static void *_aws_iot_shadow_gateway_carve(uint8_t **ppCursor, size_t *pLeft, size_t size) {
+	size_t padding = (sizeof(uint64_t) - ((uintptr_t) *ppCursor % sizeof(uint64_t))) % sizeof(uint64_t);
+	void *pBlock;
+
+	if(padding + size > *pLeft) {
+		return NULL;
+	}
+
+	pBlock = *ppCursor + padding;
+	*ppCursor += padding + size;
+	*pLeft -= padding + size;
+
+	return pBlock;
+}
+
+/* FNV-1a, the same hash the shadow client uses for client tokens */
+static uint32_t _aws_iot_shadow_gateway_hash(const char *pName, size_t nameLen) {
+	uint32_t hash = 2166136261UL;
+	size_t i;
+
+	for(i = 0; i < nameLen; i++) {
+		hash ^= (uint8_t) pName[i];
+		hash *= 16777619UL;
+	}
+
+	return hash;
+}
+
+static int32_t _aws_iot_shadow_gateway_lookup(const ShadowGateway_t *pGateway, const char *pName, size_t nameLen) {
+	const ShadowGatewayThing_t *pThing;
+	uint32_t hash = _aws_iot_shadow_gateway_hash(pName, nameLen);
+	uint32_t bucket;
+
+	for(bucket = hash & pGateway->thingBucketMask; 0 != pGateway->pThingBuckets[bucket];
+		bucket = (bucket + 1) & pGateway->thingBucketMask) {
+		pThing = &pGateway->pThings[pGateway->pThingBuckets[bucket] - 1];
+		if(pThing->nameHash == hash && pThing->nameLen == nameLen
+		   && 0 == memcmp(pGateway->pNames + pThing->nameOffset, pName, nameLen)) {
+			return pGateway->pThingBuckets[bucket] - 1;
+		}
+	}
+
+	return -1;
+}
+
+IoT_Error_t aws_iot_shadow_gateway_init(ShadowGateway_t *pGateway, AWS_IoT_Client *pClient,
+										const ShadowGatewayParams_t *pParams) {
+	uint8_t *pCursor;
+	size_t left;
+	uint32_t bucketCount;
+
+	FUNC_ENTRY;
+
+	if(NULL == pGateway || NULL == pClient || NULL == pParams || NULL == pParams->pArena
+	   || NULL == pParams->pClientTokenPrefix) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	if(0 == pParams->maxThings || 0 == pParams->maxAcks || 0 == pParams->rxBufferSize) {
+		FUNC_EXIT_RC(FAILURE);
+	}
+
+	if(strlen(pParams->pClientTokenPrefix) > SHADOW_GATEWAY_MAX_TOKEN_PREFIX_LEN) {
+		FUNC_EXIT_RC(MAX_SIZE_ERROR);
+	}
+
+	memset(pGateway, 0, sizeof(ShadowGateway_t));
+	pGateway->pClient = pClient;
+	pGateway->pClientTokenPrefix = pParams->pClientTokenPrefix;
+	pGateway->clientTokenPrefixLen = (uint16_t) strlen(pParams->pClientTokenPrefix);
+	pGateway->isDiscardOldDeltaEnabled = pParams->isDiscardOldDeltaEnabled;
+	pGateway->maxThings = pParams->maxThings;
+	pGateway->maxAcks = pParams->maxAcks;
+	pGateway->rxBufferSize = pParams->rxBufferSize;
+
+	// at most half of the buckets are used, so every probe sequence ends at an empty one
+	for(bucketCount = 2; bucketCount < 2 * (uint32_t) pParams->maxThings; bucketCount *= 2);
+	pGateway->thingBucketMask = bucketCount - 1;
+
+	pCursor = (uint8_t *) pParams->pArena;
+	left = pParams->arenaSize;
+	pGateway->pThings = (ShadowGatewayThing_t *) _aws_iot_shadow_gateway_carve(
+			&pCursor, &left, pParams->maxThings * sizeof(ShadowGatewayThing_t));
+	pGateway->pAcks = (ShadowGatewayAck_t *) _aws_iot_shadow_gateway_carve(
+			&pCursor, &left, pParams->maxAcks * sizeof(ShadowGatewayAck_t));
+	pGateway->pThingBuckets = (uint16_t *) _aws_iot_shadow_gateway_carve(&pCursor, &left,
+																		 bucketCount * sizeof(uint16_t));
+	pGateway->pRxBuffer = (char *) _aws_iot_shadow_gateway_carve(&pCursor, &left, pParams->rxBufferSize);
+	if(NULL == pGateway->pThings || NULL == pGateway->pAcks || NULL == pGateway->pThingBuckets
+	   || NULL == pGateway->pRxBuffer || 0 == left) {
+		FUNC_EXIT_RC(LIMIT_EXCEEDED_ERROR);
+	}
+
+	// the rest of the arena holds the names, addressed by 16 bit offsets
+	pGateway->pNames = (char *) pCursor;
+	pGateway->namesSize = (uint16_t) ((left > UINT16_MAX) ? UINT16_MAX : left);
+
+	memset(pGateway->pAcks, 0, pParams->maxAcks * sizeof(ShadowGatewayAck_t));
+	memset(pGateway->pThingBuckets, 0, bucketCount * sizeof(uint16_t));
+
+	FUNC_EXIT_RC(SUCCESS);
+}
+
+IoT_Error_t aws_iot_shadow_gateway_add_thing(ShadowGateway_t *pGateway, const char *pThingName,
+											 jsonStruct_t *pDeltaFields, uint8_t deltaFieldCount,
+											 uint16_t *pThingIndex) {
+	ShadowGatewayThing_t *pThing;
+	size_t nameLen;
+	uint32_t bucket;
+
+	FUNC_ENTRY;
+
+	if(NULL == pGateway || NULL == pThingName || NULL == pThingIndex
+	   || (NULL == pDeltaFields && 0 != deltaFieldCount)) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	nameLen = strlen(pThingName);
+	if(0 == nameLen || nameLen >= MAX_SIZE_OF_THING_NAME) {
+		FUNC_EXIT_RC(MAX_SIZE_ERROR);
+	}
+
+	if(0 <= _aws_iot_shadow_gateway_lookup(pGateway, pThingName, nameLen)) {
+		FUNC_EXIT_RC(FAILURE);
+	}
+
+	if(pGateway->thingCount >= pGateway->maxThings || nameLen + 1 > (size_t) (pGateway->namesSize - pGateway->namesUsed)) {
+		FUNC_EXIT_RC(LIMIT_EXCEEDED_ERROR);
+	}
+
+	pThing = &pGateway->pThings[pGateway->thingCount];
+	pThing->pDeltaFields = pDeltaFields;
+	pThing->deltaFieldCount = deltaFieldCount;
+	pThing->nameHash = _aws_iot_shadow_gateway_hash(pThingName, nameLen);
+	pThing->nameLen = (uint8_t) nameLen;
+	pThing->nameOffset = pGateway->namesUsed;
+	pThing->version = 0;
+	memcpy(pGateway->pNames + pGateway->namesUsed, pThingName, nameLen + 1);
+	pGateway->namesUsed = (uint16_t) (pGateway->namesUsed + nameLen + 1);
+
+	for(bucket = pThing->nameHash & pGateway->thingBucketMask; 0 != pGateway->pThingBuckets[bucket];
+		bucket = (bucket + 1) & pGateway->thingBucketMask);
+	pGateway->pThingBuckets[bucket] = (uint16_t) (pGateway->thingCount + 1);
+
+	*pThingIndex = pGateway->thingCount;
+	pGateway->thingCount++;
+
+	FUNC_EXIT_RC(SUCCESS);
+}
+
+IoT_Error_t aws_iot_shadow_gateway_find_thing(const ShadowGateway_t *pGateway, const char *pThingName,
+											  uint16_t *pThingIndex) {
+	int32_t index;
+
+	if(NULL == pGateway || NULL == pThingName || NULL == pThingIndex) {
+		return NULL_VALUE_ERROR;
+	}
+
+	index = _aws_iot_shadow_gateway_lookup(pGateway, pThingName, strlen(pThingName));
+	if(0 > index) {
+		return FAILURE;
+	}
+
+	*pThingIndex = (uint16_t) index;
+
+	return SUCCESS;
+}
+
+const char *aws_iot_shadow_gateway_get_thing_name(const ShadowGateway_t *pGateway, uint16_t thingIndex) {
+	if(NULL == pGateway || thingIndex >= pGateway->thingCount) {
+		return NULL;
+	}
+
+	return pGateway->pNames + pGateway->pThings[thingIndex].nameOffset;
+}
+
+uint32_t aws_iot_shadow_gateway_get_version(const ShadowGateway_t *pGateway, uint16_t thingIndex) {
+	if(NULL == pGateway || thingIndex >= pGateway->thingCount) {
+		return 0;
+	}
+
+	return pGateway->pThings[thingIndex].version;
+}
+
+/* Finds the thing of a topic of the form $aws/things/<thing>/shadow/..., and where the part after shadow/ starts */
+static ShadowGatewayThing_t *_aws_iot_shadow_gateway_thing_of_topic(ShadowGateway_t *pGateway, const char *pTopic,
+																	uint16_t topicLen, const char **ppSuffix,
+																	uint16_t *pSuffixLen) {
+	const char *pName = pTopic + SHADOW_GATEWAY_TOPIC_PREFIX_LEN;
+	const char *pEnd;
+	int32_t index;
+
+	if(topicLen <= SHADOW_GATEWAY_TOPIC_PREFIX_LEN + sizeof("/shadow/") - 1) {
+		return NULL;
+	}
+
+	pEnd = (const char *) memchr(pName, '/', topicLen - SHADOW_GATEWAY_TOPIC_PREFIX_LEN);
+	if(NULL == pEnd || (uint16_t) (pTopic + topicLen - pEnd) < sizeof("/shadow/") - 1
+	   || 0 != strncmp(pEnd, "/shadow/", sizeof("/shadow/") - 1)) {
+		return NULL;
+	}
+
+	index = _aws_iot_shadow_gateway_lookup(pGateway, pName, (size_t) (pEnd - pName));
+	if(0 > index) {
+		return NULL;
+	}
+
+	*ppSuffix = pEnd + sizeof("/shadow/") - 1;
+	*pSuffixLen = (uint16_t) (pTopic + topicLen - *ppSuffix);
+
+	return &pGateway->pThings[index];
+}
+
+/* Copies a received document into the rx buffer and parses it */
+static bool _aws_iot_shadow_gateway_parse(ShadowGateway_t *pGateway, const IoT_Publish_Message_Params *params,
+										  int32_t *pTokenCount) {
+	if(params->payloadLen >= pGateway->rxBufferSize) {
+		IOT_WARN("Payload larger than RX Buffer");
+		return false;
+	}
+
+	memcpy(pGateway->pRxBuffer, params->payload, params->payloadLen);
+	pGateway->pRxBuffer[params->payloadLen] = '\0';    // jsmn_parse relies on a string
+
+	if(!isJsonValidAndParse(pGateway->pRxBuffer, pGateway->rxBufferSize, NULL, pTokenCount)) {
+		IOT_WARN("Received JSON is not valid");
+		return false;
+	}
+
+	return true;
+}
+
+static void _aws_iot_shadow_gateway_release_ack(ShadowGateway_t *pGateway, ShadowGatewayAck_t *pAck) {
+	pAck->isInUse = false;
+	pGateway->ackCount--;
+}
+
+/* The slot of a client token, NULL if the token was not issued by this gateway or nothing waits on it */
+static ShadowGatewayAck_t *_aws_iot_shadow_gateway_ack_of_token(ShadowGateway_t *pGateway, const char *pToken) {
+	ShadowGatewayAck_t *pAck;
+	const char *pDigits;
+	uint32_t sequence = 0;
+
+	if(0 != strncmp(pToken, pGateway->pClientTokenPrefix, pGateway->clientTokenPrefixLen)
+	   || '-' != pToken[pGateway->clientTokenPrefixLen]) {
+		return NULL;
+	}
+
+	pDigits = pToken + pGateway->clientTokenPrefixLen + 1;
+	if('\0' == *pDigits) {
+		return NULL;
+	}
+	for(; '\0' != *pDigits; pDigits++) {
+		if(*pDigits < '0' || *pDigits > '9') {
+			return NULL;
+		}
+		sequence = sequence * 10 + (uint32_t) (*pDigits - '0');
+	}
+
+	pAck = &pGateway->pAcks[sequence % pGateway->maxAcks];
+	if(!pAck->isInUse || pAck->sequence != sequence) {
+		return NULL;
+	}
+
+	return pAck;
+}
+
+static void _aws_iot_shadow_gateway_ack_callback(AWS_IoT_Client *pClient, char *topicName, uint16_t topicNameLen,
+												 IoT_Publish_Message_Params *params, void *pData) {
+	ShadowGateway_t *pGateway = (ShadowGateway_t *) pData;
+	ShadowGatewayThing_t *pThing;
+	ShadowGatewayAck_t *pAck;
+	Shadow_Ack_Status_t status;
+	const char *pSuffix;
+	uint16_t suffixLen;
+	int32_t tokenCount;
+	uint32_t version;
+	char clientToken[MAX_SIZE_CLIENT_ID_WITH_SEQUENCE];
+
+	IOT_UNUSED(pClient);
+
+	pThing = _aws_iot_shadow_gateway_thing_of_topic(pGateway, topicName, topicNameLen, &pSuffix, &suffixLen);
+	if(NULL == pThing || !_aws_iot_shadow_gateway_parse(pGateway, params, &tokenCount)) {
+		return;
+	}
+
+	status = (suffixLen > sizeof("accepted") && 0 == strncmp(pSuffix + suffixLen - (sizeof("accepted") - 1),
+															 "accepted", sizeof("accepted") - 1))
+			 ? SHADOW_ACK_ACCEPTED : SHADOW_ACK_REJECTED;
+
+	if(SHADOW_ACK_ACCEPTED == status && 0 == strncmp(pSuffix, "get/", sizeof("get/") - 1)
+	   && extractVersionNumber(pGateway->pRxBuffer, NULL, tokenCount, &version) && version > pThing->version) {
+		pThing->version = version;
+	}
+
+	if(0 == pGateway->ackCount
+	   || !extractClientToken(pGateway->pRxBuffer, params->payloadLen, clientToken, sizeof(clientToken))) {
+		return;
+	}
+
+	pAck = _aws_iot_shadow_gateway_ack_of_token(pGateway, clientToken);
+	if(NULL == pAck || &pGateway->pThings[pAck->thingIndex] != pThing) {
+		return;
+	}
+
+	_aws_iot_shadow_gateway_release_ack(pGateway, pAck);
+	pAck->callback(pGateway->pNames + pThing->nameOffset, (ShadowActions_t) pAck->action, status,
+				   pGateway->pRxBuffer, pAck->pCallbackContext);
+}
+
+/* Runs the callbacks of the delta fields of one thing matching a key of the delta */
+static void _aws_iot_shadow_gateway_dispatch_key(const char *pJsonDocument, const char *pKey, uint32_t keyLen,
+												 int32_t valueIndex, void *pContext) {
+	ShadowGatewayThing_t *pThing = (ShadowGatewayThing_t *) pContext;
+	jsonStruct_t *pField;
+	int32_t dataPosition;
+	uint32_t dataLength;
+	uint8_t i;
+
+	for(i = 0; i < pThing->deltaFieldCount; i++) {
+		pField = &pThing->pDeltaFields[i];
+		if(0 != strncmp(pField->pKey, pKey, keyLen) || '\0' != pField->pKey[keyLen]) {
+			continue;
+		}
+
+		updateValueOfJsonToken(pJsonDocument, NULL, valueIndex, pField, &dataLength, &dataPosition);
+		if(NULL != pField->cb) {
+			pField->cb(pJsonDocument + dataPosition, dataLength, pField);
+		}
+	}
+}
+
+static void _aws_iot_shadow_gateway_delta_callback(AWS_IoT_Client *pClient, char *topicName, uint16_t topicNameLen,
+												   IoT_Publish_Message_Params *params, void *pData) {
+	ShadowGateway_t *pGateway = (ShadowGateway_t *) pData;
+	ShadowGatewayThing_t *pThing;
+	const char *pSuffix;
+	uint16_t suffixLen;
+	int32_t tokenCount;
+	uint32_t version;
+
+	IOT_UNUSED(pClient);
+
+	pThing = _aws_iot_shadow_gateway_thing_of_topic(pGateway, topicName, topicNameLen, &pSuffix, &suffixLen);
+	if(NULL == pThing || 0 == pThing->deltaFieldCount || !_aws_iot_shadow_gateway_parse(pGateway, params, &tokenCount)) {
+		return;
+	}
+
+	if(extractVersionNumber(pGateway->pRxBuffer, NULL, tokenCount, &version)) {
+		if(version > pThing->version) {
+			pThing->version = version;
+		} else if(pGateway->isDiscardOldDeltaEnabled) {
+			IOT_WARN("Old Delta Message received - Ignoring rx: %u local: %u", (unsigned) version,
+					 (unsigned) pThing->version);
+			return;
+		}
+	}
+
+	visitJsonStateKeys(pGateway->pRxBuffer, NULL, tokenCount, _aws_iot_shadow_gateway_dispatch_key, pThing);
+}
+
+IoT_Error_t aws_iot_shadow_gateway_subscribe(ShadowGateway_t *pGateway) {
+	IoT_Error_t rc;
+
+	FUNC_ENTRY;
+
+	if(NULL == pGateway) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	rc = aws_iot_mqtt_subscribe(pGateway->pClient, shadowGatewayDeltaFilter,
+								(uint16_t) (sizeof(shadowGatewayDeltaFilter) - 1), QOS0,
+								_aws_iot_shadow_gateway_delta_callback, pGateway);
+	if(SUCCESS == rc) {
+		rc = aws_iot_mqtt_subscribe(pGateway->pClient, shadowGatewayAcceptedFilter,
+									(uint16_t) (sizeof(shadowGatewayAcceptedFilter) - 1), QOS0,
+									_aws_iot_shadow_gateway_ack_callback, pGateway);
+	}
+	if(SUCCESS == rc) {
+		rc = aws_iot_mqtt_subscribe(pGateway->pClient, shadowGatewayRejectedFilter,
+									(uint16_t) (sizeof(shadowGatewayRejectedFilter) - 1), QOS0,
+									_aws_iot_shadow_gateway_ack_callback, pGateway);
+	}
+
+	FUNC_EXIT_RC(rc);
+}
+
+/* Offset of the closing brace of a JSON object, and whether the object has members */
+static bool _aws_iot_shadow_gateway_find_close(const char *pJsonDocument, size_t *pCloseOffset, bool *pHasMembers) {
+	size_t i = strlen(pJsonDocument);
+
+	while(0 < i && (' ' == pJsonDocument[i - 1] || '\n' == pJsonDocument[i - 1] || '\r' == pJsonDocument[i - 1]
+					|| '\t' == pJsonDocument[i - 1])) {
+		i--;
+	}
+	if(2 > i || '{' != pJsonDocument[0] || '}' != pJsonDocument[i - 1]) {
+		return false;
+	}
+
+	*pCloseOffset = i - 1;
+	for(i = *pCloseOffset; 0 < i && (' ' == pJsonDocument[i - 1] || '\n' == pJsonDocument[i - 1]
+									  || '\r' == pJsonDocument[i - 1] || '\t' == pJsonDocument[i - 1]); i--);
+	*pHasMembers = (1 != i);
+
+	return true;
+}
+
+static IoT_Error_t _aws_iot_shadow_gateway_action(ShadowGateway_t *pGateway, uint16_t thingIndex,
+												  ShadowActions_t action, const char *pJsonDocument,
+												  fpActionCallback_t callback, void *pContextData,
+												  uint8_t timeout_seconds) {
+	const ShadowGatewayThing_t *pThing;
+	ShadowGatewayAck_t *pAck = NULL;
+	IoT_Publish_Message_Params msgParams;
+	IoT_Iovec payload[2];
+	IoT_Error_t rc;
+	uint32_t sequence;
+	size_t closeOffset;
+	bool hasMembers;
+	int32_t len;
+	char topic[MAX_SHADOW_TOPIC_LENGTH_BYTES];
+	char tokenMember[MAX_SIZE_CLIENT_TOKEN_CLIENT_SEQUENCE + 2];
+
+	FUNC_ENTRY;
+
+	if(NULL == pGateway || NULL == pJsonDocument) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	if(thingIndex >= pGateway->thingCount) {
+		FUNC_EXIT_RC(FAILURE);
+	}
+
+	if(!_aws_iot_shadow_gateway_find_close(pJsonDocument, &closeOffset, &hasMembers)) {
+		FUNC_EXIT_RC(SHADOW_JSON_ERROR);
+	}
+
+	pThing = &pGateway->pThings[thingIndex];
+	len = snprintf(topic, sizeof(topic), SHADOW_GATEWAY_TOPIC_PREFIX "%s/shadow/%s",
+				   pGateway->pNames + pThing->nameOffset,
+				   (SHADOW_GET == action) ? "get" : ((SHADOW_DELETE == action) ? "delete" : "update"));
+	if(0 > len || (size_t) len >= sizeof(topic)) {
+		FUNC_EXIT_RC(MAX_SIZE_ERROR);
+	}
+
+	msgParams.qos = QOS0;
+	msgParams.isRetained = 0;
+	msgParams.isDup = 0;
+	msgParams.id = 0;
+	msgParams.payload = (void *) pJsonDocument;
+	msgParams.payloadLen = closeOffset + 1;
+
+	if(NULL == callback) {
+		rc = aws_iot_mqtt_publish(pGateway->pClient, topic, (uint16_t) len, &msgParams);
+		FUNC_EXIT_RC(rc);
+	}
+
+	if(pGateway->ackCount >= pGateway->maxAcks) {
+		FUNC_EXIT_RC(LIMIT_EXCEEDED_ERROR);
+	}
+
+	// skip sequence numbers whose slot is still waiting, at most maxAcks - 1 of them
+	for(sequence = pGateway->nextSequence; pGateway->pAcks[sequence % pGateway->maxAcks].isInUse; sequence++);
+
+	snprintf(tokenMember, sizeof(tokenMember), "%s\"" SHADOW_CLIENT_TOKEN_STRING "\":\"%s-%u\"}",
+			 hasMembers ? ", " : "", pGateway->pClientTokenPrefix, (unsigned) sequence);
+
+	// the document goes out as it is, followed by the client token in place of its closing brace
+	payload[0].pBuffer = (const unsigned char *) pJsonDocument;
+	payload[0].len = closeOffset;
+	payload[1].pBuffer = (const unsigned char *) tokenMember;
+	payload[1].len = strlen(tokenMember);
+	rc = aws_iot_mqtt_publish_vector(pGateway->pClient, topic, (uint16_t) len, &msgParams, payload, 2);
+	if(SUCCESS != rc) {
+		FUNC_EXIT_RC(rc);
+	}
+
+	pAck = &pGateway->pAcks[sequence % pGateway->maxAcks];
+	pAck->callback = callback;
+	pAck->pCallbackContext = pContextData;
+	pAck->sequence = sequence;
+	pAck->thingIndex = thingIndex;
+	pAck->action = (uint8_t) action;
+	pAck->isInUse = true;
+	init_timer(&pAck->timer);
+	countdown_sec(&pAck->timer, timeout_seconds);
+	pGateway->ackCount++;
+	pGateway->nextSequence = sequence + 1;
+
+	FUNC_EXIT_RC(SUCCESS);
+}
+
+IoT_Error_t aws_iot_shadow_gateway_update(ShadowGateway_t *pGateway, uint16_t thingIndex, const char *pJsonDocument,
+										  fpActionCallback_t callback, void *pContextData, uint8_t timeout_seconds) {
+	return _aws_iot_shadow_gateway_action(pGateway, thingIndex, SHADOW_UPDATE, pJsonDocument, callback, pContextData,
+										  timeout_seconds);
+}
+
+IoT_Error_t aws_iot_shadow_gateway_get(ShadowGateway_t *pGateway, uint16_t thingIndex, fpActionCallback_t callback,
+									   void *pContextData, uint8_t timeout_seconds) {
+	if(NULL == callback) {
+		return NULL_VALUE_ERROR;
+	}
+
+	return _aws_iot_shadow_gateway_action(pGateway, thingIndex, SHADOW_GET, "{}", callback, pContextData,
+										  timeout_seconds);
+}
+
+IoT_Error_t aws_iot_shadow_gateway_delete(ShadowGateway_t *pGateway, uint16_t thingIndex, fpActionCallback_t callback,
+										  void *pContextData, uint8_t timeout_seconds) {
+	return _aws_iot_shadow_gateway_action(pGateway, thingIndex, SHADOW_DELETE, "{}", callback, pContextData,
+										  timeout_seconds);
+}
+
+IoT_Error_t aws_iot_shadow_gateway_yield(ShadowGateway_t *pGateway, uint32_t timeout_ms) {
+	ShadowGatewayAck_t *pAck;
+	uint8_t i;
+
+	if(NULL == pGateway) {
+		return NULL_VALUE_ERROR;
+	}
+
+	for(i = 0; i < pGateway->maxAcks && 0 < pGateway->ackCount; i++) {
+		pAck = &pGateway->pAcks[i];
+		if(pAck->isInUse && has_timer_expired(&pAck->timer)) {
+			_aws_iot_shadow_gateway_release_ack(pGateway, pAck);
+			pAck->callback(pGateway->pNames + pGateway->pThings[pAck->thingIndex].nameOffset,
+						   (ShadowActions_t) pAck->action, SHADOW_ACK_TIMEOUT, "", pAck->pCallbackContext);
+		}
+	}
+
+	return aws_iot_mqtt_yield(pGateway->pClient, timeout_ms);
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -36,9 +36,10 @@ extern char mqttClientID[MAX_SIZE_OF_UNIQUE_CLIENT_ID_BYTES];
 #define AWS_IOT_SHADOW_CLIENT_TOKEN_KEY "{\"clientToken\":\""
 static uint32_t clientTokenNum = 0;
 
-//helper functions
-static IoT_Error_t convertDataToString(char *pStringBuffer, size_t maxSizoStringBuffer, JsonPrimitiveType type,
-									   void *pData);
+/* Room for the digits and the sign of any integer the writer formats */
+#define SHADOW_JSON_MAX_NUMBER_TEXT 22
+/* Doubles at or above this magnitude are formatted with snprintf, value * 10^6 must fit a uint64_t */
+#define SHADOW_JSON_FAST_DOUBLE_LIMIT 1e13
 
 void resetClientTokenSequenceNum(void) {
 	clientTokenNum = 0;
@@ -125,252 +126,548 @@ IoT_Error_t aws_iot_shadow_init_json_document(char *pJsonDocument, size_t maxSiz
 
 }
 
-IoT_Error_t aws_iot_shadow_add_desired(char *pJsonDocument, size_t maxSizeOfJsonDocument, uint8_t count, ...) {
-	IoT_Error_t ret_val = SUCCESS;
-	size_t tempSize = 0;
-	int8_t i;
-	size_t remSizeOfJsonBuffer = maxSizeOfJsonDocument;
-	int32_t snPrintfReturn = 0;
-	va_list pArgs;
-	jsonStruct_t *pTemporary = NULL;
-	va_start(pArgs, count);
+/* Keeps the first error, later calls on the writer become no-ops */
+static IoT_Error_t writerFail(ShadowJsonWriter_t *pWriter, IoT_Error_t error) {
+	if(pWriter->error == SUCCESS) {
+		pWriter->error = error;
+	}
+	return pWriter->error;
+}
 
-	if(pJsonDocument == NULL) {
-		va_end(pArgs);
-		return NULL_VALUE_ERROR;
+static void writerAppend(ShadowJsonWriter_t *pWriter, const char *pData, size_t length) {
+	size_t space;
+
+	if(pWriter->error != SUCCESS) {
+		return;
 	}
 
-	tempSize = maxSizeOfJsonDocument - strlen(pJsonDocument);
-	if(tempSize <= 1) {
-		va_end(pArgs);
-		return SHADOW_JSON_ERROR;
+	space = pWriter->bufferSize - pWriter->offset;
+	if(length >= space) {
+		// Keep what fits, the same way snprintf truncates
+		length = space - 1;
+		pWriter->error = SHADOW_JSON_BUFFER_TRUNCATED;
+	}
+	memcpy(pWriter->pBuffer + pWriter->offset, pData, length);
+	pWriter->offset += length;
+	pWriter->pBuffer[pWriter->offset] = '\0';
+}
+
+#define WRITER_APPEND_LITERAL(pWriter, literal) writerAppend((pWriter), (literal), sizeof(literal) - 1)
+
+/* Writes the digits of value backwards from pEnd and returns how many were written */
+static size_t formatUnsigned(char *pEnd, uint64_t value) {
+	char *pDigit = pEnd;
+	uint32_t lowValue;
+
+	// 64 bit division is done in software on 32 bit targets, only use it for the top digits
+	while(value > UINT32_MAX) {
+		*--pDigit = (char) ('0' + (value % 10));
+		value /= 10;
+	}
+	lowValue = (uint32_t) value;
+	do {
+		*--pDigit = (char) ('0' + (lowValue % 10));
+		lowValue /= 10;
+	} while(lowValue != 0);
+
+	return (size_t) (pEnd - pDigit);
+}
+
+static void writerAppendInteger(ShadowJsonWriter_t *pWriter, uint32_t magnitude, bool isNegative) {
+	char text[SHADOW_JSON_MAX_NUMBER_TEXT];
+	char *pEnd = text + sizeof(text);
+	size_t length = formatUnsigned(pEnd, magnitude);
+
+	if(isNegative) {
+		length++;
+		*(pEnd - length) = '-';
 	}
-	remSizeOfJsonBuffer = tempSize;
+	writerAppend(pWriter, pEnd - length, length);
+}
+
+static void writerAppendSigned(ShadowJsonWriter_t *pWriter, int32_t value) {
+	if(value < 0) {
+		writerAppendInteger(pWriter, (uint32_t) 0 - (uint32_t) value, true);
+	} else {
+		writerAppendInteger(pWriter, (uint32_t) value, false);
+	}
+}
 
-	snPrintfReturn = snprintf(pJsonDocument + strlen(pJsonDocument), remSizeOfJsonBuffer, "\"desired\":{");
-	ret_val = checkReturnValueOfSnPrintf(snPrintfReturn, remSizeOfJsonBuffer);
+static void writerAppendDoubleWithSnPrintf(ShadowJsonWriter_t *pWriter, double value) {
+	size_t space;
+	int32_t snPrintfReturn;
+	IoT_Error_t ret_val;
+
+	if(pWriter->error != SUCCESS) {
+		return;
+	}
 
+	space = pWriter->bufferSize - pWriter->offset;
+	snPrintfReturn = snprintf(pWriter->pBuffer + pWriter->offset, space, "%f", value);
+	ret_val = checkReturnValueOfSnPrintf(snPrintfReturn, space);
 	if(ret_val != SUCCESS) {
-		va_end(pArgs);
-		return ret_val;
+		writerFail(pWriter, ret_val);
+		pWriter->offset += strlen(pWriter->pBuffer + pWriter->offset);
+		return;
 	}
+	pWriter->offset += (size_t) snPrintfReturn;
+}
 
-	for(i = 0; i < count; i++) {
-		tempSize = maxSizeOfJsonDocument - strlen(pJsonDocument);
-		if(tempSize <= 1) {
-			va_end(pArgs);
-			return SHADOW_JSON_ERROR;
-		}
-		remSizeOfJsonBuffer = tempSize;
-		pTemporary = va_arg (pArgs, jsonStruct_t *);
-		if(pTemporary != NULL) {
-			snPrintfReturn = snprintf(pJsonDocument + strlen(pJsonDocument), remSizeOfJsonBuffer, "\"%s\":",
-									  pTemporary->pKey);
-			ret_val = checkReturnValueOfSnPrintf(snPrintfReturn, remSizeOfJsonBuffer);
-			if(ret_val != SUCCESS) {
-				va_end(pArgs);
-				return ret_val;
-			}
-			if(pTemporary->pKey != NULL && pTemporary->pData != NULL) {
-				ret_val = convertDataToString(pJsonDocument + strlen(pJsonDocument), remSizeOfJsonBuffer,
-											  pTemporary->type, pTemporary->pData);
-			} else {
-				va_end(pArgs);
-				return NULL_VALUE_ERROR;
-			}
-			if(ret_val != SUCCESS) {
-				va_end(pArgs);
-				return ret_val;
-			}
+/**
+ * Formats value with six decimals, exactly as "%f" does, without going through printf.
+ *
+ * value * 10^6 is computed exactly as mantissa * 15625 * 2^(exponent + 6), a product of at most 67 bits,
+ * and then rounded to an integer half to even like the C library does. Values of 10^13 and above, NaN and
+ * infinities are left to snprintf.
+ */
+static void writerAppendDouble(ShadowJsonWriter_t *pWriter, double value) {
+	char text[SHADOW_JSON_MAX_NUMBER_TEXT + 8];
+	char *pEnd = text + sizeof(text);
+	char *pText;
+	uint64_t bits, mantissa, partLow, partHigh, productLow, productHigh, scaled;
+	uint64_t remainderLow, remainderHigh, halfLow, halfHigh;
+	uint32_t exponentBits, shift, fraction, i;
+	bool isNegative, isAboveHalf, isHalf;
+
+	memcpy(&bits, &value, sizeof(bits));
+	isNegative = (bits >> 63) != 0;
+	exponentBits = (uint32_t) ((bits >> 52) & 0x7FF);
+	mantissa = bits & 0xFFFFFFFFFFFFFULL;
+
+	if(exponentBits == 0x7FF || value >= SHADOW_JSON_FAST_DOUBLE_LIMIT || value <= -SHADOW_JSON_FAST_DOUBLE_LIMIT) {
+		writerAppendDoubleWithSnPrintf(pWriter, value);
+		return;
+	}
+
+	// value * 10^6 = mantissa * 15625 >> shift, shift is at least 3 below the limit
+	if(exponentBits == 0) {
+		shift = 1074 - 6;
+	} else {
+		mantissa |= 1ULL << 52;
+		shift = 1075 - 6 - exponentBits;
+	}
+
+	if(shift >= 68) {
+		// The product is below 2^67, so half of 2^shift is never reached
+		scaled = 0;
+	} else {
+		partLow = (mantissa & 0xFFFFFFFFULL) * 15625;
+		partHigh = (mantissa >> 32) * 15625;
+		productLow = partLow + (partHigh << 32);
+		productHigh = (partHigh >> 32) + (productLow < partLow ? 1 : 0);
+
+		if(shift < 64) {
+			scaled = (productHigh << (64 - shift)) | (productLow >> shift);
+			remainderHigh = 0;
+			remainderLow = productLow & ((1ULL << shift) - 1);
+			halfHigh = 0;
+			halfLow = 1ULL << (shift - 1);
 		} else {
-			va_end(pArgs);
-			return NULL_VALUE_ERROR;
+			scaled = productHigh >> (shift - 64);
+			remainderHigh = productHigh & ((1ULL << (shift - 64)) - 1);
+			remainderLow = productLow;
+			halfHigh = (shift == 64) ? 0 : 1ULL << (shift - 65);
+			halfLow = (shift == 64) ? 1ULL << 63 : 0;
+		}
+
+		isAboveHalf = remainderHigh > halfHigh || (remainderHigh == halfHigh && remainderLow > halfLow);
+		isHalf = remainderHigh == halfHigh && remainderLow == halfLow;
+		if(isAboveHalf || (isHalf && (scaled & 1) != 0)) {
+			scaled++;
 		}
 	}
 
-	va_end(pArgs);
-	snPrintfReturn = snprintf(pJsonDocument + strlen(pJsonDocument) - 1, remSizeOfJsonBuffer, "},");
-	ret_val = checkReturnValueOfSnPrintf(snPrintfReturn, remSizeOfJsonBuffer);
-	return ret_val;
+	pText = pEnd;
+	fraction = (uint32_t) (scaled % 1000000);
+	for(i = 0; i < 6; i++) {
+		*--pText = (char) ('0' + (fraction % 10));
+		fraction /= 10;
+	}
+	*--pText = '.';
+	pText -= formatUnsigned(pText, scaled / 1000000);
+	if(isNegative) {
+		*--pText = '-';
+	}
+	writerAppend(pWriter, pText, (size_t) (pEnd - pText));
 }
 
-IoT_Error_t aws_iot_shadow_add_reported(char *pJsonDocument, size_t maxSizeOfJsonDocument, uint8_t count, ...) {
-	IoT_Error_t ret_val = SUCCESS;
+static void writerAppendValue(ShadowJsonWriter_t *pWriter, JsonPrimitiveType type, const void *pData) {
+	switch(type) {
+		case SHADOW_JSON_INT32:
+			writerAppendSigned(pWriter, *(const int32_t *) pData);
+			break;
+		case SHADOW_JSON_INT16:
+			writerAppendSigned(pWriter, *(const int16_t *) pData);
+			break;
+		case SHADOW_JSON_INT8:
+			writerAppendSigned(pWriter, *(const int8_t *) pData);
+			break;
+		case SHADOW_JSON_UINT32:
+			writerAppendInteger(pWriter, *(const uint32_t *) pData, false);
+			break;
+		case SHADOW_JSON_UINT16:
+			writerAppendInteger(pWriter, *(const uint16_t *) pData, false);
+			break;
+		case SHADOW_JSON_UINT8:
+			writerAppendInteger(pWriter, *(const uint8_t *) pData, false);
+			break;
+		case SHADOW_JSON_DOUBLE:
+			writerAppendDouble(pWriter, *(const double *) pData);
+			break;
+		case SHADOW_JSON_FLOAT:
+			writerAppendDouble(pWriter, *(const float *) pData);
+			break;
+		case SHADOW_JSON_BOOL:
+			if(*(const bool *) pData) {
+				WRITER_APPEND_LITERAL(pWriter, "true");
+			} else {
+				WRITER_APPEND_LITERAL(pWriter, "false");
+			}
+			break;
+		case SHADOW_JSON_STRING:
+			WRITER_APPEND_LITERAL(pWriter, "\"");
+			writerAppend(pWriter, (const char *) pData, strlen((const char *) pData));
+			WRITER_APPEND_LITERAL(pWriter, "\"");
+			break;
+		case SHADOW_JSON_OBJECT:
+			writerAppend(pWriter, (const char *) pData, strlen((const char *) pData));
+			break;
+		default:
+			writerFail(pWriter, SHADOW_JSON_ERROR);
+			break;
+	}
+}
 
-	int8_t i;
-	size_t remSizeOfJsonBuffer = maxSizeOfJsonDocument;
-	int32_t snPrintfReturn = 0;
-	size_t tempSize = 0;
-	jsonStruct_t *pTemporary;
-	va_list pArgs;
-	va_start(pArgs, count);
+/* Writes the separator and the key that go in front of a new member of the innermost container */
+static void writerBeginMember(ShadowJsonWriter_t *pWriter, const char *pKey) {
+	uint32_t containerBit;
 
-	if(pJsonDocument == NULL) {
-		va_end(pArgs);
-		return NULL_VALUE_ERROR;
+	if(pWriter->error != SUCCESS) {
+		return;
 	}
 
+	// At depth 0 a member is written into a document built by someone else, no separator is needed
+	if(pWriter->depth > 0) {
+		containerBit = 1UL << (pWriter->depth - 1);
+		if(((pWriter->isArray & containerBit) != 0) != (pKey == NULL)) {
+			writerFail(pWriter, SHADOW_JSON_ERROR);
+			return;
+		}
+		if((pWriter->hasMembers & containerBit) != 0) {
+			WRITER_APPEND_LITERAL(pWriter, ",");
+		}
+		pWriter->hasMembers |= containerBit;
+	}
 
-	tempSize = maxSizeOfJsonDocument - strlen(pJsonDocument);
-	if(tempSize <= 1) {
-		va_end(pArgs);
-		return SHADOW_JSON_ERROR;
+	if(pKey != NULL) {
+		WRITER_APPEND_LITERAL(pWriter, "\"");
+		writerAppend(pWriter, pKey, strlen(pKey));
+		WRITER_APPEND_LITERAL(pWriter, "\":");
 	}
-	remSizeOfJsonBuffer = tempSize;
+}
 
-	snPrintfReturn = snprintf(pJsonDocument + strlen(pJsonDocument), remSizeOfJsonBuffer, "\"reported\":{");
-	ret_val = checkReturnValueOfSnPrintf(snPrintfReturn, remSizeOfJsonBuffer);
+static IoT_Error_t writerOpen(ShadowJsonWriter_t *pWriter, const char *pKey, bool isArray) {
+	uint32_t containerBit;
 
-	if(ret_val != SUCCESS) {
-		va_end(pArgs);
-		return ret_val;
+	if(pWriter == NULL) {
+		return NULL_VALUE_ERROR;
+	}
+	if(pWriter->depth >= SHADOW_JSON_WRITER_MAX_DEPTH) {
+		return writerFail(pWriter, SHADOW_JSON_ERROR);
 	}
 
-	for(i = 0; i < count; i++) {
-		tempSize = maxSizeOfJsonDocument - strlen(pJsonDocument);
-		if(tempSize <= 1) {
-			va_end(pArgs);
-			return SHADOW_JSON_ERROR;
-		}
-		remSizeOfJsonBuffer = tempSize;
-
-		pTemporary = va_arg (pArgs, jsonStruct_t *);
-		if(pTemporary != NULL) {
-			snPrintfReturn = snprintf(pJsonDocument + strlen(pJsonDocument), remSizeOfJsonBuffer, "\"%s\":",
-									  pTemporary->pKey);
-			ret_val = checkReturnValueOfSnPrintf(snPrintfReturn, remSizeOfJsonBuffer);
-			if(ret_val != SUCCESS) {
-				va_end(pArgs);
-				return ret_val;
-			}
-			if(pTemporary->pKey != NULL && pTemporary->pData != NULL) {
-				ret_val = convertDataToString(pJsonDocument + strlen(pJsonDocument), remSizeOfJsonBuffer,
-											  pTemporary->type, pTemporary->pData);
-			} else {
-				va_end(pArgs);
-				return NULL_VALUE_ERROR;
-			}
-			if(ret_val != SUCCESS) {
-				va_end(pArgs);
-				return ret_val;
-			}
+	writerBeginMember(pWriter, pKey);
+	writerAppend(pWriter, isArray ? "[" : "{", 1);
+	if(pWriter->error == SUCCESS) {
+		containerBit = 1UL << pWriter->depth;
+		pWriter->depth++;
+		pWriter->hasMembers &= ~containerBit;
+		if(isArray) {
+			pWriter->isArray |= containerBit;
 		} else {
-			va_end(pArgs);
-			return NULL_VALUE_ERROR;
+			pWriter->isArray &= ~containerBit;
 		}
 	}
+	return pWriter->error;
+}
 
-	va_end(pArgs);
-	snPrintfReturn = snprintf(pJsonDocument + strlen(pJsonDocument) - 1, remSizeOfJsonBuffer, "},");
-	ret_val = checkReturnValueOfSnPrintf(snPrintfReturn, remSizeOfJsonBuffer);
-	return ret_val;
+static IoT_Error_t writerClose(ShadowJsonWriter_t *pWriter, bool isArray) {
+	if(pWriter == NULL) {
+		return NULL_VALUE_ERROR;
+	}
+	if(pWriter->error != SUCCESS) {
+		return pWriter->error;
+	}
+	if(pWriter->depth == 0 || ((pWriter->isArray & (1UL << (pWriter->depth - 1))) != 0) != isArray) {
+		return writerFail(pWriter, SHADOW_JSON_ERROR);
+	}
+
+	writerAppend(pWriter, isArray ? "]" : "}", 1);
+	if(pWriter->error == SUCCESS) {
+		pWriter->depth--;
+	}
+	return pWriter->error;
 }
 
+static void writerAppendClientToken(ShadowJsonWriter_t *pWriter) {
+	if(pWriter->error != SUCCESS) {
+		return;
+	}
+	writerAppend(pWriter, mqttClientID, strlen(mqttClientID));
+	WRITER_APPEND_LITERAL(pWriter, "-");
+	writerAppendSigned(pWriter, (int32_t) clientTokenNum++);
+}
 
-int32_t FillWithClientTokenSize(char *pBufferToBeUpdatedWithClientToken, size_t maxSizeOfJsonDocument) {
-	int32_t snPrintfReturn;
-	snPrintfReturn = snprintf(pBufferToBeUpdatedWithClientToken, maxSizeOfJsonDocument, "%s-%d", mqttClientID,
-				  (int) clientTokenNum++);
+/* Points a writer at the end of a document started with aws_iot_shadow_init_json_document */
+static IoT_Error_t writerResume(ShadowJsonWriter_t *pWriter, char *pJsonDocument, size_t maxSizeOfJsonDocument) {
+	pWriter->pBuffer = pJsonDocument;
+	pWriter->bufferSize = maxSizeOfJsonDocument;
+	pWriter->offset = strlen(pJsonDocument);
+	pWriter->depth = 0;
+	pWriter->hasMembers = 0;
+	pWriter->isArray = 0;
+	pWriter->error = SUCCESS;
+
+	if(pWriter->offset + 1 >= maxSizeOfJsonDocument) {
+		return SHADOW_JSON_ERROR;
+	}
+	return SUCCESS;
+}
 
-	return snPrintfReturn;
+IoT_Error_t aws_iot_shadow_json_writer_init(ShadowJsonWriter_t *pWriter, char *pBuffer, size_t bufferSize) {
+	if(pWriter == NULL || pBuffer == NULL) {
+		return NULL_VALUE_ERROR;
+	}
+	if(bufferSize == 0) {
+		return SHADOW_JSON_ERROR;
+	}
+
+	pBuffer[0] = '\0';
+	pWriter->pBuffer = pBuffer;
+	pWriter->bufferSize = bufferSize;
+	pWriter->offset = 0;
+	pWriter->depth = 0;
+	pWriter->hasMembers = 0;
+	pWriter->isArray = 0;
+	pWriter->error = SUCCESS;
+
+	return SUCCESS;
 }
 
-IoT_Error_t aws_iot_fill_with_client_token(char *pBufferToBeUpdatedWithClientToken, size_t maxSizeOfJsonDocument) {
+IoT_Error_t aws_iot_shadow_json_writer_begin_object(ShadowJsonWriter_t *pWriter, const char *pKey) {
+	return writerOpen(pWriter, pKey, false);
+}
 
-	int32_t snPrintfRet = 0;
-	snPrintfRet = FillWithClientTokenSize(pBufferToBeUpdatedWithClientToken, maxSizeOfJsonDocument);
-	return checkReturnValueOfSnPrintf(snPrintfRet, maxSizeOfJsonDocument);
+IoT_Error_t aws_iot_shadow_json_writer_end_object(ShadowJsonWriter_t *pWriter) {
+	return writerClose(pWriter, false);
+}
 
+IoT_Error_t aws_iot_shadow_json_writer_begin_array(ShadowJsonWriter_t *pWriter, const char *pKey) {
+	return writerOpen(pWriter, pKey, true);
 }
 
-IoT_Error_t aws_iot_finalize_json_document(char *pJsonDocument, size_t maxSizeOfJsonDocument) {
-	size_t remSizeOfJsonBuffer = maxSizeOfJsonDocument;
-	int32_t snPrintfReturn = 0;
-	size_t tempSize = 0;
-	IoT_Error_t ret_val = SUCCESS;
+IoT_Error_t aws_iot_shadow_json_writer_end_array(ShadowJsonWriter_t *pWriter) {
+	return writerClose(pWriter, true);
+}
 
-	if(pJsonDocument == NULL) {
+IoT_Error_t aws_iot_shadow_json_writer_add(ShadowJsonWriter_t *pWriter, const jsonStruct_t *pStruct) {
+	if(pWriter == NULL) {
 		return NULL_VALUE_ERROR;
 	}
+	if(pStruct == NULL || pStruct->pKey == NULL || pStruct->pData == NULL) {
+		return writerFail(pWriter, NULL_VALUE_ERROR);
+	}
 
-	tempSize = maxSizeOfJsonDocument - strlen(pJsonDocument);
-	if(tempSize <= 1) {
-		return SHADOW_JSON_ERROR;
+	writerBeginMember(pWriter, pStruct->pKey);
+	writerAppendValue(pWriter, pStruct->type, pStruct->pData);
+	return pWriter->error;
+}
+
+IoT_Error_t aws_iot_shadow_json_writer_add_value(ShadowJsonWriter_t *pWriter, JsonPrimitiveType type,
+												 const void *pData) {
+	if(pWriter == NULL) {
+		return NULL_VALUE_ERROR;
+	}
+	if(pData == NULL) {
+		return writerFail(pWriter, NULL_VALUE_ERROR);
+	}
+
+	writerBeginMember(pWriter, NULL);
+	writerAppendValue(pWriter, type, pData);
+	return pWriter->error;
+}
+
+static size_t sizeOfJsonPrimitive(JsonPrimitiveType type) {
+	switch(type) {
+		case SHADOW_JSON_INT32:
+		case SHADOW_JSON_UINT32:
+			return sizeof(int32_t);
+		case SHADOW_JSON_INT16:
+		case SHADOW_JSON_UINT16:
+			return sizeof(int16_t);
+		case SHADOW_JSON_INT8:
+		case SHADOW_JSON_UINT8:
+			return sizeof(int8_t);
+		case SHADOW_JSON_FLOAT:
+			return sizeof(float);
+		case SHADOW_JSON_DOUBLE:
+			return sizeof(double);
+		case SHADOW_JSON_BOOL:
+			return sizeof(bool);
+		default:
+			return 0;
 	}
-	remSizeOfJsonBuffer = tempSize;
+}
 
-	// strlen(ShadowTxBuffer) - 1 is to ensure we remove the last ,(comma) that was added
-	snPrintfReturn = snprintf(pJsonDocument + strlen(pJsonDocument) - 1, remSizeOfJsonBuffer, "}, \"%s\":\"",
-							  SHADOW_CLIENT_TOKEN_STRING);
-	ret_val = checkReturnValueOfSnPrintf(snPrintfReturn, remSizeOfJsonBuffer);
+IoT_Error_t aws_iot_shadow_json_writer_add_if_changed(ShadowJsonWriter_t *pWriter, const jsonStruct_t *pStruct,
+													  void *pLastValue) {
+	size_t valueSize;
+	bool isText;
 
-	if(ret_val != SUCCESS) {
-		return ret_val;
+	if(pWriter == NULL) {
+		return NULL_VALUE_ERROR;
 	}
-	// refactor this XXX repeated code
-	tempSize = maxSizeOfJsonDocument - strlen(pJsonDocument);
-	if(tempSize <= 1) {
-		return SHADOW_JSON_ERROR;
+	if(pStruct == NULL || pStruct->pKey == NULL || pStruct->pData == NULL || pLastValue == NULL) {
+		return writerFail(pWriter, NULL_VALUE_ERROR);
+	}
+	if(pWriter->error != SUCCESS) {
+		return pWriter->error;
 	}
-	remSizeOfJsonBuffer = tempSize;
 
+	isText = pStruct->type == SHADOW_JSON_STRING || pStruct->type == SHADOW_JSON_OBJECT;
+	valueSize = isText ? pStruct->dataLength : sizeOfJsonPrimitive(pStruct->type);
+	if(valueSize == 0) {
+		return writerFail(pWriter, SHADOW_JSON_ERROR);
+	}
 
-	snPrintfReturn = FillWithClientTokenSize(pJsonDocument + strlen(pJsonDocument), remSizeOfJsonBuffer);
-	ret_val = checkReturnValueOfSnPrintf(snPrintfReturn, remSizeOfJsonBuffer);
+	if(isText) {
+		if(strncmp((const char *) pLastValue, (const char *) pStruct->pData, valueSize) == 0) {
+			return SUCCESS;
+		}
+	} else if(memcmp(pLastValue, pStruct->pData, valueSize) == 0) {
+		return SUCCESS;
+	}
 
-	if(ret_val != SUCCESS) {
-		return ret_val;
+	aws_iot_shadow_json_writer_add(pWriter, pStruct);
+	if(pWriter->error == SUCCESS) {
+		if(isText) {
+			strncpy((char *) pLastValue, (const char *) pStruct->pData, valueSize - 1);
+			((char *) pLastValue)[valueSize - 1] = '\0';
+		} else {
+			memcpy(pLastValue, pStruct->pData, valueSize);
+		}
 	}
-	tempSize = maxSizeOfJsonDocument - strlen(pJsonDocument);
-	if(tempSize <= 1) {
+	return pWriter->error;
+}
+
+IoT_Error_t aws_iot_shadow_json_writer_finalize(ShadowJsonWriter_t *pWriter) {
+	if(pWriter == NULL) {
+		return NULL_VALUE_ERROR;
+	}
+	if(pWriter->error != SUCCESS) {
+		return pWriter->error;
+	}
+	if(pWriter->depth == 0 || (pWriter->isArray & 1) != 0) {
+		return writerFail(pWriter, SHADOW_JSON_ERROR);
+	}
+
+	while(pWriter->depth > 1 && pWriter->error == SUCCESS) {
+		writerClose(pWriter, (pWriter->isArray & (1UL << (pWriter->depth - 1))) != 0);
+	}
+	if((pWriter->hasMembers & 1) != 0) {
+		WRITER_APPEND_LITERAL(pWriter, ", ");
+	}
+	WRITER_APPEND_LITERAL(pWriter, "\"" SHADOW_CLIENT_TOKEN_STRING "\":\"");
+	writerAppendClientToken(pWriter);
+	WRITER_APPEND_LITERAL(pWriter, "\"}");
+	if(pWriter->error == SUCCESS) {
+		pWriter->depth = 0;
+	}
+	return pWriter->error;
+}
+
+/* Appends "key":{...}, to a document, the trailing comma is replaced by aws_iot_finalize_json_document */
+static IoT_Error_t addShadowSection(char *pJsonDocument, size_t maxSizeOfJsonDocument, const char *pSectionKey,
+									uint8_t count, va_list pArgs) {
+	ShadowJsonWriter_t writer;
+	uint8_t i;
+
+	if(pJsonDocument == NULL) {
+		return NULL_VALUE_ERROR;
+	}
+	if(writerResume(&writer, pJsonDocument, maxSizeOfJsonDocument) != SUCCESS) {
 		return SHADOW_JSON_ERROR;
 	}
-	remSizeOfJsonBuffer = tempSize;
 
+	aws_iot_shadow_json_writer_begin_object(&writer, pSectionKey);
+	for(i = 0; i < count && writer.error == SUCCESS; i++) {
+		if(writer.bufferSize - writer.offset <= 1) {
+			return SHADOW_JSON_ERROR;
+		}
+		aws_iot_shadow_json_writer_add(&writer, va_arg(pArgs, jsonStruct_t *));
+	}
+	aws_iot_shadow_json_writer_end_object(&writer);
+	WRITER_APPEND_LITERAL(&writer, ",");
 
-	snPrintfReturn = snprintf(pJsonDocument + strlen(pJsonDocument), remSizeOfJsonBuffer, "\"}");
-	ret_val = checkReturnValueOfSnPrintf(snPrintfReturn, remSizeOfJsonBuffer);
+	return writer.error;
+}
+
+IoT_Error_t aws_iot_shadow_add_desired(char *pJsonDocument, size_t maxSizeOfJsonDocument, uint8_t count, ...) {
+	IoT_Error_t ret_val;
+	va_list pArgs;
+
+	va_start(pArgs, count);
+	ret_val = addShadowSection(pJsonDocument, maxSizeOfJsonDocument, "desired", count, pArgs);
+	va_end(pArgs);
 
 	return ret_val;
 }
 
-static IoT_Error_t convertDataToString(char *pStringBuffer, size_t maxSizoStringBuffer, JsonPrimitiveType type,
-									   void *pData) {
-	int32_t snPrintfReturn = 0;
-	IoT_Error_t ret_val = SUCCESS;
+IoT_Error_t aws_iot_shadow_add_reported(char *pJsonDocument, size_t maxSizeOfJsonDocument, uint8_t count, ...) {
+	IoT_Error_t ret_val;
+	va_list pArgs;
+
+	va_start(pArgs, count);
+	ret_val = addShadowSection(pJsonDocument, maxSizeOfJsonDocument, "reported", count, pArgs);
+	va_end(pArgs);
+
+	return ret_val;
+}
+
+
+int32_t FillWithClientTokenSize(char *pBufferToBeUpdatedWithClientToken, size_t maxSizeOfJsonDocument) {
+	int32_t snPrintfReturn;
+	snPrintfReturn = snprintf(pBufferToBeUpdatedWithClientToken, maxSizeOfJsonDocument, "%s-%d", mqttClientID,
+				  (int) clientTokenNum++);
+
+	return snPrintfReturn;
+}
+
+IoT_Error_t aws_iot_fill_with_client_token(char *pBufferToBeUpdatedWithClientToken, size_t maxSizeOfJsonDocument) {
+
+	int32_t snPrintfRet = 0;
+	snPrintfRet = FillWithClientTokenSize(pBufferToBeUpdatedWithClientToken, maxSizeOfJsonDocument);
+	return checkReturnValueOfSnPrintf(snPrintfRet, maxSizeOfJsonDocument);
+
+}
+
+IoT_Error_t aws_iot_finalize_json_document(char *pJsonDocument, size_t maxSizeOfJsonDocument) {
+	ShadowJsonWriter_t writer;
 
-	if(maxSizoStringBuffer == 0) {
+	if(pJsonDocument == NULL) {
+		return NULL_VALUE_ERROR;
+	}
+	if(writerResume(&writer, pJsonDocument, maxSizeOfJsonDocument) != SUCCESS || writer.offset == 0) {
 		return SHADOW_JSON_ERROR;
 	}
 
-	if(type == SHADOW_JSON_INT32) {
-		snPrintfReturn = snprintf(pStringBuffer, maxSizoStringBuffer, "%i,", *(int32_t *) (pData));
-	} else if(type == SHADOW_JSON_INT16) {
-		snPrintfReturn = snprintf(pStringBuffer, maxSizoStringBuffer, "%hi,", *(int16_t *) (pData));
-	} else if(type == SHADOW_JSON_INT8) {
-		snPrintfReturn = snprintf(pStringBuffer, maxSizoStringBuffer, "%hhi,", *(int8_t *) (pData));
-	} else if(type == SHADOW_JSON_UINT32) {
-		snPrintfReturn = snprintf(pStringBuffer, maxSizoStringBuffer, "%u,", *(uint32_t *) (pData));
-	} else if(type == SHADOW_JSON_UINT16) {
-		snPrintfReturn = snprintf(pStringBuffer, maxSizoStringBuffer, "%hu,", *(uint16_t *) (pData));
-	} else if(type == SHADOW_JSON_UINT8) {
-		snPrintfReturn = snprintf(pStringBuffer, maxSizoStringBuffer, "%hhu,", *(uint8_t *) (pData));
-	} else if(type == SHADOW_JSON_DOUBLE) {
-		snPrintfReturn = snprintf(pStringBuffer, maxSizoStringBuffer, "%f,", *(double *) (pData));
-	} else if(type == SHADOW_JSON_FLOAT) {
-		snPrintfReturn = snprintf(pStringBuffer, maxSizoStringBuffer, "%f,", *(float *) (pData));
-	} else if(type == SHADOW_JSON_BOOL) {
-		snPrintfReturn = snprintf(pStringBuffer, maxSizoStringBuffer, "%s,", *(bool *) (pData) ? "true" : "false");
-	} else if(type == SHADOW_JSON_STRING) {
-		snPrintfReturn = snprintf(pStringBuffer, maxSizoStringBuffer, "\"%s\",", (char *) (pData));
-	} else if(type == SHADOW_JSON_OBJECT) {
-		snPrintfReturn = snprintf(pStringBuffer, maxSizoStringBuffer, "%s,", (char *) (pData));
-	}
-
-
-	ret_val = checkReturnValueOfSnPrintf(snPrintfReturn, maxSizoStringBuffer);
+	// offset - 1 is to ensure we remove the last ,(comma) that was added
+	writer.offset--;
+	WRITER_APPEND_LITERAL(&writer, "}, \"" SHADOW_CLIENT_TOKEN_STRING "\":\"");
+	writerAppendClientToken(&writer);
+	WRITER_APPEND_LITERAL(&writer, "\"}");
 
-	return ret_val;
+	return writer.error;
 }
 
 static jsmn_parser shadowJsonParser;
@@ -477,6 +774,82 @@ bool isJsonKeyMatchingAndUpdateValue(const char *pJsonDocument, void *pJsonHandl
 	return false;
 }
 
+/* Returns the index of the first token after the token at index and everything nested in it */
+static int32_t skipJsonToken(int32_t index, int32_t tokenCount) {
+	int32_t end = jsonTokenStruct[index].end;
+
+	index++;
+	while(index < tokenCount && jsonTokenStruct[index].start < end) {
+		index++;
+	}
+
+	return index;
+}
+
+/* Visits the keys nested in the object or array at index, skipping "metadata" objects,
+ * and returns the index of the first token after it */
+static int32_t visitJsonKeysOfToken(const char *pJsonDocument, int32_t index, int32_t tokenCount,
+									jsonKeyVisitor_t visitor, void *pContext) {
+	int32_t end = jsonTokenStruct[index].end;
+	bool isObject = (JSMN_OBJECT == jsonTokenStruct[index].type);
+	jsmntok_t *pKeyToken;
+
+	index++;
+	while(index < tokenCount && jsonTokenStruct[index].start < end) {
+		if(isObject) {
+			if(index + 1 >= tokenCount) {
+				return tokenCount;
+			}
+
+			pKeyToken = &(jsonTokenStruct[index]);
+			index++;
+			if(jsoneq(pJsonDocument, pKeyToken, "metadata") == 0) {
+				index = skipJsonToken(index, tokenCount);
+				continue;
+			}
+			visitor(pJsonDocument, pJsonDocument + pKeyToken->start, (uint32_t) (pKeyToken->end - pKeyToken->start),
+					index, pContext);
+		}
+
+		if(JSMN_OBJECT == jsonTokenStruct[index].type || JSMN_ARRAY == jsonTokenStruct[index].type) {
+			index = visitJsonKeysOfToken(pJsonDocument, index, tokenCount, visitor, pContext);
+		} else {
+			index++;
+		}
+	}
+
+	return index;
+}
+
+void visitJsonStateKeys(const char *pJsonDocument, void *pJsonHandler, int32_t tokenCount,
+						jsonKeyVisitor_t visitor, void *pContext) {
+	int32_t i;
+
+	IOT_UNUSED(pJsonHandler);
+
+	/* Walk only the top level "state" object when there is one */
+	for(i = 1; i + 1 < tokenCount; i = skipJsonToken(i + 1, tokenCount)) {
+		if(jsoneq(pJsonDocument, &(jsonTokenStruct[i]), "state") == 0
+		   && JSMN_OBJECT == jsonTokenStruct[i + 1].type) {
+			visitJsonKeysOfToken(pJsonDocument, i + 1, tokenCount, visitor, pContext);
+			return;
+		}
+	}
+
+	visitJsonKeysOfToken(pJsonDocument, 0, tokenCount, visitor, pContext);
+}
+
+void updateValueOfJsonToken(const char *pJsonDocument, void *pJsonHandler, int32_t valueIndex,
+							jsonStruct_t *pDataStruct, uint32_t *pDataLength, int32_t *pDataPosition) {
+	jsmntok_t dataToken = jsonTokenStruct[valueIndex];
+
+	IOT_UNUSED(pJsonHandler);
+
+	UpdateValueIfNoObject(pJsonDocument, pDataStruct, dataToken);
+	*pDataPosition = dataToken.start;
+	*pDataLength = (uint32_t) (dataToken.end - dataToken.start);
+}
+
 bool isReceivedJsonValid(const char *pJsonDocument, size_t jsonSize ) {
 	int32_t tokenCount;
 
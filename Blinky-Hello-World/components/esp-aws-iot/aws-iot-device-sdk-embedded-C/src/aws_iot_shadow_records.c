@@ -39,12 +39,14 @@ typedef struct {
 	ShadowActions_t action;
 	fpActionCallback_t callback;
 	void *pCallbackContext;
+	uint32_t clientTokenHash;
 	bool isFree;
 	Timer timer;
 } ToBeReceivedAckRecord_t;
 
 typedef struct {
 	const char *pKey;
+	uint32_t keyLen;
 	void *pStruct;
 	jsonStructCallback_t callback;
 	bool isFree;
@@ -63,6 +65,12 @@ typedef enum {
 
 ToBeReceivedAckRecord_t AckWaitList[MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME];
 
+/* Open addressing table from client token hash to AckWaitList index + 1, 0 marks an empty bucket.
+ * Twice as many buckets as records keeps the linear probe sequences short. */
+#define ACK_WAIT_HASH_BUCKETS (2 * MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME + 1)
+static uint8_t ackWaitHash[ACK_WAIT_HASH_BUCKETS];
+static uint8_t ackWaitListCount = 0;
+
 AWS_IoT_Client *pMqttClient;
 
 char myThingName[MAX_SIZE_OF_THING_NAME];
@@ -78,6 +86,8 @@ char shadowRxBuf[SHADOW_MAX_SIZE_OF_RX_BUFFER];
 
 static JsonTokenTable_t tokenTable[MAX_JSON_TOKEN_EXPECTED];
 static uint32_t tokenTableIndex = 0;
+/* tokenTable indexes sorted by key length then key, equal keys in registration order */
+static uint16_t tokenKeyIndex[MAX_JSON_TOKEN_EXPECTED];
 static bool deltaTopicSubscribedFlag = false;
 uint32_t shadowJsonVersionNum = 0;
 bool shadowDiscardOldDeltaFlag = true;
@@ -94,6 +104,10 @@ static void topicNameFromThingAndAction(char *pTopic, const char *pThingName, Sh
 
 static int16_t getNextFreeIndexOfSubscriptionList(void);
 
+static int16_t findIndexOfAckWaitList(const char *pClientToken);
+
+static void removeFromAckWaitList(uint8_t index);
+
 static void unsubscribeFromAcceptedAndRejected(uint8_t index);
 
 void initDeltaTokens(void) {
@@ -105,9 +119,39 @@ void initDeltaTokens(void) {
 	deltaTopicSubscribedFlag = false;
 }
 
+static int compareDeltaKey(const char *pKey, uint32_t keyLen, const JsonTokenTable_t *pToken) {
+	if(keyLen != pToken->keyLen) {
+		return (keyLen < pToken->keyLen) ? -1 : 1;
+	}
+
+	return memcmp(pKey, pToken->pKey, keyLen);
+}
+
+/* Binary search of tokenKeyIndex for the first key not below pKey, or above it when isAfter is set */
+static uint32_t findDeltaKeyPosition(const char *pKey, uint32_t keyLen, bool isAfter) {
+	uint32_t low = 0;
+	uint32_t high = tokenTableIndex;
+	uint32_t mid;
+	int cmp;
+
+	while(low < high) {
+		mid = low + ((high - low) / 2);
+		cmp = compareDeltaKey(pKey, keyLen, &tokenTable[tokenKeyIndex[mid]]);
+		if(cmp > 0 || (isAfter && 0 == cmp)) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+
+	return low;
+}
+
 IoT_Error_t registerJsonTokenOnDelta(jsonStruct_t *pStruct) {
 
 	IoT_Error_t rc = SUCCESS;
+	uint32_t keyLen;
+	uint32_t position;
 
 	if(!deltaTopicSubscribedFlag) {
 		snprintf(shadowDeltaTopic, MAX_SHADOW_TOPIC_LENGTH_BYTES, "$aws/things/%s/shadow/update/delta", myThingName);
@@ -120,7 +164,14 @@ IoT_Error_t registerJsonTokenOnDelta(jsonStruct_t *pStruct) {
 		return FAILURE;
 	}
 
+	keyLen = (uint32_t) strlen(pStruct->pKey);
+	position = findDeltaKeyPosition(pStruct->pKey, keyLen, true);
+	memmove(&tokenKeyIndex[position + 1], &tokenKeyIndex[position],
+			(tokenTableIndex - position) * sizeof(tokenKeyIndex[0]));
+	tokenKeyIndex[position] = (uint16_t) tokenTableIndex;
+
 	tokenTable[tokenTableIndex].pKey = pStruct->pKey;
+	tokenTable[tokenTableIndex].keyLen = keyLen;
 	tokenTable[tokenTableIndex].callback = pStruct->cb;
 	tokenTable[tokenTableIndex].pStruct = pStruct;
 	tokenTable[tokenTableIndex].isFree = false;
@@ -181,6 +232,7 @@ static void AckStatusCallback(AWS_IoT_Client *pClient, char *topicName, uint16_t
 							  IoT_Publish_Message_Params *params, void *pData) {
 	int32_t tokenCount;
 	uint8_t i;
+	int16_t indexAckWaitList;
 	void *pJsonHandler = NULL;
 	char temporaryClientToken[MAX_SIZE_CLIENT_TOKEN_CLIENT_SEQUENCE];
 
@@ -211,25 +263,23 @@ static void AckStatusCallback(AWS_IoT_Client *pClient, char *topicName, uint16_t
 	}
 
 	if(extractClientToken(shadowRxBuf, SHADOW_MAX_SIZE_OF_RX_BUFFER, temporaryClientToken, MAX_SIZE_CLIENT_TOKEN_CLIENT_SEQUENCE)) {
-		for(i = 0; i < MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME; i++) {
-			if(!AckWaitList[i].isFree) {
-				if(strcmp(AckWaitList[i].clientTokenID, temporaryClientToken) == 0) {
-					Shadow_Ack_Status_t status = SHADOW_ACK_REJECTED;
-					if(strstr(topicName, "accepted") != NULL) {
-						status = SHADOW_ACK_ACCEPTED;
-					} else if(strstr(topicName, "rejected") != NULL) {
-						status = SHADOW_ACK_REJECTED;
-					}
-					if(status == SHADOW_ACK_ACCEPTED || status == SHADOW_ACK_REJECTED) {
-						if(AckWaitList[i].callback != NULL) {
-							AckWaitList[i].callback(AckWaitList[i].thingName, AckWaitList[i].action, status,
-													shadowRxBuf, AckWaitList[i].pCallbackContext);
-						}
-						unsubscribeFromAcceptedAndRejected(i);
-						AckWaitList[i].isFree = true;
-						return;
-					}
+		indexAckWaitList = findIndexOfAckWaitList(temporaryClientToken);
+		if(indexAckWaitList >= 0) {
+			Shadow_Ack_Status_t status = SHADOW_ACK_REJECTED;
+			i = (uint8_t) indexAckWaitList;
+			if(strstr(topicName, "accepted") != NULL) {
+				status = SHADOW_ACK_ACCEPTED;
+			} else if(strstr(topicName, "rejected") != NULL) {
+				status = SHADOW_ACK_REJECTED;
+			}
+			if(status == SHADOW_ACK_ACCEPTED || status == SHADOW_ACK_REJECTED) {
+				if(AckWaitList[i].callback != NULL) {
+					AckWaitList[i].callback(AckWaitList[i].thingName, AckWaitList[i].action, status,
+											shadowRxBuf, AckWaitList[i].pCallbackContext);
 				}
+				unsubscribeFromAcceptedAndRejected(i);
+				removeFromAckWaitList(i);
+				return;
 			}
 		}
 	}
@@ -292,6 +342,8 @@ void initializeRecords(AWS_IoT_Client *pClient) {
 	for(i = 0; i < MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME; i++) {
 		AckWaitList[i].isFree = true;
 	}
+	memset(ackWaitHash, 0, sizeof(ackWaitHash));
+	ackWaitListCount = 0;
 	for(i = 0; i < MAX_TOPICS_AT_ANY_GIVEN_TIME; i++) {
 		SubscriptionList[i].isFree = true;
 		SubscriptionList[i].count = 0;
@@ -422,6 +474,66 @@ IoT_Error_t publishToShadowAction(const char *pThingName, ShadowActions_t action
 	return ret_val;
 }
 
+/* FNV-1a, client tokens are short and differ mostly in the trailing sequence number */
+static uint32_t hashClientToken(const char *pClientToken) {
+	uint32_t hash = 2166136261UL;
+
+	while(*pClientToken != '\0') {
+		hash ^= (uint8_t) *pClientToken++;
+		hash *= 16777619UL;
+	}
+
+	return hash;
+}
+
+static int16_t findIndexOfAckWaitList(const char *pClientToken) {
+	uint32_t hash;
+	uint32_t bucket;
+	uint8_t index;
+
+	if(0 == ackWaitListCount) {
+		return -1;
+	}
+
+	hash = hashClientToken(pClientToken);
+	for(bucket = hash % ACK_WAIT_HASH_BUCKETS; ackWaitHash[bucket] != 0; bucket = (bucket + 1) % ACK_WAIT_HASH_BUCKETS) {
+		index = (uint8_t) (ackWaitHash[bucket] - 1);
+		if(AckWaitList[index].clientTokenHash == hash && strcmp(AckWaitList[index].clientTokenID, pClientToken) == 0) {
+			return index;
+		}
+	}
+
+	return -1;
+}
+
+static void removeFromAckWaitList(uint8_t index) {
+	uint32_t hole;
+	uint32_t bucket;
+	uint32_t home;
+
+	AckWaitList[index].isFree = true;
+
+	hole = AckWaitList[index].clientTokenHash % ACK_WAIT_HASH_BUCKETS;
+	while(ackWaitHash[hole] != (uint8_t) (index + 1)) {
+		if(0 == ackWaitHash[hole]) {
+			return;
+		}
+		hole = (hole + 1) % ACK_WAIT_HASH_BUCKETS;
+	}
+	ackWaitHash[hole] = 0;
+	ackWaitListCount--;
+
+	// Shift later entries of the probe sequence back so lookups never stop at the hole too early
+	for(bucket = (hole + 1) % ACK_WAIT_HASH_BUCKETS; ackWaitHash[bucket] != 0; bucket = (bucket + 1) % ACK_WAIT_HASH_BUCKETS) {
+		home = AckWaitList[ackWaitHash[bucket] - 1].clientTokenHash % ACK_WAIT_HASH_BUCKETS;
+		if((bucket > hole && (home <= hole || home > bucket)) || (bucket < hole && home <= hole && home > bucket)) {
+			ackWaitHash[hole] = ackWaitHash[bucket];
+			ackWaitHash[bucket] = 0;
+			hole = bucket;
+		}
+	}
+}
+
 bool getNextFreeIndexOfAckWaitList(uint8_t *pIndex) {
 	uint8_t i;
 	bool rc = false;
@@ -444,6 +556,8 @@ bool getNextFreeIndexOfAckWaitList(uint8_t *pIndex) {
 void addToAckWaitList(uint8_t indexAckWaitList, const char *pThingName, ShadowActions_t action,
 					  const char *pExtractedClientToken, fpActionCallback_t callback, void *pCallbackContext,
 					  uint32_t timeout_seconds) {
+	uint32_t bucket;
+
 	AckWaitList[indexAckWaitList].callback = callback;
 	memcpy(AckWaitList[indexAckWaitList].clientTokenID, pExtractedClientToken, MAX_SIZE_CLIENT_ID_WITH_SEQUENCE);
 	memcpy(AckWaitList[indexAckWaitList].thingName, pThingName, MAX_SIZE_OF_THING_NAME);
@@ -452,10 +566,23 @@ void addToAckWaitList(uint8_t indexAckWaitList, const char *pThingName, ShadowAc
 	init_timer(&(AckWaitList[indexAckWaitList].timer));
 	countdown_sec(&(AckWaitList[indexAckWaitList].timer), timeout_seconds);
 	AckWaitList[indexAckWaitList].isFree = false;
+
+	AckWaitList[indexAckWaitList].clientTokenHash = hashClientToken(AckWaitList[indexAckWaitList].clientTokenID);
+	bucket = AckWaitList[indexAckWaitList].clientTokenHash % ACK_WAIT_HASH_BUCKETS;
+	while(ackWaitHash[bucket] != 0) {
+		bucket = (bucket + 1) % ACK_WAIT_HASH_BUCKETS;
+	}
+	ackWaitHash[bucket] = (uint8_t) (indexAckWaitList + 1);
+	ackWaitListCount++;
 }
 
 void HandleExpiredResponseCallbacks(void) {
 	uint8_t i;
+
+	if(0 == ackWaitListCount) {
+		return;
+	}
+
 	for(i = 0; i < MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME; i++) {
 		if(!AckWaitList[i].isFree) {
 			if(has_timer_expired(&(AckWaitList[i].timer))) {
@@ -463,21 +590,47 @@ void HandleExpiredResponseCallbacks(void) {
 					AckWaitList[i].callback(AckWaitList[i].thingName, AckWaitList[i].action, SHADOW_ACK_TIMEOUT,
 											shadowRxBuf, AckWaitList[i].pCallbackContext);
 				}
-				AckWaitList[i].isFree = true;
+				removeFromAckWaitList(i);
 				unsubscribeFromAcceptedAndRejected(i);
 			}
 		}
 	}
 }
 
+/* Runs the callbacks registered for one key of a delta, each registration at most once per delta */
+static void dispatchDeltaKey(const char *pJsonDocument, const char *pKey, uint32_t keyLen, int32_t valueIndex,
+							 void *pContext) {
+	bool *pDispatched = (bool *) pContext;
+	void *pJsonHandler = NULL;
+	int32_t DataPosition;
+	uint32_t dataLength;
+	uint32_t position;
+	uint16_t i;
+
+	for(position = findDeltaKeyPosition(pKey, keyLen, false); position < tokenTableIndex; position++) {
+		i = tokenKeyIndex[position];
+		if(0 != compareDeltaKey(pKey, keyLen, &tokenTable[i])) {
+			break;
+		}
+		if(tokenTable[i].isFree || pDispatched[i]) {
+			continue;
+		}
+
+		pDispatched[i] = true;
+		updateValueOfJsonToken(pJsonDocument, pJsonHandler, valueIndex, (jsonStruct_t *) tokenTable[i].pStruct,
+							   &dataLength, &DataPosition);
+		if(tokenTable[i].callback != NULL) {
+			tokenTable[i].callback(pJsonDocument + DataPosition, dataLength, (jsonStruct_t *) tokenTable[i].pStruct);
+		}
+	}
+}
+
 static void shadow_delta_callback(AWS_IoT_Client *pClient, char *topicName,
 								  uint16_t topicNameLen, IoT_Publish_Message_Params *params, void *pData) {
 	int32_t tokenCount;
-	uint32_t i = 0;
 	void *pJsonHandler = NULL;
-	int32_t DataPosition;
-	uint32_t dataLength;
 	uint32_t tempVersionNumber = 0;
+	bool dispatched[MAX_JSON_TOKEN_EXPECTED];
 
 	FUNC_ENTRY;
 
@@ -511,17 +664,9 @@ static void shadow_delta_callback(AWS_IoT_Client *pClient, char *topicName,
 		}
 	}
 
-	for(i = 0; i < tokenTableIndex; i++) {
-		if(!tokenTable[i].isFree) {
-			if(isJsonKeyMatchingAndUpdateValue(shadowRxBuf, pJsonHandler, tokenCount,
-											   (jsonStruct_t *) tokenTable[i].pStruct, &dataLength, &DataPosition)) {
-				if(tokenTable[i].callback != NULL) {
-					tokenTable[i].callback(shadowRxBuf + DataPosition, dataLength,
-										   (jsonStruct_t *) tokenTable[i].pStruct);
-				}
-			}
-		}
-	}
+	/* One walk of the state object, callbacks run in document order */
+	memset(dispatched, 0, tokenTableIndex * sizeof(dispatched[0]));
+	visitJsonStateKeys(shadowRxBuf, pJsonHandler, tokenCount, dispatchDeltaKey, dispatched);
 }
 
 #ifdef __cplusplus
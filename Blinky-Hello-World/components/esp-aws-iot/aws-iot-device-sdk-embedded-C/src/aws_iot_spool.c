@@ -0,0 +1,591 @@
+/*
+ * Copyright 2010-2015 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file aws_iot_spool.c
+ * @brief Store and forward spool for telemetry recorded while offline
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <string.h>
+#include <unistd.h>
+
+#include "aws_iot_spool.h"
+#include "aws_iot_log.h"
+
+#define SPOOL_RECORD_DATA 1
+#define SPOOL_RECORD_COMMIT 2
+
+#define SPOOL_RECORD_VALID(type, payloadLen) \
+	((SPOOL_RECORD_DATA == (type) && AWS_IOT_SPOOL_MAX_RECORD_LEN >= (payloadLen)) \
+	 || (SPOOL_RECORD_COMMIT == (type) && 0 == (payloadLen)))
+
+#define SPOOL_BATCH_HEADER_LEN 3
+#define SPOOL_BATCH_RECORD_HEADER_LEN 6
+
+#define SPOOL_FILE_COPY_CHUNK 128
+
+static const uint32_t crc32Nibbles[16] = {
+		0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+		0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+};
+
+/* CRC-32 as used by zlib and Ethernet, with a 16 entry table to keep it small. Start and finish with ~0. */
+static uint32_t _aws_iot_spool_crc32(uint32_t crc, const uint8_t *pBuf, size_t len) {
+	size_t i;
+
+	for(i = 0; i < len; i++) {
+		crc ^= pBuf[i];
+		crc = (crc >> 4) ^ crc32Nibbles[crc & 0x0F];
+		crc = (crc >> 4) ^ crc32Nibbles[crc & 0x0F];
+	}
+
+	return crc;
+}
+
+static void _aws_iot_spool_put_u16(uint8_t *pBuf, uint16_t value) {
+	pBuf[0] = (uint8_t) value;
+	pBuf[1] = (uint8_t) (value >> 8);
+}
+
+static void _aws_iot_spool_put_u32(uint8_t *pBuf, uint32_t value) {
+	pBuf[0] = (uint8_t) value;
+	pBuf[1] = (uint8_t) (value >> 8);
+	pBuf[2] = (uint8_t) (value >> 16);
+	pBuf[3] = (uint8_t) (value >> 24);
+}
+
+static uint16_t _aws_iot_spool_get_u16(const uint8_t *pBuf) {
+	return (uint16_t) (pBuf[0] | (pBuf[1] << 8));
+}
+
+static uint32_t _aws_iot_spool_get_u32(const uint8_t *pBuf) {
+	return (uint32_t) pBuf[0] | ((uint32_t) pBuf[1] << 8) | ((uint32_t) pBuf[2] << 16) | ((uint32_t) pBuf[3] << 24);
+}
+
+/* Writes a complete record to pRecord and returns its length */
+static size_t _aws_iot_spool_encode(uint8_t *pRecord, uint8_t type, uint32_t seq, const void *pPayload,
+									uint16_t payloadLen) {
+	uint32_t crc;
+
+	pRecord[0] = AWS_IOT_SPOOL_RECORD_MAGIC;
+	pRecord[1] = type;
+	_aws_iot_spool_put_u16(&pRecord[2], payloadLen);
+	_aws_iot_spool_put_u32(&pRecord[4], seq);
+	if(0 < payloadLen) {
+		memcpy(&pRecord[AWS_IOT_SPOOL_RECORD_HEADER_LEN], pPayload, payloadLen);
+	}
+	crc = ~_aws_iot_spool_crc32(0xFFFFFFFF, &pRecord[1], AWS_IOT_SPOOL_RECORD_HEADER_LEN - 1 + payloadLen);
+	_aws_iot_spool_put_u32(&pRecord[AWS_IOT_SPOOL_RECORD_HEADER_LEN + payloadLen], crc);
+
+	return AWS_IOT_SPOOL_RECORD_OVERHEAD + payloadLen;
+}
+
+/* Reads the header at offset, returns false at the end of the log or when no valid header is found */
+static bool _aws_iot_spool_read_header(AWS_IoT_Spool *pSpool, uint32_t offset, uint8_t *pHeader, uint8_t *pType,
+									   uint16_t *pPayloadLen, uint32_t *pSeq) {
+	size_t readLen = 0;
+
+	if(SUCCESS != pSpool->storage.read(pSpool->storage.pContext, offset, pHeader, AWS_IOT_SPOOL_RECORD_HEADER_LEN,
+									   &readLen) || AWS_IOT_SPOOL_RECORD_HEADER_LEN != readLen) {
+		return false;
+	}
+
+	*pType = pHeader[1];
+	*pPayloadLen = _aws_iot_spool_get_u16(&pHeader[2]);
+	*pSeq = _aws_iot_spool_get_u32(&pHeader[4]);
+
+	return AWS_IOT_SPOOL_RECORD_MAGIC == pHeader[0] && SPOOL_RECORD_VALID(*pType, *pPayloadLen);
+}
+
+/* Reads the payload and CRC following a header into pPayload and checks the CRC */
+static bool _aws_iot_spool_read_payload(AWS_IoT_Spool *pSpool, uint32_t offset, const uint8_t *pHeader,
+										uint8_t *pPayload, uint16_t payloadLen) {
+	uint8_t crcBytes[4];
+	size_t readLen = 0;
+	uint32_t crc;
+
+	offset += AWS_IOT_SPOOL_RECORD_HEADER_LEN;
+	if(0 < payloadLen) {
+		if(SUCCESS != pSpool->storage.read(pSpool->storage.pContext, offset, pPayload, payloadLen, &readLen)
+		   || payloadLen != readLen) {
+			return false;
+		}
+	}
+	if(SUCCESS != pSpool->storage.read(pSpool->storage.pContext, offset + payloadLen, crcBytes, sizeof(crcBytes),
+									   &readLen) || sizeof(crcBytes) != readLen) {
+		return false;
+	}
+
+	crc = _aws_iot_spool_crc32(0xFFFFFFFF, &pHeader[1], AWS_IOT_SPOOL_RECORD_HEADER_LEN - 1);
+	crc = ~_aws_iot_spool_crc32(crc, pPayload, payloadLen);
+
+	return crc == _aws_iot_spool_get_u32(crcBytes);
+}
+
+static IoT_Error_t _aws_iot_spool_file_read(void *pContext, uint32_t offset, uint8_t *pBuf, size_t len,
+											size_t *pRead) {
+	AWS_IoT_Spool_File *pFile = (AWS_IoT_Spool_File *) pContext;
+
+	if(NULL == pFile->pFile || 0 != fseek(pFile->pFile, (long) offset, SEEK_SET)) {
+		return SPOOL_STORAGE_ERROR;
+	}
+
+	*pRead = fread(pBuf, 1, len, pFile->pFile);
+	if(*pRead < len && ferror(pFile->pFile)) {
+		clearerr(pFile->pFile);
+		return SPOOL_STORAGE_ERROR;
+	}
+
+	return SUCCESS;
+}
+
+static IoT_Error_t _aws_iot_spool_file_append(void *pContext, const uint8_t *pBuf, size_t len) {
+	AWS_IoT_Spool_File *pFile = (AWS_IoT_Spool_File *) pContext;
+
+	/* The file is opened for appending, the seek only switches the stream from reading to writing */
+	if(NULL == pFile->pFile || 0 != fseek(pFile->pFile, 0, SEEK_END)
+	   || len != fwrite(pBuf, 1, len, pFile->pFile)) {
+		return SPOOL_STORAGE_ERROR;
+	}
+
+	return SUCCESS;
+}
+
+static IoT_Error_t _aws_iot_spool_file_sync(void *pContext) {
+	AWS_IoT_Spool_File *pFile = (AWS_IoT_Spool_File *) pContext;
+
+	if(NULL == pFile->pFile || 0 != fflush(pFile->pFile) || 0 != fsync(fileno(pFile->pFile))) {
+		return SPOOL_STORAGE_ERROR;
+	}
+
+	return SUCCESS;
+}
+
+/*
+ * The new log is built next to the old one and renamed over it. FAT cannot rename onto an existing file, so the
+ * old log is removed first, aws_iot_spool_file_open takes the new one when a power loss hits in between.
+ */
+static IoT_Error_t _aws_iot_spool_file_rewrite(void *pContext, const uint8_t *pHead, size_t headLen,
+											   uint32_t srcOffset, uint32_t srcLen) {
+	AWS_IoT_Spool_File *pFile = (AWS_IoT_Spool_File *) pContext;
+	uint8_t chunk[SPOOL_FILE_COPY_CHUNK];
+	size_t chunkLen, readLen;
+	IoT_Error_t rc = SUCCESS;
+	FILE *pTmp;
+
+	pTmp = fopen(pFile->tmpPath, "wb");
+	if(NULL == pTmp) {
+		return SPOOL_STORAGE_ERROR;
+	}
+
+	if(0 < headLen && headLen != fwrite(pHead, 1, headLen, pTmp)) {
+		rc = SPOOL_STORAGE_ERROR;
+	}
+	while(SUCCESS == rc && 0 < srcLen) {
+		chunkLen = srcLen < sizeof(chunk) ? srcLen : sizeof(chunk);
+		rc = _aws_iot_spool_file_read(pContext, srcOffset, chunk, chunkLen, &readLen);
+		if(SUCCESS == rc && (chunkLen != readLen || chunkLen != fwrite(chunk, 1, chunkLen, pTmp))) {
+			rc = SPOOL_STORAGE_ERROR;
+		}
+		srcOffset += (uint32_t) chunkLen;
+		srcLen -= (uint32_t) chunkLen;
+	}
+	if(SUCCESS == rc && (0 != fflush(pTmp) || 0 != fsync(fileno(pTmp)))) {
+		rc = SPOOL_STORAGE_ERROR;
+	}
+	if(0 != fclose(pTmp) && SUCCESS == rc) {
+		rc = SPOOL_STORAGE_ERROR;
+	}
+	if(SUCCESS != rc) {
+		(void) remove(pFile->tmpPath);
+		return rc;
+	}
+
+	fclose(pFile->pFile);
+	(void) remove(pFile->path);
+	if(0 != rename(pFile->tmpPath, pFile->path)) {
+		rc = SPOOL_STORAGE_ERROR;
+	}
+	pFile->pFile = fopen(pFile->path, "a+b");
+	if(NULL == pFile->pFile) {
+		rc = SPOOL_STORAGE_ERROR;
+	}
+
+	return rc;
+}
+
+IoT_Error_t aws_iot_spool_file_open(AWS_IoT_Spool_Storage *pStorage, AWS_IoT_Spool_File *pFile, const char *pPath) {
+	FILE *pExisting;
+	int len;
+
+	FUNC_ENTRY;
+
+	if(NULL == pStorage || NULL == pFile || NULL == pPath) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	memset(pFile, 0, sizeof(AWS_IoT_Spool_File));
+	len = snprintf(pFile->tmpPath, sizeof(pFile->tmpPath), "%s.tmp", pPath);
+	if(0 > len || (size_t) len >= sizeof(pFile->tmpPath)) {
+		FUNC_EXIT_RC(MAX_SIZE_ERROR);
+	}
+	strcpy(pFile->path, pPath);
+
+	pExisting = fopen(pFile->path, "rb");
+	if(NULL != pExisting) {
+		/* A temporary file next to the log is a rewrite that did not finish, the log is still complete */
+		fclose(pExisting);
+		(void) remove(pFile->tmpPath);
+	} else {
+		/* Without the log a rewrite stopped after removing it, the temporary file is the complete new log */
+		(void) rename(pFile->tmpPath, pFile->path);
+	}
+
+	pFile->pFile = fopen(pFile->path, "a+b");
+	if(NULL == pFile->pFile) {
+		IOT_ERROR("Unable to open the spool at %s", pFile->path);
+		FUNC_EXIT_RC(SPOOL_STORAGE_ERROR);
+	}
+
+	pStorage->read = _aws_iot_spool_file_read;
+	pStorage->append = _aws_iot_spool_file_append;
+	pStorage->sync = _aws_iot_spool_file_sync;
+	pStorage->rewrite = _aws_iot_spool_file_rewrite;
+	pStorage->pContext = pFile;
+
+	FUNC_EXIT_RC(SUCCESS);
+}
+
+IoT_Error_t aws_iot_spool_file_close(AWS_IoT_Spool_File *pFile) {
+	IoT_Error_t rc = SUCCESS;
+
+	FUNC_ENTRY;
+
+	if(NULL == pFile) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	if(NULL != pFile->pFile && 0 != fclose(pFile->pFile)) {
+		rc = SPOOL_STORAGE_ERROR;
+	}
+	pFile->pFile = NULL;
+
+	FUNC_EXIT_RC(rc);
+}
+
+IoT_Error_t aws_iot_spool_init(AWS_IoT_Spool *pSpool, const AWS_IoT_Spool_Storage *pStorage, uint32_t maxBytes,
+							   uint32_t batchInterval_ms) {
+	uint8_t header[AWS_IOT_SPOOL_RECORD_HEADER_LEN];
+	uint8_t payload[AWS_IOT_SPOOL_MAX_RECORD_LEN];
+	uint8_t chunk[SPOOL_FILE_COPY_CHUNK];
+	uint16_t payloadLen;
+	uint32_t offset, seq;
+	size_t readLen;
+	uint8_t type;
+	IoT_Error_t rc;
+
+	FUNC_ENTRY;
+
+	if(NULL == pSpool || NULL == pStorage || NULL == pStorage->read || NULL == pStorage->append
+	   || NULL == pStorage->sync || NULL == pStorage->rewrite) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	if(maxBytes < 2 * (AWS_IOT_SPOOL_RECORD_OVERHEAD + AWS_IOT_SPOOL_MAX_RECORD_LEN)) {
+		FUNC_EXIT_RC(MAX_SIZE_ERROR);
+	}
+
+	memset(pSpool, 0, sizeof(AWS_IoT_Spool));
+	pSpool->storage = *pStorage;
+	pSpool->maxBytes = maxBytes;
+	pSpool->batchInterval_ms = batchInterval_ms;
+	pSpool->syncInterval = 1;
+	pSpool->nextSeq = 1;
+	init_timer(&(pSpool->batchTimer));
+
+	/* Sequence numbers only grow, the last data record and the last commit give the state of the spool */
+	offset = 0;
+	while(_aws_iot_spool_read_header(pSpool, offset, header, &type, &payloadLen, &seq)
+		  && _aws_iot_spool_read_payload(pSpool, offset, header, payload, payloadLen)) {
+		if(SPOOL_RECORD_COMMIT == type && seq > pSpool->committedSeq) {
+			pSpool->committedSeq = seq;
+		}
+		if(seq >= pSpool->nextSeq) {
+			pSpool->nextSeq = seq + 1;
+		}
+		offset += AWS_IOT_SPOOL_RECORD_OVERHEAD + payloadLen;
+	}
+	pSpool->size = offset;
+	pSpool->pendingCount = pSpool->nextSeq - 1 - pSpool->committedSeq;
+
+	/* Whatever follows the last valid record was torn by a power loss and is cut off */
+	rc = pSpool->storage.read(pSpool->storage.pContext, offset, chunk, sizeof(chunk), &readLen);
+	while(SUCCESS == rc && 0 < readLen) {
+		pSpool->metrics.discardedBytes += (uint32_t) readLen;
+		offset += (uint32_t) readLen;
+		rc = pSpool->storage.read(pSpool->storage.pContext, offset, chunk, sizeof(chunk), &readLen);
+	}
+	if(SUCCESS != rc) {
+		FUNC_EXIT_RC(rc);
+	}
+	if(0 < pSpool->metrics.discardedBytes) {
+		IOT_WARN("Spool cut %u bytes after the last valid record", (unsigned) pSpool->metrics.discardedBytes);
+		rc = pSpool->storage.rewrite(pSpool->storage.pContext, NULL, 0, 0, pSpool->size);
+	}
+
+	IOT_DEBUG("Spool holds %u bytes, %u records pending, next sequence number %u", (unsigned) pSpool->size,
+			  (unsigned) pSpool->pendingCount, (unsigned) pSpool->nextSeq);
+
+	FUNC_EXIT_RC(rc);
+}
+
+IoT_Error_t aws_iot_spool_append(AWS_IoT_Spool *pSpool, const void *pPayload, uint16_t payloadLen,
+								 uint32_t *pSeq) {
+	uint8_t record[AWS_IOT_SPOOL_RECORD_OVERHEAD + AWS_IOT_SPOOL_MAX_RECORD_LEN];
+	size_t recordLen;
+	IoT_Error_t rc;
+
+	FUNC_ENTRY;
+
+	if(NULL == pSpool || (NULL == pPayload && 0 < payloadLen)) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	if(AWS_IOT_SPOOL_MAX_RECORD_LEN < payloadLen) {
+		FUNC_EXIT_RC(MAX_SIZE_ERROR);
+	}
+
+	if(pSpool->size + AWS_IOT_SPOOL_RECORD_OVERHEAD + payloadLen > pSpool->maxBytes) {
+		pSpool->metrics.refused++;
+		FUNC_EXIT_RC(SPOOL_FULL_ERROR);
+	}
+
+	recordLen = _aws_iot_spool_encode(record, SPOOL_RECORD_DATA, pSpool->nextSeq, pPayload, payloadLen);
+	rc = pSpool->storage.append(pSpool->storage.pContext, record, recordLen);
+	if(SUCCESS == rc && pSpool->unsyncedCount + 1 >= pSpool->syncInterval) {
+		rc = pSpool->storage.sync(pSpool->storage.pContext);
+		if(SUCCESS == rc) {
+			pSpool->unsyncedCount = 0;
+		}
+	} else if(SUCCESS == rc) {
+		pSpool->unsyncedCount++;
+	}
+	if(SUCCESS != rc) {
+		/* Part of the record may have been written, cut it so the next record does not land behind it */
+		(void) pSpool->storage.rewrite(pSpool->storage.pContext, NULL, 0, 0, pSpool->size);
+		FUNC_EXIT_RC(rc);
+	}
+
+	if(NULL != pSeq) {
+		*pSeq = pSpool->nextSeq;
+	}
+	pSpool->nextSeq++;
+	pSpool->size += (uint32_t) recordLen;
+	pSpool->pendingCount++;
+	pSpool->metrics.appended++;
+
+	FUNC_EXIT_RC(SUCCESS);
+}
+
+IoT_Error_t aws_iot_spool_set_sync_interval(AWS_IoT_Spool *pSpool, uint32_t syncInterval) {
+	FUNC_ENTRY;
+
+	if(NULL == pSpool) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	pSpool->syncInterval = 0 < syncInterval ? syncInterval : 1;
+
+	FUNC_EXIT_RC(SUCCESS);
+}
+
+IoT_Error_t aws_iot_spool_sync(AWS_IoT_Spool *pSpool) {
+	IoT_Error_t rc;
+
+	FUNC_ENTRY;
+
+	if(NULL == pSpool) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	if(0 == pSpool->unsyncedCount) {
+		FUNC_EXIT_RC(SUCCESS);
+	}
+
+	rc = pSpool->storage.sync(pSpool->storage.pContext);
+	if(SUCCESS == rc) {
+		pSpool->unsyncedCount = 0;
+	}
+
+	FUNC_EXIT_RC(rc);
+}
+
+uint32_t aws_iot_spool_pending(const AWS_IoT_Spool *pSpool) {
+	if(NULL == pSpool) {
+		return 0;
+	}
+
+	return pSpool->pendingCount;
+}
+
+/* Appends the commit record of committedSeq, and rewrites the log once the committed records are not needed */
+static IoT_Error_t _aws_iot_spool_commit(AWS_IoT_Spool *pSpool) {
+	uint8_t record[AWS_IOT_SPOOL_RECORD_OVERHEAD];
+	size_t recordLen;
+	uint32_t keepLen;
+	IoT_Error_t rc;
+
+	recordLen = _aws_iot_spool_encode(record, SPOOL_RECORD_COMMIT, pSpool->committedSeq, NULL, 0);
+
+	if(0 < pSpool->pendingCount && pSpool->replayOffset <= pSpool->maxBytes / 2) {
+		rc = pSpool->storage.append(pSpool->storage.pContext, record, recordLen);
+		if(SUCCESS == rc) {
+			rc = pSpool->storage.sync(pSpool->storage.pContext);
+		}
+		if(SUCCESS == rc) {
+			pSpool->size += (uint32_t) recordLen;
+			pSpool->unsyncedCount = 0;
+		}
+		return rc;
+	}
+
+	/* The commit record heads the new log so the sequence numbers carry on after a reboot */
+	keepLen = 0 < pSpool->pendingCount ? pSpool->size - pSpool->replayOffset : 0;
+	rc = pSpool->storage.rewrite(pSpool->storage.pContext, record, recordLen, pSpool->replayOffset, keepLen);
+	if(SUCCESS == rc) {
+		pSpool->size = (uint32_t) recordLen + keepLen;
+		pSpool->replayOffset = (uint32_t) recordLen;
+		pSpool->unsyncedCount = 0;
+		pSpool->metrics.rewrites++;
+	}
+
+	return rc;
+}
+
+IoT_Error_t aws_iot_spool_replay(AWS_IoT_Spool *pSpool, AWS_IoT_Client *pClient, const char *pTopicName,
+								 uint16_t topicNameLen, uint8_t *pBatchBuffer, size_t batchBufferSize,
+								 uint32_t *pReplayed) {
+	uint8_t header[AWS_IOT_SPOOL_RECORD_HEADER_LEN];
+	IoT_Publish_Message_Params params;
+	uint32_t offset, seq, lastSeq = 0;
+	uint16_t payloadLen, count = 0;
+	bool isBatchFull = false;
+	size_t batchLen;
+	uint8_t type;
+	IoT_Error_t rc;
+
+	FUNC_ENTRY;
+
+	if(NULL == pSpool || NULL == pClient || NULL == pTopicName || NULL == pBatchBuffer) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	if(NULL != pReplayed) {
+		*pReplayed = 0;
+	}
+
+	if(0 == pSpool->pendingCount) {
+		FUNC_EXIT_RC(SUCCESS);
+	}
+
+	if(!has_timer_expired(&(pSpool->batchTimer))) {
+		pSpool->metrics.rateLimited++;
+		FUNC_EXIT_RC(SUCCESS);
+	}
+
+	/* Commit records and records committed before are skipped, which drops anything sent already */
+	batchLen = SPOOL_BATCH_HEADER_LEN;
+	offset = pSpool->replayOffset;
+	while(offset < pSpool->size && UINT16_MAX > count
+		  && _aws_iot_spool_read_header(pSpool, offset, header, &type, &payloadLen, &seq)) {
+		if(SPOOL_RECORD_DATA == type && seq > pSpool->committedSeq) {
+			if(batchLen + SPOOL_BATCH_RECORD_HEADER_LEN + payloadLen > batchBufferSize) {
+				isBatchFull = true;
+				break;
+			}
+			if(!_aws_iot_spool_read_payload(pSpool, offset, header,
+											&pBatchBuffer[batchLen + SPOOL_BATCH_RECORD_HEADER_LEN], payloadLen)) {
+				IOT_ERROR("Spool record at %u is corrupt", (unsigned) offset);
+				FUNC_EXIT_RC(SPOOL_STORAGE_ERROR);
+			}
+			_aws_iot_spool_put_u32(&pBatchBuffer[batchLen], seq);
+			_aws_iot_spool_put_u16(&pBatchBuffer[batchLen + 4], payloadLen);
+			batchLen += SPOOL_BATCH_RECORD_HEADER_LEN + payloadLen;
+			lastSeq = seq;
+			count++;
+		}
+		offset += AWS_IOT_SPOOL_RECORD_OVERHEAD + payloadLen;
+	}
+
+	if(0 == count) {
+		if(isBatchFull) {
+			/* The next record does not fit in the batch buffer at all */
+			FUNC_EXIT_RC(MAX_SIZE_ERROR);
+		}
+		if(offset < pSpool->size) {
+			IOT_ERROR("Spool record at %u is corrupt", (unsigned) offset);
+			FUNC_EXIT_RC(SPOOL_STORAGE_ERROR);
+		}
+		pSpool->pendingCount = 0;
+		FUNC_EXIT_RC(SUCCESS);
+	}
+
+	pBatchBuffer[0] = AWS_IOT_SPOOL_BATCH_VERSION;
+	_aws_iot_spool_put_u16(&pBatchBuffer[1], count);
+
+	params.qos = QOS1;
+	params.isRetained = 0;
+	params.payload = pBatchBuffer;
+	params.payloadLen = batchLen;
+	rc = aws_iot_mqtt_publish(pClient, pTopicName, topicNameLen, &params);
+	countdown_ms(&(pSpool->batchTimer), pSpool->batchInterval_ms);
+	if(SUCCESS != rc) {
+		FUNC_EXIT_RC(rc);
+	}
+
+	pSpool->committedSeq = lastSeq;
+	pSpool->replayOffset = offset;
+	pSpool->pendingCount -= count;
+	pSpool->metrics.replayed += count;
+	pSpool->metrics.batches++;
+	if(NULL != pReplayed) {
+		*pReplayed = count;
+	}
+
+	rc = _aws_iot_spool_commit(pSpool);
+	if(SUCCESS != rc) {
+		/* The batch is out, after a reboot it is sent again and the receiver drops it by sequence number */
+		IOT_WARN("Spool could not commit sequence number %u", (unsigned) lastSeq);
+	}
+
+	FUNC_EXIT_RC(rc);
+}
+
+IoT_Error_t aws_iot_spool_get_metrics(const AWS_IoT_Spool *pSpool, AWS_IoT_Spool_Metrics *pMetrics) {
+	if(NULL == pSpool || NULL == pMetrics) {
+		return NULL_VALUE_ERROR;
+	}
+
+	*pMetrics = pSpool->metrics;
+	return SUCCESS;
+}
+
+#ifdef __cplusplus
+}
+#endif
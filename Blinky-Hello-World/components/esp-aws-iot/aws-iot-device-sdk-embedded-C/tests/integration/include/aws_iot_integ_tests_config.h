@@ -33,6 +33,15 @@
 /* Interval that each thread sleeps for */
 #define THREAD_SLEEP_INTERVAL_USEC 500000
 
+/* Number of producer threads of the publish queue benchmark */
+#define PUBLISH_QUEUE_BENCHMARK_THREAD_COUNT 4
+
+/* Number of messages every producer thread of the publish queue benchmark sends */
+#define PUBLISH_QUEUE_BENCHMARK_MESSAGE_COUNT 250
+
+/* QoS of the messages of the publish queue benchmark */
+#define PUBLISH_QUEUE_BENCHMARK_QOS QOS1
+
 /* Test topic to publish on */
 #define INTEGRATION_TEST_TOPIC "Tests/Integration/EmbeddedC"
 
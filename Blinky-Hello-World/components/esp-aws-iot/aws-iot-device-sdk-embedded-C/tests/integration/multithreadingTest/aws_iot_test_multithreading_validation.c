@@ -19,6 +19,8 @@
 
 #define BUFFER_SIZE 100
 
+int aws_iot_mqtt_tests_publish_queue_benchmark();
+
 static bool terminate_yield_thread;
 static bool terminate_subUnsub_thread;
 
@@ -358,5 +360,21 @@ int main() {
 	printf("* MQTT Version 3.1.1 Multithreading Validation Test SUCCESS!!    *\n");
 	printf("******************************************************************\n");
 
+	printf("\n\n");
+	printf("******************************************************************\n");
+	printf("* Starting MQTT Version 3.1.1 Publish Queue Benchmark            *\n");
+	printf("******************************************************************\n");
+	rc = aws_iot_mqtt_tests_publish_queue_benchmark();
+	if(0 != rc) {
+		printf("\n*******************************************************************\n");
+		printf("*MQTT Version 3.1.1 Publish Queue Benchmark FAILED! RC : %d \n", rc);
+		printf("*******************************************************************\n");
+		return 1;
+	}
+
+	printf("\n******************************************************************\n");
+	printf("* MQTT Version 3.1.1 Publish Queue Benchmark SUCCESS!!           *\n");
+	printf("******************************************************************\n");
+
 	return 0;
 }
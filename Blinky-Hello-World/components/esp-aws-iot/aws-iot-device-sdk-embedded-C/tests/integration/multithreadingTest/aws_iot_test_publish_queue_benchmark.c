@@ -0,0 +1,263 @@
+/*
+ * aws_iot_test_publish_queue_benchmark.c
+ *
+ * Publishes the same messages from several threads twice, once with aws_iot_mqtt_publish next to a yield thread
+ * and once through a publish queue drained by a single network thread, and prints throughput and latency of both.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include "aws_iot_mqtt_client_interface.h"
+#include "aws_iot_mqtt_client_publish_queue.h"
+#include "aws_iot_log.h"
+
+#include "aws_iot_integ_tests_config.h"
+#include "aws_iot_config.h"
+
+#define BENCHMARK_MESSAGE_COUNT (PUBLISH_QUEUE_BENCHMARK_THREAD_COUNT * PUBLISH_QUEUE_BENCHMARK_MESSAGE_COUNT)
+
+typedef struct {
+	unsigned int messages;
+	unsigned int errors;
+	unsigned int retries;
+	uint64_t totalLatency_us;
+	uint64_t maxLatency_us;
+	uint64_t elapsed_us;
+} BenchmarkResult;
+
+typedef struct {
+	AWS_IoT_Client *pClient;
+	int threadId;
+} BenchmarkThreadData;
+
+static AWS_IoT_Publish_Queue publishQueue;
+static struct timeval enqueueTime[BENCHMARK_MESSAGE_COUNT];
+static BenchmarkResult result;
+static pthread_mutex_t resultLock = PTHREAD_MUTEX_INITIALIZER;
+static volatile bool terminate_network_thread;
+
+static uint64_t aws_iot_benchmark_elapsed_us(const struct timeval *pStart) {
+	struct timeval now, elapsed;
+
+	gettimeofday(&now, NULL);
+	timersub(&now, pStart, &elapsed);
+	return (uint64_t) elapsed.tv_sec * 1000000 + (uint64_t) elapsed.tv_usec;
+}
+
+static void aws_iot_benchmark_record(IoT_Error_t rc, uint64_t latency_us) {
+	pthread_mutex_lock(&resultLock);
+	if(SUCCESS == rc) {
+		result.messages++;
+		result.totalLatency_us += latency_us;
+		if(latency_us > result.maxLatency_us) {
+			result.maxLatency_us = latency_us;
+		}
+	} else {
+		result.errors++;
+	}
+	pthread_mutex_unlock(&resultLock);
+}
+
+static void aws_iot_benchmark_disconnect_callback_handler(AWS_IoT_Client *pClient, void *param) {
+}
+
+static void aws_iot_benchmark_build_message(IoT_Publish_Message_Params *pParams, char *pPayload, size_t payloadSize,
+											int threadId, int messageId) {
+	snprintf(pPayload, payloadSize, "%s_Benchmark : %d, Msg : %d", AWS_IOT_MY_THING_NAME, threadId, messageId);
+	pParams->payload = (void *) pPayload;
+	pParams->payloadLen = strlen(pPayload) + 1;
+	pParams->qos = PUBLISH_QUEUE_BENCHMARK_QOS;
+	pParams->isRetained = 0;
+}
+
+static void *aws_iot_benchmark_yield_thread_runner(void *ptr) {
+	AWS_IoT_Client *pClient = (AWS_IoT_Client *) ptr;
+
+	while(false == terminate_network_thread) {
+		aws_iot_mqtt_yield(pClient, 10);
+		usleep(1000);
+	}
+
+	return NULL;
+}
+
+static void *aws_iot_benchmark_direct_publish_thread_runner(void *ptr) {
+	BenchmarkThreadData *pThreadData = (BenchmarkThreadData *) ptr;
+	IoT_Publish_Message_Params params;
+	struct timeval start;
+	char cPayload[100];
+	IoT_Error_t rc;
+	int i;
+
+	for(i = 0; i < PUBLISH_QUEUE_BENCHMARK_MESSAGE_COUNT; i++) {
+		aws_iot_benchmark_build_message(&params, cPayload, sizeof(cPayload), pThreadData->threadId, i);
+		gettimeofday(&start, NULL);
+		do {
+			rc = aws_iot_mqtt_publish(pThreadData->pClient, INTEGRATION_TEST_TOPIC, strlen(INTEGRATION_TEST_TOPIC),
+									  &params);
+			if(MUTEX_LOCK_ERROR == rc || MQTT_CLIENT_NOT_IDLE_ERROR == rc) {
+				pthread_mutex_lock(&resultLock);
+				result.retries++;
+				pthread_mutex_unlock(&resultLock);
+			}
+		} while(MUTEX_LOCK_ERROR == rc || MQTT_CLIENT_NOT_IDLE_ERROR == rc);
+		aws_iot_benchmark_record(rc, aws_iot_benchmark_elapsed_us(&start));
+	}
+
+	return NULL;
+}
+
+static void aws_iot_benchmark_completion_handler(AWS_IoT_Client *pClient, IoT_Error_t rc, void *pData) {
+	IOT_UNUSED(pClient);
+
+	aws_iot_benchmark_record(rc, aws_iot_benchmark_elapsed_us(&enqueueTime[(intptr_t) pData]));
+}
+
+static void *aws_iot_benchmark_network_thread_runner(void *ptr) {
+	AWS_IoT_Client *pClient = (AWS_IoT_Client *) ptr;
+
+	while(false == terminate_network_thread) {
+		aws_iot_mqtt_publish_queue_run(pClient, &publishQueue, 10);
+	}
+
+	return NULL;
+}
+
+static void *aws_iot_benchmark_queue_publish_thread_runner(void *ptr) {
+	BenchmarkThreadData *pThreadData = (BenchmarkThreadData *) ptr;
+	IoT_Publish_Message_Params params;
+	char cPayload[100];
+	intptr_t index;
+	IoT_Error_t rc;
+	int i;
+
+	for(i = 0; i < PUBLISH_QUEUE_BENCHMARK_MESSAGE_COUNT; i++) {
+		aws_iot_benchmark_build_message(&params, cPayload, sizeof(cPayload), pThreadData->threadId, i);
+		index = (intptr_t) pThreadData->threadId * PUBLISH_QUEUE_BENCHMARK_MESSAGE_COUNT + i;
+		gettimeofday(&enqueueTime[index], NULL);
+		do {
+			rc = aws_iot_mqtt_publish_queue_add(&publishQueue, PUBLISH_QUEUE_LANE_NORMAL, INTEGRATION_TEST_TOPIC,
+												strlen(INTEGRATION_TEST_TOPIC), &params,
+												aws_iot_benchmark_completion_handler, (void *) index);
+			if(MQTT_PUBLISH_QUEUE_FULL_ERROR == rc) {
+				usleep(100);
+			}
+		} while(MQTT_PUBLISH_QUEUE_FULL_ERROR == rc);
+		if(SUCCESS != rc) {
+			aws_iot_benchmark_record(rc, 0);
+		}
+	}
+
+	return NULL;
+}
+
+static int aws_iot_benchmark_run(AWS_IoT_Client *pClient, bool useQueue) {
+	pthread_t publishThread[PUBLISH_QUEUE_BENCHMARK_THREAD_COUNT], networkThread;
+	BenchmarkThreadData threadData[PUBLISH_QUEUE_BENCHMARK_THREAD_COUNT];
+	struct timeval start;
+	unsigned int done;
+	int i;
+
+	memset(&result, 0, sizeof(result));
+	terminate_network_thread = false;
+	aws_iot_mqtt_publish_queue_init(&publishQueue);
+
+	gettimeofday(&start, NULL);
+	if(0 != pthread_create(&networkThread, NULL, useQueue ? aws_iot_benchmark_network_thread_runner
+														  : aws_iot_benchmark_yield_thread_runner, pClient)) {
+		return -1;
+	}
+	for(i = 0; i < PUBLISH_QUEUE_BENCHMARK_THREAD_COUNT; i++) {
+		threadData[i].pClient = pClient;
+		threadData[i].threadId = i;
+		pthread_create(&publishThread[i], NULL, useQueue ? aws_iot_benchmark_queue_publish_thread_runner
+														 : aws_iot_benchmark_direct_publish_thread_runner,
+					   &threadData[i]);
+	}
+	for(i = 0; i < PUBLISH_QUEUE_BENCHMARK_THREAD_COUNT; i++) {
+		pthread_join(publishThread[i], NULL);
+	}
+
+	/* Queued messages complete on the network thread after the producers returned */
+	do {
+		pthread_mutex_lock(&resultLock);
+		done = result.messages + result.errors;
+		pthread_mutex_unlock(&resultLock);
+		if(done < BENCHMARK_MESSAGE_COUNT) {
+			usleep(1000);
+		}
+	} while(done < BENCHMARK_MESSAGE_COUNT && aws_iot_benchmark_elapsed_us(&start) < 60000000);
+	result.elapsed_us = aws_iot_benchmark_elapsed_us(&start);
+
+	terminate_network_thread = true;
+	pthread_join(networkThread, NULL);
+
+	printf("\n%-28s %8u msgs %6u errors %8u retries %10.1f msgs/s %10.1f us avg %10llu us max",
+		   useQueue ? "Publish queue, one thread" : "aws_iot_mqtt_publish", result.messages, result.errors,
+		   result.retries, (double) result.messages * 1000000 / (double) result.elapsed_us,
+		   result.messages ? (double) result.totalLatency_us / result.messages : 0.0,
+		   (unsigned long long) result.maxLatency_us);
+
+	return (BENCHMARK_MESSAGE_COUNT == result.messages) ? 0 : -2;
+}
+
+int aws_iot_mqtt_tests_publish_queue_benchmark() {
+	char certDirectory[15] = "../../certs";
+	char clientCRT[PATH_MAX + 1];
+	char clientKey[PATH_MAX + 1];
+	char CurrentWD[PATH_MAX + 1];
+	char root_CA[PATH_MAX + 1];
+	char clientId[50];
+	IoT_Client_Init_Params initParams = IoT_Client_Init_Params_initializer;
+	IoT_Client_Connect_Params connectParams = iotClientConnectParamsDefault;
+	AWS_IoT_Client client;
+	IoT_Error_t rc;
+	int test_result;
+
+	getcwd(CurrentWD, sizeof(CurrentWD));
+	snprintf(root_CA, PATH_MAX + 1, "%s/%s/%s", CurrentWD, certDirectory, AWS_IOT_ROOT_CA_FILENAME);
+	snprintf(clientCRT, PATH_MAX + 1, "%s/%s/%s", CurrentWD, certDirectory, AWS_IOT_CERTIFICATE_FILENAME);
+	snprintf(clientKey, PATH_MAX + 1, "%s/%s/%s", CurrentWD, certDirectory, AWS_IOT_PRIVATE_KEY_FILENAME);
+	srand((unsigned int) time(NULL));
+	snprintf(clientId, 50, "%s_%d", INTEGRATION_TEST_CLIENT_ID, rand() % 10000);
+
+	initParams.pHostURL = AWS_IOT_MQTT_HOST;
+	initParams.port = AWS_IOT_MQTT_PORT;
+	initParams.pRootCALocation = root_CA;
+	initParams.pDeviceCertLocation = clientCRT;
+	initParams.pDevicePrivateKeyLocation = clientKey;
+	initParams.mqttCommandTimeout_ms = 10000;
+	initParams.tlsHandshakeTimeout_ms = 10000;
+	initParams.disconnectHandler = aws_iot_benchmark_disconnect_callback_handler;
+	initParams.enableAutoReconnect = false;
+	initParams.isBlockOnThreadLockEnabled = true;
+	aws_iot_mqtt_init(&client, &initParams);
+
+	connectParams.keepAliveIntervalInSec = 10;
+	connectParams.isCleanSession = true;
+	connectParams.MQTTVersion = MQTT_3_1_1;
+	connectParams.pClientID = clientId;
+	connectParams.clientIDLen = (uint16_t) strlen(clientId);
+
+	rc = aws_iot_mqtt_connect(&client, &connectParams);
+	if(SUCCESS != rc) {
+		IOT_ERROR("ERROR Connecting %d\n", rc);
+		return -1;
+	}
+
+	printf("\n%d threads publishing %d messages each", PUBLISH_QUEUE_BENCHMARK_THREAD_COUNT,
+		   PUBLISH_QUEUE_BENCHMARK_MESSAGE_COUNT);
+	test_result = aws_iot_benchmark_run(&client, false);
+	if(0 == test_result) {
+		test_result = aws_iot_benchmark_run(&client, true);
+	}
+	printf("\nPublish queue refused %u messages with a full lane\n", publishQueue.refusedCount);
+
+	aws_iot_mqtt_disconnect(&client);
+	return test_result;
+}
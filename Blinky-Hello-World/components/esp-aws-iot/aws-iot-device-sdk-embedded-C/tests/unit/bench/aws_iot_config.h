@@ -0,0 +1,33 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_config.h
+ * @brief Unit test config with a gateway sized subscription table
+ *
+ * Used instead of tests/unit/include/aws_iot_config.h by
+ * `make run-dispatch-benchmark`, so the subscribe dispatch benchmark can
+ * measure large tables while the unit tests keep their own limit.
+ */
+
+#ifndef IOT_TESTS_UNIT_BENCH_CONFIG_H_
+#define IOT_TESTS_UNIT_BENCH_CONFIG_H_
+
+#include "../include/aws_iot_config.h"
+
+#undef AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS
+#define AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS 64 ///< Subscriptions the dispatch benchmark goes up to
+
+#endif /* IOT_TESTS_UNIT_BENCH_CONFIG_H_ */
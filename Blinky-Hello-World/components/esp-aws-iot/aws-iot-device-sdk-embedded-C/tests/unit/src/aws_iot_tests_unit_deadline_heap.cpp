@@ -0,0 +1,41 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+/**
+ * @file aws_iot_tests_unit_deadline_heap.cpp
+ * @brief IoT Client Unit Testing - Deadline Heap Tests
+ */
+
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTest/TestHarness_c.h>
+
+TEST_GROUP_C(DeadlineHeapTests){
+	TEST_GROUP_C_SETUP_WRAPPER(DeadlineHeapTests)
+	TEST_GROUP_C_TEARDOWN_WRAPPER(DeadlineHeapTests)
+};
+
+/* T:1 - Timers keep microsecond resolution */
+TEST_GROUP_C_WRAPPER(DeadlineHeapTests, TimerMicrosecondResolution)
+/* T:2 - The earliest deadline is reported, also after a timer is restarted */
+TEST_GROUP_C_WRAPPER(DeadlineHeapTests, EarliestDeadlineFirst)
+/* T:3 - A cancelled timer no longer wakes anyone */
+TEST_GROUP_C_WRAPPER(DeadlineHeapTests, CancelledTimerRemoved)
+/* T:4 - Expired timers are reported once and dropped */
+TEST_GROUP_C_WRAPPER(DeadlineHeapTests, ExpiredTimersDropped)
+/* T:5 - A full heap refuses new timers */
+TEST_GROUP_C_WRAPPER(DeadlineHeapTests, FullHeapRefuses)
+/* T:6 - The client schedules its keep alive and the yield wakes up for it */
+TEST_GROUP_C_WRAPPER(DeadlineHeapTests, KeepAliveScheduled)
+/* T:7 - A yield waiting to reconnect sleeps instead of spinning */
+TEST_GROUP_C_WRAPPER(DeadlineHeapTests, ReconnectWaitSleeps)
@@ -0,0 +1,45 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+/**
+ * @file aws_iot_tests_unit_payload.cpp
+ * @brief IoT Client Unit Testing - Payload Tests
+ */
+
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTest/TestHarness_c.h>
+
+TEST_GROUP_C(PayloadTests){
+	TEST_GROUP_C_SETUP_WRAPPER(PayloadTests)
+	TEST_GROUP_C_TEARDOWN_WRAPPER(PayloadTests)
+};
+
+/* P:1 - Every field type comes back unchanged from CBOR */
+TEST_GROUP_C_WRAPPER(PayloadTests, CborRoundTrip)
+/* P:2 - CBOR values are written in their shortest form under integer keys */
+TEST_GROUP_C_WRAPPER(PayloadTests, CborShortestEncoding)
+/* P:3 - Every field type comes back unchanged from JSON and callbacks get the value text */
+TEST_GROUP_C_WRAPPER(PayloadTests, JsonRoundTrip)
+/* P:4 - Unknown keys and values that do not fit their field are skipped */
+TEST_GROUP_C_WRAPPER(PayloadTests, CborSkipsUnknownAndMismatched)
+/* P:5 - Integers and half precision floats decode into float fields */
+TEST_GROUP_C_WRAPPER(PayloadTests, CborNumberConversions)
+/* P:6 - Malformed payloads are refused */
+TEST_GROUP_C_WRAPPER(PayloadTests, MalformedPayloadRefused)
+/* P:7 - A payload larger than the buffer is reported as truncated */
+TEST_GROUP_C_WRAPPER(PayloadTests, EncodeBufferTooSmall)
+/* P:8 - Every topic is published in its own format */
+TEST_GROUP_C_WRAPPER(PayloadTests, PublishPerTopicFormat)
+/* P:9 - Bytes and time per message against JSON */
+TEST_GROUP_C_WRAPPER(PayloadTests, PayloadBenchmark)
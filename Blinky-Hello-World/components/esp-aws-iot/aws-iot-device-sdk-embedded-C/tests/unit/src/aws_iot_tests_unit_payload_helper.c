@@ -0,0 +1,462 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+/**
+ * @file aws_iot_tests_unit_payload_helper.c
+ * @brief IoT Client Unit Testing - Payload Tests Helper
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <CppUTest/TestHarness_c.h>
+
+#include "aws_iot_tests_unit_helper_functions.h"
+#include "aws_iot_tests_unit_mock_tls_params.h"
+#include "aws_iot_payload.h"
+#include "aws_iot_log.h"
+
+/* Messages encoded and decoded per format in the benchmark */
+#define PAYLOAD_BENCHMARK_MESSAGES 100000
+#define PAYLOAD_BUFFER_SIZE 512
+
+static IoT_Client_Init_Params initParams;
+static IoT_Client_Connect_Params connectParams;
+static AWS_IoT_Client iotClient;
+
+static uint8_t payloadBuffer[PAYLOAD_BUFFER_SIZE];
+
+/* One field of every type */
+static int32_t i32Value;
+static int16_t i16Value;
+static int8_t i8Value;
+static uint32_t u32Value;
+static uint16_t u16Value;
+static uint8_t u8Value;
+static float floatValue;
+static double doubleValue;
+static bool boolValue;
+static char stringValue[16];
+static uint8_t objectValue[32];
+
+static jsonStruct_t i32Field = {"i32", &i32Value, sizeof(i32Value), SHADOW_JSON_INT32, NULL};
+static jsonStruct_t i16Field = {"i16", &i16Value, sizeof(i16Value), SHADOW_JSON_INT16, NULL};
+static jsonStruct_t i8Field = {"i8", &i8Value, sizeof(i8Value), SHADOW_JSON_INT8, NULL};
+static jsonStruct_t u32Field = {"u32", &u32Value, sizeof(u32Value), SHADOW_JSON_UINT32, NULL};
+static jsonStruct_t u16Field = {"u16", &u16Value, sizeof(u16Value), SHADOW_JSON_UINT16, NULL};
+static jsonStruct_t u8Field = {"u8", &u8Value, sizeof(u8Value), SHADOW_JSON_UINT8, NULL};
+static jsonStruct_t floatField = {"float", &floatValue, sizeof(floatValue), SHADOW_JSON_FLOAT, NULL};
+static jsonStruct_t doubleField = {"double", &doubleValue, sizeof(doubleValue), SHADOW_JSON_DOUBLE, NULL};
+static jsonStruct_t boolField = {"bool", &boolValue, sizeof(boolValue), SHADOW_JSON_BOOL, NULL};
+static jsonStruct_t stringField = {"string", stringValue, sizeof(stringValue), SHADOW_JSON_STRING, NULL};
+static jsonStruct_t objectField = {"object", objectValue, sizeof(objectValue), SHADOW_JSON_OBJECT, NULL};
+
+static jsonStruct_t *const allFields[] = {&i32Field, &i16Field, &i8Field, &u32Field, &u16Field, &u8Field,
+										  &floatField, &doubleField, &boolField, &stringField, &objectField};
+static const AWS_IoT_Payload_Schema allSchema = {allFields, sizeof(allFields) / sizeof(allFields[0])};
+
+/* The telemetry of the thermostat */
+static float temperature;
+static uint8_t soundLevel;
+static bool roomOccupancy;
+static char hvacStatus[16];
+
+static jsonStruct_t temperatureField = {"temperature", &temperature, sizeof(temperature), SHADOW_JSON_FLOAT, NULL};
+static jsonStruct_t soundField = {"sound", &soundLevel, sizeof(soundLevel), SHADOW_JSON_UINT8, NULL};
+static jsonStruct_t occupancyField = {"roomOccupancy", &roomOccupancy, sizeof(roomOccupancy), SHADOW_JSON_BOOL, NULL};
+static jsonStruct_t hvacField = {"hvacStatus", hvacStatus, sizeof(hvacStatus), SHADOW_JSON_STRING, NULL};
+
+static jsonStruct_t *const thermostatFields[] = {&temperatureField, &soundField, &occupancyField, &hvacField};
+static const AWS_IoT_Payload_Schema thermostatSchema = {thermostatFields, 4};
+
+static int callbackCount;
+static char callbackValue[32];
+
+static void valueCallback(const char *pJsonValueBuffer, uint32_t valueLength, jsonStruct_t *pJsonStruct_t) {
+	IOT_UNUSED(pJsonStruct_t);
+
+	callbackCount++;
+	snprintf(callbackValue, sizeof(callbackValue), "%.*s", (int) valueLength, pJsonValueBuffer);
+}
+
+static void setAllValues(void) {
+	/* The CBOR encoding of {"a": [1, 2]} */
+	static const uint8_t cborObject[] = {0xA1, 0x61, 'a', 0x82, 0x01, 0x02};
+
+	i32Value = -100000;
+	i16Value = -300;
+	i8Value = -7;
+	u32Value = 4000000000u;
+	u16Value = 60000;
+	u8Value = 200;
+	floatValue = 21.5f;
+	doubleValue = -1234.0625;
+	boolValue = true;
+	strcpy(stringValue, "HEATING");
+	memset(objectValue, 0, sizeof(objectValue));
+	memcpy(objectValue, cborObject, sizeof(cborObject));
+}
+
+static void clearAllValues(void) {
+	i32Value = 0;
+	i16Value = 0;
+	i8Value = 0;
+	u32Value = 0;
+	u16Value = 0;
+	u8Value = 0;
+	floatValue = 0;
+	doubleValue = 0;
+	boolValue = false;
+	memset(stringValue, 0, sizeof(stringValue));
+	memset(objectValue, 0, sizeof(objectValue));
+}
+
+static void checkAllValues(void) {
+	CHECK_EQUAL_C_INT(-100000, i32Value);
+	CHECK_EQUAL_C_INT(-300, i16Value);
+	CHECK_EQUAL_C_INT(-7, i8Value);
+	CHECK_EQUAL_C_UBYTE(1, 4000000000u == u32Value);
+	CHECK_EQUAL_C_INT(60000, u16Value);
+	CHECK_EQUAL_C_INT(200, u8Value);
+	CHECK_EQUAL_C_REAL(21.5, floatValue, 0.0001);
+	CHECK_EQUAL_C_REAL(-1234.0625, doubleValue, 0.0001);
+	CHECK_EQUAL_C_UBYTE(1, boolValue);
+	CHECK_EQUAL_C_STRING("HEATING", stringValue);
+}
+
+TEST_GROUP_C_SETUP(PayloadTests) {
+	IoT_Error_t rc;
+
+	ResetTLSBuffer();
+	InitMQTTParamsSetup(&initParams, AWS_IOT_MQTT_HOST, AWS_IOT_MQTT_PORT, false, NULL);
+	rc = aws_iot_mqtt_init(&iotClient, &initParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	ConnectMQTTParamsSetup(&connectParams, AWS_IOT_MQTT_CLIENT_ID, (uint16_t) strlen(AWS_IOT_MQTT_CLIENT_ID));
+	setTLSRxBufferForConnack(&connectParams, 0, 0);
+	rc = aws_iot_mqtt_connect(&iotClient, &connectParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	ResetTLSBuffer();
+
+	i32Field.cb = NULL;
+	floatField.cb = NULL;
+	stringField.cb = NULL;
+	callbackCount = 0;
+	callbackValue[0] = '\0';
+	memset(payloadBuffer, 0, sizeof(payloadBuffer));
+}
+
+TEST_GROUP_C_TEARDOWN(PayloadTests) {
+	IoT_Error_t rc = aws_iot_mqtt_disconnect(&iotClient);
+	IOT_UNUSED(rc);
+}
+
+/* P:1 - Every field type comes back unchanged from CBOR */
+TEST_C(PayloadTests, CborRoundTrip) {
+	uint32_t updated = 0;
+	size_t length = 0;
+
+	IOT_DEBUG("-->Running Payload Tests - P:1 - Every field type comes back unchanged from CBOR \n");
+
+	setAllValues();
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_payload_encode(AWS_IOT_PAYLOAD_CBOR, &allSchema, payloadBuffer,
+														  sizeof(payloadBuffer), &length));
+
+	clearAllValues();
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_payload_decode(AWS_IOT_PAYLOAD_CBOR, &allSchema, payloadBuffer, length,
+														  &updated));
+	CHECK_EQUAL_C_INT(0x7FF, updated);
+	checkAllValues();
+	CHECK_EQUAL_C_INT(0xA1, objectValue[0]);
+	CHECK_EQUAL_C_INT(0x02, objectValue[5]);
+	CHECK_EQUAL_C_INT(0, objectValue[6]);
+
+	IOT_DEBUG("-->Success - P:1 - Every field type comes back unchanged from CBOR \n");
+}
+
+/* P:2 - CBOR values are written in their shortest form under integer keys */
+TEST_C(PayloadTests, CborShortestEncoding) {
+	static const uint8_t expected[] = {
+			0xA4,                               /* map of 4 pairs */
+			0x00, 0xFA, 0x41, 0xAC, 0x00, 0x00, /* 0: float 21.5 */
+			0x01, 0x18, 0x2A,                   /* 1: 42 */
+			0x02, 0xF5,                         /* 2: true */
+			0x03, 0x62, 'o', 'n'                /* 3: "on" */
+	};
+	static const uint8_t negative[] = {0xA1, 0x00, 0x39, 0x01, 0x2B};
+	int32_t value = -300;
+	jsonStruct_t field = {"v", &value, sizeof(value), SHADOW_JSON_INT32, NULL};
+	jsonStruct_t *const fields[] = {&field};
+	AWS_IoT_Payload_Schema schema = {fields, 1};
+	size_t length = 0;
+
+	IOT_DEBUG("-->Running Payload Tests - P:2 - CBOR values are written in their shortest form \n");
+
+	temperature = 21.5f;
+	soundLevel = 42;
+	roomOccupancy = true;
+	strcpy(hvacStatus, "on");
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_payload_encode(AWS_IOT_PAYLOAD_CBOR, &thermostatSchema, payloadBuffer,
+														  sizeof(payloadBuffer), &length));
+	CHECK_EQUAL_C_INT(sizeof(expected), length);
+	CHECK_EQUAL_C_INT(0, memcmp(expected, payloadBuffer, sizeof(expected)));
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_payload_encode(AWS_IOT_PAYLOAD_CBOR, &schema, payloadBuffer,
+														  sizeof(payloadBuffer), &length));
+	CHECK_EQUAL_C_INT(sizeof(negative), length);
+	CHECK_EQUAL_C_INT(0, memcmp(negative, payloadBuffer, sizeof(negative)));
+
+	IOT_DEBUG("-->Success - P:2 - CBOR values are written in their shortest form \n");
+}
+
+/* P:3 - Every field type comes back unchanged from JSON and callbacks get the value text */
+TEST_C(PayloadTests, JsonRoundTrip) {
+	static const char jsonObject[] = "{\"a\":[1,2]}";
+	uint32_t updated = 0;
+	size_t length = 0;
+
+	IOT_DEBUG("-->Running Payload Tests - P:3 - Every field type comes back unchanged from JSON \n");
+
+	setAllValues();
+	memset(objectValue, 0, sizeof(objectValue));
+	memcpy(objectValue, jsonObject, sizeof(jsonObject));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_payload_encode(AWS_IOT_PAYLOAD_JSON, &allSchema, payloadBuffer,
+														  sizeof(payloadBuffer), &length));
+	CHECK_EQUAL_C_INT(strlen((const char *) payloadBuffer), length);
+
+	clearAllValues();
+	floatField.cb = valueCallback;
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_payload_decode(AWS_IOT_PAYLOAD_JSON, &allSchema, payloadBuffer, length,
+														  &updated));
+	CHECK_EQUAL_C_INT(0x7FF, updated);
+	checkAllValues();
+	CHECK_EQUAL_C_STRING(jsonObject, (const char *) objectValue);
+	CHECK_EQUAL_C_INT(1, callbackCount);
+	CHECK_EQUAL_C_REAL(21.5, atof(callbackValue), 0.0001);
+
+	IOT_DEBUG("-->Success - P:3 - Every field type comes back unchanged from JSON \n");
+}
+
+/* P:4 - Unknown keys and values that do not fit their field are skipped */
+TEST_C(PayloadTests, CborSkipsUnknownAndMismatched) {
+	static const uint8_t payload[] = {
+			0xA7,                               /* map of 7 pairs */
+			0x63, 'x', 'y', 'z', 0x01,          /* "xyz": 1, text key */
+			0x18, 0x40, 0xA1, 0x01, 0x82, 0x01, 0x02, /* 64: {1: [1, 2]}, key outside the schema */
+			0x02, 0x19, 0x01, 0x00,             /* 2: 256, too large for int8 */
+			0x05, 0x20,                         /* 5: -1, negative for uint8 */
+			0x09, 0x70, 'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h', 'i', 'j', 'k', 'l', 'm', 'n', 'o', 'p',
+			/* 9: 16 characters, too long for string */
+			0x00, 0x38, 0x63,                   /* 0: -100 */
+			0x08, 0xF4                          /* 8: false */
+	};
+	uint32_t updated = 0;
+
+	IOT_DEBUG("-->Running Payload Tests - P:4 - Unknown keys and mismatched values are skipped \n");
+
+	setAllValues();
+	i32Field.cb = valueCallback;
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_payload_decode(AWS_IOT_PAYLOAD_CBOR, &allSchema, payload, sizeof(payload),
+														  &updated));
+	CHECK_EQUAL_C_INT((1 << 0) | (1 << 8), updated);
+	CHECK_EQUAL_C_INT(-100, i32Value);
+	CHECK_EQUAL_C_INT(-7, i8Value);
+	CHECK_EQUAL_C_INT(200, u8Value);
+	CHECK_EQUAL_C_STRING("HEATING", stringValue);
+	CHECK_EQUAL_C_UBYTE(0, boolValue);
+	CHECK_EQUAL_C_INT(1, callbackCount);
+	CHECK_EQUAL_C_INT(0x38, (uint8_t) callbackValue[0]);
+	CHECK_EQUAL_C_INT(0x63, (uint8_t) callbackValue[1]);
+
+	IOT_DEBUG("-->Success - P:4 - Unknown keys and mismatched values are skipped \n");
+}
+
+/* P:5 - Integers and half precision floats decode into float fields */
+TEST_C(PayloadTests, CborNumberConversions) {
+	static const uint8_t payload[] = {
+			0xA2,
+			0x06, 0xF9, 0x3E, 0x00, /* 6: half precision 1.5 */
+			0x07, 0x29              /* 7: -10 */
+	};
+	static const uint8_t subnormal[] = {0xA1, 0x06, 0xF9, 0x80, 0x01};
+	uint32_t updated = 0;
+
+	IOT_DEBUG("-->Running Payload Tests - P:5 - Integers and half floats decode into float fields \n");
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_payload_decode(AWS_IOT_PAYLOAD_CBOR, &allSchema, payload, sizeof(payload),
+														  &updated));
+	CHECK_EQUAL_C_INT((1 << 6) | (1 << 7), updated);
+	CHECK_EQUAL_C_REAL(1.5, floatValue, 0.0001);
+	CHECK_EQUAL_C_REAL(-10.0, doubleValue, 0.0001);
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_payload_decode(AWS_IOT_PAYLOAD_CBOR, &allSchema, subnormal,
+														  sizeof(subnormal), &updated));
+	CHECK_EQUAL_C_REAL(-5.9604645e-8, floatValue, 1e-12);
+
+	IOT_DEBUG("-->Success - P:5 - Integers and half floats decode into float fields \n");
+}
+
+/* P:6 - Malformed payloads are refused */
+TEST_C(PayloadTests, MalformedPayloadRefused) {
+	static const uint8_t array[] = {0x82, 0x01, 0x02};
+	static const uint8_t truncated[] = {0xA2, 0x00, 0x01, 0x01};
+	static const uint8_t longString[] = {0xA1, 0x09, 0x7A, 0xFF, 0xFF, 0xFF, 0xFF, 'a'};
+	static const uint8_t deep[] = {0xA1, 0x0A, 0x81, 0x81, 0x81, 0x81, 0x81, 0x81, 0x81, 0x81, 0x81, 0x00};
+	static const char *pJson = "[1, 2]";
+
+	IOT_DEBUG("-->Running Payload Tests - P:6 - Malformed payloads are refused \n");
+
+	CHECK_EQUAL_C_INT(JSON_PARSE_ERROR, aws_iot_payload_decode(AWS_IOT_PAYLOAD_CBOR, &allSchema, array,
+																   sizeof(array), NULL));
+	CHECK_EQUAL_C_INT(JSON_PARSE_ERROR, aws_iot_payload_decode(AWS_IOT_PAYLOAD_CBOR, &allSchema, truncated,
+																   sizeof(truncated), NULL));
+	CHECK_EQUAL_C_INT(JSON_PARSE_ERROR, aws_iot_payload_decode(AWS_IOT_PAYLOAD_CBOR, &allSchema, longString,
+																   sizeof(longString), NULL));
+	CHECK_EQUAL_C_INT(JSON_PARSE_ERROR, aws_iot_payload_decode(AWS_IOT_PAYLOAD_CBOR, &allSchema, deep,
+																   sizeof(deep), NULL));
+	CHECK_EQUAL_C_INT(JSON_PARSE_ERROR, aws_iot_payload_decode(AWS_IOT_PAYLOAD_CBOR, &allSchema, payloadBuffer,
+																   0, NULL));
+	CHECK_EQUAL_C_INT(JSON_PARSE_ERROR, aws_iot_payload_decode(AWS_IOT_PAYLOAD_JSON, &allSchema,
+																   (const uint8_t *) pJson, strlen(pJson), NULL));
+
+	IOT_DEBUG("-->Success - P:6 - Malformed payloads are refused \n");
+}
+
+/* P:7 - A payload larger than the buffer is reported as truncated */
+TEST_C(PayloadTests, EncodeBufferTooSmall) {
+	size_t length = 0;
+
+	IOT_DEBUG("-->Running Payload Tests - P:7 - A payload larger than the buffer is reported as truncated \n");
+
+	temperature = 21.5f;
+	soundLevel = 42;
+	roomOccupancy = true;
+	strcpy(hvacStatus, "on");
+	CHECK_EQUAL_C_INT(SHADOW_JSON_BUFFER_TRUNCATED, aws_iot_payload_encode(AWS_IOT_PAYLOAD_CBOR, &thermostatSchema,
+																		   payloadBuffer, 15, &length));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_payload_encode(AWS_IOT_PAYLOAD_CBOR, &thermostatSchema, payloadBuffer, 16,
+													  &length));
+	CHECK_EQUAL_C_INT(SHADOW_JSON_BUFFER_TRUNCATED, aws_iot_payload_encode(AWS_IOT_PAYLOAD_JSON, &thermostatSchema,
+																		   payloadBuffer, 16, &length));
+
+	IOT_DEBUG("-->Success - P:7 - A payload larger than the buffer is reported as truncated \n");
+}
+
+/* P:8 - Every topic is published in its own format */
+TEST_C(PayloadTests, PublishPerTopicFormat) {
+	static const char *pJsonTopic = "sdk/Test/json";
+	static const char *pCborTopic = "sdk/Test/cbor";
+	AWS_IoT_Payload_Topic jsonTopic = {pJsonTopic, (uint16_t) strlen(pJsonTopic), AWS_IOT_PAYLOAD_JSON,
+									   &thermostatSchema};
+	AWS_IoT_Payload_Topic cborTopic = {pCborTopic, (uint16_t) strlen(pCborTopic), AWS_IOT_PAYLOAD_CBOR,
+									   &thermostatSchema};
+	uint32_t updated = 0;
+
+	IOT_DEBUG("-->Running Payload Tests - P:8 - Every topic is published in its own format \n");
+
+	temperature = 19.25f;
+	soundLevel = 7;
+	roomOccupancy = false;
+	strcpy(hvacStatus, "COOLING");
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_payload_publish(&iotClient, &jsonTopic, QOS0, payloadBuffer,
+														   sizeof(payloadBuffer)));
+	CHECK_EQUAL_C_STRING(pJsonTopic, LastPublishMessageTopic);
+	CHECK_EQUAL_C_INT('{', LastPublishMessagePayload[0]);
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_payload_publish(&iotClient, &cborTopic, QOS0, payloadBuffer,
+														   sizeof(payloadBuffer)));
+	CHECK_EQUAL_C_STRING(pCborTopic, LastPublishMessageTopic);
+	CHECK_EQUAL_C_INT(0xA4, (uint8_t) LastPublishMessagePayload[0]);
+
+	temperature = 0;
+	strcpy(hvacStatus, "");
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_payload_decode(AWS_IOT_PAYLOAD_CBOR, &thermostatSchema,
+														  (const uint8_t *) LastPublishMessagePayload,
+														  lastPublishMessagePayloadLen, &updated));
+	CHECK_EQUAL_C_INT(0xF, updated);
+	CHECK_EQUAL_C_REAL(19.25, temperature, 0.0001);
+	CHECK_EQUAL_C_STRING("COOLING", hvacStatus);
+
+	IOT_DEBUG("-->Success - P:8 - Every topic is published in its own format \n");
+}
+
+static double elapsedNs(const struct timespec *pStart, const struct timespec *pEnd) {
+	return (pEnd->tv_sec - pStart->tv_sec) * 1e9 + (pEnd->tv_nsec - pStart->tv_nsec);
+}
+
+/* The telemetry the thermostat formatted with snprintf before the payload layer */
+static size_t printfThermostat(char *pBuffer, size_t bufferSize) {
+	return (size_t) snprintf(pBuffer, bufferSize,
+							 "{\"temperature\":%f,\"sound\":%d,\"roomOccupancy\":%s,\"hvacStatus\":\"%s\"}",
+							 temperature, soundLevel, roomOccupancy ? "true" : "false", hvacStatus);
+}
+
+static void benchmarkFormat(const char *pName, AWS_IoT_Payload_Format format, const AWS_IoT_Payload_Schema *pSchema) {
+	struct timespec start, middle, end;
+	size_t length = 0;
+	int i;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for(i = 0; i < PAYLOAD_BENCHMARK_MESSAGES; i++) {
+		CHECK_EQUAL_C_INT(SUCCESS, aws_iot_payload_encode(format, pSchema, payloadBuffer, sizeof(payloadBuffer),
+															  &length));
+	}
+	clock_gettime(CLOCK_MONOTONIC, &middle);
+	for(i = 0; i < PAYLOAD_BENCHMARK_MESSAGES; i++) {
+		CHECK_EQUAL_C_INT(SUCCESS, aws_iot_payload_decode(format, pSchema, payloadBuffer, length, NULL));
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	printf("%-22s %6u %12.0f %12.0f\n", pName, (unsigned) length,
+		   elapsedNs(&start, &middle) / PAYLOAD_BENCHMARK_MESSAGES,
+		   elapsedNs(&middle, &end) / PAYLOAD_BENCHMARK_MESSAGES);
+}
+
+/* P:9 - Bytes and time per message against JSON */
+TEST_C(PayloadTests, PayloadBenchmark) {
+	struct timespec start, end;
+	size_t length = 0;
+	int i;
+
+	IOT_DEBUG("-->Running Payload Tests - P:9 - Bytes and time per message against JSON \n");
+
+	temperature = 22.75f;
+	soundLevel = 37;
+	roomOccupancy = true;
+	strcpy(hvacStatus, "HEATING");
+	setAllValues();
+	strcpy((char *) objectValue, "living room");
+	objectField.type = SHADOW_JSON_STRING;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for(i = 0; i < PAYLOAD_BENCHMARK_MESSAGES; i++) {
+		length = printfThermostat((char *) payloadBuffer, sizeof(payloadBuffer));
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	printf("\nPayload encoding, bytes and ns per message\n");
+	printf("schema and format       bytes       encode       decode\n");
+	printf("%-22s %6u %12.0f %12s\n", "thermostat snprintf", (unsigned) length,
+		   elapsedNs(&start, &end) / PAYLOAD_BENCHMARK_MESSAGES, "-");
+	benchmarkFormat("thermostat JSON", AWS_IOT_PAYLOAD_JSON, &thermostatSchema);
+	benchmarkFormat("thermostat CBOR", AWS_IOT_PAYLOAD_CBOR, &thermostatSchema);
+	benchmarkFormat("11 fields JSON", AWS_IOT_PAYLOAD_JSON, &allSchema);
+	benchmarkFormat("11 fields CBOR", AWS_IOT_PAYLOAD_CBOR, &allSchema);
+
+	objectField.type = SHADOW_JSON_OBJECT;
+
+	IOT_DEBUG("-->Success - P:9 - Bytes and time per message against JSON \n");
+}
@@ -24,6 +24,7 @@
 
 #include "aws_iot_mqtt_client_interface.h"
 #include "aws_iot_tests_unit_helper_functions.h"
+#include "aws_iot_tests_unit_mock_tls_params.h"
 #include "aws_iot_log.h"
 
 static IoT_Client_Init_Params initParams;
@@ -203,3 +204,93 @@ TEST_C(PublishTests, publishQoS1Success) {
 
 	IOT_DEBUG("-->Success - E:10 - Publish with QoS1 send success, Puback received \n");
 }
+
+/* E:11 - Publish QoS0 vector, short buffers staged, long buffer written in place */
+TEST_C(PublishTests, publishVectorQoS0Success) {
+	IoT_Error_t rc = SUCCESS;
+	IoT_Iovec payload[3];
+	char expected[150];
+	char block[120];
+
+	IOT_DEBUG("-->Running Publish Tests - E:11 - Publish QoS0 vector, short buffers staged, long buffer written in place \n");
+
+	memset(block, 'x', sizeof(block));
+	payload[0].pBuffer = (const unsigned char *) "{\"t\":";
+	payload[0].len = 5;
+	payload[1].pBuffer = (const unsigned char *) "21,\"d\":\"";
+	payload[1].len = 9;
+	payload[2].pBuffer = (const unsigned char *) block;
+	payload[2].len = sizeof(block);
+	memcpy(expected, payload[0].pBuffer, 5);
+	memcpy(&expected[5], payload[1].pBuffer, 9);
+	memcpy(&expected[14], block, sizeof(block));
+
+	testPubMsgParams.qos = QOS0;
+	rc = aws_iot_mqtt_publish_vector(&iotClient, subTopic, subTopicLen, &testPubMsgParams, payload, 3);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_STRING(subTopic, LastPublishMessageTopic);
+	CHECK_EQUAL_C_INT(14 + sizeof(block), lastPublishMessagePayloadLen);
+	CHECK_EQUAL_C_INT(0, memcmp(expected, LastPublishMessagePayload, 14 + sizeof(block)));
+	CHECK_EQUAL_C_INT(2, lastWritevCount);
+
+	IOT_DEBUG("-->Success - E:11 - Publish QoS0 vector, short buffers staged, long buffer written in place \n");
+}
+
+/* E:12 - Publish QoS1 vector success, Puback received */
+TEST_C(PublishTests, publishVectorQoS1Success) {
+	IoT_Error_t rc = SUCCESS;
+	IoT_Iovec payload;
+
+	IOT_DEBUG("-->Running Publish Tests - E:12 - Publish QoS1 vector success, Puback received \n");
+
+	payload.pBuffer = (const unsigned char *) cPayload;
+	payload.len = strlen(cPayload);
+
+	setTLSRxBufferForPuback();
+	rc = aws_iot_mqtt_publish_vector(&iotClient, subTopic, subTopicLen, &testPubMsgParams, &payload, 1);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_STRING(cPayload, LastPublishMessagePayload);
+
+	IOT_DEBUG("-->Success - E:12 - Publish QoS1 vector success, Puback received \n");
+}
+
+/* E:13 - Publish vector with too many buffers */
+TEST_C(PublishTests, publishVectorTooManyBuffers) {
+	IoT_Error_t rc = SUCCESS;
+	IoT_Iovec payload[AWS_IOT_MQTT_PUBLISH_MAX_IOVECS + 1];
+	size_t i;
+
+	IOT_DEBUG("-->Running Publish Tests - E:13 - Publish vector with too many buffers \n");
+
+	for(i = 0; i < AWS_IOT_MQTT_PUBLISH_MAX_IOVECS + 1; i++) {
+		payload[i].pBuffer = (const unsigned char *) "x";
+		payload[i].len = 1;
+	}
+
+	rc = aws_iot_mqtt_publish_vector(&iotClient, subTopic, subTopicLen, &testPubMsgParams, payload,
+									 AWS_IOT_MQTT_PUBLISH_MAX_IOVECS + 1);
+	CHECK_EQUAL_C_INT(LIMIT_EXCEEDED_ERROR, rc);
+
+	IOT_DEBUG("-->Success - E:13 - Publish vector with too many buffers \n");
+}
+
+/* E:14 - Publish QoS0 payload larger than the TX buffer */
+TEST_C(PublishTests, publishLargerThanTxBuffer) {
+	IoT_Error_t rc = SUCCESS;
+	static char largePayload[AWS_IOT_MQTT_TX_BUF_LEN * 2];
+
+	IOT_DEBUG("-->Running Publish Tests - E:14 - Publish QoS0 payload larger than the TX buffer \n");
+
+	memset(largePayload, 'p', sizeof(largePayload));
+	testPubMsgParams.qos = QOS0;
+	testPubMsgParams.payload = largePayload;
+	testPubMsgParams.payloadLen = sizeof(largePayload);
+
+	rc = aws_iot_mqtt_publish(&iotClient, subTopic, subTopicLen, &testPubMsgParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(sizeof(largePayload), lastPublishMessagePayloadLen);
+	CHECK_EQUAL_C_INT(0, memcmp(largePayload, LastPublishMessagePayload, sizeof(largePayload)));
+	CHECK_EQUAL_C_INT(2, lastWritevCount);
+
+	IOT_DEBUG("-->Success - E:14 - Publish QoS0 payload larger than the TX buffer \n");
+}
@@ -0,0 +1,341 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_tests_unit_shadow_delta_dispatch_helper.c
+ * @brief IoT Client Unit Testing - Shadow Delta Dispatch Tests Helper
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <CppUTest/TestHarness_c.h>
+
+#include "aws_iot_shadow_interface.h"
+#include "aws_iot_shadow_json.h"
+#include "aws_iot_mqtt_client_common_internal.h"
+#include "aws_iot_tests_unit_helper_functions.h"
+#include "aws_iot_log.h"
+
+/* Deltas dispatched per registration count in the benchmark */
+#define DELTA_BENCHMARK_MESSAGES 20000
+#define MAX_DELTA_KEYS 96
+/* Room for an "actuator_%02d" key with any int */
+#define DELTA_KEY_SIZE sizeof("actuator_-2147483648")
+
+#define SHADOW_DELTA_UPDATE "$aws/things/%s/shadow/update/delta"
+#define KEY_SCAN_TOPIC "sdkTest/keyScan"
+
+#undef AWS_IOT_MY_THING_NAME
+#define AWS_IOT_MY_THING_NAME "AWS-IoT-C-SDK"
+
+static AWS_IoT_Client client;
+static IoT_Client_Connect_Params connectParams;
+static ShadowInitParameters_t shadowInitParams;
+static ShadowConnectParameters_t shadowConnectParams;
+static IoT_Publish_Message_Params testPubMsgParams;
+static char shadowDeltaTopic[MAX_SHADOW_TOPIC_LENGTH_BYTES];
+
+static char deltaKeys[MAX_DELTA_KEYS][DELTA_KEY_SIZE];
+static jsonStruct_t deltaStructs[MAX_DELTA_KEYS];
+static int32_t deltaValues[MAX_DELTA_KEYS];
+static int registeredCount;
+
+static int callbackOrder[MAX_DELTA_KEYS];
+static int callbackCount;
+
+static void deltaKeyCallback(const char *pJsonStringData, uint32_t JsonStringDataLen, jsonStruct_t *pContext) {
+	IOT_UNUSED(pJsonStringData);
+	IOT_UNUSED(JsonStringDataLen);
+
+	if(callbackCount < MAX_DELTA_KEYS) {
+		callbackOrder[callbackCount] = (int) (pContext - deltaStructs);
+	}
+	callbackCount++;
+}
+
+/* The dispatch the delta callback did before the state walk: every registered key
+ * scans the whole document */
+static void keyScanCallback(AWS_IoT_Client *pClient, char *topicName, uint16_t topicNameLen,
+							IoT_Publish_Message_Params *params, void *pData) {
+	static char rxBuf[SHADOW_MAX_SIZE_OF_RX_BUFFER];
+	void *pJsonHandler = NULL;
+	int32_t tokenCount;
+	int32_t dataPosition;
+	uint32_t dataLength;
+	int i;
+
+	IOT_UNUSED(pClient);
+	IOT_UNUSED(topicName);
+	IOT_UNUSED(topicNameLen);
+	IOT_UNUSED(pData);
+
+	memcpy(rxBuf, params->payload, params->payloadLen);
+	rxBuf[params->payloadLen] = '\0';
+	if(!isJsonValidAndParse(rxBuf, SHADOW_MAX_SIZE_OF_RX_BUFFER, pJsonHandler, &tokenCount)) {
+		return;
+	}
+
+	for(i = 0; i < registeredCount; i++) {
+		if(isJsonKeyMatchingAndUpdateValue(rxBuf, pJsonHandler, tokenCount, &deltaStructs[i], &dataLength,
+										   &dataPosition)) {
+			deltaStructs[i].cb(rxBuf + dataPosition, dataLength, &deltaStructs[i]);
+		}
+	}
+}
+
+static void registerDeltaKey(const char *pKey) {
+	IoT_Error_t rc;
+	jsonStruct_t *pStruct = &deltaStructs[registeredCount];
+
+	snprintf(deltaKeys[registeredCount], sizeof(deltaKeys[0]), "%s", pKey);
+	deltaValues[registeredCount] = 0;
+	pStruct->cb = deltaKeyCallback;
+	pStruct->pKey = deltaKeys[registeredCount];
+	pStruct->type = SHADOW_JSON_INT32;
+	pStruct->pData = &deltaValues[registeredCount];
+	pStruct->dataLength = sizeof(int32_t);
+
+	ResetTLSBuffer();
+	setTLSRxBufferForSuback(shadowDeltaTopic, strlen(shadowDeltaTopic), QOS0, testPubMsgParams);
+	rc = aws_iot_shadow_register_delta(&client, pStruct);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	registeredCount++;
+}
+
+static void deliverOn(const char *pTopic, const char *pDocument) {
+	uint8_t packetType;
+	Timer timer;
+	IoT_Error_t rc;
+
+	testPubMsgParams.payload = (void *) pDocument;
+	testPubMsgParams.payloadLen = strlen(pDocument);
+	setTLSRxBufferWithMsgOnSubscribedTopic((char *) pTopic, strlen(pTopic), QOS0, testPubMsgParams,
+										   (char *) pDocument);
+	init_timer(&timer);
+	countdown_ms(&timer, 1000);
+	rc = aws_iot_mqtt_internal_cycle_read(&client, &timer, &packetType);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(PUBLISH, packetType);
+}
+
+static int deliverDelta(const char *pDocument) {
+	callbackCount = 0;
+	deliverOn(shadowDeltaTopic, pDocument);
+	return callbackCount;
+}
+
+static int deliverKeyScan(const char *pDocument) {
+	callbackCount = 0;
+	deliverOn(KEY_SCAN_TOPIC, pDocument);
+	return callbackCount;
+}
+
+static void connectShadow(void) {
+	IoT_Error_t rc;
+
+	shadowInitParams.pHost = AWS_IOT_MQTT_HOST;
+	shadowInitParams.port = AWS_IOT_MQTT_PORT;
+	shadowInitParams.pClientCRT = AWS_IOT_CERTIFICATE_FILENAME;
+	shadowInitParams.pRootCA = AWS_IOT_ROOT_CA_FILENAME;
+	shadowInitParams.pClientKey = AWS_IOT_PRIVATE_KEY_FILENAME;
+	shadowInitParams.disconnectHandler = NULL;
+	shadowInitParams.enableAutoReconnect = false;
+	rc = aws_iot_shadow_init(&client, &shadowInitParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	shadowConnectParams.pMyThingName = AWS_IOT_MY_THING_NAME;
+	shadowConnectParams.pMqttClientId = AWS_IOT_MQTT_CLIENT_ID;
+	shadowConnectParams.mqttClientIdLen = (uint16_t) strlen(AWS_IOT_MQTT_CLIENT_ID);
+	ResetTLSBuffer();
+	ConnectMQTTParamsSetup(&connectParams, AWS_IOT_MQTT_CLIENT_ID, (uint16_t) strlen(AWS_IOT_MQTT_CLIENT_ID));
+	setTLSRxBufferForConnack(&connectParams, 0, 0);
+	rc = aws_iot_shadow_connect(&client, &shadowConnectParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	ResetTLSBuffer();
+	setTLSRxBufferForSuback(KEY_SCAN_TOPIC, strlen(KEY_SCAN_TOPIC), QOS0, testPubMsgParams);
+	rc = aws_iot_mqtt_subscribe(&client, KEY_SCAN_TOPIC, (uint16_t) strlen(KEY_SCAN_TOPIC), QOS0, keyScanCallback,
+								NULL);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	registeredCount = 0;
+}
+
+TEST_GROUP_C_SETUP(ShadowDeltaDispatchTests) {
+	testPubMsgParams.qos = QOS0;
+	testPubMsgParams.isRetained = 0;
+	snprintf(shadowDeltaTopic, MAX_SHADOW_TOPIC_LENGTH_BYTES, SHADOW_DELTA_UPDATE, AWS_IOT_MY_THING_NAME);
+	aws_iot_shadow_disable_discard_old_delta_msgs();
+	connectShadow();
+}
+
+TEST_GROUP_C_TEARDOWN(ShadowDeltaDispatchTests) {
+	aws_iot_shadow_enable_discard_old_delta_msgs();
+}
+
+/* G:1 - Delta callbacks run in document order */
+TEST_C(ShadowDeltaDispatchTests, CallbacksInDocumentOrder) {
+	IOT_DEBUG("-->Running Shadow Delta Dispatch Tests - G:1 - Delta callbacks run in document order \n");
+
+	registerDeltaKey("fan");
+	registerDeltaKey("heater");
+	registerDeltaKey("cooler");
+
+	CHECK_EQUAL_C_INT(3, deliverDelta("{\"state\":{\"cooler\":3,\"fan\":1,\"heater\":2},\"version\":1}"));
+	CHECK_EQUAL_C_INT(2, callbackOrder[0]);
+	CHECK_EQUAL_C_INT(0, callbackOrder[1]);
+	CHECK_EQUAL_C_INT(1, callbackOrder[2]);
+	CHECK_EQUAL_C_INT(1, deltaValues[0]);
+	CHECK_EQUAL_C_INT(2, deltaValues[1]);
+	CHECK_EQUAL_C_INT(3, deltaValues[2]);
+
+	IOT_DEBUG("-->Success - G:1 - Delta callbacks run in document order \n");
+}
+
+/* G:2 - Key registered twice, both callbacks run */
+TEST_C(ShadowDeltaDispatchTests, DuplicateKeyRegistration) {
+	IOT_DEBUG("-->Running Shadow Delta Dispatch Tests - G:2 - Key registered twice, both callbacks run \n");
+
+	registerDeltaKey("fan");
+	registerDeltaKey("fan_speed");
+	registerDeltaKey("fan");
+
+	CHECK_EQUAL_C_INT(2, deliverDelta("{\"state\":{\"fan\":7},\"version\":1}"));
+	CHECK_EQUAL_C_INT(0, callbackOrder[0]);
+	CHECK_EQUAL_C_INT(2, callbackOrder[1]);
+	CHECK_EQUAL_C_INT(7, deltaValues[0]);
+	CHECK_EQUAL_C_INT(0, deltaValues[1]);
+	CHECK_EQUAL_C_INT(7, deltaValues[2]);
+
+	IOT_DEBUG("-->Success - G:2 - Key registered twice, both callbacks run \n");
+}
+
+/* G:3 - Keys outside the state object and in metadata ignored */
+TEST_C(ShadowDeltaDispatchTests, MetadataAndTopLevelKeysIgnored) {
+	IOT_DEBUG("-->Running Shadow Delta Dispatch Tests - G:3 - Keys outside the state object and in metadata ignored \n");
+
+	registerDeltaKey("timestamp");
+	registerDeltaKey("setpoint");
+
+	CHECK_EQUAL_C_INT(1, deliverDelta("{\"version\":4,\"timestamp\":99,\"state\":{\"setpoint\":21},"
+									  "\"metadata\":{\"setpoint\":{\"timestamp\":98}}}"));
+	CHECK_EQUAL_C_INT(1, callbackOrder[0]);
+	CHECK_EQUAL_C_INT(0, deltaValues[0]);
+	CHECK_EQUAL_C_INT(21, deltaValues[1]);
+
+	IOT_DEBUG("-->Success - G:3 - Keys outside the state object and in metadata ignored \n");
+}
+
+/* Builds a delta holding every fifth of keyCount actuators, with two unregistered keys and some metadata */
+static void buildActuatorDelta(char *pDocument, size_t documentSize, int keyCount, int *pExpectedCallbacks) {
+	size_t len;
+	int i;
+
+	*pExpectedCallbacks = 0;
+	len = (size_t) snprintf(pDocument, documentSize, "{\"version\":12,\"timestamp\":1600000000,\"state\":{");
+	for(i = 0; i < 60; i += 5) {
+		/* Stop before documentSize - len wraps around */
+		CHECK_C(len < documentSize);
+		len += (size_t) snprintf(pDocument + len, documentSize - len, "\"actuator_%02d\":%d,", i, 100 + i);
+		if(i < keyCount) {
+			(*pExpectedCallbacks)++;
+		}
+	}
+	CHECK_C(len < documentSize);
+	len +=(size_t) snprintf(pDocument + len, documentSize - len,
+							 "\"mode\":\"heat\",\"schedule\":{\"on\":7,\"off\":22}},\"metadata\":{"
+							 "\"actuator_00\":{\"timestamp\":1600000000},\"actuator_05\":{\"timestamp\":1600000000}}}");
+	CHECK_C(len < documentSize);
+}
+
+/* G:4 - Callback counts match the per key scan */
+TEST_C(ShadowDeltaDispatchTests, CallbackCountMatchesKeyScan) {
+	char document[SHADOW_MAX_SIZE_OF_RX_BUFFER];
+	char key[DELTA_KEY_SIZE];
+	int expected;
+	int i;
+
+	IOT_DEBUG("-->Running Shadow Delta Dispatch Tests - G:4 - Callback counts match the per key scan \n");
+
+	for(i = 0; i < 40; i++) {
+		snprintf(key, sizeof(key), "actuator_%02d", i);
+		registerDeltaKey(key);
+	}
+	buildActuatorDelta(document, sizeof(document), 40, &expected);
+
+	CHECK_EQUAL_C_INT(expected, deliverDelta(document));
+	for(i = 0; i < 40; i++) {
+		CHECK_EQUAL_C_INT((0 == i % 5) ? 100 + i : 0, deltaValues[i]);
+		deltaValues[i] = 0;
+	}
+	CHECK_EQUAL_C_INT(expected, deliverKeyScan(document));
+	for(i = 0; i < 40; i++) {
+		CHECK_EQUAL_C_INT((0 == i % 5) ? 100 + i : 0, deltaValues[i]);
+	}
+
+	IOT_DEBUG("-->Success - G:4 - Callback counts match the per key scan \n");
+}
+
+/* Delivers DELTA_BENCHMARK_MESSAGES copies of pDocument on the delta or key scan topic,
+ * returns the average time per delta in nanoseconds */
+static double benchmarkDelta(const char *pDocument, bool isKeyScan, int expectedCallbacks) {
+	struct timespec start, end;
+	int i;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for(i = 0; i < DELTA_BENCHMARK_MESSAGES; i++) {
+		if(isKeyScan) {
+			CHECK_EQUAL_C_INT(expectedCallbacks, deliverKeyScan(pDocument));
+		} else {
+			CHECK_EQUAL_C_INT(expectedCallbacks, deliverDelta(pDocument));
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	return ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / DELTA_BENCHMARK_MESSAGES;
+}
+
+/* G:5 - Dispatch cost against the per key scan */
+TEST_C(ShadowDeltaDispatchTests, DispatchBenchmark) {
+	static const int keyCounts[] = {4, 16, 48, MAX_DELTA_KEYS};
+	char document[SHADOW_MAX_SIZE_OF_RX_BUFFER];
+	char key[DELTA_KEY_SIZE];
+	int expected;
+	size_t n;
+	int i;
+
+	IOT_DEBUG("-->Running Shadow Delta Dispatch Tests - G:5 - Dispatch cost against the per key scan \n");
+
+	printf("\nShadow delta dispatch, ns per delta\n");
+	printf("registered keys   state walk   key scan\n");
+	for(n = 0; n < sizeof(keyCounts) / sizeof(keyCounts[0]); n++) {
+		double walkNs, scanNs;
+
+		connectShadow();
+		for(i = 0; i < keyCounts[n]; i++) {
+			snprintf(key, sizeof(key), "actuator_%02d", i);
+			registerDeltaKey(key);
+		}
+		buildActuatorDelta(document, sizeof(document), keyCounts[n], &expected);
+
+		walkNs = benchmarkDelta(document, false, expected);
+		scanNs = benchmarkDelta(document, true, expected);
+		printf("%15d %12.0f %10.0f\n", keyCounts[n], walkNs, scanNs);
+	}
+
+	IOT_DEBUG("-->Success - G:5 - Dispatch cost against the per key scan \n");
+}
@@ -29,3 +29,11 @@ TEST_GROUP_C(ShadowJsonBuilderTests){
 TEST_GROUP_C_WRAPPER(ShadowJsonBuilderTests, UpdateTheJSONDocumentBuilder)
 TEST_GROUP_C_WRAPPER(ShadowJsonBuilderTests, PassingNullValue)
 TEST_GROUP_C_WRAPPER(ShadowJsonBuilderTests, SmallBuffer)
+TEST_GROUP_C_WRAPPER(ShadowJsonBuilderTests, WriterMatchesLegacyDocument)
+TEST_GROUP_C_WRAPPER(ShadowJsonBuilderTests, WriterNestedObjectsAndArrays)
+TEST_GROUP_C_WRAPPER(ShadowJsonBuilderTests, WriterDeltaOnlyReporting)
+TEST_GROUP_C_WRAPPER(ShadowJsonBuilderTests, WriterNumbersMatchPrintf)
+TEST_GROUP_C_WRAPPER(ShadowJsonBuilderTests, WriterSmallBuffer)
+TEST_GROUP_C_WRAPPER(ShadowJsonBuilderTests, WriterStructureErrors)
+TEST_GROUP_C_WRAPPER(ShadowJsonBuilderTests, EmptyReportedSection)
+TEST_GROUP_C_WRAPPER(ShadowJsonBuilderTests, BuilderBenchmark)
@@ -0,0 +1,38 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_tests_unit_shadow_pipeline.cpp
+ * @brief IoT Client Unit Testing - Shadow Update Pipeline Tests
+ */
+
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTest/TestHarness_c.h>
+
+TEST_GROUP_C(ShadowPipelineTests){
+	TEST_GROUP_C_SETUP_WRAPPER(ShadowPipelineTests)
+	TEST_GROUP_C_TEARDOWN_WRAPPER(ShadowPipelineTests)
+};
+
+/* P:1 - Updates are sent without waiting for acks until the window is full */
+TEST_GROUP_C_WRAPPER(ShadowPipelineTests, WindowKeepsUpdatesInFlight)
+/* P:2 - Acks arriving out of order are matched to their update by client token */
+TEST_GROUP_C_WRAPPER(ShadowPipelineTests, OutOfOrderAcksMatchedByClientToken)
+/* P:3 - Values staged again before a flush are sent once with the latest value */
+TEST_GROUP_C_WRAPPER(ShadowPipelineTests, SupersededValuesCoalesced)
+/* P:4 - Rejected and timed out updates free their slot */
+TEST_GROUP_C_WRAPPER(ShadowPipelineTests, RejectedAndTimedOutUpdates)
+/* P:5 - Invalid parameters */
+TEST_GROUP_C_WRAPPER(ShadowPipelineTests, InvalidParameters)
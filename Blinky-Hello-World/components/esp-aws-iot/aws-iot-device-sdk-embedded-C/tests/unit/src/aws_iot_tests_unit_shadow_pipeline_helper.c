@@ -0,0 +1,336 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_tests_unit_shadow_pipeline_helper.c
+ * @brief IoT Client Unit Testing - Shadow Update Pipeline Tests Helper
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <CppUTest/TestHarness_c.h>
+
+#include "aws_iot_tests_unit_mock_tls_params.h"
+#include "aws_iot_tests_unit_helper_functions.h"
+#include "aws_iot_tests_unit_shadow_helper.h"
+
+#include "aws_iot_shadow_interface.h"
+#include "aws_iot_shadow_pipeline.h"
+#include "aws_iot_log.h"
+
+#define PIPELINE_WINDOW 3
+#define PIPELINE_TIMEOUT_SECONDS 4
+#define SIZE_OF_UPDATE_DOCUMENT 200
+#define MAX_BROKER_UPDATES 8
+
+static AWS_IoT_Client client;
+static IoT_Client_Connect_Params connectParams;
+static IoT_Publish_Message_Params testPubMsgParams;
+static ShadowInitParameters_t shadowInitParams;
+static ShadowConnectParameters_t shadowConnectParams;
+
+static ShadowUpdatePipeline_t pipeline;
+static char documentBuffer[SIZE_OF_UPDATE_DOCUMENT];
+
+static int32_t temperature;
+static bool isOccupied;
+static jsonStruct_t temperatureHandler;
+static jsonStruct_t occupancyHandler;
+
+/* The mock broker keeps every update document it received until the test acks it */
+static char brokerUpdates[MAX_BROKER_UPDATES][SIZE_OF_UPDATE_DOCUMENT];
+static int brokerUpdateCount;
+
+static Shadow_Ack_Status_t ackStatusRx[MAX_BROKER_UPDATES];
+static int ackCount;
+
+static void pipelineCallback(const char *pThingName, ShadowActions_t action, Shadow_Ack_Status_t status,
+							 const char *pReceivedJsonDocument, void *pContextData) {
+	IOT_UNUSED(pThingName);
+	IOT_UNUSED(pReceivedJsonDocument);
+	IOT_UNUSED(pContextData);
+
+	CHECK_EQUAL_C_INT(SHADOW_UPDATE, action);
+	if(ackCount < MAX_BROKER_UPDATES) {
+		ackStatusRx[ackCount] = status;
+	}
+	ackCount++;
+}
+
+TEST_GROUP_C_SETUP(ShadowPipelineTests) {
+	IoT_Error_t ret_val;
+
+	shadowInitParams.pHost = AWS_IOT_MQTT_HOST;
+	shadowInitParams.port = AWS_IOT_MQTT_PORT;
+	shadowInitParams.pClientCRT = AWS_IOT_CERTIFICATE_FILENAME;
+	shadowInitParams.pRootCA = AWS_IOT_ROOT_CA_FILENAME;
+	shadowInitParams.pClientKey = AWS_IOT_PRIVATE_KEY_FILENAME;
+	shadowInitParams.disconnectHandler = NULL;
+	shadowInitParams.enableAutoReconnect = false;
+	ret_val = aws_iot_shadow_init(&client, &shadowInitParams);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+
+	shadowConnectParams.pMyThingName = AWS_IOT_MY_THING_NAME;
+	shadowConnectParams.pMqttClientId = AWS_IOT_MQTT_CLIENT_ID;
+	shadowConnectParams.mqttClientIdLen = (uint16_t) strlen(AWS_IOT_MQTT_CLIENT_ID);
+	ConnectMQTTParamsSetup(&connectParams, AWS_IOT_MQTT_CLIENT_ID, (uint16_t) strlen(AWS_IOT_MQTT_CLIENT_ID));
+	setTLSRxBufferForConnack(&connectParams, 0, 0);
+	ret_val = aws_iot_shadow_connect(&client, &shadowConnectParams);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+
+	// Subacks for update/accepted and update/rejected, subscribed by the first flush
+	setTLSRxBufferForDoubleSuback(UPDATE_ACCEPTED_TOPIC, strlen(UPDATE_ACCEPTED_TOPIC), QOS0, testPubMsgParams);
+
+	temperature = 20;
+	temperatureHandler.cb = NULL;
+	temperatureHandler.pKey = "temperature";
+	temperatureHandler.pData = &temperature;
+	temperatureHandler.type = SHADOW_JSON_INT32;
+	temperatureHandler.dataLength = sizeof(int32_t);
+
+	isOccupied = false;
+	occupancyHandler.cb = NULL;
+	occupancyHandler.pKey = "roomOccupancy";
+	occupancyHandler.pData = &isOccupied;
+	occupancyHandler.type = SHADOW_JSON_BOOL;
+	occupancyHandler.dataLength = sizeof(bool);
+
+	brokerUpdateCount = 0;
+	ackCount = 0;
+
+	ret_val = aws_iot_shadow_pipeline_init(&pipeline, &client, AWS_IOT_MY_THING_NAME, documentBuffer,
+										   sizeof(documentBuffer), PIPELINE_WINDOW, PIPELINE_TIMEOUT_SECONDS,
+										   pipelineCallback, NULL);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+}
+
+TEST_GROUP_C_TEARDOWN(ShadowPipelineTests) {
+	/* Clean up. Not checking return code here because this is common to all tests.
+	 * A test might have already caused a disconnect by this point.
+	 */
+	IoT_Error_t rc = aws_iot_shadow_disconnect(&client);
+	IOT_UNUSED(rc);
+}
+
+/* Flushes the pipeline and lets the mock broker take the update if one was published */
+static IoT_Error_t flushToBroker(void) {
+	uint32_t sentBefore = pipeline.metrics.sent;
+	IoT_Error_t rc = aws_iot_shadow_pipeline_flush(&pipeline);
+
+	if(pipeline.metrics.sent != sentBefore) {
+		CHECK_C(brokerUpdateCount < MAX_BROKER_UPDATES);
+		CHECK_C(lastPublishMessagePayloadLen < SIZE_OF_UPDATE_DOCUMENT);
+		CHECK_EQUAL_C_STRING(UPDATE_PUB_TOPIC, LastPublishMessageTopic);
+		memcpy(brokerUpdates[brokerUpdateCount++], LastPublishMessagePayload, lastPublishMessagePayloadLen + 1);
+	}
+	return rc;
+}
+
+/* The mock broker answers a received update on update/accepted or update/rejected */
+static void brokerAck(int update, const char *pTopic) {
+	IoT_Publish_Message_Params params;
+	char ack[SIZE_OF_UPDATE_DOCUMENT];
+	const char *pToken;
+	IoT_Error_t rc;
+
+	pToken = strstr(brokerUpdates[update], "\"clientToken\":\"");
+	CHECK_C(NULL != pToken);
+	pToken += strlen("\"clientToken\":\"");
+	snprintf(ack, sizeof(ack), "{\"version\":%d,\"clientToken\":\"%.*s\"}", update + 1,
+			 (int) strcspn(pToken, "\""), pToken);
+
+	ResetTLSBuffer();
+	params.payloadLen = strlen(ack);
+	params.payload = ack;
+	params.qos = QOS0;
+	setTLSRxBufferWithMsgOnSubscribedTopic((char *) pTopic, strlen(pTopic), QOS0, params, params.payload);
+	rc = aws_iot_shadow_yield(&client, 200);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+}
+
+/* P:1 - Updates are sent without waiting for acks until the window is full */
+TEST_C(ShadowPipelineTests, WindowKeepsUpdatesInFlight) {
+	int i;
+
+	IOT_DEBUG("-->Running Shadow Pipeline Tests - P:1 - Window keeps updates in flight \n");
+
+	for(i = 0; i < PIPELINE_WINDOW; i++) {
+		temperature = 20 + i;
+		CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_pipeline_report(&pipeline, &temperatureHandler));
+		CHECK_EQUAL_C_INT(SUCCESS, flushToBroker());
+	}
+	CHECK_EQUAL_C_INT(PIPELINE_WINDOW, brokerUpdateCount);
+	CHECK_EQUAL_C_INT(PIPELINE_WINDOW, pipeline.metrics.inFlight);
+
+	// The window is full, the value stays staged
+	temperature = 30;
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_pipeline_report(&pipeline, &temperatureHandler));
+	CHECK_EQUAL_C_INT(SUCCESS, flushToBroker());
+	CHECK_EQUAL_C_INT(PIPELINE_WINDOW, brokerUpdateCount);
+
+	// An ack frees a slot for it
+	brokerAck(1, UPDATE_ACCEPTED_TOPIC);
+	CHECK_EQUAL_C_INT(PIPELINE_WINDOW - 1, pipeline.metrics.inFlight);
+	CHECK_EQUAL_C_INT(SUCCESS, flushToBroker());
+	CHECK_EQUAL_C_INT(PIPELINE_WINDOW + 1, brokerUpdateCount);
+	CHECK_C(NULL != strstr(brokerUpdates[PIPELINE_WINDOW], "{\"state\":{\"reported\":{\"temperature\":30}}"));
+
+	CHECK_EQUAL_C_INT(PIPELINE_WINDOW + 1, pipeline.metrics.sent);
+	CHECK_EQUAL_C_INT(PIPELINE_WINDOW, pipeline.metrics.inFlight);
+	CHECK_EQUAL_C_INT(PIPELINE_WINDOW, pipeline.metrics.maxInFlight);
+
+	IOT_DEBUG("-->Success - P:1 - Window keeps updates in flight \n");
+}
+
+/* P:2 - Acks arriving out of order are matched to their update by client token */
+TEST_C(ShadowPipelineTests, OutOfOrderAcksMatchedByClientToken) {
+	ShadowPipelineMetrics_t metrics;
+	static const int ackOrder[] = {2, 0, 1};
+	int i;
+
+	IOT_DEBUG("-->Running Shadow Pipeline Tests - P:2 - Out of order acks matched by client token \n");
+
+	for(i = 0; i < PIPELINE_WINDOW; i++) {
+		temperature = 20 + i;
+		aws_iot_shadow_pipeline_report(&pipeline, &temperatureHandler);
+		CHECK_EQUAL_C_INT(SUCCESS, flushToBroker());
+	}
+
+	// A token the device never sent is ignored
+	snprintf(brokerUpdates[MAX_BROKER_UPDATES - 1], SIZE_OF_UPDATE_DOCUMENT, "{\"clientToken\":\"unknown-7\"}");
+	brokerAck(MAX_BROKER_UPDATES - 1, UPDATE_ACCEPTED_TOPIC);
+	CHECK_EQUAL_C_INT(0, ackCount);
+
+	for(i = 0; i < PIPELINE_WINDOW; i++) {
+		brokerAck(ackOrder[i], UPDATE_ACCEPTED_TOPIC);
+		CHECK_EQUAL_C_INT(i + 1, ackCount);
+		CHECK_EQUAL_C_INT(SHADOW_ACK_ACCEPTED, ackStatusRx[i]);
+		CHECK_EQUAL_C_INT(PIPELINE_WINDOW - 1 - i, pipeline.metrics.inFlight);
+	}
+
+	// Every update was acked once
+	brokerAck(0, UPDATE_ACCEPTED_TOPIC);
+	CHECK_EQUAL_C_INT(PIPELINE_WINDOW, ackCount);
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_pipeline_get_metrics(&pipeline, &metrics));
+	CHECK_EQUAL_C_INT(PIPELINE_WINDOW, metrics.accepted);
+	CHECK_EQUAL_C_INT(0, metrics.inFlight);
+	CHECK_C(metrics.minAckLatency_ms <= metrics.maxAckLatency_ms);
+	CHECK_C(metrics.maxAckLatency_ms <= PIPELINE_TIMEOUT_SECONDS * 1000);
+	CHECK_C(metrics.totalAckLatency_ms >= (uint64_t) metrics.maxAckLatency_ms);
+
+	IOT_DEBUG("-->Success - P:2 - Out of order acks matched by client token \n");
+}
+
+/* P:3 - Values staged again before a flush are sent once with the latest value */
+TEST_C(ShadowPipelineTests, SupersededValuesCoalesced) {
+	jsonStruct_t laterTemperatureHandler;
+	int32_t laterTemperature = 25;
+	char expected[SIZE_OF_UPDATE_DOCUMENT];
+
+	IOT_DEBUG("-->Running Shadow Pipeline Tests - P:3 - Superseded values coalesced \n");
+
+	temperature = 21;
+	aws_iot_shadow_pipeline_report(&pipeline, &temperatureHandler);
+	aws_iot_shadow_pipeline_report(&pipeline, &occupancyHandler);
+	temperature = 22;
+	aws_iot_shadow_pipeline_report(&pipeline, &temperatureHandler);
+	isOccupied = true;
+
+	// Another jsonStruct_t with the same key replaces the staged one
+	laterTemperatureHandler = temperatureHandler;
+	laterTemperatureHandler.pData = &laterTemperature;
+	aws_iot_shadow_pipeline_report(&pipeline, &laterTemperatureHandler);
+
+	CHECK_EQUAL_C_INT(SUCCESS, flushToBroker());
+	CHECK_EQUAL_C_INT(1, brokerUpdateCount);
+	CHECK_EQUAL_C_INT(2, pipeline.metrics.coalesced);
+
+	snprintf(expected, sizeof(expected),
+			 "{\"state\":{\"reported\":{\"temperature\":25,\"roomOccupancy\":true}}, \"clientToken\":\"%s-0\"}",
+			 AWS_IOT_MQTT_CLIENT_ID);
+	CHECK_EQUAL_C_STRING(expected, brokerUpdates[0]);
+
+	// Nothing staged, nothing sent
+	CHECK_EQUAL_C_INT(SUCCESS, flushToBroker());
+	CHECK_EQUAL_C_INT(1, brokerUpdateCount);
+
+	IOT_DEBUG("-->Success - P:3 - Superseded values coalesced \n");
+}
+
+/* P:4 - Rejected and timed out updates free their slot */
+TEST_C(ShadowPipelineTests, RejectedAndTimedOutUpdates) {
+	IoT_Error_t rc;
+
+	IOT_DEBUG("-->Running Shadow Pipeline Tests - P:4 - Rejected and timed out updates \n");
+
+	aws_iot_shadow_pipeline_report(&pipeline, &temperatureHandler);
+	CHECK_EQUAL_C_INT(SUCCESS, flushToBroker());
+	aws_iot_shadow_pipeline_report(&pipeline, &occupancyHandler);
+	CHECK_EQUAL_C_INT(SUCCESS, flushToBroker());
+
+	brokerAck(0, UPDATE_REJECTED_TOPIC);
+	CHECK_EQUAL_C_INT(1, ackCount);
+	CHECK_EQUAL_C_INT(SHADOW_ACK_REJECTED, ackStatusRx[0]);
+	CHECK_EQUAL_C_INT(1, pipeline.metrics.rejected);
+	CHECK_EQUAL_C_INT(1, pipeline.metrics.inFlight);
+
+	sleep(PIPELINE_TIMEOUT_SECONDS + 1);
+	ResetTLSBuffer();
+	rc = aws_iot_shadow_yield(&client, 200);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(2, ackCount);
+	CHECK_EQUAL_C_INT(SHADOW_ACK_TIMEOUT, ackStatusRx[1]);
+	CHECK_EQUAL_C_INT(1, pipeline.metrics.timedOut);
+	CHECK_EQUAL_C_INT(0, pipeline.metrics.inFlight);
+
+	// A late ack for the timed out update is ignored
+	brokerAck(1, UPDATE_ACCEPTED_TOPIC);
+	CHECK_EQUAL_C_INT(2, ackCount);
+	CHECK_EQUAL_C_INT(0, pipeline.metrics.accepted);
+
+	IOT_DEBUG("-->Success - P:4 - Rejected and timed out updates \n");
+}
+
+/* P:5 - Invalid parameters */
+TEST_C(ShadowPipelineTests, InvalidParameters) {
+	ShadowUpdatePipeline_t otherPipeline;
+	jsonStruct_t fields[AWS_IOT_SHADOW_PIPELINE_MAX_FIELDS + 1];
+	char keys[AWS_IOT_SHADOW_PIPELINE_MAX_FIELDS + 1][8];
+	int i;
+
+	IOT_DEBUG("-->Running Shadow Pipeline Tests - P:5 - Invalid parameters \n");
+
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_shadow_pipeline_init(NULL, &client, AWS_IOT_MY_THING_NAME,
+								  documentBuffer, sizeof(documentBuffer), 1, 1, NULL, NULL));
+	CHECK_EQUAL_C_INT(FAILURE, aws_iot_shadow_pipeline_init(&otherPipeline, &client, AWS_IOT_MY_THING_NAME,
+						  documentBuffer, sizeof(documentBuffer), 0, 1, NULL, NULL));
+	CHECK_EQUAL_C_INT(FAILURE, aws_iot_shadow_pipeline_init(&otherPipeline, &client, AWS_IOT_MY_THING_NAME,
+						  documentBuffer, sizeof(documentBuffer), MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME + 1, 1,
+						  NULL, NULL));
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_shadow_pipeline_report(&pipeline, NULL));
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_shadow_pipeline_flush(NULL));
+
+	for(i = 0; i <= AWS_IOT_SHADOW_PIPELINE_MAX_FIELDS; i++) {
+		snprintf(keys[i], sizeof(keys[i]), "k%d", i);
+		fields[i] = temperatureHandler;
+		fields[i].pKey = keys[i];
+		CHECK_EQUAL_C_INT(i < AWS_IOT_SHADOW_PIPELINE_MAX_FIELDS ? SUCCESS : LIMIT_EXCEEDED_ERROR,
+						  aws_iot_shadow_pipeline_report(&pipeline, &fields[i]));
+	}
+
+	IOT_DEBUG("-->Success - P:5 - Invalid parameters \n");
+}
@@ -0,0 +1,37 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+/**
+ * @file aws_iot_tests_unit_yield_wait.cpp
+ * @brief IoT Client Unit Testing - Yield Waiting On The Network Tests
+ */
+
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTest/TestHarness_c.h>
+
+TEST_GROUP_C(YieldWaitTests){
+	TEST_GROUP_C_SETUP_WRAPPER(YieldWaitTests)
+	TEST_GROUP_C_TEARDOWN_WRAPPER(YieldWaitTests)
+};
+
+/* W:1 - No incoming data, yield blocks once for the whole timeout */
+TEST_GROUP_C_WRAPPER(YieldWaitTests, NoDataBlocksUntilTimeout)
+/* W:2 - Incoming message wakes the yield when it arrives */
+TEST_GROUP_C_WRAPPER(YieldWaitTests, MessageWakesYield)
+/* W:3 - Keep alive deadline ends the wait and sends the ping */
+TEST_GROUP_C_WRAPPER(YieldWaitTests, KeepAliveDeadlineEndsWait)
+/* W:4 - Read error while waiting disconnects the client */
+TEST_GROUP_C_WRAPPER(YieldWaitTests, WaitErrorDisconnects)
+/* W:5 - Wakeups and message latency against the polling yield */
+TEST_GROUP_C_WRAPPER(YieldWaitTests, WakeupsAndLatencyAgainstPolling)
@@ -0,0 +1,243 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+/**
+ * @file aws_iot_tests_unit_yield_wait_helper.c
+ * @brief IoT Client Unit Testing - Yield Waiting On The Network Tests Helper
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+#include <CppUTest/TestHarness_c.h>
+
+#include "aws_iot_tests_unit_helper_functions.h"
+#include "aws_iot_tests_unit_mock_tls_params.h"
+#include "aws_iot_log.h"
+
+/* Messages delivered per yield mode in the comparison */
+#define YIELD_WAIT_COMPARE_MESSAGES 10
+/* Time after the start of a yield at which the broker stand-in delivers a message */
+#define YIELD_WAIT_DELIVERY_DELAY_US 30000
+#define YIELD_WAIT_YIELD_MS 60
+
+static IoT_Client_Init_Params initParams;
+static IoT_Client_Connect_Params connectParams;
+static IoT_Publish_Message_Params testPubMsgParams;
+static AWS_IoT_Client iotClient;
+
+static char subTopic[10] = "sdk/Test";
+static uint16_t subTopicLen = 8;
+
+static int messageCount;
+static struct timeval messageHandledTime;
+
+static void iot_yield_wait_callback_handler(AWS_IoT_Client *pClient, char *topicName, uint16_t topicNameLen,
+											IoT_Publish_Message_Params *params, void *pData) {
+	IOT_UNUSED(pClient);
+	IOT_UNUSED(topicName);
+	IOT_UNUSED(topicNameLen);
+	IOT_UNUSED(params);
+	IOT_UNUSED(pData);
+
+	gettimeofday(&messageHandledTime, NULL);
+	messageCount++;
+}
+
+static long elapsedMicroseconds(const struct timeval *pStart, const struct timeval *pEnd) {
+	return (long) (pEnd->tv_sec - pStart->tv_sec) * 1000000L + (long) (pEnd->tv_usec - pStart->tv_usec);
+}
+
+static void subscribeTestTopic(void) {
+	IoT_Error_t rc;
+
+	setTLSRxBufferForSuback(subTopic, subTopicLen, QOS0, testPubMsgParams);
+	rc = aws_iot_mqtt_subscribe(&iotClient, subTopic, subTopicLen, QOS0, iot_yield_wait_callback_handler, NULL);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	ResetTLSBuffer();
+}
+
+/* Queues a message the broker stand-in delivers after delay_us, returns when it becomes readable */
+static struct timeval deliverMessageAfter(long delay_us) {
+	struct timeval now, delay, delivery;
+
+	setTLSRxBufferWithMsgOnSubscribedTopic(subTopic, subTopicLen, QOS0, testPubMsgParams, "yield wait");
+	setTLSRxBufferDelay(0, (int) delay_us);
+
+	gettimeofday(&now, NULL);
+	delay.tv_sec = 0;
+	delay.tv_usec = delay_us;
+	timeradd(&now, &delay, &delivery);
+	return delivery;
+}
+
+TEST_GROUP_C_SETUP(YieldWaitTests) {
+	IoT_Error_t rc;
+
+	ResetTLSBuffer();
+	InitMQTTParamsSetup(&initParams, AWS_IOT_MQTT_HOST, AWS_IOT_MQTT_PORT, false, NULL);
+	rc = aws_iot_mqtt_init(&iotClient, &initParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	ConnectMQTTParamsSetup(&connectParams, AWS_IOT_MQTT_CLIENT_ID, (uint16_t) strlen(AWS_IOT_MQTT_CLIENT_ID));
+	connectParams.keepAliveIntervalInSec = 5;
+	setTLSRxBufferForConnack(&connectParams, 0, 0);
+	rc = aws_iot_mqtt_connect(&iotClient, &connectParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	rc = aws_iot_mqtt_autoreconnect_set_status(&iotClient, false);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	iotClient.networkStack.waitForRead = iot_tls_wait_for_read;
+	ResetTLSBuffer();
+	messageCount = 0;
+	readCount = 0;
+	waitForReadCount = 0;
+}
+
+TEST_GROUP_C_TEARDOWN(YieldWaitTests) {
+	/* A test might have already caused a disconnect by this point */
+	IoT_Error_t rc = aws_iot_mqtt_disconnect(&iotClient);
+	IOT_UNUSED(rc);
+}
+
+/* W:1 - No incoming data, yield blocks once for the whole timeout */
+TEST_C(YieldWaitTests, NoDataBlocksUntilTimeout) {
+	IoT_Error_t rc;
+	struct timeval start, end;
+
+	IOT_DEBUG("-->Running Yield Wait Tests - W:1 - No incoming data, yield blocks once for the whole timeout \n");
+
+	gettimeofday(&start, NULL);
+	rc = aws_iot_mqtt_yield(&iotClient, 200);
+	gettimeofday(&end, NULL);
+
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(0, readCount);
+	CHECK_C(waitForReadCount <= 2);
+	CHECK_C(elapsedMicroseconds(&start, &end) >= 190000);
+
+	IOT_DEBUG("-->Success - W:1 - No incoming data, yield blocks once for the whole timeout \n");
+}
+
+/* W:2 - Incoming message wakes the yield when it arrives */
+TEST_C(YieldWaitTests, MessageWakesYield) {
+	IoT_Error_t rc;
+	struct timeval delivery;
+
+	IOT_DEBUG("-->Running Yield Wait Tests - W:2 - Incoming message wakes the yield when it arrives \n");
+
+	subscribeTestTopic();
+	waitForReadCount = 0;
+
+	delivery = deliverMessageAfter(50000);
+	rc = aws_iot_mqtt_yield(&iotClient, 300);
+
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(1, messageCount);
+	CHECK_C(elapsedMicroseconds(&delivery, &messageHandledTime) >= 0);
+	CHECK_C(elapsedMicroseconds(&delivery, &messageHandledTime) < 20000);
+	CHECK_C(waitForReadCount <= 3);
+
+	IOT_DEBUG("-->Success - W:2 - Incoming message wakes the yield when it arrives \n");
+}
+
+/* W:3 - Keep alive deadline ends the wait and sends the ping */
+TEST_C(YieldWaitTests, KeepAliveDeadlineEndsWait) {
+	IoT_Error_t rc;
+
+	IOT_DEBUG("-->Running Yield Wait Tests - W:3 - Keep alive deadline ends the wait and sends the ping \n");
+
+	countdown_ms(&(iotClient.pingReqTimer), 50);
+	rc = aws_iot_mqtt_yield(&iotClient, 300);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(1, isLastTLSTxMessagePingreq());
+	CHECK_EQUAL_C_INT(true, iotClient.clientStatus.isPingOutstanding);
+	CHECK_C(waitForReadCount <= 3);
+
+	IOT_DEBUG("-->Success - W:3 - Keep alive deadline ends the wait and sends the ping \n");
+}
+
+/* W:4 - Read error while waiting disconnects the client */
+TEST_C(YieldWaitTests, WaitErrorDisconnects) {
+	IoT_Error_t rc;
+
+	IOT_DEBUG("-->Running Yield Wait Tests - W:4 - Read error while waiting disconnects the client \n");
+
+	setTLSRxBufferForError(NETWORK_SSL_READ_ERROR);
+	rc = aws_iot_mqtt_yield(&iotClient, 100);
+
+	CHECK_EQUAL_C_INT(NETWORK_DISCONNECTED_ERROR, rc);
+	CHECK_EQUAL_C_INT(0, aws_iot_mqtt_is_client_connected(&iotClient));
+
+	IOT_DEBUG("-->Success - W:4 - Read error while waiting disconnects the client \n");
+}
+
+static void runDeliveries(size_t *pWakeups, long *pLatencySum_us, long *pLatencyMax_us) {
+	struct timeval delivery;
+	long latency_us;
+	int i;
+
+	*pWakeups = 0;
+	*pLatencySum_us = 0;
+	*pLatencyMax_us = 0;
+	readCount = 0;
+	waitForReadCount = 0;
+
+	for(i = 0; i < YIELD_WAIT_COMPARE_MESSAGES; i++) {
+		messageCount = 0;
+		delivery = deliverMessageAfter(YIELD_WAIT_DELIVERY_DELAY_US);
+		CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_yield(&iotClient, YIELD_WAIT_YIELD_MS));
+		CHECK_EQUAL_C_INT(1, messageCount);
+
+		latency_us = elapsedMicroseconds(&delivery, &messageHandledTime);
+		*pLatencySum_us += latency_us;
+		if(latency_us > *pLatencyMax_us) {
+			*pLatencyMax_us = latency_us;
+		}
+	}
+
+	/* The polling yield wakes up for every read attempt, the waiting one for every wait */
+	*pWakeups = (NULL == iotClient.networkStack.waitForRead) ? readCount : waitForReadCount;
+}
+
+/* W:5 - Wakeups and message latency against the polling yield */
+TEST_C(YieldWaitTests, WakeupsAndLatencyAgainstPolling) {
+	size_t pollWakeups, waitWakeups;
+	long pollLatencySum_us, pollLatencyMax_us, waitLatencySum_us, waitLatencyMax_us;
+
+	IOT_DEBUG("-->Running Yield Wait Tests - W:5 - Wakeups and message latency against the polling yield \n");
+
+	subscribeTestTopic();
+
+	iotClient.networkStack.waitForRead = NULL;
+	runDeliveries(&pollWakeups, &pollLatencySum_us, &pollLatencyMax_us);
+
+	iotClient.networkStack.waitForRead = iot_tls_wait_for_read;
+	runDeliveries(&waitWakeups, &waitLatencySum_us, &waitLatencyMax_us);
+
+	printf("\nYield against the mock broker, %d messages, one per %d ms yield\n", YIELD_WAIT_COMPARE_MESSAGES,
+		   YIELD_WAIT_YIELD_MS);
+	printf("mode      wakeups/yield  mean latency us  max latency us\n");
+	printf("polling   %13.1f  %15ld  %14ld\n", (double) pollWakeups / YIELD_WAIT_COMPARE_MESSAGES,
+		   pollLatencySum_us / YIELD_WAIT_COMPARE_MESSAGES, pollLatencyMax_us);
+	printf("waiting   %13.1f  %15ld  %14ld\n", (double) waitWakeups / YIELD_WAIT_COMPARE_MESSAGES,
+		   waitLatencySum_us / YIELD_WAIT_COMPARE_MESSAGES, waitLatencyMax_us);
+
+	CHECK_C(waitWakeups <= 3 * YIELD_WAIT_COMPARE_MESSAGES);
+	CHECK_C(waitWakeups < pollWakeups);
+	CHECK_C(waitLatencyMax_us < 20000);
+
+	IOT_DEBUG("-->Success - W:5 - Wakeups and message latency against the polling yield \n");
+}
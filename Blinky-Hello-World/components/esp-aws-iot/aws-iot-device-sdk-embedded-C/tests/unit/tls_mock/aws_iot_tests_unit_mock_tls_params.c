@@ -35,6 +35,11 @@ size_t lastPublishMessageTopicLen;
 char LastPublishMessagePayload[TLSMaxBufferSize];
 size_t lastPublishMessagePayloadLen;
 
+size_t lastWritevCount;
+size_t readCount;
+size_t waitForReadCount;
+TLSConnectTiming mockedConnectTiming;
+
 TlsBuffer RxBuffer = {.pBuffer = RxBuf,.len = 512, .NoMsgFlag=1, .expiry_time = {0, 0}, .BufMaxSize = TLSMaxBufferSize, .mockedError = SUCCESS};
 TlsBuffer TxBuffer = {.pBuffer = TxBuf,.len = 512, .NoMsgFlag=1, .expiry_time = {0, 0}, .BufMaxSize = TLSMaxBufferSize, .mockedError = SUCCESS};
 
@@ -16,6 +16,8 @@
 
 #ifndef IOTSDKC_NETWORK_MBEDTLS_PLATFORM_H_H
 
+#include <stdbool.h>
+
 #if !defined(MBEDTLS_CONFIG_FILE)
 #include "mbedtls/config.h"
 #else
@@ -53,6 +55,9 @@ typedef struct _TLSDataParams {
     mbedtls_x509_crt clicert;
     mbedtls_pk_context pkey;
     mbedtls_net_context server_fd;
+    bool isCredentialCached; /* cacert, clicert and pkey are kept by iot_tls_destroy */
+    bool isSessionSaved; /* savedSession holds the session of the last handshake */
+    mbedtls_ssl_session savedSession;
 }TLSDataParams;
 
 #define IOTSDKC_NETWORK_MBEDTLS_PLATFORM_H_H
@@ -28,11 +28,17 @@ extern "C" {
  * definition of the Timer struct. Platform specific
  */
 struct Timer {
-    uint32_t start_ticks;
-    uint32_t timeout_ticks;
-    uint32_t last_polled_ticks;
+    int64_t end_us; ///< esp_timer_get_time() at which the timer expires
+    uint32_t last_polled_ticks; ///< Tick of the last has_timer_expired() call on an unexpired timer
 };
 
+/**
+ * @brief Delay (sleep) for the specified number of milliseconds.
+ *
+ * @param milliseconds The number of milliseconds to sleep, rounded up to whole ticks.
+ */
+void delay(unsigned milliseconds);
+
 #ifdef __cplusplus
 }
 #endif
@@ -1,9 +1,14 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
 
 #include "driver/i2c.h"
 #include "esp_log.h"
 #include "esp_err.h"
+#include "esp_timer.h"
+
+#include <string.h>
 
 #include "i2c_device.h"
 
@@ -29,6 +34,15 @@
 
 #define I2C_TIMEOUT_MS (100)
 
+#ifdef CONFIG_I2C_ENGINE_QUEUE_SIZE
+#define I2C_ENGINE_QUEUE_SIZE CONFIG_I2C_ENGINE_QUEUE_SIZE
+#else
+#define I2C_ENGINE_QUEUE_SIZE 16
+#endif
+
+/* Transactions the bus owner collects before it starts running them */
+#define I2C_ENGINE_BATCH_MAX 8
+
 typedef struct _i2c_port_obj_t {
     i2c_port_t port;
     gpio_num_t scl;
@@ -39,10 +53,16 @@ typedef struct _i2c_port_obj_t {
 typedef struct _i2c_device_t {
     i2c_port_obj_t* i2c_port;
     uint8_t addr;
+    uint32_t latency_hist[I2C_LATENCY_BUCKETS];
 } i2c_device_t;
 
 static SemaphoreHandle_t i2c_mutex[I2C_NUM_MAX];
 static i2c_port_obj_t *i2c_port_used[2] = { NULL, NULL };
+static QueueHandle_t i2c_engine_queue[I2C_NUM_MAX];
+
+static i2c_cmd_handle_t i2c_build_cmd(i2c_device_t* device, uint32_t reg_addr, uint8_t *data, uint16_t length, bool read);
+static void i2c_record_latency(i2c_device_t* device, int64_t start_us);
+static void i2c_engine_task(void *arg);
 
 I2CDevice_t i2c_malloc_device(i2c_port_t i2c_num, gpio_num_t sda, gpio_num_t scl, uint32_t freq, uint8_t device_addr) {
     if (i2c_num > I2C_NUM_MAX) {
@@ -67,7 +87,7 @@ I2CDevice_t i2c_malloc_device(i2c_port_t i2c_num, gpio_num_t sda, gpio_num_t scl
     new_device_port->freq = freq;
     new_device_port->port = i2c_num;
 
-    i2c_device_t* device = (i2c_device_t *)malloc(sizeof(i2c_device_t));
+    i2c_device_t* device = (i2c_device_t *)calloc(1, sizeof(i2c_device_t));
     if (device == NULL) {
         return NULL;
     }
@@ -166,28 +186,14 @@ esp_err_t i2c_read_bytes(I2CDevice_t i2c_device, uint32_t reg_addr, uint8_t *dat
 
     i2c_device_t* device = (i2c_device_t *)i2c_device;
 
-    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
-
-    if(!(reg_addr & I2C_NO_REG)){
-        i2c_master_start(cmd);
-        i2c_master_write_byte(cmd, (device->addr << 1) | I2C_MASTER_WRITE, 1);
-        i2c_master_write_byte(cmd, reg_addr, 1);
-    }
- 
-    i2c_master_start(cmd);
-    i2c_master_write_byte(cmd, (device->addr << 1) | I2C_MASTER_READ, 1);
-    if (length > 1) {
-        i2c_master_read(cmd, data, length - 1, I2C_MASTER_ACK);
-    }
-    if (length > 0) {
-        i2c_master_read_byte(cmd, &data[length-1], I2C_MASTER_NACK);
-    }
-    i2c_master_stop(cmd);
+    i2c_cmd_handle_t cmd = i2c_build_cmd(device, reg_addr, data, length, true);
     i2c_apply_bus(i2c_device);
     
     esp_err_t err = ESP_FAIL;
 
+    int64_t start_us = esp_timer_get_time();
     err = i2c_master_cmd_begin(device->i2c_port->port, cmd, pdMS_TO_TICKS(I2C_TIMEOUT_MS));
+    i2c_record_latency(device, start_us);
     i2c_free_bus(i2c_device);
     i2c_cmd_link_delete(cmd);
 
@@ -202,45 +208,7 @@ esp_err_t i2c_read_bytes(I2CDevice_t i2c_device, uint32_t reg_addr, uint8_t *dat
 }
 
 esp_err_t i2c_read_bytes_no_stop(I2CDevice_t i2c_device, uint32_t reg_addr, uint8_t *data, uint16_t length) {
-    if (i2c_device == NULL || (length > 0 && data == NULL)) {
-        return ESP_ERR_INVALID_ARG;
-    }
-
-    i2c_device_t* device = (i2c_device_t *)i2c_device;
-
-    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
-    
-    if(!(reg_addr & I2C_NO_REG)){
-        i2c_master_start(cmd);
-        i2c_master_write_byte(cmd, (device->addr << 1) | I2C_MASTER_WRITE, 1);
-        i2c_master_write_byte(cmd, reg_addr, 1);
-    }
-
-    i2c_master_start(cmd);
-    i2c_master_write_byte(cmd, (device->addr << 1) | I2C_MASTER_READ, 1);
-    if (length > 1) {
-        i2c_master_read(cmd, data, length - 1, I2C_MASTER_ACK);
-    }
-    if (length > 0) {
-        i2c_master_read_byte(cmd, &data[length-1], I2C_MASTER_NACK);
-    }
-    i2c_master_stop(cmd);
-    i2c_apply_bus(i2c_device);
-
-    esp_err_t err = ESP_FAIL;
-    
-    err = i2c_master_cmd_begin(device->i2c_port->port, cmd, pdMS_TO_TICKS(I2C_TIMEOUT_MS));
-    i2c_free_bus(i2c_device);
-    i2c_cmd_link_delete(cmd);
-
-    if (err != ESP_OK) {
-        log_e("I2C Read Error: 0x%02x, reg: 0x%02x, length: %d, Code: 0x%x", device->addr, reg_addr, length, err);
-    } else {
-        log_i("I2C Read Success: 0x%02x, reg: 0x%02x, length: %d", device->addr, reg_addr, length);
-        log_reg(data, length);
-    }
-
-    return err;
+    return i2c_read_bytes(i2c_device, reg_addr, data, length);
 }
 
 esp_err_t i2c_read_byte(I2CDevice_t i2c_device, uint32_t reg_addr, uint8_t* data) {
@@ -288,21 +256,14 @@ esp_err_t i2c_write_bytes(I2CDevice_t i2c_device, uint32_t reg_addr, uint8_t *da
 
     i2c_device_t* device = (i2c_device_t *)i2c_device;
 
-    i2c_cmd_handle_t write_cmd = i2c_cmd_link_create();
-    i2c_master_start(write_cmd);
-    i2c_master_write_byte(write_cmd, (device->addr << 1) | I2C_MASTER_WRITE, 1);
-    if(!(reg_addr & I2C_NO_REG)){
-        i2c_master_write_byte(write_cmd, reg_addr, 1);
-    }
-    if (length > 0) {
-        i2c_master_write(write_cmd, data, length, 1);
-    }
-    i2c_master_stop(write_cmd);
+    i2c_cmd_handle_t write_cmd = i2c_build_cmd(device, reg_addr, data, length, false);
 
     esp_err_t err = ESP_FAIL;
 
     i2c_apply_bus(i2c_device);
+    int64_t start_us = esp_timer_get_time();
     err = i2c_master_cmd_begin(device->i2c_port->port, write_cmd, pdMS_TO_TICKS(I2C_TIMEOUT_MS));
+    i2c_record_latency(device, start_us);
     i2c_free_bus(i2c_device);
 
     i2c_cmd_link_delete(write_cmd);
@@ -392,4 +353,205 @@ esp_err_t i2c_device_valid(I2CDevice_t i2c_device) {
 
     i2c_cmd_link_delete(write_cmd);
     return err;
-}
\ No newline at end of file
+}
+
+esp_err_t i2c_device_get_latency(I2CDevice_t i2c_device, uint32_t *hist, bool reset) {
+    if (i2c_device == NULL || hist == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    i2c_device_t* device = (i2c_device_t *)i2c_device;
+    xSemaphoreTakeRecursive(i2c_mutex[device->i2c_port->port], portMAX_DELAY);
+    memcpy(hist, device->latency_hist, sizeof(device->latency_hist));
+    if (reset) {
+        memset(device->latency_hist, 0, sizeof(device->latency_hist));
+    }
+    xSemaphoreGiveRecursive(i2c_mutex[device->i2c_port->port]);
+    return ESP_OK;
+}
+
+esp_err_t i2c_submit(i2c_trans_t *trans) {
+    if (trans == NULL || trans->device == NULL || (trans->length > 0 && trans->data == NULL)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    i2c_port_t port = ((i2c_device_t *)trans->device)->i2c_port->port;
+
+    /* The bus owner task is started by the first submission on a port */
+    if (i2c_engine_queue[port] == NULL) {
+        xSemaphoreTakeRecursive(i2c_mutex[port], portMAX_DELAY);
+        if (i2c_engine_queue[port] == NULL) {
+            QueueHandle_t queue = xQueueCreate(I2C_ENGINE_QUEUE_SIZE, sizeof(i2c_trans_t *));
+            if (queue == NULL) {
+                xSemaphoreGiveRecursive(i2c_mutex[port]);
+                return ESP_ERR_NO_MEM;
+            }
+            if (xTaskCreatePinnedToCore(i2c_engine_task, "I2CEngine", 2 * 1024, queue,
+                                        configMAX_PRIORITIES - 3, NULL, 0) != pdPASS) {
+                vQueueDelete(queue);
+                xSemaphoreGiveRecursive(i2c_mutex[port]);
+                return ESP_ERR_NO_MEM;
+            }
+            i2c_engine_queue[port] = queue;
+        }
+        xSemaphoreGiveRecursive(i2c_mutex[port]);
+    }
+
+    trans->err = ESP_ERR_TIMEOUT;
+    trans->submit_us = esp_timer_get_time();
+    if (xQueueSend(i2c_engine_queue[port], &trans, portMAX_DELAY) != pdTRUE) {
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+esp_err_t i2c_transfer(i2c_trans_t *trans) {
+    if (trans == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    StaticSemaphore_t done_buf;
+    trans->done_sem = xSemaphoreCreateBinaryStatic(&done_buf);
+    esp_err_t err = i2c_submit(trans);
+    if (err == ESP_OK) {
+        xSemaphoreTake(trans->done_sem, portMAX_DELAY);
+        err = trans->err;
+    }
+    vSemaphoreDelete(trans->done_sem);
+    trans->done_sem = NULL;
+    return err;
+}
+
+void i2c_trans_release(i2c_trans_t *trans) {
+    if (trans != NULL && trans->cmd != NULL) {
+        i2c_cmd_link_delete(trans->cmd);
+        trans->cmd = NULL;
+    }
+}
+
+static i2c_cmd_handle_t i2c_build_cmd(i2c_device_t* device, uint32_t reg_addr, uint8_t *data, uint16_t length, bool read) {
+    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+
+    if (read) {
+        if(!(reg_addr & I2C_NO_REG)){
+            i2c_master_start(cmd);
+            i2c_master_write_byte(cmd, (device->addr << 1) | I2C_MASTER_WRITE, 1);
+            i2c_master_write_byte(cmd, reg_addr, 1);
+        }
+
+        i2c_master_start(cmd);
+        i2c_master_write_byte(cmd, (device->addr << 1) | I2C_MASTER_READ, 1);
+        if (length > 1) {
+            i2c_master_read(cmd, data, length - 1, I2C_MASTER_ACK);
+        }
+        if (length > 0) {
+            i2c_master_read_byte(cmd, &data[length-1], I2C_MASTER_NACK);
+        }
+    } else {
+        i2c_master_start(cmd);
+        i2c_master_write_byte(cmd, (device->addr << 1) | I2C_MASTER_WRITE, 1);
+        if(!(reg_addr & I2C_NO_REG)){
+            i2c_master_write_byte(cmd, reg_addr, 1);
+        }
+        if (length > 0) {
+            i2c_master_write(cmd, data, length, 1);
+        }
+    }
+    i2c_master_stop(cmd);
+    return cmd;
+}
+
+/* Bucket n counts transactions that took from 2^n to 2^(n+1) - 1 us */
+static void i2c_record_latency(i2c_device_t* device, int64_t start_us) {
+    uint32_t us = (uint32_t)(esp_timer_get_time() - start_us);
+    uint8_t bucket = 0;
+    while (us > 1 && bucket < I2C_LATENCY_BUCKETS - 1) {
+        us >>= 1;
+        bucket++;
+    }
+    device->latency_hist[bucket]++;
+}
+
+static bool i2c_same_config(const i2c_port_obj_t *a, const i2c_port_obj_t *b) {
+    return a->sda == b->sda && a->scl == b->scl && a->freq == b->freq;
+}
+
+static void i2c_engine_run(i2c_trans_t *trans) {
+    i2c_device_t* device = (i2c_device_t *)trans->device;
+
+    if (trans->cmd == NULL) {
+        trans->cmd = i2c_build_cmd(device, trans->reg_addr, trans->data, trans->length,
+                                   (trans->flags & I2C_TRANS_READ) != 0);
+    }
+
+    trans->err = i2c_master_cmd_begin(device->i2c_port->port, trans->cmd, pdMS_TO_TICKS(I2C_TIMEOUT_MS));
+    i2c_record_latency(device, trans->submit_us);
+
+    if (!(trans->flags & I2C_TRANS_KEEP_CMD)) {
+        i2c_trans_release(trans);
+    }
+
+    if (trans->err != ESP_OK) {
+        log_e("I2C Queued Error: 0x%02x, reg: 0x%02x, length: %d, Code: 0x%x", device->addr, trans->reg_addr, trans->length, trans->err);
+    } else if (trans->flags & I2C_TRANS_READ) {
+        log_reg(trans->data, trans->length);
+    }
+}
+
+/* Owns one port: collects a batch of queued transactions, then runs them
+ * grouped by bus configuration, so the driver is reconfigured at most once
+ * per group and the port mutex is taken once per group instead of once per
+ * transaction. */
+static void i2c_engine_task(void *arg) {
+    QueueHandle_t queue = (QueueHandle_t)arg;
+    i2c_trans_t *batch[I2C_ENGINE_BATCH_MAX];
+
+    for (;;) {
+        uint8_t count = 0;
+        xQueueReceive(queue, &batch[count++], portMAX_DELAY);
+        while (count < I2C_ENGINE_BATCH_MAX && xQueueReceive(queue, &batch[count], 0) == pdTRUE) {
+            count++;
+        }
+
+        uint8_t done = 0;
+        while (done < count) {
+            i2c_device_t* lead = (i2c_device_t *)batch[done]->device;
+
+            /* Move every transaction sharing the lead's configuration up,
+             * keeping submission order within the group */
+            uint8_t end = done + 1;
+            for (uint8_t i = done + 1; i < count; i++) {
+                i2c_device_t* device = (i2c_device_t *)batch[i]->device;
+                if (i2c_same_config(device->i2c_port, lead->i2c_port)) {
+                    i2c_trans_t *t = batch[i];
+                    memmove(&batch[end + 1], &batch[end], (i - end) * sizeof(batch[0]));
+                    batch[end++] = t;
+                }
+            }
+
+            i2c_apply_bus(lead);
+            for (uint8_t i = done; i < end; i++) {
+                i2c_engine_run(batch[i]);
+            }
+            i2c_free_bus(lead);
+
+            /* Completion is reported once the bus is free again */
+            for (uint8_t i = done; i < end; i++) {
+                i2c_trans_t *trans = batch[i];
+                TaskHandle_t notify_task = trans->notify_task;
+                SemaphoreHandle_t done_sem = trans->done_sem;
+                if (trans->callback) {
+                    trans->callback(trans);
+                }
+                if (notify_task) {
+                    xTaskNotifyGive(notify_task);
+                }
+                /* Last, the waiter may free the descriptor as soon as it runs */
+                if (done_sem) {
+                    xSemaphoreGive(done_sem);
+                }
+            }
+            done = end;
+        }
+    }
+}
@@ -0,0 +1,91 @@
+/**
+ * @file disp_area.h
+ *
+ * Bus cost model for the ILI9342C address window and the merge policy
+ * used to join neighbouring invalidated areas before they are flushed.
+ */
+
+#ifndef DISP_AREA_H
+#define DISP_AREA_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "lvgl/lvgl.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+/* CASET/RASET are one command byte followed by four parameter bytes */
+#define DISP_AREA_ADDR_CMD_BYTES    5
+/* RAMWR carries no parameter bytes */
+#define DISP_AREA_RAMWR_CMD_BYTES   1
+/* Bytes sent for a complete address window: CASET + RASET + RAMWR */
+#define DISP_AREA_WINDOW_CMD_BYTES  (2 * DISP_AREA_ADDR_CMD_BYTES + DISP_AREA_RAMWR_CMD_BYTES)
+
+/* Every address window costs the command bytes plus the setup of a few
+ * SPI transactions and DC toggles. Expressed in pixels, this is how much
+ * extra area may be pushed to save one window. */
+#ifndef DISP_AREA_WINDOW_COST_PX
+#define DISP_AREA_WINDOW_COST_PX    512
+#endif
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/* Bus traffic counters for the display flush path */
+typedef struct {
+    uint32_t frames;        /* Refreshes that flushed at least one area */
+    uint32_t windows;       /* Flush calls, i.e. RAMWR commands */
+    uint32_t merged;        /* Invalidated areas absorbed by a neighbour */
+    uint32_t pixel_bytes;   /* Colour data bytes */
+    uint32_t cmd_bytes;     /* Command and parameter bytes */
+    uint32_t busy_us;       /* Time spent rendering and flushing */
+    uint32_t latency_us;    /* Sum of the times from first invalidation to frame end */
+    uint32_t latency_max_us;/* Worst time from first invalidation to frame end */
+} disp_flush_stats_t;
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+/**
+ * Merge neighbouring areas when pushing their bounding box is cheaper than
+ * opening a separate address window for each of them.
+ * Uses the same bookkeeping as LVGL: an area merged into another one is
+ * flagged in `joined` and must be skipped by the caller.
+ * @param areas invalidated areas, updated in place
+ * @param joined one flag per area, non-zero for areas already joined
+ * @param count number of entries in `areas` and `joined`
+ * @param window_cost_px cost of one extra address window in pixels
+ * @return number of areas merged by this call
+ */
+uint16_t disp_area_merge(lv_area_t * areas, uint8_t * joined, uint16_t count, uint32_t window_cost_px);
+
+/**
+ * Bytes of CASET/RASET/RAMWR needed to move from the previous address window
+ * to the next one. Column or page addresses equal to the ones already
+ * latched in the controller are not resent, RAMWR always is.
+ * @param prev window currently set in the controller or NULL if unknown
+ * @param next window to set
+ * @param send_caset set to true if the column addresses must be sent
+ * @param send_raset set to true if the page addresses must be sent
+ * @return number of command and parameter bytes
+ */
+uint32_t disp_area_window_cmd_bytes(const lv_area_t * prev, const lv_area_t * next,
+                                    bool * send_caset, bool * send_raset);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /*DISP_AREA_H*/
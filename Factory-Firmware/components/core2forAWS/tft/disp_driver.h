@@ -15,12 +15,17 @@ extern "C" {
 #include "lvgl/lvgl.h"
 
 #include "ili9341.h"
+#include "disp_area.h"
 
 
 /*********************
  *      DEFINES
  *********************/
+#if CONFIG_LV_DISP_BUF_MODE_FULL_FRAME
+#define DISP_BUF_SIZE  (LV_HOR_RES_MAX * LV_VER_RES_MAX)
+#else
 #define DISP_BUF_SIZE  (LV_HOR_RES_MAX * 32)
+#endif
 
 /**********************
  *      TYPEDEFS
@@ -36,6 +41,22 @@ void disp_driver_init(void);
 /* Display flush callback */
 void disp_driver_flush(lv_disp_drv_t * drv, const lv_area_t * area, lv_color_t * color_map);
 
+/* Hook the registered display's refresh task to merge invalidated areas.
+ * `on_invalidate` is called whenever a new area of the screen gets dirty. */
+void disp_driver_attach(lv_disp_t * disp, void (*on_invalidate)(void));
+
+/* Copy the bus traffic counters of the flush path */
+void disp_driver_get_flush_stats(disp_flush_stats_t * stats);
+
+/* Clear the bus traffic counters */
+void disp_driver_reset_flush_stats(void);
+
+#if CONFIG_LV_DISP_SPI_BENCHMARK
+/* Redraw the whole active screen `frames` times and log the frame time and
+ * the SPI bus utilisation. Take xGuiSemaphore before calling. */
+void disp_driver_benchmark(lv_disp_t * disp, uint32_t frames);
+#endif
+
 /**********************
  *      MACROS
  **********************/
@@ -14,6 +14,23 @@ extern "C" {
 #include <stdbool.h>
 #include <driver/spi_master.h>
 
+/* Depth of the transaction queue shared by the command and colour phases */
+#ifdef CONFIG_LV_DISP_SPI_QUEUE_SIZE
+#define DISP_SPI_QUEUE_SIZE CONFIG_LV_DISP_SPI_QUEUE_SIZE
+#else
+#define DISP_SPI_QUEUE_SIZE 8
+#endif
+
+#define DISP_SPI_CLOCK_HZ   (40 * 1000 * 1000)
+
+/* Largest single DMA transfer on the bus, longer pixel runs are split */
+#define DISP_SPI_MAX_TRANSFER_SZ    (320 * 32 * 3)
+
+/* Internal RAM the queued transfers out of PSRAM may hold in bounce buffers
+ * at once. Two transfers let the next one be copied while the current one
+ * is clocked out. */
+#define DISP_SPI_MAX_BOUNCE_BYTES   (2 * DISP_SPI_MAX_TRANSFER_SZ)
+
 typedef enum _disp_spi_send_flag_t {
     DISP_SPI_SEND_QUEUED        = 0x00000000,
     DISP_SPI_SEND_POLLING       = 0x00000001,
@@ -29,8 +46,17 @@ typedef enum _disp_spi_send_flag_t {
     DISP_SPI_MODE_DIO           = 0x00000400, /* Reserved */
     DISP_SPI_MODE_QIO           = 0x00000800, /* Reserved */
     DISP_SPI_MODE_DIOQIO_ADDR   = 0x00001000, /* Reserved */
+    DISP_SPI_DC_DATA            = 0x00002000, /* DC high during the transfer, low otherwise */
+    DISP_SPI_RELEASE_BUS        = 0x00004000, /* Last transfer of a queued burst */
 } disp_spi_send_flag_t;
 
+/* One command or data phase of a chained transfer */
+typedef struct _disp_spi_segment_t {
+    const uint8_t *data;
+    size_t length;
+    bool command;       /* DC low for the command byte, high for parameters */
+} disp_spi_segment_t;
+
 typedef struct _disp_spi_read_data {
     uint8_t _dummy_byte;
     union {
@@ -54,16 +80,31 @@ void disp_spi_add_device(spi_host_device_t host);
 void disp_spi_add_device_config(spi_host_device_t host, spi_device_interface_config_t *devcfg);
 void disp_spi_transaction(const uint8_t *data, size_t length,
     disp_spi_send_flag_t flags, disp_spi_read_data *out, uint64_t addr);
+/* Collects the results of the queued transfers of the calling task and hands
+ * the bus back once a burst is complete. Called from another task it waits
+ * for the display to release the bus. */
 void disp_wait_for_pending_transactions(void);
+void disp_spi_send_chain(const disp_spi_segment_t *segments, size_t count);
+void disp_spi_send_pixels(const uint8_t *data, size_t length, disp_spi_send_flag_t flags);
 
-static inline void disp_spi_send_data(uint8_t *data, size_t length) {
+#if CONFIG_LV_DISP_SPI_BENCHMARK
+/* Bytes clocked out to the display since boot */
+uint64_t disp_spi_get_tx_bytes(void);
+#endif
+
+static inline void disp_spi_send_cmd(uint8_t *data, size_t length) {
     disp_spi_transaction(data, length, DISP_SPI_SEND_POLLING, NULL, 0);
 }
 
-static inline void disp_spi_send_colors(uint8_t *data, size_t length) {
-    disp_spi_transaction(data, length,
-        DISP_SPI_SEND_QUEUED | DISP_SPI_SIGNAL_FLUSH,
-        NULL, 0);
+static inline void disp_spi_send_data(uint8_t *data, size_t length) {
+    disp_spi_transaction(data, length, DISP_SPI_SEND_POLLING | DISP_SPI_DC_DATA, NULL, 0);
+}
+
+/* Queue colour data behind the address window. The bus stays owned by the
+ * display until the last part of a refresh has been sent. */
+static inline void disp_spi_send_colors(uint8_t *data, size_t length, bool last) {
+    disp_spi_send_pixels(data, length,
+        DISP_SPI_SIGNAL_FLUSH | (last ? DISP_SPI_RELEASE_BUS : 0));
 }
 
 /**
@@ -38,13 +38,22 @@
 #include <stdio.h>
 #include <math.h>
 #include <complex.h>
+#include <stdatomic.h>
 
 #include "fft.h"
+#include "fft_twiddle.h"
 
 #define TWO_PI 6.28318530
 #define USE_SPLIT_RADIX 1
 #define LARGE_BASE_CASE 1
 
+static void rfft_post(float *y, const float *twiddle_factors, int n, int tw_step);
+static void irfft_pre(float *x, const float *twiddle_factors, int n, int tw_step);
+static void cfft_inplace(float *x, int n, const float *twiddle_factors, int tw_stride);
+static void rfft_inplace(float *x, const float *twiddle_factors, int n, int tw_step);
+
+static _Atomic(fft_config_t *) plan_cache[FFT_PLAN_CACHE_SIZE];
+
 fft_config_t *fft_init(int size, fft_type_t type, fft_direction_t direction, float *input, float *output)
 {
   /*
@@ -60,21 +69,39 @@ fft_config_t *fft_init(int size, fft_type_t type, fft_direction_t direction, flo
   if ((size & (size-1)) != 0)  // tests if size is a power of two
     return NULL;
 
+  // In place is only supported for forward transforms
+  if (input != NULL && input == output && direction == FFT_BACKWARD)
+  {
+    free(config);
+    return NULL;
+  }
+
   // start configuration
   config->flags = 0;
   config->type = type;
   config->direction = direction;
   config->size = size;
 
-  // Allocate and precompute twiddle factors
-  config->twiddle_factors = (float *)malloc(2 * config->size * sizeof(float));
+  // Sizes covered by the shared table read every (max / size)-th entry of
+  // it, only larger ones need their own twiddle factors
+  if (config->size <= FFT_TWIDDLE_MAX_SIZE)
+  {
+    config->twiddle_factors = (float *)fft_twiddle_table;
+    config->twiddle_step = FFT_TWIDDLE_MAX_SIZE / config->size;
+    config->flags |= FFT_SHARED_TWIDDLES;
+  }
+  else
+  {
+    config->twiddle_factors = (float *)malloc(2 * config->size * sizeof(float));
+    config->twiddle_step = 1;
 
-  float two_pi_by_n = TWO_PI / config->size;
+    float two_pi_by_n = TWO_PI / config->size;
 
-  for (k = 0, m = 0 ; k < config->size ; k++, m+=2)
-  {
-    config->twiddle_factors[m] = cosf(two_pi_by_n * k);    // real
-    config->twiddle_factors[m+1] = sinf(two_pi_by_n * k);  // imag
+    for (k = 0, m = 0 ; k < config->size ; k++, m+=2)
+    {
+      config->twiddle_factors[m] = cosf(two_pi_by_n * k);    // real
+      config->twiddle_factors[m+1] = sinf(two_pi_by_n * k);  // imag
+    }
   }
 
   // Allocate input buffer
@@ -112,28 +139,120 @@ fft_config_t *fft_init(int size, fft_type_t type, fft_direction_t direction, flo
   return config;
 }
 
+static void plan_discard(fft_config_t *config)
+{
+  // A plan built for the cache that never made it in
+  config->flags &= ~FFT_CACHED_PLAN;
+  fft_destroy(config);
+}
+
+fft_config_t *fft_plan_get(int size, fft_type_t type, fft_direction_t direction)
+{
+  /*
+   * Return the cached plan for this size, type and direction, creating it
+   * on first use. Cached plans live for the whole program and must not be
+   * passed to fft_destroy().
+   *
+   * fft_init() allocates, so a missing plan is built without holding
+   * anything and published into a free slot with a compare and swap. A
+   * task that loses the race for that slot to the same plan frees its own
+   * and returns the winner's.
+   */
+  int k;
+  fft_config_t *config = NULL;
+  fft_config_t *slot;
+
+  for (k = 0 ; k < FFT_PLAN_CACHE_SIZE ; k++)
+  {
+    slot = atomic_load_explicit(&plan_cache[k], memory_order_acquire);
+
+    if (slot == NULL)
+    {
+      if (config == NULL)
+      {
+        config = fft_init(size, type, direction, NULL, NULL);
+        if (config == NULL)
+          return NULL;
+        config->flags |= FFT_CACHED_PLAN;
+      }
+
+      if (atomic_compare_exchange_strong_explicit(&plan_cache[k], &slot, config,
+                                                  memory_order_acq_rel, memory_order_acquire))
+        return config;
+      // Lost the slot, slot now holds the plan that took it
+    }
+
+    if (slot->size == size && slot->type == type && slot->direction == direction)
+    {
+      if (config != NULL)
+        plan_discard(config);
+      return slot;
+    }
+  }
+
+  // Cache full: no plan rather than one the caller would have to destroy
+  if (config != NULL)
+    plan_discard(config);
+
+  return NULL;
+}
+
 void fft_destroy(fft_config_t *config)
 {
+  if (config->flags & FFT_CACHED_PLAN)
+    return;
+
   if (config->flags & FFT_OWN_INPUT_MEM)
     free(config->input);
 
   if (config->flags & FFT_OWN_OUTPUT_MEM)
     free(config->output);
 
-  free(config->twiddle_factors);
+  if (!(config->flags & FFT_SHARED_TWIDDLES))
+    free(config->twiddle_factors);
   free(config);
 }
 
 void fft_execute(fft_config_t *config)
 {
-  if (config->type == FFT_REAL && config->direction == FFT_FORWARD)
-    rfft(config->input, config->output, config->twiddle_factors, config->size);
+  int n = config->size;
+  int step = config->twiddle_step;
+  float *x = config->input;
+  float *y = config->output;
+  float *tw = config->twiddle_factors;
+
+  if (x == y && config->direction == FFT_FORWARD)
+  {
+    // In place, no second buffer and no copy
+    if (config->type == FFT_REAL)
+      rfft_inplace(x, tw, n, step);
+    else
+      cfft_inplace(x, n, tw, 2 * step);
+  }
+  else if (config->type == FFT_REAL && config->direction == FFT_FORWARD)
+  {
+#if USE_SPLIT_RADIX
+    split_radix_fft(x, y, n / 2, 2, tw, 4 * step);
+#else
+    fft_primitive(x, y, n / 2, 2, tw, 4 * step);
+#endif
+    rfft_post(y, tw, n, step);
+  }
   else if (config->type == FFT_REAL && config->direction == FFT_BACKWARD)
-    irfft(config->input, config->output, config->twiddle_factors, config->size);
+  {
+    irfft_pre(x, tw, n, step);
+    ifft_primitive(x, y, n / 2, 2, tw, 4 * step);
+  }
   else if (config->type == FFT_COMPLEX && config->direction == FFT_FORWARD)
-    fft(config->input, config->output, config->twiddle_factors, config->size);
+  {
+#if USE_SPLIT_RADIX
+    split_radix_fft(x, y, n, 2, tw, 2 * step);
+#else
+    fft_primitive(x, y, n, 2, tw, 2 * step);
+#endif
+  }
   else if (config->type == FFT_COMPLEX && config->direction == FFT_BACKWARD)
-    ifft(config->input, config->output, config->twiddle_factors, config->size);
+    ifft_primitive(x, y, n, 2, tw, 2 * step);
 }
 
 void fft(float *input, float *output, float *twiddle_factors, int n)
@@ -191,6 +310,11 @@ void rfft(float *x, float *y, float *twiddle_factors, int n)
   fft_primitive(x, y, n / 2, 2, twiddle_factors, 4);
 #endif
 
+  rfft_post(y, twiddle_factors, n, 1);
+}
+
+static void rfft_post(float *y, const float *twiddle_factors, int n, int tw_step)
+{
   // Now apply post processing to recover positive
   // frequencies of the real FFT
   float t = y[0];
@@ -207,8 +331,8 @@ void rfft(float *x, float *y, float *twiddle_factors, int n)
   {
     float xer, xei, xor_t, xoi, c, s, tr, ti;
 
-    c = twiddle_factors[k];
-    s = twiddle_factors[k+1];
+    c = twiddle_factors[k * tw_step];
+    s = twiddle_factors[k * tw_step + 1];
     
     // even half coefficient
     xer = 0.5 * (y[k] + y[n-k]);
@@ -234,6 +358,13 @@ void irfft(float *x, float *y, float *twiddle_factors, int n)
   /*
    * Destroys content of input vector
    */
+  irfft_pre(x, twiddle_factors, n, 1);
+
+  ifft_primitive(x, y, n / 2, 2, twiddle_factors, 4);
+}
+
+static void irfft_pre(float *x, const float *twiddle_factors, int n, int tw_step)
+{
   int k;
 
   // Here we need to apply a pre-processing first
@@ -247,8 +378,8 @@ void irfft(float *x, float *y, float *twiddle_factors, int n)
   {
     float xer, xei, xor_t, xoi, c, s, tr, ti;
 
-    c = twiddle_factors[k];
-    s = twiddle_factors[k+1];
+    c = twiddle_factors[k * tw_step];
+    s = twiddle_factors[k * tw_step + 1];
 
     xer = 0.5 * (x[k] + x[n-k]);
     tr  = 0.5 * (x[k] - x[n-k]);
@@ -265,8 +396,114 @@ void irfft(float *x, float *y, float *twiddle_factors, int n)
     x[n-k]   = xer + xoi;
     x[n-k+1] = xor_t - xei;
   }
+}
 
-  ifft_primitive(x, y, n / 2, 2, twiddle_factors, 4);
+static void cfft_inplace(float *x, int n, const float *twiddle_factors, int tw_stride)
+{
+  /*
+   * Forward fast Fourier transform
+   * DIT, radix-2, in-place iterative implementation
+   *
+   * Parameters
+   * ----------
+   *  x (float *)
+   *    The array containing the complex samples with real/imaginary parts
+   *    interleaved, overwritten by the spectrum
+   *  n (int)
+   *    The FFT size, should be a power of 2
+   *  tw_stride (int)
+   *    The number of elements to skip between two successive twiddle factors
+   */
+  int i, j, k, len;
+  float t;
+
+  // Bit reversal permutation
+  for (i = 1, j = 0 ; i < n ; i++)
+  {
+    int bit = n >> 1;
+    for ( ; j & bit ; bit >>= 1)
+      j ^= bit;
+    j ^= bit;
+
+    if (i < j)
+    {
+      t = x[2 * i];
+      x[2 * i] = x[2 * j];
+      x[2 * j] = t;
+
+      t = x[2 * i + 1];
+      x[2 * i + 1] = x[2 * j + 1];
+      x[2 * j + 1] = t;
+    }
+  }
+
+  // First two stages merged into radix-4 butterflies, their twiddle
+  // factors are 1 and -j so no multiplication is needed
+  for (i = 0 ; i + 3 < n ; i += 4)
+  {
+    float *a = &x[2 * i];
+    float s0r = a[0] + a[2], s0i = a[1] + a[3];
+    float d0r = a[0] - a[2], d0i = a[1] - a[3];
+    float s1r = a[4] + a[6], s1i = a[5] + a[7];
+    float d1r = a[4] - a[6], d1i = a[5] - a[7];
+
+    a[0] = s0r + s1r;
+    a[1] = s0i + s1i;
+    a[4] = s0r - s1r;
+    a[5] = s0i - s1i;
+    // d1 * -j
+    a[2] = d0r + d1i;
+    a[3] = d0i - d1r;
+    a[6] = d0r - d1i;
+    a[7] = d0i + d1r;
+  }
+
+  // Sizes below 4 only have the first stage
+  if (n == 2)
+  {
+    t = x[0];
+    x[0] = t + x[2];
+    x[2] = t - x[2];
+    t = x[1];
+    x[1] = t + x[3];
+    x[3] = t - x[3];
+  }
+
+  // Remaining stages, one twiddle factor load per group
+  for (len = 8 ; len <= n ; len <<= 1)
+  {
+    int half = len / 2;
+    int step = (n / len) * tw_stride;
+
+    for (k = 0 ; k < half ; k++)
+    {
+      float c = twiddle_factors[k * step];
+      float s = twiddle_factors[k * step + 1];
+
+      for (i = k ; i < n ; i += len)
+      {
+        float *a = &x[2 * i];
+        float *b = &x[2 * (i + half)];
+        float x2r =  c * b[0] + s * b[1];
+        float x2i = -s * b[0] + c * b[1];
+
+        b[0] = a[0] - x2r;
+        b[1] = a[1] - x2i;
+        a[0] += x2r;
+        a[1] += x2i;
+      }
+    }
+  }
+}
+
+static void rfft_inplace(float *x, const float *twiddle_factors, int n, int tw_step)
+{
+  /*
+   * Real forward FFT without an output buffer, the spectrum replaces the
+   * samples in the same layout as rfft() produces
+   */
+  cfft_inplace(x, n / 2, twiddle_factors, 4 * tw_step);
+  rfft_post(x, twiddle_factors, n, tw_step);
 }
 
 void fft_primitive(float *x, float *y, int n, int stride, float *twiddle_factors, int tw_stride)
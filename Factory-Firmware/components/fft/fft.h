@@ -51,6 +51,12 @@ typedef enum
 
 #define FFT_OWN_INPUT_MEM 1
 #define FFT_OWN_OUTPUT_MEM 2
+#define FFT_SHARED_TWIDDLES 4
+#define FFT_CACHED_PLAN 8
+
+#ifndef FFT_PLAN_CACHE_SIZE
+#define FFT_PLAN_CACHE_SIZE 4
+#endif
 
 typedef struct
 {
@@ -61,9 +67,15 @@ typedef struct
   fft_type_t type;   // real or complex
   fft_direction_t direction; // forward or backward
   unsigned int flags; // FFT flags
+  int twiddle_step;  // entries of twiddle_factors to skip between two successive ones
 } fft_config_t;
 
 fft_config_t *fft_init(int size, fft_type_t type, fft_direction_t direction, float *input, float *output);
+// Cached plans are shared: every caller asking for the same size, type and
+// direction gets the same input and output buffers, so two tasks must not
+// run the same plan at the same time. A task that may overlap with another
+// one on the same size keeps its own plan from fft_init() instead.
+fft_config_t *fft_plan_get(int size, fft_type_t type, fft_direction_t direction);
 void fft_destroy(fft_config_t *config);
 void fft_execute(fft_config_t *config);
 void fft(float *input, float *output, float *twiddle_factors, int n);
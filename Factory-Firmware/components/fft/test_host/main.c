@@ -0,0 +1,298 @@
+/*
+ * Host-side benchmark and correctness check for ../fft.c.
+ *
+ * Checks every plan flavour against a direct DFT, then times a 512-point
+ * real FFT three ways:
+ *  - per block: fft_init() + fft_execute() + fft_destroy() with per-plan
+ *    twiddle factors computed with cosf()/sinf(), as fft_init() did before
+ *    the shared table and as the microphone tasks called it every block
+ *  - kept plan: the same out-of-place rfft() on a plan kept across blocks
+ *  - cached: fft_plan_get(), out of place with the shared twiddle table
+ *  - in place: a plan whose input and output are the same buffer, which
+ *    saves the output buffer at the cost of a bit reversal pass
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <assert.h>
+#include <pthread.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "fft.h"
+
+#define BENCH_SIZE  512
+#define BENCH_ITER  20000
+
+static uint64_t now_cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+#endif
+}
+
+/* fft_init() before the shared twiddle table: three allocations and one
+ * cosf()/sinf() pair per point */
+static fft_config_t *legacy_init(int size)
+{
+    fft_config_t *config = malloc(sizeof(fft_config_t));
+    config->size = size;
+    config->type = FFT_REAL;
+    config->direction = FFT_FORWARD;
+    config->flags = FFT_OWN_INPUT_MEM | FFT_OWN_OUTPUT_MEM;
+    config->twiddle_step = 1;
+    config->twiddle_factors = malloc(2 * size * sizeof(float));
+    for (int k = 0; k < size; k++) {
+        config->twiddle_factors[2 * k] = cosf(6.28318530f / size * k);
+        config->twiddle_factors[2 * k + 1] = sinf(6.28318530f / size * k);
+    }
+    config->input = malloc(size * sizeof(float));
+    config->output = malloc(size * sizeof(float));
+    return config;
+}
+
+static void legacy_destroy(fft_config_t *config)
+{
+    free(config->input);
+    free(config->output);
+    free(config->twiddle_factors);
+    free(config);
+}
+
+static void fill(float *x, int n, unsigned seed)
+{
+    srand(seed);
+    for (int i = 0; i < n; i++) {
+        x[i] = (float)(rand() % 2001 - 1000);
+    }
+}
+
+/* Direct DFT of interleaved complex input, for reference */
+static void dft(const float *x, double *y, int n, int sign)
+{
+    for (int k = 0; k < n; k++) {
+        double re = 0, im = 0;
+        for (int j = 0; j < n; j++) {
+            double a = sign * 2 * M_PI * (double)j * k / n;
+            re += x[2 * j] * cos(a) - x[2 * j + 1] * sin(a);
+            im += x[2 * j] * sin(a) + x[2 * j + 1] * cos(a);
+        }
+        y[2 * k] = re;
+        y[2 * k + 1] = im;
+    }
+}
+
+static double max_error_real(const float *spectrum, const float *samples, int n)
+{
+    float *cx = calloc(2 * n, sizeof(float));
+    double *ref = malloc(2 * n * sizeof(double));
+    double err = 0;
+
+    for (int i = 0; i < n; i++) {
+        cx[2 * i] = samples[i];
+    }
+    dft(cx, ref, n, -1);
+
+    /* rfft layout: [0] DC, [1] Nyquist, then re/im pairs */
+    err = fmax(err, fabs(spectrum[0] - ref[0]));
+    err = fmax(err, fabs(spectrum[1] - ref[n]));
+    for (int k = 1; k < n / 2; k++) {
+        err = fmax(err, fabs(spectrum[2 * k] - ref[2 * k]));
+        err = fmax(err, fabs(spectrum[2 * k + 1] - ref[2 * k + 1]));
+    }
+    free(cx);
+    free(ref);
+    return err / n;
+}
+
+static double max_error_complex(const float *spectrum, const float *samples, int n, int sign)
+{
+    double *ref = malloc(2 * n * sizeof(double));
+    double err = 0;
+
+    dft(samples, ref, n, sign);
+    for (int k = 0; k < 2 * n; k++) {
+        double want = sign > 0 ? ref[k] / n : ref[k];
+        err = fmax(err, fabs(spectrum[k] - want));
+    }
+    free(ref);
+    return err / n;
+}
+
+static void test_accuracy(void)
+{
+    for (int n = 16; n <= 2048; n *= 2) {
+        float *samples = malloc(2 * n * sizeof(float));
+        fill(samples, 2 * n, n);
+
+        /* Real, out of place and in place */
+        fft_config_t *oop = fft_init(n, FFT_REAL, FFT_FORWARD, NULL, NULL);
+        memcpy(oop->input, samples, n * sizeof(float));
+        fft_execute(oop);
+        assert(max_error_real(oop->output, samples, n) < 1e-3);
+
+        float *buf = malloc(2 * n * sizeof(float));
+        fft_config_t *inplace = fft_init(n, FFT_REAL, FFT_FORWARD, buf, buf);
+        memcpy(buf, samples, n * sizeof(float));
+        fft_execute(inplace);
+        assert(max_error_real(buf, samples, n) < 1e-3);
+
+        /* Real inverse gets the samples back */
+        fft_config_t *inv = fft_init(n, FFT_REAL, FFT_BACKWARD, NULL, NULL);
+        memcpy(inv->input, oop->output, n * sizeof(float));
+        fft_execute(inv);
+        for (int i = 0; i < n; i++) {
+            assert(fabsf(inv->output[i] - samples[i]) < 1e-2f);
+        }
+
+        /* Complex forward in place and inverse out of place */
+        fft_config_t *cplx = fft_init(n, FFT_COMPLEX, FFT_FORWARD, buf, buf);
+        memcpy(buf, samples, 2 * n * sizeof(float));
+        fft_execute(cplx);
+        assert(max_error_complex(buf, samples, n, -1) < 1e-3);
+
+        fft_config_t *icplx = fft_init(n, FFT_COMPLEX, FFT_BACKWARD, NULL, NULL);
+        memcpy(icplx->input, samples, 2 * n * sizeof(float));
+        fft_execute(icplx);
+        assert(max_error_complex(icplx->output, samples, n, 1) < 1e-3);
+
+        assert(fft_init(n, FFT_COMPLEX, FFT_BACKWARD, buf, buf) == NULL);
+
+        fft_destroy(oop);
+        fft_destroy(inv);
+        fft_destroy(cplx);
+        fft_destroy(icplx);
+        fft_destroy(inplace);
+        free(buf);
+        free(samples);
+    }
+
+    /* Cached plans: the same key returns the same plan, and fft_destroy()
+     * leaves it alone */
+    float samples[BENCH_SIZE];
+    fill(samples, BENCH_SIZE, 2);
+    fft_config_t *cached = fft_plan_get(BENCH_SIZE, FFT_REAL, FFT_FORWARD);
+    assert(cached != NULL && (cached->flags & FFT_SHARED_TWIDDLES));
+    assert(cached == fft_plan_get(BENCH_SIZE, FFT_REAL, FFT_FORWARD));
+    assert(cached != fft_plan_get(BENCH_SIZE, FFT_COMPLEX, FFT_FORWARD));
+    fft_destroy(cached);
+    memcpy(cached->input, samples, sizeof(samples));
+    fft_execute(cached);
+    assert(max_error_real(cached->output, samples, BENCH_SIZE) < 1e-3);
+
+    fft_config_t *cached_inv = fft_plan_get(BENCH_SIZE, FFT_REAL, FFT_BACKWARD);
+    assert(cached_inv != NULL && cached_inv->input != cached_inv->output);
+
+    printf("accuracy: all sizes from 16 to 2048 match the direct DFT\n");
+}
+
+#define RACERS 8
+
+static void *race_plan_get(void *arg)
+{
+    return fft_plan_get(BENCH_SIZE / 2, FFT_REAL, FFT_FORWARD);
+}
+
+static void test_plan_race(void)
+{
+    /* Tasks asking for a plan no one built yet all get the one that made it
+     * into the cache, the others are freed */
+    pthread_t threads[RACERS];
+    void *plans[RACERS];
+
+    for (int i = 0; i < RACERS; i++) {
+        pthread_create(&threads[i], NULL, race_plan_get, NULL);
+    }
+    for (int i = 0; i < RACERS; i++) {
+        pthread_join(threads[i], &plans[i]);
+        assert(plans[i] != NULL && plans[i] == plans[0]);
+    }
+    assert(plans[0] == fft_plan_get(BENCH_SIZE / 2, FFT_REAL, FFT_FORWARD));
+
+    /* That was the last slot: a new key gets no plan, known ones still do */
+    assert(fft_plan_get(BENCH_SIZE / 4, FFT_REAL, FFT_FORWARD) == NULL);
+    assert(fft_plan_get(BENCH_SIZE, FFT_REAL, FFT_FORWARD) != NULL);
+}
+
+static volatile float sink;
+
+static void report(const char *name, uint64_t total, uint64_t base)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    const char *unit = "cycles";
+#else
+    const char *unit = "ns";
+#endif
+    printf("  %-12s %9.0f %s/transform  %5.2fx\n", name, (double)total / BENCH_ITER, unit,
+           (double)base / (double)total);
+}
+
+static void bench(void)
+{
+    float samples[BENCH_SIZE];
+    uint64_t start, per_block, kept, cached, inplace;
+
+    fill(samples, BENCH_SIZE, 1);
+
+    start = now_cycles();
+    for (int i = 0; i < BENCH_ITER; i++) {
+        fft_config_t *plan = legacy_init(BENCH_SIZE);
+        memcpy(plan->input, samples, sizeof(samples));
+        rfft(plan->input, plan->output, plan->twiddle_factors, plan->size);
+        sink = plan->output[2];
+        legacy_destroy(plan);
+    }
+    per_block = now_cycles() - start;
+
+    fft_config_t *plan = legacy_init(BENCH_SIZE);
+    start = now_cycles();
+    for (int i = 0; i < BENCH_ITER; i++) {
+        memcpy(plan->input, samples, sizeof(samples));
+        rfft(plan->input, plan->output, plan->twiddle_factors, plan->size);
+        sink = plan->output[2];
+    }
+    kept = now_cycles() - start;
+    legacy_destroy(plan);
+
+    start = now_cycles();
+    for (int i = 0; i < BENCH_ITER; i++) {
+        plan = fft_plan_get(BENCH_SIZE, FFT_REAL, FFT_FORWARD);
+        memcpy(plan->input, samples, sizeof(samples));
+        fft_execute(plan);
+        sink = plan->output[2];
+    }
+    cached = now_cycles() - start;
+
+    float buf[BENCH_SIZE];
+    plan = fft_init(BENCH_SIZE, FFT_REAL, FFT_FORWARD, buf, buf);
+    start = now_cycles();
+    for (int i = 0; i < BENCH_ITER; i++) {
+        memcpy(plan->input, samples, sizeof(samples));
+        fft_execute(plan);
+        sink = plan->output[2];
+    }
+    inplace = now_cycles() - start;
+    fft_destroy(plan);
+
+    printf("%d-point real FFT, %d transforms:\n", BENCH_SIZE, BENCH_ITER);
+    report("per block", per_block, per_block);
+    report("kept plan", kept, per_block);
+    report("cached", cached, per_block);
+    report("in place", inplace, per_block);
+}
+
+int main(void)
+{
+    test_accuracy();
+    test_plan_race();
+    bench();
+    return 0;
+}
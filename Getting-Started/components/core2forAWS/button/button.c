@@ -101,18 +101,22 @@ void Button_Update(Button_t* button, uint8_t press, uint16_t x, uint16_t y) {
 
 static void Button_UpdateTask(void *arg) {
     Button_t* button;
-    uint16_t x, y;
-    bool press;
+    touch_ring_reader_t reader;
+    touch_sample_t sample;
 
+    FT6336U_ReaderInit(&reader);
     for (;;) {
-        FT6336U_GetTouch(&x, &y, &press);
-        xSemaphoreTake(button_lock, portMAX_DELAY);
-        button = button_ahead;
-        while (button != NULL) {
-            Button_Update(button, press, x, y);
-            button = button->next;
+        /* Feed every sample since the last pass, so a tap shorter than
+         * the poll period still toggles the button */
+        while (FT6336U_ReadSample(&reader, &sample)) {
+            xSemaphoreTake(button_lock, portMAX_DELAY);
+            button = button_ahead;
+            while (button != NULL) {
+                Button_Update(button, sample.points ? 1 : 0, sample.x, sample.y);
+                button = button->next;
+            }
+            xSemaphoreGive(button_lock);
         }
-        xSemaphoreGive(button_lock);
         vTaskDelay(pdMS_TO_TICKS(20));
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,55 @@
+/**
+ * @file touch_ring.h
+ * @brief Lock-free ring of timestamped touch samples.
+ *
+ * One producer (the FT6336U task) pushes samples, any number of readers
+ * consume them, each with its own cursor. Neither side blocks: a slow
+ * reader that gets lapped skips ahead and counts the samples it missed.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+/* Number of samples kept, must be a power of two. At the 20 ms poll
+ * period this is more than half a second of touch history. */
+#define TOUCH_RING_SIZE 32
+
+/* @[declare_touch_sample_t] */
+typedef struct {
+    int64_t time_us;    /**< @brief Time the panel was read, in microseconds since boot. */
+    uint8_t points;     /**< @brief Number of touch points, 0 when released. */
+    uint16_t x;         /**< @brief X-coordinate of the first touch point. */
+    uint16_t y;         /**< @brief Y-coordinate of the first touch point. */
+    uint16_t x2;        /**< @brief X-coordinate of the second touch point. */
+    uint16_t y2;        /**< @brief Y-coordinate of the second touch point. */
+} touch_sample_t;
+/* @[declare_touch_sample_t] */
+
+typedef struct {
+    atomic_uint_fast32_t seq;   /* Sample number + 1, 0 while being written */
+    touch_sample_t sample;
+} touch_slot_t;
+
+typedef struct {
+    touch_slot_t slots[TOUCH_RING_SIZE];
+    atomic_uint_fast32_t head;  /* Number of samples pushed so far */
+} touch_ring_t;
+
+/* @[declare_touch_ring_reader_t] */
+typedef struct {
+    uint32_t next;      /**< @brief Number of the next sample to read. */
+    uint32_t dropped;   /**< @brief Samples overwritten before this reader got to them. */
+} touch_ring_reader_t;
+/* @[declare_touch_ring_reader_t] */
+
+void touch_ring_init(touch_ring_t *ring);
+void touch_ring_push(touch_ring_t *ring, const touch_sample_t *sample);
+void touch_ring_reader_init(touch_ring_t *ring, touch_ring_reader_t *reader);
+bool touch_ring_read(touch_ring_t *ring, touch_ring_reader_t *reader, touch_sample_t *sample);
+uint32_t touch_ring_pending(touch_ring_t *ring, const touch_ring_reader_t *reader);
+/* Copy the newest sample. Returns false when nothing was pushed yet, or
+ * when newer samples overwrote it on every retry. */
+bool touch_ring_latest(touch_ring_t *ring, touch_sample_t *sample);
@@ -0,0 +1,16 @@
+/* Minimal stand-in for the LVGL types used by disp_area.c on the host */
+#ifndef LVGL_H
+#define LVGL_H
+
+#include <stdint.h>
+
+typedef int16_t lv_coord_t;
+
+typedef struct {
+    lv_coord_t x1;
+    lv_coord_t y1;
+    lv_coord_t x2;
+    lv_coord_t y2;
+} lv_area_t;
+
+#endif /*LVGL_H*/
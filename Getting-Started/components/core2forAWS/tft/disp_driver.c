@@ -2,18 +2,151 @@
  * @file disp_driver.c
  */
 
+#include <string.h>
+
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 #include <freertos/semphr.h>
 
+#include "esp_log.h"
+#include "esp_timer.h"
+
 #include "disp_driver.h"
 #include "disp_spi.h"
 
+#define TAG "DISP_DRIVER"
+
+static disp_flush_stats_t flush_stats;
+static void (*invalidate_cb)(void);
+static int64_t invalidated_at = 0;
+static bool refreshing = false;
+
+static void disp_driver_refr_task(lv_task_t * task);
+static void disp_driver_rounder(lv_disp_drv_t * drv, lv_area_t * area);
+
 void disp_driver_init(void) {
     ili9341_init();
 }
 
 void disp_driver_flush(lv_disp_drv_t * drv, const lv_area_t * area, lv_color_t * color_map) {
-    ili9341_flush(drv, area, color_map);
+    flush_stats.cmd_bytes += ili9341_flush(drv, area, color_map);
+    flush_stats.pixel_bytes += lv_area_get_size(area) * sizeof(lv_color_t);
+    flush_stats.windows++;
+}
+
+void disp_driver_attach(lv_disp_t * disp, void (*on_invalidate)(void)) {
+    invalidate_cb = on_invalidate;
+    lv_task_set_cb(disp->refr_task, disp_driver_refr_task);
+    /* _lv_inv_area() calls the rounder for every invalidated area, use it
+     * to learn when the screen becomes dirty */
+    disp->driver.rounder_cb = disp_driver_rounder;
 }
 
+void disp_driver_get_flush_stats(disp_flush_stats_t * stats) {
+    *stats = flush_stats;
+}
+
+void disp_driver_reset_flush_stats(void) {
+    memset(&flush_stats, 0, sizeof(flush_stats));
+}
+
+#if CONFIG_LV_DISP_SPI_BENCHMARK
+void disp_driver_benchmark(lv_disp_t * disp, uint32_t frames) {
+    if (frames == 0) {
+        return;
+    }
+
+    disp_wait_for_pending_transactions();
+    uint64_t bytes = disp_spi_get_tx_bytes();
+    int64_t start = esp_timer_get_time();
+
+    for (uint32_t i = 0; i < frames; i++) {
+        lv_obj_invalidate(lv_disp_get_scr_act(disp));
+        lv_refr_now(disp);
+    }
+    disp_wait_for_pending_transactions();
+
+    int64_t elapsed_us = esp_timer_get_time() - start;
+    bytes = disp_spi_get_tx_bytes() - bytes;
+
+    /* Bits the bus could have clocked out in the same time */
+    uint64_t capacity = (uint64_t) elapsed_us * (DISP_SPI_CLOCK_HZ / 1000000);
+    ESP_LOGI(TAG, "benchmark: %u frames, %lld us/frame, %llu bytes, %llu%% bus utilisation",
+             frames, elapsed_us / frames, bytes, capacity ? bytes * 8 * 100 / capacity : 0);
+}
+#endif
+
+/* Doesn't round anything. Records when the screen got dirty and wakes up
+ * whoever runs lv_task_handler(). The refresh also calls it to size the
+ * render bands, which is not an invalidation. An area invalidated while
+ * refreshing re-arms the refresh task, which lv_task_handler() already
+ * accounts for in the time it returns, so no wake-up is lost. */
+static void disp_driver_rounder(lv_disp_drv_t * drv, lv_area_t * area) {
+    (void) drv;
+    (void) area;
+
+    if (refreshing) {
+        return;
+    }
+    if (invalidated_at == 0) {
+        invalidated_at = esp_timer_get_time();
+    }
+    if (invalidate_cb) {
+        invalidate_cb();
+    }
+}
+
+/* Wraps the LVGL refresh task to merge the invalidated areas with the bus
+ * cost model before LVGL joins and renders them. */
+static void disp_driver_refr_task(lv_task_t * task) {
+    lv_disp_t * disp = task->user_data;
+    disp_flush_stats_t before = flush_stats;
+    int64_t start = esp_timer_get_time();
+
+    refreshing = true;
+    flush_stats.merged += disp_area_merge(disp->inv_areas, disp->inv_area_joined,
+                                          disp->inv_p, DISP_AREA_WINDOW_COST_PX);
+
+    _lv_disp_refr_task(task);
+    refreshing = false;
+
+    /* Give the SPI bus back to the SD card once the refresh is out */
+    disp_wait_for_pending_transactions();
+
+    int64_t now = esp_timer_get_time();
+
+    if (flush_stats.windows != before.windows) {
+        flush_stats.frames++;
+        flush_stats.busy_us += now - start;
+        if (invalidated_at) {
+            uint32_t latency = now - invalidated_at;
+            flush_stats.latency_us += latency;
+            if (latency > flush_stats.latency_max_us) {
+                flush_stats.latency_max_us = latency;
+            }
+            invalidated_at = 0;
+        }
+        ESP_LOGD(TAG, "frame: %u windows, %u pixel bytes, %u command bytes, %lld us",
+                 flush_stats.windows - before.windows,
+                 flush_stats.pixel_bytes - before.pixel_bytes,
+                 flush_stats.cmd_bytes - before.cmd_bytes,
+                 now - start);
+    }
+
+#if CONFIG_LV_DISP_SPI_BENCHMARK
+    /* Log the frame rate and the share of CPU time spent in the refresh
+     * once per second */
+    static int64_t period_start = 0;
+    static disp_flush_stats_t period_stats;
+    if (now - period_start >= 1000000) {
+        if (period_start) {
+            int64_t period_us = now - period_start;
+            ESP_LOGI(TAG, "%lld fps, %lld%% CPU in display refresh",
+                     (flush_stats.frames - period_stats.frames) * 1000000LL / period_us,
+                     (flush_stats.busy_us - period_stats.busy_us) * 100LL / period_us);
+        }
+        period_start = now;
+        period_stats = flush_stats;
+    }
+#endif
+}
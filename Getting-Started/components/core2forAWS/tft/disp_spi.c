@@ -6,6 +6,7 @@
 #include "esp_system.h"
 #include "driver/gpio.h"
 #include "driver/spi_master.h"
+#include "soc/soc_memory_layout.h"
 
 #include <string.h>
 
@@ -20,13 +21,39 @@
 
 SemaphoreHandle_t spi_mutex;
 
+static void IRAM_ATTR spi_pre_transfer(spi_transaction_t *trans);
 static void IRAM_ATTR spi_ready (spi_transaction_t *trans);
+static void IRAM_ATTR spi_trans_done(disp_spi_send_flag_t flags);
+static size_t trans_bounce_bytes(const spi_transaction_t *trans);
+static void collect_trans_result(void);
 
 static spi_host_device_t spi_host;
 static spi_device_handle_t spi;
 static volatile uint8_t spi_pending_trans = 0;
+static transaction_cb_t chained_pre_cb;
 static transaction_cb_t chained_post_cb;
 
+/* Queued transactions are copied into this ring and must stay untouched
+ * until their result has been collected with spi_device_get_trans_result() */
+static spi_transaction_ext_t trans_ring[DISP_SPI_QUEUE_SIZE];
+static uint8_t trans_head = 0;
+
+/* Internal RAM the SPI driver holds for the queued transfers it had to copy
+ * out of PSRAM, see trans_bounce_bytes() */
+static size_t bounce_bytes = 0;
+
+/* True while a burst of queued transactions owns the bus. Queuing the
+ * transaction flagged with DISP_SPI_RELEASE_BUS closes it, the task that
+ * opened it hands the bus back in disp_wait_for_pending_transactions()
+ * once the transfers are done. */
+static bool burst_open = false;
+static bool release_pending = false;
+static TaskHandle_t burst_owner = NULL;
+
+#if CONFIG_LV_DISP_SPI_BENCHMARK
+static volatile uint64_t tx_bytes = 0;
+#endif
+
 static uint8_t tft_used_spi_dma = 0;
 
 #define CONFIG_LV_DISP_SPI_CS   5
@@ -40,6 +67,7 @@ void spi_poll() {
         .flags = SPI_TRANS_USE_TXDATA,
         .length = 8,
         .rxlength = 0,
+        .user = (void *) DISP_SPI_DC_DATA, /* Leave DC as the last flush did */
         .tx_data = {0xff}
     };
     spi_device_polling_transmit(spi, &t);
@@ -48,7 +76,9 @@ void spi_poll() {
 
 void disp_spi_add_device_config(spi_host_device_t host, spi_device_interface_config_t *devcfg) {
     spi_host=host;
+    chained_pre_cb=devcfg->pre_cb;
     chained_post_cb=devcfg->post_cb;
+    devcfg->pre_cb=spi_pre_transfer;
     devcfg->post_cb=spi_ready;
     esp_err_t ret=spi_bus_add_device(host, devcfg, &spi);
     assert(ret==ESP_OK);
@@ -61,11 +91,11 @@ void disp_spi_add_device(spi_host_device_t host) {
     gpio_set_level(CONFIG_LV_DISP_SPI_CS, 1);
 
     spi_device_interface_config_t devcfg = {
-        .clock_speed_hz = 40 * 1000 * 1000,
+        .clock_speed_hz = DISP_SPI_CLOCK_HZ,
         .mode = 0,
         .spics_io_num=CONFIG_LV_DISP_SPI_CS,              // CS pin
         .input_delay_ns=0,
-        .queue_size=1,
+        .queue_size=DISP_SPI_QUEUE_SIZE,
         .pre_cb=NULL,
         .post_cb=NULL,
         .flags = SPI_DEVICE_NO_DUMMY,
@@ -81,8 +111,15 @@ void disp_spi_transaction(const uint8_t *data, size_t length,
         return;
     }
 
-    /* Wait for previous pending transaction results */
-    disp_wait_for_pending_transactions();
+    bool queued = !(flags & (DISP_SPI_SEND_POLLING | DISP_SPI_SEND_SYNCHRONOUS));
+
+    /* Polling and synchronous transfers can't be mixed with queued ones,
+     * wait for previous pending transaction results. The mutex isn't
+     * recursive, so they can't be sent from inside an open burst. */
+    if (!queued) {
+        assert(!(burst_open && burst_owner == xTaskGetCurrentTaskHandle()));
+        disp_wait_for_pending_transactions();
+    }
 
     spi_transaction_ext_t t = {0};
 
@@ -119,62 +156,177 @@ void disp_spi_transaction(const uint8_t *data, size_t length,
     /* Save flags for pre/post transaction processing */
     t.base.user = (void *) flags;
 
-    xSemaphoreTake(spi_mutex, portMAX_DELAY);
-    spi_device_acquire_bus(spi, portMAX_DELAY);
-    gpio_set_level(CONFIG_LV_DISP_SPI_CS, 0);
+    if (!queued) {
+        xSemaphoreTake(spi_mutex, portMAX_DELAY);
+        spi_device_acquire_bus(spi, portMAX_DELAY);
+        gpio_set_level(CONFIG_LV_DISP_SPI_CS, 0);
+
+        if (flags & DISP_SPI_SEND_POLLING) {
+            spi_device_polling_transmit(spi, (spi_transaction_t *) &t);
+        } else {
+            spi_device_transmit(spi, (spi_transaction_t *) &t);
+        }
 
-    /* Poll/Complete/Queue transaction */
-    if (flags & DISP_SPI_SEND_POLLING) {
-        spi_device_polling_transmit(spi, (spi_transaction_t *) &t);
         gpio_set_level(CONFIG_LV_DISP_SPI_CS, 1);
         spi_device_release_bus(spi);
         xSemaphoreGive(spi_mutex);
-    } else if (flags & DISP_SPI_SEND_SYNCHRONOUS) {
-        spi_device_transmit(spi, (spi_transaction_t *) &t);
+        return;
+    }
+
+    if (!burst_open) {
+        /* Hand back the previous burst before taking the bus again */
+        disp_wait_for_pending_transactions();
+        xSemaphoreTake(spi_mutex, portMAX_DELAY);
+        spi_device_acquire_bus(spi, portMAX_DELAY);
+        gpio_set_level(CONFIG_LV_DISP_SPI_CS, 0);
+        burst_owner = xTaskGetCurrentTaskHandle();
+        burst_open = true;
+    }
+
+    /* Recycle the oldest descriptors once the ring is full or the bounce
+     * buffers of the queued transfers would exceed their budget. Results
+     * come back in queue order, so the oldest is the one at trans_head. */
+    size_t bounce = trans_bounce_bytes(&t.base);
+    while (spi_pending_trans >= DISP_SPI_QUEUE_SIZE ||
+           (spi_pending_trans && bounce_bytes + bounce > DISP_SPI_MAX_BOUNCE_BYTES)) {
+        collect_trans_result();
+    }
+
+    spi_transaction_ext_t *queuedt = &trans_ring[trans_head];
+    trans_head = (trans_head + 1) % DISP_SPI_QUEUE_SIZE;
+    memcpy(queuedt, &t, sizeof t);
+
+    if (flags & DISP_SPI_RELEASE_BUS) {
+        burst_open = false;
+        release_pending = true;
+    }
+
+    spi_pending_trans++;
+    bounce_bytes += bounce;
+    if (spi_device_queue_trans(spi, (spi_transaction_t *) queuedt, portMAX_DELAY) != ESP_OK) {
+        spi_pending_trans--; /* Clear wait state */
+        bounce_bytes -= bounce;
+
+        /* spi_ready() will never see this descriptor, so signal LVGL and
+         * hand the bus back here or both the GUI and the SD card stall */
+        spi_trans_done(flags);
+        if (flags & DISP_SPI_RELEASE_BUS) {
+            disp_wait_for_pending_transactions();
+        }
+    }
+}
+
+/* Queue a sequence of short command/data phases. The DC line is driven by
+ * spi_pre_transfer(), so no phase has to wait for the previous one. Data
+ * longer than 4 bytes is not copied and must stay valid until sent. */
+void disp_spi_send_chain(const disp_spi_segment_t *segments, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        const disp_spi_segment_t *seg = &segments[i];
+        disp_spi_transaction(seg->data, seg->length,
+            DISP_SPI_SEND_QUEUED | (seg->command ? 0 : DISP_SPI_DC_DATA),
+            NULL, 0);
+    }
+}
+
+/* Queue colour data, split into transfers the bus can take in one DMA run.
+ * `flags` only apply to the final transfer. */
+void disp_spi_send_pixels(const uint8_t *data, size_t length, disp_spi_send_flag_t flags) {
+    while (length > DISP_SPI_MAX_TRANSFER_SZ) {
+        disp_spi_transaction(data, DISP_SPI_MAX_TRANSFER_SZ,
+            DISP_SPI_SEND_QUEUED | DISP_SPI_DC_DATA, NULL, 0);
+        data += DISP_SPI_MAX_TRANSFER_SZ;
+        length -= DISP_SPI_MAX_TRANSFER_SZ;
+    }
+    disp_spi_transaction(data, length, DISP_SPI_SEND_QUEUED | DISP_SPI_DC_DATA | flags, NULL, 0);
+}
+
+void disp_wait_for_pending_transactions(void) {
+    /* Only the task that queued the burst collects its results. Any other
+     * task waits for the bus to be handed back. */
+    if (burst_owner != xTaskGetCurrentTaskHandle()) {
+        xSemaphoreTake(spi_mutex, portMAX_DELAY);
+        xSemaphoreGive(spi_mutex);
+        return;
+    }
+
+    while (spi_pending_trans) {
+        collect_trans_result();
+    }
+
+    /* The acquire and the mutex were taken by this task, release them here
+     * and not from spi_ready(), which runs in the ISR */
+    if (release_pending) {
+        release_pending = false;
+        burst_owner = NULL;
         gpio_set_level(CONFIG_LV_DISP_SPI_CS, 1);
         spi_device_release_bus(spi);
         xSemaphoreGive(spi_mutex);
-    } else {
-        static spi_transaction_ext_t queuedt;
-        memcpy(&queuedt, &t, sizeof t);
-        spi_pending_trans++;
-        if (spi_device_queue_trans(spi, (spi_transaction_t *) &queuedt, portMAX_DELAY) != ESP_OK) {
-            spi_pending_trans--; /* Clear wait state */
-        }
     }
 }
 
-void disp_wait_for_pending_transactions(void) {
+/* The SPI DMA can't read PSRAM. For such a buffer, or one that isn't word
+ * aligned, spi_device_queue_trans() allocates an internal copy that lives
+ * until the result is collected. */
+static size_t trans_bounce_bytes(const spi_transaction_t *trans) {
+    if ((trans->flags & SPI_TRANS_USE_TXDATA) || trans->tx_buffer == NULL) {
+        return 0;
+    }
+    if (esp_ptr_dma_capable(trans->tx_buffer) && ((uintptr_t) trans->tx_buffer % 4) == 0) {
+        return 0;
+    }
+    return (trans->length / 8 + 3) & ~3;
+}
+
+static void collect_trans_result(void) {
     spi_transaction_t *presult;
 
-    while (spi_pending_trans) {
-        if (spi_device_get_trans_result(spi, &presult, portMAX_DELAY) == ESP_OK) {
-            spi_pending_trans--;
-        }
+    if (spi_device_get_trans_result(spi, &presult, portMAX_DELAY) == ESP_OK) {
+        spi_pending_trans--;
+        bounce_bytes -= trans_bounce_bytes(presult);
     }
 }
 
-static void IRAM_ATTR spi_ready(spi_transaction_t *trans) {
+#if CONFIG_LV_DISP_SPI_BENCHMARK
+uint64_t disp_spi_get_tx_bytes(void) {
+    return tx_bytes;
+}
+#endif
+
+static void IRAM_ATTR spi_pre_transfer(spi_transaction_t *trans) {
     disp_spi_send_flag_t flags = (disp_spi_send_flag_t) trans->user;
-    int higher_priority_task_awoken = pdFALSE;
 
-    if (flags & DISP_SPI_SIGNAL_FLUSH) {
-        lv_disp_t * disp = NULL;
-        disp = _lv_refr_get_disp_refreshing();
-        lv_disp_flush_ready(&disp->driver);
+    gpio_set_level(ILI9341_DC, (flags & DISP_SPI_DC_DATA) ? 1 : 0);
 
+    if (chained_pre_cb) {
+        chained_pre_cb(trans);
     }
+}
+
+static void IRAM_ATTR spi_ready(spi_transaction_t *trans) {
+    disp_spi_send_flag_t flags = (disp_spi_send_flag_t) trans->user;
+
+#if CONFIG_LV_DISP_SPI_BENCHMARK
+    tx_bytes += trans->length / 8;
+#endif
 
     if (chained_post_cb) {
         chained_post_cb(trans);
     }
 
-    if (flags & DISP_SPI_SIGNAL_FLUSH) {
+    spi_trans_done(flags);
+}
+
+/* Completion handling shared by spi_ready() and a transfer that failed to
+ * queue. The bus itself is handed back in task context by
+ * disp_wait_for_pending_transactions() */
+static void IRAM_ATTR spi_trans_done(disp_spi_send_flag_t flags) {
+    if (flags & DISP_SPI_RELEASE_BUS) {
         tft_used_spi_dma = 1;
-        gpio_set_level(CONFIG_LV_DISP_SPI_CS, 1);
-        spi_device_release_bus(spi);
-        xSemaphoreGiveFromISR(spi_mutex, &higher_priority_task_awoken);
     }
 
-    if (higher_priority_task_awoken) portYIELD_FROM_ISR();
+    if (flags & DISP_SPI_SIGNAL_FLUSH) {
+        lv_disp_t * disp = NULL;
+        disp = _lv_refr_get_disp_refreshing();
+        lv_disp_flush_ready(&disp->driver);
+    }
 }
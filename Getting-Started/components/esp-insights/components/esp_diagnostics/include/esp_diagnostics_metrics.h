@@ -52,6 +52,16 @@ typedef struct {
     esp_diag_data_type_t type; /*!< Data type of metrics */
 } esp_diag_metrics_meta_t;
 
+/**
+ * @brief Handle of a registered metrics, its index in the order of registration
+ */
+typedef uint16_t esp_diag_metrics_handle_t;
+
+/**
+ * @brief Handle given when the metrics could not be registered
+ */
+#define ESP_DIAG_METRICS_INVALID_HANDLE UINT16_MAX
+
 /**
  * @brief Initialize the diagnostics metrics
  *
@@ -78,6 +88,38 @@ esp_err_t esp_diag_metrics_register(const char *tag,
                                     const char *path,
                                     esp_diag_data_type_t type);
 
+/**
+ * @brief Register a metrics and get its handle
+ *
+ * Same as \ref esp_diag_metrics_register(), the handle can then be used to add
+ * the metrics without looking its key up.
+ *
+ * @param[in]  tag    Tag of metrics
+ * @param[in]  key    Unique key for the metrics
+ * @param[in]  label  Label for the metrics
+ * @param[in]  path   Hierarchical path for key, must be separated by '.' for more than one level
+ * @param[in]  type   Data type of metrics
+ * @param[out] handle Handle of the metrics, can be NULL
+ *
+ * @return ESP_OK if successful, appropriate error code otherwise.
+ */
+esp_err_t esp_diag_metrics_register_with_handle(const char *tag,
+                                                const char *key,
+                                                const char *label,
+                                                const char *path,
+                                                esp_diag_data_type_t type,
+                                                esp_diag_metrics_handle_t *handle);
+
+/**
+ * @brief Get the handle of a registered metrics
+ *
+ * @param[in]  key    Key of the metrics
+ * @param[out] handle Handle of the metrics
+ *
+ * @return ESP_OK if successful, ESP_ERR_NOT_FOUND if the key is not registered.
+ */
+esp_err_t esp_diag_metrics_get_handle(const char *key, esp_diag_metrics_handle_t *handle);
+
 /**
  * @brief Get metadata for all metrics
  *
@@ -109,6 +151,21 @@ esp_err_t esp_diag_metrics_add(esp_diag_data_type_t data_type,
                                const char *key, const void *val,
                                size_t val_sz, uint64_t ts);
 
+/**
+ * @brief Add metrics to storage by handle
+ *
+ * @param[in] handle    Handle of metrics, from \ref esp_diag_metrics_register_with_handle()
+ * @param[in] data_type Data type of metrics \ref esp_diag_data_type_t
+ * @param[in] val       Value of metrics
+ * @param[in] val_sz    Size of val
+ * @param[in] ts        Timestamp in microseconds, this should be the value at the time of data gathering
+ *
+ * @return ESP_OK if successful, appropriate error code otherwise.
+ */
+esp_err_t esp_diag_metrics_add_by_handle(esp_diag_metrics_handle_t handle,
+                                         esp_diag_data_type_t data_type, const void *val,
+                                         size_t val_sz, uint64_t ts);
+
 /**
  * @brief Add the metrics of data type boolean
  *
@@ -179,6 +236,76 @@ esp_err_t esp_diag_metrics_add_mac(const char *key, uint8_t *mac);
  */
 esp_err_t esp_diag_metrics_add_str(const char *key, const char *str);
 
+/**
+ * @brief Add the metrics of data type boolean by handle
+ *
+ * @param[in] handle Handle of the metrics
+ * @param[in] b      Value of the metrics
+ *
+ * @return ESP_OK if successful, appropriate error code otherwise.
+ */
+esp_err_t esp_diag_metrics_add_bool_by_handle(esp_diag_metrics_handle_t handle, bool b);
+
+/**
+ * @brief Add the metrics of data type integer by handle
+ *
+ * @param[in] handle Handle of the metrics
+ * @param[in] i      Value of the metrics
+ *
+ * @return ESP_OK if successful, appropriate error code otherwise.
+ */
+esp_err_t esp_diag_metrics_add_int_by_handle(esp_diag_metrics_handle_t handle, int32_t i);
+
+/**
+ * @brief Add the metrics of data type unsigned integer by handle
+ *
+ * @param[in] handle Handle of the metrics
+ * @param[in] u      Value of the metrics
+ *
+ * @return ESP_OK if successful, appropriate error code otherwise.
+ */
+esp_err_t esp_diag_metrics_add_uint_by_handle(esp_diag_metrics_handle_t handle, uint32_t u);
+
+/**
+ * @brief Add the metrics of data type float by handle
+ *
+ * @param[in] handle Handle of the metrics
+ * @param[in] f      Value of the metrics
+ *
+ * @return ESP_OK if successful, appropriate error code otherwise.
+ */
+esp_err_t esp_diag_metrics_add_float_by_handle(esp_diag_metrics_handle_t handle, float f);
+
+/**
+ * @brief Add the IPv4 address metrics by handle
+ *
+ * @param[in] handle Handle of the metrics
+ * @param[in] ip     IPv4 address
+ *
+ * @return ESP_OK if successful, appropriate error code otherwise.
+ */
+esp_err_t esp_diag_metrics_add_ipv4_by_handle(esp_diag_metrics_handle_t handle, uint32_t ip);
+
+/**
+ * @brief Add the MAC address metrics by handle
+ *
+ * @param[in] handle Handle of the metrics
+ * @param[in] mac    Array of length 6 i.e 6 octets of mac address
+ *
+ * @return ESP_OK if successful, appropriate error code otherwise.
+ */
+esp_err_t esp_diag_metrics_add_mac_by_handle(esp_diag_metrics_handle_t handle, uint8_t *mac);
+
+/**
+ * @brief Add the metrics of data type string by handle
+ *
+ * @param[in] handle Handle of the metrics
+ * @param[in] str    Value of the metrics
+ *
+ * @return ESP_OK if successful, appropriate error code otherwise.
+ */
+esp_err_t esp_diag_metrics_add_str_by_handle(esp_diag_metrics_handle_t handle, const char *str);
+
 #endif /* CONFIG_DIAG_ENABLE_METRICS */
 
 #ifdef __cplusplus
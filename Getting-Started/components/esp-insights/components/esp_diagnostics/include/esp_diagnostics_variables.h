@@ -53,6 +53,16 @@ typedef struct {
     esp_diag_data_type_t type; /*!< Data type of variables */
 } esp_diag_variable_meta_t;
 
+/**
+ * @brief Handle of a registered variable, its index in the order of registration
+ */
+typedef uint16_t esp_diag_variable_handle_t;
+
+/**
+ * @brief Handle given when the variable could not be registered
+ */
+#define ESP_DIAG_VARIABLE_INVALID_HANDLE UINT16_MAX
+
 /**
  * @brief Initialize the diagnostics variable
  *
@@ -79,6 +89,38 @@ esp_err_t esp_diag_variable_register(const char *tag,
                                      const char *path,
                                      esp_diag_data_type_t type);
 
+/**
+ * @brief Register a diagnostics variable and get its handle
+ *
+ * Same as \ref esp_diag_variable_register(), the handle can then be used to add
+ * the variable without looking its key up.
+ *
+ * @param[in]  tag    Tag of variable
+ * @param[in]  key    Unique key for the variable
+ * @param[in]  label  Label for the variable
+ * @param[in]  path   Hierarchical path for key, must be separated by '.' for more than one level
+ * @param[in]  type   Data type of variable
+ * @param[out] handle Handle of the variable, can be NULL
+ *
+ * @return ESP_OK if successful, appropriate error code otherwise.
+ */
+esp_err_t esp_diag_variable_register_with_handle(const char *tag,
+                                                 const char *key,
+                                                 const char *label,
+                                                 const char *path,
+                                                 esp_diag_data_type_t type,
+                                                 esp_diag_variable_handle_t *handle);
+
+/**
+ * @brief Get the handle of a registered variable
+ *
+ * @param[in]  key    Key of the variable
+ * @param[out] handle Handle of the variable
+ *
+ * @return ESP_OK if successful, ESP_ERR_NOT_FOUND if the key is not registered.
+ */
+esp_err_t esp_diag_variable_get_handle(const char *key, esp_diag_variable_handle_t *handle);
+
 /**
  * @brief Get metadata for all variables
  *
@@ -110,6 +152,21 @@ esp_err_t esp_diag_variable_add(esp_diag_data_type_t data_type,
                                 const char *key, const void *val,
                                 size_t val_sz, uint64_t ts);
 
+/**
+ * @brief Add variable to storage by handle
+ *
+ * @param[in] handle    Handle of variable, from \ref esp_diag_variable_register_with_handle()
+ * @param[in] data_type Data type of variable \ref esp_diag_data_type_t
+ * @param[in] val       Value of variable
+ * @param[in] val_sz    Size of val
+ * @param[in] ts        Timestamp in microseconds, this should be the value at the time of data gathering
+ *
+ * @return ESP_OK if successful, appropriate error code otherwise.
+ */
+esp_err_t esp_diag_variable_add_by_handle(esp_diag_variable_handle_t handle,
+                                          esp_diag_data_type_t data_type, const void *val,
+                                          size_t val_sz, uint64_t ts);
+
 /**
  * @brief Add the variable of data type boolean
  *
@@ -180,6 +237,76 @@ esp_err_t esp_diag_variable_add_mac(const char *key, uint8_t *mac);
  */
 esp_err_t esp_diag_variable_add_str(const char *key, const char *str);
 
+/**
+ * @brief Add the variable of data type boolean by handle
+ *
+ * @param[in] handle Handle of the variable
+ * @param[in] b      Value of the variable
+ *
+ * @return ESP_OK if successful, appropriate error code otherwise.
+ */
+esp_err_t esp_diag_variable_add_bool_by_handle(esp_diag_variable_handle_t handle, bool b);
+
+/**
+ * @brief Add the variable of data type integer by handle
+ *
+ * @param[in] handle Handle of the variable
+ * @param[in] i      Value of the variable
+ *
+ * @return ESP_OK if successful, appropriate error code otherwise.
+ */
+esp_err_t esp_diag_variable_add_int_by_handle(esp_diag_variable_handle_t handle, int32_t i);
+
+/**
+ * @brief Add the variable of data type unsigned integer by handle
+ *
+ * @param[in] handle Handle of the variable
+ * @param[in] u      Value of the variable
+ *
+ * @return ESP_OK if successful, appropriate error code otherwise.
+ */
+esp_err_t esp_diag_variable_add_uint_by_handle(esp_diag_variable_handle_t handle, uint32_t u);
+
+/**
+ * @brief Add the variable of data type float by handle
+ *
+ * @param[in] handle Handle of the variable
+ * @param[in] f      Value of the variable
+ *
+ * @return ESP_OK if successful, appropriate error code otherwise.
+ */
+esp_err_t esp_diag_variable_add_float_by_handle(esp_diag_variable_handle_t handle, float f);
+
+/**
+ * @brief Add the IPv4 address variable by handle
+ *
+ * @param[in] handle Handle of the variable
+ * @param[in] ip     IPv4 address
+ *
+ * @return ESP_OK if successful, appropriate error code otherwise.
+ */
+esp_err_t esp_diag_variable_add_ipv4_by_handle(esp_diag_variable_handle_t handle, uint32_t ip);
+
+/**
+ * @brief Add the MAC address variable by handle
+ *
+ * @param[in] handle Handle of the variable
+ * @param[in] mac    Array of length 6 i.e 6 octets of mac address
+ *
+ * @return ESP_OK if successful, appropriate error code otherwise.
+ */
+esp_err_t esp_diag_variable_add_mac_by_handle(esp_diag_variable_handle_t handle, uint8_t *mac);
+
+/**
+ * @brief Add the variable of data type string by handle
+ *
+ * @param[in] handle Handle of the variable
+ * @param[in] str    Value of the variable
+ *
+ * @return ESP_OK if successful, appropriate error code otherwise.
+ */
+esp_err_t esp_diag_variable_add_str_by_handle(esp_diag_variable_handle_t handle, const char *str);
+
 #endif /* CONFIG_DIAG_ENABLE_VARIABLES */
 
 #ifdef __cplusplus
@@ -48,9 +48,22 @@ typedef struct {
     uint64_t max_ts;
 } heap_metrics_data_pt_t;
 
+typedef struct {
+    esp_diag_metrics_handle_t alloc_fail;
+    esp_diag_metrics_handle_t free;
+    esp_diag_metrics_handle_t lfb;
+    esp_diag_metrics_handle_t min_free;
+#ifdef CONFIG_ESP32_SPIRAM_SUPPORT
+    esp_diag_metrics_handle_t ext_free;
+    esp_diag_metrics_handle_t ext_lfb;
+    esp_diag_metrics_handle_t ext_min_free;
+#endif /* CONFIG_ESP32_SPIRAM_SUPPORT */
+} heap_metrics_handles_t;
+
 typedef struct {
     uint32_t period;
     TimerHandle_t handle;
+    heap_metrics_handles_t metrics;
     uint32_t prev_min_free_ever;
     heap_metrics_data_pt_t free;
     heap_metrics_data_pt_t lfb;
@@ -66,7 +79,7 @@ static heap_diag_priv_data_t s_priv_data;
 #if ESP_IDF_VERSION_MAJOR >= 4 && ESP_IDF_VERSION_MINOR >= 2
 static void alloc_failed_hook(size_t size, uint32_t caps, const char *func)
 {
-    esp_diag_metrics_add_uint(KEY_ALLOC_FAIL, size);
+    esp_diag_metrics_add_uint_by_handle(s_priv_data.metrics.alloc_fail, size);
     ESP_DIAG_EVENT(METRICS_TAG, KEY_ALLOC_FAIL " size:0x%x func:%s", size, func);
 }
 #endif
@@ -101,15 +114,15 @@ static void heap_timer_cb(TimerHandle_t handle)
 
     min_free_ever = heap_caps_get_minimum_free_size(MALLOC_CAP_SPIRAM);
     if (min_free_ever < s_priv_data.prev_ext_min_free_ever) {
-        esp_diag_metrics_add_uint(KEY_EXT_MIN_FREE, min_free_ever);
+        esp_diag_metrics_add_uint_by_handle(s_priv_data.metrics.ext_min_free, min_free_ever);
         s_priv_data.prev_ext_min_free_ever = min_free_ever;
     }
     if (count == 0) {
         /* Collect min/max for spiram free and lfb */
-        esp_diag_metrics_add(ESP_DIAG_DATA_TYPE_UINT, KEY_EXT_FREE, &s_priv_data.ext_free.min, sizeof(uint32_t), s_priv_data.ext_free.min_ts);
-        esp_diag_metrics_add(ESP_DIAG_DATA_TYPE_UINT, KEY_EXT_FREE, &s_priv_data.ext_free.max, sizeof(uint32_t), s_priv_data.ext_free.max_ts);
-        esp_diag_metrics_add(ESP_DIAG_DATA_TYPE_UINT, KEY_EXT_LFB, &s_priv_data.ext_lfb.min, sizeof(uint32_t), s_priv_data.ext_lfb.min_ts);
-        esp_diag_metrics_add(ESP_DIAG_DATA_TYPE_UINT, KEY_EXT_LFB, &s_priv_data.ext_lfb.max, sizeof(uint32_t), s_priv_data.ext_lfb.max_ts);
+        esp_diag_metrics_add_by_handle(s_priv_data.metrics.ext_free, ESP_DIAG_DATA_TYPE_UINT, &s_priv_data.ext_free.min, sizeof(uint32_t), s_priv_data.ext_free.min_ts);
+        esp_diag_metrics_add_by_handle(s_priv_data.metrics.ext_free, ESP_DIAG_DATA_TYPE_UINT, &s_priv_data.ext_free.max, sizeof(uint32_t), s_priv_data.ext_free.max_ts);
+        esp_diag_metrics_add_by_handle(s_priv_data.metrics.ext_lfb, ESP_DIAG_DATA_TYPE_UINT, &s_priv_data.ext_lfb.min, sizeof(uint32_t), s_priv_data.ext_lfb.min_ts);
+        esp_diag_metrics_add_by_handle(s_priv_data.metrics.ext_lfb, ESP_DIAG_DATA_TYPE_UINT, &s_priv_data.ext_lfb.max, sizeof(uint32_t), s_priv_data.ext_lfb.max_ts);
 
         /* Reset values */
         s_priv_data.ext_free.min = s_priv_data.ext_free.max = free;
@@ -141,16 +154,16 @@ static void heap_timer_cb(TimerHandle_t handle)
 
     min_free_ever = heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL);
     if (min_free_ever < s_priv_data.prev_min_free_ever) {
-        esp_diag_metrics_add_uint(KEY_MIN_FREE, min_free_ever);
+        esp_diag_metrics_add_uint_by_handle(s_priv_data.metrics.min_free, min_free_ever);
         s_priv_data.prev_min_free_ever = min_free_ever;
     }
 
     if (--count == 0) {
         /* Record min/max for lfb and free heap */
-        esp_diag_metrics_add(ESP_DIAG_DATA_TYPE_UINT, KEY_FREE, &s_priv_data.free.min, sizeof(uint32_t), s_priv_data.free.min_ts);
-        esp_diag_metrics_add(ESP_DIAG_DATA_TYPE_UINT, KEY_FREE, &s_priv_data.free.max, sizeof(uint32_t), s_priv_data.free.max_ts);
-        esp_diag_metrics_add(ESP_DIAG_DATA_TYPE_UINT, KEY_LFB, &s_priv_data.lfb.min, sizeof(uint32_t), s_priv_data.lfb.min_ts);
-        esp_diag_metrics_add(ESP_DIAG_DATA_TYPE_UINT, KEY_LFB, &s_priv_data.lfb.max, sizeof(uint32_t), s_priv_data.lfb.max_ts);
+        esp_diag_metrics_add_by_handle(s_priv_data.metrics.free, ESP_DIAG_DATA_TYPE_UINT, &s_priv_data.free.min, sizeof(uint32_t), s_priv_data.free.min_ts);
+        esp_diag_metrics_add_by_handle(s_priv_data.metrics.free, ESP_DIAG_DATA_TYPE_UINT, &s_priv_data.free.max, sizeof(uint32_t), s_priv_data.free.max_ts);
+        esp_diag_metrics_add_by_handle(s_priv_data.metrics.lfb, ESP_DIAG_DATA_TYPE_UINT, &s_priv_data.lfb.min, sizeof(uint32_t), s_priv_data.lfb.min_ts);
+        esp_diag_metrics_add_by_handle(s_priv_data.metrics.lfb, ESP_DIAG_DATA_TYPE_UINT, &s_priv_data.lfb.max, sizeof(uint32_t), s_priv_data.lfb.max_ts);
 
         /* Reset min/max */
         s_priv_data.free.min = s_priv_data.free.max = free;
@@ -169,9 +182,9 @@ void esp_diag_heap_metrics_dump(void)
     uint32_t lfb = heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL);
     uint32_t min_free_ever = heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL);
 
-    esp_diag_metrics_add_uint(KEY_FREE, free);
-    esp_diag_metrics_add_uint(KEY_LFB, lfb);
-    esp_diag_metrics_add_uint(KEY_MIN_FREE, min_free_ever);
+    esp_diag_metrics_add_uint_by_handle(s_priv_data.metrics.free, free);
+    esp_diag_metrics_add_uint_by_handle(s_priv_data.metrics.lfb, lfb);
+    esp_diag_metrics_add_uint_by_handle(s_priv_data.metrics.min_free, min_free_ever);
 
     ESP_LOGI(LOG_TAG, KEY_FREE ":0x%x " KEY_LFB ":0x%x " KEY_MIN_FREE ":0x%x", free, lfb, min_free_ever);
 #ifdef CONFIG_ESP32_SPIRAM_SUPPORT
@@ -179,9 +192,9 @@ void esp_diag_heap_metrics_dump(void)
     lfb = heap_caps_get_largest_free_block(MALLOC_CAP_SPIRAM);
     min_free_ever = heap_caps_get_minimum_free_size(MALLOC_CAP_SPIRAM);
 
-    esp_diag_metrics_add_uint(KEY_EXT_FREE, free);
-    esp_diag_metrics_add_uint(KEY_EXT_LFB, lfb);
-    esp_diag_metrics_add_uint(KEY_EXT_MIN_FREE, min_free_ever);
+    esp_diag_metrics_add_uint_by_handle(s_priv_data.metrics.ext_free, free);
+    esp_diag_metrics_add_uint_by_handle(s_priv_data.metrics.ext_lfb, lfb);
+    esp_diag_metrics_add_uint_by_handle(s_priv_data.metrics.ext_min_free, min_free_ever);
 
     ESP_LOGI(LOG_TAG, EXT_KEY_FREE ":0x%x " EXT_KEY_LFB ":0x%x " EXT_KEY_MIN_FREE ":0x%x", free, lfb, min_free_ever);
 #endif /* CONFIG_ESP32_SPIRAM_SUPPORT */
@@ -190,17 +203,22 @@ void esp_diag_heap_metrics_dump(void)
 esp_err_t esp_diag_heap_metrics_init(void)
 {
 #if ESP_IDF_VERSION_MAJOR >= 4 && ESP_IDF_VERSION_MINOR >= 2
+    /* Registered before the hook, which records by handle */
+    esp_diag_metrics_register_with_handle(METRICS_TAG, KEY_ALLOC_FAIL, "Malloc fail", METRICS_TAG,
+                                          ESP_DIAG_DATA_TYPE_UINT, &s_priv_data.metrics.alloc_fail);
     esp_err_t err = heap_caps_register_failed_alloc_callback(alloc_failed_hook);
     if (err != ESP_OK) {
         return err;
     }
-    esp_diag_metrics_register(METRICS_TAG, KEY_ALLOC_FAIL, "Malloc fail", METRICS_TAG, ESP_DIAG_DATA_TYPE_UINT);
 #endif
 
 #ifdef CONFIG_ESP32_SPIRAM_SUPPORT
-    esp_diag_metrics_register(METRICS_TAG, KEY_EXT_FREE, "External free heap", PATH_HEAP_EXTERNAL, ESP_DIAG_DATA_TYPE_UINT);
-    esp_diag_metrics_register(METRICS_TAG, KEY_EXT_LFB, "External largest free block", PATH_HEAP_EXTERNAL, ESP_DIAG_DATA_TYPE_UINT);
-    esp_diag_metrics_register(METRICS_TAG, KEY_EXT_MIN_FREE, "External minimum free size", PATH_HEAP_EXTERNAL, ESP_DIAG_DATA_TYPE_UINT);
+    esp_diag_metrics_register_with_handle(METRICS_TAG, KEY_EXT_FREE, "External free heap", PATH_HEAP_EXTERNAL,
+                                          ESP_DIAG_DATA_TYPE_UINT, &s_priv_data.metrics.ext_free);
+    esp_diag_metrics_register_with_handle(METRICS_TAG, KEY_EXT_LFB, "External largest free block", PATH_HEAP_EXTERNAL,
+                                          ESP_DIAG_DATA_TYPE_UINT, &s_priv_data.metrics.ext_lfb);
+    esp_diag_metrics_register_with_handle(METRICS_TAG, KEY_EXT_MIN_FREE, "External minimum free size", PATH_HEAP_EXTERNAL,
+                                          ESP_DIAG_DATA_TYPE_UINT, &s_priv_data.metrics.ext_min_free);
 
     s_priv_data.prev_ext_min_free_ever = heap_caps_get_minimum_free_size(MALLOC_CAP_SPIRAM);
     s_priv_data.ext_free.min = s_priv_data.ext_free.max = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
@@ -210,9 +228,12 @@ esp_err_t esp_diag_heap_metrics_init(void)
 
 #endif /* CONFIG_ESP32_SPIRAM_SUPPORT */
 
-    esp_diag_metrics_register(METRICS_TAG, KEY_FREE, "Free heap", PATH_HEAP_INTERNAL, ESP_DIAG_DATA_TYPE_UINT);
-    esp_diag_metrics_register(METRICS_TAG, KEY_LFB, "Largest free block", PATH_HEAP_INTERNAL, ESP_DIAG_DATA_TYPE_UINT);
-    esp_diag_metrics_register(METRICS_TAG, KEY_MIN_FREE, "Minimum free size", PATH_HEAP_INTERNAL, ESP_DIAG_DATA_TYPE_UINT);
+    esp_diag_metrics_register_with_handle(METRICS_TAG, KEY_FREE, "Free heap", PATH_HEAP_INTERNAL,
+                                          ESP_DIAG_DATA_TYPE_UINT, &s_priv_data.metrics.free);
+    esp_diag_metrics_register_with_handle(METRICS_TAG, KEY_LFB, "Largest free block", PATH_HEAP_INTERNAL,
+                                          ESP_DIAG_DATA_TYPE_UINT, &s_priv_data.metrics.lfb);
+    esp_diag_metrics_register_with_handle(METRICS_TAG, KEY_MIN_FREE, "Minimum free size", PATH_HEAP_INTERNAL,
+                                          ESP_DIAG_DATA_TYPE_UINT, &s_priv_data.metrics.min_free);
 
     s_priv_data.prev_min_free_ever = heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL);
     s_priv_data.free.min = s_priv_data.free.max = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
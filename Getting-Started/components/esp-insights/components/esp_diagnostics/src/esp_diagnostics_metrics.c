@@ -27,38 +27,65 @@
 #define MAX_METRICS_WRITE_SZ     sizeof(esp_diag_data_pt_t)
 #define MAX_STR_METRICS_WRITE_SZ sizeof(esp_diag_str_data_pt_t)
 
+#if DIAG_METRICS_MAX_COUNT >= UINT16_MAX
+#error "CONFIG_DIAG_METRICS_MAX_COUNT must fit in a handle"
+#endif
+
+/* Open addressing table from the hash of a key to its index + 1, at most half full */
+#define DIAG_METRICS_INDEX_SIZE   (2 * DIAG_METRICS_MAX_COUNT + 1)
+
 typedef struct {
     size_t metrics_count;
     esp_diag_metrics_meta_t metrics[DIAG_METRICS_MAX_COUNT];
+    uint32_t hashes[DIAG_METRICS_MAX_COUNT];
+    uint16_t index[DIAG_METRICS_INDEX_SIZE];
     esp_diag_metrics_config_t config;
     bool init;
 } metrics_priv_data_t;
 
 static metrics_priv_data_t s_priv_data;
 
-static const esp_diag_metrics_meta_t *esp_diag_metrics_meta_get(const char *key)
+/* FNV-1a */
+static uint32_t key_hash(const char *key)
 {
-    uint32_t i;
-    if (!key) {
-        return NULL;
+    uint32_t hash = 2166136261u;
+    while (*key) {
+        hash ^= (uint8_t)*key++;
+        hash *= 16777619u;
     }
-    for (i = 0; i < s_priv_data.metrics_count; i++) {
-        if (s_priv_data.metrics[i].key && strcmp(s_priv_data.metrics[i].key, key) == 0) {
-            return &s_priv_data.metrics[i];
+    return hash;
+}
+
+/* Returns the slot of the key in the index, or the empty slot it would take */
+static uint32_t key_slot(const char *key, uint32_t hash)
+{
+    uint32_t slot = hash % DIAG_METRICS_INDEX_SIZE;
+    while (s_priv_data.index[slot]) {
+        uint16_t i = s_priv_data.index[slot] - 1;
+        if (s_priv_data.hashes[i] == hash && strcmp(s_priv_data.metrics[i].key, key) == 0) {
+            break;
         }
+        slot = (slot + 1) % DIAG_METRICS_INDEX_SIZE;
     }
-    return NULL;
+    return slot;
 }
 
-static bool key_present(const char *key)
+static const esp_diag_metrics_meta_t *esp_diag_metrics_meta_get(const char *key)
 {
-    return (esp_diag_metrics_meta_get(key) != NULL);
+    if (!key) {
+        return NULL;
+    }
+    uint16_t i = s_priv_data.index[key_slot(key, key_hash(key))];
+    return i ? &s_priv_data.metrics[i - 1] : NULL;
 }
 
-esp_err_t esp_diag_metrics_register(const char *tag, const char *key,
-                                   const char *label, const char *path,
-                                   esp_diag_data_type_t type)
+esp_err_t esp_diag_metrics_register_with_handle(const char *tag, const char *key,
+                                                const char *label, const char *path,
+                                                esp_diag_data_type_t type, esp_diag_metrics_handle_t *handle)
 {
+    if (handle) {
+        *handle = ESP_DIAG_METRICS_INVALID_HANDLE;
+    }
     if (!tag || !key || !label || !path) {
         ESP_LOGE(TAG, "Failed to register metrics, tag, key, lable, or path is NULL");
         return ESP_ERR_INVALID_ARG;
@@ -70,16 +97,47 @@ esp_err_t esp_diag_metrics_register(const char *tag, const char *key,
         ESP_LOGE(TAG, "No space left for more metrics");
         return ESP_ERR_NO_MEM;
     }
-    if (key_present(key)) {
+    uint32_t hash = key_hash(key);
+    uint32_t slot = key_slot(key, hash);
+    if (s_priv_data.index[slot]) {
         ESP_LOGE(TAG, "Metrics key:%s exists", key);
         return ESP_FAIL;
     }
-    s_priv_data.metrics[s_priv_data.metrics_count].tag = tag;
-    s_priv_data.metrics[s_priv_data.metrics_count].key = key;
-    s_priv_data.metrics[s_priv_data.metrics_count].label = label;
-    s_priv_data.metrics[s_priv_data.metrics_count].path = path;
-    s_priv_data.metrics[s_priv_data.metrics_count].type = type;
+    size_t i = s_priv_data.metrics_count;
+    s_priv_data.metrics[i].tag = tag;
+    s_priv_data.metrics[i].key = key;
+    s_priv_data.metrics[i].label = label;
+    s_priv_data.metrics[i].path = path;
+    s_priv_data.metrics[i].type = type;
+    s_priv_data.hashes[i] = hash;
+    s_priv_data.index[slot] = i + 1;
     s_priv_data.metrics_count++;
+    if (handle) {
+        *handle = i;
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_diag_metrics_register(const char *tag, const char *key,
+                                    const char *label, const char *path,
+                                    esp_diag_data_type_t type)
+{
+    return esp_diag_metrics_register_with_handle(tag, key, label, path, type, NULL);
+}
+
+esp_err_t esp_diag_metrics_get_handle(const char *key, esp_diag_metrics_handle_t *handle)
+{
+    if (!key || !handle) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!s_priv_data.init) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    const esp_diag_metrics_meta_t *meta = esp_diag_metrics_meta_get(key);
+    if (!meta) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    *handle = meta - s_priv_data.metrics;
     return ESP_OK;
 }
 
@@ -119,21 +177,20 @@ esp_err_t esp_diag_metrics_init(esp_diag_metrics_config_t *config)
     return ESP_OK;
 }
 
-esp_err_t esp_diag_metrics_add(esp_diag_data_type_t data_type,
-                               const char *key, const void *val,
-                               size_t val_sz, uint64_t ts)
+esp_err_t esp_diag_metrics_add_by_handle(esp_diag_metrics_handle_t handle,
+                                         esp_diag_data_type_t data_type, const void *val,
+                                         size_t val_sz, uint64_t ts)
 {
-    if (!key || !val) {
+    if (!val) {
         return ESP_ERR_INVALID_ARG;
     }
     if (!s_priv_data.init) {
         return ESP_ERR_INVALID_STATE;
     }
-
-    const esp_diag_metrics_meta_t *metrics = esp_diag_metrics_meta_get(key);
-    if (!metrics) {
+    if (handle >= s_priv_data.metrics_count) {
         return ESP_ERR_NOT_FOUND;
     }
+    const esp_diag_metrics_meta_t *metrics = &s_priv_data.metrics[handle];
     if (metrics->type != data_type) {
         return ESP_ERR_INVALID_ARG;
     }
@@ -146,7 +203,7 @@ esp_err_t esp_diag_metrics_add(esp_diag_data_type_t data_type,
     memset(&data, 0, sizeof(data));
     data.type = ESP_DIAG_DATA_PT_METRICS;
     data.data_type = data_type;
-    data.key = key;
+    data.key = metrics->key;
     data.ts = ts;
     memcpy(&data.value, val, val_sz);
 
@@ -156,6 +213,23 @@ esp_err_t esp_diag_metrics_add(esp_diag_data_type_t data_type,
     return ESP_OK;
 }
 
+esp_err_t esp_diag_metrics_add(esp_diag_data_type_t data_type,
+                               const char *key, const void *val,
+                               size_t val_sz, uint64_t ts)
+{
+    if (!key || !val) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!s_priv_data.init) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    const esp_diag_metrics_meta_t *metrics = esp_diag_metrics_meta_get(key);
+    if (!metrics) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    return esp_diag_metrics_add_by_handle(metrics - s_priv_data.metrics, data_type, val, val_sz, ts);
+}
+
 esp_err_t esp_diag_metrics_add_bool(const char *key, bool b)
 {
     return esp_diag_metrics_add(ESP_DIAG_DATA_TYPE_BOOL, key, &b, sizeof(b), esp_diag_timestamp_get());
@@ -190,3 +264,38 @@ esp_err_t esp_diag_metrics_add_str(const char *key, const char *str)
 {
     return esp_diag_metrics_add(ESP_DIAG_DATA_TYPE_STR, key, str, strlen(str), esp_diag_timestamp_get());
 }
+
+esp_err_t esp_diag_metrics_add_bool_by_handle(esp_diag_metrics_handle_t handle, bool b)
+{
+    return esp_diag_metrics_add_by_handle(handle, ESP_DIAG_DATA_TYPE_BOOL, &b, sizeof(b), esp_diag_timestamp_get());
+}
+
+esp_err_t esp_diag_metrics_add_int_by_handle(esp_diag_metrics_handle_t handle, int32_t i)
+{
+    return esp_diag_metrics_add_by_handle(handle, ESP_DIAG_DATA_TYPE_INT, &i, sizeof(i), esp_diag_timestamp_get());
+}
+
+esp_err_t esp_diag_metrics_add_uint_by_handle(esp_diag_metrics_handle_t handle, uint32_t u)
+{
+    return esp_diag_metrics_add_by_handle(handle, ESP_DIAG_DATA_TYPE_UINT, &u, sizeof(u), esp_diag_timestamp_get());
+}
+
+esp_err_t esp_diag_metrics_add_float_by_handle(esp_diag_metrics_handle_t handle, float f)
+{
+    return esp_diag_metrics_add_by_handle(handle, ESP_DIAG_DATA_TYPE_FLOAT, &f, sizeof(f), esp_diag_timestamp_get());
+}
+
+esp_err_t esp_diag_metrics_add_ipv4_by_handle(esp_diag_metrics_handle_t handle, uint32_t ip)
+{
+    return esp_diag_metrics_add_by_handle(handle, ESP_DIAG_DATA_TYPE_IPv4, &ip, sizeof(ip), esp_diag_timestamp_get());
+}
+
+esp_err_t esp_diag_metrics_add_mac_by_handle(esp_diag_metrics_handle_t handle, uint8_t *mac)
+{
+    return esp_diag_metrics_add_by_handle(handle, ESP_DIAG_DATA_TYPE_MAC, mac, 6, esp_diag_timestamp_get());
+}
+
+esp_err_t esp_diag_metrics_add_str_by_handle(esp_diag_metrics_handle_t handle, const char *str)
+{
+    return esp_diag_metrics_add_by_handle(handle, ESP_DIAG_DATA_TYPE_STR, str, strlen(str), esp_diag_timestamp_get());
+}
@@ -30,6 +30,8 @@
 typedef struct {
     uint32_t period;
     TimerHandle_t handle;
+    esp_diag_metrics_handle_t rssi;
+    esp_diag_metrics_handle_t min_rssi;
     int32_t prev_rssi;
 } wifi_diag_priv_data_t;
 
@@ -48,7 +50,7 @@ static void wifi_evt_handler(void *arg, esp_event_base_t evt_base, int32_t evt_i
 			case WIFI_EVENT_STA_BSS_RSSI_LOW:
 			{
 				wifi_event_bss_rssi_low_t *data = evt_data;
-				esp_diag_metrics_add_int(KEY_MIN_RSSI, data->rssi);
+				esp_diag_metrics_add_int_by_handle(s_priv_data.min_rssi, data->rssi);
                 ets_printf("wifi rssi crossed threshold %d\n", data->rssi);
                 esp_wifi_set_rssi_threshold(data->rssi);
 				break;
@@ -77,7 +79,7 @@ static void wifi_timer_cb(TimerHandle_t handle)
         return;
     }
     if ((rssi / THRESHOLD_INTERVAL) != (s_priv_data.prev_rssi / THRESHOLD_INTERVAL)) {
-        esp_diag_metrics_add_int(KEY_RSSI, rssi);
+        esp_diag_metrics_add_int_by_handle(s_priv_data.rssi, rssi);
     }
     s_priv_data.prev_rssi = rssi;
 }
@@ -86,7 +88,7 @@ void esp_diag_wifi_metrics_dump(void)
 {
     int32_t rssi = get_rssi();
     if (rssi != 1) {
-        esp_diag_metrics_add_int(KEY_RSSI, rssi);
+        esp_diag_metrics_add_int_by_handle(s_priv_data.rssi, rssi);
         ESP_LOGI(LOG_TAG, "%s:%d", KEY_RSSI, rssi);
         s_priv_data.prev_rssi = rssi;
     }
@@ -95,6 +97,9 @@ void esp_diag_wifi_metrics_dump(void)
 esp_err_t esp_diag_wifi_metrics_init(void)
 {
 #if ESP_IDF_VERSION_MAJOR >= 4 && ESP_IDF_VERSION_MINOR >= 3
+    /* Registered before the event handler, which records by handle */
+    esp_diag_metrics_register_with_handle(METRICS_TAG, KEY_MIN_RSSI, "Minimum ever Wi-Fi RSSI", PATH_WIFI_STATION,
+                                          ESP_DIAG_DATA_TYPE_INT, &s_priv_data.min_rssi);
     /* Register the event handler for wifi events */
     esp_err_t err = esp_event_handler_register(WIFI_EVENT, ESP_EVENT_ANY_ID, wifi_evt_handler, NULL);
     if (err != ESP_OK) {
@@ -104,9 +109,9 @@ esp_err_t esp_diag_wifi_metrics_init(void)
     if (err != ESP_OK) {
         ESP_LOGW(LOG_TAG, "Failed to set rssi threshold value");
     }
-    esp_diag_metrics_register(METRICS_TAG, KEY_MIN_RSSI, "Minimum ever Wi-Fi RSSI", PATH_WIFI_STATION, ESP_DIAG_DATA_TYPE_INT);
 #endif
-    esp_diag_metrics_register(METRICS_TAG, KEY_RSSI, "Wi-Fi RSSI", PATH_WIFI_STATION, ESP_DIAG_DATA_TYPE_INT);
+    esp_diag_metrics_register_with_handle(METRICS_TAG, KEY_RSSI, "Wi-Fi RSSI", PATH_WIFI_STATION,
+                                          ESP_DIAG_DATA_TYPE_INT, &s_priv_data.rssi);
 
     s_priv_data.period = POLLING_INTERVAL;
     s_priv_data.handle = xTimerCreate("wifi_metrics", SEC2TICKS(s_priv_data.period),
@@ -0,0 +1,11 @@
+#pragma once
+#include <sdkconfig.h>
+
+/* Errors and warnings go to stderr */
+void esp_log_write_stub(const char *level, const char *tag, const char *format, ...);
+int ets_printf(const char *format, ...);
+
+#define ESP_LOGE(tag, fmt, ...) esp_log_write_stub("E", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) esp_log_write_stub("W", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...) do { (void)(tag); } while (0)
+#define ESP_LOGD(tag, fmt, ...) do { (void)(tag); } while (0)
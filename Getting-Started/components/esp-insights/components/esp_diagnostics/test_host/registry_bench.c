@@ -0,0 +1,270 @@
+/*
+ * Host-side benchmark of the metrics and variables registries of
+ * ../src/esp_diagnostics_metrics.c and ../src/esp_diagnostics_variables.c.
+ *
+ * 64 keys sharing long prefixes, the way the heap, Wi-Fi and network keys do,
+ * are registered and 1M samples are recorded over them in a fixed pseudo
+ * random order, three ways:
+ * - legacy: the add before the hash index, a strcmp() over the registered
+ *   keys for every sample,
+ * - key: esp_diag_*_add_uint(), looked up through the hash index,
+ * - handle: esp_diag_*_add_uint_by_handle(), no lookup at all.
+ * All three have to write the same data points. The strcmp() calls are
+ * counted through the --wrap option of the Makefile.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+#include <assert.h>
+
+#include <esp_diagnostics.h>
+#include <esp_diagnostics_metrics.h>
+#include <esp_diagnostics_variables.h>
+
+#define NUM_KEYS        64
+#define SAMPLES         1000000
+
+int __real_strcmp(const char *s1, const char *s2);
+
+static unsigned long strcmps;
+
+int __wrap_strcmp(const char *s1, const char *s2)
+{
+    strcmps++;
+    return __real_strcmp(s1, s2);
+}
+
+void esp_log_write_stub(const char *level, const char *tag, const char *format, ...)
+{
+    va_list args;
+    fprintf(stderr, "%s (%s): ", level, tag);
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+    fprintf(stderr, "\n");
+}
+
+int ets_printf(const char *format, ...)
+{
+    return 0;
+}
+
+static uint64_t timestamp;
+
+uint64_t esp_diag_timestamp_get(void)
+{
+    return ++timestamp;
+}
+
+/* Sum of what was written, to compare the three ways */
+
+typedef struct {
+    unsigned long writes;
+    uint64_t sum;
+} written_t;
+
+static written_t written;
+
+static esp_err_t write_cb(const char *tag, void *data, size_t len, void *cb_arg)
+{
+    esp_diag_data_pt_t *pt = data;
+    assert(len == sizeof(esp_diag_data_pt_t));
+    assert(pt->type == (uintptr_t)cb_arg);
+    written.writes++;
+    written.sum += pt->value.u * (uintptr_t)pt->key + pt->ts;
+    return ESP_OK;
+}
+
+static char keys[NUM_KEYS][32];
+static uint16_t order[SAMPLES];
+
+static void make_keys(void)
+{
+    static const char *prefixes[] = { "heap_internal_", "heap_external_", "wifi_station_", "network_ip_" };
+    for (int i = 0; i < NUM_KEYS; i++) {
+        snprintf(keys[i], sizeof(keys[i]), "%s%s%d", prefixes[i % 4], i % 2 ? "free_" : "lfb_", i);
+    }
+    srand(1);
+    for (int i = 0; i < SAMPLES; i++) {
+        order[i] = rand() % NUM_KEYS;
+    }
+}
+
+/* The add before the hash index, with the same write callback */
+
+typedef const void *(*meta_get_all_t)(uint32_t *len);
+
+static struct {
+    meta_get_all_t meta_get_all;
+    size_t meta_size;
+    esp_diag_data_pt_type_t pt_type;
+} legacy;
+
+static esp_err_t legacy_add_uint(const char *key, uint32_t u)
+{
+    uint32_t len;
+    const uint8_t *metas = legacy.meta_get_all(&len);
+    const esp_diag_metrics_meta_t *meta = NULL;
+    /* Metrics and variables metadata have the same layout */
+    for (uint32_t i = 0; i < len; i++) {
+        const esp_diag_metrics_meta_t *m = (const esp_diag_metrics_meta_t *)(metas + i * legacy.meta_size);
+        if (m->key && strcmp(m->key, key) == 0) {
+            meta = m;
+            break;
+        }
+    }
+    if (!meta) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (meta->type != ESP_DIAG_DATA_TYPE_UINT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    /* Only the size of a non string data point is written */
+    esp_diag_data_pt_t data;
+    memset(&data, 0, sizeof(data));
+    data.type = legacy.pt_type;
+    data.data_type = ESP_DIAG_DATA_TYPE_UINT;
+    data.key = meta->key;
+    data.ts = esp_diag_timestamp_get();
+    memcpy(&data.value, &u, sizeof(u));
+    return write_cb(meta->tag, &data, sizeof(esp_diag_data_pt_t), (void *)(uintptr_t)legacy.pt_type);
+}
+
+/* One registry, metrics or variables, behind the same calls */
+
+typedef struct {
+    const char *name;
+    esp_err_t (*register_with_handle)(const char *key, uint16_t *handle);
+    esp_err_t (*get_handle)(const char *key, uint16_t *handle);
+    esp_err_t (*add_uint)(const char *key, uint32_t u);
+    esp_err_t (*add_uint_by_handle)(uint16_t handle, uint32_t u);
+    esp_err_t (*add_int_by_handle)(uint16_t handle, int32_t i);
+} registry_t;
+
+static esp_err_t metrics_register(const char *key, uint16_t *handle)
+{
+    return esp_diag_metrics_register_with_handle("bench", key, key, "bench.metrics", ESP_DIAG_DATA_TYPE_UINT, handle);
+}
+
+static esp_err_t variable_register(const char *key, uint16_t *handle)
+{
+    return esp_diag_variable_register_with_handle("bench", key, key, "bench.variables", ESP_DIAG_DATA_TYPE_UINT,
+                                                  handle);
+}
+
+static const registry_t registries[] = {
+    {
+        "metrics", metrics_register, esp_diag_metrics_get_handle, esp_diag_metrics_add_uint,
+        esp_diag_metrics_add_uint_by_handle, esp_diag_metrics_add_int_by_handle,
+    },
+    {
+        "variables", variable_register, esp_diag_variable_get_handle, esp_diag_variable_add_uint,
+        esp_diag_variable_add_uint_by_handle, esp_diag_variable_add_int_by_handle,
+    },
+};
+
+static uint16_t handles[NUM_KEYS];
+
+static void register_keys(const registry_t *reg)
+{
+    for (int i = 0; i < NUM_KEYS; i++) {
+        assert(reg->register_with_handle(keys[i], &handles[i]) == ESP_OK);
+        assert(handles[i] == i);
+    }
+    /* Full, and the keys are only found once */
+    uint16_t handle;
+    assert(reg->register_with_handle("one_too_many", &handle) == ESP_ERR_NO_MEM);
+    assert(handle == UINT16_MAX);
+    for (int i = 0; i < NUM_KEYS; i++) {
+        char key[32];
+        strcpy(key, keys[i]);
+        assert(reg->get_handle(key, &handle) == ESP_OK && handle == i);
+    }
+    assert(reg->get_handle("heap_internal_lfb_", &handle) == ESP_ERR_NOT_FOUND);
+    assert(reg->add_uint("heap_internal_lfb_", 1) == ESP_ERR_NOT_FOUND);
+    assert(reg->add_uint_by_handle(NUM_KEYS, 1) == ESP_ERR_NOT_FOUND);
+    assert(reg->add_uint_by_handle(UINT16_MAX, 1) == ESP_ERR_NOT_FOUND);
+    assert(reg->add_int_by_handle(handles[0], 1) == ESP_ERR_INVALID_ARG);
+}
+
+static double elapsed_ns(struct timespec *start)
+{
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) * 1e9 + (end.tv_nsec - start->tv_nsec);
+}
+
+typedef enum {
+    BY_LEGACY,
+    BY_KEY,
+    BY_HANDLE,
+} record_way_t;
+
+static written_t record(const registry_t *reg, record_way_t way, const char *name)
+{
+    struct timespec start;
+    memset(&written, 0, sizeof(written));
+    timestamp = 0;
+    strcmps = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < SAMPLES; i++) {
+        int k = order[i];
+        switch (way) {
+            case BY_LEGACY:
+                legacy_add_uint(keys[k], i);
+                break;
+            case BY_KEY:
+                reg->add_uint(keys[k], i);
+                break;
+            case BY_HANDLE:
+                reg->add_uint_by_handle(handles[k], i);
+                break;
+        }
+    }
+    double ns = elapsed_ns(&start) / SAMPLES;
+    assert(written.writes == SAMPLES);
+    printf("%-10s %-8s %14.2f %10.1f\n", reg->name, name, (double)strcmps / SAMPLES, ns);
+    return written;
+}
+
+int main(void)
+{
+    esp_diag_metrics_config_t metrics_config = {
+        .write_cb = write_cb,
+        .cb_arg = (void *)(uintptr_t)ESP_DIAG_DATA_PT_METRICS,
+    };
+    esp_diag_variable_config_t variable_config = {
+        .write_cb = write_cb,
+        .cb_arg = (void *)(uintptr_t)ESP_DIAG_DATA_PT_VARIABLE,
+    };
+    assert(esp_diag_metrics_register_with_handle("bench", "early", "early", "bench", ESP_DIAG_DATA_TYPE_UINT, NULL)
+           == ESP_ERR_INVALID_STATE);
+    assert(esp_diag_metrics_init(&metrics_config) == ESP_OK);
+    assert(esp_diag_variable_init(&variable_config) == ESP_OK);
+
+    make_keys();
+    printf("%d keys, %d samples\n", NUM_KEYS, SAMPLES);
+    printf("%-10s %-8s %14s %10s\n", "registry", "record", "strcmp/sample", "ns/sample");
+    for (int r = 0; r < 2; r++) {
+        const registry_t *reg = &registries[r];
+        register_keys(reg);
+        if (r == 0) {
+            legacy.meta_get_all = (meta_get_all_t)esp_diag_metrics_meta_get_all;
+            legacy.meta_size = sizeof(esp_diag_metrics_meta_t);
+            legacy.pt_type = ESP_DIAG_DATA_PT_METRICS;
+        } else {
+            legacy.meta_get_all = (meta_get_all_t)esp_diag_variable_meta_get_all;
+            legacy.meta_size = sizeof(esp_diag_variable_meta_t);
+            legacy.pt_type = ESP_DIAG_DATA_PT_VARIABLE;
+        }
+        written_t by_legacy = record(reg, BY_LEGACY, "legacy");
+        written_t by_key = record(reg, BY_KEY, "key");
+        written_t by_handle = record(reg, BY_HANDLE, "handle");
+        assert(by_legacy.sum == by_key.sum && by_key.sum == by_handle.sum);
+        /* Recording by handle compares no key */
+        assert(strcmps == 0);
+    }
+    return 0;
+}
@@ -0,0 +1,8 @@
+/* Options used by the sources built in the host test */
+#define CONFIG_DIAG_ENABLE_METRICS 1
+#define CONFIG_DIAG_ENABLE_VARIABLES 1
+#define CONFIG_DIAG_METRICS_MAX_COUNT 64
+#define CONFIG_DIAG_VARIABLES_MAX_COUNT 64
+#define CONFIG_DIAG_LOG_MSG_ARG_MAX_SIZE 64
+#define CONFIG_FREERTOS_MAX_TASK_NAME_LEN 16
+#define CONFIG_APP_RETRIEVE_LEN_ELF_SHA 16
@@ -207,6 +207,34 @@ typedef struct {
 typedef esp_err_t (*esp_rmaker_device_write_cb_t)(const esp_rmaker_device_t *device, const esp_rmaker_param_t *param,
         const esp_rmaker_param_val_t val, void *priv_data, esp_rmaker_write_ctx_t *ctx);
 
+/** Parameter write request, as passed to \ref esp_rmaker_device_bulk_write_cb_t */
+typedef struct {
+    /** Parameter handle */
+    esp_rmaker_param_t *param;
+    /** Value received for the parameter */
+    esp_rmaker_param_val_t val;
+} esp_rmaker_param_write_req_t;
+
+/** Callback for bulk parameter value write requests.
+ *
+ * Called once for all the parameters of the device which are in a write request, so that
+ * related changes (Eg. power, brightness and hue of a light) can be applied together.
+ * The callback should call the esp_rmaker_param_update_and_report() API for each parameter
+ * whose new value is to be set and reported back. Only these are reported back, in one
+ * report once all the devices in the request have been handled.
+ *
+ * @param[in] device Device handle.
+ * @param[in] write_req Array of write requests, one per parameter.
+ * @param[in] count Number of write requests in the array.
+ * @param[in] priv_data Pointer to the private data passed while creating the device.
+ * @param[in] ctx Context associated with the request.
+ *
+ * @return ESP_OK on success.
+ * @return error in case of failure.
+ */
+typedef esp_err_t (*esp_rmaker_device_bulk_write_cb_t)(const esp_rmaker_device_t *device,
+        const esp_rmaker_param_write_req_t write_req[], uint8_t count, void *priv_data, esp_rmaker_write_ctx_t *ctx);
+
 /** Callback for parameter value changes
  *
  * The callback should call the esp_rmaker_param_update_and_report() API if the new value is to be set
@@ -496,6 +524,20 @@ esp_err_t esp_rmaker_device_delete(const esp_rmaker_device_t *device);
  */
 esp_err_t esp_rmaker_device_add_cb(const esp_rmaker_device_t *device, esp_rmaker_device_write_cb_t write_cb, esp_rmaker_device_read_cb_t read_cb);
 
+/** Add bulk write callback for a device
+ *
+ * Add a callback function which gets all the parameters of the device in a write request
+ * in one call. If registered, it is used instead of the write callback added with
+ * esp_rmaker_device_add_cb().
+ *
+ * @param[in] device Device handle.
+ * @param[in] write_cb Bulk write callback.
+ *
+ * @return ESP_OK on success.
+ * @return error in case of failure.
+ */
+esp_err_t esp_rmaker_device_add_bulk_cb(const esp_rmaker_device_t *device, esp_rmaker_device_bulk_write_cb_t write_cb);
+
 /**
  * Add a device to a node
  *
@@ -711,11 +753,33 @@ esp_err_t esp_rmaker_param_add_valid_str_list(const esp_rmaker_param_t *param, c
  */
 esp_err_t esp_rmaker_param_add_array_max_count(const esp_rmaker_param_t *param, int count);
 
+/** Add a deadband to an integer/float parameter
+ *
+ * A change of the parameter is reported only once its value has moved by at least the deadband
+ * from the value last reported. Smaller changes are still applied, they just do not trigger a report.
+ * Useful for sensor readings which keep changing in the last digits.
+ * Eg. esp_rmaker_param_add_deadband(temperature_param, esp_rmaker_float(0.1));
+ *
+ * @note Since a deadband also holds back changes received from the cloud, it is meant for
+ * read-only parameters.
+ *
+ * @param[in] param Parameter handle.
+ * @param[in] deadband Smallest change to be reported. Should be of the same type as the parameter.
+ *
+ * @return ESP_OK on success.
+ * return error in case of failure.
+ */
+esp_err_t esp_rmaker_param_add_deadband(const esp_rmaker_param_t *param, esp_rmaker_param_val_t deadband);
+
 /** Update and report a parameter
  *
  * Calling this API will update the parameter and report it to ESP RainMaker cloud.
  * This should be used whenever there is any local change.
  *
+ * Parameters changed together are sent in a single report. Reports are sent at most once
+ * in CONFIG_ESP_RMAKER_PARAM_REPORT_MIN_INTERVAL, or earlier if the changed parameters
+ * add up to CONFIG_ESP_RMAKER_PARAM_REPORT_FLUSH_SIZE bytes.
+ *
  * @param[in] param Parameter handle.
  * @param[in] val New value of the parameter.
  *
@@ -374,6 +374,12 @@ static esp_err_t esp_rmaker_init(const esp_rmaker_config_t *config, bool use_cla
         ESP_LOGE(TAG, "ESP RainMaker Queue Creation Failed");
         return ESP_ERR_NO_MEM;
     }
+    if (esp_rmaker_param_init() != ESP_OK) {
+        esp_rmaker_deinit_priv_data(esp_rmaker_priv_data);
+        esp_rmaker_priv_data = NULL;
+        ESP_LOGE(TAG, "Failed to initialise params");
+        return ESP_ERR_NO_MEM;
+    }
 #ifndef CONFIG_ESP_RMAKER_DISABLE_USER_MAPPING_PROV
     if (esp_rmaker_user_mapping_prov_init()) {
         esp_rmaker_deinit_priv_data(esp_rmaker_priv_data);
@@ -461,6 +467,10 @@ esp_err_t esp_rmaker_start(void)
     if (esp_rmaker_priv_data->enable_time_sync) {
         esp_rmaker_time_sync_init(NULL);
     }
+    /* Devices and params are all added by now. Index them for the set params requests */
+    if (esp_rmaker_node_build_index(esp_rmaker_get_node()) != ESP_OK) {
+        ESP_LOGW(TAG, "Couldn't index the node. Set params will build the index later.");
+    }
     ESP_LOGI(TAG, "Starting RainMaker Work Queue task");
     if (esp_rmaker_work_queue_start() != ESP_OK) {
         ESP_LOGE(TAG, "Couldn't create RainMaker Work Queue task");
@@ -125,6 +125,9 @@ esp_err_t esp_rmaker_device_add_param(const esp_rmaker_device_t *device, const e
     } else {
         _device->params = _new_param;
     }
+    if (_device->parent) {
+        esp_rmaker_node_invalidate_index(_device->parent);
+    }
     /* We check the stored value here, and not during param creation, because a parameter
      * in itself isn't unique. However, it is unique within a given device and hence can
      * be uniquely represented in storage only when added to a device.
@@ -140,10 +143,13 @@ esp_err_t esp_rmaker_device_add_param(const esp_rmaker_device_t *device, const e
                 }
             }
             _new_param->val = stored_val;
+            /* The stored value comes in storage of its own size */
+            _new_param->val_size = 0;
+            _new_param->fragment_len = 0;
             /* The device callback should be invoked once with the stored value, so
              * that applications can do initialisations as required.
              */
-            if (_device->write_cb) {
+            if (_device->bulk_write_cb || _device->write_cb) {
                 /* However, the callback should be invoked, only if the parameter is not
                  * of type ESP_RMAKER_PARAM_NAME, as it has special handling internally.
                  */
@@ -151,7 +157,15 @@ esp_err_t esp_rmaker_device_add_param(const esp_rmaker_device_t *device, const e
                     esp_rmaker_write_ctx_t ctx = {
                         .src = ESP_RMAKER_REQ_SRC_INIT,
                     };
-                    _device->write_cb(device, param, stored_val, _device->priv_data, &ctx);
+                    if (_device->bulk_write_cb) {
+                        esp_rmaker_param_write_req_t write_req = {
+                            .param = (esp_rmaker_param_t *)param,
+                            .val = stored_val,
+                        };
+                        _device->bulk_write_cb(device, &write_req, 1, _device->priv_data, &ctx);
+                    } else {
+                        _device->write_cb(device, param, stored_val, _device->priv_data, &ctx);
+                    }
                 }
             }
         } else {
@@ -247,6 +261,16 @@ esp_err_t esp_rmaker_device_add_cb(const esp_rmaker_device_t *device, esp_rmaker
     return ESP_OK;
 }
 
+esp_err_t esp_rmaker_device_add_bulk_cb(const esp_rmaker_device_t *device, esp_rmaker_device_bulk_write_cb_t write_cb)
+{
+    if (!device) {
+        ESP_LOGE(TAG, "Device handle cannot be NULL");
+        return ESP_ERR_INVALID_ARG;
+    }
+    ((_esp_rmaker_device_t *)device)->bulk_write_cb = write_cb;
+    return ESP_OK;
+}
+
 char *esp_rmaker_device_get_name(const esp_rmaker_device_t *device)
 {
     if (!device) {
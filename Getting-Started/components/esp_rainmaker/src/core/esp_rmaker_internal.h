@@ -38,6 +38,11 @@ typedef struct {
     const char **str_list;
 } esp_rmaker_param_valid_str_list_t;
 
+typedef struct {
+    esp_rmaker_param_val_t band;
+    esp_rmaker_param_val_t reported;
+} esp_rmaker_param_deadband_t;
+
 struct esp_rmaker_param {
     char *name;
     char *type;
@@ -47,6 +52,17 @@ struct esp_rmaker_param {
     esp_rmaker_param_val_t val;
     esp_rmaker_param_bounds_t *bounds;
     esp_rmaker_param_valid_str_list_t *valid_str_list;
+    esp_rmaker_param_deadband_t *deadband;
+    /* Capacity of val.val.s for string, object and array params, reused by updates that fit */
+    size_t val_size;
+    /* "name":value of the param as it goes in reports, kept until the value changes.
+     * fragment_len is 0 while it has to be generated again.
+     */
+    char *fragment;
+    size_t fragment_len;
+    size_t fragment_size;
+    /* Length of the fragment in the params JSON being built, 0 if the param is not in it */
+    size_t populate_len;
     struct esp_rmaker_device *parent;
     struct esp_rmaker_param * next;
 };
@@ -65,6 +81,7 @@ struct esp_rmaker_device {
     char *type;
     char *subtype;
     esp_rmaker_device_write_cb_t write_cb;
+    esp_rmaker_device_bulk_write_cb_t bulk_write_cb;
     esp_rmaker_device_read_cb_t read_cb;
     void *priv_data;
     bool is_service;
@@ -76,11 +93,22 @@ struct esp_rmaker_device {
 };
 typedef struct esp_rmaker_device _esp_rmaker_device_t;
 
+/* Hash tables from device names and device.param names to their handles,
+ * so that set params requests are dispatched without walking the lists.
+ */
+typedef struct {
+    _esp_rmaker_device_t **devices;
+    _esp_rmaker_param_t **params;
+    uint32_t devices_mask;
+    uint32_t params_mask;
+} esp_rmaker_node_index_t;
+
 typedef struct {
     char *node_id;
     esp_rmaker_node_info_t *info;
     esp_rmaker_attr_t *attributes;
     _esp_rmaker_device_t *devices;
+    esp_rmaker_node_index_t *index;
 } _esp_rmaker_node_t;
 
 esp_rmaker_node_t *esp_rmaker_node_create(const char *name, const char *type);
@@ -91,10 +119,17 @@ esp_err_t esp_rmaker_report_node_config(void);
 esp_err_t esp_rmaker_report_node_state(void);
 _esp_rmaker_device_t *esp_rmaker_node_get_first_device(const esp_rmaker_node_t *node);
 esp_rmaker_attr_t *esp_rmaker_node_get_first_attribute(const esp_rmaker_node_t *node);
+esp_err_t esp_rmaker_node_build_index(const esp_rmaker_node_t *node);
+void esp_rmaker_node_invalidate_index(const esp_rmaker_node_t *node);
+_esp_rmaker_device_t *esp_rmaker_node_find_device(const esp_rmaker_node_t *node, const char *name, size_t len);
+_esp_rmaker_param_t *esp_rmaker_node_find_param(const esp_rmaker_node_t *node, const _esp_rmaker_device_t *device,
+        const char *name, size_t len);
 esp_err_t esp_rmaker_register_for_set_params(void);
 esp_err_t esp_rmaker_report_param_internal(void);
+esp_err_t esp_rmaker_param_init(void);
 esp_err_t esp_rmaker_param_get_stored_value(_esp_rmaker_param_t *param, esp_rmaker_param_val_t *val);
 esp_err_t esp_rmaker_param_store_value(_esp_rmaker_param_t *param);
+esp_err_t esp_rmaker_param_update(const esp_rmaker_param_t *param, esp_rmaker_param_val_t val);
 esp_err_t esp_rmaker_node_delete(const esp_rmaker_node_t *node);
 esp_err_t esp_rmaker_param_delete(const esp_rmaker_param_t *param);
 esp_err_t esp_rmaker_attribute_delete(esp_rmaker_attr_t *attr);
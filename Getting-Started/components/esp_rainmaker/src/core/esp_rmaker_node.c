@@ -83,6 +83,7 @@ esp_err_t esp_rmaker_node_delete(const esp_rmaker_node_t *node)
         if (_node->info) {
             esp_rmaker_node_info_free(_node->info);
         }
+        esp_rmaker_node_invalidate_index(node);
         return ESP_OK;
     }
     return ESP_ERR_INVALID_ARG;
@@ -237,6 +238,7 @@ esp_err_t esp_rmaker_node_add_device(const esp_rmaker_node_t *node, const esp_rm
         _node->devices = _new_device;
     }
     _new_device->parent = node;
+    esp_rmaker_node_invalidate_index(node);
     return ESP_OK;
 }
 
@@ -268,6 +270,7 @@ esp_err_t esp_rmaker_node_remove_device(const esp_rmaker_node_t *node, const esp
         prev_device->next = tmp_device->next;
     }
     tmp_device->parent = NULL;
+    esp_rmaker_node_invalidate_index(node);
     return ESP_OK;
 }
 
@@ -310,3 +313,130 @@ char *esp_rmaker_node_get_id(const esp_rmaker_node_t *node)
     }
     return _node->node_id;
 }
+
+/* FNV-1a, params are hashed together with their device */
+static uint32_t esp_rmaker_name_hash(const char *name, size_t len, const void *device)
+{
+    uint32_t hash = 2166136261u;
+    while (len--) {
+        hash ^= (uint8_t)*name++;
+        hash *= 16777619u;
+    }
+    return hash ^ ((uint32_t)(uintptr_t)device * 2654435761u);
+}
+
+static bool esp_rmaker_name_matches(const char *name, const char *key, size_t len)
+{
+    return (strncmp(name, key, len) == 0) && (name[len] == '\0');
+}
+
+/* Smallest power of two, at least twice the count, so that the tables stay at most half full */
+static uint32_t esp_rmaker_index_slots(size_t count)
+{
+    uint32_t slots = 2;
+    while (slots < 2 * count) {
+        slots <<= 1;
+    }
+    return slots;
+}
+
+void esp_rmaker_node_invalidate_index(const esp_rmaker_node_t *node)
+{
+    _esp_rmaker_node_t *_node = (_esp_rmaker_node_t *)node;
+    if (_node && _node->index) {
+        free(_node->index);
+        _node->index = NULL;
+    }
+}
+
+esp_err_t esp_rmaker_node_build_index(const esp_rmaker_node_t *node)
+{
+    _esp_rmaker_node_t *_node = (_esp_rmaker_node_t *)node;
+    if (!_node) {
+        ESP_LOGE(TAG, "Node handle cannot be NULL.");
+        return ESP_ERR_INVALID_ARG;
+    }
+    size_t num_devices = 0, num_params = 0;
+    _esp_rmaker_device_t *device;
+    _esp_rmaker_param_t *param;
+    for (device = _node->devices; device; device = device->next) {
+        num_devices++;
+        for (param = device->params; param; param = param->next) {
+            num_params++;
+        }
+    }
+    uint32_t device_slots = esp_rmaker_index_slots(num_devices);
+    uint32_t param_slots = esp_rmaker_index_slots(num_params);
+    /* The index and both tables in one allocation */
+    esp_rmaker_node_index_t *index = calloc(1, sizeof(esp_rmaker_node_index_t) +
+            (device_slots + param_slots) * sizeof(void *));
+    if (!index) {
+        ESP_LOGE(TAG, "Failed to allocate memory for node index.");
+        return ESP_ERR_NO_MEM;
+    }
+    index->devices = (_esp_rmaker_device_t **)(index + 1);
+    index->params = (_esp_rmaker_param_t **)(index->devices + device_slots);
+    index->devices_mask = device_slots - 1;
+    index->params_mask = param_slots - 1;
+    for (device = _node->devices; device; device = device->next) {
+        uint32_t slot = esp_rmaker_name_hash(device->name, strlen(device->name), NULL) & index->devices_mask;
+        while (index->devices[slot]) {
+            slot = (slot + 1) & index->devices_mask;
+        }
+        index->devices[slot] = device;
+        for (param = device->params; param; param = param->next) {
+            slot = esp_rmaker_name_hash(param->name, strlen(param->name), device) & index->params_mask;
+            while (index->params[slot]) {
+                slot = (slot + 1) & index->params_mask;
+            }
+            index->params[slot] = param;
+        }
+    }
+    esp_rmaker_node_invalidate_index(node);
+    _node->index = index;
+    ESP_LOGD(TAG, "Indexed %d devices and %d params.", num_devices, num_params);
+    return ESP_OK;
+}
+
+_esp_rmaker_device_t *esp_rmaker_node_find_device(const esp_rmaker_node_t *node, const char *name, size_t len)
+{
+    _esp_rmaker_node_t *_node = (_esp_rmaker_node_t *)node;
+    if (!_node || !name) {
+        return NULL;
+    }
+    /* Devices or params added after the node was indexed */
+    if (!_node->index && (esp_rmaker_node_build_index(node) != ESP_OK)) {
+        return NULL;
+    }
+    esp_rmaker_node_index_t *index = _node->index;
+    uint32_t slot = esp_rmaker_name_hash(name, len, NULL) & index->devices_mask;
+    while (index->devices[slot]) {
+        if (esp_rmaker_name_matches(index->devices[slot]->name, name, len)) {
+            return index->devices[slot];
+        }
+        slot = (slot + 1) & index->devices_mask;
+    }
+    return NULL;
+}
+
+_esp_rmaker_param_t *esp_rmaker_node_find_param(const esp_rmaker_node_t *node, const _esp_rmaker_device_t *device,
+        const char *name, size_t len)
+{
+    _esp_rmaker_node_t *_node = (_esp_rmaker_node_t *)node;
+    if (!_node || !device || !name) {
+        return NULL;
+    }
+    if (!_node->index && (esp_rmaker_node_build_index(node) != ESP_OK)) {
+        return NULL;
+    }
+    esp_rmaker_node_index_t *index = _node->index;
+    uint32_t slot = esp_rmaker_name_hash(name, len, device) & index->params_mask;
+    while (index->params[slot]) {
+        _esp_rmaker_param_t *param = index->params[slot];
+        if ((param->parent == device) && esp_rmaker_name_matches(param->name, name, len)) {
+            return param;
+        }
+        slot = (slot + 1) & index->params_mask;
+    }
+    return NULL;
+}
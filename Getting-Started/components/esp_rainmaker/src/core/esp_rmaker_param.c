@@ -13,9 +13,14 @@
 // limitations under the License.
 #include <sdkconfig.h>
 #include <string.h>
+#include <stdlib.h>
+#include <math.h>
 #include <esp_log.h>
 #include <esp_err.h>
+#include <esp_timer.h>
 #include <nvs.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
 
 #include <json_parser.h>
 #include <json_generator.h>
@@ -23,6 +28,7 @@
 #include <esp_rmaker_core.h>
 #include <esp_rmaker_standard_types.h>
 #include <esp_rmaker_mqtt.h>
+#include <esp_rmaker_work_queue.h>
 
 #include "esp_rmaker_internal.h"
 
@@ -34,6 +40,14 @@
 #define ESP_RMAKER_NVS_PART_NAME        "nvs"
 #define MAX_PUBLISH_TOPIC_LEN           64
 #define RMAKER_PARAMS_SIZE_MARGIN       50
+/* Quotes around the name, colon and comma of a param in a report */
+#define RMAKER_PARAM_REPORT_OVERHEAD    4
+/* Write requests of a bulk write callback kept on the stack */
+#define RMAKER_BULK_WRITE_REQS          8
+/* Storage of string values and report fragments grows in steps of this, so that small
+ * changes in length reuse it.
+ */
+#define RMAKER_PARAM_STORAGE_STEP       32
 
 static size_t max_node_params_size = CONFIG_ESP_RMAKER_MAX_PARAM_DATA_SIZE;
 /* This buffer will be allocated once and will be reused for all param updates.
@@ -41,6 +55,45 @@ static size_t max_node_params_size = CONFIG_ESP_RMAKER_MAX_PARAM_DATA_SIZE;
 static char *node_params_buf;
 static char publish_topic[MAX_PUBLISH_TOPIC_LEN];
 
+typedef enum {
+    RMAKER_REPORT_IDLE = 0,
+    RMAKER_REPORT_TIMER_ARMED,
+    RMAKER_REPORT_QUEUED,
+} esp_rmaker_report_state_t;
+
+/* Changed params are collected and reported together, at most once in min_report_interval_us.
+ * After a quiet period the report is queued right away, so it still goes out without delay but
+ * picks up all the params changed until the work queue gets to it.
+ */
+static const int64_t min_report_interval_us = CONFIG_ESP_RMAKER_PARAM_REPORT_MIN_INTERVAL * 1000LL;
+static esp_timer_handle_t report_timer;
+/* Guards report_state, last_report_time, pending_report_size and the flags of the params, which
+ * the reporting tasks, the esp_timer task and the work queue task all update. The timer and the
+ * work queue are only called after leaving it, so a timer callback that already started finds the
+ * state changed and does nothing.
+ */
+static portMUX_TYPE report_lock = portMUX_INITIALIZER_UNLOCKED;
+static esp_rmaker_report_state_t report_state;
+static int64_t last_report_time;
+/* Estimated size of the params waiting to be reported */
+static size_t pending_report_size;
+/* A set params request being handled by a task. The reports made by its callbacks, in that
+ * task, are held back and go out together when they return. Reports made by other tasks
+ * meanwhile are scheduled as usual.
+ */
+typedef struct esp_rmaker_set_params_call {
+    TaskHandle_t task;
+    int reports;
+    struct esp_rmaker_set_params_call *next;
+} esp_rmaker_set_params_call_t;
+/* The set params requests being handled, guarded by report_lock */
+static esp_rmaker_set_params_call_t *set_params_calls;
+
+/* Guards the values and report fragments of the params, so that a params JSON is built out of
+ * one consistent set of them and no fragment is regenerated while it is being copied.
+ */
+static SemaphoreHandle_t params_lock;
+
 static const char *TAG = "esp_rmaker_param";
 
 
@@ -113,41 +166,201 @@ esp_rmaker_param_val_t esp_rmaker_array(const char *val)
     return param_val;
 }
 
-static esp_err_t esp_rmaker_populate_params(char *buf, size_t *buf_len, uint8_t flags, bool reset_flags)
+static size_t esp_rmaker_param_storage_size(size_t len)
 {
-    esp_err_t err = ESP_OK;
+    return (len + RMAKER_PARAM_STORAGE_STEP - 1) / RMAKER_PARAM_STORAGE_STEP * RMAKER_PARAM_STORAGE_STEP;
+}
+
+/* Copies a string, object or array value into the storage of the param, which is reallocated
+ * only if the value does not fit.
+ */
+static esp_err_t esp_rmaker_param_set_str(_esp_rmaker_param_t *param, const char *val)
+{
+    if (!val) {
+        if (param->val.val.s) {
+            free(param->val.val.s);
+        }
+        param->val.val.s = NULL;
+        param->val_size = 0;
+        return ESP_OK;
+    }
+    size_t len = strlen(val) + 1;
+    if (len <= param->val_size) {
+        /* The new value may be the current one */
+        memmove(param->val.val.s, val, len);
+        return ESP_OK;
+    }
+    size_t size = esp_rmaker_param_storage_size(len);
+    char *new_val = malloc(size);
+    if (!new_val) {
+        return ESP_ERR_NO_MEM;
+    }
+    memcpy(new_val, val, len);
+    if (param->val.val.s) {
+        free(param->val.val.s);
+    }
+    param->val.val.s = new_val;
+    param->val_size = size;
+    return ESP_OK;
+}
+
+/* Generates the "name":value fragment of the param if its value changed since the last time */
+static esp_err_t esp_rmaker_param_update_fragment(_esp_rmaker_param_t *param)
+{
+    if (param->fragment_len) {
+        return ESP_OK;
+    }
     json_gen_str_t jstr;
-    json_gen_str_start(&jstr, buf, *buf_len, NULL, NULL);
-    json_gen_start_object(&jstr);
+    json_gen_str_start(&jstr, param->fragment, param->fragment_size, NULL, NULL);
+    esp_rmaker_report_value(&param->val, param->name, &jstr);
+    size_t req_size = json_gen_str_end(&jstr);
+    if (req_size > param->fragment_size) {
+        size_t size = esp_rmaker_param_storage_size(req_size);
+        char *fragment = realloc(param->fragment, size);
+        if (!fragment) {
+            ESP_LOGE(TAG, "Failed to allocate %d bytes for the report of %s.", size, param->name);
+            return ESP_ERR_NO_MEM;
+        }
+        param->fragment = fragment;
+        param->fragment_size = size;
+        json_gen_str_start(&jstr, param->fragment, param->fragment_size, NULL, NULL);
+        esp_rmaker_report_value(&param->val, param->name, &jstr);
+        req_size = json_gen_str_end(&jstr);
+    }
+    param->fragment_len = req_size - 1;
+    return ESP_OK;
+}
+
+/* Appends data if it fits in buf_len along with the NULL termination. Once something does not
+ * fit, len stays at buf_len and nothing more is appended.
+ */
+static inline size_t esp_rmaker_params_append(char *buf, size_t buf_len, size_t len, const char *data,
+        size_t data_len)
+{
+    if ((len >= buf_len) || (data_len >= buf_len - len)) {
+        return buf_len;
+    }
+    memcpy(buf + len, data, data_len);
+    return len + data_len;
+}
+
+/* Builds the params JSON out of the fragments of the params, which are regenerated only for
+ * the params which changed. The size is worked out first, so that nothing is written, and no
+ * flags are reset, if the buffer is too small. *buf_len is set to the size required, including
+ * the NULL termination.
+ *
+ * The flags of a param may be set by a report any time, so the first pass records in
+ * populate_len which params go in and the second pass writes exactly those. params_lock keeps
+ * their values and fragments as they were for both passes.
+ */
+static esp_err_t esp_rmaker_populate_params_locked(char *buf, size_t *buf_len, uint8_t flags, bool reset_flags)
+{
+    /* The braces of the node object and the NULL termination */
+    size_t req_size = 3;
     _esp_rmaker_device_t *device = esp_rmaker_node_get_first_device(esp_rmaker_get_node());
-    while (device) {
-        bool device_added = false;
-        _esp_rmaker_param_t *param = device->params;
-        while (param) {
+    for (; device; device = device->next) {
+        size_t device_size = 0;
+        for (_esp_rmaker_param_t *param = device->params; param; param = param->next) {
+            param->populate_len = 0;
             if (!flags || (param->flags & flags)) {
-                if (!device_added) {
-                    json_gen_push_object(&jstr, device->name);
-                    device_added = true;
+                esp_err_t err = esp_rmaker_param_update_fragment(param);
+                if (err != ESP_OK) {
+                    return err;
                 }
-                esp_rmaker_report_value(&param->val, param->name, &jstr);
-                if (reset_flags) {
-                    param->flags &= ~flags;
+                param->populate_len = param->fragment_len;
+                /* The fragment and a comma before it */
+                device_size += param->populate_len + 1;
+            }
+        }
+        if (device_size) {
+            /* A comma before the device, "name":{ and } minus the comma of the first param */
+            req_size += strlen(device->name) + 5 + device_size;
+        }
+    }
+    /* There is no comma before the first device */
+    if (req_size > 3) {
+        req_size--;
+    }
+    if (!buf || (req_size > *buf_len)) {
+        *buf_len = req_size;
+        return ESP_ERR_NO_MEM;
+    }
+    size_t buf_size = *buf_len;
+    *buf_len = req_size;
+
+    size_t len = esp_rmaker_params_append(buf, buf_size, 0, "{", 1);
+    device = esp_rmaker_node_get_first_device(esp_rmaker_get_node());
+    for (; device; device = device->next) {
+        bool device_added = false;
+        for (_esp_rmaker_param_t *param = device->params; param; param = param->next) {
+            if (!param->populate_len) {
+                continue;
+            }
+            if (!device_added) {
+                if (len > 1) {
+                    len = esp_rmaker_params_append(buf, buf_size, len, ",", 1);
                 }
+                len = esp_rmaker_params_append(buf, buf_size, len, "\"", 1);
+                len = esp_rmaker_params_append(buf, buf_size, len, device->name, strlen(device->name));
+                len = esp_rmaker_params_append(buf, buf_size, len, "\":{", 3);
+                device_added = true;
+            } else {
+                len = esp_rmaker_params_append(buf, buf_size, len, ",", 1);
             }
-            param = param->next;
+            len = esp_rmaker_params_append(buf, buf_size, len, param->fragment, param->populate_len);
         }
         if (device_added) {
-            json_gen_pop_object(&jstr);
+            len = esp_rmaker_params_append(buf, buf_size, len, "}", 1);
         }
-        device = device->next;
     }
-    if (json_gen_end_object(&jstr) < 0) {
-        err = ESP_ERR_NO_MEM;
+    len = esp_rmaker_params_append(buf, buf_size, len, "}", 1);
+    if (len >= buf_size) {
+        ESP_LOGE(TAG, "Params JSON outgrew the %d bytes worked out for it.", req_size);
+        buf[0] = '\0';
+        return ESP_FAIL;
     }
-    *buf_len = json_gen_str_end(&jstr);
+    buf[len] = '\0';
+
+    if (reset_flags) {
+        device = esp_rmaker_node_get_first_device(esp_rmaker_get_node());
+        for (; device; device = device->next) {
+            for (_esp_rmaker_param_t *param = device->params; param; param = param->next) {
+                if (!param->populate_len) {
+                    continue;
+                }
+                portENTER_CRITICAL(&report_lock);
+                param->flags &= ~flags;
+                portEXIT_CRITICAL(&report_lock);
+                /* The deadband is measured from the last value that was reported */
+                if (param->deadband) {
+                    param->deadband->reported = param->val;
+                }
+            }
+        }
+    }
+    return ESP_OK;
+}
+
+static esp_err_t esp_rmaker_populate_params(char *buf, size_t *buf_len, uint8_t flags, bool reset_flags)
+{
+    xSemaphoreTake(params_lock, portMAX_DELAY);
+    esp_err_t err = esp_rmaker_populate_params_locked(buf, buf_len, flags, reset_flags);
+    xSemaphoreGive(params_lock);
     return err;
 }
 
+esp_err_t esp_rmaker_param_init(void)
+{
+    if (!params_lock) {
+        params_lock = xSemaphoreCreateMutex();
+        if (!params_lock) {
+            ESP_LOGE(TAG, "Failed to create params lock.");
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    return ESP_OK;
+}
+
 /* This function does not use the node_params_buf since this is for external use
  * and we do not want __esp_rmaker_allocate_and_populate_params to overwrite
  * the buffer.
@@ -157,13 +370,11 @@ char *esp_rmaker_get_node_params(void)
     size_t req_size = 0;
     /* Passing NULL pointer to find the required buffer size */
     esp_err_t err = esp_rmaker_populate_params(NULL, &req_size, 0, false);
-    if (err != ESP_OK) {
+    if (err != ESP_ERR_NO_MEM) {
         ESP_LOGE(TAG, "Failed to get required size for Node params JSON.");
         return NULL;
     }
-    /* Keeping some margin just in case some param value changes in between */
-    req_size += RMAKER_PARAMS_SIZE_MARGIN;
-    char *node_params = calloc(1, req_size);
+    char *node_params = malloc(req_size);
     if (!node_params) {
         ESP_LOGE(TAG, "Failed to allocate %d bytes for Node params.", req_size);
         return NULL;
@@ -230,7 +441,10 @@ esp_err_t esp_rmaker_report_param_internal(void)
 
 esp_err_t esp_rmaker_report_node_state(void)
 {
-    esp_err_t err = esp_rmaker_allocate_and_populate_params(0, false);
+    /* With no flags to reset, resetting only starts the deadbands from the values in this
+     * full report, which is what the cloud has for those params from now on.
+     */
+    esp_err_t err = esp_rmaker_allocate_and_populate_params(0, true);
     if (err == ESP_OK) {
         /* Just checking if there are indeed any params to report by comparing with a decent enough
          * length as even the smallest possible data, Eg. '{"d":{"p":0}}' will be > 10 bytes.
@@ -246,119 +460,353 @@ esp_err_t esp_rmaker_report_node_state(void)
     return err;
 }
 
-static esp_err_t esp_rmaker_device_set_params(_esp_rmaker_device_t *device, jparse_ctx_t *jptr, esp_rmaker_req_src_t src)
+static void esp_rmaker_report_work_cb(void *priv_data)
 {
-    _esp_rmaker_param_t *param = device->params;
-    while (param) {
-        esp_rmaker_param_val_t new_val = {0};
-        bool param_found = false;
-        switch(param->val.type) {
-            case RMAKER_VAL_TYPE_BOOLEAN:
-                if (json_obj_get_bool(jptr, param->name, &new_val.val.b) == 0) {
-                    new_val.type = RMAKER_VAL_TYPE_BOOLEAN;
-                    param_found = true;
-                }
-                break;
-            case RMAKER_VAL_TYPE_INTEGER:
-                if (json_obj_get_int(jptr, param->name, &new_val.val.i) == 0) {
-                    new_val.type = RMAKER_VAL_TYPE_INTEGER;
-                    param_found = true;
-                }
-                break;
-            case RMAKER_VAL_TYPE_FLOAT:
-                if (json_obj_get_float(jptr, param->name, &new_val.val.f) == 0) {
-                    new_val.type = RMAKER_VAL_TYPE_FLOAT;
-                    param_found = true;
-                }
-                break;
-            case RMAKER_VAL_TYPE_STRING: {
-                int val_size = 0;
-                if (json_obj_get_strlen(jptr, param->name, &val_size) == 0) {
-                    val_size++; /* For NULL termination */
-                    new_val.val.s = calloc(1, val_size);
-                    if (!new_val.val.s) {
-                        return ESP_ERR_NO_MEM;
-                    }
-                    json_obj_get_string(jptr, param->name, new_val.val.s, val_size);
-                    new_val.type = RMAKER_VAL_TYPE_STRING;
-                    param_found = true;
-                }
-                break;
+    portENTER_CRITICAL(&report_lock);
+    report_state = RMAKER_REPORT_IDLE;
+    pending_report_size = 0;
+    last_report_time = esp_timer_get_time();
+    portEXIT_CRITICAL(&report_lock);
+    esp_rmaker_report_param_internal();
+}
+
+/* Called by whoever moved report_state to RMAKER_REPORT_QUEUED */
+static esp_err_t esp_rmaker_queue_param_report(void)
+{
+    esp_err_t err = esp_rmaker_work_queue_add_task(esp_rmaker_report_work_cb, NULL);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to queue params report.");
+        portENTER_CRITICAL(&report_lock);
+        report_state = RMAKER_REPORT_IDLE;
+        portEXIT_CRITICAL(&report_lock);
+    }
+    return err;
+}
+
+/* Queues the report the timer was armed for, unless something else queued it meanwhile */
+static esp_err_t esp_rmaker_queue_armed_report(void)
+{
+    portENTER_CRITICAL(&report_lock);
+    bool queue = (report_state == RMAKER_REPORT_TIMER_ARMED);
+    if (queue) {
+        report_state = RMAKER_REPORT_QUEUED;
+    }
+    portEXIT_CRITICAL(&report_lock);
+    return queue ? esp_rmaker_queue_param_report() : ESP_OK;
+}
+
+static void esp_rmaker_report_timer_cb(void *priv_data)
+{
+    esp_rmaker_queue_armed_report();
+}
+
+static size_t esp_rmaker_param_report_size(const _esp_rmaker_param_t *param)
+{
+    size_t size = strlen(param->name) + RMAKER_PARAM_REPORT_OVERHEAD;
+    switch (param->val.type) {
+        case RMAKER_VAL_TYPE_BOOLEAN:
+            return size + strlen("false");
+        case RMAKER_VAL_TYPE_INTEGER:
+            return size + strlen("-2147483648");
+        case RMAKER_VAL_TYPE_FLOAT:
+            return size + strlen("-1000.00000");
+        default:
+            return size + (param->val.val.s ? strlen(param->val.val.s) + 2 : strlen("null"));
+    }
+}
+
+/* Called by whoever moved report_state to RMAKER_REPORT_TIMER_ARMED */
+static esp_err_t esp_rmaker_arm_report_timer(int64_t delay)
+{
+    if (!report_timer) {
+        esp_timer_create_args_t report_timer_conf = {
+            .callback = esp_rmaker_report_timer_cb,
+            .dispatch_method = ESP_TIMER_TASK,
+            .name = "esp_rmaker_report"
+        };
+        if (esp_timer_create(&report_timer_conf, &report_timer) != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to create params report timer.");
+            report_timer = NULL;
+        }
+    }
+    if (report_timer && (esp_timer_start_once(report_timer, delay) == ESP_OK)) {
+        return ESP_OK;
+    }
+    /* Report right away instead */
+    return esp_rmaker_queue_armed_report();
+}
+
+static esp_err_t esp_rmaker_schedule_param_report(_esp_rmaker_param_t *param)
+{
+    bool queue = false, arm = false, stop = false;
+    int64_t delay = 0;
+
+    portENTER_CRITICAL(&report_lock);
+    bool already_pending = (param->flags & RMAKER_PARAM_FLAG_VALUE_CHANGE);
+    param->flags |= RMAKER_PARAM_FLAG_VALUE_CHANGE;
+    /* A param already waiting for a report goes out with its latest value */
+    if (already_pending && (report_state != RMAKER_REPORT_IDLE)) {
+        portEXIT_CRITICAL(&report_lock);
+        return ESP_OK;
+    }
+    pending_report_size += esp_rmaker_param_report_size(param);
+    if (report_state != RMAKER_REPORT_QUEUED) {
+        delay = last_report_time + min_report_interval_us - esp_timer_get_time();
+        if ((delay <= 0) || (pending_report_size >= CONFIG_ESP_RMAKER_PARAM_REPORT_FLUSH_SIZE)) {
+            stop = (report_state == RMAKER_REPORT_TIMER_ARMED);
+            report_state = RMAKER_REPORT_QUEUED;
+            queue = true;
+        } else if (report_state == RMAKER_REPORT_IDLE) {
+            report_state = RMAKER_REPORT_TIMER_ARMED;
+            arm = true;
+        }
+    }
+    portEXIT_CRITICAL(&report_lock);
+
+    if (stop && report_timer) {
+        esp_timer_stop(report_timer);
+    }
+    if (queue) {
+        return esp_rmaker_queue_param_report();
+    }
+    if (arm) {
+        return esp_rmaker_arm_report_timer(delay);
+    }
+    return ESP_OK;
+}
+
+static bool esp_rmaker_param_within_deadband(const _esp_rmaker_param_t *param)
+{
+    const esp_rmaker_param_deadband_t *deadband = param->deadband;
+    if (param->val.type == RMAKER_VAL_TYPE_INTEGER) {
+        return llabs((long long)param->val.val.i - deadband->reported.val.i) < deadband->band.val.i;
+    }
+    return fabsf(param->val.val.f - deadband->reported.val.f) < deadband->band.val.f;
+}
+
+/* Reads the value of a param from the current object of the request */
+static esp_err_t esp_rmaker_param_get_json_val(_esp_rmaker_param_t *param, jparse_ctx_t *jptr,
+        esp_rmaker_param_val_t *new_val)
+{
+    bool found = false;
+    switch(param->val.type) {
+        case RMAKER_VAL_TYPE_BOOLEAN:
+            if (json_obj_get_bool(jptr, param->name, &new_val->val.b) == 0) {
+                new_val->type = RMAKER_VAL_TYPE_BOOLEAN;
+                found = true;
+            }
+            break;
+        case RMAKER_VAL_TYPE_INTEGER:
+            if (json_obj_get_int(jptr, param->name, &new_val->val.i) == 0) {
+                new_val->type = RMAKER_VAL_TYPE_INTEGER;
+                found = true;
             }
-            case RMAKER_VAL_TYPE_OBJECT: {
-                int val_size = 0;
-                if (json_obj_get_object_strlen(jptr, param->name, &val_size) == 0) {
-                    val_size++; /* For NULL termination */
-                    new_val.val.s = calloc(1, val_size);
-                    if (!new_val.val.s) {
-                        return ESP_ERR_NO_MEM;
-                    }
-                    json_obj_get_object_str(jptr, param->name, new_val.val.s, val_size);
-                    new_val.type = RMAKER_VAL_TYPE_OBJECT;
-                    param_found = true;
+            break;
+        case RMAKER_VAL_TYPE_FLOAT:
+            if (json_obj_get_float(jptr, param->name, &new_val->val.f) == 0) {
+                new_val->type = RMAKER_VAL_TYPE_FLOAT;
+                found = true;
+            }
+            break;
+        case RMAKER_VAL_TYPE_STRING: {
+            int val_size = 0;
+            if (json_obj_get_strlen(jptr, param->name, &val_size) == 0) {
+                val_size++; /* For NULL termination */
+                new_val->val.s = calloc(1, val_size);
+                if (!new_val->val.s) {
+                    return ESP_ERR_NO_MEM;
                 }
-                break;
+                json_obj_get_string(jptr, param->name, new_val->val.s, val_size);
+                new_val->type = RMAKER_VAL_TYPE_STRING;
+                found = true;
             }
-            case RMAKER_VAL_TYPE_ARRAY: {
-                int val_size = 0;
-                if (json_obj_get_array_strlen(jptr, param->name, &val_size) == 0) {
-                    val_size++; /* For NULL termination */
-                    new_val.val.s = calloc(1, val_size);
-                    if (!new_val.val.s) {
-                        return ESP_ERR_NO_MEM;
-                    }
-                    json_obj_get_array_str(jptr, param->name, new_val.val.s, val_size);
-                    new_val.type = RMAKER_VAL_TYPE_ARRAY;
-                    param_found = true;
+            break;
+        }
+        case RMAKER_VAL_TYPE_OBJECT: {
+            int val_size = 0;
+            if (json_obj_get_object_strlen(jptr, param->name, &val_size) == 0) {
+                val_size++; /* For NULL termination */
+                new_val->val.s = calloc(1, val_size);
+                if (!new_val->val.s) {
+                    return ESP_ERR_NO_MEM;
                 }
-                break;
+                json_obj_get_object_str(jptr, param->name, new_val->val.s, val_size);
+                new_val->type = RMAKER_VAL_TYPE_OBJECT;
+                found = true;
             }
-            default:
-                break;
-        }
-        if (param_found) {
-            /* Special handling for ESP_RMAKER_PARAM_NAME. Just update the name instead
-             * of calling the registered callback.
-             */
-            if (param->type && (strcmp(param->type, ESP_RMAKER_PARAM_NAME) == 0)) {
-                esp_rmaker_param_update_and_report((esp_rmaker_param_t *)param, new_val);
-            } else if (device->write_cb) {
-                esp_rmaker_write_ctx_t ctx = {
-                    .src = src,
-                };
-                if (device->write_cb((esp_rmaker_device_t *)device, (esp_rmaker_param_t *)param,
-                            new_val, device->priv_data, &ctx) != ESP_OK) {
-                    ESP_LOGE(TAG, "Remote update to param %s - %s failed", device->name, param->name);
+            break;
+        }
+        case RMAKER_VAL_TYPE_ARRAY: {
+            int val_size = 0;
+            if (json_obj_get_array_strlen(jptr, param->name, &val_size) == 0) {
+                val_size++; /* For NULL termination */
+                new_val->val.s = calloc(1, val_size);
+                if (!new_val->val.s) {
+                    return ESP_ERR_NO_MEM;
                 }
+                json_obj_get_array_str(jptr, param->name, new_val->val.s, val_size);
+                new_val->type = RMAKER_VAL_TYPE_ARRAY;
+                found = true;
             }
-            if ((new_val.type == RMAKER_VAL_TYPE_STRING) || (new_val.type == RMAKER_VAL_TYPE_OBJECT ||
-                        (new_val.type == RMAKER_VAL_TYPE_ARRAY))) {
-                if (new_val.val.s) {
-                    free(new_val.val.s);
+            break;
+        }
+        default:
+            break;
+    }
+    return found ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+static void esp_rmaker_param_val_free(esp_rmaker_param_val_t *val)
+{
+    if ((val->type == RMAKER_VAL_TYPE_STRING) || (val->type == RMAKER_VAL_TYPE_OBJECT) ||
+                (val->type == RMAKER_VAL_TYPE_ARRAY)) {
+        if (val->val.s) {
+            free(val->val.s);
+        }
+    }
+}
+
+static void esp_rmaker_device_bulk_write(_esp_rmaker_device_t *device, esp_rmaker_param_write_req_t *write_req,
+        size_t count, esp_rmaker_req_src_t src)
+{
+    esp_rmaker_write_ctx_t ctx = {
+        .src = src,
+    };
+    if (device->bulk_write_cb((esp_rmaker_device_t *)device, write_req, count, device->priv_data, &ctx) != ESP_OK) {
+        ESP_LOGE(TAG, "Remote update to %d params of %s failed", count, device->name);
+    }
+    for (size_t i = 0; i < count; i++) {
+        esp_rmaker_param_val_free(&write_req[i].val);
+    }
+}
+
+/* Walks the params of the device in the request once, looking them up in the node index. With a bulk
+ * write callback, the device gets all of them in one call.
+ */
+static esp_err_t esp_rmaker_device_set_params(_esp_rmaker_device_t *device, jparse_ctx_t *jptr, esp_rmaker_req_src_t src)
+{
+    esp_rmaker_param_write_req_t write_req_buf[RMAKER_BULK_WRITE_REQS];
+    esp_rmaker_param_write_req_t *write_req = write_req_buf;
+    size_t max_count = RMAKER_BULK_WRITE_REQS, count = 0;
+    esp_err_t err = ESP_OK;
+    int pos = 0, key_len = 0;
+    char *key = NULL;
+    while (json_obj_get_next_key(jptr, &pos, &key, &key_len) == 0) {
+        _esp_rmaker_param_t *param = esp_rmaker_node_find_param(device->parent, device, key, key_len);
+        if (!param) {
+            ESP_LOGW(TAG, "Param %.*s not found in %s", key_len, key, device->name);
+            continue;
+        }
+        esp_rmaker_param_val_t new_val = {0};
+        err = esp_rmaker_param_get_json_val(param, jptr, &new_val);
+        if (err == ESP_ERR_NOT_FOUND) {
+            ESP_LOGW(TAG, "Value of %s - %s is not of its type", device->name, param->name);
+            err = ESP_OK;
+            continue;
+        } else if (err != ESP_OK) {
+            break;
+        }
+        /* Special handling for ESP_RMAKER_PARAM_NAME. Just update the name instead
+         * of calling the registered callback.
+         */
+        if (param->type && (strcmp(param->type, ESP_RMAKER_PARAM_NAME) == 0)) {
+            esp_rmaker_param_update_and_report((esp_rmaker_param_t *)param, new_val);
+        } else if (device->bulk_write_cb) {
+            if ((count == max_count) && (max_count < UINT8_MAX)) {
+                size_t new_max_count = (2 * max_count < UINT8_MAX) ? 2 * max_count : UINT8_MAX;
+                esp_rmaker_param_write_req_t *new_write_req = calloc(new_max_count, sizeof(esp_rmaker_param_write_req_t));
+                if (!new_write_req) {
+                    esp_rmaker_param_val_free(&new_val);
+                    err = ESP_ERR_NO_MEM;
+                    break;
                 }
+                memcpy(new_write_req, write_req, count * sizeof(esp_rmaker_param_write_req_t));
+                if (write_req != write_req_buf) {
+                    free(write_req);
+                }
+                write_req = new_write_req;
+                max_count = new_max_count;
+            }
+            /* More than a callback can take, hand over the ones so far */
+            if (count == max_count) {
+                esp_rmaker_device_bulk_write(device, write_req, count, src);
+                count = 0;
+            }
+            write_req[count].param = (esp_rmaker_param_t *)param;
+            write_req[count++].val = new_val;
+            continue;
+        } else if (device->write_cb) {
+            esp_rmaker_write_ctx_t ctx = {
+                .src = src,
+            };
+            if (device->write_cb((esp_rmaker_device_t *)device, (esp_rmaker_param_t *)param,
+                        new_val, device->priv_data, &ctx) != ESP_OK) {
+                ESP_LOGE(TAG, "Remote update to param %s - %s failed", device->name, param->name);
             }
         }
-        param = param->next;
+        esp_rmaker_param_val_free(&new_val);
     }
-    return ESP_OK;
+    if (count) {
+        esp_rmaker_device_bulk_write(device, write_req, count, src);
+    }
+    if (write_req != write_req_buf) {
+        free(write_req);
+    }
+    return err;
 }
 
 esp_err_t esp_rmaker_handle_set_params(char *data, size_t data_len, esp_rmaker_req_src_t src)
 {
     ESP_LOGI(TAG, "Received params: %.*s", data_len, data);
     jparse_ctx_t jctx;
-    if (json_parse_start(&jctx, data, data_len) != 0) {
+    if (json_parse_start_indexed(&jctx, data, data_len) != 0) {
         return ESP_FAIL;
     }
-    _esp_rmaker_device_t *device = esp_rmaker_node_get_first_device(esp_rmaker_get_node());
-    while (device) {
+    const esp_rmaker_node_t *node = esp_rmaker_get_node();
+    int pos = 0, key_len = 0;
+    char *key = NULL;
+    esp_rmaker_set_params_call_t call = {
+        .task = xTaskGetCurrentTaskHandle(),
+    };
+    portENTER_CRITICAL(&report_lock);
+    call.next = set_params_calls;
+    set_params_calls = &call;
+    portEXIT_CRITICAL(&report_lock);
+    while (json_obj_get_next_key(&jctx, &pos, &key, &key_len) == 0) {
+        _esp_rmaker_device_t *device = esp_rmaker_node_find_device(node, key, key_len);
+        if (!device) {
+            ESP_LOGW(TAG, "Device %.*s not found", key_len, key);
+            continue;
+        }
         if (json_obj_get_object(&jctx, device->name) == 0) {
             esp_rmaker_device_set_params(device, &jctx, src);
             json_obj_leave_object(&jctx);
         }
-        device = device->next;
     }
     json_parse_end(&jctx);
+    /* Report back the params which the callbacks accepted, in one report */
+    bool stop = false;
+    portENTER_CRITICAL(&report_lock);
+    esp_rmaker_set_params_call_t **prev = &set_params_calls;
+    while (*prev != &call) {
+        prev = &(*prev)->next;
+    }
+    *prev = call.next;
+    if (call.reports) {
+        stop = (report_state == RMAKER_REPORT_TIMER_ARMED);
+        if (stop) {
+            report_state = RMAKER_REPORT_IDLE;
+        }
+        pending_report_size = 0;
+        last_report_time = esp_timer_get_time();
+    }
+    portEXIT_CRITICAL(&report_lock);
+    if (call.reports) {
+        if (stop && report_timer) {
+            esp_timer_stop(report_timer);
+        }
+        esp_rmaker_report_param_internal();
+    }
     return ESP_OK;
 }
 
@@ -471,6 +919,16 @@ esp_err_t esp_rmaker_param_delete(const esp_rmaker_param_t *param)
         if (_param->ui_type) {
             free(_param->ui_type);
         }
+        if (_param->deadband) {
+            free(_param->deadband);
+        }
+        if (((_param->val.type == RMAKER_VAL_TYPE_STRING) || (_param->val.type == RMAKER_VAL_TYPE_OBJECT) ||
+                    (_param->val.type == RMAKER_VAL_TYPE_ARRAY)) && _param->val.val.s) {
+            free(_param->val.val.s);
+        }
+        if (_param->fragment) {
+            free(_param->fragment);
+        }
         free(_param);
         return ESP_OK;
     }
@@ -505,11 +963,8 @@ esp_rmaker_param_t *esp_rmaker_param_create(const char *param_name, const char *
     param->prop_flags = properties;
     if ((val.type == RMAKER_VAL_TYPE_STRING) || (val.type == RMAKER_VAL_TYPE_OBJECT) ||
                 (val.type == RMAKER_VAL_TYPE_ARRAY)) {
-        if (val.val.s) {
-             param->val.val.s = strdup(val.val.s);
-             if (!param->val.val.s) {
-                 ESP_LOGE(TAG, "Failed to allocate memory for the value of param %s.", param_name);
-             }
+        if (esp_rmaker_param_set_str(param, val.val.s) != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to allocate memory for the value of param %s.", param_name);
         }
     } else {
         param->val.val = val.val;
@@ -601,6 +1056,33 @@ esp_err_t esp_rmaker_param_add_array_max_count(const esp_rmaker_param_t *param,
     return ESP_OK;
 }
 
+esp_err_t esp_rmaker_param_add_deadband(const esp_rmaker_param_t *param, esp_rmaker_param_val_t deadband)
+{
+    if (!param) {
+        ESP_LOGE(TAG, "Param handle cannot be NULL.");
+        return ESP_ERR_INVALID_ARG;
+    }
+    _esp_rmaker_param_t *_param = (_esp_rmaker_param_t *)param;
+    if ((_param->val.type != RMAKER_VAL_TYPE_INTEGER) && (_param->val.type != RMAKER_VAL_TYPE_FLOAT)) {
+        ESP_LOGE(TAG, "Only integer and float params can have a deadband.");
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (deadband.type != _param->val.type) {
+        ESP_LOGE(TAG, "Cannot set deadband for %s because of value type mismatch.", _param->name);
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!_param->deadband) {
+        _param->deadband = calloc(1, sizeof(esp_rmaker_param_deadband_t));
+        if (!_param->deadband) {
+            ESP_LOGE(TAG, "Failed to allocate memory for parameter deadband.");
+            return ESP_ERR_NO_MEM;
+        }
+        _param->deadband->reported = _param->val;
+    }
+    _param->deadband->band = deadband;
+    return ESP_OK;
+}
+
 esp_err_t esp_rmaker_param_add_ui_type(const esp_rmaker_param_t *param, const char *ui_type)
 {
     if (!param || !ui_type) {
@@ -629,35 +1111,33 @@ esp_err_t esp_rmaker_param_update(const esp_rmaker_param_t *param, esp_rmaker_pa
         ESP_LOGE(TAG, "New param value type not same as the existing one.");
         return ESP_ERR_INVALID_ARG;
     }
+    esp_err_t err = ESP_OK;
+    xSemaphoreTake(params_lock, portMAX_DELAY);
     switch (_param->val.type) {
         case RMAKER_VAL_TYPE_STRING:
         case RMAKER_VAL_TYPE_OBJECT:
-        case RMAKER_VAL_TYPE_ARRAY: {
-            char *new_val = NULL;
-            if (val.val.s) {
-                new_val = strdup(val.val.s);
-                if (!new_val) {
-                    return ESP_FAIL;
-                }
-            }
-            if (_param->val.val.s) {
-                free(_param->val.val.s);
+        case RMAKER_VAL_TYPE_ARRAY:
+            if (esp_rmaker_param_set_str(_param, val.val.s) != ESP_OK) {
+                err = ESP_FAIL;
             }
-            _param->val.val.s = new_val;
             break;
-        }
         case RMAKER_VAL_TYPE_BOOLEAN:
         case RMAKER_VAL_TYPE_INTEGER:
         case RMAKER_VAL_TYPE_FLOAT:
             _param->val.val = val.val;
             break;
         default:
-            return ESP_ERR_INVALID_ARG;
+            err = ESP_ERR_INVALID_ARG;
+            break;
     }
-    if (_param->prop_flags & PROP_FLAG_PERSIST) {
-        esp_rmaker_param_store_value(_param);
+    if (err == ESP_OK) {
+        _param->fragment_len = 0;
+        if (_param->prop_flags & PROP_FLAG_PERSIST) {
+            esp_rmaker_param_store_value(_param);
+        }
     }
-    return ESP_OK;
+    xSemaphoreGive(params_lock);
+    return err;
 }
 
 esp_err_t esp_rmaker_param_report(const esp_rmaker_param_t *param)
@@ -666,8 +1146,33 @@ esp_err_t esp_rmaker_param_report(const esp_rmaker_param_t *param)
         ESP_LOGE(TAG, "Param handle cannot be NULL.");
         return ESP_ERR_INVALID_ARG;
     }
-    ((_esp_rmaker_param_t *)param)->flags |= RMAKER_PARAM_FLAG_VALUE_CHANGE;
-    return esp_rmaker_report_param_internal();
+    _esp_rmaker_param_t *_param = (_esp_rmaker_param_t *)param;
+    if (_param->deadband && esp_rmaker_param_within_deadband(_param)) {
+        ESP_LOGD(TAG, "Change of %s within its deadband. Not reporting.", _param->name);
+        return ESP_OK;
+    }
+    /* A report from the callbacks of a set params request goes out when they return */
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    portENTER_CRITICAL(&report_lock);
+    esp_rmaker_set_params_call_t *call = set_params_calls;
+    while (call && (call->task != task)) {
+        call = call->next;
+    }
+    if (call) {
+        _param->flags |= RMAKER_PARAM_FLAG_VALUE_CHANGE;
+        call->reports++;
+    }
+    portEXIT_CRITICAL(&report_lock);
+    if (call) {
+        return ESP_OK;
+    }
+    if (min_report_interval_us == 0) {
+        portENTER_CRITICAL(&report_lock);
+        _param->flags |= RMAKER_PARAM_FLAG_VALUE_CHANGE;
+        portEXIT_CRITICAL(&report_lock);
+        return esp_rmaker_report_param_internal();
+    }
+    return esp_rmaker_schedule_param_report(_param);
 }
 
 esp_err_t esp_rmaker_param_update_and_report(const esp_rmaker_param_t *param, esp_rmaker_param_val_t val)
@@ -713,7 +713,7 @@ static esp_err_t esp_rmaker_schedule_parse_json(void *data, size_t data_len, esp
 
     /* Get details from JSON */
     jparse_ctx_t jctx;
-    if (json_parse_start(&jctx, (char *)data, data_len) != 0) {
+    if (json_parse_start_indexed(&jctx, (char *)data, data_len) != 0) {
         ESP_LOGE(TAG, "Json parse start failed");
         return ESP_FAIL;
     }
@@ -0,0 +1,10 @@
+#pragma once
+#include <esp_err.h>
+#include <freertos/FreeRTOS.h>
+
+typedef const char *esp_event_base_t;
+
+#define ESP_EVENT_DECLARE_BASE(id) extern esp_event_base_t id
+
+esp_err_t esp_event_post(esp_event_base_t event_base, int32_t event_id, void *event_data,
+        size_t event_data_size, TickType_t ticks_to_wait);
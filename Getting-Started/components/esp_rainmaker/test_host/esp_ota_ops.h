@@ -0,0 +1,9 @@
+#pragma once
+
+/* Only what the node info is filled from */
+typedef struct {
+    char version[32];
+    char project_name[32];
+} esp_app_desc_t;
+
+const esp_app_desc_t *esp_ota_get_app_description(void);
@@ -0,0 +1,185 @@
+/*
+ * Fakes shared by the host-side tests: logs, esp_timer and the RainMaker work
+ * queue on a simulated clock, the current task, events, an empty NVS and the
+ * parts of RainMaker around the node. MQTT publishes are checked by each test.
+ */
+#include <stdio.h>
+#include <stdarg.h>
+#include <assert.h>
+
+#include <sdkconfig.h>
+#include <esp_timer.h>
+#include <esp_event.h>
+#include <nvs.h>
+#include <esp_ota_ops.h>
+#include <freertos/task.h>
+#include <esp_rmaker_core.h>
+#include <esp_rmaker_mqtt.h>
+#include <esp_rmaker_work_queue.h>
+#include "esp_rmaker_internal.h"
+#include "fakes.h"
+
+#define MAX_TIMERS      2
+#define MAX_WORK        8
+
+esp_event_base_t RMAKER_EVENT = "RMAKER_EVENT";
+
+static int main_task;
+TaskHandle_t current_task = &main_task;
+
+void esp_log_write_stub(const char *level, const char *tag, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    fprintf(stderr, "%s %s: ", level, tag);
+    vfprintf(stderr, format, args);
+    fputc('\n', stderr);
+    va_end(args);
+}
+
+struct esp_timer {
+    esp_timer_cb_t callback;
+    void *arg;
+    int64_t deadline;
+    bool armed;
+};
+
+int64_t now_us;
+static struct esp_timer timers[MAX_TIMERS];
+static int timer_count;
+
+static struct {
+    esp_rmaker_work_fn_t fn;
+    void *priv_data;
+} work[MAX_WORK];
+static int work_count;
+
+int64_t esp_timer_get_time(void)
+{
+    return now_us;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args, esp_timer_handle_t *out_handle)
+{
+    assert(timer_count < MAX_TIMERS);
+    timers[timer_count].callback = create_args->callback;
+    timers[timer_count].arg = create_args->arg;
+    *out_handle = &timers[timer_count++];
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    if (timer->armed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->deadline = now_us + timeout_us;
+    timer->armed = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    if (!timer->armed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->armed = false;
+    return ESP_OK;
+}
+
+esp_err_t esp_rmaker_work_queue_add_task(esp_rmaker_work_fn_t work_fn, void *priv_data)
+{
+    if (work_count == MAX_WORK) {
+        return ESP_FAIL;
+    }
+    work[work_count].fn = work_fn;
+    work[work_count++].priv_data = priv_data;
+    return ESP_OK;
+}
+
+void run_timers_and_work(void)
+{
+    for (int i = 0; i < timer_count; i++) {
+        if (timers[i].armed && timers[i].deadline <= now_us) {
+            timers[i].armed = false;
+            timers[i].callback(timers[i].arg);
+        }
+    }
+    for (int i = 0; i < work_count; i++) {
+        work[i].fn(work[i].priv_data);
+    }
+    work_count = 0;
+}
+
+esp_err_t esp_event_post(esp_event_base_t event_base, int32_t event_id, void *event_data,
+        size_t event_data_size, TickType_t ticks_to_wait)
+{
+    return ESP_OK;
+}
+
+esp_err_t nvs_open_from_partition(const char *part_name, const char *name, nvs_open_mode open_mode, nvs_handle *out_handle)
+{
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t nvs_get_blob(nvs_handle handle, const char *key, void *out_value, size_t *length)
+{
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t nvs_set_blob(nvs_handle handle, const char *key, const void *value, size_t length)
+{
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_str(nvs_handle handle, const char *key, char *out_value, size_t *length)
+{
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t nvs_commit(nvs_handle handle)
+{
+    return ESP_OK;
+}
+
+void nvs_close(nvs_handle handle)
+{
+}
+
+/* Fakes of the rest of RainMaker */
+
+const esp_app_desc_t *esp_ota_get_app_description(void)
+{
+    static const esp_app_desc_t app_desc = { .version = "1.0", .project_name = "test" };
+    return &app_desc;
+}
+
+char *esp_rmaker_get_node_id(void)
+{
+    return "host-test";
+}
+
+/* The node can be created only once, the tests add and remove its devices.
+ * Like esp_rmaker_node_init(), the params are initialised before it. */
+const esp_rmaker_node_t *esp_rmaker_get_node(void)
+{
+    static esp_rmaker_node_t *node;
+    if (!node) {
+        assert(esp_rmaker_param_init() == ESP_OK);
+        node = esp_rmaker_node_create("Node", "Host test");
+        assert(node);
+    }
+    return node;
+}
+
+bool rmaker_started = true;
+
+esp_rmaker_state_t esp_rmaker_get_state(void)
+{
+    return rmaker_started ? ESP_RMAKER_STATE_STARTED : ESP_RMAKER_STATE_INIT_DONE;
+}
+
+esp_err_t esp_rmaker_mqtt_subscribe(const char *topic, esp_rmaker_mqtt_subscribe_cb_t cb, uint8_t qos, void *priv_data)
+{
+    return ESP_OK;
+}
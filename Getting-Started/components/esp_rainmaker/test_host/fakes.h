@@ -0,0 +1,12 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Simulated clock, in microseconds, read by esp_timer_get_time() */
+extern int64_t now_us;
+
+/* Fires the timers due and runs the queued work, as the work queue task would */
+void run_timers_and_work(void);
+
+/* esp_rmaker_get_state() says started while set, param updates are reported only then */
+extern bool rmaker_started;
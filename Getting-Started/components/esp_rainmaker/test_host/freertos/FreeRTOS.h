@@ -0,0 +1,12 @@
+#pragma once
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+
+#define portMAX_DELAY   ((TickType_t)0xffffffffUL)
+
+/* Single threaded on the host, critical sections have nothing to exclude */
+typedef int portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED    0
+#define portENTER_CRITICAL(mux)         ((void)(mux))
+#define portEXIT_CRITICAL(mux)          ((void)(mux))
@@ -0,0 +1,12 @@
+#pragma once
+#include "FreeRTOS.h"
+
+typedef void *TaskHandle_t;
+
+/* The task the host test is running as, set by tests that act as another task */
+extern TaskHandle_t current_task;
+
+static inline TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    return current_task;
+}
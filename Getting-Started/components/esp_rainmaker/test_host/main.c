@@ -0,0 +1,289 @@
+/*
+ * Host-side test for the coalesced param reports of ../src/core/esp_rmaker_param.c.
+ *
+ * The node is built from real devices and params, the esp_timer, the work
+ * queue and MQTT are faked on a simulated clock. Each scenario is a 100 Hz
+ * update storm: every 10 ms tick the app updates its params, then the timers
+ * due are fired and the work queue runs, as it would once the app task blocks.
+ *
+ * The fake publish counts the reports and their bytes, parses them and
+ * measures the flush latency, the time from the first change not yet reported
+ * to the report that carries it. Built with
+ * CONFIG_ESP_RMAKER_PARAM_REPORT_MIN_INTERVAL=0 (test_param_report_legacy)
+ * every change is published as it is made, without deadbands.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <assert.h>
+
+#include <sdkconfig.h>
+#include <esp_timer.h>
+#include <nvs.h>
+#include <json_parser.h>
+#include <esp_rmaker_core.h>
+#include <esp_rmaker_mqtt.h>
+#include <esp_rmaker_work_queue.h>
+#include "esp_rmaker_internal.h"
+#include "fakes.h"
+
+#define TICK_US         10000
+#define STORM_US        (60 * 1000000LL)
+#define MIN_INTERVAL_US (CONFIG_ESP_RMAKER_PARAM_REPORT_MIN_INTERVAL * 1000LL)
+#define HUB_SENSORS     32
+#define MAX_PARAMS      (HUB_SENSORS + 1)
+
+/* Node of a scenario and what the publishes carried */
+
+typedef struct {
+    const char *name;
+    esp_rmaker_device_t *device;
+    esp_rmaker_param_t *params[MAX_PARAMS];
+    esp_rmaker_param_val_t reported[MAX_PARAMS];
+    int param_count;
+} device_t;
+
+typedef struct {
+    uint32_t publishes;
+    uint32_t bytes;
+    uint32_t largest;
+    uint32_t updates;
+    int64_t latency_sum;
+    int64_t latency_max;
+    int64_t oldest_unreported;
+    int64_t last_publish;
+    int64_t min_gap;
+} stats_t;
+
+static device_t devices[2];
+static int device_count;
+static stats_t stats;
+
+static esp_rmaker_param_t *add_param(device_t *dev, const char *name, esp_rmaker_param_val_t val)
+{
+    esp_rmaker_param_t *param = esp_rmaker_param_create(name, NULL, val, PROP_FLAG_READ);
+    assert(param);
+    assert(esp_rmaker_device_add_param(dev->device, param) == ESP_OK);
+    dev->reported[dev->param_count] = val;
+    dev->params[dev->param_count++] = param;
+    return param;
+}
+
+static device_t *add_device(const char *name)
+{
+    esp_rmaker_device_t *device = esp_rmaker_device_create(name, NULL, NULL);
+    assert(device);
+    assert(esp_rmaker_node_add_device(esp_rmaker_get_node(), device) == ESP_OK);
+    devices[device_count].name = name;
+    devices[device_count].device = device;
+    devices[device_count].param_count = 0;
+    return &devices[device_count++];
+}
+
+static void free_node(void)
+{
+    for (int d = 0; d < device_count; d++) {
+        assert(esp_rmaker_node_remove_device(esp_rmaker_get_node(), devices[d].device) == ESP_OK);
+        assert(esp_rmaker_device_delete(devices[d].device) == ESP_OK);
+        /* esp_rmaker_device_delete() frees what the device holds, not the device */
+        free(devices[d].device);
+    }
+    device_count = 0;
+}
+
+esp_err_t esp_rmaker_mqtt_publish(const char *topic, void *data, size_t data_len, uint8_t qos, int *msg_id)
+{
+    assert(strcmp(topic, "node/host-test/params/local") == 0);
+    assert(strlen(data) == data_len);
+    stats.publishes++;
+    stats.bytes += data_len;
+    if (data_len > stats.largest) {
+        stats.largest = data_len;
+    }
+    if (stats.last_publish >= 0 && now_us - stats.last_publish < stats.min_gap) {
+        stats.min_gap = now_us - stats.last_publish;
+    }
+    stats.last_publish = now_us;
+    if (stats.oldest_unreported >= 0) {
+        int64_t latency = now_us - stats.oldest_unreported;
+        stats.latency_sum += latency;
+        if (latency > stats.latency_max) {
+            stats.latency_max = latency;
+        }
+        stats.oldest_unreported = -1;
+    }
+
+    jparse_ctx_t jctx;
+    assert(json_parse_start(&jctx, data, data_len) == 0);
+    for (int d = 0; d < device_count; d++) {
+        device_t *dev = &devices[d];
+        if (json_obj_get_object(&jctx, (char *)dev->name) != 0) {
+            continue;
+        }
+        for (int p = 0; p < dev->param_count; p++) {
+            _esp_rmaker_param_t *param = (_esp_rmaker_param_t *)dev->params[p];
+            esp_rmaker_param_val_t *val = &dev->reported[p];
+            switch (param->val.type) {
+                case RMAKER_VAL_TYPE_BOOLEAN:
+                    json_obj_get_bool(&jctx, param->name, &val->val.b);
+                    break;
+                case RMAKER_VAL_TYPE_INTEGER:
+                    json_obj_get_int(&jctx, param->name, &val->val.i);
+                    break;
+                case RMAKER_VAL_TYPE_FLOAT:
+                    json_obj_get_float(&jctx, param->name, &val->val.f);
+                    break;
+                default:
+                    break;
+            }
+        }
+        json_obj_leave_object(&jctx);
+    }
+    json_parse_end(&jctx);
+    return ESP_OK;
+}
+
+static void update(esp_rmaker_param_t *param, esp_rmaker_param_val_t val)
+{
+    assert(esp_rmaker_param_update_and_report(param, val) == ESP_OK);
+    stats.updates++;
+    /* Without coalescing the flag is already cleared by the publish */
+    if ((((_esp_rmaker_param_t *)param)->flags & RMAKER_PARAM_FLAG_VALUE_CHANGE) && stats.oldest_unreported < 0) {
+        stats.oldest_unreported = now_us;
+    }
+}
+
+static float noise(float amplitude)
+{
+    return amplitude * (2.0f * rand() / (float)RAND_MAX - 1.0f);
+}
+
+/* Temperature, humidity and battery read together at 100 Hz, a light toggled every 7 s */
+static void thermostat_setup(void)
+{
+    device_t *thermostat = add_device("Thermostat");
+    device_t *light = add_device("Light");
+    esp_rmaker_param_t *temperature = add_param(thermostat, "temperature", esp_rmaker_float(22.0f));
+    esp_rmaker_param_t *humidity = add_param(thermostat, "humidity", esp_rmaker_float(45.0f));
+    esp_rmaker_param_t *battery = add_param(thermostat, "battery", esp_rmaker_int(100));
+    add_param(light, "power", esp_rmaker_bool(false));
+    if (MIN_INTERVAL_US) {
+        assert(esp_rmaker_param_add_deadband(temperature, esp_rmaker_float(0.1f)) == ESP_OK);
+        assert(esp_rmaker_param_add_deadband(humidity, esp_rmaker_float(0.5f)) == ESP_OK);
+        assert(esp_rmaker_param_add_deadband(battery, esp_rmaker_int(1)) == ESP_OK);
+        assert(esp_rmaker_param_add_deadband(battery, esp_rmaker_float(1.0f)) == ESP_ERR_INVALID_ARG);
+        assert(esp_rmaker_param_add_deadband(light->params[0], esp_rmaker_bool(true)) == ESP_ERR_INVALID_ARG);
+    }
+}
+
+static void thermostat_tick(int64_t t)
+{
+    float s = t / 1e6f;
+    update(devices[0].params[0], esp_rmaker_float(22.0f + 0.5f * sinf(s * 2 * M_PI / 30) + noise(0.05f)));
+    update(devices[0].params[1], esp_rmaker_float(45.0f + 2.0f * sinf(s * 2 * M_PI / 20) + noise(0.2f)));
+    update(devices[0].params[2], esp_rmaker_int(100 - (int)(s / 2)));
+    if (t % 7000000 == 0) {
+        update(devices[1].params[0], esp_rmaker_bool((t / 7000000) % 2));
+    }
+}
+
+/* Sensor hub polling one of its 32 sensors every tick, which fills a report before the interval ends */
+static void hub_setup(void)
+{
+    device_t *hub = add_device("Hub");
+    char name[16];
+    for (int i = 0; i < HUB_SENSORS; i++) {
+        snprintf(name, sizeof(name), "sensor%d", i);
+        add_param(hub, name, esp_rmaker_float(0.0f));
+    }
+}
+
+static void hub_tick(int64_t t)
+{
+    int i = (t / TICK_US) % HUB_SENSORS;
+    update(devices[0].params[i], esp_rmaker_float(i + noise(10.0f)));
+}
+
+static void check_reported(void)
+{
+    for (int d = 0; d < device_count; d++) {
+        for (int p = 0; p < devices[d].param_count; p++) {
+            _esp_rmaker_param_t *param = (_esp_rmaker_param_t *)devices[d].params[p];
+            esp_rmaker_param_val_t *reported = &devices[d].reported[p];
+            switch (param->val.type) {
+                case RMAKER_VAL_TYPE_BOOLEAN:
+                    assert(reported->val.b == param->val.val.b);
+                    break;
+                case RMAKER_VAL_TYPE_INTEGER:
+                    assert(abs(reported->val.i - param->val.val.i) < (param->deadband ? param->deadband->band.val.i : 1));
+                    break;
+                case RMAKER_VAL_TYPE_FLOAT:
+                    assert(fabsf(reported->val.f - param->val.val.f) <=
+                            (param->deadband ? param->deadband->band.val.f : 0.0f) + 1e-5f);
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+}
+
+static void run_storm(const char *name, void (*setup)(void), void (*tick)(int64_t))
+{
+    memset(&stats, 0, sizeof(stats));
+    stats.oldest_unreported = -1;
+    stats.last_publish = -1;
+    stats.min_gap = INT64_MAX;
+    srand(1);
+    setup();
+
+    clock_t start = clock();
+    int64_t end = now_us + STORM_US;
+    for (int64_t t = 0; now_us < end; t += TICK_US, now_us += TICK_US) {
+        tick(t);
+        run_timers_and_work();
+    }
+    /* Let the last collected changes go out */
+    for (int64_t quiet = 0; quiet <= MIN_INTERVAL_US; quiet += TICK_US, now_us += TICK_US) {
+        run_timers_and_work();
+    }
+    double cpu_ms = 1000.0 * (clock() - start) / CLOCKS_PER_SEC;
+
+    assert(stats.oldest_unreported < 0);
+    check_reported();
+    printf("%-12s %8u %10u %10u %10u %11.1f %11.1f %9.1f\n", name, stats.updates, stats.publishes,
+            stats.bytes, stats.largest, stats.publishes ? stats.latency_sum / 1000.0 / stats.publishes : 0.0,
+            stats.latency_max / 1000.0, cpu_ms);
+
+    assert(stats.largest < CONFIG_ESP_RMAKER_MAX_PARAM_DATA_SIZE);
+    if (MIN_INTERVAL_US) {
+        assert(stats.latency_max <= MIN_INTERVAL_US);
+    }
+    free_node();
+}
+
+int main(void)
+{
+    printf("Min interval %d ms, flush size %d bytes, %d s storm at 100 Hz\n",
+            CONFIG_ESP_RMAKER_PARAM_REPORT_MIN_INTERVAL, CONFIG_ESP_RMAKER_PARAM_REPORT_FLUSH_SIZE,
+            (int)(STORM_US / 1000000));
+    printf("%-12s %8s %10s %10s %10s %11s %11s %9s\n", "scenario", "updates", "publishes", "bytes",
+            "largest", "avg lat ms", "max lat ms", "cpu ms");
+
+    run_storm("thermostat", thermostat_setup, thermostat_tick);
+    if (MIN_INTERVAL_US) {
+        /* No more than one report per interval, plus the first one after the quiet start */
+        assert(stats.publishes * MIN_INTERVAL_US <= STORM_US + 2 * MIN_INTERVAL_US);
+        assert(stats.min_gap >= MIN_INTERVAL_US);
+    }
+
+    run_storm("sensor hub", hub_setup, hub_tick);
+    if (MIN_INTERVAL_US) {
+        /* The size threshold sends reports before the interval is over */
+        assert(stats.publishes * MIN_INTERVAL_US > STORM_US + 2 * MIN_INTERVAL_US);
+        assert(stats.min_gap < MIN_INTERVAL_US);
+    }
+    return 0;
+}
@@ -0,0 +1,250 @@
+/*
+ * Host-side benchmark of the node params serialization of ../src/core/esp_rmaker_param.c.
+ *
+ * A node of 8 devices, each with bool, int, float, string, object and array
+ * params, changes a few params, one of them a string, and then reports all of
+ * its params. That is done two ways:
+ * - legacy: the serialization before the report fragments, the JSON generator
+ *   run twice over every param into a new buffer and strings duplicated on
+ *   every update,
+ * - fragments: esp_rmaker_param_update() and esp_rmaker_report_node_state().
+ * Both have to give the same JSON. The bytes allocated and the time are given
+ * per report, updates included, and for esp_rmaker_get_node_params().
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <assert.h>
+
+#include <sdkconfig.h>
+#include <json_generator.h>
+#include <esp_rmaker_core.h>
+#include <esp_rmaker_mqtt.h>
+#include "esp_rmaker_internal.h"
+#include "fakes.h"
+
+#define NUM_DEVICES     8
+#define NUM_PARAMS      6
+#define ITERATIONS      50000
+
+/* Allocations, counted through the --wrap options of the Makefile */
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t nmemb, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+static unsigned long allocs;
+static unsigned long alloc_bytes;
+
+void *__wrap_malloc(size_t size)
+{
+    allocs++;
+    alloc_bytes += size;
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t nmemb, size_t size)
+{
+    allocs++;
+    alloc_bytes += nmemb * size;
+    return __real_calloc(nmemb, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+    allocs++;
+    alloc_bytes += size;
+    return __real_realloc(ptr, size);
+}
+
+char *__wrap_strdup(const char *s)
+{
+    size_t len = strlen(s) + 1;
+    char *copy = __wrap_malloc(len);
+    if (copy) {
+        memcpy(copy, s, len);
+    }
+    return copy;
+}
+
+static esp_rmaker_device_t *devices[NUM_DEVICES];
+static esp_rmaker_param_t *params[NUM_DEVICES][NUM_PARAMS];
+static char published[4096];
+
+esp_err_t esp_rmaker_mqtt_publish(const char *topic, void *data, size_t data_len, uint8_t qos, int *msg_id)
+{
+    assert(data_len < sizeof(published));
+    memcpy(published, data, data_len + 1);
+    return ESP_OK;
+}
+
+static void add_devices(void)
+{
+    static const char *modes[] = { "Auto", "Cool", "Heat", "Fan only" };
+    char name[16];
+    for (int d = 0; d < NUM_DEVICES; d++) {
+        snprintf(name, sizeof(name), "Device%d", d);
+        devices[d] = esp_rmaker_device_create(name, NULL, NULL);
+        assert(devices[d]);
+        esp_rmaker_param_val_t vals[NUM_PARAMS] = {
+            esp_rmaker_bool(false),
+            esp_rmaker_int(d),
+            esp_rmaker_float(21.5f),
+            esp_rmaker_str(modes[d % 4]),
+            esp_rmaker_obj("{\"r\":255,\"g\":128,\"b\":0}"),
+            esp_rmaker_array("[1,2,3,4]"),
+        };
+        static const char *names[NUM_PARAMS] = { "Power", "Speed", "Temperature", "Mode", "Color", "Schedule" };
+        for (int p = 0; p < NUM_PARAMS; p++) {
+            params[d][p] = esp_rmaker_param_create(names[p], NULL, vals[p], PROP_FLAG_READ | PROP_FLAG_WRITE);
+            assert(params[d][p]);
+            assert(esp_rmaker_device_add_param(devices[d], params[d][p]) == ESP_OK);
+        }
+        assert(esp_rmaker_node_add_device(esp_rmaker_get_node(), devices[d]) == ESP_OK);
+    }
+}
+
+/* The serialization before the report fragments */
+
+static esp_err_t legacy_update(esp_rmaker_param_t *param, esp_rmaker_param_val_t val)
+{
+    _esp_rmaker_param_t *_param = (_esp_rmaker_param_t *)param;
+    if (val.type == RMAKER_VAL_TYPE_STRING) {
+        char *new_val = strdup(val.val.s);
+        free(_param->val.val.s);
+        _param->val.val.s = new_val;
+        /* The storage is no longer known to esp_rmaker_param_update() */
+        _param->val_size = 0;
+    } else {
+        _param->val.val = val.val;
+    }
+    _param->fragment_len = 0;
+    return ESP_OK;
+}
+
+static int legacy_populate(char *buf, size_t buf_len)
+{
+    json_gen_str_t jstr;
+    json_gen_str_start(&jstr, buf, buf_len, NULL, NULL);
+    json_gen_start_object(&jstr);
+    for (_esp_rmaker_device_t *device = esp_rmaker_node_get_first_device(esp_rmaker_get_node()); device;
+            device = device->next) {
+        json_gen_push_object(&jstr, device->name);
+        for (_esp_rmaker_param_t *param = device->params; param; param = param->next) {
+            esp_rmaker_report_value(&param->val, param->name, &jstr);
+        }
+        json_gen_pop_object(&jstr);
+    }
+    json_gen_end_object(&jstr);
+    return json_gen_str_end(&jstr);
+}
+
+static char *legacy_get_node_params(void)
+{
+    size_t req_size = legacy_populate(NULL, 0) + 50;
+    char *node_params = calloc(1, req_size);
+    legacy_populate(node_params, req_size);
+    return node_params;
+}
+
+static void legacy_report(void)
+{
+    char *node_params = legacy_get_node_params();
+    esp_rmaker_mqtt_publish("node/host-test/params/local/init", node_params, strlen(node_params), 1, NULL);
+    free(node_params);
+}
+
+static void new_report(void)
+{
+    assert(esp_rmaker_report_node_state() == ESP_OK);
+}
+
+/* Power toggles, the speed steps, the temperature drifts and the mode of one device changes */
+static void change_params(int i, esp_err_t (*update)(esp_rmaker_param_t *, esp_rmaker_param_val_t))
+{
+    static const char *modes[] = { "Auto", "Cool", "Heat", "Fan only" };
+    int d = i % NUM_DEVICES;
+    assert(update(params[d][0], esp_rmaker_bool(i & 1)) == ESP_OK);
+    assert(update(params[d][1], esp_rmaker_int(i % 5)) == ESP_OK);
+    assert(update(params[d][2], esp_rmaker_float(21.5f + (i % 20) / 10.0f)) == ESP_OK);
+    assert(update(params[d][3], esp_rmaker_str(modes[i % 4])) == ESP_OK);
+}
+
+static esp_err_t new_update(esp_rmaker_param_t *param, esp_rmaker_param_val_t val)
+{
+    return esp_rmaker_param_update(param, val);
+}
+
+static double elapsed_ns(struct timespec *start)
+{
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) * 1e9 + (end.tv_nsec - start->tv_nsec);
+}
+
+static void bench(const char *name, void (*report)(void),
+        esp_err_t (*update)(esp_rmaker_param_t *, esp_rmaker_param_val_t), char *(*get_node_params)(void))
+{
+    struct timespec start;
+    /* Warm up, the first report sizes the buffers */
+    for (int i = 0; i < 2 * NUM_DEVICES; i++) {
+        change_params(i, update);
+        report();
+    }
+    allocs = alloc_bytes = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < ITERATIONS; i++) {
+        change_params(i, update);
+        report();
+    }
+    double report_ns = elapsed_ns(&start) / ITERATIONS;
+    double report_allocs = (double)allocs / ITERATIONS, report_bytes = (double)alloc_bytes / ITERATIONS;
+
+    allocs = alloc_bytes = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < ITERATIONS; i++) {
+        free(get_node_params());
+    }
+    double get_ns = elapsed_ns(&start) / ITERATIONS;
+    printf("%-10s %6zu %12.1f %12.1f %10.0f %12.1f %12.1f %10.0f\n", name, strlen(published), report_allocs,
+            report_bytes, report_ns, (double)allocs / ITERATIONS, (double)alloc_bytes / ITERATIONS, get_ns);
+}
+
+int main(void)
+{
+    add_devices();
+    printf("%d devices of %d params, %d reports each, after 4 updates\n", NUM_DEVICES, NUM_PARAMS, ITERATIONS);
+    printf("%-10s %6s %12s %12s %10s %12s %12s %10s\n", "serialize", "bytes", "allocs/rep", "bytes/rep",
+            "ns/rep", "allocs/get", "bytes/get", "ns/get");
+
+    bench("legacy", legacy_report, legacy_update, legacy_get_node_params);
+    char *legacy = legacy_get_node_params();
+    bench("fragments", new_report, new_update, esp_rmaker_get_node_params);
+    char *fragments = esp_rmaker_get_node_params();
+    /* Both ended with the same changes */
+    assert(strcmp(legacy, fragments) == 0);
+    assert(strcmp(published, fragments) == 0);
+
+    /* Steady state reports do not touch the heap, unless a string outgrows its storage */
+    allocs = 0;
+    change_params(1, new_update);
+    new_report();
+    assert(allocs == 0);
+    assert(esp_rmaker_param_update(params[0][3], esp_rmaker_str("A mode with a much longer name than before"))
+            == ESP_OK);
+    new_report();
+    /* The value, its fragment and the report buffer, which outgrew its margin */
+    assert(allocs == 3);
+    assert(strstr(published, "\"Mode\":\"A mode with a much longer name than before\""));
+
+    /* Only the changed params, with the flags */
+    assert(esp_rmaker_param_update(params[2][1], esp_rmaker_int(7)) == ESP_OK);
+    ((_esp_rmaker_param_t *)params[2][1])->flags |= RMAKER_PARAM_FLAG_VALUE_CHANGE;
+    ((_esp_rmaker_param_t *)params[5][4])->flags |= RMAKER_PARAM_FLAG_VALUE_CHANGE;
+    assert(esp_rmaker_report_param_internal() == ESP_OK);
+    assert(strcmp(published, "{\"Device2\":{\"Speed\":7},\"Device5\":{\"Color\":{\"r\":255,\"g\":128,\"b\":0}}}") == 0);
+    free(legacy);
+    free(fragments);
+    return 0;
+}
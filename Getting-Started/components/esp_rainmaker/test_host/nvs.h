@@ -0,0 +1,16 @@
+#pragma once
+#include <esp_err.h>
+
+typedef uint32_t nvs_handle;
+
+typedef enum {
+    NVS_READONLY,
+    NVS_READWRITE,
+} nvs_open_mode;
+
+esp_err_t nvs_open_from_partition(const char *part_name, const char *name, nvs_open_mode open_mode, nvs_handle *out_handle);
+esp_err_t nvs_get_blob(nvs_handle handle, const char *key, void *out_value, size_t *length);
+esp_err_t nvs_set_blob(nvs_handle handle, const char *key, const void *value, size_t length);
+esp_err_t nvs_get_str(nvs_handle handle, const char *key, char *out_value, size_t *length);
+esp_err_t nvs_commit(nvs_handle handle);
+void nvs_close(nvs_handle handle);
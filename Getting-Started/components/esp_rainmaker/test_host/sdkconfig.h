@@ -0,0 +1,6 @@
+/* Options used by the sources built in the host test */
+#define CONFIG_ESP_RMAKER_MAX_PARAM_DATA_SIZE 1024
+#ifndef CONFIG_ESP_RMAKER_PARAM_REPORT_MIN_INTERVAL
+#define CONFIG_ESP_RMAKER_PARAM_REPORT_MIN_INTERVAL 1000
+#endif
+#define CONFIG_ESP_RMAKER_PARAM_REPORT_FLUSH_SIZE 512
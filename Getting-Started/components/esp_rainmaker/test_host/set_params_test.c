@@ -0,0 +1,368 @@
+/*
+ * Host-side test for the set params dispatch of ../src/core/esp_rmaker_param.c.
+ *
+ * A node of 1, 8 and 32 lights, each with a name and four params, gets set
+ * params messages for all its lights and messages toggling the power of its
+ * last light. Each message is dispatched three ways:
+ * - legacy: the dispatch before the node index, a lookup of every param of
+ *   every device in the message, one write callback per param,
+ * - write cb: esp_rmaker_handle_set_params() with a write callback per param,
+ * - bulk cb: esp_rmaker_handle_set_params() with a bulk write callback.
+ * The callbacks update and report the values like an app would. Callbacks,
+ * allocations and publishes are counted per message, up to the report that
+ * carries the new values, and the values reported are checked. Messages are
+ * timed without reports, for the dispatch and callbacks alone, and with them.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <assert.h>
+
+#include <sdkconfig.h>
+#include <json_parser.h>
+#include <esp_rmaker_core.h>
+#include <esp_rmaker_mqtt.h>
+#include <esp_rmaker_standard_types.h>
+#include <freertos/task.h>
+#include "esp_rmaker_internal.h"
+#include "fakes.h"
+
+#define MAX_DEVICES     32
+#define NUM_PARAMS      4
+#define MAX_MSG         4096
+#define ITERATIONS      20000
+
+static const char *param_names[NUM_PARAMS] = { "Power", "Brightness", "Hue", "Saturation" };
+
+/* Allocations, counted through the --wrap options of the Makefile */
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t nmemb, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+static unsigned long allocs;
+
+void *__wrap_malloc(size_t size)
+{
+    allocs++;
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t nmemb, size_t size)
+{
+    allocs++;
+    return __real_calloc(nmemb, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+    allocs++;
+    return __real_realloc(ptr, size);
+}
+
+char *__wrap_strdup(const char *s)
+{
+    size_t len = strlen(s) + 1;
+    char *copy = __wrap_malloc(len);
+    if (copy) {
+        memcpy(copy, s, len);
+    }
+    return copy;
+}
+
+/* Node of a scenario and what the publishes carried */
+
+static esp_rmaker_device_t *devices[MAX_DEVICES];
+static esp_rmaker_param_t *params[MAX_DEVICES][NUM_PARAMS];
+static int device_count;
+static int sent[MAX_DEVICES][NUM_PARAMS];
+static int reported[MAX_DEVICES][NUM_PARAMS];
+static unsigned long callbacks;
+static unsigned long publishes;
+static bool check_publishes = true;
+
+esp_err_t esp_rmaker_mqtt_publish(const char *topic, void *data, size_t data_len, uint8_t qos, int *msg_id)
+{
+    publishes++;
+    if (!check_publishes) {
+        return ESP_OK;
+    }
+    jparse_ctx_t jctx;
+    assert(json_parse_start(&jctx, data, data_len) == 0);
+    for (int d = 0; d < device_count; d++) {
+        if (json_obj_get_object(&jctx, esp_rmaker_device_get_name(devices[d])) != 0) {
+            continue;
+        }
+        bool power;
+        if (json_obj_get_bool(&jctx, "Power", &power) == 0) {
+            reported[d][0] = power;
+        }
+        for (int p = 1; p < NUM_PARAMS; p++) {
+            json_obj_get_int(&jctx, (char *)param_names[p], &reported[d][p]);
+        }
+        json_obj_leave_object(&jctx);
+    }
+    json_parse_end(&jctx);
+    return ESP_OK;
+}
+
+static esp_err_t write_cb(const esp_rmaker_device_t *device, const esp_rmaker_param_t *param,
+        const esp_rmaker_param_val_t val, void *priv_data, esp_rmaker_write_ctx_t *ctx)
+{
+    callbacks++;
+    return esp_rmaker_param_update_and_report(param, val);
+}
+
+static esp_err_t bulk_write_cb(const esp_rmaker_device_t *device, const esp_rmaker_param_write_req_t write_req[],
+        uint8_t count, void *priv_data, esp_rmaker_write_ctx_t *ctx)
+{
+    callbacks++;
+    for (int i = 0; i < count; i++) {
+        esp_rmaker_param_update_and_report(write_req[i].param, write_req[i].val);
+    }
+    return ESP_OK;
+}
+
+/* Reports a param of the last device as another task would, while the callback runs */
+static esp_err_t other_task_write_cb(const esp_rmaker_device_t *device, const esp_rmaker_param_t *param,
+        const esp_rmaker_param_val_t val, void *priv_data, esp_rmaker_write_ctx_t *ctx)
+{
+    static int other_task;
+    TaskHandle_t task = current_task;
+    callbacks++;
+    current_task = &other_task;
+    esp_rmaker_param_update_and_report(params[device_count - 1][1], esp_rmaker_int(42));
+    current_task = task;
+    return ESP_OK;
+}
+
+static void add_devices(int count)
+{
+    char name[16];
+    for (int d = 0; d < count; d++) {
+        snprintf(name, sizeof(name), "Light%d", d);
+        devices[d] = esp_rmaker_device_create(name, ESP_RMAKER_DEVICE_LIGHTBULB, NULL);
+        assert(devices[d]);
+        esp_rmaker_param_t *name_param = esp_rmaker_param_create("Name", ESP_RMAKER_PARAM_NAME,
+                esp_rmaker_str(name), PROP_FLAG_READ | PROP_FLAG_WRITE);
+        assert(esp_rmaker_device_add_param(devices[d], name_param) == ESP_OK);
+        for (int p = 0; p < NUM_PARAMS; p++) {
+            params[d][p] = esp_rmaker_param_create(param_names[p], NULL,
+                    p ? esp_rmaker_int(0) : esp_rmaker_bool(false), PROP_FLAG_READ | PROP_FLAG_WRITE);
+            assert(esp_rmaker_device_add_param(devices[d], params[d][p]) == ESP_OK);
+        }
+        assert(esp_rmaker_node_add_device(esp_rmaker_get_node(), devices[d]) == ESP_OK);
+    }
+    device_count = count;
+    memset(reported, 0, sizeof(reported));
+}
+
+static void remove_devices(void)
+{
+    for (int d = 0; d < device_count; d++) {
+        assert(esp_rmaker_node_remove_device(esp_rmaker_get_node(), devices[d]) == ESP_OK);
+        assert(esp_rmaker_device_delete(devices[d]) == ESP_OK);
+        /* esp_rmaker_device_delete() frees what the device holds, not the device */
+        free(devices[d]);
+    }
+    device_count = 0;
+}
+
+/* {"Light0":{"Power":true,"Brightness":1,"Hue":2,"Saturation":3},"Light1":{...},...}
+ * or {"Light31":{"Power":true}} for a toggle
+ */
+static int make_message(char *msg, int seq, bool toggle)
+{
+    int len = snprintf(msg, MAX_MSG, "{");
+    if (toggle) {
+        int d = device_count - 1;
+        sent[d][0] = seq % 2;
+        len += snprintf(msg + len, MAX_MSG - len, "\"Light%d\":{\"Power\":%s}}", d, sent[d][0] ? "true" : "false");
+        return len;
+    }
+    for (int d = 0; d < device_count; d++) {
+        for (int p = 0; p < NUM_PARAMS; p++) {
+            sent[d][p] = p ? (seq + d + p) % 100 : (seq + d) % 2;
+        }
+        len += snprintf(msg + len, MAX_MSG - len, "%s\"Light%d\":{\"Power\":%s,\"Brightness\":%d,\"Hue\":%d,"
+                "\"Saturation\":%d}", d ? "," : "", d, sent[d][0] ? "true" : "false", sent[d][1], sent[d][2],
+                sent[d][3]);
+    }
+    len += snprintf(msg + len, MAX_MSG - len, "}");
+    assert(len < MAX_MSG);
+    return len;
+}
+
+/* The dispatch before the node index: every param of every device is looked up in the message */
+static esp_err_t legacy_handle_set_params(char *data, size_t data_len)
+{
+    jparse_ctx_t jctx;
+    if (json_parse_start(&jctx, data, data_len) != 0) {
+        return ESP_FAIL;
+    }
+    _esp_rmaker_device_t *device = esp_rmaker_node_get_first_device(esp_rmaker_get_node());
+    while (device) {
+        if (json_obj_get_object(&jctx, device->name) == 0) {
+            for (_esp_rmaker_param_t *param = device->params; param; param = param->next) {
+                esp_rmaker_param_val_t new_val = { .type = param->val.type };
+                int val_size = 0;
+                bool found = false;
+                switch (param->val.type) {
+                    case RMAKER_VAL_TYPE_BOOLEAN:
+                        found = json_obj_get_bool(&jctx, param->name, &new_val.val.b) == 0;
+                        break;
+                    case RMAKER_VAL_TYPE_INTEGER:
+                        found = json_obj_get_int(&jctx, param->name, &new_val.val.i) == 0;
+                        break;
+                    case RMAKER_VAL_TYPE_STRING:
+                        if (json_obj_get_strlen(&jctx, param->name, &val_size) == 0) {
+                            new_val.val.s = calloc(1, val_size + 1);
+                            json_obj_get_string(&jctx, param->name, new_val.val.s, val_size + 1);
+                            found = true;
+                        }
+                        break;
+                    default:
+                        break;
+                }
+                if (found && device->write_cb) {
+                    esp_rmaker_write_ctx_t ctx = {
+                        .src = ESP_RMAKER_REQ_SRC_CLOUD,
+                    };
+                    device->write_cb((esp_rmaker_device_t *)device, (esp_rmaker_param_t *)param, new_val,
+                            device->priv_data, &ctx);
+                }
+                if (new_val.type == RMAKER_VAL_TYPE_STRING) {
+                    free(new_val.val.s);
+                }
+            }
+            json_obj_leave_object(&jctx);
+        }
+        device = device->next;
+    }
+    json_parse_end(&jctx);
+    return ESP_OK;
+}
+
+enum {
+    MODE_LEGACY,
+    MODE_WRITE_CB,
+    MODE_BULK_CB,
+    MODE_MAX,
+};
+
+static const char *mode_names[MODE_MAX] = { "legacy", "write cb", "bulk cb" };
+
+/* Dispatches a message and lets the report it causes go out */
+static void dispatch(int mode, char *msg, int len)
+{
+    if (mode == MODE_LEGACY) {
+        assert(legacy_handle_set_params(msg, len) == ESP_OK);
+    } else {
+        assert(esp_rmaker_handle_set_params(msg, len, ESP_RMAKER_REQ_SRC_CLOUD) == ESP_OK);
+    }
+    now_us += CONFIG_ESP_RMAKER_PARAM_REPORT_MIN_INTERVAL * 1000LL;
+    run_timers_and_work();
+}
+
+static void check_reported(void)
+{
+    for (int d = 0; d < device_count; d++) {
+        for (int p = 0; p < NUM_PARAMS; p++) {
+            esp_rmaker_param_val_t *val = esp_rmaker_param_get_val(params[d][p]);
+            assert((p ? val->val.i : val->val.b) == sent[d][p]);
+            assert(reported[d][p] == sent[d][p]);
+        }
+    }
+}
+
+static void run(int count, bool toggle)
+{
+    static char msg[MAX_MSG];
+    struct timespec start, end;
+
+    add_devices(count);
+    for (int mode = 0; mode < MODE_MAX; mode++) {
+        for (int d = 0; d < count; d++) {
+            _esp_rmaker_device_t *device = (_esp_rmaker_device_t *)devices[d];
+            device->write_cb = (mode == MODE_BULK_CB) ? NULL : write_cb;
+            device->bulk_write_cb = (mode == MODE_BULK_CB) ? bulk_write_cb : NULL;
+        }
+        /* The first message builds the index and sets all params */
+        int len = make_message(msg, mode + 1, false);
+        dispatch(mode, msg, len);
+        len = make_message(msg, mode + 2, toggle);
+        callbacks = allocs = publishes = 0;
+        dispatch(mode, msg, len);
+        check_reported();
+        unsigned long msg_callbacks = callbacks, msg_allocs = allocs, msg_publishes = publishes;
+
+        double ns[2] = { 0, 0 };
+        check_publishes = false;
+        for (int reports = 0; reports < 2; reports++) {
+            rmaker_started = reports;
+            for (int i = 0; i < ITERATIONS; i++) {
+                len = make_message(msg, i, toggle);
+                clock_gettime(CLOCK_MONOTONIC, &start);
+                dispatch(mode, msg, len);
+                clock_gettime(CLOCK_MONOTONIC, &end);
+                ns[reports] += (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+            }
+            ns[reports] /= ITERATIONS;
+        }
+        check_publishes = true;
+        printf("%-7s %7d %6d %-9s %9lu %7lu %9lu %10.0f %10.0f\n", toggle ? "toggle" : "all", count, len,
+                mode_names[mode], msg_callbacks,
+                msg_allocs, msg_publishes, ns[0], ns[1]);
+
+        /* One callback per device with a bulk callback, one per param otherwise */
+        if (toggle) {
+            assert(msg_callbacks == 1);
+        } else {
+            assert(msg_callbacks == ((mode == MODE_BULK_CB) ? count : count * NUM_PARAMS));
+        }
+        /* The new dispatch reports the accepted values in one publish, as soon as the callbacks return */
+        if (mode != MODE_LEGACY) {
+            assert(msg_publishes == 1);
+        }
+    }
+    remove_devices();
+}
+
+int main(void)
+{
+    static const int counts[] = { 1, 8, 32 };
+    printf("%d params per device, %d messages each\n", NUM_PARAMS, ITERATIONS);
+    printf("%-7s %7s %6s %-9s %9s %7s %9s %10s %10s\n", "message", "devices", "bytes", "dispatch", "callbacks", "allocs",
+            "publishes", "ns/msg", "ns/report");
+    for (int toggle = 0; toggle < 2; toggle++) {
+        for (int i = 0; i < 3; i++) {
+            run(counts[i], toggle);
+        }
+    }
+    /* Unknown devices and params are skipped */
+    add_devices(1);
+    char msg[] = "{\"Light9\":{\"Power\":true},\"Light0\":{\"Dimmer\":1,\"Power\":true,\"Hue\":\"red\"}}";
+    callbacks = 0;
+    ((_esp_rmaker_device_t *)devices[0])->write_cb = write_cb;
+    assert(esp_rmaker_handle_set_params(msg, strlen(msg), ESP_RMAKER_REQ_SRC_CLOUD) == ESP_OK);
+    assert(callbacks == 1);
+    assert(esp_rmaker_param_get_val(params[0][0])->val.b == true);
+    remove_devices();
+
+    /* A report from another task during a set params request is not held back with the
+     * reports of its callbacks, it is queued as usual
+     */
+    add_devices(2);
+    char power_msg[] = "{\"Light0\":{\"Power\":true}}";
+    ((_esp_rmaker_device_t *)devices[0])->write_cb = other_task_write_cb;
+    now_us += CONFIG_ESP_RMAKER_PARAM_REPORT_MIN_INTERVAL * 1000LL;
+    publishes = 0;
+    assert(esp_rmaker_handle_set_params(power_msg, strlen(power_msg), ESP_RMAKER_REQ_SRC_CLOUD) == ESP_OK);
+    assert(publishes == 0);
+    run_timers_and_work();
+    assert(publishes == 1);
+    assert(reported[1][1] == 42);
+    remove_devices();
+    return 0;
+}
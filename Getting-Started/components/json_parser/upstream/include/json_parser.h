@@ -38,9 +38,22 @@ typedef struct {
 	json_tok_t *tokens;
 	json_tok_t *cur;
 	int num_tokens;
+	/* Set by json_parse_start_indexed() */
+	int *next;		/* Index of the token following each element */
+	int *keys;		/* Hash table of object keys, token index + 1 */
+	uint32_t keys_mask;
+	json_tok_t *arr;	/* Last array element looked up, to continue from */
+	json_tok_t *arr_elem;
+	uint32_t arr_index;
 } jparse_ctx_t;
 
 int json_parse_start(jparse_ctx_t *jctx, char *js, int len);
+/* Like json_parse_start(), but also indexes the keys of all objects and
+ * where every element ends, so that a key is found without walking its
+ * siblings and iterating over an array is linear. Costs an int per token
+ * and two per key.
+ */
+int json_parse_start_indexed(jparse_ctx_t *jctx, char *js, int len);
 int json_parse_end(jparse_ctx_t *jctx);
 
 int json_obj_get_array(jparse_ctx_t *jctx, char *name, int *num_elem);
@@ -57,6 +70,11 @@ int json_obj_get_object_str(jparse_ctx_t *jctx, char *name, char *val, int size)
 int json_obj_get_object_strlen(jparse_ctx_t *jctx, char *name, int *strlen);
 int json_obj_get_array_str(jparse_ctx_t *jctx, char *name, char *val, int size);
 int json_obj_get_array_strlen(jparse_ctx_t *jctx, char *name, int *strlen);
+/* Iterates over the keys of the current object, in the order they appear.
+ * Start with *pos = 0. On success key points into the JSON string, it is not
+ * NULL terminated.
+ */
+int json_obj_get_next_key(jparse_ctx_t *jctx, int *pos, char **key, int *key_len);
 
 int json_arr_get_array(jparse_ctx_t *jctx, uint32_t index);
 int json_arr_leave_array(jparse_ctx_t *jctx);
@@ -23,6 +23,14 @@
 #include <jsmn/jsmn.h>
 #include <json_parser.h>
 
+#ifdef JSON_PARSER_STATS
+/* Tokens looked at by the searches, for benchmarks */
+unsigned long json_parser_tok_visits;
+#define JSON_PARSER_VISIT()	(json_parser_tok_visits++)
+#else
+#define JSON_PARSER_VISIT()
+#endif
+
 static bool token_matches_str(jparse_ctx_t *ctx, json_tok_t *tok, char *str)
 {
 	char *js = ctx->js;
@@ -35,6 +43,7 @@ static json_tok_t *json_skip_elem(json_tok_t *token)
 	json_tok_t *cur = token;
 	int cnt = cur->size;
 	while (cnt--) {
+		JSON_PARSER_VISIT();
 		cur++;
 		cur = json_skip_elem(cur);
 	}
@@ -100,6 +109,31 @@ static int json_tok_to_string(jparse_ctx_t *jctx, json_tok_t *tok, char *val, in
 	return OS_SUCCESS;
 }
 
+/* FNV-1a of the key, mixed with the index of the object it is in */
+static uint32_t json_key_hash(const char *key, int len, int obj)
+{
+	uint32_t hash = 2166136261u;
+	while (len--) {
+		hash ^= (uint8_t)*key++;
+		hash *= 16777619u;
+	}
+	return hash ^ ((uint32_t)obj * 2654435761u);
+}
+
+static json_tok_t *json_obj_search_indexed(jparse_ctx_t *jctx, char *key)
+{
+	int obj = jctx->cur - jctx->tokens;
+	uint32_t i = json_key_hash(key, strlen(key), obj) & jctx->keys_mask;
+	while (jctx->keys[i]) {
+		json_tok_t *tok = &jctx->tokens[jctx->keys[i] - 1];
+		JSON_PARSER_VISIT();
+		if ((tok->parent == obj) && token_matches_str(jctx, tok, key))
+			return tok;
+		i = (i + 1) & jctx->keys_mask;
+	}
+	return NULL;
+}
+
 static json_tok_t *json_obj_search(jparse_ctx_t *jctx, char *key)
 {
 	json_tok_t *tok = jctx->cur;
@@ -108,9 +142,12 @@ static json_tok_t *json_obj_search(jparse_ctx_t *jctx, char *key)
 		return NULL;
 	if (tok->type != JSMN_OBJECT)
 		return NULL;
+	if (jctx->keys)
+		return json_obj_search_indexed(jctx, key);
 
 	while (size--) {
 		tok++;
+		JSON_PARSER_VISIT();
 		if (token_matches_str(jctx, tok, key))
 			return tok;
 		tok = json_skip_elem(tok);
@@ -258,6 +295,26 @@ int json_obj_get_array_strlen(jparse_ctx_t *jctx, char *name, int *strlen)
 	return OS_SUCCESS;
 }
 
+int json_obj_get_next_key(jparse_ctx_t *jctx, int *pos, char **key, int *key_len)
+{
+	int obj = jctx->cur - jctx->tokens;
+	if (jctx->cur->type != JSMN_OBJECT)
+		return -OS_FAIL;
+	/* pos is the index of the next key, token 0 is never one */
+	int i = *pos ? *pos : obj + 1;
+	if ((i >= jctx->num_tokens) || (jctx->tokens[i].parent != obj))
+		return -OS_FAIL;
+	json_tok_t *tok = &jctx->tokens[i];
+	JSON_PARSER_VISIT();
+	*key = jctx->js + tok->start;
+	*key_len = tok->end - tok->start;
+	if (jctx->next)
+		*pos = jctx->next[i];
+	else
+		*pos = json_skip_elem(tok) - jctx->tokens + 1;
+	return OS_SUCCESS;
+}
+
 static json_tok_t *json_arr_search(jparse_ctx_t *ctx, uint32_t index)
 {
 	json_tok_t *tok = ctx->cur;
@@ -265,9 +322,31 @@ static json_tok_t *json_arr_search(jparse_ctx_t *ctx, uint32_t index)
 		return NULL;
 	if (index > (uint32_t)(tok->size - 1))
 		return NULL;
+	if (ctx->next && index) {
+		/* Continue from the last element looked up when iterating. The
+		 * first element is found right away, so looking it up in a nested
+		 * array does not lose the place in the outer one.
+		 */
+		json_tok_t *arr = tok;
+		uint32_t i = 0;
+		tok++;
+		if ((ctx->arr == arr) && (ctx->arr_index <= index)) {
+			tok = ctx->arr_elem;
+			i = ctx->arr_index;
+		}
+		for (; i < index; i++) {
+			JSON_PARSER_VISIT();
+			tok = &ctx->tokens[ctx->next[tok - ctx->tokens]];
+		}
+		ctx->arr = arr;
+		ctx->arr_elem = tok;
+		ctx->arr_index = index;
+		return tok;
+	}
 	/* Increment by 1, so that token points to index 0 */
 	tok++;
 	while (index--) {
+		JSON_PARSER_VISIT();
 		tok = json_skip_elem(tok);
 		tok++;
 	}
@@ -389,10 +468,57 @@ int json_parse_start(jparse_ctx_t *jctx, char *js, int len)
 	return OS_SUCCESS;
 }
 
+int json_parse_start_indexed(jparse_ctx_t *jctx, char *js, int len)
+{
+	if (json_parse_start(jctx, js, len) != OS_SUCCESS)
+		return -OS_FAIL;
+	json_tok_t *tokens = jctx->tokens;
+	int n = jctx->num_tokens;
+	int num_keys = 0, i;
+	for (i = 1; i < n; i++) {
+		if ((tokens[i].parent >= 0) && (tokens[tokens[i].parent].type == JSMN_OBJECT))
+			num_keys++;
+	}
+	/* At most half full, so that probes stay short */
+	uint32_t num_slots = 2;
+	while (num_slots < 2 * (uint32_t)num_keys)
+		num_slots <<= 1;
+	jctx->next = calloc(n + num_slots, sizeof(int));
+	if (!jctx->next) {
+		json_parse_end(jctx);
+		return -OS_FAIL;
+	}
+	jctx->keys = jctx->next + n;
+	jctx->keys_mask = num_slots - 1;
+
+	/* Children follow their parent, so going backwards every element
+	 * ends where its last child ends.
+	 */
+	for (i = n - 1; i >= 0; i--) {
+		if (jctx->next[i] < i + 1)
+			jctx->next[i] = i + 1;
+		int parent = tokens[i].parent;
+		if ((parent >= 0) && (jctx->next[parent] < jctx->next[i]))
+			jctx->next[parent] = jctx->next[i];
+	}
+	for (i = 1; i < n; i++) {
+		int obj = tokens[i].parent;
+		if ((obj < 0) || (tokens[obj].type != JSMN_OBJECT))
+			continue;
+		uint32_t slot = json_key_hash(js + tokens[i].start, tokens[i].end - tokens[i].start, obj) & jctx->keys_mask;
+		while (jctx->keys[slot])
+			slot = (slot + 1) & jctx->keys_mask;
+		jctx->keys[slot] = i + 1;
+	}
+	return OS_SUCCESS;
+}
+
 int json_parse_end(jparse_ctx_t *jctx)
 {
 	if (jctx->tokens)
 		free(jctx->tokens);
+	if (jctx->next)
+		free(jctx->next);
 	memset(jctx, 0, sizeof(jparse_ctx_t));
 	return OS_SUCCESS;
 }
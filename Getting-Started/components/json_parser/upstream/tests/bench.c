@@ -0,0 +1,200 @@
+/*
+ *    Copyright 2020 Piyush Shah <shahpiyushv@gmail.com>
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/* Compares json_parse_start() and json_parse_start_indexed() on the payloads
+ * ESP RainMaker parses: set params messages, read the way
+ * esp_rmaker_device_set_params() reads them, with one lookup per param of
+ * the device, and schedule lists, iterated the way esp_rmaker_schedule.c
+ * does. Both modes have to read the same values.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <assert.h>
+#include <json_parser.h>
+
+extern unsigned long json_parser_tok_visits;
+
+#define MAX_PAYLOAD	(64 * 1024)
+
+typedef int (*parse_start_t)(jparse_ctx_t *jctx, char *js, int len);
+
+static char payload[MAX_PAYLOAD];
+
+static double now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* {"Thermostat":{"p0":0,"p1":true,"p2":1.5,"p3":"s3","p4":{"k":4},...}} */
+static int make_set_params(int num_params)
+{
+	int len = snprintf(payload, MAX_PAYLOAD, "{\"Thermostat\":{");
+	for (int i = 0; i < num_params; i++) {
+		const char *sep = i ? "," : "";
+		switch (i % 5) {
+		case 0:
+			len += snprintf(payload + len, MAX_PAYLOAD - len, "%s\"p%d\":%d", sep, i, i);
+			break;
+		case 1:
+			len += snprintf(payload + len, MAX_PAYLOAD - len, "%s\"p%d\":%s", sep, i, i % 2 ? "true" : "false");
+			break;
+		case 2:
+			len += snprintf(payload + len, MAX_PAYLOAD - len, "%s\"p%d\":%d.5", sep, i, i);
+			break;
+		case 3:
+			len += snprintf(payload + len, MAX_PAYLOAD - len, "%s\"p%d\":\"s%d\"", sep, i, i);
+			break;
+		default:
+			len += snprintf(payload + len, MAX_PAYLOAD - len, "%s\"p%d\":{\"k\":%d,\"a\":[1,2,3]}", sep, i, i);
+			break;
+		}
+	}
+	len += snprintf(payload + len, MAX_PAYLOAD - len, "}}");
+	assert(len < MAX_PAYLOAD);
+	return len;
+}
+
+/* Returns a checksum of the values read */
+static long read_set_params(parse_start_t parse_start, int len, int num_params)
+{
+	jparse_ctx_t jctx;
+	long sum = 0;
+	char name[16], str[32];
+	assert(parse_start(&jctx, payload, len) == OS_SUCCESS);
+	assert(json_obj_get_object(&jctx, "Thermostat") == OS_SUCCESS);
+	for (int i = 0; i < num_params; i++) {
+		int ival = 0, slen = 0;
+		bool bval = false;
+		float fval = 0;
+		snprintf(name, sizeof(name), "p%d", i);
+		switch (i % 5) {
+		case 0:
+			assert(json_obj_get_int(&jctx, name, &ival) == OS_SUCCESS);
+			sum += ival;
+			break;
+		case 1:
+			assert(json_obj_get_bool(&jctx, name, &bval) == OS_SUCCESS);
+			sum += bval;
+			break;
+		case 2:
+			assert(json_obj_get_float(&jctx, name, &fval) == OS_SUCCESS);
+			sum += (long)(fval * 2);
+			break;
+		case 3:
+			assert(json_obj_get_string(&jctx, name, str, sizeof(str)) == OS_SUCCESS);
+			sum += atoi(str + 1);
+			break;
+		default:
+			assert(json_obj_get_object_strlen(&jctx, name, &slen) == OS_SUCCESS);
+			sum += slen;
+			break;
+		}
+	}
+	/* A param the device has but the message does not */
+	assert(json_obj_get_int(&jctx, "missing", &num_params) != OS_SUCCESS);
+	json_obj_leave_object(&jctx);
+	json_parse_end(&jctx);
+	return sum;
+}
+
+/* [{"id":"s0","name":"n0","enabled":true,"triggers":[{"m":0,"d":31}],"action":{"Light":{"power":true}}},...] */
+static int make_schedules(int num_schedules)
+{
+	int len = snprintf(payload, MAX_PAYLOAD, "[");
+	for (int i = 0; i < num_schedules; i++) {
+		len += snprintf(payload + len, MAX_PAYLOAD - len,
+				"%s{\"id\":\"s%d\",\"name\":\"n%d\",\"enabled\":true,\"triggers\":[{\"m\":%d,\"d\":31}],"
+				"\"action\":{\"Light\":{\"power\":true,\"brightness\":%d}}}",
+				i ? "," : "", i, i, i, i % 100);
+	}
+	len += snprintf(payload + len, MAX_PAYLOAD - len, "]");
+	assert(len < MAX_PAYLOAD);
+	return len;
+}
+
+static long read_schedules(parse_start_t parse_start, int len, int num_schedules)
+{
+	jparse_ctx_t jctx;
+	long sum = 0;
+	char id[16];
+	int i = 0, num_triggers, minutes, action_len;
+	assert(parse_start(&jctx, payload, len) == OS_SUCCESS);
+	while (json_arr_get_object(&jctx, i) == OS_SUCCESS) {
+		assert(json_obj_get_string(&jctx, "id", id, sizeof(id)) == OS_SUCCESS);
+		assert(atoi(id + 1) == i);
+		if (json_obj_get_array(&jctx, "triggers", &num_triggers) == OS_SUCCESS) {
+			if (json_arr_get_object(&jctx, 0) == OS_SUCCESS) {
+				json_obj_get_int(&jctx, "m", &minutes);
+				sum += minutes;
+				json_arr_leave_object(&jctx);
+			}
+			json_obj_leave_array(&jctx);
+		}
+		assert(json_obj_get_object_strlen(&jctx, "action", &action_len) == OS_SUCCESS);
+		sum += action_len;
+		json_arr_leave_object(&jctx);
+		i++;
+	}
+	assert(i == num_schedules);
+	json_parse_end(&jctx);
+	return sum;
+}
+
+typedef long (*read_fn_t)(parse_start_t parse_start, int len, int count);
+
+static void bench(const char *name, int count, int len, read_fn_t read)
+{
+	struct {
+		parse_start_t parse_start;
+		unsigned long visits;
+		double ns;
+		long sum;
+	} modes[2] = { { json_parse_start }, { json_parse_start_indexed } };
+	int iterations = 2000000 / len + 1;
+
+	for (int m = 0; m < 2; m++) {
+		json_parser_tok_visits = 0;
+		modes[m].sum = read(modes[m].parse_start, len, count);
+		modes[m].visits = json_parser_tok_visits;
+		double start = now_ns();
+		for (int it = 0; it < iterations; it++)
+			read(modes[m].parse_start, len, count);
+		modes[m].ns = (now_ns() - start) / iterations;
+	}
+	assert(modes[0].sum == modes[1].sum);
+	printf("%-12s %5d %7d %12lu %12lu %12.0f %12.0f %7.1fx\n", name, count, len,
+			modes[0].visits, modes[1].visits, modes[0].ns, modes[1].ns, modes[0].ns / modes[1].ns);
+}
+
+int main(int argc, char **argv)
+{
+	static const int sizes[] = { 10, 100, 500 };
+	printf("%-12s %5s %7s %12s %12s %12s %12s %8s\n", "payload", "count", "bytes",
+			"visits", "visits idx", "ns", "ns idx", "speedup");
+	for (int i = 0; i < 3; i++) {
+		int len = make_set_params(sizes[i]);
+		bench("set params", sizes[i], len, read_set_params);
+	}
+	for (int i = 0; i < 3; i++) {
+		int len = make_schedules(sizes[i]);
+		bench("schedules", sizes[i], len, read_schedules);
+	}
+	return 0;
+}
@@ -4,6 +4,7 @@
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
+#include "esp_timer.h"
 
 #include "ft6336u.h"
 #include "i2c_device.h"
@@ -11,11 +12,17 @@
 #define FT6336U_I2C_ADDR 0x38
 #define FT6336U_INTR_PIN 39
 
-static uint16_t _x, _y;
-static bool _pressed;
+/* TD_STATUS (0x02) through P2_MISC (0x0E) */
+#define FT6336U_TOUCH_REG 0x02
+#define FT6336U_TOUCH_LEN 13
+
+static touch_ring_t touch_ring;
 static I2CDevice_t ft6336u_i2c;
 static xTaskHandle ft6336_task_handle;
-static SemaphoreHandle_t thread_mutex;
+/* Given on every edge of the interrupt line. Waiting on it instead of
+ * suspending keeps the ISR from waking the task out of i2c_transfer() */
+static SemaphoreHandle_t ft6336_intr_sem;
+static TaskHandle_t event_task = NULL;
 
 static void IRAM_ATTR FT6336U_ISRHandler(void* arg);
 static void FT6336U_UpdateTask(void *arg);
@@ -23,8 +30,6 @@ static void FT6336U_UpdateTask(void *arg);
 void FT6336U_Init() {
     ft6336u_i2c = i2c_malloc_device(I2C_NUM_1, 21, 22, 400000, FT6336U_I2C_ADDR);
     i2c_write_byte(ft6336u_i2c, 0xa4, 0x00);
-    
-    thread_mutex = xSemaphoreCreateMutex();
 
     gpio_config_t io_conf;
     io_conf.intr_type = GPIO_INTR_ANYEDGE;
@@ -32,65 +37,103 @@ void FT6336U_Init() {
     io_conf.mode = GPIO_MODE_INPUT;
     io_conf.pull_up_en = 1;
     gpio_config(&io_conf);
+    touch_ring_init(&touch_ring);
+    ft6336_intr_sem = xSemaphoreCreateBinary();
     xTaskCreatePinnedToCore(FT6336U_UpdateTask, "FT6336Task", 2 * 1024, NULL, 1, &ft6336_task_handle, 0);
     gpio_install_isr_service(0);
-    gpio_isr_handler_add(FT6336U_INTR_PIN, FT6336U_ISRHandler, &ft6336_task_handle);
+    gpio_isr_handler_add(FT6336U_INTR_PIN, FT6336U_ISRHandler, NULL);
 }
 
 static void IRAM_ATTR FT6336U_ISRHandler(void* arg) {
-    xTaskHandle task_handle = *(xTaskHandle *)arg;
-    xTaskResumeFromISR(task_handle);
+    BaseType_t higher_priority_task_woken = pdFALSE;
+    xSemaphoreGiveFromISR(ft6336_intr_sem, &higher_priority_task_woken);
+    if (higher_priority_task_woken) {
+        portYIELD_FROM_ISR();
+    }
 }
 
 static void FT6336U_UpdateTask(void *arg) {
-    uint8_t buff[5] = {0x00, 0x00, 0x00, 0x00, 0x00};
-    bool press_stash;
+    uint8_t buff[FT6336U_TOUCH_LEN] = {0x00};
+    touch_sample_t sample;
+
+    /* The same read every time, so the command link is built only once */
+    i2c_trans_t read = {
+        .device = ft6336u_i2c,
+        .reg_addr = FT6336U_TOUCH_REG,
+        .data = buff,
+        .length = FT6336U_TOUCH_LEN,
+        .flags = I2C_TRANS_READ | I2C_TRANS_KEEP_CMD,
+    };
+
     for (;;) {
-        i2c_read_bytes(ft6336u_i2c, 0x02, buff, 5);
-        
-        xSemaphoreTake(thread_mutex, portMAX_DELAY);
-        _pressed = buff[0] ? true : false;
-        _x = ((buff[1] & 0x0f) << 8) | buff[2];
-        _y = ((buff[3] & 0x0f) << 8) | buff[4];
-        press_stash = _pressed;
-        xSemaphoreGive(thread_mutex);
-
-        if (press_stash == false) {
-            vTaskSuspend(NULL);
+        i2c_transfer(&read);
+
+        sample.time_us = esp_timer_get_time();
+        /* The count is only valid for 1 or 2 points */
+        sample.points = buff[0] & 0x0f;
+        if (sample.points > 2) {
+            sample.points = 0;
+        }
+        sample.x = ((buff[1] & 0x0f) << 8) | buff[2];
+        sample.y = ((buff[3] & 0x0f) << 8) | buff[4];
+        sample.x2 = ((buff[7] & 0x0f) << 8) | buff[8];
+        sample.y2 = ((buff[9] & 0x0f) << 8) | buff[10];
+        touch_ring_push(&touch_ring, &sample);
+
+        if (event_task) {
+            xTaskNotifyGive(event_task);
+        }
+
+        if (sample.points == 0) {
+            xSemaphoreTake(ft6336_intr_sem, portMAX_DELAY);
         } else {
             vTaskDelay(pdMS_TO_TICKS(20));
         }
     }
 }
 
+void FT6336U_SetEventTask(TaskHandle_t task) {
+    event_task = task;
+}
+
+void FT6336U_ReaderInit(touch_ring_reader_t *reader) {
+    touch_ring_reader_init(&touch_ring, reader);
+}
+
+bool FT6336U_ReadSample(touch_ring_reader_t *reader, touch_sample_t *sample) {
+    return touch_ring_read(&touch_ring, reader, sample);
+}
+
+uint32_t FT6336U_SamplesPending(const touch_ring_reader_t *reader) {
+    return touch_ring_pending(&touch_ring, reader);
+}
+
+bool FT6336U_GetSample(touch_sample_t *sample) {
+    return touch_ring_latest(&touch_ring, sample);
+}
+
 void FT6336U_GetTouch(uint16_t* x, uint16_t* y, bool* press_down) {
-    xSemaphoreTake(thread_mutex, portMAX_DELAY);
-    *x = _x;
-    *y = _y;
-    *press_down = _pressed;
-    xSemaphoreGive(thread_mutex);
+    touch_sample_t sample = {0};
+    FT6336U_GetSample(&sample);
+    *x = sample.x;
+    *y = sample.y;
+    *press_down = sample.points ? true : false;
 }
 
 bool FT6336U_WasPressed() {
-    bool state = 0;
-    xSemaphoreTake(thread_mutex, portMAX_DELAY);
-    state = _pressed;
-    xSemaphoreGive(thread_mutex);
-    return state;
+    touch_sample_t sample = {0};
+    FT6336U_GetSample(&sample);
+    return sample.points ? true : false;
 }
 
 uint16_t FT6336U_GetPressPosX() {
-    uint16_t stash = 0;
-    xSemaphoreTake(thread_mutex, portMAX_DELAY);
-    stash = _x;
-    xSemaphoreGive(thread_mutex);
-    return stash;
+    touch_sample_t sample = {0};
+    FT6336U_GetSample(&sample);
+    return sample.x;
 }
 
 uint16_t FT6336U_GetPressPosY() {
-    uint16_t stash = 0;
-    xSemaphoreTake(thread_mutex, portMAX_DELAY);
-    stash = _y;
-    xSemaphoreGive(thread_mutex);
-    return stash;
+    touch_sample_t sample = {0};
+    FT6336U_GetSample(&sample);
+    return sample.y;
 }
@@ -0,0 +1,94 @@
+#include <string.h>
+
+#include "touch_ring.h"
+
+#define TOUCH_RING_MASK (TOUCH_RING_SIZE - 1)
+
+/* Torn copies touch_ring_latest() retries before giving up */
+#define TOUCH_RING_READ_RETRIES 4
+
+/* Copy a slot if it still holds sample `n`. Each slot is a small seqlock:
+ * the sequence is cleared before the sample is rewritten and set again
+ * after, so a copy that races with the producer is detected and dropped. */
+static bool touch_ring_load(touch_ring_t *ring, uint32_t n, touch_sample_t *sample) {
+    touch_slot_t *slot = &ring->slots[n & TOUCH_RING_MASK];
+
+    uint32_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+    if (seq != n + 1) {
+        return false;
+    }
+    memcpy(sample, &slot->sample, sizeof(*sample));
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit(&slot->seq, memory_order_relaxed) == seq;
+}
+
+void touch_ring_init(touch_ring_t *ring) {
+    for (uint32_t i = 0; i < TOUCH_RING_SIZE; i++) {
+        atomic_init(&ring->slots[i].seq, 0);
+    }
+    atomic_init(&ring->head, 0);
+}
+
+void touch_ring_push(touch_ring_t *ring, const touch_sample_t *sample) {
+    uint32_t n = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    touch_slot_t *slot = &ring->slots[n & TOUCH_RING_MASK];
+
+    atomic_store_explicit(&slot->seq, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    memcpy(&slot->sample, sample, sizeof(*sample));
+    atomic_store_explicit(&slot->seq, n + 1, memory_order_release);
+    atomic_store_explicit(&ring->head, n + 1, memory_order_release);
+}
+
+void touch_ring_reader_init(touch_ring_t *ring, touch_ring_reader_t *reader) {
+    reader->next = atomic_load_explicit(&ring->head, memory_order_acquire);
+    reader->dropped = 0;
+}
+
+bool touch_ring_read(touch_ring_t *ring, touch_ring_reader_t *reader, touch_sample_t *sample) {
+    for (;;) {
+        uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        if (reader->next == head) {
+            return false;
+        }
+
+        /* Lapped: skip to the oldest sample still in the ring, leaving one
+         * slot of margin for the one the producer may be writing */
+        if (head - reader->next >= TOUCH_RING_SIZE) {
+            uint32_t oldest = head - TOUCH_RING_SIZE + 1;
+            reader->dropped += oldest - reader->next;
+            reader->next = oldest;
+        }
+
+        if (touch_ring_load(ring, reader->next, sample)) {
+            reader->next++;
+            return true;
+        }
+
+        /* Overwritten while copying, the next pass resyncs */
+        reader->dropped++;
+        reader->next++;
+    }
+}
+
+uint32_t touch_ring_pending(touch_ring_t *ring, const touch_ring_reader_t *reader) {
+    uint32_t pending = atomic_load_explicit(&ring->head, memory_order_acquire) - reader->next;
+    return pending < TOUCH_RING_SIZE ? pending : TOUCH_RING_SIZE - 1;
+}
+
+bool touch_ring_latest(touch_ring_t *ring, touch_sample_t *sample) {
+    /* A push rewrites the slot at head and publishes head after it, so the
+     * newest sample's slot is only reused once the producer has lapped the
+     * ring. A failed copy means newer samples came in, retry with the new
+     * head, but only a few times so a reader never spins on a busy panel */
+    for (int retry = 0; retry < TOUCH_RING_READ_RETRIES; retry++) {
+        uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        if (head == 0) {
+            return false;
+        }
+        if (touch_ring_load(ring, head - 1, sample)) {
+            return true;
+        }
+    }
+    return false;
+}
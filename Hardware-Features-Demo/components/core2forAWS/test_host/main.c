@@ -0,0 +1,227 @@
+/*
+ * Host-side harness for the display flush path.
+ *
+ * Replays LVGL invalidation traces through the area merge policy and the
+ * address window cache in ../tft/disp_area.c, and counts the bytes that
+ * would go over the SPI bus compared to the previous flush path.
+ *
+ * Trace format: one "frame" line per refresh followed by one
+ * "x1 y1 x2 y2" line per invalidated area. Lines starting with '#' are
+ * ignored.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "disp_area.h"
+
+#define HOR_RES         320
+#define VER_RES         240
+#define BUF_PX          (HOR_RES * 32)  /* DISP_BUF_SIZE */
+#define INV_BUF_SIZE    32              /* LV_INV_BUF_SIZE */
+
+typedef struct {
+    lv_area_t areas[INV_BUF_SIZE];
+    uint8_t joined[INV_BUF_SIZE];
+    uint16_t count;
+} frame_t;
+
+typedef struct {
+    uint32_t frames;
+    uint32_t windows;
+    uint32_t pixel_bytes;
+    uint32_t cmd_bytes;
+} bus_count_t;
+
+static uint32_t area_size(const lv_area_t *a)
+{
+    return (uint32_t)(a->x2 - a->x1 + 1) * (uint32_t)(a->y2 - a->y1 + 1);
+}
+
+static int area_is_on(const lv_area_t *a, const lv_area_t *b)
+{
+    return !(a->x1 > b->x2 || b->x1 > a->x2 || a->y1 > b->y2 || b->y1 > a->y2);
+}
+
+/* Same policy as lv_refr_join_area() in LVGL 7.11 */
+static void lvgl_join(frame_t *f)
+{
+    for (uint16_t in = 0; in < f->count; in++) {
+        if (f->joined[in]) {
+            continue;
+        }
+        for (uint16_t from = 0; from < f->count; from++) {
+            if (f->joined[from] || in == from || !area_is_on(&f->areas[in], &f->areas[from])) {
+                continue;
+            }
+            lv_area_t u = {
+                f->areas[in].x1 < f->areas[from].x1 ? f->areas[in].x1 : f->areas[from].x1,
+                f->areas[in].y1 < f->areas[from].y1 ? f->areas[in].y1 : f->areas[from].y1,
+                f->areas[in].x2 > f->areas[from].x2 ? f->areas[in].x2 : f->areas[from].x2,
+                f->areas[in].y2 > f->areas[from].y2 ? f->areas[in].y2 : f->areas[from].y2,
+            };
+            if (area_size(&u) < area_size(&f->areas[in]) + area_size(&f->areas[from])) {
+                f->areas[in] = u;
+                f->joined[from] = 1;
+            }
+        }
+    }
+}
+
+/* Split the area in buffer-sized bands like lv_refr_area() and count the
+ * bytes of every flush call */
+static void flush_frame(const frame_t *f, int cache_window, bus_count_t *bus)
+{
+    lv_area_t window;
+    int window_valid = 0;
+    uint32_t windows = bus->windows;
+
+    for (uint16_t i = 0; i < f->count; i++) {
+        if (f->joined[i]) {
+            continue;
+        }
+        const lv_area_t *a = &f->areas[i];
+        lv_coord_t w = a->x2 - a->x1 + 1;
+        lv_coord_t max_row = BUF_PX / w;
+
+        for (lv_coord_t y = a->y1; y <= a->y2; y += max_row) {
+            lv_area_t band = { a->x1, y, a->x2, y + max_row - 1 };
+            if (band.y2 > a->y2) {
+                band.y2 = a->y2;
+            }
+            if (cache_window) {
+                bus->cmd_bytes += disp_area_window_cmd_bytes(window_valid ? &window : NULL, &band, NULL, NULL);
+            } else {
+                bus->cmd_bytes += DISP_AREA_WINDOW_CMD_BYTES;
+            }
+            window = band;
+            window_valid = 1;
+            bus->pixel_bytes += area_size(&band) * 2;
+            bus->windows++;
+        }
+    }
+
+    if (bus->windows != windows) {
+        bus->frames++;
+    }
+}
+
+static int replay(const char *path)
+{
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) {
+        perror(path);
+        return 1;
+    }
+
+    bus_count_t old_bus = {0};
+    bus_count_t new_bus = {0};
+    uint32_t merged = 0;
+    frame_t frame = {0};
+    int have_frame = 0;
+    char line[128];
+
+    for (;;) {
+        int eof = fgets(line, sizeof(line), fp) == NULL;
+        if (eof || strncmp(line, "frame", 5) == 0) {
+            if (have_frame) {
+                frame_t f = frame;
+                lvgl_join(&f);
+                flush_frame(&f, 0, &old_bus);
+
+                f = frame;
+                merged += disp_area_merge(f.areas, f.joined, f.count, DISP_AREA_WINDOW_COST_PX);
+                lvgl_join(&f);
+                flush_frame(&f, 1, &new_bus);
+            }
+            if (eof) {
+                break;
+            }
+            memset(&frame, 0, sizeof(frame));
+            have_frame = 1;
+            continue;
+        }
+
+        int x1, y1, x2, y2;
+        if (line[0] == '#' || sscanf(line, "%d %d %d %d", &x1, &y1, &x2, &y2) != 4) {
+            continue;
+        }
+        /* LVGL restarts with a full screen area when the buffer overflows */
+        if (frame.count == INV_BUF_SIZE) {
+            frame.count = 0;
+            x1 = 0; y1 = 0; x2 = HOR_RES - 1; y2 = VER_RES - 1;
+        }
+        frame.areas[frame.count++] = (lv_area_t){ x1, y1, x2, y2 };
+    }
+    fclose(fp);
+
+    printf("%s: %u frames, %u areas merged\n", path, new_bus.frames, merged);
+    printf("  before: %6u windows %9u pixel bytes %7u command bytes (%.2f%%)\n",
+           old_bus.windows, old_bus.pixel_bytes, old_bus.cmd_bytes,
+           100.0 * old_bus.cmd_bytes / (old_bus.pixel_bytes + old_bus.cmd_bytes));
+    printf("  after:  %6u windows %9u pixel bytes %7u command bytes (%.2f%%)\n",
+           new_bus.windows, new_bus.pixel_bytes, new_bus.cmd_bytes,
+           100.0 * new_bus.cmd_bytes / (new_bus.pixel_bytes + new_bus.cmd_bytes));
+
+    /* Every merge trades at most DISP_AREA_WINDOW_COST_PX extra pixels
+     * for a saved window */
+    if (new_bus.frames != old_bus.frames || new_bus.windows > old_bus.windows ||
+        new_bus.cmd_bytes > old_bus.cmd_bytes) {
+        printf("  FAIL: merged flush path sends more windows or command bytes\n");
+        return 1;
+    }
+    return 0;
+}
+
+static void test_window_cmd_bytes(void)
+{
+    lv_area_t band1 = { 0, 0, 319, 31 };
+    lv_area_t band2 = { 0, 32, 319, 63 };
+    lv_area_t label = { 20, 32, 139, 63 };
+    bool caset, raset;
+
+    assert(disp_area_window_cmd_bytes(NULL, &band1, &caset, &raset) == DISP_AREA_WINDOW_CMD_BYTES);
+    assert(caset && raset);
+    assert(disp_area_window_cmd_bytes(&band1, &band2, &caset, &raset) == DISP_AREA_ADDR_CMD_BYTES + 1);
+    assert(!caset && raset);
+    assert(disp_area_window_cmd_bytes(&band2, &label, &caset, &raset) == DISP_AREA_ADDR_CMD_BYTES + 1);
+    assert(caset && !raset);
+    assert(disp_area_window_cmd_bytes(&band2, &band2, &caset, &raset) == DISP_AREA_RAMWR_CMD_BYTES);
+}
+
+static void test_merge(void)
+{
+    /* Two stacked labels with a small gap are cheaper as one window */
+    lv_area_t areas[3] = {
+        { 20, 60, 139, 83 },
+        { 20, 88, 139, 111 },
+        { 250, 4, 315, 19 },
+    };
+    uint8_t joined[3] = {0};
+
+    assert(disp_area_merge(areas, joined, 3, DISP_AREA_WINDOW_COST_PX) == 1);
+    assert(joined[1] && !joined[0] && !joined[2]);
+    assert(areas[0].y1 == 60 && areas[0].y2 == 111);
+
+    /* Far apart areas stay separate */
+    lv_area_t far[2] = {
+        { 0, 0, 15, 15 },
+        { 300, 220, 315, 235 },
+    };
+    uint8_t far_joined[2] = {0};
+    assert(disp_area_merge(far, far_joined, 2, DISP_AREA_WINDOW_COST_PX) == 0);
+}
+
+int main(int argc, char **argv)
+{
+    int ret = 0;
+
+    test_window_cmd_bytes();
+    test_merge();
+
+    for (int i = 1; i < argc; i++) {
+        ret |= replay(argv[i]);
+    }
+    return ret;
+}
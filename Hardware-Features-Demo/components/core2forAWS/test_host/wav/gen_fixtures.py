@@ -0,0 +1,33 @@
+#!/usr/bin/env python3
+# Generates the WAV fixtures used by mic_features_test.c: 0.2 s of 16-bit
+# mono PCM at 44.1 kHz, the rate the SPM1423 runs at.
+import math
+import random
+import struct
+import wave
+
+RATE = 44100
+LENGTH = RATE // 5
+
+
+def write(name, samples):
+    with wave.open(name, 'wb') as w:
+        w.setnchannels(1)
+        w.setsampwidth(2)
+        w.setframerate(RATE)
+        w.writeframes(struct.pack('<%dh' % len(samples), *samples))
+
+
+def sine(freq, dbfs):
+    # RMS of a sine is its amplitude over sqrt(2)
+    amp = 32768 * 10 ** (dbfs / 20) * math.sqrt(2)
+    return [max(-32768, min(32767, round(amp * math.sin(2 * math.pi * freq * n / RATE))))
+            for n in range(LENGTH)]
+
+
+random.seed(1)
+write('silence.wav', [0] * LENGTH)
+write('sine_1k_-20dbfs.wav', sine(1000, -20))
+write('sine_100_-10dbfs.wav', sine(100, -10))
+write('sine_8k_-3dbfs.wav', sine(8000, -3.0103))
+write('noise_-30dbfs.wav', [round(random.gauss(0, 32768 * 10 ** (-30 / 20))) for _ in range(LENGTH)])
@@ -0,0 +1,1045 @@
+/*
+ * Twiddle factors shared by every FFT plan up to FFT_TWIDDLE_MAX_SIZE points.
+ *
+ * Entry k holds cos(2 pi k / N) and sin(2 pi k / N) for N = FFT_TWIDDLE_MAX_SIZE,
+ * interleaved like the tables fft_init() used to compute. A plan of size n
+ * reads every (N / n)-th entry.
+ *
+ * Generated, do not edit. To change the size, regenerate with:
+ *
+ *   python3 -c "import math; N=1024; print('\n'.join('  %+.9ef, %+.9ef,' % (math.cos(2*math.pi*k/N), math.sin(2*math.pi*k/N)) for k in range(N)))"
+ */
+#ifndef __FFT_TWIDDLE_H__
+#define __FFT_TWIDDLE_H__
+
+#define FFT_TWIDDLE_MAX_SIZE 1024
+
+static const float fft_twiddle_table[2 * FFT_TWIDDLE_MAX_SIZE] =
+{
+  +1.000000000e+00f, +0.000000000e+00f,
+  +9.999811753e-01f, +6.135884649e-03f,
+  +9.999247018e-01f, +1.227153829e-02f,
+  +9.998305818e-01f, +1.840672991e-02f,
+  +9.996988187e-01f, +2.454122852e-02f,
+  +9.995294175e-01f, +3.067480318e-02f,
+  +9.993223846e-01f, +3.680722294e-02f,
+  +9.990777278e-01f, +4.293825693e-02f,
+  +9.987954562e-01f, +4.906767433e-02f,
+  +9.984755806e-01f, +5.519524435e-02f,
+  +9.981181129e-01f, +6.132073630e-02f,
+  +9.977230666e-01f, +6.744391956e-02f,
+  +9.972904567e-01f, +7.356456360e-02f,
+  +9.968202993e-01f, +7.968243797e-02f,
+  +9.963126122e-01f, +8.579731234e-02f,
+  +9.957674145e-01f, +9.190895650e-02f,
+  +9.951847267e-01f, +9.801714033e-02f,
+  +9.945645707e-01f, +1.041216339e-01f,
+  +9.939069700e-01f, +1.102222073e-01f,
+  +9.932119492e-01f, +1.163186309e-01f,
+  +9.924795346e-01f, +1.224106752e-01f,
+  +9.917097537e-01f, +1.284981108e-01f,
+  +9.909026354e-01f, +1.345807085e-01f,
+  +9.900582103e-01f, +1.406582393e-01f,
+  +9.891765100e-01f, +1.467304745e-01f,
+  +9.882575677e-01f, +1.527971853e-01f,
+  +9.873014182e-01f, +1.588581433e-01f,
+  +9.863080972e-01f, +1.649131205e-01f,
+  +9.852776424e-01f, +1.709618888e-01f,
+  +9.842100924e-01f, +1.770042204e-01f,
+  +9.831054874e-01f, +1.830398880e-01f,
+  +9.819638691e-01f, +1.890686641e-01f,
+  +9.807852804e-01f, +1.950903220e-01f,
+  +9.795697657e-01f, +2.011046348e-01f,
+  +9.783173707e-01f, +2.071113762e-01f,
+  +9.770281427e-01f, +2.131103199e-01f,
+  +9.757021300e-01f, +2.191012402e-01f,
+  +9.743393828e-01f, +2.250839114e-01f,
+  +9.729399522e-01f, +2.310581083e-01f,
+  +9.715038910e-01f, +2.370236060e-01f,
+  +9.700312532e-01f, +2.429801799e-01f,
+  +9.685220943e-01f, +2.489276057e-01f,
+  +9.669764710e-01f, +2.548656596e-01f,
+  +9.653944417e-01f, +2.607941179e-01f,
+  +9.637760658e-01f, +2.667127575e-01f,
+  +9.621214043e-01f, +2.726213554e-01f,
+  +9.604305194e-01f, +2.785196894e-01f,
+  +9.587034749e-01f, +2.844075372e-01f,
+  +9.569403357e-01f, +2.902846773e-01f,
+  +9.551411683e-01f, +2.961508882e-01f,
+  +9.533060404e-01f, +3.020059493e-01f,
+  +9.514350210e-01f, +3.078496400e-01f,
+  +9.495281806e-01f, +3.136817404e-01f,
+  +9.475855910e-01f, +3.195020308e-01f,
+  +9.456073254e-01f, +3.253102922e-01f,
+  +9.435934582e-01f, +3.311063058e-01f,
+  +9.415440652e-01f, +3.368898534e-01f,
+  +9.394592236e-01f, +3.426607173e-01f,
+  +9.373390119e-01f, +3.484186802e-01f,
+  +9.351835099e-01f, +3.541635254e-01f,
+  +9.329927988e-01f, +3.598950365e-01f,
+  +9.307669611e-01f, +3.656129978e-01f,
+  +9.285060805e-01f, +3.713171940e-01f,
+  +9.262102421e-01f, +3.770074102e-01f,
+  +9.238795325e-01f, +3.826834324e-01f,
+  +9.215140393e-01f, +3.883450467e-01f,
+  +9.191138517e-01f, +3.939920401e-01f,
+  +9.166790599e-01f, +3.996241998e-01f,
+  +9.142097557e-01f, +4.052413140e-01f,
+  +9.117060320e-01f, +4.108431711e-01f,
+  +9.091679831e-01f, +4.164295601e-01f,
+  +9.065957045e-01f, +4.220002708e-01f,
+  +9.039892931e-01f, +4.275550934e-01f,
+  +9.013488470e-01f, +4.330938189e-01f,
+  +8.986744657e-01f, +4.386162385e-01f,
+  +8.959662498e-01f, +4.441221446e-01f,
+  +8.932243012e-01f, +4.496113297e-01f,
+  +8.904487232e-01f, +4.550835871e-01f,
+  +8.876396204e-01f, +4.605387110e-01f,
+  +8.847970984e-01f, +4.659764958e-01f,
+  +8.819212643e-01f, +4.713967368e-01f,
+  +8.790122264e-01f, +4.767992301e-01f,
+  +8.760700942e-01f, +4.821837721e-01f,
+  +8.730949784e-01f, +4.875501601e-01f,
+  +8.700869911e-01f, +4.928981922e-01f,
+  +8.670462455e-01f, +4.982276670e-01f,
+  +8.639728561e-01f, +5.035383837e-01f,
+  +8.608669386e-01f, +5.088301425e-01f,
+  +8.577286100e-01f, +5.141027442e-01f,
+  +8.545579884e-01f, +5.193559902e-01f,
+  +8.513551931e-01f, +5.245896827e-01f,
+  +8.481203448e-01f, +5.298036247e-01f,
+  +8.448535652e-01f, +5.349976199e-01f,
+  +8.415549774e-01f, +5.401714727e-01f,
+  +8.382247056e-01f, +5.453249884e-01f,
+  +8.348628750e-01f, +5.504579729e-01f,
+  +8.314696123e-01f, +5.555702330e-01f,
+  +8.280450453e-01f, +5.606615762e-01f,
+  +8.245893028e-01f, +5.657318108e-01f,
+  +8.211025150e-01f, +5.707807459e-01f,
+  +8.175848132e-01f, +5.758081914e-01f,
+  +8.140363297e-01f, +5.808139581e-01f,
+  +8.104571983e-01f, +5.857978575e-01f,
+  +8.068475535e-01f, +5.907597019e-01f,
+  +8.032075315e-01f, +5.956993045e-01f,
+  +7.995372691e-01f, +6.006164794e-01f,
+  +7.958369046e-01f, +6.055110414e-01f,
+  +7.921065773e-01f, +6.103828063e-01f,
+  +7.883464276e-01f, +6.152315906e-01f,
+  +7.845565972e-01f, +6.200572118e-01f,
+  +7.807372286e-01f, +6.248594881e-01f,
+  +7.768884657e-01f, +6.296382389e-01f,
+  +7.730104534e-01f, +6.343932842e-01f,
+  +7.691033376e-01f, +6.391244449e-01f,
+  +7.651672656e-01f, +6.438315429e-01f,
+  +7.612023855e-01f, +6.485144010e-01f,
+  +7.572088465e-01f, +6.531728430e-01f,
+  +7.531867990e-01f, +6.578066933e-01f,
+  +7.491363945e-01f, +6.624157776e-01f,
+  +7.450577854e-01f, +6.669999223e-01f,
+  +7.409511254e-01f, +6.715589548e-01f,
+  +7.368165689e-01f, +6.760927036e-01f,
+  +7.326542717e-01f, +6.806009978e-01f,
+  +7.284643904e-01f, +6.850836678e-01f,
+  +7.242470830e-01f, +6.895405447e-01f,
+  +7.200025080e-01f, +6.939714609e-01f,
+  +7.157308253e-01f, +6.983762494e-01f,
+  +7.114321957e-01f, +7.027547445e-01f,
+  +7.071067812e-01f, +7.071067812e-01f,
+  +7.027547445e-01f, +7.114321957e-01f,
+  +6.983762494e-01f, +7.157308253e-01f,
+  +6.939714609e-01f, +7.200025080e-01f,
+  +6.895405447e-01f, +7.242470830e-01f,
+  +6.850836678e-01f, +7.284643904e-01f,
+  +6.806009978e-01f, +7.326542717e-01f,
+  +6.760927036e-01f, +7.368165689e-01f,
+  +6.715589548e-01f, +7.409511254e-01f,
+  +6.669999223e-01f, +7.450577854e-01f,
+  +6.624157776e-01f, +7.491363945e-01f,
+  +6.578066933e-01f, +7.531867990e-01f,
+  +6.531728430e-01f, +7.572088465e-01f,
+  +6.485144010e-01f, +7.612023855e-01f,
+  +6.438315429e-01f, +7.651672656e-01f,
+  +6.391244449e-01f, +7.691033376e-01f,
+  +6.343932842e-01f, +7.730104534e-01f,
+  +6.296382389e-01f, +7.768884657e-01f,
+  +6.248594881e-01f, +7.807372286e-01f,
+  +6.200572118e-01f, +7.845565972e-01f,
+  +6.152315906e-01f, +7.883464276e-01f,
+  +6.103828063e-01f, +7.921065773e-01f,
+  +6.055110414e-01f, +7.958369046e-01f,
+  +6.006164794e-01f, +7.995372691e-01f,
+  +5.956993045e-01f, +8.032075315e-01f,
+  +5.907597019e-01f, +8.068475535e-01f,
+  +5.857978575e-01f, +8.104571983e-01f,
+  +5.808139581e-01f, +8.140363297e-01f,
+  +5.758081914e-01f, +8.175848132e-01f,
+  +5.707807459e-01f, +8.211025150e-01f,
+  +5.657318108e-01f, +8.245893028e-01f,
+  +5.606615762e-01f, +8.280450453e-01f,
+  +5.555702330e-01f, +8.314696123e-01f,
+  +5.504579729e-01f, +8.348628750e-01f,
+  +5.453249884e-01f, +8.382247056e-01f,
+  +5.401714727e-01f, +8.415549774e-01f,
+  +5.349976199e-01f, +8.448535652e-01f,
+  +5.298036247e-01f, +8.481203448e-01f,
+  +5.245896827e-01f, +8.513551931e-01f,
+  +5.193559902e-01f, +8.545579884e-01f,
+  +5.141027442e-01f, +8.577286100e-01f,
+  +5.088301425e-01f, +8.608669386e-01f,
+  +5.035383837e-01f, +8.639728561e-01f,
+  +4.982276670e-01f, +8.670462455e-01f,
+  +4.928981922e-01f, +8.700869911e-01f,
+  +4.875501601e-01f, +8.730949784e-01f,
+  +4.821837721e-01f, +8.760700942e-01f,
+  +4.767992301e-01f, +8.790122264e-01f,
+  +4.713967368e-01f, +8.819212643e-01f,
+  +4.659764958e-01f, +8.847970984e-01f,
+  +4.605387110e-01f, +8.876396204e-01f,
+  +4.550835871e-01f, +8.904487232e-01f,
+  +4.496113297e-01f, +8.932243012e-01f,
+  +4.441221446e-01f, +8.959662498e-01f,
+  +4.386162385e-01f, +8.986744657e-01f,
+  +4.330938189e-01f, +9.013488470e-01f,
+  +4.275550934e-01f, +9.039892931e-01f,
+  +4.220002708e-01f, +9.065957045e-01f,
+  +4.164295601e-01f, +9.091679831e-01f,
+  +4.108431711e-01f, +9.117060320e-01f,
+  +4.052413140e-01f, +9.142097557e-01f,
+  +3.996241998e-01f, +9.166790599e-01f,
+  +3.939920401e-01f, +9.191138517e-01f,
+  +3.883450467e-01f, +9.215140393e-01f,
+  +3.826834324e-01f, +9.238795325e-01f,
+  +3.770074102e-01f, +9.262102421e-01f,
+  +3.713171940e-01f, +9.285060805e-01f,
+  +3.656129978e-01f, +9.307669611e-01f,
+  +3.598950365e-01f, +9.329927988e-01f,
+  +3.541635254e-01f, +9.351835099e-01f,
+  +3.484186802e-01f, +9.373390119e-01f,
+  +3.426607173e-01f, +9.394592236e-01f,
+  +3.368898534e-01f, +9.415440652e-01f,
+  +3.311063058e-01f, +9.435934582e-01f,
+  +3.253102922e-01f, +9.456073254e-01f,
+  +3.195020308e-01f, +9.475855910e-01f,
+  +3.136817404e-01f, +9.495281806e-01f,
+  +3.078496400e-01f, +9.514350210e-01f,
+  +3.020059493e-01f, +9.533060404e-01f,
+  +2.961508882e-01f, +9.551411683e-01f,
+  +2.902846773e-01f, +9.569403357e-01f,
+  +2.844075372e-01f, +9.587034749e-01f,
+  +2.785196894e-01f, +9.604305194e-01f,
+  +2.726213554e-01f, +9.621214043e-01f,
+  +2.667127575e-01f, +9.637760658e-01f,
+  +2.607941179e-01f, +9.653944417e-01f,
+  +2.548656596e-01f, +9.669764710e-01f,
+  +2.489276057e-01f, +9.685220943e-01f,
+  +2.429801799e-01f, +9.700312532e-01f,
+  +2.370236060e-01f, +9.715038910e-01f,
+  +2.310581083e-01f, +9.729399522e-01f,
+  +2.250839114e-01f, +9.743393828e-01f,
+  +2.191012402e-01f, +9.757021300e-01f,
+  +2.131103199e-01f, +9.770281427e-01f,
+  +2.071113762e-01f, +9.783173707e-01f,
+  +2.011046348e-01f, +9.795697657e-01f,
+  +1.950903220e-01f, +9.807852804e-01f,
+  +1.890686641e-01f, +9.819638691e-01f,
+  +1.830398880e-01f, +9.831054874e-01f,
+  +1.770042204e-01f, +9.842100924e-01f,
+  +1.709618888e-01f, +9.852776424e-01f,
+  +1.649131205e-01f, +9.863080972e-01f,
+  +1.588581433e-01f, +9.873014182e-01f,
+  +1.527971853e-01f, +9.882575677e-01f,
+  +1.467304745e-01f, +9.891765100e-01f,
+  +1.406582393e-01f, +9.900582103e-01f,
+  +1.345807085e-01f, +9.909026354e-01f,
+  +1.284981108e-01f, +9.917097537e-01f,
+  +1.224106752e-01f, +9.924795346e-01f,
+  +1.163186309e-01f, +9.932119492e-01f,
+  +1.102222073e-01f, +9.939069700e-01f,
+  +1.041216339e-01f, +9.945645707e-01f,
+  +9.801714033e-02f, +9.951847267e-01f,
+  +9.190895650e-02f, +9.957674145e-01f,
+  +8.579731234e-02f, +9.963126122e-01f,
+  +7.968243797e-02f, +9.968202993e-01f,
+  +7.356456360e-02f, +9.972904567e-01f,
+  +6.744391956e-02f, +9.977230666e-01f,
+  +6.132073630e-02f, +9.981181129e-01f,
+  +5.519524435e-02f, +9.984755806e-01f,
+  +4.906767433e-02f, +9.987954562e-01f,
+  +4.293825693e-02f, +9.990777278e-01f,
+  +3.680722294e-02f, +9.993223846e-01f,
+  +3.067480318e-02f, +9.995294175e-01f,
+  +2.454122852e-02f, +9.996988187e-01f,
+  +1.840672991e-02f, +9.998305818e-01f,
+  +1.227153829e-02f, +9.999247018e-01f,
+  +6.135884649e-03f, +9.999811753e-01f,
+  +6.123233996e-17f, +1.000000000e+00f,
+  -6.135884649e-03f, +9.999811753e-01f,
+  -1.227153829e-02f, +9.999247018e-01f,
+  -1.840672991e-02f, +9.998305818e-01f,
+  -2.454122852e-02f, +9.996988187e-01f,
+  -3.067480318e-02f, +9.995294175e-01f,
+  -3.680722294e-02f, +9.993223846e-01f,
+  -4.293825693e-02f, +9.990777278e-01f,
+  -4.906767433e-02f, +9.987954562e-01f,
+  -5.519524435e-02f, +9.984755806e-01f,
+  -6.132073630e-02f, +9.981181129e-01f,
+  -6.744391956e-02f, +9.977230666e-01f,
+  -7.356456360e-02f, +9.972904567e-01f,
+  -7.968243797e-02f, +9.968202993e-01f,
+  -8.579731234e-02f, +9.963126122e-01f,
+  -9.190895650e-02f, +9.957674145e-01f,
+  -9.801714033e-02f, +9.951847267e-01f,
+  -1.041216339e-01f, +9.945645707e-01f,
+  -1.102222073e-01f, +9.939069700e-01f,
+  -1.163186309e-01f, +9.932119492e-01f,
+  -1.224106752e-01f, +9.924795346e-01f,
+  -1.284981108e-01f, +9.917097537e-01f,
+  -1.345807085e-01f, +9.909026354e-01f,
+  -1.406582393e-01f, +9.900582103e-01f,
+  -1.467304745e-01f, +9.891765100e-01f,
+  -1.527971853e-01f, +9.882575677e-01f,
+  -1.588581433e-01f, +9.873014182e-01f,
+  -1.649131205e-01f, +9.863080972e-01f,
+  -1.709618888e-01f, +9.852776424e-01f,
+  -1.770042204e-01f, +9.842100924e-01f,
+  -1.830398880e-01f, +9.831054874e-01f,
+  -1.890686641e-01f, +9.819638691e-01f,
+  -1.950903220e-01f, +9.807852804e-01f,
+  -2.011046348e-01f, +9.795697657e-01f,
+  -2.071113762e-01f, +9.783173707e-01f,
+  -2.131103199e-01f, +9.770281427e-01f,
+  -2.191012402e-01f, +9.757021300e-01f,
+  -2.250839114e-01f, +9.743393828e-01f,
+  -2.310581083e-01f, +9.729399522e-01f,
+  -2.370236060e-01f, +9.715038910e-01f,
+  -2.429801799e-01f, +9.700312532e-01f,
+  -2.489276057e-01f, +9.685220943e-01f,
+  -2.548656596e-01f, +9.669764710e-01f,
+  -2.607941179e-01f, +9.653944417e-01f,
+  -2.667127575e-01f, +9.637760658e-01f,
+  -2.726213554e-01f, +9.621214043e-01f,
+  -2.785196894e-01f, +9.604305194e-01f,
+  -2.844075372e-01f, +9.587034749e-01f,
+  -2.902846773e-01f, +9.569403357e-01f,
+  -2.961508882e-01f, +9.551411683e-01f,
+  -3.020059493e-01f, +9.533060404e-01f,
+  -3.078496400e-01f, +9.514350210e-01f,
+  -3.136817404e-01f, +9.495281806e-01f,
+  -3.195020308e-01f, +9.475855910e-01f,
+  -3.253102922e-01f, +9.456073254e-01f,
+  -3.311063058e-01f, +9.435934582e-01f,
+  -3.368898534e-01f, +9.415440652e-01f,
+  -3.426607173e-01f, +9.394592236e-01f,
+  -3.484186802e-01f, +9.373390119e-01f,
+  -3.541635254e-01f, +9.351835099e-01f,
+  -3.598950365e-01f, +9.329927988e-01f,
+  -3.656129978e-01f, +9.307669611e-01f,
+  -3.713171940e-01f, +9.285060805e-01f,
+  -3.770074102e-01f, +9.262102421e-01f,
+  -3.826834324e-01f, +9.238795325e-01f,
+  -3.883450467e-01f, +9.215140393e-01f,
+  -3.939920401e-01f, +9.191138517e-01f,
+  -3.996241998e-01f, +9.166790599e-01f,
+  -4.052413140e-01f, +9.142097557e-01f,
+  -4.108431711e-01f, +9.117060320e-01f,
+  -4.164295601e-01f, +9.091679831e-01f,
+  -4.220002708e-01f, +9.065957045e-01f,
+  -4.275550934e-01f, +9.039892931e-01f,
+  -4.330938189e-01f, +9.013488470e-01f,
+  -4.386162385e-01f, +8.986744657e-01f,
+  -4.441221446e-01f, +8.959662498e-01f,
+  -4.496113297e-01f, +8.932243012e-01f,
+  -4.550835871e-01f, +8.904487232e-01f,
+  -4.605387110e-01f, +8.876396204e-01f,
+  -4.659764958e-01f, +8.847970984e-01f,
+  -4.713967368e-01f, +8.819212643e-01f,
+  -4.767992301e-01f, +8.790122264e-01f,
+  -4.821837721e-01f, +8.760700942e-01f,
+  -4.875501601e-01f, +8.730949784e-01f,
+  -4.928981922e-01f, +8.700869911e-01f,
+  -4.982276670e-01f, +8.670462455e-01f,
+  -5.035383837e-01f, +8.639728561e-01f,
+  -5.088301425e-01f, +8.608669386e-01f,
+  -5.141027442e-01f, +8.577286100e-01f,
+  -5.193559902e-01f, +8.545579884e-01f,
+  -5.245896827e-01f, +8.513551931e-01f,
+  -5.298036247e-01f, +8.481203448e-01f,
+  -5.349976199e-01f, +8.448535652e-01f,
+  -5.401714727e-01f, +8.415549774e-01f,
+  -5.453249884e-01f, +8.382247056e-01f,
+  -5.504579729e-01f, +8.348628750e-01f,
+  -5.555702330e-01f, +8.314696123e-01f,
+  -5.606615762e-01f, +8.280450453e-01f,
+  -5.657318108e-01f, +8.245893028e-01f,
+  -5.707807459e-01f, +8.211025150e-01f,
+  -5.758081914e-01f, +8.175848132e-01f,
+  -5.808139581e-01f, +8.140363297e-01f,
+  -5.857978575e-01f, +8.104571983e-01f,
+  -5.907597019e-01f, +8.068475535e-01f,
+  -5.956993045e-01f, +8.032075315e-01f,
+  -6.006164794e-01f, +7.995372691e-01f,
+  -6.055110414e-01f, +7.958369046e-01f,
+  -6.103828063e-01f, +7.921065773e-01f,
+  -6.152315906e-01f, +7.883464276e-01f,
+  -6.200572118e-01f, +7.845565972e-01f,
+  -6.248594881e-01f, +7.807372286e-01f,
+  -6.296382389e-01f, +7.768884657e-01f,
+  -6.343932842e-01f, +7.730104534e-01f,
+  -6.391244449e-01f, +7.691033376e-01f,
+  -6.438315429e-01f, +7.651672656e-01f,
+  -6.485144010e-01f, +7.612023855e-01f,
+  -6.531728430e-01f, +7.572088465e-01f,
+  -6.578066933e-01f, +7.531867990e-01f,
+  -6.624157776e-01f, +7.491363945e-01f,
+  -6.669999223e-01f, +7.450577854e-01f,
+  -6.715589548e-01f, +7.409511254e-01f,
+  -6.760927036e-01f, +7.368165689e-01f,
+  -6.806009978e-01f, +7.326542717e-01f,
+  -6.850836678e-01f, +7.284643904e-01f,
+  -6.895405447e-01f, +7.242470830e-01f,
+  -6.939714609e-01f, +7.200025080e-01f,
+  -6.983762494e-01f, +7.157308253e-01f,
+  -7.027547445e-01f, +7.114321957e-01f,
+  -7.071067812e-01f, +7.071067812e-01f,
+  -7.114321957e-01f, +7.027547445e-01f,
+  -7.157308253e-01f, +6.983762494e-01f,
+  -7.200025080e-01f, +6.939714609e-01f,
+  -7.242470830e-01f, +6.895405447e-01f,
+  -7.284643904e-01f, +6.850836678e-01f,
+  -7.326542717e-01f, +6.806009978e-01f,
+  -7.368165689e-01f, +6.760927036e-01f,
+  -7.409511254e-01f, +6.715589548e-01f,
+  -7.450577854e-01f, +6.669999223e-01f,
+  -7.491363945e-01f, +6.624157776e-01f,
+  -7.531867990e-01f, +6.578066933e-01f,
+  -7.572088465e-01f, +6.531728430e-01f,
+  -7.612023855e-01f, +6.485144010e-01f,
+  -7.651672656e-01f, +6.438315429e-01f,
+  -7.691033376e-01f, +6.391244449e-01f,
+  -7.730104534e-01f, +6.343932842e-01f,
+  -7.768884657e-01f, +6.296382389e-01f,
+  -7.807372286e-01f, +6.248594881e-01f,
+  -7.845565972e-01f, +6.200572118e-01f,
+  -7.883464276e-01f, +6.152315906e-01f,
+  -7.921065773e-01f, +6.103828063e-01f,
+  -7.958369046e-01f, +6.055110414e-01f,
+  -7.995372691e-01f, +6.006164794e-01f,
+  -8.032075315e-01f, +5.956993045e-01f,
+  -8.068475535e-01f, +5.907597019e-01f,
+  -8.104571983e-01f, +5.857978575e-01f,
+  -8.140363297e-01f, +5.808139581e-01f,
+  -8.175848132e-01f, +5.758081914e-01f,
+  -8.211025150e-01f, +5.707807459e-01f,
+  -8.245893028e-01f, +5.657318108e-01f,
+  -8.280450453e-01f, +5.606615762e-01f,
+  -8.314696123e-01f, +5.555702330e-01f,
+  -8.348628750e-01f, +5.504579729e-01f,
+  -8.382247056e-01f, +5.453249884e-01f,
+  -8.415549774e-01f, +5.401714727e-01f,
+  -8.448535652e-01f, +5.349976199e-01f,
+  -8.481203448e-01f, +5.298036247e-01f,
+  -8.513551931e-01f, +5.245896827e-01f,
+  -8.545579884e-01f, +5.193559902e-01f,
+  -8.577286100e-01f, +5.141027442e-01f,
+  -8.608669386e-01f, +5.088301425e-01f,
+  -8.639728561e-01f, +5.035383837e-01f,
+  -8.670462455e-01f, +4.982276670e-01f,
+  -8.700869911e-01f, +4.928981922e-01f,
+  -8.730949784e-01f, +4.875501601e-01f,
+  -8.760700942e-01f, +4.821837721e-01f,
+  -8.790122264e-01f, +4.767992301e-01f,
+  -8.819212643e-01f, +4.713967368e-01f,
+  -8.847970984e-01f, +4.659764958e-01f,
+  -8.876396204e-01f, +4.605387110e-01f,
+  -8.904487232e-01f, +4.550835871e-01f,
+  -8.932243012e-01f, +4.496113297e-01f,
+  -8.959662498e-01f, +4.441221446e-01f,
+  -8.986744657e-01f, +4.386162385e-01f,
+  -9.013488470e-01f, +4.330938189e-01f,
+  -9.039892931e-01f, +4.275550934e-01f,
+  -9.065957045e-01f, +4.220002708e-01f,
+  -9.091679831e-01f, +4.164295601e-01f,
+  -9.117060320e-01f, +4.108431711e-01f,
+  -9.142097557e-01f, +4.052413140e-01f,
+  -9.166790599e-01f, +3.996241998e-01f,
+  -9.191138517e-01f, +3.939920401e-01f,
+  -9.215140393e-01f, +3.883450467e-01f,
+  -9.238795325e-01f, +3.826834324e-01f,
+  -9.262102421e-01f, +3.770074102e-01f,
+  -9.285060805e-01f, +3.713171940e-01f,
+  -9.307669611e-01f, +3.656129978e-01f,
+  -9.329927988e-01f, +3.598950365e-01f,
+  -9.351835099e-01f, +3.541635254e-01f,
+  -9.373390119e-01f, +3.484186802e-01f,
+  -9.394592236e-01f, +3.426607173e-01f,
+  -9.415440652e-01f, +3.368898534e-01f,
+  -9.435934582e-01f, +3.311063058e-01f,
+  -9.456073254e-01f, +3.253102922e-01f,
+  -9.475855910e-01f, +3.195020308e-01f,
+  -9.495281806e-01f, +3.136817404e-01f,
+  -9.514350210e-01f, +3.078496400e-01f,
+  -9.533060404e-01f, +3.020059493e-01f,
+  -9.551411683e-01f, +2.961508882e-01f,
+  -9.569403357e-01f, +2.902846773e-01f,
+  -9.587034749e-01f, +2.844075372e-01f,
+  -9.604305194e-01f, +2.785196894e-01f,
+  -9.621214043e-01f, +2.726213554e-01f,
+  -9.637760658e-01f, +2.667127575e-01f,
+  -9.653944417e-01f, +2.607941179e-01f,
+  -9.669764710e-01f, +2.548656596e-01f,
+  -9.685220943e-01f, +2.489276057e-01f,
+  -9.700312532e-01f, +2.429801799e-01f,
+  -9.715038910e-01f, +2.370236060e-01f,
+  -9.729399522e-01f, +2.310581083e-01f,
+  -9.743393828e-01f, +2.250839114e-01f,
+  -9.757021300e-01f, +2.191012402e-01f,
+  -9.770281427e-01f, +2.131103199e-01f,
+  -9.783173707e-01f, +2.071113762e-01f,
+  -9.795697657e-01f, +2.011046348e-01f,
+  -9.807852804e-01f, +1.950903220e-01f,
+  -9.819638691e-01f, +1.890686641e-01f,
+  -9.831054874e-01f, +1.830398880e-01f,
+  -9.842100924e-01f, +1.770042204e-01f,
+  -9.852776424e-01f, +1.709618888e-01f,
+  -9.863080972e-01f, +1.649131205e-01f,
+  -9.873014182e-01f, +1.588581433e-01f,
+  -9.882575677e-01f, +1.527971853e-01f,
+  -9.891765100e-01f, +1.467304745e-01f,
+  -9.900582103e-01f, +1.406582393e-01f,
+  -9.909026354e-01f, +1.345807085e-01f,
+  -9.917097537e-01f, +1.284981108e-01f,
+  -9.924795346e-01f, +1.224106752e-01f,
+  -9.932119492e-01f, +1.163186309e-01f,
+  -9.939069700e-01f, +1.102222073e-01f,
+  -9.945645707e-01f, +1.041216339e-01f,
+  -9.951847267e-01f, +9.801714033e-02f,
+  -9.957674145e-01f, +9.190895650e-02f,
+  -9.963126122e-01f, +8.579731234e-02f,
+  -9.968202993e-01f, +7.968243797e-02f,
+  -9.972904567e-01f, +7.356456360e-02f,
+  -9.977230666e-01f, +6.744391956e-02f,
+  -9.981181129e-01f, +6.132073630e-02f,
+  -9.984755806e-01f, +5.519524435e-02f,
+  -9.987954562e-01f, +4.906767433e-02f,
+  -9.990777278e-01f, +4.293825693e-02f,
+  -9.993223846e-01f, +3.680722294e-02f,
+  -9.995294175e-01f, +3.067480318e-02f,
+  -9.996988187e-01f, +2.454122852e-02f,
+  -9.998305818e-01f, +1.840672991e-02f,
+  -9.999247018e-01f, +1.227153829e-02f,
+  -9.999811753e-01f, +6.135884649e-03f,
+  -1.000000000e+00f, +1.224646799e-16f,
+  -9.999811753e-01f, -6.135884649e-03f,
+  -9.999247018e-01f, -1.227153829e-02f,
+  -9.998305818e-01f, -1.840672991e-02f,
+  -9.996988187e-01f, -2.454122852e-02f,
+  -9.995294175e-01f, -3.067480318e-02f,
+  -9.993223846e-01f, -3.680722294e-02f,
+  -9.990777278e-01f, -4.293825693e-02f,
+  -9.987954562e-01f, -4.906767433e-02f,
+  -9.984755806e-01f, -5.519524435e-02f,
+  -9.981181129e-01f, -6.132073630e-02f,
+  -9.977230666e-01f, -6.744391956e-02f,
+  -9.972904567e-01f, -7.356456360e-02f,
+  -9.968202993e-01f, -7.968243797e-02f,
+  -9.963126122e-01f, -8.579731234e-02f,
+  -9.957674145e-01f, -9.190895650e-02f,
+  -9.951847267e-01f, -9.801714033e-02f,
+  -9.945645707e-01f, -1.041216339e-01f,
+  -9.939069700e-01f, -1.102222073e-01f,
+  -9.932119492e-01f, -1.163186309e-01f,
+  -9.924795346e-01f, -1.224106752e-01f,
+  -9.917097537e-01f, -1.284981108e-01f,
+  -9.909026354e-01f, -1.345807085e-01f,
+  -9.900582103e-01f, -1.406582393e-01f,
+  -9.891765100e-01f, -1.467304745e-01f,
+  -9.882575677e-01f, -1.527971853e-01f,
+  -9.873014182e-01f, -1.588581433e-01f,
+  -9.863080972e-01f, -1.649131205e-01f,
+  -9.852776424e-01f, -1.709618888e-01f,
+  -9.842100924e-01f, -1.770042204e-01f,
+  -9.831054874e-01f, -1.830398880e-01f,
+  -9.819638691e-01f, -1.890686641e-01f,
+  -9.807852804e-01f, -1.950903220e-01f,
+  -9.795697657e-01f, -2.011046348e-01f,
+  -9.783173707e-01f, -2.071113762e-01f,
+  -9.770281427e-01f, -2.131103199e-01f,
+  -9.757021300e-01f, -2.191012402e-01f,
+  -9.743393828e-01f, -2.250839114e-01f,
+  -9.729399522e-01f, -2.310581083e-01f,
+  -9.715038910e-01f, -2.370236060e-01f,
+  -9.700312532e-01f, -2.429801799e-01f,
+  -9.685220943e-01f, -2.489276057e-01f,
+  -9.669764710e-01f, -2.548656596e-01f,
+  -9.653944417e-01f, -2.607941179e-01f,
+  -9.637760658e-01f, -2.667127575e-01f,
+  -9.621214043e-01f, -2.726213554e-01f,
+  -9.604305194e-01f, -2.785196894e-01f,
+  -9.587034749e-01f, -2.844075372e-01f,
+  -9.569403357e-01f, -2.902846773e-01f,
+  -9.551411683e-01f, -2.961508882e-01f,
+  -9.533060404e-01f, -3.020059493e-01f,
+  -9.514350210e-01f, -3.078496400e-01f,
+  -9.495281806e-01f, -3.136817404e-01f,
+  -9.475855910e-01f, -3.195020308e-01f,
+  -9.456073254e-01f, -3.253102922e-01f,
+  -9.435934582e-01f, -3.311063058e-01f,
+  -9.415440652e-01f, -3.368898534e-01f,
+  -9.394592236e-01f, -3.426607173e-01f,
+  -9.373390119e-01f, -3.484186802e-01f,
+  -9.351835099e-01f, -3.541635254e-01f,
+  -9.329927988e-01f, -3.598950365e-01f,
+  -9.307669611e-01f, -3.656129978e-01f,
+  -9.285060805e-01f, -3.713171940e-01f,
+  -9.262102421e-01f, -3.770074102e-01f,
+  -9.238795325e-01f, -3.826834324e-01f,
+  -9.215140393e-01f, -3.883450467e-01f,
+  -9.191138517e-01f, -3.939920401e-01f,
+  -9.166790599e-01f, -3.996241998e-01f,
+  -9.142097557e-01f, -4.052413140e-01f,
+  -9.117060320e-01f, -4.108431711e-01f,
+  -9.091679831e-01f, -4.164295601e-01f,
+  -9.065957045e-01f, -4.220002708e-01f,
+  -9.039892931e-01f, -4.275550934e-01f,
+  -9.013488470e-01f, -4.330938189e-01f,
+  -8.986744657e-01f, -4.386162385e-01f,
+  -8.959662498e-01f, -4.441221446e-01f,
+  -8.932243012e-01f, -4.496113297e-01f,
+  -8.904487232e-01f, -4.550835871e-01f,
+  -8.876396204e-01f, -4.605387110e-01f,
+  -8.847970984e-01f, -4.659764958e-01f,
+  -8.819212643e-01f, -4.713967368e-01f,
+  -8.790122264e-01f, -4.767992301e-01f,
+  -8.760700942e-01f, -4.821837721e-01f,
+  -8.730949784e-01f, -4.875501601e-01f,
+  -8.700869911e-01f, -4.928981922e-01f,
+  -8.670462455e-01f, -4.982276670e-01f,
+  -8.639728561e-01f, -5.035383837e-01f,
+  -8.608669386e-01f, -5.088301425e-01f,
+  -8.577286100e-01f, -5.141027442e-01f,
+  -8.545579884e-01f, -5.193559902e-01f,
+  -8.513551931e-01f, -5.245896827e-01f,
+  -8.481203448e-01f, -5.298036247e-01f,
+  -8.448535652e-01f, -5.349976199e-01f,
+  -8.415549774e-01f, -5.401714727e-01f,
+  -8.382247056e-01f, -5.453249884e-01f,
+  -8.348628750e-01f, -5.504579729e-01f,
+  -8.314696123e-01f, -5.555702330e-01f,
+  -8.280450453e-01f, -5.606615762e-01f,
+  -8.245893028e-01f, -5.657318108e-01f,
+  -8.211025150e-01f, -5.707807459e-01f,
+  -8.175848132e-01f, -5.758081914e-01f,
+  -8.140363297e-01f, -5.808139581e-01f,
+  -8.104571983e-01f, -5.857978575e-01f,
+  -8.068475535e-01f, -5.907597019e-01f,
+  -8.032075315e-01f, -5.956993045e-01f,
+  -7.995372691e-01f, -6.006164794e-01f,
+  -7.958369046e-01f, -6.055110414e-01f,
+  -7.921065773e-01f, -6.103828063e-01f,
+  -7.883464276e-01f, -6.152315906e-01f,
+  -7.845565972e-01f, -6.200572118e-01f,
+  -7.807372286e-01f, -6.248594881e-01f,
+  -7.768884657e-01f, -6.296382389e-01f,
+  -7.730104534e-01f, -6.343932842e-01f,
+  -7.691033376e-01f, -6.391244449e-01f,
+  -7.651672656e-01f, -6.438315429e-01f,
+  -7.612023855e-01f, -6.485144010e-01f,
+  -7.572088465e-01f, -6.531728430e-01f,
+  -7.531867990e-01f, -6.578066933e-01f,
+  -7.491363945e-01f, -6.624157776e-01f,
+  -7.450577854e-01f, -6.669999223e-01f,
+  -7.409511254e-01f, -6.715589548e-01f,
+  -7.368165689e-01f, -6.760927036e-01f,
+  -7.326542717e-01f, -6.806009978e-01f,
+  -7.284643904e-01f, -6.850836678e-01f,
+  -7.242470830e-01f, -6.895405447e-01f,
+  -7.200025080e-01f, -6.939714609e-01f,
+  -7.157308253e-01f, -6.983762494e-01f,
+  -7.114321957e-01f, -7.027547445e-01f,
+  -7.071067812e-01f, -7.071067812e-01f,
+  -7.027547445e-01f, -7.114321957e-01f,
+  -6.983762494e-01f, -7.157308253e-01f,
+  -6.939714609e-01f, -7.200025080e-01f,
+  -6.895405447e-01f, -7.242470830e-01f,
+  -6.850836678e-01f, -7.284643904e-01f,
+  -6.806009978e-01f, -7.326542717e-01f,
+  -6.760927036e-01f, -7.368165689e-01f,
+  -6.715589548e-01f, -7.409511254e-01f,
+  -6.669999223e-01f, -7.450577854e-01f,
+  -6.624157776e-01f, -7.491363945e-01f,
+  -6.578066933e-01f, -7.531867990e-01f,
+  -6.531728430e-01f, -7.572088465e-01f,
+  -6.485144010e-01f, -7.612023855e-01f,
+  -6.438315429e-01f, -7.651672656e-01f,
+  -6.391244449e-01f, -7.691033376e-01f,
+  -6.343932842e-01f, -7.730104534e-01f,
+  -6.296382389e-01f, -7.768884657e-01f,
+  -6.248594881e-01f, -7.807372286e-01f,
+  -6.200572118e-01f, -7.845565972e-01f,
+  -6.152315906e-01f, -7.883464276e-01f,
+  -6.103828063e-01f, -7.921065773e-01f,
+  -6.055110414e-01f, -7.958369046e-01f,
+  -6.006164794e-01f, -7.995372691e-01f,
+  -5.956993045e-01f, -8.032075315e-01f,
+  -5.907597019e-01f, -8.068475535e-01f,
+  -5.857978575e-01f, -8.104571983e-01f,
+  -5.808139581e-01f, -8.140363297e-01f,
+  -5.758081914e-01f, -8.175848132e-01f,
+  -5.707807459e-01f, -8.211025150e-01f,
+  -5.657318108e-01f, -8.245893028e-01f,
+  -5.606615762e-01f, -8.280450453e-01f,
+  -5.555702330e-01f, -8.314696123e-01f,
+  -5.504579729e-01f, -8.348628750e-01f,
+  -5.453249884e-01f, -8.382247056e-01f,
+  -5.401714727e-01f, -8.415549774e-01f,
+  -5.349976199e-01f, -8.448535652e-01f,
+  -5.298036247e-01f, -8.481203448e-01f,
+  -5.245896827e-01f, -8.513551931e-01f,
+  -5.193559902e-01f, -8.545579884e-01f,
+  -5.141027442e-01f, -8.577286100e-01f,
+  -5.088301425e-01f, -8.608669386e-01f,
+  -5.035383837e-01f, -8.639728561e-01f,
+  -4.982276670e-01f, -8.670462455e-01f,
+  -4.928981922e-01f, -8.700869911e-01f,
+  -4.875501601e-01f, -8.730949784e-01f,
+  -4.821837721e-01f, -8.760700942e-01f,
+  -4.767992301e-01f, -8.790122264e-01f,
+  -4.713967368e-01f, -8.819212643e-01f,
+  -4.659764958e-01f, -8.847970984e-01f,
+  -4.605387110e-01f, -8.876396204e-01f,
+  -4.550835871e-01f, -8.904487232e-01f,
+  -4.496113297e-01f, -8.932243012e-01f,
+  -4.441221446e-01f, -8.959662498e-01f,
+  -4.386162385e-01f, -8.986744657e-01f,
+  -4.330938189e-01f, -9.013488470e-01f,
+  -4.275550934e-01f, -9.039892931e-01f,
+  -4.220002708e-01f, -9.065957045e-01f,
+  -4.164295601e-01f, -9.091679831e-01f,
+  -4.108431711e-01f, -9.117060320e-01f,
+  -4.052413140e-01f, -9.142097557e-01f,
+  -3.996241998e-01f, -9.166790599e-01f,
+  -3.939920401e-01f, -9.191138517e-01f,
+  -3.883450467e-01f, -9.215140393e-01f,
+  -3.826834324e-01f, -9.238795325e-01f,
+  -3.770074102e-01f, -9.262102421e-01f,
+  -3.713171940e-01f, -9.285060805e-01f,
+  -3.656129978e-01f, -9.307669611e-01f,
+  -3.598950365e-01f, -9.329927988e-01f,
+  -3.541635254e-01f, -9.351835099e-01f,
+  -3.484186802e-01f, -9.373390119e-01f,
+  -3.426607173e-01f, -9.394592236e-01f,
+  -3.368898534e-01f, -9.415440652e-01f,
+  -3.311063058e-01f, -9.435934582e-01f,
+  -3.253102922e-01f, -9.456073254e-01f,
+  -3.195020308e-01f, -9.475855910e-01f,
+  -3.136817404e-01f, -9.495281806e-01f,
+  -3.078496400e-01f, -9.514350210e-01f,
+  -3.020059493e-01f, -9.533060404e-01f,
+  -2.961508882e-01f, -9.551411683e-01f,
+  -2.902846773e-01f, -9.569403357e-01f,
+  -2.844075372e-01f, -9.587034749e-01f,
+  -2.785196894e-01f, -9.604305194e-01f,
+  -2.726213554e-01f, -9.621214043e-01f,
+  -2.667127575e-01f, -9.637760658e-01f,
+  -2.607941179e-01f, -9.653944417e-01f,
+  -2.548656596e-01f, -9.669764710e-01f,
+  -2.489276057e-01f, -9.685220943e-01f,
+  -2.429801799e-01f, -9.700312532e-01f,
+  -2.370236060e-01f, -9.715038910e-01f,
+  -2.310581083e-01f, -9.729399522e-01f,
+  -2.250839114e-01f, -9.743393828e-01f,
+  -2.191012402e-01f, -9.757021300e-01f,
+  -2.131103199e-01f, -9.770281427e-01f,
+  -2.071113762e-01f, -9.783173707e-01f,
+  -2.011046348e-01f, -9.795697657e-01f,
+  -1.950903220e-01f, -9.807852804e-01f,
+  -1.890686641e-01f, -9.819638691e-01f,
+  -1.830398880e-01f, -9.831054874e-01f,
+  -1.770042204e-01f, -9.842100924e-01f,
+  -1.709618888e-01f, -9.852776424e-01f,
+  -1.649131205e-01f, -9.863080972e-01f,
+  -1.588581433e-01f, -9.873014182e-01f,
+  -1.527971853e-01f, -9.882575677e-01f,
+  -1.467304745e-01f, -9.891765100e-01f,
+  -1.406582393e-01f, -9.900582103e-01f,
+  -1.345807085e-01f, -9.909026354e-01f,
+  -1.284981108e-01f, -9.917097537e-01f,
+  -1.224106752e-01f, -9.924795346e-01f,
+  -1.163186309e-01f, -9.932119492e-01f,
+  -1.102222073e-01f, -9.939069700e-01f,
+  -1.041216339e-01f, -9.945645707e-01f,
+  -9.801714033e-02f, -9.951847267e-01f,
+  -9.190895650e-02f, -9.957674145e-01f,
+  -8.579731234e-02f, -9.963126122e-01f,
+  -7.968243797e-02f, -9.968202993e-01f,
+  -7.356456360e-02f, -9.972904567e-01f,
+  -6.744391956e-02f, -9.977230666e-01f,
+  -6.132073630e-02f, -9.981181129e-01f,
+  -5.519524435e-02f, -9.984755806e-01f,
+  -4.906767433e-02f, -9.987954562e-01f,
+  -4.293825693e-02f, -9.990777278e-01f,
+  -3.680722294e-02f, -9.993223846e-01f,
+  -3.067480318e-02f, -9.995294175e-01f,
+  -2.454122852e-02f, -9.996988187e-01f,
+  -1.840672991e-02f, -9.998305818e-01f,
+  -1.227153829e-02f, -9.999247018e-01f,
+  -6.135884649e-03f, -9.999811753e-01f,
+  -1.836970199e-16f, -1.000000000e+00f,
+  +6.135884649e-03f, -9.999811753e-01f,
+  +1.227153829e-02f, -9.999247018e-01f,
+  +1.840672991e-02f, -9.998305818e-01f,
+  +2.454122852e-02f, -9.996988187e-01f,
+  +3.067480318e-02f, -9.995294175e-01f,
+  +3.680722294e-02f, -9.993223846e-01f,
+  +4.293825693e-02f, -9.990777278e-01f,
+  +4.906767433e-02f, -9.987954562e-01f,
+  +5.519524435e-02f, -9.984755806e-01f,
+  +6.132073630e-02f, -9.981181129e-01f,
+  +6.744391956e-02f, -9.977230666e-01f,
+  +7.356456360e-02f, -9.972904567e-01f,
+  +7.968243797e-02f, -9.968202993e-01f,
+  +8.579731234e-02f, -9.963126122e-01f,
+  +9.190895650e-02f, -9.957674145e-01f,
+  +9.801714033e-02f, -9.951847267e-01f,
+  +1.041216339e-01f, -9.945645707e-01f,
+  +1.102222073e-01f, -9.939069700e-01f,
+  +1.163186309e-01f, -9.932119492e-01f,
+  +1.224106752e-01f, -9.924795346e-01f,
+  +1.284981108e-01f, -9.917097537e-01f,
+  +1.345807085e-01f, -9.909026354e-01f,
+  +1.406582393e-01f, -9.900582103e-01f,
+  +1.467304745e-01f, -9.891765100e-01f,
+  +1.527971853e-01f, -9.882575677e-01f,
+  +1.588581433e-01f, -9.873014182e-01f,
+  +1.649131205e-01f, -9.863080972e-01f,
+  +1.709618888e-01f, -9.852776424e-01f,
+  +1.770042204e-01f, -9.842100924e-01f,
+  +1.830398880e-01f, -9.831054874e-01f,
+  +1.890686641e-01f, -9.819638691e-01f,
+  +1.950903220e-01f, -9.807852804e-01f,
+  +2.011046348e-01f, -9.795697657e-01f,
+  +2.071113762e-01f, -9.783173707e-01f,
+  +2.131103199e-01f, -9.770281427e-01f,
+  +2.191012402e-01f, -9.757021300e-01f,
+  +2.250839114e-01f, -9.743393828e-01f,
+  +2.310581083e-01f, -9.729399522e-01f,
+  +2.370236060e-01f, -9.715038910e-01f,
+  +2.429801799e-01f, -9.700312532e-01f,
+  +2.489276057e-01f, -9.685220943e-01f,
+  +2.548656596e-01f, -9.669764710e-01f,
+  +2.607941179e-01f, -9.653944417e-01f,
+  +2.667127575e-01f, -9.637760658e-01f,
+  +2.726213554e-01f, -9.621214043e-01f,
+  +2.785196894e-01f, -9.604305194e-01f,
+  +2.844075372e-01f, -9.587034749e-01f,
+  +2.902846773e-01f, -9.569403357e-01f,
+  +2.961508882e-01f, -9.551411683e-01f,
+  +3.020059493e-01f, -9.533060404e-01f,
+  +3.078496400e-01f, -9.514350210e-01f,
+  +3.136817404e-01f, -9.495281806e-01f,
+  +3.195020308e-01f, -9.475855910e-01f,
+  +3.253102922e-01f, -9.456073254e-01f,
+  +3.311063058e-01f, -9.435934582e-01f,
+  +3.368898534e-01f, -9.415440652e-01f,
+  +3.426607173e-01f, -9.394592236e-01f,
+  +3.484186802e-01f, -9.373390119e-01f,
+  +3.541635254e-01f, -9.351835099e-01f,
+  +3.598950365e-01f, -9.329927988e-01f,
+  +3.656129978e-01f, -9.307669611e-01f,
+  +3.713171940e-01f, -9.285060805e-01f,
+  +3.770074102e-01f, -9.262102421e-01f,
+  +3.826834324e-01f, -9.238795325e-01f,
+  +3.883450467e-01f, -9.215140393e-01f,
+  +3.939920401e-01f, -9.191138517e-01f,
+  +3.996241998e-01f, -9.166790599e-01f,
+  +4.052413140e-01f, -9.142097557e-01f,
+  +4.108431711e-01f, -9.117060320e-01f,
+  +4.164295601e-01f, -9.091679831e-01f,
+  +4.220002708e-01f, -9.065957045e-01f,
+  +4.275550934e-01f, -9.039892931e-01f,
+  +4.330938189e-01f, -9.013488470e-01f,
+  +4.386162385e-01f, -8.986744657e-01f,
+  +4.441221446e-01f, -8.959662498e-01f,
+  +4.496113297e-01f, -8.932243012e-01f,
+  +4.550835871e-01f, -8.904487232e-01f,
+  +4.605387110e-01f, -8.876396204e-01f,
+  +4.659764958e-01f, -8.847970984e-01f,
+  +4.713967368e-01f, -8.819212643e-01f,
+  +4.767992301e-01f, -8.790122264e-01f,
+  +4.821837721e-01f, -8.760700942e-01f,
+  +4.875501601e-01f, -8.730949784e-01f,
+  +4.928981922e-01f, -8.700869911e-01f,
+  +4.982276670e-01f, -8.670462455e-01f,
+  +5.035383837e-01f, -8.639728561e-01f,
+  +5.088301425e-01f, -8.608669386e-01f,
+  +5.141027442e-01f, -8.577286100e-01f,
+  +5.193559902e-01f, -8.545579884e-01f,
+  +5.245896827e-01f, -8.513551931e-01f,
+  +5.298036247e-01f, -8.481203448e-01f,
+  +5.349976199e-01f, -8.448535652e-01f,
+  +5.401714727e-01f, -8.415549774e-01f,
+  +5.453249884e-01f, -8.382247056e-01f,
+  +5.504579729e-01f, -8.348628750e-01f,
+  +5.555702330e-01f, -8.314696123e-01f,
+  +5.606615762e-01f, -8.280450453e-01f,
+  +5.657318108e-01f, -8.245893028e-01f,
+  +5.707807459e-01f, -8.211025150e-01f,
+  +5.758081914e-01f, -8.175848132e-01f,
+  +5.808139581e-01f, -8.140363297e-01f,
+  +5.857978575e-01f, -8.104571983e-01f,
+  +5.907597019e-01f, -8.068475535e-01f,
+  +5.956993045e-01f, -8.032075315e-01f,
+  +6.006164794e-01f, -7.995372691e-01f,
+  +6.055110414e-01f, -7.958369046e-01f,
+  +6.103828063e-01f, -7.921065773e-01f,
+  +6.152315906e-01f, -7.883464276e-01f,
+  +6.200572118e-01f, -7.845565972e-01f,
+  +6.248594881e-01f, -7.807372286e-01f,
+  +6.296382389e-01f, -7.768884657e-01f,
+  +6.343932842e-01f, -7.730104534e-01f,
+  +6.391244449e-01f, -7.691033376e-01f,
+  +6.438315429e-01f, -7.651672656e-01f,
+  +6.485144010e-01f, -7.612023855e-01f,
+  +6.531728430e-01f, -7.572088465e-01f,
+  +6.578066933e-01f, -7.531867990e-01f,
+  +6.624157776e-01f, -7.491363945e-01f,
+  +6.669999223e-01f, -7.450577854e-01f,
+  +6.715589548e-01f, -7.409511254e-01f,
+  +6.760927036e-01f, -7.368165689e-01f,
+  +6.806009978e-01f, -7.326542717e-01f,
+  +6.850836678e-01f, -7.284643904e-01f,
+  +6.895405447e-01f, -7.242470830e-01f,
+  +6.939714609e-01f, -7.200025080e-01f,
+  +6.983762494e-01f, -7.157308253e-01f,
+  +7.027547445e-01f, -7.114321957e-01f,
+  +7.071067812e-01f, -7.071067812e-01f,
+  +7.114321957e-01f, -7.027547445e-01f,
+  +7.157308253e-01f, -6.983762494e-01f,
+  +7.200025080e-01f, -6.939714609e-01f,
+  +7.242470830e-01f, -6.895405447e-01f,
+  +7.284643904e-01f, -6.850836678e-01f,
+  +7.326542717e-01f, -6.806009978e-01f,
+  +7.368165689e-01f, -6.760927036e-01f,
+  +7.409511254e-01f, -6.715589548e-01f,
+  +7.450577854e-01f, -6.669999223e-01f,
+  +7.491363945e-01f, -6.624157776e-01f,
+  +7.531867990e-01f, -6.578066933e-01f,
+  +7.572088465e-01f, -6.531728430e-01f,
+  +7.612023855e-01f, -6.485144010e-01f,
+  +7.651672656e-01f, -6.438315429e-01f,
+  +7.691033376e-01f, -6.391244449e-01f,
+  +7.730104534e-01f, -6.343932842e-01f,
+  +7.768884657e-01f, -6.296382389e-01f,
+  +7.807372286e-01f, -6.248594881e-01f,
+  +7.845565972e-01f, -6.200572118e-01f,
+  +7.883464276e-01f, -6.152315906e-01f,
+  +7.921065773e-01f, -6.103828063e-01f,
+  +7.958369046e-01f, -6.055110414e-01f,
+  +7.995372691e-01f, -6.006164794e-01f,
+  +8.032075315e-01f, -5.956993045e-01f,
+  +8.068475535e-01f, -5.907597019e-01f,
+  +8.104571983e-01f, -5.857978575e-01f,
+  +8.140363297e-01f, -5.808139581e-01f,
+  +8.175848132e-01f, -5.758081914e-01f,
+  +8.211025150e-01f, -5.707807459e-01f,
+  +8.245893028e-01f, -5.657318108e-01f,
+  +8.280450453e-01f, -5.606615762e-01f,
+  +8.314696123e-01f, -5.555702330e-01f,
+  +8.348628750e-01f, -5.504579729e-01f,
+  +8.382247056e-01f, -5.453249884e-01f,
+  +8.415549774e-01f, -5.401714727e-01f,
+  +8.448535652e-01f, -5.349976199e-01f,
+  +8.481203448e-01f, -5.298036247e-01f,
+  +8.513551931e-01f, -5.245896827e-01f,
+  +8.545579884e-01f, -5.193559902e-01f,
+  +8.577286100e-01f, -5.141027442e-01f,
+  +8.608669386e-01f, -5.088301425e-01f,
+  +8.639728561e-01f, -5.035383837e-01f,
+  +8.670462455e-01f, -4.982276670e-01f,
+  +8.700869911e-01f, -4.928981922e-01f,
+  +8.730949784e-01f, -4.875501601e-01f,
+  +8.760700942e-01f, -4.821837721e-01f,
+  +8.790122264e-01f, -4.767992301e-01f,
+  +8.819212643e-01f, -4.713967368e-01f,
+  +8.847970984e-01f, -4.659764958e-01f,
+  +8.876396204e-01f, -4.605387110e-01f,
+  +8.904487232e-01f, -4.550835871e-01f,
+  +8.932243012e-01f, -4.496113297e-01f,
+  +8.959662498e-01f, -4.441221446e-01f,
+  +8.986744657e-01f, -4.386162385e-01f,
+  +9.013488470e-01f, -4.330938189e-01f,
+  +9.039892931e-01f, -4.275550934e-01f,
+  +9.065957045e-01f, -4.220002708e-01f,
+  +9.091679831e-01f, -4.164295601e-01f,
+  +9.117060320e-01f, -4.108431711e-01f,
+  +9.142097557e-01f, -4.052413140e-01f,
+  +9.166790599e-01f, -3.996241998e-01f,
+  +9.191138517e-01f, -3.939920401e-01f,
+  +9.215140393e-01f, -3.883450467e-01f,
+  +9.238795325e-01f, -3.826834324e-01f,
+  +9.262102421e-01f, -3.770074102e-01f,
+  +9.285060805e-01f, -3.713171940e-01f,
+  +9.307669611e-01f, -3.656129978e-01f,
+  +9.329927988e-01f, -3.598950365e-01f,
+  +9.351835099e-01f, -3.541635254e-01f,
+  +9.373390119e-01f, -3.484186802e-01f,
+  +9.394592236e-01f, -3.426607173e-01f,
+  +9.415440652e-01f, -3.368898534e-01f,
+  +9.435934582e-01f, -3.311063058e-01f,
+  +9.456073254e-01f, -3.253102922e-01f,
+  +9.475855910e-01f, -3.195020308e-01f,
+  +9.495281806e-01f, -3.136817404e-01f,
+  +9.514350210e-01f, -3.078496400e-01f,
+  +9.533060404e-01f, -3.020059493e-01f,
+  +9.551411683e-01f, -2.961508882e-01f,
+  +9.569403357e-01f, -2.902846773e-01f,
+  +9.587034749e-01f, -2.844075372e-01f,
+  +9.604305194e-01f, -2.785196894e-01f,
+  +9.621214043e-01f, -2.726213554e-01f,
+  +9.637760658e-01f, -2.667127575e-01f,
+  +9.653944417e-01f, -2.607941179e-01f,
+  +9.669764710e-01f, -2.548656596e-01f,
+  +9.685220943e-01f, -2.489276057e-01f,
+  +9.700312532e-01f, -2.429801799e-01f,
+  +9.715038910e-01f, -2.370236060e-01f,
+  +9.729399522e-01f, -2.310581083e-01f,
+  +9.743393828e-01f, -2.250839114e-01f,
+  +9.757021300e-01f, -2.191012402e-01f,
+  +9.770281427e-01f, -2.131103199e-01f,
+  +9.783173707e-01f, -2.071113762e-01f,
+  +9.795697657e-01f, -2.011046348e-01f,
+  +9.807852804e-01f, -1.950903220e-01f,
+  +9.819638691e-01f, -1.890686641e-01f,
+  +9.831054874e-01f, -1.830398880e-01f,
+  +9.842100924e-01f, -1.770042204e-01f,
+  +9.852776424e-01f, -1.709618888e-01f,
+  +9.863080972e-01f, -1.649131205e-01f,
+  +9.873014182e-01f, -1.588581433e-01f,
+  +9.882575677e-01f, -1.527971853e-01f,
+  +9.891765100e-01f, -1.467304745e-01f,
+  +9.900582103e-01f, -1.406582393e-01f,
+  +9.909026354e-01f, -1.345807085e-01f,
+  +9.917097537e-01f, -1.284981108e-01f,
+  +9.924795346e-01f, -1.224106752e-01f,
+  +9.932119492e-01f, -1.163186309e-01f,
+  +9.939069700e-01f, -1.102222073e-01f,
+  +9.945645707e-01f, -1.041216339e-01f,
+  +9.951847267e-01f, -9.801714033e-02f,
+  +9.957674145e-01f, -9.190895650e-02f,
+  +9.963126122e-01f, -8.579731234e-02f,
+  +9.968202993e-01f, -7.968243797e-02f,
+  +9.972904567e-01f, -7.356456360e-02f,
+  +9.977230666e-01f, -6.744391956e-02f,
+  +9.981181129e-01f, -6.132073630e-02f,
+  +9.984755806e-01f, -5.519524435e-02f,
+  +9.987954562e-01f, -4.906767433e-02f,
+  +9.990777278e-01f, -4.293825693e-02f,
+  +9.993223846e-01f, -3.680722294e-02f,
+  +9.995294175e-01f, -3.067480318e-02f,
+  +9.996988187e-01f, -2.454122852e-02f,
+  +9.998305818e-01f, -1.840672991e-02f,
+  +9.999247018e-01f, -1.227153829e-02f,
+  +9.999811753e-01f, -6.135884649e-03f,
+};
+
+#endif // __FFT_TWIDDLE_H__
@@ -116,7 +116,7 @@ void microphoneTask(void *arg) {
     for (;;) {
         fft_dis_buff = (uint8_t *)heap_caps_malloc(CANVAS_HEIGHT * sizeof(uint8_t), MALLOC_CAP_DEFAULT | MALLOC_CAP_SPIRAM);
         memset(fft_dis_buff, 0, CANVAS_HEIGHT);
-        fft_config_t *real_fft_plan = fft_init(512, FFT_REAL, FFT_FORWARD, NULL, NULL);
+        fft_config_t *real_fft_plan = fft_plan_get(512, FFT_REAL, FFT_FORWARD);
         i2s_read(I2S_NUM_0, (char *)i2s_readraw_buff, 1024, &bytesread, pdMS_TO_TICKS(100));
         buffptr = (int16_t *)i2s_readraw_buff;
         for (uint16_t count_n = 0; count_n < real_fft_plan->size; count_n++) {
@@ -128,7 +128,6 @@ void microphoneTask(void *arg) {
             data = sqrt(real_fft_plan->output[2 * count_n] * real_fft_plan->output[2 * count_n] + real_fft_plan->output[2 * count_n + 1] * real_fft_plan->output[2 * count_n + 1]);
             fft_dis_buff[CANVAS_HEIGHT - count_n]  = map(data, 0, 2000, 0, 256);
         }
-        fft_destroy(real_fft_plan);
         if(xQueueSend(queue, &fft_dis_buff, 0) == pdFAIL) {
             free(fft_dis_buff);
         }
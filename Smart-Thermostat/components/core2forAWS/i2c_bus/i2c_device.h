@@ -7,6 +7,9 @@ extern "C" {
 #include "esp_log.h"
 #include "driver/gpio.h"
 #include "driver/i2c.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
 
 /**
  * @brief Used when the I2C peripheral does not use registers 
@@ -41,6 +44,53 @@ extern "C" {
 typedef void * I2CDevice_t;
 /* @[declare_i2cdevice_t] */
 
+/**
+ * @brief Number of buckets in a device latency histogram.
+ *
+ * Bucket n counts transactions that took from 2^n to 2^(n+1) - 1
+ * microseconds, the last bucket also counts everything slower.
+ */
+#define I2C_LATENCY_BUCKETS 16
+
+/** @brief Queued transaction reads from the device, otherwise it writes. */
+#define I2C_TRANS_READ      (1 << 0)
+/** @brief Keep the command link after completion so a resubmission of the
+ * same descriptor doesn't rebuild it. Free it with i2c_trans_release(). */
+#define I2C_TRANS_KEEP_CMD  (1 << 1)
+
+struct i2c_trans;
+
+/**
+ * @brief Called by the bus owner task when a queued transaction completes.
+ *
+ * Runs in the bus owner task, so it must not block or submit and wait on
+ * the same port.
+ */
+typedef void (*i2c_trans_cb_t)(struct i2c_trans *trans);
+
+/**
+ * @brief A transaction descriptor for the queued I2C engine.
+ *
+ * Zero-initialize it, fill the request fields and pass it to i2c_submit().
+ * The descriptor and its data buffer must stay valid until completion.
+ */
+/* @[declare_i2c_trans_t] */
+typedef struct i2c_trans {
+    I2CDevice_t device;         /**< @brief Device to talk to. */
+    uint32_t reg_addr;          /**< @brief Register address, or I2C_NO_REG. */
+    uint8_t *data;              /**< @brief Buffer to read into or write from. */
+    uint16_t length;            /**< @brief Number of bytes to transfer. */
+    uint8_t flags;              /**< @brief I2C_TRANS_READ, I2C_TRANS_KEEP_CMD. */
+    i2c_trans_cb_t callback;    /**< @brief Called on completion, or NULL. */
+    void *user;                 /**< @brief Free for the callback's use. */
+    TaskHandle_t notify_task;   /**< @brief Given a notification on completion, or NULL. */
+    SemaphoreHandle_t done_sem; /**< @brief Given on completion, or NULL. Set by i2c_transfer(). */
+    esp_err_t err;              /**< @brief Result, valid after completion. */
+    int64_t submit_us;          /**< @brief Set by i2c_submit(). */
+    i2c_cmd_handle_t cmd;       /**< @brief Cached command link, owned by the engine. */
+} i2c_trans_t;
+/* @[declare_i2c_trans_t] */
+
 I2CDevice_t i2c_malloc_device(i2c_port_t i2c_num, gpio_num_t sda, gpio_num_t scl, uint32_t freq, uint8_t device_addr);
 
 void i2c_free_device(I2CDevice_t i2c_device);
@@ -87,6 +137,51 @@ esp_err_t i2c_write_bits(I2CDevice_t i2c_device, uint32_t reg_addr, uint8_t data
 
 esp_err_t i2c_device_valid(I2CDevice_t i2c_device);
 
+/**
+ * @brief Copies the latency histogram of a device.
+ *
+ * Synchronous calls count the time spent on the bus, queued transactions
+ * the time from submission to completion.
+ *
+ * @param[in] i2c_device The device.
+ * @param[out] hist Array of I2C_LATENCY_BUCKETS counters.
+ * @param[in] reset Clear the device histogram after copying it.
+ * @return ESP_OK or ESP_ERR_INVALID_ARG.
+ */
+esp_err_t i2c_device_get_latency(I2CDevice_t i2c_device, uint32_t *hist, bool reset);
+
+/**
+ * @brief Queues a transaction to the bus owner task of the device's port.
+ *
+ * Returns as soon as the descriptor is queued. The bus owner task is
+ * created by the first submission on a port. It runs queued transactions
+ * in batches grouped by bus configuration and reports completion through
+ * `callback`, `notify_task` and `done_sem`.
+ *
+ * @param[in] trans The transaction, must stay valid until completion.
+ * @return ESP_OK if the transaction was queued.
+ */
+esp_err_t i2c_submit(i2c_trans_t *trans);
+
+/**
+ * @brief Queues a transaction and waits for its completion.
+ *
+ * Waits on a semaphore only the bus owner task gives, so notifications
+ * sent to the calling task by anyone else can't end the wait early.
+ *
+ * @param[in] trans The transaction.
+ * @return The transaction result.
+ */
+esp_err_t i2c_transfer(i2c_trans_t *trans);
+
+/**
+ * @brief Frees the command link cached in a descriptor.
+ *
+ * Must be called before changing the request fields of a descriptor
+ * submitted with I2C_TRANS_KEEP_CMD, and before discarding it.
+ */
+void i2c_trans_release(i2c_trans_t *trans);
+
 BaseType_t i2c_take_port(i2c_port_t i2c_num, uint32_t timeout);
 
 BaseType_t i2c_free_port(i2c_port_t i2c_num);
@@ -31,7 +31,8 @@ extern "C" {
  **********************/
 
 void ili9341_init(void);
-void ili9341_flush(lv_disp_drv_t * drv, const lv_area_t * area, lv_color_t * color_map);
+/* Returns the number of command and parameter bytes sent for the area */
+uint32_t ili9341_flush(lv_disp_drv_t * drv, const lv_area_t * area, lv_color_t * color_map);
 void ili9341_sleep_in(void);
 void ili9341_sleep_out(void);
 
@@ -156,7 +156,13 @@ typedef enum {
 	/** Some limit has been exceeded, e.g. the maximum number of subscriptions has been reached */
 			LIMIT_EXCEEDED_ERROR = -51,
 	/** Invalid input topic type */
-			INVALID_TOPIC_TYPE_ERROR = -52
+			INVALID_TOPIC_TYPE_ERROR = -52,
+	/** MQTT: The lane of the publish queue is full, the message was not queued */
+			MQTT_PUBLISH_QUEUE_FULL_ERROR = -53,
+	/** Spool: The record does not fit in the space given to the spool */
+			SPOOL_FULL_ERROR = -54,
+	/** Spool: The storage of the spool could not be opened, read or written */
+			SPOOL_STORAGE_ERROR = -55
 } IoT_Error_t;
 
 #ifdef __cplusplus
@@ -56,6 +56,7 @@ extern "C" {
 /* Platform specific implementation header files */
 #include "network_interface.h"
 #include "timer_interface.h"
+#include "aws_iot_deadline_heap.h"
 
 #ifdef _ENABLE_THREAD_SUPPORT_
 #include "threads_interface.h"
@@ -64,6 +65,26 @@ extern "C" {
 /** Greatest packet identifier, per MQTT spec */
 #define MAX_PACKET_ID 65535
 
+/** Buckets of the hash table holding subscriptions without wildcards */
+#ifndef AWS_IOT_MQTT_SUBSCRIBE_HASH_BUCKETS
+#define AWS_IOT_MQTT_SUBSCRIBE_HASH_BUCKETS ((2 * AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS) + 1)
+#endif
+
+/** Nodes of the trie holding the levels of wildcard subscriptions, root included */
+#ifndef AWS_IOT_MQTT_TOPIC_TRIE_NODES
+#define AWS_IOT_MQTT_TOPIC_TRIE_NODES ((4 * AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS) + 1)
+#endif
+
+/** Greatest number of payload buffers in one vectored publish */
+#ifndef AWS_IOT_MQTT_PUBLISH_MAX_IOVECS
+#define AWS_IOT_MQTT_PUBLISH_MAX_IOVECS 8
+#endif
+
+/** Payload buffers shorter than this are copied next to the publish header rather than written on their own */
+#ifndef AWS_IOT_MQTT_PUBLISH_COPY_THRESHOLD
+#define AWS_IOT_MQTT_PUBLISH_COPY_THRESHOLD 64
+#endif
+
 typedef struct _Client AWS_IoT_Client;
 
 /**
@@ -243,6 +264,42 @@ typedef struct _MessageHandlers {
 	void *pApplicationHandlerData; ///< Context to pass to application handler
 } MessageHandlers;   /* Message handlers are indexed by subscription topic */
 
+/**
+ * @brief Topic Trie Node
+ *
+ * One level of a wildcard topic filter. Children and handlers are chained
+ * through 1-based indexes, 0 ends a chain.
+ *
+ */
+typedef struct _TopicTrieNode {
+	const char *pToken; ///< Level of the topic filter, not NUL terminated
+	uint16_t tokenLen; ///< Length of the level
+	uint8_t kind; ///< Literal level, '+' or '#'
+	uint16_t firstChild; ///< First node one level down
+	uint16_t nextSibling; ///< Next node on the same level
+	uint16_t firstHandler; ///< First message handler whose filter ends at this node
+} TopicTrieNode;
+
+/**
+ * @brief MQTT Subscription Index
+ *
+ * Message handlers compiled for dispatch. Topic filters without wildcards
+ * are found through an open addressing hash table, filters with wildcards
+ * are split into levels and merged into a trie. Filters that fit neither
+ * are matched one by one. Rebuilt whenever the message handlers change.
+ *
+ */
+typedef struct _SubscriptionIndex {
+	uint32_t topicHash[AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS]; ///< Hash of each handler's topic filter
+	uint16_t filterLen[AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS]; ///< Length of each topic filter up to its first NUL
+	uint16_t hashBuckets[AWS_IOT_MQTT_SUBSCRIBE_HASH_BUCKETS]; ///< 1-based handler indexes, 0 for a free bucket
+	TopicTrieNode trieNodes[AWS_IOT_MQTT_TOPIC_TRIE_NODES]; ///< Wildcard filter levels, node 0 is the root
+	uint16_t trieNodeCount; ///< Nodes in use
+	uint16_t nextHandler[AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS]; ///< Handlers ending at the same trie node
+	uint16_t unindexed[AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS]; ///< Handlers matched one by one
+	uint16_t unindexedCount; ///< Entries in unindexed
+} SubscriptionIndex;
+
 /**
  * @brief MQTT Client Status
  *
@@ -256,6 +313,18 @@ typedef struct _ClientStatus {
 	bool isAutoReconnectEnabled; ///< Whether auto-reconnect is enabled for this client
 } ClientStatus;
 
+/**
+ * @brief MQTT Client Connect Timing
+ *
+ * Defining a type for the time spent in the steps of the last connect
+ * Filled in by @ref mqtt_function_get_connect_timing
+ *
+ */
+typedef struct {
+	TLSConnectTiming network; ///< Steps of the TLS connect
+	uint32_t mqttConnect_ms; ///< Time from sending CONNECT until the CONNACK was read
+} IoT_Client_Connect_Timing;
+
 /**
  * @brief MQTT Client Data
  *
@@ -272,6 +341,7 @@ typedef struct _ClientData {
 	uint16_t keepAliveInterval; ///< Maximum interval between control packets
 	uint32_t currentReconnectWaitInterval; ///< Current backoff period for reconnect
 	uint32_t counterNetworkDisconnected; ///< How many times this client detected a disconnection
+	uint32_t connackLatencyMs; ///< Time from sending CONNECT until the CONNACK was read in the last connect
 
 	/* The below values are initialized with the
 	 * lengths of the TX/RX buffers and never modified
@@ -292,6 +362,7 @@ typedef struct _ClientData {
 	IoT_Client_Connect_Params options; ///< Options passed when the client was initialized
 
 	MessageHandlers messageHandlers[AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS]; ///< Callbacks for incoming messages
+	SubscriptionIndex subscriptionIndex; ///< Message handlers compiled for dispatch
 	iot_disconnect_handler disconnectHandler; ///< Callback when a disconnection is detected
 	void *disconnectHandlerData; ///< Context for disconnect handler
 } ClientData;
@@ -306,6 +377,7 @@ struct _Client {
 	Timer pingReqTimer;		///< Timer to keep track of when to send next PINGREQ
 	Timer pingRespTimer;	///< Timer to ensure that PINGRESP is received timely
 	Timer reconnectDelayTimer; ///< Timer for backoff on reconnect
+	AWS_IoT_Deadline_Heap deadlines; ///< The timers above that are running, the yield sleeps until the earliest
 
 	ClientStatus clientStatus; ///< Client state information
 	ClientData clientData; ///< Client context
@@ -322,6 +394,7 @@ struct _Client {
  * @functionpage{aws_iot_mqtt_autoreconnect_set_status,mqtt,autoreconnect_set_status}
  * @functionpage{aws_iot_mqtt_get_network_disconnected_count,mqtt,get_network_disconnected_count}
  * @functionpage{aws_iot_mqtt_reset_network_disconnected_count,mqtt,reset_network_disconnected_count}
+ * @functionpage{aws_iot_mqtt_get_connect_timing,mqtt,get_connect_timing}
  */
 
 /**
@@ -484,6 +557,25 @@ uint32_t aws_iot_mqtt_get_network_disconnected_count(AWS_IoT_Client *pClient);
 void aws_iot_mqtt_reset_network_disconnected_count(AWS_IoT_Client *pClient);
 /* @[declare_mqtt_reset_network_disconnected_count] */
 
+/**
+ * @brief Get the time spent in the steps of the last connect of an MQTT client context.
+ *
+ * Separates the TLS layer steps (loading credentials, TCP, handshake and signing with
+ * the private key) from the MQTT CONNECT round trip. Reconnects done by
+ * @ref mqtt_function_attempt_reconnect and @ref mqtt_function_yield are measured too.
+ *
+ * @param[in] pClient MQTT client context
+ * @param[out] pTiming Filled with the timing of the last successful or failed connect
+ *
+ * @return Returns NULL_VALUE_ERROR if provided a bad parameter; otherwise, always
+ * returns SUCCESS.
+ *
+ * @warning Do not call this function if a connection attempt is in progress.
+ */
+/* @[declare_mqtt_get_connect_timing] */
+IoT_Error_t aws_iot_mqtt_get_connect_timing(AWS_IoT_Client *pClient, IoT_Client_Connect_Timing *pTiming);
+/* @[declare_mqtt_get_connect_timing] */
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,125 @@
+/*
+ * Copyright 2010-2015 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file aws_iot_payload.h
+ * @brief Schema driven payloads in JSON or CBOR
+ *
+ * A schema is a list of jsonStruct_t, the same structs used for shadow documents. It encodes to a JSON object
+ * keyed by pKey, or to a CBOR map (RFC 8949) keyed by the index of the field in the schema. The integer keys keep
+ * the CBOR payload small, and the schema gives the decoder the type of every value, so nothing but the index goes
+ * on the wire. Append new fields at the end of a schema to keep the keys of the existing ones.
+ *
+ * CBOR values are written in their shortest form: integers take 1 to 5 bytes, floats are single precision, doubles
+ * double precision, strings are text strings. The decoder also takes integers for float fields and half, single or
+ * double precision floats. SHADOW_JSON_OBJECT fields are copied verbatim in both directions, so they have to hold
+ * JSON text or an encoded CBOR item to match the format of the topic.
+ *
+ * The format is chosen per topic with AWS_IoT_Payload_Topic, so a device can keep JSON where a service needs it,
+ * like the shadow topics, and send CBOR everywhere else.
+ */
+
+#ifndef AWS_IOT_SDK_SRC_IOT_PAYLOAD_H_
+#define AWS_IOT_SDK_SRC_IOT_PAYLOAD_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "aws_iot_mqtt_client_interface.h"
+#include "aws_iot_shadow_json_data.h"
+
+/** Deepest nesting of arrays and maps the CBOR decoder skips over in an unknown or SHADOW_JSON_OBJECT value */
+#ifndef AWS_IOT_PAYLOAD_CBOR_MAX_DEPTH
+#define AWS_IOT_PAYLOAD_CBOR_MAX_DEPTH 8
+#endif
+
+/**
+ * @brief Encodings of a payload
+ */
+typedef enum {
+	AWS_IOT_PAYLOAD_JSON = 0, ///< JSON object keyed by the pKey of every field
+	AWS_IOT_PAYLOAD_CBOR = 1 ///< CBOR map keyed by the index of every field in the schema
+} AWS_IoT_Payload_Format;
+
+/**
+ * @brief Fields of a payload
+ */
+typedef struct {
+	jsonStruct_t *const *ppFields; ///< Fields in key order, the CBOR key of a field is its index
+	uint8_t fieldCount; ///< Number of entries in ppFields, at most 32
+} AWS_IoT_Payload_Schema;
+
+/**
+ * @brief A topic and the format and schema of its payloads
+ */
+typedef struct {
+	const char *pTopicName; ///< Topic the payloads are published to or received on
+	uint16_t topicNameLen; ///< Length of pTopicName
+	AWS_IoT_Payload_Format format; ///< Encoding of the payloads on this topic
+	const AWS_IoT_Payload_Schema *pSchema; ///< Fields of the payloads on this topic
+} AWS_IoT_Payload_Topic;
+
+/**
+ * @brief Encode the current values of all fields of a schema
+ *
+ * @param format Encoding to use
+ * @param pSchema Fields to encode
+ * @param pBuffer Buffer the payload is written into, a JSON payload is also null terminated
+ * @param bufferSize Size of pBuffer in bytes
+ * @param pLength Set to the length of the payload, without the null terminator of JSON
+ * @return An IoT Error Type, SHADOW_JSON_BUFFER_TRUNCATED if the payload does not fit in pBuffer
+ */
+IoT_Error_t aws_iot_payload_encode(AWS_IoT_Payload_Format format, const AWS_IoT_Payload_Schema *pSchema,
+								   uint8_t *pBuffer, size_t bufferSize, size_t *pLength);
+
+/**
+ * @brief Decode a payload into the fields of a schema
+ *
+ * Every field found in the payload is written to its pData and then its callback, if any, is called with the
+ * encoded value, the JSON text or the CBOR item. Keys not in the schema are skipped. JSON values are parsed like
+ * those of a shadow delta, CBOR values that do not fit the type or size of their field are skipped.
+ *
+ * @param format Encoding of the payload
+ * @param pSchema Fields to decode into
+ * @param pPayload Received payload
+ * @param payloadLen Length of the payload
+ * @param pUpdated Set to a mask of the fields updated, bit n for the field at index n, can be NULL
+ * @return An IoT Error Type, JSON_PARSE_ERROR if the payload is not a JSON object or CBOR map
+ */
+IoT_Error_t aws_iot_payload_decode(AWS_IoT_Payload_Format format, const AWS_IoT_Payload_Schema *pSchema,
+								   const uint8_t *pPayload, size_t payloadLen, uint32_t *pUpdated);
+
+/**
+ * @brief Encode the fields of the schema of a topic in its format and publish them
+ *
+ * @param pClient Connected MQTT client
+ * @param pTopic Topic to publish to
+ * @param qos QoS of the message
+ * @param pBuffer Buffer the payload is encoded in
+ * @param bufferSize Size of pBuffer in bytes
+ * @return An IoT Error Type, the error of encoding or of aws_iot_mqtt_publish
+ */
+IoT_Error_t aws_iot_payload_publish(AWS_IoT_Client *pClient, const AWS_IoT_Payload_Topic *pTopic, QoS qos,
+									uint8_t *pBuffer, size_t bufferSize);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AWS_IOT_SDK_SRC_IOT_PAYLOAD_H_ */
@@ -26,6 +26,7 @@ extern "C" {
  */
 
 #include <stddef.h>
+#include <stdint.h>
 
 /**
  * @brief This is a static JSON object that could be used in code
@@ -143,6 +144,123 @@ IoT_Error_t aws_iot_finalize_json_document(char *pJsonDocument, size_t maxSizeOf
 
 IoT_Error_t aws_iot_fill_with_client_token(char *pBufferToBeUpdatedWithClientToken, size_t maxSizeOfJsonDocument);
 
+/**
+ * @brief Deepest nesting of objects and arrays the JSON writer can track
+ */
+#define SHADOW_JSON_WRITER_MAX_DEPTH 32
+
+/**
+ * @brief Cursor over a JSON document that is being built
+ *
+ * The writer remembers where the document ends, so every value is appended in place without scanning the
+ * buffer again. Numbers are formatted directly into the buffer and produce the same text as the printf
+ * conversions used by aws_iot_shadow_add_reported. The first error is kept in error and turns every later
+ * call into a no-op, so a sequence of calls only needs to check the return value of the last one.
+ */
+typedef struct {
+	char *pBuffer; ///< Buffer the document is written into, always null terminated
+	size_t bufferSize; ///< Size of pBuffer in bytes
+	size_t offset; ///< Length of the document written so far
+	uint8_t depth; ///< Number of objects and arrays currently open
+	uint32_t hasMembers; ///< Bit n is set once the container at depth n holds a member
+	uint32_t isArray; ///< Bit n is set when the container at depth n is an array
+	IoT_Error_t error; ///< First error hit while writing, SUCCESS otherwise
+} ShadowJsonWriter_t;
+
+/**
+ * @brief Start a JSON document in the given buffer
+ *
+ * Nothing is written apart from the null terminator. Open the top level object with
+ * aws_iot_shadow_json_writer_begin_object and a NULL key.
+ *
+ * @param pWriter Writer to initialize
+ * @param pBuffer Buffer the document is written into
+ * @param bufferSize Size of pBuffer in bytes
+ * @return SUCCESS, NULL_VALUE_ERROR if a pointer is NULL or SHADOW_JSON_ERROR if the buffer is empty
+ */
+IoT_Error_t aws_iot_shadow_json_writer_init(ShadowJsonWriter_t *pWriter, char *pBuffer, size_t bufferSize);
+
+/**
+ * @brief Open an object
+ *
+ * @param pWriter Writer of the document
+ * @param pKey Key of the object in the enclosing object, NULL for the top level object and for array elements
+ * @return An IoT Error Type, SHADOW_JSON_BUFFER_TRUNCATED if the buffer is full
+ */
+IoT_Error_t aws_iot_shadow_json_writer_begin_object(ShadowJsonWriter_t *pWriter, const char *pKey);
+
+/**
+ * @brief Close the innermost object
+ *
+ * @param pWriter Writer of the document
+ * @return An IoT Error Type, SHADOW_JSON_ERROR if the innermost container is not an object
+ */
+IoT_Error_t aws_iot_shadow_json_writer_end_object(ShadowJsonWriter_t *pWriter);
+
+/**
+ * @brief Open an array
+ *
+ * @param pWriter Writer of the document
+ * @param pKey Key of the array in the enclosing object, NULL for array elements
+ * @return An IoT Error Type, SHADOW_JSON_BUFFER_TRUNCATED if the buffer is full
+ */
+IoT_Error_t aws_iot_shadow_json_writer_begin_array(ShadowJsonWriter_t *pWriter, const char *pKey);
+
+/**
+ * @brief Close the innermost array
+ *
+ * @param pWriter Writer of the document
+ * @return An IoT Error Type, SHADOW_JSON_ERROR if the innermost container is not an array
+ */
+IoT_Error_t aws_iot_shadow_json_writer_end_array(ShadowJsonWriter_t *pWriter);
+
+/**
+ * @brief Add the key value pair of a jsonStruct_t to the innermost object
+ *
+ * @param pWriter Writer of the document
+ * @param pStruct Key, type and value to add
+ * @return An IoT Error Type, NULL_VALUE_ERROR if the key or the data is NULL
+ */
+IoT_Error_t aws_iot_shadow_json_writer_add(ShadowJsonWriter_t *pWriter, const jsonStruct_t *pStruct);
+
+/**
+ * @brief Add a value without a key, used for array elements
+ *
+ * @param pWriter Writer of the document
+ * @param type Type of the value
+ * @param pData Pointer to the value
+ * @return An IoT Error Type, NULL_VALUE_ERROR if pData is NULL
+ */
+IoT_Error_t aws_iot_shadow_json_writer_add_value(ShadowJsonWriter_t *pWriter, JsonPrimitiveType type,
+												 const void *pData);
+
+/**
+ * @brief Add the key value pair of a jsonStruct_t only if it changed since it was last added
+ *
+ * Used to report only the fields that changed. The value is compared with pLastValue and, when it differs,
+ * added to the document and copied into pLastValue. pLastValue must be able to hold a value of the type of
+ * pStruct, for strings and objects dataLength bytes. If the update is later rejected, reset pLastValue so
+ * the value is reported again.
+ *
+ * @param pWriter Writer of the document
+ * @param pStruct Key, type and value to add
+ * @param pLastValue Copy of the value last added to a document
+ * @return An IoT Error Type, NULL_VALUE_ERROR if a pointer is NULL
+ */
+IoT_Error_t aws_iot_shadow_json_writer_add_if_changed(ShadowJsonWriter_t *pWriter, const jsonStruct_t *pStruct,
+													  void *pLastValue);
+
+/**
+ * @brief Close every open container and add the client token to the top level object
+ *
+ * The document ends the same way as one finished with aws_iot_finalize_json_document and the client token
+ * sequence number is incremented in the same way.
+ *
+ * @param pWriter Writer of the document
+ * @return An IoT Error Type, SHADOW_JSON_ERROR if no object is open
+ */
+IoT_Error_t aws_iot_shadow_json_writer_finalize(ShadowJsonWriter_t *pWriter);
+
 #ifdef __cplusplus
 }
 #endif
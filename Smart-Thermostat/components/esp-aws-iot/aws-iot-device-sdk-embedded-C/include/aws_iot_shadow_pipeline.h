@@ -0,0 +1,151 @@
+/*
+ * Copyright 2010-2015 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#ifndef AWS_IOT_SDK_SRC_IOT_SHADOW_PIPELINE_H_
+#define AWS_IOT_SDK_SRC_IOT_SHADOW_PIPELINE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file aws_iot_shadow_pipeline.h
+ * @brief Pipelined reported state updates for a thing shadow
+ *
+ * aws_iot_shadow_update waits for nothing, but a device that only sends the next update once the previous one
+ * was acknowledged gets one update per round trip. The pipeline keeps up to a window of updates in flight at the
+ * same time. Values are staged with aws_iot_shadow_pipeline_report and sent together by
+ * aws_iot_shadow_pipeline_flush. A value staged again before it was sent replaces the earlier one, so only the
+ * latest value of every key goes out. Acks are matched to their update by client token and feed the in-flight
+ * depth and ack latency metrics.
+ */
+
+#include "aws_iot_shadow_interface.h"
+#include "aws_iot_config.h"
+#include "timer_interface.h"
+
+/**
+ * @brief Number of different keys that can be staged between two flushes
+ */
+#ifndef AWS_IOT_SHADOW_PIPELINE_MAX_FIELDS
+#define AWS_IOT_SHADOW_PIPELINE_MAX_FIELDS 16
+#endif
+
+/**
+ * @brief Counters of a pipeline, read with aws_iot_shadow_pipeline_get_metrics
+ */
+typedef struct {
+	uint32_t sent; ///< Updates published
+	uint32_t accepted; ///< Updates acknowledged on the accepted topic
+	uint32_t rejected; ///< Updates acknowledged on the rejected topic
+	uint32_t timedOut; ///< Updates that got no ack within the timeout
+	uint32_t coalesced; ///< Staged values replaced by a newer value of the same key before they were sent
+	uint8_t inFlight; ///< Updates currently waiting for an ack
+	uint8_t maxInFlight; ///< Highest number of updates that were in flight at the same time
+	uint32_t lastAckLatency_ms; ///< Time between publishing and the ack of the last acknowledged update
+	uint32_t minAckLatency_ms; ///< Shortest ack latency seen
+	uint32_t maxAckLatency_ms; ///< Longest ack latency seen
+	uint64_t totalAckLatency_ms; ///< Sum of the latencies of all accepted and rejected updates
+} ShadowPipelineMetrics_t;
+
+typedef struct ShadowUpdatePipeline ShadowUpdatePipeline_t;
+
+/**
+ * @brief An update in flight, passed as context of its ack callback
+ */
+typedef struct {
+	ShadowUpdatePipeline_t *pPipeline; ///< Pipeline the update belongs to
+	Timer sentTimer; ///< Counts down from the ack timeout since the update was published
+	bool isInFlight; ///< Set while the update waits for its ack
+} ShadowPipelineSlot_t;
+
+/**
+ * @brief State of a pipeline, initialize with aws_iot_shadow_pipeline_init
+ */
+struct ShadowUpdatePipeline {
+	AWS_IoT_Client *pClient; ///< Client the updates are published with
+	const char *pThingName; ///< Thing Name of the updated shadow
+	char *pDocumentBuffer; ///< Buffer the update documents are built in
+	size_t documentBufferSize; ///< Size of pDocumentBuffer in bytes
+	uint8_t window; ///< Maximum number of updates in flight
+	uint8_t timeout_seconds; ///< Time to wait for the ack of an update
+	fpActionCallback_t callback; ///< Called with the ack of every update, can be NULL
+	void *pCallbackContext; ///< Context passed to callback
+	const jsonStruct_t *pStaged[AWS_IOT_SHADOW_PIPELINE_MAX_FIELDS]; ///< Values to send with the next update
+	uint8_t stagedCount; ///< Number of entries in pStaged
+	ShadowPipelineSlot_t slots[MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME]; ///< Updates in flight
+	ShadowPipelineMetrics_t metrics; ///< Counters of the pipeline
+};
+
+/**
+ * @brief Initialize a pipeline of reported state updates
+ *
+ * The acks are handled by aws_iot_shadow_yield like those of aws_iot_shadow_update, and share the
+ * MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME records with every other shadow action.
+ *
+ * @param pPipeline Pipeline to initialize
+ * @param pClient MQTT Client used as the protocol layer, connected with aws_iot_shadow_connect
+ * @param pThingName Thing Name of the shadow to update
+ * @param pDocumentBuffer Buffer the update documents are built in, it is free again once a flush returns
+ * @param documentBufferSize Size of pDocumentBuffer in bytes
+ * @param window Maximum number of updates in flight, between 1 and MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME
+ * @param timeout_seconds Time to wait for the ack of an update before reporting SHADOW_ACK_TIMEOUT
+ * @param callback Called with the ack of every update, can be NULL
+ * @param pCallbackContext Context passed to callback
+ * @return An IoT Error Type, NULL_VALUE_ERROR for a NULL pointer or FAILURE for a window out of range
+ */
+IoT_Error_t aws_iot_shadow_pipeline_init(ShadowUpdatePipeline_t *pPipeline, AWS_IoT_Client *pClient,
+										 const char *pThingName, char *pDocumentBuffer, size_t documentBufferSize,
+										 uint8_t window, uint8_t timeout_seconds, fpActionCallback_t callback,
+										 void *pCallbackContext);
+
+/**
+ * @brief Stage a reported value for the next update
+ *
+ * Only the jsonStruct_t is remembered, its value is read when the update is built. Staging a key that is
+ * already staged replaces the earlier entry and counts as coalesced.
+ *
+ * @param pPipeline Pipeline of the shadow
+ * @param pStruct Key, type and value to report
+ * @return An IoT Error Type, LIMIT_EXCEEDED_ERROR if AWS_IOT_SHADOW_PIPELINE_MAX_FIELDS keys are already staged
+ */
+IoT_Error_t aws_iot_shadow_pipeline_report(ShadowUpdatePipeline_t *pPipeline, const jsonStruct_t *pStruct);
+
+/**
+ * @brief Send the staged values as one update if the window allows it
+ *
+ * When the window is full the values stay staged and SUCCESS is returned, they go out with a later flush once
+ * an ack came in. Nothing is sent when no value is staged.
+ *
+ * @param pPipeline Pipeline of the shadow
+ * @return An IoT Error Type, the error of building or publishing the update otherwise
+ */
+IoT_Error_t aws_iot_shadow_pipeline_flush(ShadowUpdatePipeline_t *pPipeline);
+
+/**
+ * @brief Copy the counters of a pipeline
+ *
+ * @param pPipeline Pipeline of the shadow
+ * @param pMetrics Filled with the counters
+ * @return An IoT Error Type, NULL_VALUE_ERROR for a NULL pointer
+ */
+IoT_Error_t aws_iot_shadow_pipeline_get_metrics(const ShadowUpdatePipeline_t *pPipeline,
+												ShadowPipelineMetrics_t *pMetrics);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AWS_IOT_SDK_SRC_IOT_SHADOW_PIPELINE_H_ */
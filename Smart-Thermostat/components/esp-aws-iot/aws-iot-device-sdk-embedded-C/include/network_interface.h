@@ -41,6 +41,16 @@ extern "C" {
  */
 typedef struct Network Network;
 
+/**
+ * @brief I/O Vector
+ *
+ * One contiguous piece of a message sent with a single gather write.
+ */
+typedef struct {
+	const unsigned char *pBuffer;	///< Bytes to write
+	size_t len;	///< Number of bytes at pBuffer
+} IoT_Iovec;
+
 /**
  * @brief TLS Connection Parameters
  *
@@ -57,6 +67,20 @@ typedef struct {
 	bool ServerVerificationFlag;        ///< Boolean.  True = perform server certificate hostname validation.  False = skip validation \b NOT recommended.
 } TLSConnectParams;
 
+/**
+ * @brief TLS Connect Timing
+ *
+ * Time spent in the steps of the last connect of a network, filled in by the
+ * TLS layer. Steps a platform does not measure stay 0.
+ */
+typedef struct {
+	uint32_t credentials_ms;	///< Loading the root CA, device certificate and private key, 0 when they were kept from an earlier connect
+	uint32_t tcp_ms;	///< Resolving the endpoint and opening the TCP connection
+	uint32_t handshake_ms;	///< TLS handshake, including sign_ms
+	uint32_t sign_ms;	///< Part of the handshake spent signing with the device private key, on the secure element when it holds the key
+	bool isSessionResumed;	///< The handshake resumed an earlier TLS session, the private key was not used
+} TLSConnectTiming;
+
 /**
  * @brief Network Structure
  *
@@ -67,12 +91,15 @@ struct Network {
 
 	IoT_Error_t (*read)(Network *, unsigned char *, size_t, Timer *, size_t *);    ///< Function pointer pointing to the network function to read from the network
 	IoT_Error_t (*write)(Network *, unsigned char *, size_t, Timer *, size_t *);    ///< Function pointer pointing to the network function to write to the network
+	IoT_Error_t (*writev)(Network *, const IoT_Iovec *, size_t, Timer *, size_t *);    ///< Function pointer pointing to the network function to write several buffers to the network, NULL if the platform has none
+	IoT_Error_t (*waitForRead)(Network *, uint32_t);    ///< Function pointer pointing to the network function to block until data can be read, NULL if the platform has none
 	IoT_Error_t (*disconnect)(Network *);    ///< Function pointer pointing to the network function to disconnect from the network
 	IoT_Error_t (*isConnected)(Network *);    ///< Function pointer pointing to the network function to check if TLS is connected
 	IoT_Error_t (*destroy)(Network *);        ///< Function pointer pointing to the network function to destroy the network object
 
 	TLSConnectParams tlsConnectParams;        ///< TLSConnect params structure containing the common connection parameters
 	TLSDataParams tlsDataParams;            ///< TLSData params structure containing the connection data parameters that are specific to the library being used
+	TLSConnectTiming connectTiming;            ///< Time spent in the steps of the last connect
 };
 
 /**
@@ -120,6 +147,21 @@ IoT_Error_t iot_tls_connect(Network *pNetwork, TLSConnectParams *TLSParams);
  */
 IoT_Error_t iot_tls_write(Network *, unsigned char *, size_t, Timer *, size_t *);
 
+/**
+ * @brief Write several buffers to the network socket as one stream
+ *
+ * The buffers are passed to the TLS layer where they are, without being
+ * gathered in an intermediate buffer first.
+ *
+ * @param Network - Pointer to a Network struct defining the network interface.
+ * @param IoT_Iovec pointer - buffers to write, in order
+ * @param size_t - number of buffers
+ * @param Timer * - operation timer
+ * @param size_t - pointer to store the total number of bytes written
+ * @return IoT_Error_t - successful write or TLS error code
+ */
+IoT_Error_t iot_tls_writev(Network *, const IoT_Iovec *, size_t, Timer *, size_t *);
+
 /**
  * @brief Read bytes from the network socket
  *
@@ -132,6 +174,17 @@ IoT_Error_t iot_tls_write(Network *, unsigned char *, size_t, Timer *, size_t *)
  */
 IoT_Error_t iot_tls_read(Network *, unsigned char *, size_t, Timer *, size_t *);
 
+/**
+ * @brief Wait until bytes can be read from the network socket
+ * Blocks on the socket itself instead of polling it with short reads. Bytes
+ * the TLS layer already decrypted but not yet returned count as readable.
+ * @param Network - Pointer to a Network struct defining the network interface.
+ * @param uint32_t - maximum time to wait in milliseconds, 0 only checks
+ * @return IoT_Error_t - SUCCESS if bytes can be read, NETWORK_SSL_NOTHING_TO_READ
+ * when the time ran out or NETWORK_SSL_READ_ERROR if the socket failed
+ */
+IoT_Error_t iot_tls_wait_for_read(Network *pNetwork, uint32_t timeout_ms);
+
 /**
  * @brief Disconnect from network socket
  *
@@ -150,6 +203,18 @@ IoT_Error_t iot_tls_disconnect(Network *pNetwork);
  */
 IoT_Error_t iot_tls_destroy(Network *pNetwork);
 
+/**
+ * @brief Free what the TLS layer keeps across connections
+ *
+ * Platforms may keep the parsed credentials and the TLS session of a network
+ * after iot_tls_destroy to speed up the next connect. Called once the network
+ * is no longer used, after it was disconnected and destroyed.
+ *
+ * @param Network - Pointer to a Network struct defining the network interface
+ * @return IoT_Error_t - successful cleanup or TLS error code
+ */
+IoT_Error_t iot_tls_free_cache(Network *pNetwork);
+
 /**
  * @brief Check if TLS layer is still connected
  *
@@ -25,13 +25,14 @@ extern "C" {
  */
 #include <sys/time.h>
 #include <sys/select.h>
+#include <stdint.h>
 #include "timer_interface.h"
 
 /**
  * definition of the Timer struct. Platform specific
  */
 struct Timer {
-	struct timeval end_time;
+	uint64_t end_us; ///< CLOCK_MONOTONIC time in microseconds at which the timer expires
 };
 
 /**
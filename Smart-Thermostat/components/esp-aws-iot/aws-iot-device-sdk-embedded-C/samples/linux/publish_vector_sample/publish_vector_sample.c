@@ -0,0 +1,306 @@
+/*
+ * Copyright 2010-2015 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file publish_vector_sample.c
+ * @brief Compare the bytes copied by aws_iot_mqtt_publish and aws_iot_mqtt_publish_vector
+ *
+ * This example takes the parameters from the aws_iot_config.h file and establishes a connection to the AWS IoT MQTT Platform.
+ * It publishes the same telemetry message to "sdkTest/vector" with both publish functions.
+ *
+ * The message is a short JSON prefix, a block of samples and a short suffix. aws_iot_mqtt_publish needs them
+ * assembled in one buffer, aws_iot_mqtt_publish_vector takes the three pieces as they are. The network write
+ * functions are wrapped to count the bytes written from the client's TX buffer, which the MQTT layer copied
+ * there, against the bytes written straight from application memory. The copy mbedTLS makes into its record
+ * buffer while encrypting is the same for both and is not counted.
+ *
+ * The application takes in the certificate path, host name, port, the number of publishes and the size of the
+ * sample block. With the default size the message fits in AWS_IOT_MQTT_TX_BUF_LEN, larger sizes show that
+ * neither function is limited by it.
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <limits.h>
+#include <string.h>
+
+#include "aws_iot_config.h"
+#include "aws_iot_log.h"
+#include "aws_iot_version.h"
+#include "aws_iot_mqtt_client_interface.h"
+
+#define HOST_ADDRESS_SIZE 255
+#define PUBLISH_TOPIC "sdkTest/vector"
+#define PUBLISH_TOPIC_LEN 14
+#define MAX_SAMPLE_BLOCK_SIZE 16384
+
+/**
+ * @brief Default cert location
+ */
+static char certDirectory[PATH_MAX + 1] = "../../../certs";
+
+/**
+ * @brief Default MQTT HOST URL is pulled from the aws_iot_config.h
+ */
+static char HostAddress[HOST_ADDRESS_SIZE] = AWS_IOT_MQTT_HOST;
+
+/**
+ * @brief Default MQTT port is pulled from the aws_iot_config.h
+ */
+static uint32_t port = AWS_IOT_MQTT_PORT;
+
+/**
+ * @brief Number of times each publish function is measured
+ */
+static uint32_t publishCount = 10;
+
+/**
+ * @brief Size of the sample block in the middle of the message
+ */
+static size_t sampleBlockSize = 400;
+
+/**
+ * @brief Byte counters filled in by the wrapped network write functions
+ */
+typedef struct {
+	size_t fromTxBuffer;	///< Bytes written from the client's TX buffer
+	size_t inPlace;	///< Bytes written from application memory
+	size_t writeCalls;	///< Calls to the network write functions
+} WriteStats;
+
+static WriteStats writeStats;
+static AWS_IoT_Client client;
+static IoT_Error_t (*tlsWrite)(Network *, unsigned char *, size_t, Timer *, size_t *);
+static IoT_Error_t (*tlsWritev)(Network *, const IoT_Iovec *, size_t, Timer *, size_t *);
+
+static void countBuffer(const unsigned char *pBuffer, size_t len) {
+	const unsigned char *pTxBuffer = client.clientData.writeBuf;
+
+	if(pBuffer >= pTxBuffer && pBuffer < pTxBuffer + client.clientData.writeBufSize) {
+		writeStats.fromTxBuffer += len;
+	} else {
+		writeStats.inPlace += len;
+	}
+}
+
+static IoT_Error_t countingWrite(Network *pNetwork, unsigned char *pMsg, size_t len, Timer *pTimer,
+								 size_t *pWrittenLen) {
+	writeStats.writeCalls++;
+	countBuffer(pMsg, len);
+	return tlsWrite(pNetwork, pMsg, len, pTimer, pWrittenLen);
+}
+
+static IoT_Error_t countingWritev(Network *pNetwork, const IoT_Iovec *pVec, size_t count, Timer *pTimer,
+								  size_t *pWrittenLen) {
+	size_t i;
+
+	writeStats.writeCalls++;
+	for(i = 0; i < count; i++) {
+		countBuffer(pVec[i].pBuffer, pVec[i].len);
+	}
+	return tlsWritev(pNetwork, pVec, count, pTimer, pWrittenLen);
+}
+
+static void parseInputArgsForConnectParams(int argc, char **argv) {
+	int opt;
+
+	while(-1 != (opt = getopt(argc, argv, "h:p:c:x:s:"))) {
+		switch(opt) {
+			case 'h':
+				strncpy(HostAddress, optarg, HOST_ADDRESS_SIZE);
+				IOT_DEBUG("Host %s", optarg);
+				break;
+			case 'p':
+				port = atoi(optarg);
+				IOT_DEBUG("arg %s", optarg);
+				break;
+			case 'c':
+				strncpy(certDirectory, optarg, PATH_MAX + 1);
+				IOT_DEBUG("cert root directory %s", optarg);
+				break;
+			case 'x':
+				publishCount = atoi(optarg);
+				IOT_DEBUG("publish %s times\n", optarg);
+				break;
+			case 's':
+				sampleBlockSize = (size_t) atoi(optarg);
+				if(sampleBlockSize > MAX_SAMPLE_BLOCK_SIZE) {
+					sampleBlockSize = MAX_SAMPLE_BLOCK_SIZE;
+				}
+				IOT_DEBUG("sample block of %u bytes\n", (unsigned int) sampleBlockSize);
+				break;
+			case '?':
+				if(optopt == 'c') {
+					IOT_ERROR("Option -%c requires an argument.", optopt);
+				} else if(isprint(optopt)) {
+					IOT_WARN("Unknown option `-%c'.", optopt);
+				} else {
+					IOT_WARN("Unknown option character `\\x%x'.", optopt);
+				}
+				break;
+			default:
+				IOT_ERROR("Error in command line argument parsing");
+				break;
+		}
+	}
+
+}
+
+static void reportStats(const char *pName, uint32_t count, size_t payloadLen, size_t assembled) {
+	if(0 == count) {
+		return;
+	}
+
+	IOT_INFO("%s: %u byte payload, per publish %u bytes copied (%u assembling the message, %u into the TX buffer), "
+			 "%u bytes written in place, %u network writes",
+			 pName, (unsigned int) payloadLen,
+			 (unsigned int) ((assembled + writeStats.fromTxBuffer) / count),
+			 (unsigned int) (assembled / count), (unsigned int) (writeStats.fromTxBuffer / count),
+			 (unsigned int) (writeStats.inPlace / count), (unsigned int) (writeStats.writeCalls / count));
+}
+
+int main(int argc, char **argv) {
+	char rootCA[PATH_MAX + 1];
+	char clientCRT[PATH_MAX + 1];
+	char clientKey[PATH_MAX + 1];
+	char CurrentWD[PATH_MAX + 1];
+	static char sampleBlock[MAX_SAMPLE_BLOCK_SIZE];
+	static char message[MAX_SAMPLE_BLOCK_SIZE + 64];
+	char prefix[48];
+	const char suffix[] = "\"}";
+
+	size_t i, prefixLen, messageLen, assembled;
+	uint32_t sent;
+
+	IoT_Error_t rc = FAILURE;
+
+	IoT_Client_Init_Params mqttInitParams = iotClientInitParamsDefault;
+	IoT_Client_Connect_Params connectParams = iotClientConnectParamsDefault;
+
+	IoT_Publish_Message_Params paramsQOS0;
+	IoT_Iovec payload[3];
+
+	parseInputArgsForConnectParams(argc, argv);
+
+	IOT_INFO("\nAWS IoT SDK Version %d.%d.%d-%s\n", VERSION_MAJOR, VERSION_MINOR, VERSION_PATCH, VERSION_TAG);
+
+	getcwd(CurrentWD, sizeof(CurrentWD));
+	snprintf(rootCA, PATH_MAX + 1, "%s/%s/%s", CurrentWD, certDirectory, AWS_IOT_ROOT_CA_FILENAME);
+	snprintf(clientCRT, PATH_MAX + 1, "%s/%s/%s", CurrentWD, certDirectory, AWS_IOT_CERTIFICATE_FILENAME);
+	snprintf(clientKey, PATH_MAX + 1, "%s/%s/%s", CurrentWD, certDirectory, AWS_IOT_PRIVATE_KEY_FILENAME);
+
+	IOT_DEBUG("rootCA %s", rootCA);
+	IOT_DEBUG("clientCRT %s", clientCRT);
+	IOT_DEBUG("clientKey %s", clientKey);
+	mqttInitParams.enableAutoReconnect = false;
+	mqttInitParams.pHostURL = HostAddress;
+	mqttInitParams.port = port;
+	mqttInitParams.pRootCALocation = rootCA;
+	mqttInitParams.pDeviceCertLocation = clientCRT;
+	mqttInitParams.pDevicePrivateKeyLocation = clientKey;
+	mqttInitParams.mqttCommandTimeout_ms = 20000;
+	mqttInitParams.tlsHandshakeTimeout_ms = 5000;
+	mqttInitParams.isSSLHostnameVerify = true;
+	mqttInitParams.disconnectHandler = NULL;
+	mqttInitParams.disconnectHandlerData = NULL;
+
+	rc = aws_iot_mqtt_init(&client, &mqttInitParams);
+	if(SUCCESS != rc) {
+		IOT_ERROR("aws_iot_mqtt_init returned error : %d ", rc);
+		return rc;
+	}
+
+	connectParams.keepAliveIntervalInSec = 600;
+	connectParams.isCleanSession = true;
+	connectParams.MQTTVersion = MQTT_3_1_1;
+	connectParams.pClientID = AWS_IOT_MQTT_CLIENT_ID;
+	connectParams.clientIDLen = (uint16_t) strlen(AWS_IOT_MQTT_CLIENT_ID);
+	connectParams.isWillMsgPresent = false;
+
+	IOT_INFO("Connecting...");
+	rc = aws_iot_mqtt_connect(&client, &connectParams);
+	if(SUCCESS != rc) {
+		IOT_ERROR("Error(%d) connecting to %s:%d", rc, mqttInitParams.pHostURL, mqttInitParams.port);
+		return rc;
+	}
+
+	/* Count what the MQTT layer hands to TLS from here on */
+	tlsWrite = client.networkStack.write;
+	tlsWritev = client.networkStack.writev;
+	client.networkStack.write = countingWrite;
+	if(NULL != tlsWritev) {
+		client.networkStack.writev = countingWritev;
+	}
+
+	for(i = 0; i < sampleBlockSize; i++) {
+		sampleBlock[i] = (char) ('A' + (i % 26));
+	}
+
+	paramsQOS0.qos = QOS0;
+	paramsQOS0.isRetained = 0;
+
+	/* Contiguous message for aws_iot_mqtt_publish */
+	memset(&writeStats, 0, sizeof(writeStats));
+	assembled = 0;
+	messageLen = 0;
+	for(sent = 0; sent < publishCount && SUCCESS == rc; sent++) {
+		prefixLen = (size_t) snprintf(prefix, sizeof(prefix), "{\"seq\":%u,\"samples\":\"", (unsigned int) sent);
+		memcpy(message, prefix, prefixLen);
+		memcpy(&message[prefixLen], sampleBlock, sampleBlockSize);
+		memcpy(&message[prefixLen + sampleBlockSize], suffix, sizeof(suffix) - 1);
+		messageLen = prefixLen + sampleBlockSize + sizeof(suffix) - 1;
+		assembled += messageLen;
+
+		paramsQOS0.payload = message;
+		paramsQOS0.payloadLen = messageLen;
+		rc = aws_iot_mqtt_publish(&client, PUBLISH_TOPIC, PUBLISH_TOPIC_LEN, &paramsQOS0);
+	}
+	if(SUCCESS != rc) {
+		IOT_ERROR("aws_iot_mqtt_publish returned error : %d ", rc);
+		return rc;
+	}
+	reportStats("aws_iot_mqtt_publish       ", sent, messageLen, assembled);
+
+	/* The same message as three pieces for aws_iot_mqtt_publish_vector */
+	memset(&writeStats, 0, sizeof(writeStats));
+	for(sent = 0; sent < publishCount && SUCCESS == rc; sent++) {
+		prefixLen = (size_t) snprintf(prefix, sizeof(prefix), "{\"seq\":%u,\"samples\":\"", (unsigned int) sent);
+		payload[0].pBuffer = (const unsigned char *) prefix;
+		payload[0].len = prefixLen;
+		payload[1].pBuffer = (const unsigned char *) sampleBlock;
+		payload[1].len = sampleBlockSize;
+		payload[2].pBuffer = (const unsigned char *) suffix;
+		payload[2].len = sizeof(suffix) - 1;
+		messageLen = prefixLen + sampleBlockSize + sizeof(suffix) - 1;
+
+		rc = aws_iot_mqtt_publish_vector(&client, PUBLISH_TOPIC, PUBLISH_TOPIC_LEN, &paramsQOS0, payload, 3);
+	}
+	if(SUCCESS != rc) {
+		IOT_ERROR("aws_iot_mqtt_publish_vector returned error : %d ", rc);
+		return rc;
+	}
+	reportStats("aws_iot_mqtt_publish_vector", sent, messageLen, 0);
+
+	rc = aws_iot_mqtt_disconnect(&client);
+	if(SUCCESS != rc) {
+		IOT_ERROR("aws_iot_mqtt_disconnect returned error : %d ", rc);
+	} else {
+		IOT_INFO("Publish done\n");
+	}
+
+	return rc;
+}
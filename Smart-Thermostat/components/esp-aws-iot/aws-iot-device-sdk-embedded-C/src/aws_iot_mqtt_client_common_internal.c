@@ -363,6 +363,83 @@ IoT_Error_t aws_iot_mqtt_internal_send_packet(AWS_IoT_Client *pClient, size_t le
 	FUNC_EXIT_RC(rc);
 }
 
+/**
+ * @brief Send an MQTT packet held in several buffers on the network
+ *
+ * The buffers are written in order with the network gather write, or one by
+ * one if the network has none. Unlike aws_iot_mqtt_internal_send_packet the
+ * packet is not limited by the size of the TX buffer.
+ *
+ * @param pClient MQTT client sending the packet
+ * @param pVec Buffers holding the packet, advanced past the bytes written
+ * @param count Number of buffers
+ * @param pTimer Amount of time allowed to send packet
+ *
+ * @return IoT_Error_t of send status
+ */
+IoT_Error_t aws_iot_mqtt_internal_send_packet_vector(AWS_IoT_Client *pClient, IoT_Iovec *pVec, size_t count,
+													 Timer *pTimer) {
+	size_t sentLen;
+	IoT_Error_t rc = FAILURE;
+
+#ifdef _ENABLE_THREAD_SUPPORT_
+	IoT_Error_t threadRc;
+#endif
+
+	FUNC_ENTRY;
+
+	if(NULL == pClient || NULL == pVec || NULL == pTimer) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+#ifdef _ENABLE_THREAD_SUPPORT_
+	threadRc = aws_iot_mqtt_client_lock_mutex(pClient, &(pClient->clientData.tls_write_mutex));
+	if(SUCCESS != threadRc) {
+		FUNC_EXIT_RC(threadRc);
+	}
+#endif
+
+	sentLen = 0;
+
+	for(;;) {
+		/* drop the buffers written so far, the last one may be partly written */
+		while(0 < count && sentLen >= pVec->len) {
+			sentLen -= pVec->len;
+			pVec++;
+			count--;
+		}
+		if(0 == count || has_timer_expired(pTimer)) {
+			break;
+		}
+		pVec->pBuffer += sentLen;
+		pVec->len -= sentLen;
+
+		if(NULL != pClient->networkStack.writev) {
+			rc = pClient->networkStack.writev(&(pClient->networkStack), pVec, count, pTimer, &sentLen);
+		} else {
+			rc = pClient->networkStack.write(&(pClient->networkStack), (unsigned char *) pVec->pBuffer,
+											 pVec->len, pTimer, &sentLen);
+		}
+		if(SUCCESS != rc) {
+			/* there was an error writing the data */
+			break;
+		}
+	}
+
+#ifdef _ENABLE_THREAD_SUPPORT_
+	threadRc = aws_iot_mqtt_client_unlock_mutex(pClient, &(pClient->clientData.tls_write_mutex));
+	if((SUCCESS != threadRc) && ( SUCCESS == rc )) {
+		FUNC_EXIT_RC(threadRc);
+	}
+#endif
+
+	if(0 == count) {
+		FUNC_EXIT_RC(SUCCESS);
+	}
+
+	FUNC_EXIT_RC(rc);
+}
+
 static IoT_Error_t _aws_iot_mqtt_internal_readWrapper( AWS_IoT_Client *pClient, size_t offset, size_t size, Timer *pTimer, size_t * read_len ) {
     IoT_Error_t rc;
     int byteToRead;
@@ -531,10 +608,215 @@ static bool _aws_iot_mqtt_internal_is_topic_matched(char *pTopicFilter, char *pT
 	return (curn == curn_end) && (*curf == '\0');
 }
 
+/** Kinds of topic trie nodes */
+#define TOPIC_TRIE_LITERAL 0
+#define TOPIC_TRIE_PLUS 1
+#define TOPIC_TRIE_HASH 2
+
+/* FNV-1a, the topic is not NUL terminated in the receive buffer */
+static uint32_t _aws_iot_mqtt_internal_topic_hash(const char *pTopic, uint16_t topicLen) {
+	uint32_t hash = 2166136261u;
+	uint16_t i;
+
+	for(i = 0; i < topicLen; i++) {
+		hash ^= (unsigned char) pTopic[i];
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+/* Returns -1 if a wildcard shares its level with other characters or '#' is
+ * not the last level. Such filters are not indexed. */
+static int _aws_iot_mqtt_internal_classify_filter(const char *pFilter, uint16_t filterLen, bool *pHasWildcard) {
+	uint16_t i, levelStart = 0;
+
+	*pHasWildcard = false;
+	for(i = 0; i <= filterLen; i++) {
+		if(i < filterLen && pFilter[i] != '/') {
+			continue;
+		}
+		if(memchr(pFilter + levelStart, '+', i - levelStart) || memchr(pFilter + levelStart, '#', i - levelStart)) {
+			if(i - levelStart != 1 || (pFilter[levelStart] == '#' && i != filterLen)) {
+				return -1;
+			}
+			*pHasWildcard = true;
+		}
+		levelStart = i + 1;
+	}
+
+	return 0;
+}
+
+/* Finds or adds the child of node for one level, returns its index or 0 when out of nodes */
+static uint16_t _aws_iot_mqtt_internal_trie_child(SubscriptionIndex *pIndex, uint16_t node,
+												  const char *pToken, uint16_t tokenLen) {
+	TopicTrieNode *pChild;
+	uint16_t child;
+
+	for(child = pIndex->trieNodes[node].firstChild; 0 != child; child = pIndex->trieNodes[child - 1].nextSibling) {
+		pChild = &pIndex->trieNodes[child - 1];
+		if(pChild->tokenLen == tokenLen && 0 == memcmp(pChild->pToken, pToken, tokenLen)) {
+			return child - 1;
+		}
+	}
+
+	if(AWS_IOT_MQTT_TOPIC_TRIE_NODES <= pIndex->trieNodeCount) {
+		return 0;
+	}
+
+	child = pIndex->trieNodeCount++;
+	pChild = &pIndex->trieNodes[child];
+	pChild->pToken = pToken;
+	pChild->tokenLen = tokenLen;
+	pChild->kind = TOPIC_TRIE_LITERAL;
+	if(1 == tokenLen && '+' == *pToken) {
+		pChild->kind = TOPIC_TRIE_PLUS;
+	} else if(1 == tokenLen && '#' == *pToken) {
+		pChild->kind = TOPIC_TRIE_HASH;
+	}
+	pChild->firstChild = 0;
+	pChild->firstHandler = 0;
+	pChild->nextSibling = pIndex->trieNodes[node].firstChild;
+	pIndex->trieNodes[node].firstChild = (uint16_t) (child + 1);
+
+	return child;
+}
+
+static bool _aws_iot_mqtt_internal_trie_insert(SubscriptionIndex *pIndex, const char *pFilter,
+											   uint16_t filterLen, uint16_t handler) {
+	const char *pLevel = pFilter;
+	const char *pFilterEnd = pFilter + filterLen;
+	const char *pLevelEnd;
+	uint16_t node = 0;
+
+	for(;;) {
+		pLevelEnd = memchr(pLevel, '/', (size_t) (pFilterEnd - pLevel));
+		if(NULL == pLevelEnd) {
+			pLevelEnd = pFilterEnd;
+		}
+		node = _aws_iot_mqtt_internal_trie_child(pIndex, node, pLevel, (uint16_t) (pLevelEnd - pLevel));
+		if(0 == node) {
+			return false;
+		}
+		if(pLevelEnd == pFilterEnd) {
+			break;
+		}
+		pLevel = pLevelEnd + 1;
+	}
+
+	pIndex->nextHandler[handler] = pIndex->trieNodes[node].firstHandler;
+	pIndex->trieNodes[node].firstHandler = (uint16_t) (handler + 1);
+
+	return true;
+}
+
+/**
+ * @brief Compile the message handlers for dispatch
+ *
+ * Called whenever a message handler is added or removed. Subscriptions are
+ * rare next to incoming publishes, so the index is simply rebuilt.
+ *
+ * @param pClient MQTT client
+ */
+void aws_iot_mqtt_internal_index_subscriptions(AWS_IoT_Client *pClient) {
+	SubscriptionIndex *pIndex = &pClient->clientData.subscriptionIndex;
+	MessageHandlers *pHandler;
+	uint32_t bucket;
+	uint16_t itr, filterLen;
+	bool hasWildcard;
+
+	memset(pIndex->hashBuckets, 0, sizeof(pIndex->hashBuckets));
+	memset(&pIndex->trieNodes[0], 0, sizeof(pIndex->trieNodes[0]));
+	pIndex->trieNodeCount = 1;
+	pIndex->unindexedCount = 0;
+
+	for(itr = 0; itr < AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS; ++itr) {
+		pHandler = &pClient->clientData.messageHandlers[itr];
+		if(NULL == pHandler->topicName) {
+			continue;
+		}
+
+		/* Filters padded with NULs up to topicNameLen have always matched on the string alone */
+		filterLen = (uint16_t) strnlen(pHandler->topicName, pHandler->topicNameLen);
+		pIndex->filterLen[itr] = filterLen;
+
+		if(0 != _aws_iot_mqtt_internal_classify_filter(pHandler->topicName, filterLen, &hasWildcard)) {
+			pIndex->unindexed[pIndex->unindexedCount++] = itr;
+		} else if(hasWildcard) {
+			if(!_aws_iot_mqtt_internal_trie_insert(pIndex, pHandler->topicName, filterLen, itr)) {
+				IOT_WARN("Topic trie full, %.*s matched linearly", filterLen, pHandler->topicName);
+				pIndex->unindexed[pIndex->unindexedCount++] = itr;
+			}
+		} else {
+			/* There are more buckets than handlers, a free one is always found */
+			pIndex->topicHash[itr] = _aws_iot_mqtt_internal_topic_hash(pHandler->topicName, filterLen);
+			bucket = pIndex->topicHash[itr] % AWS_IOT_MQTT_SUBSCRIBE_HASH_BUCKETS;
+			while(0 != pIndex->hashBuckets[bucket]) {
+				bucket = (bucket + 1) % AWS_IOT_MQTT_SUBSCRIBE_HASH_BUCKETS;
+			}
+			pIndex->hashBuckets[bucket] = (uint16_t) (itr + 1);
+		}
+	}
+}
+
+static void _aws_iot_mqtt_internal_add_trie_handlers(const SubscriptionIndex *pIndex, uint16_t node,
+													 uint16_t *pMatches, uint16_t *pMatchCount) {
+	uint16_t handler;
+
+	for(handler = pIndex->trieNodes[node].firstHandler; 0 != handler; handler = pIndex->nextHandler[handler - 1]) {
+		pMatches[(*pMatchCount)++] = handler - 1;
+	}
+}
+
+/* Matches the topic levels from pLevel on against the children of node.
+ * '+' and '#' only stand for non-empty levels, like _aws_iot_mqtt_internal_is_topic_matched. */
+static void _aws_iot_mqtt_internal_match_trie(const SubscriptionIndex *pIndex, uint16_t node,
+											  const char *pLevel, const char *pTopicEnd,
+											  uint16_t *pMatches, uint16_t *pMatchCount) {
+	const TopicTrieNode *pChild;
+	const char *pLevelEnd;
+	uint16_t child, levelLen;
+
+	pLevelEnd = memchr(pLevel, '/', (size_t) (pTopicEnd - pLevel));
+	if(NULL == pLevelEnd) {
+		pLevelEnd = pTopicEnd;
+	}
+	levelLen = (uint16_t) (pLevelEnd - pLevel);
+
+	for(child = pIndex->trieNodes[node].firstChild; 0 != child; child = pChild->nextSibling) {
+		pChild = &pIndex->trieNodes[child - 1];
+		if(TOPIC_TRIE_HASH == pChild->kind) {
+			if(0 < levelLen) {
+				_aws_iot_mqtt_internal_add_trie_handlers(pIndex, child - 1, pMatches, pMatchCount);
+			}
+			continue;
+		}
+		if(TOPIC_TRIE_PLUS == pChild->kind) {
+			if(0 == levelLen) {
+				continue;
+			}
+		} else if(pChild->tokenLen != levelLen || 0 != memcmp(pChild->pToken, pLevel, levelLen)) {
+			continue;
+		}
+
+		if(pLevelEnd == pTopicEnd) {
+			_aws_iot_mqtt_internal_add_trie_handlers(pIndex, child - 1, pMatches, pMatchCount);
+		} else {
+			_aws_iot_mqtt_internal_match_trie(pIndex, child - 1, pLevelEnd + 1, pTopicEnd, pMatches, pMatchCount);
+		}
+	}
+}
+
 static IoT_Error_t _aws_iot_mqtt_internal_deliver_message(AWS_IoT_Client *pClient, char *pTopicName,
 														  uint16_t topicNameLen,
 														  IoT_Publish_Message_Params *pMessageParams) {
-	uint32_t itr;
+	const SubscriptionIndex *pIndex = &pClient->clientData.subscriptionIndex;
+	MessageHandlers *pHandler;
+	uint16_t matches[AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS];
+	uint16_t matchCount = 0;
+	uint16_t handler, itr, pos;
+	uint32_t hash, bucket;
 	IoT_Error_t rc;
 	ClientState clientState;
 
@@ -550,20 +832,42 @@ static IoT_Error_t _aws_iot_mqtt_internal_deliver_message(AWS_IoT_Client *pClien
 	clientState = aws_iot_mqtt_get_client_state(pClient);
 	aws_iot_mqtt_set_client_state(pClient, clientState, CLIENT_STATE_CONNECTED_WAIT_FOR_CB_RETURN);
 
-	/* Find the right message handler - indexed by topic */
-	for(itr = 0; itr < AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS; ++itr) {
-		if(NULL != pClient->clientData.messageHandlers[itr].topicName) {
-			if(((topicNameLen == pClient->clientData.messageHandlers[itr].topicNameLen)
-				&&
-				(strncmp(pTopicName, (char *) pClient->clientData.messageHandlers[itr].topicName, topicNameLen) == 0))
-			   || _aws_iot_mqtt_internal_is_topic_matched((char *) pClient->clientData.messageHandlers[itr].topicName,
-														  pTopicName, topicNameLen)) {
-				if(NULL != pClient->clientData.messageHandlers[itr].pApplicationHandler) {
-					pClient->clientData.messageHandlers[itr].pApplicationHandler(pClient, pTopicName, topicNameLen,
-																				 pMessageParams,
-																				 pClient->clientData.messageHandlers[itr].pApplicationHandlerData);
-				}
-			}
+	/* Find the right message handlers - exact topics first */
+	hash = _aws_iot_mqtt_internal_topic_hash(pTopicName, topicNameLen);
+	bucket = hash % AWS_IOT_MQTT_SUBSCRIBE_HASH_BUCKETS;
+	while(0 != (handler = pIndex->hashBuckets[bucket])) {
+		pHandler = &pClient->clientData.messageHandlers[handler - 1];
+		if(pIndex->topicHash[handler - 1] == hash && pIndex->filterLen[handler - 1] == topicNameLen
+		   && 0 == memcmp(pHandler->topicName, pTopicName, topicNameLen)) {
+			matches[matchCount++] = handler - 1;
+		}
+		bucket = (bucket + 1) % AWS_IOT_MQTT_SUBSCRIBE_HASH_BUCKETS;
+	}
+
+	_aws_iot_mqtt_internal_match_trie(pIndex, 0, pTopicName, pTopicName + topicNameLen, matches, &matchCount);
+
+	for(itr = 0; itr < pIndex->unindexedCount; ++itr) {
+		pHandler = &pClient->clientData.messageHandlers[pIndex->unindexed[itr]];
+		if(((topicNameLen == pHandler->topicNameLen) && (strncmp(pTopicName, pHandler->topicName, topicNameLen) == 0))
+		   || _aws_iot_mqtt_internal_is_topic_matched((char *) pHandler->topicName, pTopicName, topicNameLen)) {
+			matches[matchCount++] = pIndex->unindexed[itr];
+		}
+	}
+
+	/* Keep calling handlers in subscription slot order. Only a few match. */
+	for(itr = 1; itr < matchCount; ++itr) {
+		handler = matches[itr];
+		for(pos = itr; 0 < pos && matches[pos - 1] > handler; --pos) {
+			matches[pos] = matches[pos - 1];
+		}
+		matches[pos] = handler;
+	}
+
+	for(itr = 0; itr < matchCount; ++itr) {
+		pHandler = &pClient->clientData.messageHandlers[matches[itr]];
+		if(NULL != pHandler->topicName && NULL != pHandler->pApplicationHandler) {
+			pHandler->pApplicationHandler(pClient, pTopicName, topicNameLen, pMessageParams,
+										  pHandler->pApplicationHandlerData);
 		}
 	}
 	rc = aws_iot_mqtt_set_client_state(pClient, CLIENT_STATE_CONNECTED_WAIT_FOR_CB_RETURN, clientState);
@@ -687,6 +991,7 @@ IoT_Error_t aws_iot_mqtt_internal_cycle_read(AWS_IoT_Client *pClient, Timer *pTi
 		case PINGRESP: {
 			/* There is no outstanding ping request anymore. */
 			pClient->clientStatus.isPingOutstanding = false;
+			aws_iot_deadline_heap_cancel(&(pClient->deadlines), &(pClient->pingRespTimer));
 			break;
 		}
 		default: {
@@ -348,6 +348,7 @@ static IoT_Error_t _aws_iot_mqtt_internal_connect(AWS_IoT_Client *pClient, const
 		}
 	}
 
+	pClient->clientData.connackLatencyMs = 0;
 	rc = pClient->networkStack.connect(&(pClient->networkStack), NULL);
 	if(SUCCESS != rc) {
 		/* TLS Connect failed, return error */
@@ -375,6 +376,7 @@ static IoT_Error_t _aws_iot_mqtt_internal_connect(AWS_IoT_Client *pClient, const
 	if(SUCCESS != rc) {
 		FUNC_EXIT_RC(rc);
 	}
+	pClient->clientData.connackLatencyMs = pClient->clientData.commandTimeoutMs - left_ms(&connect_timer);
 
 	/* Received CONNACK, check the return code */
 	rc = _aws_iot_mqtt_deserialize_connack((unsigned char *) &sessionPresent, &connack_rc, pClient->clientData.readBuf,
@@ -390,6 +392,11 @@ static IoT_Error_t _aws_iot_mqtt_internal_connect(AWS_IoT_Client *pClient, const
 	/* Ensure that a ping request is sent after keepAliveInterval. */
 	pClient->clientStatus.isPingOutstanding = false;
 	countdown_sec(&pClient->pingReqTimer, pClient->clientData.keepAliveInterval);
+	aws_iot_deadline_heap_cancel(&(pClient->deadlines), &(pClient->pingRespTimer));
+	aws_iot_deadline_heap_cancel(&(pClient->deadlines), &(pClient->reconnectDelayTimer));
+	if(0 != pClient->clientData.keepAliveInterval) {
+		(void) aws_iot_deadline_heap_schedule(&(pClient->deadlines), &(pClient->pingReqTimer));
+	}
 
 	FUNC_EXIT_RC(SUCCESS);
 }
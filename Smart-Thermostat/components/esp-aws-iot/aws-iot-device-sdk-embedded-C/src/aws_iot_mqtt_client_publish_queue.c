@@ -0,0 +1,258 @@
+/*
+ * Copyright 2010-2015 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file aws_iot_mqtt_client_publish_queue.c
+ * @brief Publish queue drained by a single network task
+ *
+ * The lanes are bounded multi-producer rings. Every cell carries a sequence number: a producer owns the cell
+ * at position pos once it moved enqueuePosition from pos to pos + 1, and hands the message over by setting
+ * the sequence to pos + 1. The network task gives the cell back by setting it to pos + the ring length.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <string.h>
+
+#include "aws_iot_mqtt_client_publish_queue.h"
+#include "aws_iot_mqtt_client_common_internal.h"
+
+#define PUBLISH_QUEUE_INDEX_MASK (AWS_IOT_MQTT_PUBLISH_QUEUE_LENGTH - 1)
+
+#if (AWS_IOT_MQTT_PUBLISH_QUEUE_LENGTH & PUBLISH_QUEUE_INDEX_MASK) != 0
+#error "AWS_IOT_MQTT_PUBLISH_QUEUE_LENGTH must be a power of two"
+#endif
+
+IoT_Error_t aws_iot_mqtt_publish_queue_init(AWS_IoT_Publish_Queue *pQueue) {
+	uint32_t lane, i;
+
+	if(NULL == pQueue) {
+		return NULL_VALUE_ERROR;
+	}
+
+	memset(pQueue, 0, sizeof(AWS_IoT_Publish_Queue));
+	for(lane = 0; lane < PUBLISH_QUEUE_LANE_COUNT; lane++) {
+		for(i = 0; i < AWS_IOT_MQTT_PUBLISH_QUEUE_LENGTH; i++) {
+			pQueue->lanes[lane].cells[i].sequence = i;
+		}
+	}
+
+	return SUCCESS;
+}
+
+IoT_Error_t aws_iot_mqtt_publish_queue_add(AWS_IoT_Publish_Queue *pQueue, IoT_Publish_Queue_Lane lane,
+										   const char *pTopicName, uint16_t topicNameLen,
+										   const IoT_Publish_Message_Params *pParams,
+										   pPublishCompletionHandler completionHandler,
+										   void *pCompletionHandlerData) {
+	IoT_Publish_Queue_Ring *pRing;
+	IoT_Publish_Queue_Cell *pCell;
+	uint32_t remainingLen, headerLen, position, sequence;
+	IoT_Error_t rc;
+
+	if(NULL == pQueue || NULL == pTopicName || 0 == topicNameLen || NULL == pParams
+	   || (NULL == pParams->payload && 0 < pParams->payloadLen)) {
+		return NULL_VALUE_ERROR;
+	}
+
+	if(PUBLISH_QUEUE_LANE_COUNT <= (uint32_t) lane || QOS1 < pParams->qos) {
+		return FAILURE;
+	}
+
+	/* Checked before a cell is claimed, a claimed cell must be handed over */
+	remainingLen = (uint32_t) topicNameLen + 2 + (QOS1 == pParams->qos ? 2 : 0);
+	if(pParams->payloadLen > AWS_IOT_MQTT_PUBLISH_QUEUE_PACKET_LEN
+	   || aws_iot_mqtt_internal_get_final_packet_length_from_remaining_length(
+			   remainingLen + (uint32_t) pParams->payloadLen) > AWS_IOT_MQTT_PUBLISH_QUEUE_PACKET_LEN) {
+		return MQTT_TX_BUFFER_TOO_SHORT_ERROR;
+	}
+
+	pRing = &(pQueue->lanes[lane]);
+	position = __atomic_load_n(&(pRing->enqueuePosition), __ATOMIC_RELAXED);
+	for(;;) {
+		pCell = &(pRing->cells[position & PUBLISH_QUEUE_INDEX_MASK]);
+		sequence = __atomic_load_n(&(pCell->sequence), __ATOMIC_ACQUIRE);
+		if(sequence == position) {
+			// On failure position is reloaded with the value another producer moved it to
+			if(__atomic_compare_exchange_n(&(pRing->enqueuePosition), &position, position + 1, true,
+										   __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+				break;
+			}
+		} else if((int32_t) (sequence - position) < 0) {
+			// The cell still holds the message from one lap earlier
+			__atomic_fetch_add(&(pQueue->refusedCount), 1, __ATOMIC_RELAXED);
+			return MQTT_PUBLISH_QUEUE_FULL_ERROR;
+		} else {
+			position = __atomic_load_n(&(pRing->enqueuePosition), __ATOMIC_RELAXED);
+		}
+	}
+
+	rc = aws_iot_mqtt_internal_serialize_publish_header(pCell->packet, AWS_IOT_MQTT_PUBLISH_QUEUE_PACKET_LEN, 0,
+														pParams->qos, pParams->isRetained, 0, pTopicName,
+														topicNameLen, pParams->payloadLen, &headerLen);
+	if(SUCCESS == rc) {
+		memcpy(&(pCell->packet[headerLen]), pParams->payload, pParams->payloadLen);
+		pCell->packetLen = headerLen + (uint32_t) pParams->payloadLen;
+		pCell->packetIdOffset = (QOS1 == pParams->qos) ? headerLen - 2 : 0;
+	} else {
+		// Not expected after the length check, the empty packet is completed with FAILURE
+		pCell->packetLen = 0;
+		pCell->packetIdOffset = 0;
+	}
+	pCell->completionHandler = completionHandler;
+	pCell->pCompletionHandlerData = pCompletionHandlerData;
+
+	__atomic_store_n(&(pCell->sequence), position + 1, __ATOMIC_RELEASE);
+
+	return rc;
+}
+
+/**
+ * Sends a queued packet like aws_iot_mqtt_publish sends one it serialized itself.
+ */
+static IoT_Error_t _aws_iot_mqtt_publish_queue_send(AWS_IoT_Client *pClient, IoT_Publish_Queue_Cell *pCell) {
+	Timer timer;
+	IoT_Iovec packet;
+	unsigned char *ptr;
+	uint16_t packet_id;
+	unsigned char dup, type;
+	IoT_Error_t rc, pubRc;
+
+	FUNC_ENTRY;
+
+	if(0 == pCell->packetLen) {
+		FUNC_EXIT_RC(FAILURE);
+	}
+
+	rc = aws_iot_mqtt_set_client_state(pClient, CLIENT_STATE_CONNECTED_IDLE,
+									   CLIENT_STATE_CONNECTED_PUBLISH_IN_PROGRESS);
+	if(SUCCESS != rc) {
+		FUNC_EXIT_RC(rc);
+	}
+
+	init_timer(&timer);
+	countdown_ms(&timer, pClient->clientData.commandTimeoutMs);
+
+	if(0 != pCell->packetIdOffset) {
+		ptr = &(pCell->packet[pCell->packetIdOffset]);
+		aws_iot_mqtt_internal_write_uint_16(&ptr, aws_iot_mqtt_get_next_packet_id(pClient));
+	}
+
+	packet.pBuffer = pCell->packet;
+	packet.len = pCell->packetLen;
+	pubRc = aws_iot_mqtt_internal_send_packet_vector(pClient, &packet, 1, &timer);
+
+	if(SUCCESS == pubRc && 0 != pCell->packetIdOffset) {
+		pubRc = aws_iot_mqtt_internal_wait_for_read(pClient, PUBACK, &timer);
+		if(SUCCESS == pubRc) {
+			pubRc = aws_iot_mqtt_internal_deserialize_ack(&type, &dup, &packet_id, pClient->clientData.readBuf,
+														  pClient->clientData.readBufSize);
+		}
+	}
+
+	rc = aws_iot_mqtt_set_client_state(pClient, CLIENT_STATE_CONNECTED_PUBLISH_IN_PROGRESS,
+									   CLIENT_STATE_CONNECTED_IDLE);
+	if(SUCCESS == pubRc && SUCCESS != rc) {
+		pubRc = rc;
+	}
+
+	FUNC_EXIT_RC(pubRc);
+}
+
+/**
+ * Sends the oldest message of the highest priority lane that has one.
+ *
+ * @return true if a message was taken from the queue
+ */
+static bool _aws_iot_mqtt_publish_queue_send_next(AWS_IoT_Client *pClient, AWS_IoT_Publish_Queue *pQueue) {
+	IoT_Publish_Queue_Ring *pRing;
+	IoT_Publish_Queue_Cell *pCell;
+	pPublishCompletionHandler completionHandler;
+	void *pCompletionHandlerData;
+	uint32_t lane, position;
+	IoT_Error_t rc;
+
+	for(lane = 0; lane < PUBLISH_QUEUE_LANE_COUNT; lane++) {
+		pRing = &(pQueue->lanes[lane]);
+		position = pRing->dequeuePosition;
+		pCell = &(pRing->cells[position & PUBLISH_QUEUE_INDEX_MASK]);
+		if(__atomic_load_n(&(pCell->sequence), __ATOMIC_ACQUIRE) != position + 1) {
+			continue;
+		}
+
+		rc = _aws_iot_mqtt_publish_queue_send(pClient, pCell);
+		completionHandler = pCell->completionHandler;
+		pCompletionHandlerData = pCell->pCompletionHandlerData;
+
+		// Give the cell back before the handler runs so the handler can queue the next message
+		pRing->dequeuePosition = position + 1;
+		__atomic_store_n(&(pCell->sequence), position + AWS_IOT_MQTT_PUBLISH_QUEUE_LENGTH, __ATOMIC_RELEASE);
+
+		if(NULL != completionHandler) {
+			completionHandler(pClient, rc, pCompletionHandlerData);
+		}
+		return true;
+	}
+
+	return false;
+}
+
+IoT_Error_t aws_iot_mqtt_publish_queue_run(AWS_IoT_Client *pClient, AWS_IoT_Publish_Queue *pQueue,
+										   uint32_t timeout_ms) {
+	Timer timer;
+	uint32_t yield_ms;
+	IoT_Error_t rc = SUCCESS;
+
+	FUNC_ENTRY;
+
+	if(NULL == pClient || NULL == pQueue || 0 == timeout_ms) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	init_timer(&timer);
+	countdown_ms(&timer, timeout_ms);
+
+	// evaluate timeout at the end of the loop to make sure the queue is looked at least once
+	do {
+		while(aws_iot_mqtt_is_client_connected(pClient)
+			  && CLIENT_STATE_CONNECTED_IDLE == aws_iot_mqtt_get_client_state(pClient)
+			  && _aws_iot_mqtt_publish_queue_send_next(pClient, pQueue)) {
+			if(has_timer_expired(&timer)) {
+				FUNC_EXIT_RC(SUCCESS);
+			}
+		}
+
+		yield_ms = left_ms(&timer);
+		if(AWS_IOT_MQTT_PUBLISH_QUEUE_YIELD_MS < yield_ms) {
+			yield_ms = AWS_IOT_MQTT_PUBLISH_QUEUE_YIELD_MS;
+		} else if(0 == yield_ms) {
+			yield_ms = 1;
+		}
+
+		rc = aws_iot_mqtt_yield(pClient, yield_ms);
+		if(SUCCESS != rc && NETWORK_RECONNECTED != rc) {
+			break;
+		}
+		rc = SUCCESS;
+	} while(!has_timer_expired(&timer));
+
+	FUNC_EXIT_RC(rc);
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -109,6 +109,7 @@ static IoT_Error_t _aws_iot_mqtt_handle_reconnect(AWS_IoT_Client *pClient) {
 		FUNC_EXIT_RC(NETWORK_RECONNECT_TIMED_OUT_ERROR);
 	}
 	countdown_ms(&(pClient->reconnectDelayTimer), pClient->clientData.currentReconnectWaitInterval);
+	(void) aws_iot_deadline_heap_schedule(&(pClient->deadlines), &(pClient->reconnectDelayTimer));
 	FUNC_EXIT_RC(rc);
 }
 
@@ -173,10 +174,23 @@ static IoT_Error_t _aws_iot_mqtt_keep_alive(AWS_IoT_Client *pClient) {
 	countdown_sec(&pClient->pingRespTimer, pClient->clientData.keepAliveInterval);
 	/* Start a timer to keep track of when to send the next PINGREQ. */
 	countdown_sec(&pClient->pingReqTimer, pClient->clientData.keepAliveInterval);
+	(void) aws_iot_deadline_heap_schedule(&(pClient->deadlines), &(pClient->pingRespTimer));
+	(void) aws_iot_deadline_heap_schedule(&(pClient->deadlines), &(pClient->pingReqTimer));
 
 	FUNC_EXIT_RC(SUCCESS);
 }
 
+/**
+ * Time until the yield has to run again without incoming data, which is the
+ * end of the yield or the earliest keep alive or reconnect deadline, whichever
+ * comes first. Rounded up, so the wait never ends just before a deadline.
+ */
+static uint32_t _aws_iot_mqtt_next_wakeup_ms(AWS_IoT_Client *pClient, Timer *pYieldTimer) {
+	uint64_t wait_us = aws_iot_deadline_heap_next_wakeup_us(&(pClient->deadlines), left_us(pYieldTimer));
+
+	return (uint32_t) ((wait_us + 999) / 1000);
+}
+
 /**
  * @brief Yield to the MQTT client
  *
@@ -188,6 +202,8 @@ static IoT_Error_t _aws_iot_mqtt_keep_alive(AWS_IoT_Client *pClient) {
  * processing time to manage incoming messages.
  * This is the internal function which is called by the yield API to perform the operation.
  * Not meant to be called directly as it doesn't do validations or client state changes
+ * When the network layer can wait for data, the yield blocks until data arrives or the keep
+ * alive is due instead of polling the socket with short reads for the whole timeout.
  *
  * @param pClient Reference to the IoT Client
  * @param timeout_ms Maximum number of milliseconds to pass thread execution to the client.
@@ -224,12 +240,29 @@ static IoT_Error_t _aws_iot_mqtt_internal_yield(AWS_IoT_Client *pClient, uint32_
 				break;
 			}
 			yieldRc = _aws_iot_mqtt_handle_reconnect(pClient);
+			if(NETWORK_ATTEMPTING_RECONNECT == yieldRc) {
+				/* Nothing to read while disconnected, sleep until the next
+				 * attempt or the end of the yield instead of spinning */
+				delay(_aws_iot_mqtt_next_wakeup_ms(pClient, &timer));
+			}
 			/* Network reconnect attempted, check if yield timer expired before
 			 * doing anything else */
 			continue;
 		}
 
-		yieldRc = aws_iot_mqtt_internal_cycle_read(pClient, &timer, &packet_type);
+		yieldRc = SUCCESS;
+		if(NULL != pClient->networkStack.waitForRead) {
+			yieldRc = pClient->networkStack.waitForRead(&(pClient->networkStack),
+														_aws_iot_mqtt_next_wakeup_ms(pClient, &timer));
+		}
+
+		if(SUCCESS == yieldRc) {
+			yieldRc = aws_iot_mqtt_internal_cycle_read(pClient, &timer, &packet_type);
+		} else if(NETWORK_SSL_NOTHING_TO_READ == yieldRc) {
+			// Woken up by the deadline rather than by data, only the keep alive can be due
+			yieldRc = SUCCESS;
+		}
+
 		if(SUCCESS == yieldRc) {
 			yieldRc = _aws_iot_mqtt_keep_alive(pClient);
 		} else {
@@ -255,6 +288,7 @@ static IoT_Error_t _aws_iot_mqtt_internal_yield(AWS_IoT_Client *pClient, uint32_
 
 				pClient->clientData.currentReconnectWaitInterval = AWS_IOT_MQTT_MIN_RECONNECT_WAIT_INTERVAL;
 				countdown_ms(&(pClient->reconnectDelayTimer), pClient->clientData.currentReconnectWaitInterval);
+				(void) aws_iot_deadline_heap_schedule(&(pClient->deadlines), &(pClient->reconnectDelayTimer));
 
 				/* Depending on timer values, it is possible that yield timer has expired
 				 * Set to rc to attempting reconnect to inform client that autoreconnect
@@ -0,0 +1,193 @@
+/*
+ * Copyright 2010-2015 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file aws_iot_shadow_pipeline.c
+ * @brief Pipelined reported state updates for a thing shadow
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <string.h>
+
+#include "aws_iot_shadow_pipeline.h"
+#include "aws_iot_log.h"
+
+static void pipelineAckCallback(const char *pThingName, ShadowActions_t action, Shadow_Ack_Status_t status,
+								const char *pReceivedJsonDocument, void *pContextData) {
+	ShadowPipelineSlot_t *pSlot = (ShadowPipelineSlot_t *) pContextData;
+	ShadowUpdatePipeline_t *pPipeline = pSlot->pPipeline;
+	ShadowPipelineMetrics_t *pMetrics = &pPipeline->metrics;
+	uint32_t latency_ms;
+
+	pSlot->isInFlight = false;
+	pMetrics->inFlight--;
+
+	if(SHADOW_ACK_TIMEOUT == status) {
+		pMetrics->timedOut++;
+	} else {
+		if(SHADOW_ACK_ACCEPTED == status) {
+			pMetrics->accepted++;
+		} else {
+			pMetrics->rejected++;
+		}
+
+		latency_ms = (uint32_t) pPipeline->timeout_seconds * 1000 - left_ms(&pSlot->sentTimer);
+		if(1 == pMetrics->accepted + pMetrics->rejected || latency_ms < pMetrics->minAckLatency_ms) {
+			pMetrics->minAckLatency_ms = latency_ms;
+		}
+		if(latency_ms > pMetrics->maxAckLatency_ms) {
+			pMetrics->maxAckLatency_ms = latency_ms;
+		}
+		pMetrics->lastAckLatency_ms = latency_ms;
+		pMetrics->totalAckLatency_ms += latency_ms;
+	}
+
+	if(NULL != pPipeline->callback) {
+		pPipeline->callback(pThingName, action, status, pReceivedJsonDocument, pPipeline->pCallbackContext);
+	}
+}
+
+IoT_Error_t aws_iot_shadow_pipeline_init(ShadowUpdatePipeline_t *pPipeline, AWS_IoT_Client *pClient,
+										 const char *pThingName, char *pDocumentBuffer, size_t documentBufferSize,
+										 uint8_t window, uint8_t timeout_seconds, fpActionCallback_t callback,
+										 void *pCallbackContext) {
+	uint8_t i;
+
+	FUNC_ENTRY;
+
+	if(NULL == pPipeline || NULL == pClient || NULL == pThingName || NULL == pDocumentBuffer) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	if(0 == window || window > MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME) {
+		FUNC_EXIT_RC(FAILURE);
+	}
+
+	memset(pPipeline, 0, sizeof(ShadowUpdatePipeline_t));
+	pPipeline->pClient = pClient;
+	pPipeline->pThingName = pThingName;
+	pPipeline->pDocumentBuffer = pDocumentBuffer;
+	pPipeline->documentBufferSize = documentBufferSize;
+	pPipeline->window = window;
+	pPipeline->timeout_seconds = timeout_seconds;
+	pPipeline->callback = callback;
+	pPipeline->pCallbackContext = pCallbackContext;
+	for(i = 0; i < MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME; i++) {
+		pPipeline->slots[i].pPipeline = pPipeline;
+		init_timer(&(pPipeline->slots[i].sentTimer));
+	}
+
+	FUNC_EXIT_RC(SUCCESS);
+}
+
+IoT_Error_t aws_iot_shadow_pipeline_report(ShadowUpdatePipeline_t *pPipeline, const jsonStruct_t *pStruct) {
+	uint8_t i;
+
+	if(NULL == pPipeline || NULL == pStruct || NULL == pStruct->pKey) {
+		return NULL_VALUE_ERROR;
+	}
+
+	for(i = 0; i < pPipeline->stagedCount; i++) {
+		if(pPipeline->pStaged[i] == pStruct || strcmp(pPipeline->pStaged[i]->pKey, pStruct->pKey) == 0) {
+			pPipeline->pStaged[i] = pStruct;
+			pPipeline->metrics.coalesced++;
+			return SUCCESS;
+		}
+	}
+
+	if(pPipeline->stagedCount >= AWS_IOT_SHADOW_PIPELINE_MAX_FIELDS) {
+		return LIMIT_EXCEEDED_ERROR;
+	}
+
+	pPipeline->pStaged[pPipeline->stagedCount++] = pStruct;
+	return SUCCESS;
+}
+
+IoT_Error_t aws_iot_shadow_pipeline_flush(ShadowUpdatePipeline_t *pPipeline) {
+	ShadowJsonWriter_t writer;
+	ShadowPipelineSlot_t *pSlot = NULL;
+	IoT_Error_t rc;
+	uint8_t i;
+
+	FUNC_ENTRY;
+
+	if(NULL == pPipeline) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	if(0 == pPipeline->stagedCount || pPipeline->metrics.inFlight >= pPipeline->window) {
+		FUNC_EXIT_RC(SUCCESS);
+	}
+
+	for(i = 0; i < pPipeline->window; i++) {
+		if(!pPipeline->slots[i].isInFlight) {
+			pSlot = &(pPipeline->slots[i]);
+			break;
+		}
+	}
+	if(NULL == pSlot) {
+		FUNC_EXIT_RC(SUCCESS);
+	}
+
+	rc = aws_iot_shadow_json_writer_init(&writer, pPipeline->pDocumentBuffer, pPipeline->documentBufferSize);
+	if(SUCCESS != rc) {
+		FUNC_EXIT_RC(rc);
+	}
+	aws_iot_shadow_json_writer_begin_object(&writer, NULL);
+	aws_iot_shadow_json_writer_begin_object(&writer, "state");
+	aws_iot_shadow_json_writer_begin_object(&writer, "reported");
+	for(i = 0; i < pPipeline->stagedCount; i++) {
+		aws_iot_shadow_json_writer_add(&writer, pPipeline->pStaged[i]);
+	}
+	rc = aws_iot_shadow_json_writer_finalize(&writer);
+	if(SUCCESS != rc) {
+		FUNC_EXIT_RC(rc);
+	}
+
+	rc = aws_iot_shadow_update(pPipeline->pClient, pPipeline->pThingName, pPipeline->pDocumentBuffer,
+							   pipelineAckCallback, pSlot, pPipeline->timeout_seconds, true);
+	if(SUCCESS != rc) {
+		// The values stay staged and go out with the next flush
+		FUNC_EXIT_RC(rc);
+	}
+
+	pSlot->isInFlight = true;
+	countdown_ms(&(pSlot->sentTimer), (uint32_t) pPipeline->timeout_seconds * 1000);
+	pPipeline->stagedCount = 0;
+	pPipeline->metrics.sent++;
+	pPipeline->metrics.inFlight++;
+	if(pPipeline->metrics.inFlight > pPipeline->metrics.maxInFlight) {
+		pPipeline->metrics.maxInFlight = pPipeline->metrics.inFlight;
+	}
+
+	FUNC_EXIT_RC(SUCCESS);
+}
+
+IoT_Error_t aws_iot_shadow_pipeline_get_metrics(const ShadowUpdatePipeline_t *pPipeline,
+												ShadowPipelineMetrics_t *pMetrics) {
+	if(NULL == pPipeline || NULL == pMetrics) {
+		return NULL_VALUE_ERROR;
+	}
+
+	*pMetrics = pPipeline->metrics;
+	return SUCCESS;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -84,3 +84,5 @@ TEST_GROUP_C_WRAPPER(ConnectTests, cleanSessionInitSubscribers)
 TEST_GROUP_C_WRAPPER(ConnectTests, PowerCycleWithCleanSessionFalse)
 /* B:29 - Reconnect attempt succeeds, but resubscribes fail */
 TEST_GROUP_C_WRAPPER(ConnectTests, ReconnectAndResubscribe)
+/* B:30 - Connect, time spent in the TLS steps and waiting for the CONNACK is recorded */
+TEST_GROUP_C_WRAPPER(ConnectTests, ConnectTimingRecorded)
@@ -790,3 +790,49 @@ TEST_C(ConnectTests, ReconnectAndResubscribe) {
 
 	IOT_DEBUG("-->Success - B:29 - Reconnect attempt succeeds, but resubscribes fail \n");
 }
+
+/* B:30 - Connect, time spent in the TLS steps and waiting for the CONNACK is recorded */
+TEST_C(ConnectTests, ConnectTimingRecorded) {
+	IoT_Error_t rc = SUCCESS;
+	IoT_Client_Connect_Timing timing;
+
+	IOT_DEBUG("-->Running Connect Tests - B:30 - Connect, time spent in the TLS steps and waiting for the CONNACK is recorded \n");
+
+	InitMQTTParamsSetup(&initParams, AWS_IOT_MQTT_HOST, AWS_IOT_MQTT_PORT, false, NULL);
+	rc = aws_iot_mqtt_init(&iotClient, &initParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	rc = aws_iot_mqtt_get_connect_timing(&iotClient, &timing);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(0, timing.mqttConnect_ms);
+	CHECK_EQUAL_C_INT(0, timing.network.handshake_ms);
+
+	mockedConnectTiming.credentials_ms = 120;
+	mockedConnectTiming.tcp_ms = 80;
+	mockedConnectTiming.handshake_ms = 450;
+	mockedConnectTiming.sign_ms = 60;
+	mockedConnectTiming.isSessionResumed = false;
+
+	ConnectMQTTParamsSetup(&connectParams, AWS_IOT_MQTT_CLIENT_ID, (uint16_t) strlen(AWS_IOT_MQTT_CLIENT_ID));
+	setTLSRxBufferForConnack(&connectParams, 0, 0);
+	setTLSRxBufferDelay(0, 100000);
+	rc = aws_iot_mqtt_connect(&iotClient, &connectParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	rc = aws_iot_mqtt_get_connect_timing(&iotClient, &timing);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(120, timing.network.credentials_ms);
+	CHECK_EQUAL_C_INT(80, timing.network.tcp_ms);
+	CHECK_EQUAL_C_INT(450, timing.network.handshake_ms);
+	CHECK_EQUAL_C_INT(60, timing.network.sign_ms);
+	CHECK_C(false == timing.network.isSessionResumed);
+	CHECK_C(timing.mqttConnect_ms >= 90);
+	CHECK_C(timing.mqttConnect_ms < initParams.mqttCommandTimeout_ms);
+
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_mqtt_get_connect_timing(&iotClient, NULL));
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_mqtt_get_connect_timing(NULL, &timing));
+
+	memset(&mockedConnectTiming, 0, sizeof(mockedConnectTiming));
+
+	IOT_DEBUG("-->Success - B:30 - Connect, time spent in the TLS steps and waiting for the CONNACK is recorded \n");
+}
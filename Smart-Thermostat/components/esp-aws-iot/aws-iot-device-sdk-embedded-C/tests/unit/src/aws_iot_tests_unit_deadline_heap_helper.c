@@ -0,0 +1,246 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+/**
+ * @file aws_iot_tests_unit_deadline_heap_helper.c
+ * @brief IoT Client Unit Testing - Deadline Heap Tests Helper
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <CppUTest/TestHarness_c.h>
+
+#include "aws_iot_tests_unit_helper_functions.h"
+#include "aws_iot_tests_unit_mock_tls_params.h"
+#include "aws_iot_deadline_heap.h"
+#include "aws_iot_log.h"
+
+static IoT_Client_Init_Params initParams;
+static IoT_Client_Connect_Params connectParams;
+static AWS_IoT_Client iotClient;
+
+static AWS_IoT_Deadline_Heap heap;
+static Timer timers[AWS_IOT_DEADLINE_HEAP_SIZE + 1];
+
+TEST_GROUP_C_SETUP(DeadlineHeapTests) {
+	IoT_Error_t rc;
+	size_t i;
+
+	ResetTLSBuffer();
+	InitMQTTParamsSetup(&initParams, AWS_IOT_MQTT_HOST, AWS_IOT_MQTT_PORT, false, NULL);
+	rc = aws_iot_mqtt_init(&iotClient, &initParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	ConnectMQTTParamsSetup(&connectParams, AWS_IOT_MQTT_CLIENT_ID, (uint16_t) strlen(AWS_IOT_MQTT_CLIENT_ID));
+	setTLSRxBufferForConnack(&connectParams, 0, 0);
+	rc = aws_iot_mqtt_connect(&iotClient, &connectParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	ResetTLSBuffer();
+
+	aws_iot_deadline_heap_init(&heap);
+	for(i = 0; i < sizeof(timers) / sizeof(timers[0]); i++) {
+		init_timer(&timers[i]);
+	}
+}
+
+TEST_GROUP_C_TEARDOWN(DeadlineHeapTests) {
+	IoT_Error_t rc = aws_iot_mqtt_disconnect(&iotClient);
+	IOT_UNUSED(rc);
+}
+
+/* T:1 - Timers keep microsecond resolution */
+TEST_C(DeadlineHeapTests, TimerMicrosecondResolution) {
+	Timer timer;
+	uint64_t left;
+	uint64_t lateness_us;
+
+	IOT_DEBUG("-->Running Deadline Heap Tests - T:1 - Timers keep microsecond resolution \n");
+
+	init_timer(&timer);
+	CHECK_EQUAL_C_INT(true, has_timer_expired(&timer));
+	CHECK_EQUAL_C_INT(0, left_us(&timer));
+
+	countdown_ms(&timer, 2);
+	left = left_us(&timer);
+	CHECK_C(1000 < left && 2000 >= left);
+	CHECK_EQUAL_C_INT(left / 1000, left_ms(&timer));
+
+	/* The deadline is seen within a few microseconds, not at the next tick */
+	while(!has_timer_expired(&timer)) {
+	}
+	lateness_us = left_us(&timer);
+	CHECK_EQUAL_C_INT(0, lateness_us);
+
+	countdown_sec(&timer, 1);
+	CHECK_C(999000 < left_us(&timer));
+
+	IOT_DEBUG("-->Success - T:1 - Timers keep microsecond resolution \n");
+}
+
+/* T:2 - The earliest deadline is reported, also after a timer is restarted */
+TEST_C(DeadlineHeapTests, EarliestDeadlineFirst) {
+	uint64_t wakeup;
+
+	IOT_DEBUG("-->Running Deadline Heap Tests - T:2 - The earliest deadline is reported \n");
+
+	CHECK_EQUAL_C_INT(5000000, aws_iot_deadline_heap_next_wakeup_us(&heap, 5000000));
+
+	countdown_ms(&timers[0], 3000);
+	countdown_ms(&timers[1], 1000);
+	countdown_ms(&timers[2], 2000);
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_deadline_heap_schedule(&heap, &timers[0]));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_deadline_heap_schedule(&heap, &timers[1]));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_deadline_heap_schedule(&heap, &timers[2]));
+	CHECK_EQUAL_C_INT(3, heap.count);
+	CHECK_C(&timers[1] == heap.entries[0].pTimer);
+
+	wakeup = aws_iot_deadline_heap_next_wakeup_us(&heap, 5000000);
+	CHECK_C(990000 < wakeup && 1000000 >= wakeup);
+	CHECK_EQUAL_C_INT(500000, aws_iot_deadline_heap_next_wakeup_us(&heap, 500000));
+
+	/* Restarting the earliest timer later moves it down */
+	countdown_ms(&timers[1], 4000);
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_deadline_heap_schedule(&heap, &timers[1]));
+	CHECK_EQUAL_C_INT(3, heap.count);
+	CHECK_C(&timers[2] == heap.entries[0].pTimer);
+	wakeup = aws_iot_deadline_heap_next_wakeup_us(&heap, 5000000);
+	CHECK_C(1990000 < wakeup && 2000000 >= wakeup);
+
+	IOT_DEBUG("-->Success - T:2 - The earliest deadline is reported \n");
+}
+
+/* T:3 - A cancelled timer no longer wakes anyone */
+TEST_C(DeadlineHeapTests, CancelledTimerRemoved) {
+	uint64_t wakeup;
+
+	IOT_DEBUG("-->Running Deadline Heap Tests - T:3 - A cancelled timer no longer wakes anyone \n");
+
+	countdown_ms(&timers[0], 100);
+	countdown_ms(&timers[1], 2000);
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_deadline_heap_schedule(&heap, &timers[0]));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_deadline_heap_schedule(&heap, &timers[1]));
+
+	aws_iot_deadline_heap_cancel(&heap, &timers[0]);
+	aws_iot_deadline_heap_cancel(&heap, &timers[2]);
+	CHECK_EQUAL_C_INT(1, heap.count);
+	wakeup = aws_iot_deadline_heap_next_wakeup_us(&heap, 5000000);
+	CHECK_C(1990000 < wakeup && 2000000 >= wakeup);
+
+	IOT_DEBUG("-->Success - T:3 - A cancelled timer no longer wakes anyone \n");
+}
+
+/* T:4 - Expired timers are reported once and dropped */
+TEST_C(DeadlineHeapTests, ExpiredTimersDropped) {
+	uint64_t wakeup;
+
+	IOT_DEBUG("-->Running Deadline Heap Tests - T:4 - Expired timers are reported once and dropped \n");
+
+	countdown_ms(&timers[0], 0);
+	countdown_ms(&timers[1], 0);
+	countdown_ms(&timers[2], 1000);
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_deadline_heap_schedule(&heap, &timers[2]));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_deadline_heap_schedule(&heap, &timers[0]));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_deadline_heap_schedule(&heap, &timers[1]));
+
+	CHECK_EQUAL_C_INT(0, aws_iot_deadline_heap_next_wakeup_us(&heap, 5000000));
+	CHECK_EQUAL_C_INT(1, heap.count);
+	wakeup = aws_iot_deadline_heap_next_wakeup_us(&heap, 5000000);
+	CHECK_C(990000 < wakeup && 1000000 >= wakeup);
+
+	IOT_DEBUG("-->Success - T:4 - Expired timers are reported once and dropped \n");
+}
+
+/* T:5 - A full heap refuses new timers */
+TEST_C(DeadlineHeapTests, FullHeapRefuses) {
+	uint8_t i;
+
+	IOT_DEBUG("-->Running Deadline Heap Tests - T:5 - A full heap refuses new timers \n");
+
+	for(i = 0; i < AWS_IOT_DEADLINE_HEAP_SIZE; i++) {
+		countdown_ms(&timers[i], 1000 + i);
+		CHECK_EQUAL_C_INT(SUCCESS, aws_iot_deadline_heap_schedule(&heap, &timers[i]));
+	}
+	countdown_ms(&timers[i], 10);
+	CHECK_EQUAL_C_INT(LIMIT_EXCEEDED_ERROR, aws_iot_deadline_heap_schedule(&heap, &timers[i]));
+
+	/* Timers already in the heap can still be restarted */
+	countdown_ms(&timers[0], 5000);
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_deadline_heap_schedule(&heap, &timers[0]));
+	CHECK_C(&timers[1] == heap.entries[0].pTimer);
+
+	IOT_DEBUG("-->Success - T:5 - A full heap refuses new timers \n");
+}
+
+/* T:6 - The client schedules its keep alive and the yield wakes up for it */
+TEST_C(DeadlineHeapTests, KeepAliveScheduled) {
+	IoT_Error_t rc;
+
+	IOT_DEBUG("-->Running Deadline Heap Tests - T:6 - The client schedules its keep alive \n");
+
+	CHECK_EQUAL_C_INT(1, iotClient.deadlines.count);
+	CHECK_C(&iotClient.pingReqTimer == iotClient.deadlines.entries[0].pTimer);
+
+	/* Bring the keep alive forward so it falls inside the yield */
+	countdown_ms(&iotClient.pingReqTimer, 20);
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_deadline_heap_schedule(&iotClient.deadlines, &iotClient.pingReqTimer));
+	rc = aws_iot_mqtt_yield(&iotClient, 60);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(true, isLastTLSTxMessagePingreq());
+	CHECK_EQUAL_C_INT(2, iotClient.deadlines.count);
+
+	/* The PINGRESP ends the wait for it */
+	setTLSRxBufferForPingresp();
+	rc = aws_iot_mqtt_yield(&iotClient, 20);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(false, iotClient.clientStatus.isPingOutstanding);
+	CHECK_EQUAL_C_INT(1, iotClient.deadlines.count);
+	CHECK_C(&iotClient.pingReqTimer == iotClient.deadlines.entries[0].pTimer);
+
+	IOT_DEBUG("-->Success - T:6 - The client schedules its keep alive \n");
+}
+
+/* T:7 - A yield waiting to reconnect sleeps instead of spinning */
+TEST_C(DeadlineHeapTests, ReconnectWaitSleeps) {
+	struct timespec start, end;
+	clock_t cpuStart, cpuEnd;
+	double wall_ms, cpu_ms;
+	IoT_Error_t rc;
+
+	IOT_DEBUG("-->Running Deadline Heap Tests - T:7 - A yield waiting to reconnect sleeps \n");
+
+	rc = aws_iot_mqtt_autoreconnect_set_status(&iotClient, true);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	/* The next ping fails, which drops the connection */
+	init_timer(&iotClient.pingReqTimer);
+	setTLSTxBufferForError(NETWORK_SSL_WRITE_ERROR);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	cpuStart = clock();
+	rc = aws_iot_mqtt_yield(&iotClient, 300);
+	cpuEnd = clock();
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	CHECK_EQUAL_C_INT(NETWORK_ATTEMPTING_RECONNECT, rc);
+	CHECK_EQUAL_C_INT(false, aws_iot_mqtt_is_client_connected(&iotClient));
+
+	wall_ms = (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6;
+	cpu_ms = (double) (cpuEnd - cpuStart) * 1e3 / CLOCKS_PER_SEC;
+	printf("\nYield waiting to reconnect: %.1f ms wall, %.1f ms CPU\n", wall_ms, cpu_ms);
+	CHECK_C(300 <= wall_ms);
+	CHECK_C(30 > cpu_ms);
+
+	IOT_DEBUG("-->Success - T:7 - A yield waiting to reconnect sleeps \n");
+}
@@ -46,3 +46,11 @@ TEST_GROUP_C_WRAPPER(PublishTests, publishQoS1Success10msDelayedPuback)
 TEST_GROUP_C_WRAPPER(PublishTests, publishQoS0NoPubackSuccess)
 /* E:10 - Publish with QoS1 send success, Puback received */
 TEST_GROUP_C_WRAPPER(PublishTests, publishQoS1Success)
+/* E:11 - Publish QoS0 vector, short buffers staged, long buffer written in place */
+TEST_GROUP_C_WRAPPER(PublishTests, publishVectorQoS0Success)
+/* E:12 - Publish QoS1 vector success, Puback received */
+TEST_GROUP_C_WRAPPER(PublishTests, publishVectorQoS1Success)
+/* E:13 - Publish vector with too many buffers */
+TEST_GROUP_C_WRAPPER(PublishTests, publishVectorTooManyBuffers)
+/* E:14 - Publish QoS0 payload larger than the TX buffer */
+TEST_GROUP_C_WRAPPER(PublishTests, publishLargerThanTxBuffer)
@@ -0,0 +1,39 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+/**
+ * @file aws_iot_tests_unit_publish_queue.cpp
+ * @brief IoT Client Unit Testing - Publish Queue Tests
+ */
+
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTest/TestHarness_c.h>
+
+TEST_GROUP_C(PublishQueueTests){
+	TEST_GROUP_C_SETUP_WRAPPER(PublishQueueTests)
+	TEST_GROUP_C_TEARDOWN_WRAPPER(PublishQueueTests)
+};
+
+/* Q:1 - Queued QoS 0 messages sent in order and completed */
+TEST_GROUP_C_WRAPPER(PublishQueueTests, QoS0SentInOrder)
+/* Q:2 - High priority lane drained before the normal lane */
+TEST_GROUP_C_WRAPPER(PublishQueueTests, HighLaneFirst)
+/* Q:3 - Full lane refuses messages until the network task sent some */
+TEST_GROUP_C_WRAPPER(PublishQueueTests, FullLaneBackPressure)
+/* Q:4 - QoS 1 message completed once the PUBACK arrived */
+TEST_GROUP_C_WRAPPER(PublishQueueTests, QoS1CompletedOnPuback)
+/* Q:5 - Invalid and oversized messages refused */
+TEST_GROUP_C_WRAPPER(PublishQueueTests, InvalidMessages)
+/* Q:6 - Concurrent producers, every message sent once and in producer order */
+TEST_GROUP_C_WRAPPER(PublishQueueTests, ConcurrentProducers)
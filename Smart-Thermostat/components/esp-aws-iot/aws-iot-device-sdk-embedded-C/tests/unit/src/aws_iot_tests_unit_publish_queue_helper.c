@@ -0,0 +1,287 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+/**
+ * @file aws_iot_tests_unit_publish_queue_helper.c
+ * @brief IoT Client Unit Testing - Publish Queue Tests Helper
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <CppUTest/TestHarness_c.h>
+
+#include "aws_iot_tests_unit_helper_functions.h"
+#include "aws_iot_tests_unit_mock_tls_params.h"
+#include "aws_iot_mqtt_client_publish_queue.h"
+#include "aws_iot_log.h"
+
+#define PRODUCER_COUNT 4
+#define MESSAGES_PER_PRODUCER 500
+
+static IoT_Client_Init_Params initParams;
+static IoT_Client_Connect_Params connectParams;
+static AWS_IoT_Client iotClient;
+static AWS_IoT_Publish_Queue publishQueue;
+
+static const char *pTestTopic = "sdk/Test/queue";
+
+static int completionOrder[PUBLISH_QUEUE_LANE_COUNT * AWS_IOT_MQTT_PUBLISH_QUEUE_LENGTH];
+static int completionCount;
+static IoT_Error_t lastCompletionRc;
+
+static int producerNextExpected[PRODUCER_COUNT];
+static int producerOutOfOrderCount;
+static int producerCompletionCount;
+
+static void iot_publish_queue_completion_handler(AWS_IoT_Client *pClient, IoT_Error_t rc, void *pData) {
+	IOT_UNUSED(pClient);
+
+	if(completionCount < (int) (sizeof(completionOrder) / sizeof(completionOrder[0]))) {
+		completionOrder[completionCount] = (int) (intptr_t) pData;
+	}
+	completionCount++;
+	lastCompletionRc = rc;
+}
+
+static IoT_Error_t queueMessage(IoT_Publish_Queue_Lane lane, QoS qos, const char *pPayload, int id) {
+	IoT_Publish_Message_Params params;
+
+	params.qos = qos;
+	params.isRetained = 0;
+	params.payload = (void *) pPayload;
+	params.payloadLen = strlen(pPayload);
+
+	return aws_iot_mqtt_publish_queue_add(&publishQueue, lane, pTestTopic, (uint16_t) strlen(pTestTopic), &params,
+										  iot_publish_queue_completion_handler, (void *) (intptr_t) id);
+}
+
+TEST_GROUP_C_SETUP(PublishQueueTests) {
+	IoT_Error_t rc;
+
+	ResetTLSBuffer();
+	InitMQTTParamsSetup(&initParams, AWS_IOT_MQTT_HOST, AWS_IOT_MQTT_PORT, false, NULL);
+	rc = aws_iot_mqtt_init(&iotClient, &initParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	ConnectMQTTParamsSetup(&connectParams, AWS_IOT_MQTT_CLIENT_ID, (uint16_t) strlen(AWS_IOT_MQTT_CLIENT_ID));
+	setTLSRxBufferForConnack(&connectParams, 0, 0);
+	rc = aws_iot_mqtt_connect(&iotClient, &connectParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	ResetTLSBuffer();
+
+	rc = aws_iot_mqtt_publish_queue_init(&publishQueue);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	completionCount = 0;
+	lastCompletionRc = FAILURE;
+}
+
+TEST_GROUP_C_TEARDOWN(PublishQueueTests) {
+	IoT_Error_t rc = aws_iot_mqtt_disconnect(&iotClient);
+	IOT_UNUSED(rc);
+}
+
+/* Q:1 - Queued QoS 0 messages sent in order and completed */
+TEST_C(PublishQueueTests, QoS0SentInOrder) {
+	IoT_Error_t rc;
+
+	IOT_DEBUG("-->Running Publish Queue Tests - Q:1 - Queued QoS 0 messages sent in order and completed \n");
+
+	CHECK_EQUAL_C_INT(SUCCESS, queueMessage(PUBLISH_QUEUE_LANE_NORMAL, QOS0, "first", 1));
+	CHECK_EQUAL_C_INT(SUCCESS, queueMessage(PUBLISH_QUEUE_LANE_NORMAL, QOS0, "second", 2));
+	CHECK_EQUAL_C_INT(SUCCESS, queueMessage(PUBLISH_QUEUE_LANE_NORMAL, QOS0, "third", 3));
+	CHECK_EQUAL_C_INT(0, completionCount);
+
+	rc = aws_iot_mqtt_publish_queue_run(&iotClient, &publishQueue, 20);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	CHECK_EQUAL_C_INT(3, completionCount);
+	CHECK_EQUAL_C_INT(1, completionOrder[0]);
+	CHECK_EQUAL_C_INT(2, completionOrder[1]);
+	CHECK_EQUAL_C_INT(3, completionOrder[2]);
+	CHECK_EQUAL_C_INT(SUCCESS, lastCompletionRc);
+	CHECK_EQUAL_C_STRING(pTestTopic, LastPublishMessageTopic);
+	CHECK_EQUAL_C_STRING("third", LastPublishMessagePayload);
+	CHECK_EQUAL_C_INT(CLIENT_STATE_CONNECTED_IDLE, aws_iot_mqtt_get_client_state(&iotClient));
+
+	IOT_DEBUG("-->Success - Q:1 - Queued QoS 0 messages sent in order and completed \n");
+}
+
+/* Q:2 - High priority lane drained before the normal lane */
+TEST_C(PublishQueueTests, HighLaneFirst) {
+	IoT_Error_t rc;
+
+	IOT_DEBUG("-->Running Publish Queue Tests - Q:2 - High priority lane drained before the normal lane \n");
+
+	CHECK_EQUAL_C_INT(SUCCESS, queueMessage(PUBLISH_QUEUE_LANE_NORMAL, QOS0, "normal 1", 1));
+	CHECK_EQUAL_C_INT(SUCCESS, queueMessage(PUBLISH_QUEUE_LANE_HIGH, QOS0, "high 1", 2));
+	CHECK_EQUAL_C_INT(SUCCESS, queueMessage(PUBLISH_QUEUE_LANE_NORMAL, QOS0, "normal 2", 3));
+	CHECK_EQUAL_C_INT(SUCCESS, queueMessage(PUBLISH_QUEUE_LANE_HIGH, QOS0, "high 2", 4));
+
+	rc = aws_iot_mqtt_publish_queue_run(&iotClient, &publishQueue, 20);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	CHECK_EQUAL_C_INT(4, completionCount);
+	CHECK_EQUAL_C_INT(2, completionOrder[0]);
+	CHECK_EQUAL_C_INT(4, completionOrder[1]);
+	CHECK_EQUAL_C_INT(1, completionOrder[2]);
+	CHECK_EQUAL_C_INT(3, completionOrder[3]);
+
+	IOT_DEBUG("-->Success - Q:2 - High priority lane drained before the normal lane \n");
+}
+
+/* Q:3 - Full lane refuses messages until the network task sent some */
+TEST_C(PublishQueueTests, FullLaneBackPressure) {
+	IoT_Error_t rc;
+	int i;
+
+	IOT_DEBUG("-->Running Publish Queue Tests - Q:3 - Full lane refuses messages until the network task sent some \n");
+
+	for(i = 0; i < AWS_IOT_MQTT_PUBLISH_QUEUE_LENGTH; i++) {
+		CHECK_EQUAL_C_INT(SUCCESS, queueMessage(PUBLISH_QUEUE_LANE_NORMAL, QOS0, "fill", i));
+	}
+	CHECK_EQUAL_C_INT(MQTT_PUBLISH_QUEUE_FULL_ERROR, queueMessage(PUBLISH_QUEUE_LANE_NORMAL, QOS0, "refused", 100));
+	CHECK_EQUAL_C_INT(1, publishQueue.refusedCount);
+
+	/* The other lane has room of its own */
+	CHECK_EQUAL_C_INT(SUCCESS, queueMessage(PUBLISH_QUEUE_LANE_HIGH, QOS0, "urgent", 200));
+
+	rc = aws_iot_mqtt_publish_queue_run(&iotClient, &publishQueue, 20);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(AWS_IOT_MQTT_PUBLISH_QUEUE_LENGTH + 1, completionCount);
+	CHECK_EQUAL_C_INT(200, completionOrder[0]);
+
+	CHECK_EQUAL_C_INT(SUCCESS, queueMessage(PUBLISH_QUEUE_LANE_NORMAL, QOS0, "accepted again", 300));
+
+	IOT_DEBUG("-->Success - Q:3 - Full lane refuses messages until the network task sent some \n");
+}
+
+/* Q:4 - QoS 1 message completed once the PUBACK arrived */
+TEST_C(PublishQueueTests, QoS1CompletedOnPuback) {
+	IoT_Error_t rc;
+
+	IOT_DEBUG("-->Running Publish Queue Tests - Q:4 - QoS 1 message completed once the PUBACK arrived \n");
+
+	CHECK_EQUAL_C_INT(SUCCESS, queueMessage(PUBLISH_QUEUE_LANE_NORMAL, QOS1, "acknowledged", 1));
+	setTLSRxBufferForPuback();
+
+	rc = aws_iot_mqtt_publish_queue_run(&iotClient, &publishQueue, 20);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	CHECK_EQUAL_C_INT(1, completionCount);
+	CHECK_EQUAL_C_INT(SUCCESS, lastCompletionRc);
+	CHECK_EQUAL_C_STRING("acknowledged", LastPublishMessagePayload);
+	/* QoS 1 with the packet id filled in by the network task */
+	CHECK_EQUAL_C_INT(0x32, TxBuffer.pBuffer[0]);
+
+	IOT_DEBUG("-->Success - Q:4 - QoS 1 message completed once the PUBACK arrived \n");
+}
+
+/* Q:5 - Invalid and oversized messages refused */
+TEST_C(PublishQueueTests, InvalidMessages) {
+	static char largePayload[AWS_IOT_MQTT_PUBLISH_QUEUE_PACKET_LEN + 1];
+	IoT_Publish_Message_Params params;
+
+	IOT_DEBUG("-->Running Publish Queue Tests - Q:5 - Invalid and oversized messages refused \n");
+
+	memset(largePayload, 'x', sizeof(largePayload) - 1);
+	CHECK_EQUAL_C_INT(MQTT_TX_BUFFER_TOO_SHORT_ERROR, queueMessage(PUBLISH_QUEUE_LANE_NORMAL, QOS0, largePayload, 1));
+	CHECK_EQUAL_C_INT(FAILURE, queueMessage(PUBLISH_QUEUE_LANE_COUNT, QOS0, "no such lane", 2));
+
+	params.qos = QOS0;
+	params.isRetained = 0;
+	params.payload = NULL;
+	params.payloadLen = 4;
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_mqtt_publish_queue_add(&publishQueue, PUBLISH_QUEUE_LANE_NORMAL,
+																	   pTestTopic, (uint16_t) strlen(pTestTopic),
+																	   &params, NULL, NULL));
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_mqtt_publish_queue_init(NULL));
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_mqtt_publish_queue_run(&iotClient, NULL, 10));
+
+	/* Nothing was queued */
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_publish_queue_run(&iotClient, &publishQueue, 5));
+	CHECK_EQUAL_C_INT(0, completionCount);
+
+	IOT_DEBUG("-->Success - Q:5 - Invalid and oversized messages refused \n");
+}
+
+static void iot_publish_queue_producer_completion_handler(AWS_IoT_Client *pClient, IoT_Error_t rc, void *pData) {
+	int producer = (int) ((intptr_t) pData / MESSAGES_PER_PRODUCER);
+	int message = (int) ((intptr_t) pData % MESSAGES_PER_PRODUCER);
+
+	IOT_UNUSED(pClient);
+
+	if(SUCCESS != rc || message != producerNextExpected[producer]) {
+		producerOutOfOrderCount++;
+	}
+	producerNextExpected[producer] = message + 1;
+	producerCompletionCount++;
+}
+
+static void *iot_publish_queue_producer(void *pArg) {
+	int producer = (int) (intptr_t) pArg;
+	IoT_Publish_Message_Params params;
+	char payload[32];
+	IoT_Error_t rc;
+	int i;
+
+	params.qos = QOS0;
+	params.isRetained = 0;
+	params.payload = payload;
+
+	for(i = 0; i < MESSAGES_PER_PRODUCER; i++) {
+		params.payloadLen = (size_t) snprintf(payload, sizeof(payload), "producer %d message %d", producer, i);
+		do {
+			rc = aws_iot_mqtt_publish_queue_add(&publishQueue, (IoT_Publish_Queue_Lane) (producer % 2), pTestTopic,
+												(uint16_t) strlen(pTestTopic), &params,
+												iot_publish_queue_producer_completion_handler,
+												(void *) (intptr_t) (producer * MESSAGES_PER_PRODUCER + i));
+		} while(MQTT_PUBLISH_QUEUE_FULL_ERROR == rc);
+	}
+
+	return NULL;
+}
+
+/* Q:6 - Concurrent producers, every message sent once and in producer order */
+TEST_C(PublishQueueTests, ConcurrentProducers) {
+	pthread_t producers[PRODUCER_COUNT];
+	int i, rounds;
+
+	IOT_DEBUG("-->Running Publish Queue Tests - Q:6 - Concurrent producers, every message sent once and in producer order \n");
+
+	memset(producerNextExpected, 0, sizeof(producerNextExpected));
+	producerOutOfOrderCount = 0;
+	producerCompletionCount = 0;
+
+	for(i = 0; i < PRODUCER_COUNT; i++) {
+		CHECK_EQUAL_C_INT(0, pthread_create(&producers[i], NULL, iot_publish_queue_producer, (void *) (intptr_t) i));
+	}
+
+	for(rounds = 0; rounds < 10000 && producerCompletionCount < PRODUCER_COUNT * MESSAGES_PER_PRODUCER; rounds++) {
+		CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_publish_queue_run(&iotClient, &publishQueue, 1));
+	}
+
+	for(i = 0; i < PRODUCER_COUNT; i++) {
+		pthread_join(producers[i], NULL);
+	}
+
+	CHECK_EQUAL_C_INT(PRODUCER_COUNT * MESSAGES_PER_PRODUCER, producerCompletionCount);
+	CHECK_EQUAL_C_INT(0, producerOutOfOrderCount);
+	for(i = 0; i < PRODUCER_COUNT; i++) {
+		CHECK_EQUAL_C_INT(MESSAGES_PER_PRODUCER, producerNextExpected[i]);
+	}
+
+	IOT_DEBUG("-->Success - Q:6 - Concurrent producers, every message sent once and in producer order \n");
+}
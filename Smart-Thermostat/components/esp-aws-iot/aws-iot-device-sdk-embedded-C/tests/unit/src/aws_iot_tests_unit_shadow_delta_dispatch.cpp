@@ -0,0 +1,38 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_tests_unit_shadow_delta_dispatch.cpp
+ * @brief IoT Client Unit Testing - Shadow Delta Dispatch Tests
+ */
+
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTest/TestHarness_c.h>
+
+TEST_GROUP_C(ShadowDeltaDispatchTests){
+	TEST_GROUP_C_SETUP_WRAPPER(ShadowDeltaDispatchTests)
+	TEST_GROUP_C_TEARDOWN_WRAPPER(ShadowDeltaDispatchTests)
+};
+
+/* G:1 - Delta callbacks run in document order */
+TEST_GROUP_C_WRAPPER(ShadowDeltaDispatchTests, CallbacksInDocumentOrder)
+/* G:2 - Key registered twice, both callbacks run */
+TEST_GROUP_C_WRAPPER(ShadowDeltaDispatchTests, DuplicateKeyRegistration)
+/* G:3 - Keys outside the state object and in metadata ignored */
+TEST_GROUP_C_WRAPPER(ShadowDeltaDispatchTests, MetadataAndTopLevelKeysIgnored)
+/* G:4 - Callback counts match the per key scan */
+TEST_GROUP_C_WRAPPER(ShadowDeltaDispatchTests, CallbackCountMatchesKeyScan)
+/* G:5 - Dispatch cost against the per key scan */
+TEST_GROUP_C_WRAPPER(ShadowDeltaDispatchTests, DispatchBenchmark)
@@ -0,0 +1,44 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_tests_unit_shadow_gateway.cpp
+ * @brief IoT Client Unit Testing - Shadow Gateway Tests
+ */
+
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTest/TestHarness_c.h>
+
+TEST_GROUP_C(ShadowGatewayTests){
+	TEST_GROUP_C_SETUP_WRAPPER(ShadowGatewayTests)
+	TEST_GROUP_C_TEARDOWN_WRAPPER(ShadowGatewayTests)
+};
+
+/* M:1 - Init fails when the tables do not fit in the arena */
+TEST_GROUP_C_WRAPPER(ShadowGatewayTests, ArenaTooSmall)
+/* M:2 - Things are found by name, duplicates and overflow refused */
+TEST_GROUP_C_WRAPPER(ShadowGatewayTests, AddAndFindThings)
+/* M:3 - Deltas reach the fields of the thing named in the topic only */
+TEST_GROUP_C_WRAPPER(ShadowGatewayTests, DeltaRoutedToThing)
+/* M:4 - Deltas older than the last version of their thing are dropped */
+TEST_GROUP_C_WRAPPER(ShadowGatewayTests, OldDeltaDiscarded)
+/* M:5 - Update carries the gateway client token and its ack reaches the callback */
+TEST_GROUP_C_WRAPPER(ShadowGatewayTests, UpdateAccepted)
+/* M:6 - Get is rejected, delete without callback sends no token */
+TEST_GROUP_C_WRAPPER(ShadowGatewayTests, GetRejectedAndDelete)
+/* M:7 - Full ack slots refuse actions, yield reports timeouts and frees them */
+TEST_GROUP_C_WRAPPER(ShadowGatewayTests, AckSlotsAndTimeout)
+/* M:8 - Delta dispatch cost against the linear topic scan */
+TEST_GROUP_C_WRAPPER(ShadowGatewayTests, DispatchBenchmark)
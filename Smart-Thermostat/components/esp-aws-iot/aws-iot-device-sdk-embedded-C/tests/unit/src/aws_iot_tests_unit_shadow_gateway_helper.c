@@ -0,0 +1,479 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_tests_unit_shadow_gateway_helper.c
+ * @brief IoT Client Unit Testing - Shadow Gateway Tests Helper
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <CppUTest/TestHarness_c.h>
+
+#include "aws_iot_shadow_gateway.h"
+#include "aws_iot_shadow_json.h"
+#include "aws_iot_mqtt_client_common_internal.h"
+#include "aws_iot_tests_unit_helper_functions.h"
+#include "aws_iot_tests_unit_mock_tls_params.h"
+#include "aws_iot_log.h"
+
+#define SUBACK_PACKET_SIZE 5
+
+/* Things simulated by the benchmark at most, and deltas delivered per thing count */
+#define GATEWAY_BENCHMARK_MAX_THINGS 512
+#define GATEWAY_BENCHMARK_MESSAGES 20000
+#define THING_NAME_SIZE 16
+
+#define GATEWAY_TEST_MAX_THINGS 8
+#define GATEWAY_TEST_MAX_ACKS 4
+#define GATEWAY_TEST_RX_BUFFER 512
+#define LINEAR_SCAN_FILTER "$aws/things/+/shadow/update/delta"
+
+static AWS_IoT_Client client;
+static IoT_Client_Init_Params initParams;
+static IoT_Client_Connect_Params connectParams;
+static ShadowGateway_t gateway;
+static ShadowGatewayParams_t gatewayParams;
+static uint64_t arena[AWS_IOT_SHADOW_GATEWAY_ARENA_SIZE(GATEWAY_BENCHMARK_MAX_THINGS, GATEWAY_TEST_MAX_ACKS,
+															GATEWAY_TEST_RX_BUFFER,
+															GATEWAY_BENCHMARK_MAX_THINGS * THING_NAME_SIZE)
+					  / sizeof(uint64_t) + 1];
+
+static int32_t setpoints[GATEWAY_BENCHMARK_MAX_THINGS];
+static jsonStruct_t setpointFields[GATEWAY_BENCHMARK_MAX_THINGS];
+static char thingNames[GATEWAY_BENCHMARK_MAX_THINGS][THING_NAME_SIZE];
+static char deltaTopics[GATEWAY_BENCHMARK_MAX_THINGS][MAX_SHADOW_TOPIC_LENGTH_BYTES];
+static int deltaCallbackCount;
+static jsonStruct_t *pLastDeltaField;
+
+static int ackCallbackCount;
+static char ackThingName[MAX_SIZE_OF_THING_NAME];
+static ShadowActions_t ackAction;
+static Shadow_Ack_Status_t ackStatus;
+static void *pAckContext;
+
+static int linearScanThingCount;
+
+static void setpointCallback(const char *pJsonStringData, uint32_t JsonStringDataLen, jsonStruct_t *pContext) {
+	IOT_UNUSED(pJsonStringData);
+	IOT_UNUSED(JsonStringDataLen);
+
+	deltaCallbackCount++;
+	pLastDeltaField = pContext;
+}
+
+static void ackCallback(const char *pThingName, ShadowActions_t action, Shadow_Ack_Status_t status,
+						const char *pReceivedJsonDocument, void *pContextData) {
+	IOT_UNUSED(pReceivedJsonDocument);
+
+	ackCallbackCount++;
+	snprintf(ackThingName, sizeof(ackThingName), "%s", pThingName);
+	ackAction = action;
+	ackStatus = status;
+	pAckContext = pContextData;
+}
+
+/* How the records of the single thing shadow client find a thing, a strcmp per known topic */
+static void linearScanCallback(AWS_IoT_Client *pClient, char *topicName, uint16_t topicNameLen,
+							   IoT_Publish_Message_Params *params, void *pData) {
+	static char rxBuf[GATEWAY_TEST_RX_BUFFER];
+	static char topic[MAX_SHADOW_TOPIC_LENGTH_BYTES];
+	void *pJsonHandler = NULL;
+	int32_t tokenCount;
+	int32_t dataPosition;
+	uint32_t dataLength;
+	int i;
+
+	IOT_UNUSED(pClient);
+	IOT_UNUSED(pData);
+
+	if(topicNameLen >= sizeof(topic) || params->payloadLen >= sizeof(rxBuf)) {
+		return;
+	}
+	memcpy(topic, topicName, topicNameLen);
+	topic[topicNameLen] = '\0';
+	for(i = 0; i < linearScanThingCount; i++) {
+		if(0 == strcmp(topic, deltaTopics[i])) {
+			break;
+		}
+	}
+	if(i == linearScanThingCount) {
+		return;
+	}
+
+	memcpy(rxBuf, params->payload, params->payloadLen);
+	rxBuf[params->payloadLen] = '\0';
+	if(isJsonValidAndParse(rxBuf, sizeof(rxBuf), pJsonHandler, &tokenCount)
+	   && isJsonKeyMatchingAndUpdateValue(rxBuf, pJsonHandler, tokenCount, &setpointFields[i], &dataLength,
+										  &dataPosition)) {
+		setpointFields[i].cb(rxBuf + dataPosition, dataLength, &setpointFields[i]);
+	}
+}
+
+static void setTLSRxBufferForTripleSuback(void) {
+	IoT_Publish_Message_Params params;
+
+	memset(&params, 0, sizeof(params));
+	setTLSRxBufferForDoubleSuback(NULL, 0, QOS0, params);
+	memcpy(&RxBuffer.pBuffer[2 * SUBACK_PACKET_SIZE], RxBuffer.pBuffer, SUBACK_PACKET_SIZE);
+	RxBuffer.len = 3 * SUBACK_PACKET_SIZE;
+}
+
+static IoT_Error_t initGateway(uint16_t maxThings, uint8_t maxAcks, size_t arenaSize) {
+	gatewayParams.pArena = arena;
+	gatewayParams.arenaSize = arenaSize;
+	gatewayParams.maxThings = maxThings;
+	gatewayParams.maxAcks = maxAcks;
+	gatewayParams.rxBufferSize = GATEWAY_TEST_RX_BUFFER;
+	gatewayParams.pClientTokenPrefix = AWS_IOT_MQTT_CLIENT_ID;
+	gatewayParams.isDiscardOldDeltaEnabled = true;
+
+	return aws_iot_shadow_gateway_init(&gateway, &client, &gatewayParams);
+}
+
+static void addThings(int count) {
+	uint16_t thingIndex;
+	IoT_Error_t rc;
+	int i;
+
+	for(i = 0; i < count; i++) {
+		snprintf(thingNames[i], THING_NAME_SIZE, "portA-sensor%d", i);
+		snprintf(deltaTopics[i], MAX_SHADOW_TOPIC_LENGTH_BYTES, "$aws/things/%s/shadow/update/delta", thingNames[i]);
+		setpoints[i] = 0;
+		setpointFields[i].cb = setpointCallback;
+		setpointFields[i].pKey = "setpoint";
+		setpointFields[i].pData = &setpoints[i];
+		setpointFields[i].dataLength = sizeof(int32_t);
+		setpointFields[i].type = SHADOW_JSON_INT32;
+
+		rc = aws_iot_shadow_gateway_add_thing(&gateway, thingNames[i], &setpointFields[i], 1, &thingIndex);
+		CHECK_EQUAL_C_INT(SUCCESS, rc);
+		CHECK_EQUAL_C_INT(i, thingIndex);
+	}
+}
+
+static void subscribeGateway(void) {
+	IoT_Error_t rc;
+
+	setTLSRxBufferForTripleSuback();
+	rc = aws_iot_shadow_gateway_subscribe(&gateway);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	ResetTLSBuffer();
+}
+
+static void deliver(const char *pTopic, const char *pDocument) {
+	IoT_Publish_Message_Params params;
+	uint8_t packetType;
+	Timer timer;
+	IoT_Error_t rc;
+
+	memset(&params, 0, sizeof(params));
+	params.qos = QOS0;
+	params.payload = (void *) pDocument;
+	params.payloadLen = strlen(pDocument);
+	setTLSRxBufferWithMsgOnSubscribedTopic((char *) pTopic, strlen(pTopic), QOS0, params, (char *) pDocument);
+	init_timer(&timer);
+	countdown_ms(&timer, 1000);
+	rc = aws_iot_mqtt_internal_cycle_read(&client, &timer, &packetType);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(PUBLISH, packetType);
+}
+
+/* Connects the client afresh, the broker stand-in holds no subscriptions afterwards */
+static void connectClient(void) {
+	IoT_Error_t rc;
+
+	ResetTLSBuffer();
+	InitMQTTParamsSetup(&initParams, AWS_IOT_MQTT_HOST, AWS_IOT_MQTT_PORT, false, NULL);
+	rc = aws_iot_mqtt_init(&client, &initParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	ConnectMQTTParamsSetup(&connectParams, AWS_IOT_MQTT_CLIENT_ID, (uint16_t) strlen(AWS_IOT_MQTT_CLIENT_ID));
+	setTLSRxBufferForConnack(&connectParams, 0, 0);
+	rc = aws_iot_mqtt_connect(&client, &connectParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	ResetTLSBuffer();
+}
+
+TEST_GROUP_C_SETUP(ShadowGatewayTests) {
+	connectClient();
+	deltaCallbackCount = 0;
+	pLastDeltaField = NULL;
+	ackCallbackCount = 0;
+	ackThingName[0] = '\0';
+	pAckContext = NULL;
+}
+
+TEST_GROUP_C_TEARDOWN(ShadowGatewayTests) {
+	IoT_Error_t rc = aws_iot_mqtt_disconnect(&client);
+	IOT_UNUSED(rc);
+}
+
+/* M:1 - Init fails when the tables do not fit in the arena */
+TEST_C(ShadowGatewayTests, ArenaTooSmall) {
+	IOT_DEBUG("-->Running Shadow Gateway Tests - M:1 - Init fails when the tables do not fit in the arena \n");
+
+	CHECK_EQUAL_C_INT(LIMIT_EXCEEDED_ERROR, initGateway(GATEWAY_TEST_MAX_THINGS, GATEWAY_TEST_MAX_ACKS, 64));
+	CHECK_EQUAL_C_INT(FAILURE, initGateway(0, GATEWAY_TEST_MAX_ACKS, sizeof(arena)));
+	CHECK_EQUAL_C_INT(SUCCESS, initGateway(GATEWAY_TEST_MAX_THINGS, GATEWAY_TEST_MAX_ACKS,
+										   AWS_IOT_SHADOW_GATEWAY_ARENA_SIZE(GATEWAY_TEST_MAX_THINGS,
+																			 GATEWAY_TEST_MAX_ACKS,
+																			 GATEWAY_TEST_RX_BUFFER,
+																			 GATEWAY_TEST_MAX_THINGS * THING_NAME_SIZE)));
+
+	IOT_DEBUG("-->Success - M:1 - Init fails when the tables do not fit in the arena \n");
+}
+
+/* M:2 - Things are found by name, duplicates and overflow refused */
+TEST_C(ShadowGatewayTests, AddAndFindThings) {
+	uint16_t thingIndex = 0;
+	int i;
+
+	IOT_DEBUG("-->Running Shadow Gateway Tests - M:2 - Things are found by name, duplicates and overflow refused \n");
+
+	CHECK_EQUAL_C_INT(SUCCESS, initGateway(GATEWAY_TEST_MAX_THINGS, GATEWAY_TEST_MAX_ACKS, sizeof(arena)));
+	addThings(GATEWAY_TEST_MAX_THINGS);
+
+	for(i = GATEWAY_TEST_MAX_THINGS - 1; i >= 0; i--) {
+		CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_gateway_find_thing(&gateway, thingNames[i], &thingIndex));
+		CHECK_EQUAL_C_INT(i, thingIndex);
+		CHECK_EQUAL_C_STRING(thingNames[i], aws_iot_shadow_gateway_get_thing_name(&gateway, thingIndex));
+	}
+	CHECK_EQUAL_C_INT(FAILURE, aws_iot_shadow_gateway_find_thing(&gateway, "portA-sensor", &thingIndex));
+	CHECK_EQUAL_C_INT(FAILURE, aws_iot_shadow_gateway_add_thing(&gateway, thingNames[3], NULL, 0, &thingIndex));
+	CHECK_EQUAL_C_INT(LIMIT_EXCEEDED_ERROR, aws_iot_shadow_gateway_add_thing(&gateway, "portC-sensor0", NULL, 0,
+																			  &thingIndex));
+	CHECK_EQUAL_C_INT(MAX_SIZE_ERROR, aws_iot_shadow_gateway_add_thing(&gateway, "", NULL, 0, &thingIndex));
+	CHECK_C(NULL == aws_iot_shadow_gateway_get_thing_name(&gateway, GATEWAY_TEST_MAX_THINGS));
+
+	IOT_DEBUG("-->Success - M:2 - Things are found by name, duplicates and overflow refused \n");
+}
+
+/* M:3 - Deltas reach the fields of the thing named in the topic only */
+TEST_C(ShadowGatewayTests, DeltaRoutedToThing) {
+	IOT_DEBUG("-->Running Shadow Gateway Tests - M:3 - Deltas reach the fields of the thing named in the topic only \n");
+
+	CHECK_EQUAL_C_INT(SUCCESS, initGateway(GATEWAY_TEST_MAX_THINGS, GATEWAY_TEST_MAX_ACKS, sizeof(arena)));
+	addThings(4);
+	subscribeGateway();
+
+	deliver(deltaTopics[2], "{\"state\":{\"setpoint\":22},\"version\":5}");
+	CHECK_EQUAL_C_INT(1, deltaCallbackCount);
+	CHECK_C(&setpointFields[2] == pLastDeltaField);
+	CHECK_EQUAL_C_INT(22, setpoints[2]);
+	CHECK_EQUAL_C_INT(0, setpoints[1]);
+	CHECK_EQUAL_C_INT(5, aws_iot_shadow_gateway_get_version(&gateway, 2));
+	CHECK_EQUAL_C_INT(0, aws_iot_shadow_gateway_get_version(&gateway, 1));
+
+	deliver(deltaTopics[0], "{\"state\":{\"setpoint\":18,\"mode\":\"heat\"},\"version\":2}");
+	CHECK_EQUAL_C_INT(2, deltaCallbackCount);
+	CHECK_EQUAL_C_INT(18, setpoints[0]);
+	CHECK_EQUAL_C_INT(22, setpoints[2]);
+
+	deliver("$aws/things/portC-sensor0/shadow/update/delta", "{\"state\":{\"setpoint\":30},\"version\":9}");
+	CHECK_EQUAL_C_INT(2, deltaCallbackCount);
+
+	IOT_DEBUG("-->Success - M:3 - Deltas reach the fields of the thing named in the topic only \n");
+}
+
+/* M:4 - Deltas older than the last version of their thing are dropped */
+TEST_C(ShadowGatewayTests, OldDeltaDiscarded) {
+	IOT_DEBUG("-->Running Shadow Gateway Tests - M:4 - Deltas older than the last version of their thing are dropped \n");
+
+	CHECK_EQUAL_C_INT(SUCCESS, initGateway(GATEWAY_TEST_MAX_THINGS, GATEWAY_TEST_MAX_ACKS, sizeof(arena)));
+	addThings(2);
+	subscribeGateway();
+
+	deliver(deltaTopics[0], "{\"state\":{\"setpoint\":22},\"version\":7}");
+	deliver(deltaTopics[0], "{\"state\":{\"setpoint\":19},\"version\":6}");
+	CHECK_EQUAL_C_INT(1, deltaCallbackCount);
+	CHECK_EQUAL_C_INT(22, setpoints[0]);
+
+	// versions are kept per thing
+	deliver(deltaTopics[1], "{\"state\":{\"setpoint\":19},\"version\":6}");
+	CHECK_EQUAL_C_INT(2, deltaCallbackCount);
+	CHECK_EQUAL_C_INT(19, setpoints[1]);
+
+	IOT_DEBUG("-->Success - M:4 - Deltas older than the last version of their thing are dropped \n");
+}
+
+/* M:5 - Update carries the gateway client token and its ack reaches the callback */
+TEST_C(ShadowGatewayTests, UpdateAccepted) {
+	int context;
+	char ack[128];
+
+	IOT_DEBUG("-->Running Shadow Gateway Tests - M:5 - Update carries the gateway client token and its ack reaches the callback \n");
+
+	CHECK_EQUAL_C_INT(SUCCESS, initGateway(GATEWAY_TEST_MAX_THINGS, GATEWAY_TEST_MAX_ACKS, sizeof(arena)));
+	addThings(3);
+	subscribeGateway();
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_gateway_update(&gateway, 1, "{\"state\":{\"reported\":{\"t\":21}}}",
+															 ackCallback, &context, 5));
+	CHECK_EQUAL_C_STRING("$aws/things/portA-sensor1/shadow/update", LastPublishMessageTopic);
+	snprintf(ack, sizeof(ack), "{\"state\":{\"reported\":{\"t\":21}}, \"clientToken\":\"%s-0\"}",
+			 AWS_IOT_MQTT_CLIENT_ID);
+	CHECK_EQUAL_C_STRING(ack, LastPublishMessagePayload);
+
+	// the same token on the topic of another thing is not its ack
+	snprintf(ack, sizeof(ack), "{\"version\":3,\"clientToken\":\"%s-0\"}", AWS_IOT_MQTT_CLIENT_ID);
+	deliver("$aws/things/portA-sensor2/shadow/update/accepted", ack);
+	CHECK_EQUAL_C_INT(0, ackCallbackCount);
+
+	deliver("$aws/things/portA-sensor1/shadow/update/accepted", ack);
+	CHECK_EQUAL_C_INT(1, ackCallbackCount);
+	CHECK_EQUAL_C_STRING("portA-sensor1", ackThingName);
+	CHECK_EQUAL_C_INT(SHADOW_UPDATE, ackAction);
+	CHECK_EQUAL_C_INT(SHADOW_ACK_ACCEPTED, ackStatus);
+	CHECK_C(&context == pAckContext);
+
+	// a second ack for the same token finds nothing waiting
+	deliver("$aws/things/portA-sensor1/shadow/update/accepted", ack);
+	CHECK_EQUAL_C_INT(1, ackCallbackCount);
+
+	IOT_DEBUG("-->Success - M:5 - Update carries the gateway client token and its ack reaches the callback \n");
+}
+
+/* M:6 - Get is rejected, delete without callback sends no token */
+TEST_C(ShadowGatewayTests, GetRejectedAndDelete) {
+	char ack[128];
+
+	IOT_DEBUG("-->Running Shadow Gateway Tests - M:6 - Get is rejected, delete without callback sends no token \n");
+
+	CHECK_EQUAL_C_INT(SUCCESS, initGateway(GATEWAY_TEST_MAX_THINGS, GATEWAY_TEST_MAX_ACKS, sizeof(arena)));
+	addThings(2);
+	subscribeGateway();
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_gateway_get(&gateway, 0, ackCallback, NULL, 5));
+	CHECK_EQUAL_C_STRING("$aws/things/portA-sensor0/shadow/get", LastPublishMessageTopic);
+	snprintf(ack, sizeof(ack), "{\"clientToken\":\"%s-0\"}", AWS_IOT_MQTT_CLIENT_ID);
+	CHECK_EQUAL_C_STRING(ack, LastPublishMessagePayload);
+
+	snprintf(ack, sizeof(ack), "{\"code\":404,\"message\":\"No shadow exists\",\"clientToken\":\"%s-0\"}",
+			 AWS_IOT_MQTT_CLIENT_ID);
+	deliver("$aws/things/portA-sensor0/shadow/get/rejected", ack);
+	CHECK_EQUAL_C_INT(1, ackCallbackCount);
+	CHECK_EQUAL_C_INT(SHADOW_GET, ackAction);
+	CHECK_EQUAL_C_INT(SHADOW_ACK_REJECTED, ackStatus);
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_gateway_delete(&gateway, 1, NULL, NULL, 5));
+	CHECK_EQUAL_C_STRING("$aws/things/portA-sensor1/shadow/delete", LastPublishMessageTopic);
+	CHECK_EQUAL_C_STRING("{}", LastPublishMessagePayload);
+
+	CHECK_EQUAL_C_INT(SHADOW_JSON_ERROR, aws_iot_shadow_gateway_update(&gateway, 1, "{\"state\":{},", ackCallback,
+																	   NULL, 5));
+	CHECK_EQUAL_C_INT(FAILURE, aws_iot_shadow_gateway_update(&gateway, 2, "{}", ackCallback, NULL, 5));
+
+	IOT_DEBUG("-->Success - M:6 - Get is rejected, delete without callback sends no token \n");
+}
+
+/* M:7 - Full ack slots refuse actions, yield reports timeouts and frees them */
+TEST_C(ShadowGatewayTests, AckSlotsAndTimeout) {
+	char ack[128];
+	int i;
+
+	IOT_DEBUG("-->Running Shadow Gateway Tests - M:7 - Full ack slots refuse actions, yield reports timeouts and frees them \n");
+
+	CHECK_EQUAL_C_INT(SUCCESS, initGateway(GATEWAY_TEST_MAX_THINGS, GATEWAY_TEST_MAX_ACKS, sizeof(arena)));
+	addThings(GATEWAY_TEST_MAX_THINGS);
+	subscribeGateway();
+
+	for(i = 0; i < GATEWAY_TEST_MAX_ACKS; i++) {
+		CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_gateway_get(&gateway, (uint16_t) i, ackCallback, NULL,
+															  (0 == i) ? 1 : 5));
+	}
+	CHECK_EQUAL_C_INT(LIMIT_EXCEEDED_ERROR, aws_iot_shadow_gateway_get(&gateway, 4, ackCallback, NULL, 5));
+
+	// the ack of sequence 2 frees its slot, the next action skips the slots still waiting
+	snprintf(ack, sizeof(ack), "{\"version\":1,\"clientToken\":\"%s-2\"}", AWS_IOT_MQTT_CLIENT_ID);
+	deliver("$aws/things/portA-sensor2/shadow/get/accepted", ack);
+	CHECK_EQUAL_C_INT(1, ackCallbackCount);
+	CHECK_EQUAL_C_INT(1, aws_iot_shadow_gateway_get_version(&gateway, 2));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_gateway_get(&gateway, 4, ackCallback, NULL, 5));
+	snprintf(ack, sizeof(ack), "{\"clientToken\":\"%s-6\"}", AWS_IOT_MQTT_CLIENT_ID);
+	CHECK_EQUAL_C_STRING(ack, LastPublishMessagePayload);
+
+	sleep(2);
+	ResetTLSBuffer();
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_gateway_yield(&gateway, 10));
+	CHECK_EQUAL_C_INT(2, ackCallbackCount);
+	CHECK_EQUAL_C_STRING("portA-sensor0", ackThingName);
+	CHECK_EQUAL_C_INT(SHADOW_ACK_TIMEOUT, ackStatus);
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_gateway_get(&gateway, 5, ackCallback, NULL, 5));
+
+	IOT_DEBUG("-->Success - M:7 - Full ack slots refuse actions, yield reports timeouts and frees them \n");
+}
+
+/* Delivers GATEWAY_BENCHMARK_MESSAGES deltas spread over thingCount things, returns the average time per delta
+ * in nanoseconds */
+static double benchmarkDeltas(int thingCount) {
+	static const char document[] = "{\"state\":{\"setpoint\":21},\"version\":1}";
+	struct timespec start, end;
+	int i;
+
+	deltaCallbackCount = 0;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for(i = 0; i < GATEWAY_BENCHMARK_MESSAGES; i++) {
+		// a stride coprime to the thing count visits every thing
+		deliver(deltaTopics[((uint32_t) i * 7919u) % (uint32_t) thingCount], document);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	CHECK_EQUAL_C_INT(GATEWAY_BENCHMARK_MESSAGES, deltaCallbackCount);
+
+	return ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / GATEWAY_BENCHMARK_MESSAGES;
+}
+
+/* M:8 - Delta dispatch cost against the linear topic scan */
+TEST_C(ShadowGatewayTests, DispatchBenchmark) {
+	static const int thingCounts[] = {1, 10, 64, 256, GATEWAY_BENCHMARK_MAX_THINGS};
+	IoT_Publish_Message_Params subParams;
+	size_t arenaSize;
+	size_t n;
+	IoT_Error_t rc;
+
+	IOT_DEBUG("-->Running Shadow Gateway Tests - M:8 - Delta dispatch cost against the linear topic scan \n");
+
+	printf("\nShadow gateway delta dispatch, ns per delta, one MQTT connection\n");
+	printf("things   gateway   linear scan   arena bytes\n");
+	for(n = 0; n < sizeof(thingCounts) / sizeof(thingCounts[0]); n++) {
+		double gatewayNs, scanNs;
+
+		connectClient();
+		arenaSize = AWS_IOT_SHADOW_GATEWAY_ARENA_SIZE(thingCounts[n], GATEWAY_TEST_MAX_ACKS, GATEWAY_TEST_RX_BUFFER,
+													  thingCounts[n] * THING_NAME_SIZE);
+		CHECK_EQUAL_C_INT(SUCCESS, initGateway((uint16_t) thingCounts[n], GATEWAY_TEST_MAX_ACKS, arenaSize));
+		gateway.isDiscardOldDeltaEnabled = false;
+		addThings(thingCounts[n]);
+		subscribeGateway();
+		gatewayNs = benchmarkDeltas(thingCounts[n]);
+
+		connectClient();
+		ResetTLSBuffer();
+		memset(&subParams, 0, sizeof(subParams));
+		setTLSRxBufferForSuback(LINEAR_SCAN_FILTER, strlen(LINEAR_SCAN_FILTER), QOS0, subParams);
+		rc = aws_iot_mqtt_subscribe(&client, LINEAR_SCAN_FILTER, (uint16_t) strlen(LINEAR_SCAN_FILTER), QOS0,
+									linearScanCallback, NULL);
+		CHECK_EQUAL_C_INT(SUCCESS, rc);
+		linearScanThingCount = thingCounts[n];
+		scanNs = benchmarkDeltas(thingCounts[n]);
+
+		printf("%6d %9.0f %13.0f %13u\n", thingCounts[n], gatewayNs, scanNs, (unsigned) arenaSize);
+	}
+
+	IOT_DEBUG("-->Success - M:8 - Delta dispatch cost against the linear topic scan \n");
+}
@@ -18,11 +18,17 @@
  * @brief IoT Client Unit Testing - Shadow JSON Builder Tests Helper
  */
 
+#include <stdio.h>
+#include <stdarg.h>
 #include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
 #include <CppUTest/TestHarness_c.h>
 #include <aws_iot_shadow_interface.h>
 
 #include "aws_iot_shadow_actions.h"
+#include "aws_iot_shadow_json.h"
 #include "aws_iot_log.h"
 #include "aws_iot_tests_unit_helper_functions.h"
 
@@ -129,3 +135,352 @@ TEST_C(ShadowJsonBuilderTests, SmallBuffer) {
 	ret_val = aws_iot_finalize_json_document(updateRequestJson, jsonBufSize);
 	CHECK_EQUAL_C_INT(SHADOW_JSON_ERROR, ret_val);
 }
+
+#define TEST_JSON_TOKEN_SUFFIX(n) "}, \"clientToken\":\"" AWS_IOT_MQTT_CLIENT_ID "-" #n "\"}"
+
+/* Documents built per field count in the benchmark */
+#define BUILDER_BENCHMARK_DOCUMENTS 20000
+#define MAX_BENCHMARK_FIELDS 48
+
+static void beginReportedDocument(ShadowJsonWriter_t *pWriter, char *pBuffer, size_t bufferSize) {
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_json_writer_init(pWriter, pBuffer, bufferSize));
+	aws_iot_shadow_json_writer_begin_object(pWriter, NULL);
+	aws_iot_shadow_json_writer_begin_object(pWriter, "state");
+	aws_iot_shadow_json_writer_begin_object(pWriter, "reported");
+}
+
+/* Formats a single value with the writer and with the printf conversion the old builder used */
+static void checkValueMatchesPrintf(JsonPrimitiveType type, const void *pData, const char *pFormat, ...) {
+	ShadowJsonWriter_t writer;
+	char written[64];
+	char expected[64];
+	va_list pArgs;
+
+	va_start(pArgs, pFormat);
+	vsnprintf(expected, sizeof(expected), pFormat, pArgs);
+	va_end(pArgs);
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_json_writer_init(&writer, written, sizeof(written)));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_json_writer_add_value(&writer, type, pData));
+	CHECK_EQUAL_C_STRING(expected, written);
+	CHECK_EQUAL_C_INT((int) strlen(expected), (int) writer.offset);
+}
+
+TEST_C(ShadowJsonBuilderTests, WriterMatchesLegacyDocument) {
+	ShadowJsonWriter_t writer;
+	char updateRequestJson[SIZE_OF_UPFATE_BUF];
+
+	IOT_DEBUG("\n-->Running Shadow Json Builder Tests - Writer builds the same document \n");
+
+	beginReportedDocument(&writer, updateRequestJson, sizeof(updateRequestJson));
+	aws_iot_shadow_json_writer_add(&writer, &dataDoubleHandler);
+	aws_iot_shadow_json_writer_add(&writer, &dataFloatHandler);
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_json_writer_finalize(&writer));
+
+	CHECK_EQUAL_C_STRING(TEST_JSON_RESPONSE_UPDATE_DOCUMENT, updateRequestJson);
+	CHECK_EQUAL_C_INT((int) strlen(updateRequestJson), (int) writer.offset);
+}
+
+TEST_C(ShadowJsonBuilderTests, WriterNestedObjectsAndArrays) {
+	ShadowJsonWriter_t writer;
+	char updateRequestJson[SIZE_OF_UPFATE_BUF];
+	int32_t samples[] = {1, -2, 3};
+	bool isOn = false;
+	bool isOk = true;
+	char mode[] = "eco";
+	jsonStruct_t field;
+	size_t i;
+
+	IOT_DEBUG("\n-->Running Shadow Json Builder Tests - Writer nested objects and arrays \n");
+
+	beginReportedDocument(&writer, updateRequestJson, sizeof(updateRequestJson));
+	aws_iot_shadow_json_writer_begin_object(&writer, "sensor");
+	aws_iot_shadow_json_writer_add(&writer, &dataFloatHandler);
+	field.pKey = "ok";
+	field.pData = &isOk;
+	field.type = SHADOW_JSON_BOOL;
+	aws_iot_shadow_json_writer_add(&writer, &field);
+	aws_iot_shadow_json_writer_end_object(&writer);
+	aws_iot_shadow_json_writer_begin_array(&writer, "samples");
+	for(i = 0; i < sizeof(samples) / sizeof(samples[0]); i++) {
+		aws_iot_shadow_json_writer_add_value(&writer, SHADOW_JSON_INT32, &samples[i]);
+	}
+	aws_iot_shadow_json_writer_end_array(&writer);
+	aws_iot_shadow_json_writer_begin_array(&writer, "modes");
+	aws_iot_shadow_json_writer_begin_object(&writer, NULL);
+	field.pKey = "name";
+	field.pData = mode;
+	field.type = SHADOW_JSON_STRING;
+	aws_iot_shadow_json_writer_add(&writer, &field);
+	aws_iot_shadow_json_writer_end_object(&writer);
+	aws_iot_shadow_json_writer_end_array(&writer);
+	aws_iot_shadow_json_writer_end_object(&writer);
+	aws_iot_shadow_json_writer_begin_object(&writer, "desired");
+	field.pKey = "on";
+	field.pData = &isOn;
+	field.type = SHADOW_JSON_BOOL;
+	aws_iot_shadow_json_writer_add(&writer, &field);
+	/* finalize closes "desired" and "state" */
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_json_writer_finalize(&writer));
+
+	CHECK_EQUAL_C_STRING("{\"state\":{\"reported\":{\"sensor\":{\"floatData\":3.445000,\"ok\":true},"
+						 "\"samples\":[1,-2,3],\"modes\":[{\"name\":\"eco\"}]},\"desired\":{\"on\":false}"
+						 TEST_JSON_TOKEN_SUFFIX(0), updateRequestJson);
+}
+
+TEST_C(ShadowJsonBuilderTests, WriterDeltaOnlyReporting) {
+	ShadowJsonWriter_t writer;
+	char updateRequestJson[SIZE_OF_UPFATE_BUF];
+	double lastDouble = 0;
+	float lastFloat = 0;
+
+	IOT_DEBUG("\n-->Running Shadow Json Builder Tests - Writer reports only changed values \n");
+
+	beginReportedDocument(&writer, updateRequestJson, sizeof(updateRequestJson));
+	aws_iot_shadow_json_writer_add_if_changed(&writer, &dataDoubleHandler, &lastDouble);
+	aws_iot_shadow_json_writer_add_if_changed(&writer, &dataFloatHandler, &lastFloat);
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_json_writer_finalize(&writer));
+	CHECK_EQUAL_C_STRING(TEST_JSON_RESPONSE_UPDATE_DOCUMENT, updateRequestJson);
+
+	floatData = 2.5f;
+	beginReportedDocument(&writer, updateRequestJson, sizeof(updateRequestJson));
+	aws_iot_shadow_json_writer_add_if_changed(&writer, &dataDoubleHandler, &lastDouble);
+	aws_iot_shadow_json_writer_add_if_changed(&writer, &dataFloatHandler, &lastFloat);
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_json_writer_finalize(&writer));
+	CHECK_EQUAL_C_STRING("{\"state\":{\"reported\":{\"floatData\":2.500000}" TEST_JSON_TOKEN_SUFFIX(1),
+						 updateRequestJson);
+
+	beginReportedDocument(&writer, updateRequestJson, sizeof(updateRequestJson));
+	aws_iot_shadow_json_writer_add_if_changed(&writer, &dataDoubleHandler, &lastDouble);
+	aws_iot_shadow_json_writer_add_if_changed(&writer, &dataFloatHandler, &lastFloat);
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_json_writer_finalize(&writer));
+	CHECK_EQUAL_C_STRING("{\"state\":{\"reported\":{}" TEST_JSON_TOKEN_SUFFIX(2), updateRequestJson);
+
+	floatData = 3.445f;
+}
+
+TEST_C(ShadowJsonBuilderTests, WriterNumbersMatchPrintf) {
+	static const double doubles[] = {0.0, -0.0, 1.0, -1.0, 0.5, 2.5, 0.0078125, 0.0234375, 1.0000005,
+									 0.0000005, 0.00000049999999999999999, -0.0000004, 123456.7890125,
+									 4294967295.9999995, 9999999999999.0, 1e13, -1e13, 1e20, 4.0908f};
+	int32_t int32Values[] = {0, 1, -1, INT32_MAX, INT32_MIN};
+	uint32_t uint32Values[] = {0, 9, 10, UINT32_MAX};
+	int16_t int16Value = INT16_MIN;
+	uint16_t uint16Value = UINT16_MAX;
+	int8_t int8Value = INT8_MIN;
+	uint8_t uint8Value = UINT8_MAX;
+	uint32_t seed = 12345;
+	double value;
+	float floatValue;
+	size_t i;
+
+	IOT_DEBUG("\n-->Running Shadow Json Builder Tests - Writer numbers match printf \n");
+
+	for(i = 0; i < sizeof(int32Values) / sizeof(int32Values[0]); i++) {
+		checkValueMatchesPrintf(SHADOW_JSON_INT32, &int32Values[i], "%i", int32Values[i]);
+	}
+	for(i = 0; i < sizeof(uint32Values) / sizeof(uint32Values[0]); i++) {
+		checkValueMatchesPrintf(SHADOW_JSON_UINT32, &uint32Values[i], "%u", uint32Values[i]);
+	}
+	checkValueMatchesPrintf(SHADOW_JSON_INT16, &int16Value, "%hi", int16Value);
+	checkValueMatchesPrintf(SHADOW_JSON_UINT16, &uint16Value, "%hu", uint16Value);
+	checkValueMatchesPrintf(SHADOW_JSON_INT8, &int8Value, "%hhi", int8Value);
+	checkValueMatchesPrintf(SHADOW_JSON_UINT8, &uint8Value, "%hhu", uint8Value);
+
+	for(i = 0; i < sizeof(doubles) / sizeof(doubles[0]); i++) {
+		checkValueMatchesPrintf(SHADOW_JSON_DOUBLE, &doubles[i], "%f", doubles[i]);
+	}
+
+	/* Values spread over every magnitude, including halfway cases at multiples of 2^-7 */
+	for(i = 0; i < 100000; i++) {
+		seed = seed * 1103515245 + 12345;
+		value = (double) (seed >> 8) / (double) (1 << (seed % 31));
+		if(i % 4 == 0) {
+			value = (double) (seed % 100000) / 128.0;
+		}
+		if(i % 2 != 0) {
+			value = -value;
+		}
+		checkValueMatchesPrintf(SHADOW_JSON_DOUBLE, &value, "%f", value);
+		floatValue = (float) value;
+		checkValueMatchesPrintf(SHADOW_JSON_FLOAT, &floatValue, "%f", floatValue);
+	}
+}
+
+TEST_C(ShadowJsonBuilderTests, WriterSmallBuffer) {
+	ShadowJsonWriter_t writer;
+	char updateRequestJson[24];
+
+	IOT_DEBUG("\n-->Running Shadow Json Builder Tests - Writer buffer is too small \n");
+
+	beginReportedDocument(&writer, updateRequestJson, sizeof(updateRequestJson));
+	CHECK_EQUAL_C_INT(SHADOW_JSON_BUFFER_TRUNCATED, aws_iot_shadow_json_writer_add(&writer, &dataDoubleHandler));
+	CHECK_EQUAL_C_INT(sizeof(updateRequestJson) - 1, writer.offset);
+	CHECK_EQUAL_C_STRING("{\"state\":{\"reported\":{\"", updateRequestJson);
+
+	/* The first error sticks */
+	CHECK_EQUAL_C_INT(SHADOW_JSON_BUFFER_TRUNCATED, aws_iot_shadow_json_writer_add(&writer, NULL));
+	CHECK_EQUAL_C_INT(SHADOW_JSON_BUFFER_TRUNCATED, aws_iot_shadow_json_writer_finalize(&writer));
+	CHECK_EQUAL_C_INT(sizeof(updateRequestJson) - 1, strlen(updateRequestJson));
+}
+
+TEST_C(ShadowJsonBuilderTests, WriterStructureErrors) {
+	ShadowJsonWriter_t writer;
+	char updateRequestJson[SIZE_OF_UPFATE_BUF];
+	int32_t value = 1;
+
+	IOT_DEBUG("\n-->Running Shadow Json Builder Tests - Writer structure errors \n");
+
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_shadow_json_writer_init(NULL, updateRequestJson, 1));
+	CHECK_EQUAL_C_INT(SHADOW_JSON_ERROR, aws_iot_shadow_json_writer_init(&writer, updateRequestJson, 0));
+
+	beginReportedDocument(&writer, updateRequestJson, sizeof(updateRequestJson));
+	CHECK_EQUAL_C_INT(SHADOW_JSON_ERROR, aws_iot_shadow_json_writer_end_array(&writer));
+
+	beginReportedDocument(&writer, updateRequestJson, sizeof(updateRequestJson));
+	CHECK_EQUAL_C_INT(SHADOW_JSON_ERROR, aws_iot_shadow_json_writer_add_value(&writer, SHADOW_JSON_INT32, &value));
+
+	beginReportedDocument(&writer, updateRequestJson, sizeof(updateRequestJson));
+	aws_iot_shadow_json_writer_begin_array(&writer, "values");
+	CHECK_EQUAL_C_INT(SHADOW_JSON_ERROR, aws_iot_shadow_json_writer_add(&writer, &dataDoubleHandler));
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_json_writer_init(&writer, updateRequestJson, sizeof(updateRequestJson)));
+	CHECK_EQUAL_C_INT(SHADOW_JSON_ERROR, aws_iot_shadow_json_writer_finalize(&writer));
+}
+
+TEST_C(ShadowJsonBuilderTests, EmptyReportedSection) {
+	IoT_Error_t ret_val;
+	char updateRequestJson[SIZE_OF_UPFATE_BUF];
+	size_t jsonBufSize = sizeof(updateRequestJson) / sizeof(updateRequestJson[0]);
+
+	IOT_DEBUG("\n-->Running Shadow Json Builder Tests - Reported section without values \n");
+
+	ret_val = aws_iot_shadow_init_json_document(updateRequestJson, jsonBufSize);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	ret_val = aws_iot_shadow_add_reported(updateRequestJson, jsonBufSize, 0);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	ret_val = aws_iot_shadow_add_desired(updateRequestJson, jsonBufSize, 1, &dataFloatHandler);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	ret_val = aws_iot_finalize_json_document(updateRequestJson, jsonBufSize);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+
+	CHECK_EQUAL_C_STRING("{\"state\":{\"reported\":{},\"desired\":{\"floatData\":3.445000}" TEST_JSON_TOKEN_SUFFIX(0),
+						 updateRequestJson);
+}
+
+/* The builder before the writer: strlen of the whole document and a printf conversion for every value */
+static void buildWithStrlen(char *pDocument, size_t documentSize, jsonStruct_t *pFields, int fieldCount) {
+	int i;
+
+	snprintf(pDocument, documentSize, "{\"state\":{\"reported\":{");
+	for(i = 0; i < fieldCount; i++) {
+		snprintf(pDocument + strlen(pDocument), documentSize - strlen(pDocument), "\"%s\":", pFields[i].pKey);
+		if(pFields[i].type == SHADOW_JSON_INT32) {
+			snprintf(pDocument + strlen(pDocument), documentSize - strlen(pDocument), "%i,",
+					 *(int32_t *) pFields[i].pData);
+		} else if(pFields[i].type == SHADOW_JSON_FLOAT) {
+			snprintf(pDocument + strlen(pDocument), documentSize - strlen(pDocument), "%f,",
+					 *(float *) pFields[i].pData);
+		} else if(pFields[i].type == SHADOW_JSON_BOOL) {
+			snprintf(pDocument + strlen(pDocument), documentSize - strlen(pDocument), "%s,",
+					 *(bool *) pFields[i].pData ? "true" : "false");
+		} else {
+			snprintf(pDocument + strlen(pDocument), documentSize - strlen(pDocument), "\"%s\",",
+					 (char *) pFields[i].pData);
+		}
+	}
+	snprintf(pDocument + strlen(pDocument) - 1, documentSize - strlen(pDocument), "},");
+	snprintf(pDocument + strlen(pDocument) - 1, documentSize - strlen(pDocument), "}, \"clientToken\":\"");
+	aws_iot_fill_with_client_token(pDocument + strlen(pDocument), documentSize - strlen(pDocument));
+	snprintf(pDocument + strlen(pDocument), documentSize - strlen(pDocument), "\"}");
+}
+
+static void buildWithWriter(char *pDocument, size_t documentSize, jsonStruct_t *pFields, int fieldCount) {
+	ShadowJsonWriter_t writer;
+	int i;
+
+	beginReportedDocument(&writer, pDocument, documentSize);
+	for(i = 0; i < fieldCount; i++) {
+		aws_iot_shadow_json_writer_add(&writer, &pFields[i]);
+	}
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_json_writer_finalize(&writer));
+}
+
+static double benchmarkBuilder(bool isStrlen, char *pDocument, size_t documentSize, jsonStruct_t *pFields,
+							   int fieldCount) {
+	struct timespec start, end;
+	int i;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for(i = 0; i < BUILDER_BENCHMARK_DOCUMENTS; i++) {
+		if(isStrlen) {
+			buildWithStrlen(pDocument, documentSize, pFields, fieldCount);
+		} else {
+			buildWithWriter(pDocument, documentSize, pFields, fieldCount);
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	return BUILDER_BENCHMARK_DOCUMENTS /
+		   ((end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9);
+}
+
+TEST_C(ShadowJsonBuilderTests, BuilderBenchmark) {
+	static const int fieldCounts[] = {4, 16, MAX_BENCHMARK_FIELDS};
+	static char keys[MAX_BENCHMARK_FIELDS][16];
+	static int32_t intValues[MAX_BENCHMARK_FIELDS];
+	static float floatValues[MAX_BENCHMARK_FIELDS];
+	static bool boolValues[MAX_BENCHMARK_FIELDS];
+	static char stringValue[] = "heating";
+	jsonStruct_t fields[MAX_BENCHMARK_FIELDS];
+	char writerDocument[2048];
+	char strlenDocument[2048];
+	size_t n;
+	int i;
+
+	IOT_DEBUG("\n-->Running Shadow Json Builder Tests - Builder benchmark \n");
+
+	for(i = 0; i < MAX_BENCHMARK_FIELDS; i++) {
+		snprintf(keys[i], sizeof(keys[i]), "sensor_%02d", i);
+		intValues[i] = i * 1237 - 20000;
+		floatValues[i] = 21.5f + (float) i * 0.37f;
+		boolValues[i] = (i & 1) != 0;
+		fields[i].pKey = keys[i];
+		fields[i].cb = NULL;
+		switch(i % 4) {
+			case 0:
+				fields[i].type = SHADOW_JSON_INT32;
+				fields[i].pData = &intValues[i];
+				break;
+			case 1:
+				fields[i].type = SHADOW_JSON_FLOAT;
+				fields[i].pData = &floatValues[i];
+				break;
+			case 2:
+				fields[i].type = SHADOW_JSON_BOOL;
+				fields[i].pData = &boolValues[i];
+				break;
+			default:
+				fields[i].type = SHADOW_JSON_STRING;
+				fields[i].pData = stringValue;
+				break;
+		}
+	}
+
+	printf("\nShadow JSON builder, documents per second\n");
+	printf("fields       writer       strlen\n");
+	for(n = 0; n < sizeof(fieldCounts) / sizeof(fieldCounts[0]); n++) {
+		double writerRate, strlenRate;
+
+		/* Both builders produce the same document */
+		resetClientTokenSequenceNum();
+		buildWithWriter(writerDocument, sizeof(writerDocument), fields, fieldCounts[n]);
+		resetClientTokenSequenceNum();
+		buildWithStrlen(strlenDocument, sizeof(strlenDocument), fields, fieldCounts[n]);
+		CHECK_EQUAL_C_STRING(strlenDocument, writerDocument);
+
+		writerRate = benchmarkBuilder(false, writerDocument, sizeof(writerDocument), fields, fieldCounts[n]);
+		strlenRate = benchmarkBuilder(true, strlenDocument, sizeof(strlenDocument), fields, fieldCounts[n]);
+		printf("%6d %12.0f %12.0f\n", fieldCounts[n], writerRate, strlenRate);
+	}
+}
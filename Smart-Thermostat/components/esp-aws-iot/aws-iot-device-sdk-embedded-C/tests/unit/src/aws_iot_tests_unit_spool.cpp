@@ -0,0 +1,49 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+/**
+ * @file aws_iot_tests_unit_spool.cpp
+ * @brief IoT Client Unit Testing - Spool Tests
+ */
+
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTest/TestHarness_c.h>
+
+TEST_GROUP_C(SpoolTests){
+	TEST_GROUP_C_SETUP_WRAPPER(SpoolTests)
+	TEST_GROUP_C_TEARDOWN_WRAPPER(SpoolTests)
+};
+
+/* S:1 - Records and sequence numbers survive reopening the spool */
+TEST_GROUP_C_WRAPPER(SpoolTests, RecordsSurviveReopen)
+/* S:2 - A record torn by a power loss is cut off and the log stays usable */
+TEST_GROUP_C_WRAPPER(SpoolTests, TornRecordCutOff)
+/* S:3 - A record with a wrong CRC ends the log */
+TEST_GROUP_C_WRAPPER(SpoolTests, CorruptRecordDropped)
+/* S:4 - Replay publishes one batch, commits it and keeps the sequence numbers going */
+TEST_GROUP_C_WRAPPER(SpoolTests, ReplayCommitsBatch)
+/* S:5 - Records that do not fit in one batch go out with the next calls, in order and once */
+TEST_GROUP_C_WRAPPER(SpoolTests, ReplaySplitsBatches)
+/* S:6 - A second batch waits for the batch interval */
+TEST_GROUP_C_WRAPPER(SpoolTests, ReplayRateLimited)
+/* S:7 - A failed publish commits nothing and the same records are sent again */
+TEST_GROUP_C_WRAPPER(SpoolTests, FailedPublishNotCommitted)
+/* S:8 - Committed records are never replayed, also when the log could not be rewritten yet */
+TEST_GROUP_C_WRAPPER(SpoolTests, CommittedRecordsSkipped)
+/* S:9 - A full spool refuses records until replay made room */
+TEST_GROUP_C_WRAPPER(SpoolTests, FullSpoolRefuses)
+/* S:10 - A rewrite stopped by a power loss leaves either the old or the new log */
+TEST_GROUP_C_WRAPPER(SpoolTests, InterruptedRewriteRecovered)
+/* S:11 - With a sync interval, appends sync every few records and aws_iot_spool_sync saves the rest */
+TEST_GROUP_C_WRAPPER(SpoolTests, SyncInterval)
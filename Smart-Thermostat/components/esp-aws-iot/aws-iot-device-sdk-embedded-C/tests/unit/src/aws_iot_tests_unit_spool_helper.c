@@ -0,0 +1,446 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+/**
+ * @file aws_iot_tests_unit_spool_helper.c
+ * @brief IoT Client Unit Testing - Spool Tests Helper
+ *
+ * The spool is kept in a file in the working directory, which stands in for the SD card or flash file system
+ * of a device. A power loss is simulated by closing the file without any further write and opening it again.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <CppUTest/TestHarness_c.h>
+
+#include "aws_iot_tests_unit_helper_functions.h"
+#include "aws_iot_tests_unit_mock_tls_params.h"
+#include "aws_iot_spool.h"
+#include "aws_iot_log.h"
+
+#define SPOOL_PATH "aws_iot_tests_unit_spool.log"
+#define SPOOL_TMP_PATH SPOOL_PATH ".tmp"
+#define SPOOL_MAX_BYTES 4096
+
+static IoT_Client_Init_Params initParams;
+static IoT_Client_Connect_Params connectParams;
+static AWS_IoT_Client iotClient;
+
+static AWS_IoT_Spool_Storage storage;
+static AWS_IoT_Spool_File spoolFile;
+static AWS_IoT_Spool spool;
+static uint8_t batchBuffer[512];
+
+static const char *pTestTopic = "sdk/Test/spool";
+
+static IoT_Error_t openSpool(uint32_t maxBytes, uint32_t batchInterval_ms) {
+	IoT_Error_t rc = aws_iot_spool_file_open(&storage, &spoolFile, SPOOL_PATH);
+	if(SUCCESS != rc) {
+		return rc;
+	}
+	return aws_iot_spool_init(&spool, &storage, maxBytes, batchInterval_ms);
+}
+
+/* Closes the file like a power loss would, everything appended was synced already */
+static IoT_Error_t reopenSpool(uint32_t maxBytes, uint32_t batchInterval_ms) {
+	aws_iot_spool_file_close(&spoolFile);
+	return openSpool(maxBytes, batchInterval_ms);
+}
+
+static void appendReadings(int first, int count) {
+	char reading[32];
+	int i;
+
+	for(i = first; i < first + count; i++) {
+		snprintf(reading, sizeof(reading), "reading %d", i);
+		CHECK_EQUAL_C_INT(SUCCESS, aws_iot_spool_append(&spool, reading, (uint16_t) strlen(reading), NULL));
+	}
+}
+
+static long spoolFileSize(void) {
+	long size;
+	FILE *pFile = fopen(SPOOL_PATH, "rb");
+
+	if(NULL == pFile) {
+		return -1;
+	}
+	fseek(pFile, 0, SEEK_END);
+	size = ftell(pFile);
+	fclose(pFile);
+	return size;
+}
+
+static uint32_t getU32(const char *pBuf) {
+	const uint8_t *p = (const uint8_t *) pBuf;
+	return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static uint16_t getU16(const char *pBuf) {
+	const uint8_t *p = (const uint8_t *) pBuf;
+	return (uint16_t) (p[0] | (p[1] << 8));
+}
+
+/* Checks the last published batch holds count records, the first with sequence number firstSeq */
+static void checkLastBatch(uint16_t count, uint32_t firstSeq) {
+	size_t cursor = 3;
+	uint16_t i, len;
+
+	CHECK_EQUAL_C_STRING(pTestTopic, LastPublishMessageTopic);
+	CHECK_EQUAL_C_INT(AWS_IOT_SPOOL_BATCH_VERSION, (uint8_t) LastPublishMessagePayload[0]);
+	CHECK_EQUAL_C_INT(count, getU16(&LastPublishMessagePayload[1]));
+	for(i = 0; i < count; i++) {
+		CHECK_EQUAL_C_INT(firstSeq + i, getU32(&LastPublishMessagePayload[cursor]));
+		len = getU16(&LastPublishMessagePayload[cursor + 4]);
+		cursor += 6 + len;
+	}
+	CHECK_EQUAL_C_INT(lastPublishMessagePayloadLen, cursor);
+}
+
+TEST_GROUP_C_SETUP(SpoolTests) {
+	IoT_Error_t rc;
+
+	remove(SPOOL_PATH);
+	remove(SPOOL_TMP_PATH);
+
+	ResetTLSBuffer();
+	InitMQTTParamsSetup(&initParams, AWS_IOT_MQTT_HOST, AWS_IOT_MQTT_PORT, false, NULL);
+	rc = aws_iot_mqtt_init(&iotClient, &initParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	ConnectMQTTParamsSetup(&connectParams, AWS_IOT_MQTT_CLIENT_ID, (uint16_t) strlen(AWS_IOT_MQTT_CLIENT_ID));
+	setTLSRxBufferForConnack(&connectParams, 0, 0);
+	rc = aws_iot_mqtt_connect(&iotClient, &connectParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	ResetTLSBuffer();
+
+	rc = openSpool(SPOOL_MAX_BYTES, 0);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+}
+
+TEST_GROUP_C_TEARDOWN(SpoolTests) {
+	IoT_Error_t rc = aws_iot_mqtt_disconnect(&iotClient);
+	IOT_UNUSED(rc);
+
+	aws_iot_spool_file_close(&spoolFile);
+	remove(SPOOL_PATH);
+	remove(SPOOL_TMP_PATH);
+}
+
+/* S:1 - Records and sequence numbers survive reopening the spool */
+TEST_C(SpoolTests, RecordsSurviveReopen) {
+	uint32_t seq = 0;
+
+	IOT_DEBUG("-->Running Spool Tests - S:1 - Records and sequence numbers survive reopening the spool \n");
+
+	CHECK_EQUAL_C_INT(0, aws_iot_spool_pending(&spool));
+	appendReadings(1, 3);
+	CHECK_EQUAL_C_INT(3, aws_iot_spool_pending(&spool));
+
+	CHECK_EQUAL_C_INT(SUCCESS, reopenSpool(SPOOL_MAX_BYTES, 0));
+	CHECK_EQUAL_C_INT(3, aws_iot_spool_pending(&spool));
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_spool_append(&spool, "reading 4", 9, &seq));
+	CHECK_EQUAL_C_INT(4, seq);
+
+	IOT_DEBUG("-->Success - S:1 - Records and sequence numbers survive reopening the spool \n");
+}
+
+/* S:2 - A record torn by a power loss is cut off and the log stays usable */
+TEST_C(SpoolTests, TornRecordCutOff) {
+	AWS_IoT_Spool_Metrics metrics;
+	const uint8_t torn[] = {AWS_IOT_SPOOL_RECORD_MAGIC, 1, 9, 0, 3, 0, 0, 0, 'r', 'e', 'a'};
+	uint32_t seq = 0;
+	FILE *pFile;
+
+	IOT_DEBUG("-->Running Spool Tests - S:2 - A record torn by a power loss is cut off \n");
+
+	appendReadings(1, 2);
+	aws_iot_spool_file_close(&spoolFile);
+	pFile = fopen(SPOOL_PATH, "ab");
+	fwrite(torn, 1, sizeof(torn), pFile);
+	fclose(pFile);
+
+	CHECK_EQUAL_C_INT(SUCCESS, openSpool(SPOOL_MAX_BYTES, 0));
+	CHECK_EQUAL_C_INT(2, aws_iot_spool_pending(&spool));
+	aws_iot_spool_get_metrics(&spool, &metrics);
+	CHECK_EQUAL_C_INT(sizeof(torn), metrics.discardedBytes);
+	CHECK_EQUAL_C_INT(2 * (AWS_IOT_SPOOL_RECORD_OVERHEAD + 9), spoolFileSize());
+
+	/* A record appended after the cut is found again */
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_spool_append(&spool, "reading 3", 9, &seq));
+	CHECK_EQUAL_C_INT(3, seq);
+	CHECK_EQUAL_C_INT(SUCCESS, reopenSpool(SPOOL_MAX_BYTES, 0));
+	CHECK_EQUAL_C_INT(3, aws_iot_spool_pending(&spool));
+
+	IOT_DEBUG("-->Success - S:2 - A record torn by a power loss is cut off \n");
+}
+
+/* S:3 - A record with a wrong CRC ends the log */
+TEST_C(SpoolTests, CorruptRecordDropped) {
+	FILE *pFile;
+
+	IOT_DEBUG("-->Running Spool Tests - S:3 - A record with a wrong CRC ends the log \n");
+
+	appendReadings(1, 2);
+	aws_iot_spool_file_close(&spoolFile);
+	pFile = fopen(SPOOL_PATH, "r+b");
+	fseek(pFile, AWS_IOT_SPOOL_RECORD_OVERHEAD + 9 + AWS_IOT_SPOOL_RECORD_HEADER_LEN, SEEK_SET);
+	fputc('X', pFile);
+	fclose(pFile);
+
+	CHECK_EQUAL_C_INT(SUCCESS, openSpool(SPOOL_MAX_BYTES, 0));
+	CHECK_EQUAL_C_INT(1, aws_iot_spool_pending(&spool));
+
+	IOT_DEBUG("-->Success - S:3 - A record with a wrong CRC ends the log \n");
+}
+
+/* S:4 - Replay publishes one batch, commits it and keeps the sequence numbers going */
+TEST_C(SpoolTests, ReplayCommitsBatch) {
+	AWS_IoT_Spool_Metrics metrics;
+	uint32_t replayed = 0, seq = 0;
+	IoT_Error_t rc;
+
+	IOT_DEBUG("-->Running Spool Tests - S:4 - Replay publishes one batch and commits it \n");
+
+	appendReadings(1, 5);
+	setTLSRxBufferForPuback();
+	rc = aws_iot_spool_replay(&spool, &iotClient, pTestTopic, (uint16_t) strlen(pTestTopic), batchBuffer,
+							  sizeof(batchBuffer), &replayed);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(5, replayed);
+	checkLastBatch(5, 1);
+	CHECK_EQUAL_C_INT(0, aws_iot_spool_pending(&spool));
+
+	/* Only the commit record is left, the next record carries on from it after a reboot */
+	CHECK_EQUAL_C_INT(AWS_IOT_SPOOL_RECORD_OVERHEAD, spoolFileSize());
+	aws_iot_spool_get_metrics(&spool, &metrics);
+	CHECK_EQUAL_C_INT(1, metrics.batches);
+	CHECK_EQUAL_C_INT(1, metrics.rewrites);
+	CHECK_EQUAL_C_INT(SUCCESS, reopenSpool(SPOOL_MAX_BYTES, 0));
+	CHECK_EQUAL_C_INT(0, aws_iot_spool_pending(&spool));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_spool_append(&spool, "reading 6", 9, &seq));
+	CHECK_EQUAL_C_INT(6, seq);
+
+	IOT_DEBUG("-->Success - S:4 - Replay publishes one batch and commits it \n");
+}
+
+/* S:5 - Records that do not fit in one batch go out with the next calls, in order and once */
+TEST_C(SpoolTests, ReplaySplitsBatches) {
+	uint32_t replayed = 0, total = 0, firstSeq = 1;
+	int batches = 0;
+	IoT_Error_t rc;
+
+	IOT_DEBUG("-->Running Spool Tests - S:5 - Records that do not fit go out with the next batch \n");
+
+	appendReadings(10, 20);
+	while(0 < aws_iot_spool_pending(&spool) && batches < 10) {
+		setTLSRxBufferForPuback();
+		rc = aws_iot_spool_replay(&spool, &iotClient, pTestTopic, (uint16_t) strlen(pTestTopic), batchBuffer, 64,
+								  &replayed);
+		CHECK_EQUAL_C_INT(SUCCESS, rc);
+		CHECK_C(0 < replayed);
+		checkLastBatch((uint16_t) replayed, firstSeq);
+		firstSeq += replayed;
+		total += replayed;
+		batches++;
+	}
+
+	CHECK_EQUAL_C_INT(20, total);
+	CHECK_C(1 < batches);
+	CHECK_EQUAL_C_INT(0, aws_iot_spool_pending(&spool));
+
+	IOT_DEBUG("-->Success - S:5 - Records that do not fit go out with the next batch \n");
+}
+
+/* S:6 - A second batch waits for the batch interval */
+TEST_C(SpoolTests, ReplayRateLimited) {
+	AWS_IoT_Spool_Metrics metrics;
+	uint32_t replayed = 0;
+	IoT_Error_t rc;
+
+	IOT_DEBUG("-->Running Spool Tests - S:6 - A second batch waits for the batch interval \n");
+
+	CHECK_EQUAL_C_INT(SUCCESS, reopenSpool(SPOOL_MAX_BYTES, 60000));
+	appendReadings(1, 4);
+
+	setTLSRxBufferForPuback();
+	rc = aws_iot_spool_replay(&spool, &iotClient, pTestTopic, (uint16_t) strlen(pTestTopic), batchBuffer, 40,
+							  &replayed);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_C(0 < replayed && 4 > replayed);
+
+	ResetTLSBuffer();
+	rc = aws_iot_spool_replay(&spool, &iotClient, pTestTopic, (uint16_t) strlen(pTestTopic), batchBuffer, 40,
+							  &replayed);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(0, replayed);
+	CHECK_EQUAL_C_INT(0, TxBuffer.len);
+	aws_iot_spool_get_metrics(&spool, &metrics);
+	CHECK_EQUAL_C_INT(1, metrics.rateLimited);
+
+	IOT_DEBUG("-->Success - S:6 - A second batch waits for the batch interval \n");
+}
+
+/* S:7 - A failed publish commits nothing and the same records are sent again */
+TEST_C(SpoolTests, FailedPublishNotCommitted) {
+	uint32_t replayed = 0;
+	IoT_Error_t rc;
+
+	IOT_DEBUG("-->Running Spool Tests - S:7 - A failed publish commits nothing \n");
+
+	appendReadings(1, 3);
+	setTLSTxBufferForError(NETWORK_SSL_WRITE_ERROR);
+	rc = aws_iot_spool_replay(&spool, &iotClient, pTestTopic, (uint16_t) strlen(pTestTopic), batchBuffer,
+							  sizeof(batchBuffer), &replayed);
+	CHECK_EQUAL_C_INT(NETWORK_SSL_WRITE_ERROR, rc);
+	CHECK_EQUAL_C_INT(0, replayed);
+	CHECK_EQUAL_C_INT(3, aws_iot_spool_pending(&spool));
+
+	CHECK_EQUAL_C_INT(SUCCESS, reopenSpool(SPOOL_MAX_BYTES, 0));
+	CHECK_EQUAL_C_INT(3, aws_iot_spool_pending(&spool));
+	setTLSRxBufferForPuback();
+	rc = aws_iot_spool_replay(&spool, &iotClient, pTestTopic, (uint16_t) strlen(pTestTopic), batchBuffer,
+							  sizeof(batchBuffer), &replayed);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(3, replayed);
+	checkLastBatch(3, 1);
+
+	IOT_DEBUG("-->Success - S:7 - A failed publish commits nothing \n");
+}
+
+/* S:8 - Committed records are never replayed, also when the log could not be rewritten yet */
+TEST_C(SpoolTests, CommittedRecordsSkipped) {
+	uint32_t replayed = 0;
+	IoT_Error_t rc;
+
+	IOT_DEBUG("-->Running Spool Tests - S:8 - Committed records are never replayed \n");
+
+	appendReadings(1, 6);
+	setTLSRxBufferForPuback();
+	rc = aws_iot_spool_replay(&spool, &iotClient, pTestTopic, (uint16_t) strlen(pTestTopic), batchBuffer, 60,
+							  &replayed);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_C(0 < replayed && 6 > replayed);
+
+	/* The commit record was appended behind the records, reopening has to skip the committed ones */
+	CHECK_EQUAL_C_INT(SUCCESS, reopenSpool(SPOOL_MAX_BYTES, 0));
+	CHECK_EQUAL_C_INT(6 - replayed, aws_iot_spool_pending(&spool));
+	setTLSRxBufferForPuback();
+	rc = aws_iot_spool_replay(&spool, &iotClient, pTestTopic, (uint16_t) strlen(pTestTopic), batchBuffer,
+							  sizeof(batchBuffer), NULL);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	checkLastBatch((uint16_t) (6 - replayed), replayed + 1);
+
+	IOT_DEBUG("-->Success - S:8 - Committed records are never replayed \n");
+}
+
+/* S:9 - A full spool refuses records until replay made room */
+TEST_C(SpoolTests, FullSpoolRefuses) {
+	const uint32_t maxBytes = 2 * (AWS_IOT_SPOOL_RECORD_OVERHEAD + AWS_IOT_SPOOL_MAX_RECORD_LEN);
+	AWS_IoT_Spool_Metrics metrics;
+	uint8_t record[100];
+	IoT_Error_t rc;
+	int i;
+
+	IOT_DEBUG("-->Running Spool Tests - S:9 - A full spool refuses records \n");
+
+	CHECK_EQUAL_C_INT(SUCCESS, reopenSpool(maxBytes, 0));
+	memset(record, 'x', sizeof(record));
+	for(i = 0; i < (int) (maxBytes / (AWS_IOT_SPOOL_RECORD_OVERHEAD + sizeof(record))); i++) {
+		CHECK_EQUAL_C_INT(SUCCESS, aws_iot_spool_append(&spool, record, sizeof(record), NULL));
+	}
+	CHECK_EQUAL_C_INT(SPOOL_FULL_ERROR, aws_iot_spool_append(&spool, record, sizeof(record), NULL));
+	aws_iot_spool_get_metrics(&spool, &metrics);
+	CHECK_EQUAL_C_INT(1, metrics.refused);
+	CHECK_EQUAL_C_INT(MAX_SIZE_ERROR, aws_iot_spool_append(&spool, batchBuffer, AWS_IOT_SPOOL_MAX_RECORD_LEN + 1,
+															NULL));
+
+	setTLSRxBufferForPuback();
+	rc = aws_iot_spool_replay(&spool, &iotClient, pTestTopic, (uint16_t) strlen(pTestTopic), batchBuffer,
+							  sizeof(batchBuffer), NULL);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_spool_append(&spool, record, sizeof(record), NULL));
+
+	IOT_DEBUG("-->Success - S:9 - A full spool refuses records \n");
+}
+
+/* S:10 - A rewrite stopped by a power loss leaves either the old or the new log */
+TEST_C(SpoolTests, InterruptedRewriteRecovered) {
+	FILE *pFile;
+
+	IOT_DEBUG("-->Running Spool Tests - S:10 - A rewrite stopped by a power loss is recovered \n");
+
+	appendReadings(1, 2);
+	aws_iot_spool_file_close(&spoolFile);
+
+	/* Stopped while the new log was written, the old log is kept */
+	pFile = fopen(SPOOL_TMP_PATH, "wb");
+	fputs("partial", pFile);
+	fclose(pFile);
+	CHECK_EQUAL_C_INT(SUCCESS, openSpool(SPOOL_MAX_BYTES, 0));
+	CHECK_EQUAL_C_INT(2, aws_iot_spool_pending(&spool));
+	CHECK_C(NULL == fopen(SPOOL_TMP_PATH, "rb"));
+	aws_iot_spool_file_close(&spoolFile);
+
+	/* Stopped after the old log was removed, the new log is taken */
+	CHECK_EQUAL_C_INT(0, rename(SPOOL_PATH, SPOOL_TMP_PATH));
+	CHECK_EQUAL_C_INT(SUCCESS, openSpool(SPOOL_MAX_BYTES, 0));
+	CHECK_EQUAL_C_INT(2, aws_iot_spool_pending(&spool));
+
+	IOT_DEBUG("-->Success - S:10 - A rewrite stopped by a power loss is recovered \n");
+}
+
+static uint32_t syncCount;
+
+static IoT_Error_t countingSync(void *pContext) {
+	syncCount++;
+	return storage.sync(pContext);
+}
+
+/* S:11 - With a sync interval, appends sync every few records and aws_iot_spool_sync saves the rest */
+TEST_C(SpoolTests, SyncInterval) {
+	AWS_IoT_Spool_Storage countingStorage = storage;
+
+	IOT_DEBUG("-->Running Spool Tests - S:11 - Appends sync every few records \n");
+
+	countingStorage.sync = countingSync;
+	syncCount = 0;
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_spool_init(&spool, &countingStorage, SPOOL_MAX_BYTES, 0));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_spool_set_sync_interval(&spool, 3));
+
+	appendReadings(1, 2);
+	CHECK_EQUAL_C_INT(0, syncCount);
+	appendReadings(3, 1);
+	CHECK_EQUAL_C_INT(1, syncCount);
+
+	appendReadings(4, 1);
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_spool_sync(&spool));
+	CHECK_EQUAL_C_INT(2, syncCount);
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_spool_sync(&spool));
+	CHECK_EQUAL_C_INT(2, syncCount);
+
+	/* The commit after a batch syncs everything before it */
+	appendReadings(5, 1);
+	setTLSRxBufferForPuback();
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_spool_replay(&spool, &iotClient, pTestTopic, (uint16_t) strlen(pTestTopic),
+													batchBuffer, sizeof(batchBuffer), NULL));
+	checkLastBatch(5, 1);
+	CHECK_EQUAL_C_INT(0, spool.unsyncedCount);
+
+	CHECK_EQUAL_C_INT(SUCCESS, reopenSpool(SPOOL_MAX_BYTES, 0));
+	CHECK_EQUAL_C_INT(0, aws_iot_spool_pending(&spool));
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_spool_set_sync_interval(NULL, 3));
+
+	IOT_DEBUG("-->Success - S:11 - Appends sync every few records \n");
+}
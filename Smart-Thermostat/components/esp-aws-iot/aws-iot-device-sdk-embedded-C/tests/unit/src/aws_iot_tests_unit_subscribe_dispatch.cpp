@@ -0,0 +1,40 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_tests_unit_subscribe_dispatch.cpp
+ * @brief IoT Client Unit Testing - Subscription Dispatch Tests
+ */
+
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTest/TestHarness_c.h>
+
+TEST_GROUP_C(SubscribeDispatchTests){
+	TEST_GROUP_C_SETUP_WRAPPER(SubscribeDispatchTests)
+	TEST_GROUP_C_TEARDOWN_WRAPPER(SubscribeDispatchTests)
+};
+
+/* D:1 - Exact topic delivered, other topics ignored */
+TEST_GROUP_C_WRAPPER(SubscribeDispatchTests, ExactTopicDispatch)
+/* D:2 - Same topic subscribed twice, both handlers called */
+TEST_GROUP_C_WRAPPER(SubscribeDispatchTests, DuplicateTopicDispatch)
+/* D:3 - Wildcard filters match like the topic matcher */
+TEST_GROUP_C_WRAPPER(SubscribeDispatchTests, WildcardFilterMatching)
+/* D:4 - Overlapping filters, handlers called in subscription order */
+TEST_GROUP_C_WRAPPER(SubscribeDispatchTests, OverlappingFiltersDispatchOrder)
+/* D:5 - Unsubscribed filters no longer dispatched */
+TEST_GROUP_C_WRAPPER(SubscribeDispatchTests, UnsubscribeRemovesFromDispatch)
+/* D:6 - Dispatch cost against the number of subscriptions */
+TEST_GROUP_C_WRAPPER(SubscribeDispatchTests, DispatchBenchmark)
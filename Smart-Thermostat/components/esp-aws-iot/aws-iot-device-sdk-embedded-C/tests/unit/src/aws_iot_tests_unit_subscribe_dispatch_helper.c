@@ -0,0 +1,294 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_tests_unit_subscribe_dispatch_helper.c
+ * @brief IoT Client Unit Testing - Subscription Dispatch Tests Helper
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <CppUTest/TestHarness_c.h>
+
+#include "aws_iot_tests_unit_helper_functions.h"
+#include "aws_iot_mqtt_client_common_internal.h"
+#include "aws_iot_log.h"
+
+/* Messages dispatched per subscription count in the benchmark */
+#define DISPATCH_BENCHMARK_MESSAGES 20000
+
+static IoT_Client_Init_Params initParams;
+static IoT_Client_Connect_Params connectParams;
+static IoT_Publish_Message_Params testPubMsgParams;
+static AWS_IoT_Client iotClient;
+
+static int callbackOrder[AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS * 2];
+static int callbackCount;
+
+static void iot_dispatch_callback_handler(AWS_IoT_Client *pClient, char *topicName, uint16_t topicNameLen,
+										  IoT_Publish_Message_Params *params, void *pData) {
+	IOT_UNUSED(pClient);
+	IOT_UNUSED(topicName);
+	IOT_UNUSED(topicNameLen);
+	IOT_UNUSED(params);
+
+	if(callbackCount < (int) (sizeof(callbackOrder) / sizeof(callbackOrder[0]))) {
+		callbackOrder[callbackCount] = (int) (intptr_t) pData;
+	}
+	callbackCount++;
+}
+
+static void connectClient(void) {
+	IoT_Error_t rc;
+	ResetTLSBuffer();
+	InitMQTTParamsSetup(&initParams, AWS_IOT_MQTT_HOST, AWS_IOT_MQTT_PORT, false, NULL);
+	initParams.mqttCommandTimeout_ms = 2000;
+	rc = aws_iot_mqtt_init(&iotClient, &initParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	ConnectMQTTParamsSetup(&connectParams, AWS_IOT_MQTT_CLIENT_ID, (uint16_t) strlen(AWS_IOT_MQTT_CLIENT_ID));
+	setTLSRxBufferForConnack(&connectParams, 0, 0);
+	rc = aws_iot_mqtt_connect(&iotClient, &connectParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	ResetTLSBuffer();
+}
+
+static void subscribeFilter(const char *pFilter, int id) {
+	IoT_Error_t rc;
+
+	setTLSRxBufferForSuback((char *) pFilter, strlen(pFilter), QOS0, testPubMsgParams);
+	rc = aws_iot_mqtt_subscribe(&iotClient, pFilter, (uint16_t) strlen(pFilter), QOS0,
+								iot_dispatch_callback_handler, (void *) (intptr_t) id);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+}
+
+static void unsubscribeFilter(const char *pFilter) {
+	IoT_Error_t rc;
+
+	setTLSRxBufferForUnsuback();
+	rc = aws_iot_mqtt_unsubscribe(&iotClient, pFilter, (uint16_t) strlen(pFilter));
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+}
+
+/* Publishes a message on pTopic from the broker and returns the number of handlers called */
+static int deliverMessage(const char *pTopic) {
+	IoT_Error_t rc;
+
+	callbackCount = 0;
+	setTLSRxBufferWithMsgOnSubscribedTopic((char *) pTopic, strlen(pTopic), QOS0, testPubMsgParams, "dispatch");
+	rc = aws_iot_mqtt_yield(&iotClient, 10);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	return callbackCount;
+}
+
+TEST_GROUP_C_SETUP(SubscribeDispatchTests) {
+	connectClient();
+
+	testPubMsgParams.qos = QOS0;
+	testPubMsgParams.isRetained = 0;
+	testPubMsgParams.payload = (void *) "dispatch";
+	testPubMsgParams.payloadLen = strlen("dispatch");
+}
+
+TEST_GROUP_C_TEARDOWN(SubscribeDispatchTests) { }
+
+/* D:1 - Exact topic delivered, other topics ignored */
+TEST_C(SubscribeDispatchTests, ExactTopicDispatch) {
+	IOT_DEBUG("-->Running Subscribe Dispatch Tests - D:1 - Exact topic delivered, other topics ignored \n");
+
+	subscribeFilter("sdk/Test1", 1);
+	subscribeFilter("sdk/Test2", 2);
+
+	CHECK_EQUAL_C_INT(1, deliverMessage("sdk/Test2"));
+	CHECK_EQUAL_C_INT(2, callbackOrder[0]);
+	CHECK_EQUAL_C_INT(1, deliverMessage("sdk/Test1"));
+	CHECK_EQUAL_C_INT(1, callbackOrder[0]);
+	CHECK_EQUAL_C_INT(0, deliverMessage("sdk/Test"));
+	CHECK_EQUAL_C_INT(0, deliverMessage("sdk/Test12"));
+
+	IOT_DEBUG("-->Success - D:1 - Exact topic delivered, other topics ignored \n");
+}
+
+/* D:2 - Same topic subscribed twice, both handlers called */
+TEST_C(SubscribeDispatchTests, DuplicateTopicDispatch) {
+	IOT_DEBUG("-->Running Subscribe Dispatch Tests - D:2 - Same topic subscribed twice, both handlers called \n");
+
+	subscribeFilter("sdk/Test", 1);
+	subscribeFilter("sdk/Test", 2);
+
+	CHECK_EQUAL_C_INT(2, deliverMessage("sdk/Test"));
+	CHECK_EQUAL_C_INT(1, callbackOrder[0]);
+	CHECK_EQUAL_C_INT(2, callbackOrder[1]);
+
+	IOT_DEBUG("-->Success - D:2 - Same topic subscribed twice, both handlers called \n");
+}
+
+/* D:3 - Wildcard filters match like the topic matcher */
+TEST_C(SubscribeDispatchTests, WildcardFilterMatching) {
+	static const struct {
+		const char *pFilter;
+		const char *pTopic;
+		int handlersCalled;
+	} cases[] = {
+		{"sdk/+/sub", "sdk/a/sub", 1},
+		{"sdk/+/sub", "sdk//sub", 0},
+		{"sdk/+/sub", "sdk/a/b/sub", 0},
+		{"sdk/+", "sdk/a", 1},
+		{"sdk/+", "sdk/", 0},
+		{"sdk/+", "sdk/a/b", 0},
+		{"sdk/#", "sdk/a/b", 1},
+		{"sdk/#", "sdk/a", 1},
+		{"sdk/#", "sdk", 0},
+		{"sdk/#", "sdk/", 0},
+		{"sdk/#", "sdk//a", 0},
+		{"#", "sdk/a", 1},
+		{"+/+", "sdk/a", 1},
+		{"+/#", "sdk/a/b", 1},
+		/* '#' must be the last level, otherwise only the filter itself matches */
+		{"sdk/#/sub", "sdk/a/sub", 0},
+		{"sdk/#/sub", "sdk/#/sub", 1},
+		/* Wildcards sharing a level are not indexed and are matched as before */
+		{"sdk/a+/sub", "sdk/a+/sub", 1},
+		{"sdk/a+/sub", "sdk/ab/sub", 1},
+		{"sdk/Test", "sdk/Test", 1},
+		{"sdk/Test", "sdk/Tes", 0},
+	};
+	size_t i;
+
+	IOT_DEBUG("-->Running Subscribe Dispatch Tests - D:3 - Wildcard filters match like the topic matcher \n");
+
+	for(i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+		IOT_DEBUG("[Matching] %s against %s\n", cases[i].pFilter, cases[i].pTopic);
+		subscribeFilter(cases[i].pFilter, (int) i);
+		CHECK_EQUAL_C_INT(cases[i].handlersCalled, deliverMessage(cases[i].pTopic));
+		unsubscribeFilter(cases[i].pFilter);
+	}
+
+	IOT_DEBUG("-->Success - D:3 - Wildcard filters match like the topic matcher \n");
+}
+
+/* D:4 - Overlapping filters, handlers called in subscription order */
+TEST_C(SubscribeDispatchTests, OverlappingFiltersDispatchOrder) {
+	IOT_DEBUG("-->Running Subscribe Dispatch Tests - D:4 - Overlapping filters, handlers called in subscription order \n");
+
+	subscribeFilter("sdk/#", 0);
+	subscribeFilter("sdk/a/b", 1);
+	subscribeFilter("sdk/+/b", 2);
+	subscribeFilter("+/a/#", 3);
+	subscribeFilter("sdk/a/b", 4);
+
+	CHECK_EQUAL_C_INT(5, deliverMessage("sdk/a/b"));
+	CHECK_EQUAL_C_INT(0, callbackOrder[0]);
+	CHECK_EQUAL_C_INT(1, callbackOrder[1]);
+	CHECK_EQUAL_C_INT(2, callbackOrder[2]);
+	CHECK_EQUAL_C_INT(3, callbackOrder[3]);
+	CHECK_EQUAL_C_INT(4, callbackOrder[4]);
+
+	CHECK_EQUAL_C_INT(2, deliverMessage("sdk/x/b"));
+	CHECK_EQUAL_C_INT(0, callbackOrder[0]);
+	CHECK_EQUAL_C_INT(2, callbackOrder[1]);
+
+	IOT_DEBUG("-->Success - D:4 - Overlapping filters, handlers called in subscription order \n");
+}
+
+/* D:5 - Unsubscribed filters no longer dispatched */
+TEST_C(SubscribeDispatchTests, UnsubscribeRemovesFromDispatch) {
+	IOT_DEBUG("-->Running Subscribe Dispatch Tests - D:5 - Unsubscribed filters no longer dispatched \n");
+
+	subscribeFilter("sdk/a", 0);
+	subscribeFilter("sdk/+", 1);
+	CHECK_EQUAL_C_INT(2, deliverMessage("sdk/a"));
+
+	unsubscribeFilter("sdk/+");
+	CHECK_EQUAL_C_INT(1, deliverMessage("sdk/a"));
+	CHECK_EQUAL_C_INT(0, callbackOrder[0]);
+
+	unsubscribeFilter("sdk/a");
+	CHECK_EQUAL_C_INT(0, deliverMessage("sdk/a"));
+
+	subscribeFilter("sdk/+", 2);
+	CHECK_EQUAL_C_INT(1, deliverMessage("sdk/a"));
+	CHECK_EQUAL_C_INT(2, callbackOrder[0]);
+
+	IOT_DEBUG("-->Success - D:5 - Unsubscribed filters no longer dispatched \n");
+}
+
+/* Reads DISPATCH_BENCHMARK_MESSAGES publishes on pTopic through the TLS mock,
+ * returns the average time per message in nanoseconds */
+static double benchmarkDispatch(const char *pTopic, int expectedHandlers) {
+	struct timespec start, end;
+	uint8_t packetType;
+	Timer timer;
+	IoT_Error_t rc;
+	int i;
+
+	callbackCount = 0;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for(i = 0; i < DISPATCH_BENCHMARK_MESSAGES; i++) {
+		setTLSRxBufferWithMsgOnSubscribedTopic((char *) pTopic, strlen(pTopic), QOS0, testPubMsgParams, "dispatch");
+		init_timer(&timer);
+		countdown_ms(&timer, 1000);
+		rc = aws_iot_mqtt_internal_cycle_read(&iotClient, &timer, &packetType);
+		CHECK_EQUAL_C_INT(SUCCESS, rc);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	CHECK_EQUAL_C_INT(PUBLISH, packetType);
+	CHECK_EQUAL_C_INT(expectedHandlers * DISPATCH_BENCHMARK_MESSAGES, callbackCount);
+
+	return ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / DISPATCH_BENCHMARK_MESSAGES;
+}
+
+/* D:6 - Dispatch cost against the number of subscriptions */
+TEST_C(SubscribeDispatchTests, DispatchBenchmark) {
+	static char filters[AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS][64];
+	const char *pTopic = "$aws/things/thing0/shadow/update/delta";
+	int count;
+
+	IOT_DEBUG("-->Running Subscribe Dispatch Tests - D:6 - Dispatch cost against the number of subscriptions \n");
+
+	printf("\nDispatch of %s, ns per message\n", pTopic);
+	printf("subscriptions   exact   wildcard\n");
+	/* Every count up to 4, then doubling while it stays within the table:
+	 * 5 entries in the unit tests, 64 with make run-dispatch-benchmark */
+	for(count = 0; count <= AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS;
+		count = (count < 4 || count * 2 > AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS) ? count + 1 : count * 2) {
+		double exactNs, wildcardNs;
+		int i;
+
+		/* Only the first subscription matches the topic */
+		connectClient();
+		for(i = 0; i < count; i++) {
+			snprintf(filters[i], sizeof(filters[i]), "$aws/things/thing%d/shadow/update/delta", i);
+			subscribeFilter(filters[i], i);
+		}
+		exactNs = benchmarkDispatch(pTopic, count > 0 ? 1 : 0);
+
+		connectClient();
+		for(i = 0; i < count; i++) {
+			snprintf(filters[i], sizeof(filters[i]), "$aws/things/thing%d/shadow/+/delta", i);
+			subscribeFilter(filters[i], i);
+		}
+		wildcardNs = benchmarkDispatch(pTopic, count > 0 ? 1 : 0);
+
+		printf("%13d %7.0f %10.0f\n", count, exactNs, wildcardNs);
+	}
+
+	IOT_DEBUG("-->Success - D:6 - Dispatch cost against the number of subscriptions \n");
+}
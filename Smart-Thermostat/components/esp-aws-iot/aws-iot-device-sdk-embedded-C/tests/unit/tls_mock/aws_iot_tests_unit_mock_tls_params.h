@@ -59,6 +59,11 @@ extern size_t lastPublishMessageTopicLen;
 extern char LastPublishMessagePayload[TLSMaxBufferSize];
 extern size_t lastPublishMessagePayloadLen;
 
+extern size_t lastWritevCount;
+extern size_t readCount;
+extern size_t waitForReadCount;
+extern TLSConnectTiming mockedConnectTiming;
+
 extern char hostAddress[512];
 extern uint16_t port;
 extern uint32_t handshakeTimeout_ms;
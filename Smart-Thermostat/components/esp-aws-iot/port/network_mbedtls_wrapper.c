@@ -14,8 +14,10 @@
  * permissions and limitations under the License.
  */
 #include <sys/param.h>
+#include <sys/select.h>
 #include <stdbool.h>
 #include <string.h>
+#include <errno.h>
 #include "aws_iot_config.h"
 
 #include <timer_platform.h>
@@ -27,6 +29,9 @@
 #include "network_platform.h"
 
 #include "mbedtls/esp_debug.h"
+#include "mbedtls/platform.h"
+#include "mbedtls/platform_util.h"
+#include "mbedtls/version.h"
 
 #ifdef CONFIG_AWS_IOT_USE_HARDWARE_SECURE_ELEMENT
 #include "mbedtls/atca_mbedtls_wrap.h"
@@ -34,7 +39,9 @@
 #include "tng_atcacert_client.h"
 #endif
 
+#include "esp_attr.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "esp_vfs.h"
 
 static const char *TAG = "aws_iot";
@@ -58,6 +65,167 @@ static const char *TAG = "aws_iot";
 	#define IOT_SSL_READ_RETRY_TIMEOUT_MS 10
 #endif
 
+#ifdef CONFIG_AWS_IOT_TLS_SESSION_STORE_IN_RTC
+#define IOT_TLS_SESSION_STORE_IN_RTC
+
+/* The session of the last handshake, serialized so it survives deep sleep */
+typedef struct {
+    size_t len;
+    unsigned char buf[CONFIG_AWS_IOT_TLS_SESSION_RTC_STORE_SIZE];
+} TLSSessionStore;
+
+static RTC_DATA_ATTR TLSSessionStore rtcSessionStore;
+
+#if MBEDTLS_VERSION_NUMBER >= 0x02130000
+#define _iot_tls_session_save mbedtls_ssl_session_save
+#define _iot_tls_session_load mbedtls_ssl_session_load
+#else
+/* mbed TLS before 2.19 cannot serialize a session. What a client needs to resume
+ * one, the session ID or ticket, the master secret, the ciphersuite and the
+ * negotiated extensions, are plain fields of mbedtls_ssl_session, so the struct
+ * is stored as is with its pointers cleared, followed by the ticket. The server
+ * certificate is not kept: a resumed handshake does not receive it again and
+ * the stored verify_result still tells how it was verified. The header rejects
+ * a session written by a firmware built with another mbed TLS. */
+typedef struct {
+    uint32_t version;
+    uint32_t size;
+    mbedtls_ssl_session session;
+} TLSSessionHeader;
+
+static int _iot_tls_session_save(const mbedtls_ssl_session *session, unsigned char *buf, size_t buf_len,
+                                 size_t *olen) {
+    TLSSessionHeader header;
+    size_t ticket_len = 0;
+
+#if defined(MBEDTLS_SSL_SESSION_TICKETS) && defined(MBEDTLS_SSL_CLI_C)
+    ticket_len = session->ticket_len;
+#endif
+    *olen = sizeof(header) + ticket_len;
+    if(*olen > buf_len) {
+        return MBEDTLS_ERR_SSL_BUFFER_TOO_SMALL;
+    }
+
+    memset(&header, 0, sizeof(header));
+    header.version = MBEDTLS_VERSION_NUMBER;
+    header.size = sizeof(header.session);
+    header.session = *session;
+#if defined(MBEDTLS_X509_CRT_PARSE_C)
+    header.session.peer_cert = NULL;
+#endif
+#if defined(MBEDTLS_SSL_SESSION_TICKETS) && defined(MBEDTLS_SSL_CLI_C)
+    header.session.ticket = NULL;
+    if(ticket_len > 0) {
+        memcpy(buf + sizeof(header), session->ticket, ticket_len);
+    }
+#endif
+    memcpy(buf, &header, sizeof(header));
+    mbedtls_platform_zeroize(&header, sizeof(header));
+    return 0;
+}
+
+static int _iot_tls_session_load(mbedtls_ssl_session *session, const unsigned char *buf, size_t len) {
+    TLSSessionHeader header;
+    size_t ticket_len = 0;
+    int ret = 0;
+
+    if(len < sizeof(header)) {
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    }
+    memcpy(&header, buf, sizeof(header));
+#if defined(MBEDTLS_SSL_SESSION_TICKETS) && defined(MBEDTLS_SSL_CLI_C)
+    ticket_len = header.session.ticket_len;
+#endif
+    if(header.version != MBEDTLS_VERSION_NUMBER || header.size != sizeof(header.session) ||
+       len != sizeof(header) + ticket_len) {
+        ret = MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    } else {
+        *session = header.session;
+#if defined(MBEDTLS_SSL_SESSION_TICKETS) && defined(MBEDTLS_SSL_CLI_C)
+        if(ticket_len > 0) {
+            if((session->ticket = mbedtls_calloc(1, ticket_len)) == NULL) {
+                session->ticket_len = 0;
+                ret = MBEDTLS_ERR_SSL_ALLOC_FAILED;
+            } else {
+                memcpy(session->ticket, buf + sizeof(header), ticket_len);
+            }
+        }
+#endif
+    }
+    mbedtls_platform_zeroize(&header, sizeof(header));
+    return ret;
+}
+#endif
+#endif
+
+static uint32_t _iot_tls_elapsed_ms(int64_t start_us) {
+    return (uint32_t) ((esp_timer_get_time() - start_us) / 1000);
+}
+
+static void _iot_tls_free_credentials(TLSDataParams *tlsDataParams) {
+    mbedtls_x509_crt_free(&(tlsDataParams->clicert));
+    mbedtls_x509_crt_free(&(tlsDataParams->cacert));
+    mbedtls_pk_free(&(tlsDataParams->pkey));
+    tlsDataParams->isCredentialCached = false;
+}
+
+static void _iot_tls_free_session(TLSDataParams *tlsDataParams) {
+    if(tlsDataParams->isSessionSaved) {
+        mbedtls_ssl_session_free(&(tlsDataParams->savedSession));
+        tlsDataParams->isSessionSaved = false;
+    }
+}
+
+#ifdef CONFIG_AWS_IOT_TLS_SESSION_RESUMPTION
+static void _iot_tls_forget_session(TLSDataParams *tlsDataParams) {
+    _iot_tls_free_session(tlsDataParams);
+#ifdef IOT_TLS_SESSION_STORE_IN_RTC
+    rtcSessionStore.len = 0;
+#endif
+}
+
+static void _iot_tls_save_session(TLSDataParams *tlsDataParams) {
+    int ret;
+#ifdef IOT_TLS_SESSION_STORE_IN_RTC
+    size_t len = 0;
+#endif
+
+    _iot_tls_free_session(tlsDataParams);
+    mbedtls_ssl_session_init(&(tlsDataParams->savedSession));
+    if((ret = mbedtls_ssl_get_session(&(tlsDataParams->ssl), &(tlsDataParams->savedSession))) != 0) {
+        ESP_LOGW(TAG, "mbedtls_ssl_get_session returned -0x%x, the next connect does a full handshake", -ret);
+        mbedtls_ssl_session_free(&(tlsDataParams->savedSession));
+        return;
+    }
+    tlsDataParams->isSessionSaved = true;
+
+#ifdef IOT_TLS_SESSION_STORE_IN_RTC
+    ret = _iot_tls_session_save(&(tlsDataParams->savedSession), rtcSessionStore.buf, sizeof(rtcSessionStore.buf),
+                                &len);
+    if(ret != 0) {
+        ESP_LOGW(TAG, "TLS session of %u bytes does not fit the RTC store, it is kept in RAM only", (unsigned int) len);
+        len = 0;
+    }
+    rtcSessionStore.len = len;
+#endif
+}
+
+/* After deep sleep or a reset only the RTC store still holds the session */
+static void _iot_tls_restore_session(TLSDataParams *tlsDataParams) {
+#ifdef IOT_TLS_SESSION_STORE_IN_RTC
+    if(!tlsDataParams->isSessionSaved && rtcSessionStore.len > 0) {
+        mbedtls_ssl_session_init(&(tlsDataParams->savedSession));
+        if(_iot_tls_session_load(&(tlsDataParams->savedSession), rtcSessionStore.buf, rtcSessionStore.len) == 0) {
+            tlsDataParams->isSessionSaved = true;
+        } else {
+            mbedtls_ssl_session_free(&(tlsDataParams->savedSession));
+            rtcSessionStore.len = 0;
+        }
+    }
+#endif
+}
+#endif
+
 /*
  * This is a function to do further verification if needed on the cert received.
  *
@@ -103,11 +271,16 @@ IoT_Error_t iot_tls_init(Network *pNetwork, const char *pRootCALocation, const c
     pNetwork->connect = iot_tls_connect;
     pNetwork->read = iot_tls_read;
     pNetwork->write = iot_tls_write;
+    pNetwork->writev = iot_tls_writev;
+    pNetwork->waitForRead = iot_tls_wait_for_read;
     pNetwork->disconnect = iot_tls_disconnect;
     pNetwork->isConnected = iot_tls_is_connected;
     pNetwork->destroy = iot_tls_destroy;
 
     pNetwork->tlsDataParams.flags = 0;
+    pNetwork->tlsDataParams.isCredentialCached = false;
+    pNetwork->tlsDataParams.isSessionSaved = false;
+    memset(&(pNetwork->connectTiming), 0, sizeof(TLSConnectTiming));
 
     return SUCCESS;
 }
@@ -117,44 +290,9 @@ IoT_Error_t iot_tls_is_connected(Network *pNetwork) {
     return NETWORK_PHYSICAL_LAYER_CONNECTED;
 }
 
-IoT_Error_t iot_tls_connect(Network *pNetwork, TLSConnectParams *params) {
-    int ret = SUCCESS;
-    TLSDataParams *tlsDataParams = NULL;
-    char portBuffer[6];
-    char info_buf[256];
-
-    if(NULL == pNetwork) {
-        return NULL_VALUE_ERROR;
-    }
-
-    if(NULL != params) {
-        _iot_tls_set_connect_params(pNetwork, params->pRootCALocation, params->pDeviceCertLocation,
-                                    params->pDevicePrivateKeyLocation, params->pDestinationURL,
-                                    params->DestinationPort, params->timeout_ms, params->ServerVerificationFlag);
-    }
-
-    tlsDataParams = &(pNetwork->tlsDataParams);
-
-    mbedtls_net_init(&(tlsDataParams->server_fd));
-    mbedtls_ssl_init(&(tlsDataParams->ssl));
-    mbedtls_ssl_config_init(&(tlsDataParams->conf));
-
-#ifdef CONFIG_MBEDTLS_DEBUG
-    mbedtls_esp_enable_debug_log(&(tlsDataParams->conf), 4);
-#endif
-
-    mbedtls_ctr_drbg_init(&(tlsDataParams->ctr_drbg));
-    mbedtls_x509_crt_init(&(tlsDataParams->cacert));
-    mbedtls_x509_crt_init(&(tlsDataParams->clicert));
-    mbedtls_pk_init(&(tlsDataParams->pkey));
-
-    ESP_LOGD(TAG, "Seeding the random number generator...");
-    mbedtls_entropy_init(&(tlsDataParams->entropy));
-    if((ret = mbedtls_ctr_drbg_seed(&(tlsDataParams->ctr_drbg), mbedtls_entropy_func, &(tlsDataParams->entropy),
-                                    (const unsigned char *) TAG, strlen(TAG))) != 0) {
-        ESP_LOGE(TAG, "failed! mbedtls_ctr_drbg_seed returned -0x%x", -ret);
-        return NETWORK_MBEDTLS_ERR_CTR_DRBG_ENTROPY_SOURCE_FAILED;
-    }
+static IoT_Error_t _iot_tls_load_credentials(Network *pNetwork) {
+    TLSDataParams *tlsDataParams = &(pNetwork->tlsDataParams);
+    int ret;
 
    /*  Load root CA...
 
@@ -239,10 +377,85 @@ IoT_Error_t iot_tls_connect(Network *pNetwork, TLSConnectParams *params) {
         return NETWORK_PK_PRIVATE_KEY_PARSE_ERROR;
     }
 
-    /* Done parsing certs */
-    ESP_LOGD(TAG, "ok");
+    return SUCCESS;
+}
+
+IoT_Error_t iot_tls_connect(Network *pNetwork, TLSConnectParams *params) {
+    int ret = SUCCESS;
+    TLSDataParams *tlsDataParams = NULL;
+    TLSConnectTiming *pTiming = NULL;
+    char portBuffer[6];
+    char info_buf[256];
+    int64_t start_us, step_us;
+    int state;
+    bool isFullHandshake = false;
+
+    if(NULL == pNetwork) {
+        return NULL_VALUE_ERROR;
+    }
+
+    tlsDataParams = &(pNetwork->tlsDataParams);
+    pTiming = &(pNetwork->connectTiming);
+
+    if(NULL != params) {
+        /* What was kept for other credentials or another endpoint is of no use */
+        if(tlsDataParams->isCredentialCached &&
+           (params->pRootCALocation != pNetwork->tlsConnectParams.pRootCALocation ||
+            params->pDeviceCertLocation != pNetwork->tlsConnectParams.pDeviceCertLocation ||
+            params->pDevicePrivateKeyLocation != pNetwork->tlsConnectParams.pDevicePrivateKeyLocation)) {
+            _iot_tls_free_credentials(tlsDataParams);
+        }
+        if(params->pDestinationURL != pNetwork->tlsConnectParams.pDestinationURL ||
+           params->DestinationPort != pNetwork->tlsConnectParams.DestinationPort) {
+            _iot_tls_free_session(tlsDataParams);
+        }
+        _iot_tls_set_connect_params(pNetwork, params->pRootCALocation, params->pDeviceCertLocation,
+                                    params->pDevicePrivateKeyLocation, params->pDestinationURL,
+                                    params->DestinationPort, params->timeout_ms, params->ServerVerificationFlag);
+    }
+
+    memset(pTiming, 0, sizeof(TLSConnectTiming));
+
+    mbedtls_net_init(&(tlsDataParams->server_fd));
+    mbedtls_ssl_init(&(tlsDataParams->ssl));
+    mbedtls_ssl_config_init(&(tlsDataParams->conf));
+
+#ifdef CONFIG_MBEDTLS_DEBUG
+    mbedtls_esp_enable_debug_log(&(tlsDataParams->conf), 4);
+#endif
+
+    mbedtls_ctr_drbg_init(&(tlsDataParams->ctr_drbg));
+    if(!tlsDataParams->isCredentialCached) {
+        mbedtls_x509_crt_init(&(tlsDataParams->cacert));
+        mbedtls_x509_crt_init(&(tlsDataParams->clicert));
+        mbedtls_pk_init(&(tlsDataParams->pkey));
+    }
+
+    ESP_LOGD(TAG, "Seeding the random number generator...");
+    mbedtls_entropy_init(&(tlsDataParams->entropy));
+    if((ret = mbedtls_ctr_drbg_seed(&(tlsDataParams->ctr_drbg), mbedtls_entropy_func, &(tlsDataParams->entropy),
+                                    (const unsigned char *) TAG, strlen(TAG))) != 0) {
+        ESP_LOGE(TAG, "failed! mbedtls_ctr_drbg_seed returned -0x%x", -ret);
+        return NETWORK_MBEDTLS_ERR_CTR_DRBG_ENTROPY_SOURCE_FAILED;
+    }
+
+    /* Parsing the certificates and reading them from a secure element is only done
+       once when they are cached, reconnects reuse the contexts */
+    if(!tlsDataParams->isCredentialCached) {
+        start_us = esp_timer_get_time();
+        ret = _iot_tls_load_credentials(pNetwork);
+        pTiming->credentials_ms = _iot_tls_elapsed_ms(start_us);
+        if(ret != SUCCESS) {
+            return (IoT_Error_t) ret;
+        }
+#ifdef CONFIG_AWS_IOT_TLS_CACHE_CREDENTIALS
+        tlsDataParams->isCredentialCached = true;
+#endif
+    }
+
     snprintf(portBuffer, 6, "%d", pNetwork->tlsConnectParams.DestinationPort);
     ESP_LOGD(TAG, "Connecting to %s/%s...", pNetwork->tlsConnectParams.pDestinationURL, portBuffer);
+    start_us = esp_timer_get_time();
     if((ret = mbedtls_net_connect(&(tlsDataParams->server_fd), pNetwork->tlsConnectParams.pDestinationURL,
                                   portBuffer, MBEDTLS_NET_PROTO_TCP)) != 0) {
         ESP_LOGE(TAG, "failed! mbedtls_net_connect returned -0x%x", -ret);
@@ -256,6 +469,7 @@ IoT_Error_t iot_tls_connect(Network *pNetwork, TLSConnectParams *params) {
                 return NETWORK_ERR_NET_CONNECT_FAILED;
         };
     }
+    pTiming->tcp_ms = _iot_tls_elapsed_ms(start_us);
 
     ret = mbedtls_net_set_block(&(tlsDataParams->server_fd));
     if(ret != 0) {
@@ -312,17 +526,45 @@ IoT_Error_t iot_tls_connect(Network *pNetwork, TLSConnectParams *params) {
                         mbedtls_net_recv_timeout);
     ESP_LOGD(TAG, "ok");
 
+#ifdef CONFIG_AWS_IOT_TLS_SESSION_RESUMPTION
+    /* A resumed handshake skips the certificates and the signature of the private key */
+    _iot_tls_restore_session(tlsDataParams);
+    if(tlsDataParams->isSessionSaved) {
+        if((ret = mbedtls_ssl_set_session(&(tlsDataParams->ssl), &(tlsDataParams->savedSession))) != 0) {
+            ESP_LOGW(TAG, "mbedtls_ssl_set_session returned -0x%x, doing a full handshake", -ret);
+        }
+    }
+#endif
+
     ESP_LOGD(TAG, "SSL state connect : %d ", tlsDataParams->ssl.state);
     ESP_LOGD(TAG, "Performing the SSL/TLS handshake...");
-    while((ret = mbedtls_ssl_handshake(&(tlsDataParams->ssl))) != 0) {
-        if(ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+    /* Stepped through instead of calling mbedtls_ssl_handshake to time the
+       CertificateVerify message, the one step signing with the private key */
+    start_us = esp_timer_get_time();
+    while(tlsDataParams->ssl.state != MBEDTLS_SSL_HANDSHAKE_OVER) {
+        state = tlsDataParams->ssl.state;
+        step_us = esp_timer_get_time();
+        ret = mbedtls_ssl_handshake_step(&(tlsDataParams->ssl));
+        if(state == MBEDTLS_SSL_CERTIFICATE_VERIFY) {
+            pTiming->sign_ms += _iot_tls_elapsed_ms(step_us);
+        } else if(state == MBEDTLS_SSL_SERVER_CERTIFICATE) {
+            /* A resumed handshake goes from ServerHello straight to ChangeCipherSpec */
+            isFullHandshake = true;
+        }
+
+        if(ret != 0 && ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
             ESP_LOGE(TAG, "failed! mbedtls_ssl_handshake returned -0x%x", -ret);
             if(ret == MBEDTLS_ERR_X509_CERT_VERIFY_FAILED) {
                 ESP_LOGE(TAG, "    Unable to verify the server's certificate. ");
             }
+#ifdef CONFIG_AWS_IOT_TLS_SESSION_RESUMPTION
+            _iot_tls_forget_session(tlsDataParams);
+#endif
             return SSL_CONNECTION_ERROR;
         }
     }
+    pTiming->handshake_ms = _iot_tls_elapsed_ms(start_us);
+    pTiming->isSessionResumed = !isFullHandshake;
 
     ESP_LOGD(TAG, "ok    [ Protocol is %s ]    [ Ciphersuite is %s ]", mbedtls_ssl_get_version(&(tlsDataParams->ssl)),
           mbedtls_ssl_get_ciphersuite(&(tlsDataParams->ssl)));
@@ -357,6 +599,18 @@ IoT_Error_t iot_tls_connect(Network *pNetwork, TLSConnectParams *params) {
         }
     }
 
+#ifdef CONFIG_AWS_IOT_TLS_SESSION_RESUMPTION
+    if(ret == SUCCESS) {
+        _iot_tls_save_session(tlsDataParams);
+    } else {
+        _iot_tls_forget_session(tlsDataParams);
+    }
+#endif
+
+    ESP_LOGI(TAG, "TLS connect: credentials %u ms, TCP %u ms, handshake %u ms (%s, sign %u ms)",
+             pTiming->credentials_ms, pTiming->tcp_ms, pTiming->handshake_ms,
+             pTiming->isSessionResumed ? "resumed" : "full", pTiming->sign_ms);
+
 #ifdef CONFIG_AWS_IOT_SSL_SOCKET_NON_BLOCKING
 	mbedtls_net_set_nonblock(&(tlsDataParams->server_fd));
 #endif
@@ -414,6 +668,24 @@ IoT_Error_t iot_tls_write(Network *pNetwork, unsigned char *pMsg, size_t len, Ti
 	return SUCCESS;
 }
 
+IoT_Error_t iot_tls_writev(Network *pNetwork, const IoT_Iovec *pVec, size_t count, Timer *timer, size_t *written_len) {
+	size_t txLen = 0U;
+	size_t vecLen;
+	size_t i;
+	IoT_Error_t rc = SUCCESS;
+
+	/* Each buffer is passed to mbedtls_ssl_write where it is, mbedTLS copies
+	 * it only once into its record while encrypting */
+	for(i = 0U; i < count && SUCCESS == rc; i++) {
+		vecLen = 0U;
+		rc = iot_tls_write(pNetwork, (unsigned char *) pVec[i].pBuffer, pVec[i].len, timer, &vecLen);
+		txLen += vecLen;
+	}
+
+	*written_len = txLen;
+	return rc;
+}
+
 IoT_Error_t iot_tls_read(Network *pNetwork, unsigned char *pMsg, size_t len, Timer *timer, size_t *read_len) {
     TLSDataParams *tlsDataParams = &(pNetwork->tlsDataParams);
 	mbedtls_ssl_context *pSsl = &(pNetwork->tlsDataParams.ssl);
@@ -480,6 +752,33 @@ IoT_Error_t iot_tls_read(Network *pNetwork, unsigned char *pMsg, size_t len, Tim
 	return SUCCESS;
 }
 
+IoT_Error_t iot_tls_wait_for_read(Network *pNetwork, uint32_t timeout_ms) {
+    TLSDataParams *tlsDataParams = &(pNetwork->tlsDataParams);
+    fd_set readFds;
+    struct timeval timeout;
+    int ret;
+
+    /* Records mbedtls_ssl_read already decrypted are no longer visible on the socket */
+    if(mbedtls_ssl_get_bytes_avail(&(tlsDataParams->ssl)) > 0) {
+        return SUCCESS;
+    }
+
+    FD_ZERO(&readFds);
+    FD_SET(tlsDataParams->server_fd.fd, &readFds);
+    timeout.tv_sec = timeout_ms / 1000;
+    timeout.tv_usec = (timeout_ms % 1000) * 1000;
+
+    ret = select(tlsDataParams->server_fd.fd + 1, &readFds, NULL, NULL, &timeout);
+    if(ret > 0) {
+        return SUCCESS;
+    } else if(ret == 0 || errno == EINTR) {
+        return NETWORK_SSL_NOTHING_TO_READ;
+    }
+
+    ESP_LOGE(TAG, "failed! select returned %d, errno %d", ret, errno);
+    return NETWORK_SSL_READ_ERROR;
+}
+
 IoT_Error_t iot_tls_disconnect(Network *pNetwork) {
     mbedtls_ssl_context *ssl = &(pNetwork->tlsDataParams.ssl);
     int ret = 0;
@@ -498,9 +797,10 @@ IoT_Error_t iot_tls_destroy(Network *pNetwork) {
 
     mbedtls_net_free(&(tlsDataParams->server_fd));
 
-    mbedtls_x509_crt_free(&(tlsDataParams->clicert));
-    mbedtls_x509_crt_free(&(tlsDataParams->cacert));
-    mbedtls_pk_free(&(tlsDataParams->pkey));
+    /* Cached credentials stay for the next connect, iot_tls_free_cache frees them */
+    if(!tlsDataParams->isCredentialCached) {
+        _iot_tls_free_credentials(tlsDataParams);
+    }
     mbedtls_ssl_free(&(tlsDataParams->ssl));
     mbedtls_ssl_config_free(&(tlsDataParams->conf));
     mbedtls_ctr_drbg_free(&(tlsDataParams->ctr_drbg));
@@ -508,3 +808,15 @@ IoT_Error_t iot_tls_destroy(Network *pNetwork) {
 
     return SUCCESS;
 }
+
+IoT_Error_t iot_tls_free_cache(Network *pNetwork) {
+    TLSDataParams *tlsDataParams = &(pNetwork->tlsDataParams);
+
+    if(tlsDataParams->isCredentialCached) {
+        _iot_tls_free_credentials(tlsDataParams);
+    }
+    /* The RTC store is left alone, it is meant to outlive the client */
+    _iot_tls_free_session(tlsDataParams);
+
+    return SUCCESS;
+}
@@ -16,7 +16,12 @@
 
 /**
  * @file timer.c
- * @brief FreeRTOS implementation of the timer interface uses ticks.
+ * @brief FreeRTOS implementation of the timer interface on the microsecond esp_timer clock.
+ *
+ * The deadline is kept as an absolute esp_timer_get_time() value, so the
+ * resolution is a microsecond instead of a FreeRTOS tick. The MQTT yield
+ * blocks on the socket or sleeps until the next deadline of the client, see
+ * aws_iot_deadline_heap.h.
  */
 
 #ifdef __cplusplus
@@ -28,56 +33,60 @@ extern "C" {
 #include "timer_platform.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "esp_log.h"
-
-const static char *TAG = "aws_timer";
+#include "esp_timer.h"
 
 bool has_timer_expired(Timer *timer) {
-    uint32_t now = xTaskGetTickCount();
-    bool expired = (now - timer->start_ticks) >= timer->timeout_ticks;
+    bool expired = esp_timer_get_time() >= timer->end_us;
 
-    /* AWS IoT SDK isn't very RTOS friendly because it polls for "done
-       timers" a lot without ever sleeping on them. So we hack in some
-       amount of sleeping here: if it seems like the caller is polling
-       an unexpired timer in a tight loop then we delay a tick to let
-       things progress elsewhere.
+    /* The SDK still polls timers without sleeping in places that don't
+       block on the socket, such as the TLS read/write retries on a
+       non-blocking socket and the CONNACK/SUBACK/PUBACK waits. If the
+       same unexpired timer is polled twice within one tick, delay a tick
+       so lower priority tasks and IDLE get to run.
     */
-    if(!expired && now == timer->last_polled_ticks) {
-        vTaskDelay(1);
+    if (!expired) {
+        uint32_t now = xTaskGetTickCount();
+        if (now == timer->last_polled_ticks) {
+            vTaskDelay(1);
+        }
+        timer->last_polled_ticks = now;
     }
-    timer->last_polled_ticks = now;
     return expired;
 }
 
 void countdown_ms(Timer *timer, uint32_t timeout) {
-    timer->start_ticks = xTaskGetTickCount();
-    timer->timeout_ticks = timeout / portTICK_PERIOD_MS;
+    timer->end_us = esp_timer_get_time() + (int64_t) timeout * 1000;
     timer->last_polled_ticks = 0;
 }
 
+uint64_t left_us(Timer *timer) {
+    int64_t left = timer->end_us - esp_timer_get_time();
+    return (0 < left) ? (uint64_t) left : 0;
+}
+
 uint32_t left_ms(Timer *timer) {
-    uint32_t now = xTaskGetTickCount();
-    uint32_t elapsed = now - timer->start_ticks;
-    if (elapsed < timer->timeout_ticks) {
-        return (timer->timeout_ticks - elapsed) * portTICK_PERIOD_MS;
-    } else {
-        return 0;
-    }
+    return (uint32_t) (left_us(timer) / 1000);
+}
+
+uint64_t timer_deadline_us(Timer *timer) {
+    return (uint64_t) timer->end_us;
 }
 
 void countdown_sec(Timer *timer, uint32_t timeout) {
-    if (timeout > UINT32_MAX / 1000) {
-        ESP_LOGE(TAG, "timeout is out of range: %ds", timeout);
-    }
-    countdown_ms(timer, timeout * 1000);
+    timer->end_us = esp_timer_get_time() + (int64_t) timeout * 1000000;
+    timer->last_polled_ticks = 0;
 }
 
 void init_timer(Timer *timer) {
-    timer->start_ticks = 0;
-    timer->timeout_ticks = 0;
+    timer->end_us = 0;
     timer->last_polled_ticks = 0;
 }
 
+void delay(unsigned milliseconds) {
+    /* Round up so a delay shorter than a tick still sleeps instead of only yielding */
+    vTaskDelay((milliseconds + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS);
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -32,7 +32,7 @@
 #include <unistd.h>
 #include <limits.h>
 #include <string.h>
-#include <math.h>
+#include <time.h>
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -45,11 +45,13 @@
 #include "aws_iot_version.h"
 #include "aws_iot_mqtt_client_interface.h"
 #include "aws_iot_shadow_interface.h"
+#include "aws_iot_shadow_pipeline.h"
+#include "aws_iot_spool.h"
+#include "aws_iot_payload.h"
 
 #include "core2forAWS.h"
 
 #include "wifi.h"
-#include "fft.h"
 #include "ui.h"
 
 static const char *TAG = "MAIN";
@@ -63,11 +65,44 @@ static const char *TAG = "MAIN";
 #define STARTING_HVACSTATUS STANDBY
 #define STARTING_ROOMOCCUPANCY false
 
-// Number of slices to split the microphone sample into
-#define AUDIO_TIME_SLICES 60
+// A-weighted level mapped to 0 on the reported 0-255 sound scale
+#define SOUND_FLOOR_DBA -96.0f
 
 #define MAX_LENGTH_OF_UPDATE_JSON_BUFFER 200
 
+/* Shadow updates sent before the first of them has to be acknowledged */
+#define SHADOW_UPDATE_WINDOW 3
+
+#if CONFIG_THERMOSTAT_SPOOL_ENABLE
+#define SPOOL_MOUNT_POINT "/sdcard"
+/* Short file name, the FAT driver may be built without long name support */
+#define SPOOL_PATH SPOOL_MOUNT_POINT "/spool"
+#define SPOOL_BATCH_INTERVAL_MS 2000
+/* A batch goes out in a single publish, which leaves room for the topic and headers in the TX buffer */
+#define SPOOL_BATCH_BUFFER_LEN (AWS_IOT_MQTT_TX_BUF_LEN - 64)
+
+#define SPOOL_FLAG_OCCUPIED 0x01
+#define SPOOL_FLAG_HEATING 0x02
+#define SPOOL_FLAG_COOLING 0x04
+
+/* Reading spooled while offline, the payload of one spool record */
+typedef struct __attribute__((packed)) {
+    uint32_t time; // seconds of the system clock
+    int16_t temperature; // hundredths of a degree Fahrenheit
+    uint8_t sound;
+    uint8_t flags; // SPOOL_FLAG_ bits
+} spooled_reading_t;
+#endif
+
+#if CONFIG_THERMOSTAT_TELEMETRY_ENABLE
+#if CONFIG_THERMOSTAT_TELEMETRY_CBOR
+#define TELEMETRY_FORMAT AWS_IOT_PAYLOAD_CBOR
+#else
+#define TELEMETRY_FORMAT AWS_IOT_PAYLOAD_JSON
+#endif
+#define TELEMETRY_BUFFER_LEN 128
+#endif
+
 /* CA Root certificate */
 extern const uint8_t aws_root_ca_pem_start[] asm("_binary_aws_root_ca_pem_start");
 extern const uint8_t aws_root_ca_pem_end[] asm("_binary_aws_root_ca_pem_end");
@@ -79,9 +114,9 @@ char HostAddress[255] = AWS_IOT_MQTT_HOST;
 uint32_t port = AWS_IOT_MQTT_PORT;
 
 /*
-Semaphore for sound levels
+Latest microphone levels, written by microphone_task
 */
-SemaphoreHandle_t xMaxNoiseSemaphore;
+static mic_features_t micFeatures;
 
 void iot_subscribe_callback_handler(AWS_IoT_Client *pClient, char *topicName, uint16_t topicNameLen,
                                     IoT_Publish_Message_Params *params, void *pData) {
@@ -112,8 +147,6 @@ void disconnect_callback_handler(AWS_IoT_Client *pClient, void *data) {
     }
 }
 
-static bool shadowUpdateInProgress;
-
 void ShadowUpdateStatusCallback(const char *pThingName, ShadowActions_t action, Shadow_Ack_Status_t status,
                                 const char *pReceivedJsonDocument, void *pContextData) {
     IOT_UNUSED(pThingName);
@@ -121,8 +154,6 @@ void ShadowUpdateStatusCallback(const char *pThingName, ShadowActions_t action,
     IOT_UNUSED(pReceivedJsonDocument);
     IOT_UNUSED(pContextData);
 
-    shadowUpdateInProgress = false;
-
     if(SHADOW_ACK_TIMEOUT == status) {
         ESP_LOGE(TAG, "Update timed out");
     } else if(SHADOW_ACK_REJECTED == status) {
@@ -168,54 +199,154 @@ void occupancy_Callback(const char *pJsonString, uint32_t JsonStringDataLen, jso
     }
 }
 
+#if CONFIG_THERMOSTAT_TELEMETRY_ENABLE
+/* Control messages carry the same actuator fields as the shadow deltas, so the delta callbacks apply them */
+void control_callback_handler(AWS_IoT_Client *pClient, char *topicName, uint16_t topicNameLen,
+                              IoT_Publish_Message_Params *params, void *pData) {
+    const AWS_IoT_Payload_Topic *pTopic = (const AWS_IoT_Payload_Topic *) pData;
+    uint32_t updated = 0;
+
+    IoT_Error_t rc = aws_iot_payload_decode(pTopic->format, pTopic->pSchema, params->payload, params->payloadLen,
+                                            &updated);
+    if(SUCCESS != rc) {
+        ESP_LOGW(TAG, "Control message on %.*s not decoded - %d", topicNameLen, topicName, rc);
+    } else if(0 == updated) {
+        ESP_LOGW(TAG, "Control message on %.*s has no known field", topicNameLen, topicName);
+    }
+}
+#endif
+
 float temperature = STARTING_ROOMTEMPERATURE;
-uint8_t soundBuffer = STARTING_SOUNDLEVEL;
 uint8_t reportedSound = STARTING_SOUNDLEVEL;
 char hvacStatus[7] = STARTING_HVACSTATUS;
 bool roomOccupancy = STARTING_ROOMOCCUPANCY;
 
-// helper function for working with audio data
-long map(long x, long in_min, long in_max, long out_min, long out_max) {
-    long divisor = (in_max - in_min);
-    if(divisor == 0){
-        return -1; //AVR returns -1, SAM returns 0
+void read_sensors(void) {
+    // sample temperature, convert to fahrenheit
+    MPU6886_GetTempData(&temperature);
+    temperature = (temperature * 1.8)  + 32 - 50;
+
+    // scale the latest A-weighted level from the microphone to 0-255
+    mic_features_frame_t soundFrame;
+    if(mic_features_latest(&micFeatures, &soundFrame)) {
+        float level = (soundFrame.dba - SOUND_FLOOR_DBA) * 255.0f / -SOUND_FLOOR_DBA;
+        reportedSound = level <= 0.0f ? 0 : level >= 255.0f ? 255 : (uint8_t)level;
+    }
+}
+
+#if CONFIG_THERMOSTAT_SPOOL_ENABLE
+static AWS_IoT_Spool_Storage sdStorage;
+static AWS_IoT_Spool_File spoolFile;
+static AWS_IoT_Spool spool;
+static bool isSpoolReady = false;
+static uint8_t spoolBatchBuffer[SPOOL_BATCH_BUFFER_LEN];
+
+/*
+The SD card shares the SPI bus with the display, every access to the spool file takes the bus first
+*/
+static IoT_Error_t spool_sd_read(void *pContext, uint32_t offset, uint8_t *pBuf, size_t len, size_t *pRead) {
+    xSemaphoreTake(spi_mutex, portMAX_DELAY);
+    spi_poll();
+    IoT_Error_t rc = sdStorage.read(pContext, offset, pBuf, len, pRead);
+    xSemaphoreGive(spi_mutex);
+    return rc;
+}
+
+static IoT_Error_t spool_sd_append(void *pContext, const uint8_t *pBuf, size_t len) {
+    xSemaphoreTake(spi_mutex, portMAX_DELAY);
+    spi_poll();
+    IoT_Error_t rc = sdStorage.append(pContext, pBuf, len);
+    xSemaphoreGive(spi_mutex);
+    return rc;
+}
+
+static IoT_Error_t spool_sd_sync(void *pContext) {
+    xSemaphoreTake(spi_mutex, portMAX_DELAY);
+    spi_poll();
+    IoT_Error_t rc = sdStorage.sync(pContext);
+    xSemaphoreGive(spi_mutex);
+    return rc;
+}
+
+static IoT_Error_t spool_sd_rewrite(void *pContext, const uint8_t *pHead, size_t headLen, uint32_t srcOffset,
+                                    uint32_t srcLen) {
+    xSemaphoreTake(spi_mutex, portMAX_DELAY);
+    spi_poll();
+    IoT_Error_t rc = sdStorage.rewrite(pContext, pHead, headLen, srcOffset, srcLen);
+    xSemaphoreGive(spi_mutex);
+    return rc;
+}
+
+void spool_init(void) {
+    sdmmc_card_t *card;
+    IoT_Error_t rc = FAILURE;
+
+    xSemaphoreTake(spi_mutex, portMAX_DELAY);
+    spi_poll();
+    esp_err_t err = Core2ForAWS_SDcard_Mount(SPOOL_MOUNT_POINT, &card);
+    if(ESP_OK == err) {
+        rc = aws_iot_spool_file_open(&sdStorage, &spoolFile, SPOOL_PATH);
+    }
+    xSemaphoreGive(spi_mutex);
+
+    if(SUCCESS != rc) {
+        ESP_LOGW(TAG, "No spool on the SD card (%d, %d), readings taken while offline are dropped", err, rc);
+        return;
+    }
+
+    AWS_IoT_Spool_Storage lockedStorage = {
+        .read = spool_sd_read,
+        .append = spool_sd_append,
+        .sync = spool_sd_sync,
+        .rewrite = spool_sd_rewrite,
+        .pContext = sdStorage.pContext
+    };
+    rc = aws_iot_spool_init(&spool, &lockedStorage, CONFIG_THERMOSTAT_SPOOL_MAX_KB * 1024, SPOOL_BATCH_INTERVAL_MS);
+    if(SUCCESS != rc) {
+        ESP_LOGW(TAG, "Unable to open the spool - %d, readings taken while offline are dropped", rc);
+        return;
+    }
+    aws_iot_spool_set_sync_interval(&spool, CONFIG_THERMOSTAT_SPOOL_SYNC_EVERY);
+
+    isSpoolReady = true;
+    ESP_LOGI(TAG, "Spool holds %u readings to replay", (unsigned) aws_iot_spool_pending(&spool));
+}
+
+void spool_reading(void) {
+    spooled_reading_t reading;
+
+    if(!isSpoolReady) {
+        return;
+    }
+
+    reading.time = (uint32_t) time(NULL);
+    reading.temperature = (int16_t) (temperature * 100.0f);
+    reading.sound = reportedSound;
+    reading.flags = roomOccupancy ? SPOOL_FLAG_OCCUPIED : 0;
+    if(strcmp(hvacStatus, HEATING) == 0) {
+        reading.flags |= SPOOL_FLAG_HEATING;
+    } else if(strcmp(hvacStatus, COOLING) == 0) {
+        reading.flags |= SPOOL_FLAG_COOLING;
+    }
+
+    IoT_Error_t rc = aws_iot_spool_append(&spool, &reading, sizeof(reading), NULL);
+    if(SUCCESS != rc) {
+        ESP_LOGW(TAG, "Reading not spooled - %d", rc);
     }
-    return (x - in_min) * (out_max - out_min) / divisor + out_min;
 }
+#endif
 
 void microphone_task(void *arg) {
-    static int8_t i2s_readraw_buff[1024];
+    static int16_t i2s_readraw_buff[512];
     size_t bytesread;
-    int16_t *buffptr;
-    double data = 0;
+    mic_features_config_t config = MIC_FEATURES_CONFIG_DEFAULT();
 
+    mic_features_init(&micFeatures, &config);
     Microphone_Init();
-    uint8_t maxSound = 0x00;
-    uint8_t currentSound = 0x00;
 
     for (;;) {
-        maxSound = 0x00;
-        fft_config_t *real_fft_plan = fft_init(512, FFT_REAL, FFT_FORWARD, NULL, NULL);
-        i2s_read(I2S_NUM_0, (char *)i2s_readraw_buff, 1024, &bytesread, pdMS_TO_TICKS(100));
-        buffptr = (int16_t *)i2s_readraw_buff;
-        for (uint16_t count_n = 0; count_n < real_fft_plan->size; count_n++) {
-            real_fft_plan->input[count_n] = (float)map(buffptr[count_n], INT16_MIN, INT16_MAX, -1000, 1000);
-        }
-        fft_execute(real_fft_plan);
-
-        for (uint16_t count_n = 1; count_n < AUDIO_TIME_SLICES; count_n++) {
-            data = sqrt(real_fft_plan->output[2 * count_n] * real_fft_plan->output[2 * count_n] + real_fft_plan->output[2 * count_n + 1] * real_fft_plan->output[2 * count_n + 1]);
-            currentSound = map(data, 0, 2000, 0, 256);
-            if(currentSound > maxSound) {
-                maxSound = currentSound;
-            }
-        }
-        fft_destroy(real_fft_plan);
-
-        // store max of sample in semaphore
-        xSemaphoreTake(xMaxNoiseSemaphore, portMAX_DELAY);
-        soundBuffer = maxSound;
-        xSemaphoreGive(xMaxNoiseSemaphore);
+        i2s_read(I2S_NUM_0, (char *)i2s_readraw_buff, sizeof(i2s_readraw_buff), &bytesread, pdMS_TO_TICKS(100));
+        mic_features_process(&micFeatures, i2s_readraw_buff, bytesread / sizeof(int16_t), NULL);
     }
 }
 
@@ -253,6 +384,16 @@ void aws_iot_task(void *param) {
     roomOccupancyActuator.type = SHADOW_JSON_BOOL;
     roomOccupancyActuator.dataLength = sizeof(bool);
 
+#if CONFIG_THERMOSTAT_TELEMETRY_ENABLE
+    // CBOR keys are the positions in these lists, only ever append to them
+    jsonStruct_t *const telemetryFields[] = {&temperatureHandler, &soundHandler, &roomOccupancyActuator,
+                                             &hvacStatusActuator};
+    const AWS_IoT_Payload_Schema telemetrySchema = {telemetryFields, 4};
+    jsonStruct_t *const controlFields[] = {&roomOccupancyActuator, &hvacStatusActuator};
+    const AWS_IoT_Payload_Schema controlSchema = {controlFields, 2};
+    uint8_t telemetryBuffer[TELEMETRY_BUFFER_LEN];
+#endif
+
     ESP_LOGI(TAG, "AWS IoT SDK Version %d.%d.%d-%s", VERSION_MAJOR, VERSION_MINOR, VERSION_PATCH, VERSION_TAG);
 
     // initialize the mqtt client
@@ -290,6 +431,25 @@ void aws_iot_task(void *param) {
         abort();
     }
 
+#if CONFIG_THERMOSTAT_SPOOL_ENABLE
+    spool_init();
+
+    char spoolTopic[CLIENT_ID_LEN + sizeof("/spool")];
+    snprintf(spoolTopic, sizeof(spoolTopic), "%s/spool", client_id);
+#endif
+
+#if CONFIG_THERMOSTAT_TELEMETRY_ENABLE
+    char telemetryTopicName[CLIENT_ID_LEN + sizeof("/telemetry")];
+    snprintf(telemetryTopicName, sizeof(telemetryTopicName), "%s/telemetry", client_id);
+    const AWS_IoT_Payload_Topic telemetryTopic = {telemetryTopicName, strlen(telemetryTopicName), TELEMETRY_FORMAT,
+                                                  &telemetrySchema};
+
+    char controlTopicName[CLIENT_ID_LEN + sizeof("/control")];
+    snprintf(controlTopicName, sizeof(controlTopicName), "%s/control", client_id);
+    const AWS_IoT_Payload_Topic controlTopic = {controlTopicName, strlen(controlTopicName), TELEMETRY_FORMAT,
+                                                &controlSchema};
+#endif
+
     ShadowConnectParameters_t scp = ShadowConnectParametersDefault;
     scp.pMyThingName = client_id;
     scp.pMqttClientId = client_id;
@@ -328,27 +488,39 @@ void aws_iot_task(void *param) {
         ESP_LOGE(TAG, "Shadow Register Delta Error");
     }
 
+#if CONFIG_THERMOSTAT_TELEMETRY_ENABLE
+    rc = aws_iot_mqtt_subscribe(&iotCoreClient, controlTopic.pTopicName, controlTopic.topicNameLen, QOS0,
+                                control_callback_handler, (void *) &controlTopic);
+    if(SUCCESS != rc) {
+        ESP_LOGE(TAG, "Unable to subscribe to %s - %d", controlTopicName, rc);
+    }
+#endif
+
+    // keep a few updates in flight instead of waiting for every ack
+    static ShadowUpdatePipeline_t shadowPipeline;
+    rc = aws_iot_shadow_pipeline_init(&shadowPipeline, &iotCoreClient, client_id, JsonDocumentBuffer,
+                                      sizeOfJsonDocumentBuffer, SHADOW_UPDATE_WINDOW, 4,
+                                      ShadowUpdateStatusCallback, NULL);
+    if(SUCCESS != rc) {
+        ESP_LOGE(TAG, "Unable to set up the shadow update pipeline - %d, aborting...", rc);
+        abort();
+    }
+
     // loop and publish changes
     while(NETWORK_ATTEMPTING_RECONNECT == rc || NETWORK_RECONNECTED == rc || SUCCESS == rc) {
         rc = aws_iot_shadow_yield(&iotCoreClient, 200);
-        if(NETWORK_ATTEMPTING_RECONNECT == rc || shadowUpdateInProgress) {
+        if(NETWORK_ATTEMPTING_RECONNECT == rc) {
+#if CONFIG_THERMOSTAT_SPOOL_ENABLE
+            // keep the readings on the SD card until they can be published
+            read_sensors();
+            spool_reading();
+#endif
             rc = aws_iot_shadow_yield(&iotCoreClient, 1000);
-            // If the client is attempting to reconnect, or already waiting on a shadow update,
-            // we will skip the rest of the loop.
+            // If the client is attempting to reconnect, we will skip the rest of the loop.
             continue;
         }
 
-        // START get sensor readings
-        // sample temperature, convert to fahrenheit
-        MPU6886_GetTempData(&temperature);
-        temperature = (temperature * 1.8)  + 32 - 50;
-
-        // sample from soundBuffer (latest reading from microphone)
-        xSemaphoreTake(xMaxNoiseSemaphore, portMAX_DELAY);
-        reportedSound = soundBuffer;
-        xSemaphoreGive(xMaxNoiseSemaphore);
-
-        // END get sensor readings
+        read_sensors();
 
         ESP_LOGI(TAG, "*****************************************************************************************");
         ESP_LOGI(TAG, "On Device: roomOccupancy %s", roomOccupancy ? "true" : "false");
@@ -356,20 +528,46 @@ void aws_iot_task(void *param) {
         ESP_LOGI(TAG, "On Device: temperature %f", temperature);
         ESP_LOGI(TAG, "On Device: sound %d", reportedSound);
 
-        rc = aws_iot_shadow_init_json_document(JsonDocumentBuffer, sizeOfJsonDocumentBuffer);
-        if(SUCCESS == rc) {
-            rc = aws_iot_shadow_add_reported(JsonDocumentBuffer, sizeOfJsonDocumentBuffer, 4, &temperatureHandler,
-                                             &soundHandler, &roomOccupancyActuator, &hvacStatusActuator);
-            if(SUCCESS == rc) {
-                rc = aws_iot_finalize_json_document(JsonDocumentBuffer, sizeOfJsonDocumentBuffer);
-                if(SUCCESS == rc) {
-                    ESP_LOGI(TAG, "Update Shadow: %s", JsonDocumentBuffer);
-                    rc = aws_iot_shadow_update(&iotCoreClient, client_id, JsonDocumentBuffer,
-                                               ShadowUpdateStatusCallback, NULL, 4, true);
-                    shadowUpdateInProgress = true;
-                }
+        // values staged while the window is full are replaced by the next readings
+        aws_iot_shadow_pipeline_report(&shadowPipeline, &temperatureHandler);
+        aws_iot_shadow_pipeline_report(&shadowPipeline, &soundHandler);
+        aws_iot_shadow_pipeline_report(&shadowPipeline, &roomOccupancyActuator);
+        aws_iot_shadow_pipeline_report(&shadowPipeline, &hvacStatusActuator);
+        rc = aws_iot_shadow_pipeline_flush(&shadowPipeline);
+
+        ShadowPipelineMetrics_t shadowMetrics;
+        aws_iot_shadow_pipeline_get_metrics(&shadowPipeline, &shadowMetrics);
+        ESP_LOGI(TAG, "Shadow updates sent %u, in flight %u, last ack latency %u ms",
+                 (unsigned) shadowMetrics.sent, (unsigned) shadowMetrics.inFlight,
+                 (unsigned) shadowMetrics.lastAckLatency_ms);
+
+#if CONFIG_THERMOSTAT_TELEMETRY_ENABLE
+        IoT_Error_t telemetryRc = aws_iot_payload_publish(&iotCoreClient, &telemetryTopic, QOS0, telemetryBuffer,
+                                                          sizeof(telemetryBuffer));
+        if(SUCCESS != telemetryRc) {
+            ESP_LOGW(TAG, "Telemetry publish error %d", telemetryRc);
+        }
+#endif
+
+#if CONFIG_THERMOSTAT_SPOOL_ENABLE
+        // connected again, save the readings spooled since the last sync before replaying them
+        if(isSpoolReady && SUCCESS != aws_iot_spool_sync(&spool)) {
+            ESP_LOGW(TAG, "Spool sync error");
+        }
+
+        // send what was spooled while offline, one batch at a time so the live updates keep going
+        if(isSpoolReady && 0 < aws_iot_spool_pending(&spool)) {
+            uint32_t replayed = 0;
+            IoT_Error_t spoolRc = aws_iot_spool_replay(&spool, &iotCoreClient, spoolTopic, strlen(spoolTopic),
+                                                       spoolBatchBuffer, sizeof(spoolBatchBuffer), &replayed);
+            if(SUCCESS != spoolRc) {
+                ESP_LOGW(TAG, "Spool replay error %d", spoolRc);
+            } else if(0 < replayed) {
+                ESP_LOGI(TAG, "Replayed %u spooled readings, %u left", (unsigned) replayed,
+                         (unsigned) aws_iot_spool_pending(&spool));
             }
         }
+#endif
         ESP_LOGI(TAG, "*****************************************************************************************");
         ESP_LOGI(TAG, "Stack remaining for task '%s' is %d bytes", pcTaskGetTaskName(NULL), uxTaskGetStackHighWaterMark(NULL));
 
@@ -396,8 +594,6 @@ void app_main()
     Core2ForAWS_Display_SetBrightness(80);
     Core2ForAWS_LED_Enable(1);
 
-    xMaxNoiseSemaphore = xSemaphoreCreateMutex();
-
     ui_init();
     initialise_wifi();
 